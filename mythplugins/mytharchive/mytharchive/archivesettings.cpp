@@ -122,6 +122,19 @@ static HostCheckBox *MythArchiveCopyRemoteFiles()
     return gc;
 };
 
+static HostSpinBox *MythArchiveCopyThreads()
+{
+    HostSpinBox *gc = new HostSpinBox("MythArchiveCopyThreads", 1, 8, 1);
+
+    gc->setLabel(ArchiveSettings::tr("Simultaneous file copies"));
+    gc->setValue(2);
+
+    gc->setHelpText(ArchiveSettings::tr("This is the number of files to copy "
+                                        "at the same time when creating or "
+                                        "importing a native archive."));
+    return gc;
+};
+
 static HostCheckBox *MythArchiveAlwaysUseMythTranscode()
 {
     HostCheckBox *gc = new HostCheckBox("MythArchiveAlwaysUseMythTranscode");
@@ -424,6 +437,7 @@ ArchiveSettings::ArchiveSettings()
     VerticalConfigurationGroup* vcg2 = new VerticalConfigurationGroup(false);
     vcg2->setLabel(ArchiveSettings::tr("MythArchive Settings (2)"));
     vcg2->addChild(MythArchiveCopyRemoteFiles());
+    vcg2->addChild(MythArchiveCopyThreads());
     vcg2->addChild(MythArchiveAlwaysUseMythTranscode());
     vcg2->addChild(MythArchiveUseProjectX());
     vcg2->addChild(MythArchiveAddSubtitles());
@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <sys/wait.h>  // for WIFEXITED and WEXITSTATUS
 #include <unistd.h>
+#include <cmath>
 #include <cstdlib>
 
 #include <mythconfig.h>
@@ -43,6 +44,8 @@ using namespace std;
 
 // Qt headers
 #include <QApplication>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QDir>
 #include <QDomElement>
@@ -50,6 +53,7 @@ using namespace std;
 #include <QMutex>
 #include <QMutexLocker>
 #include <QTextStream>
+#include <QThread>
 
 // MythTV headers
 #include <mythcommandlineparser.h>
@@ -66,6 +70,8 @@ using namespace std;
 #include <mythdate.h>
 #include <mythlogging.h>
 #include <mythavutil.h>
+#include <mthread.h>
+#include <remotefile.h>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -77,6 +83,233 @@ extern "C" {
 #include "../mytharchive/archiveutil.h"
 #include "../mytharchive/remoteavformatcontext.h"
 
+/// A file for ArchiveCopier to copy, and what it found while copying it
+class ArchiveFile
+{
+  public:
+    ArchiveFile(const QString &_source, const QString &_destination) :
+        source(_source), destination(_destination), size(0), ok(false) {}
+
+    QString   source;
+    QString   destination;
+    QString   checksum; ///< md5 of the bytes copied, in hex
+    long long size;
+    bool      ok;
+};
+
+/**
+ *  \brief Copies the files of archive jobs, MythArchiveCopyThreads
+ *         (default 2) at a time.
+ *
+ *  Each file is read once, in large blocks, and checksummed as it is
+ *  copied, so an archive can be checked when it is imported without
+ *  reading it all again.
+ */
+class ArchiveCopier
+{
+  public:
+    ArchiveCopier(void) : m_next(0) {}
+    ~ArchiveCopier(void) { qDeleteAll(m_files); }
+
+    ArchiveFile *addFile(const QString &source, const QString &destination);
+    bool run(void);
+
+    ArchiveFile *nextFile(void);
+    static bool copyFile(ArchiveFile *file);
+
+  private:
+    QList<ArchiveFile*> m_files;
+    int                 m_next;
+    QMutex              m_lock;
+};
+
+class ArchiveCopyThread : public MThread
+{
+  public:
+    explicit ArchiveCopyThread(ArchiveCopier *parent) :
+        MThread("ArchiveCopy"), m_parent(parent) {}
+
+  protected:
+    virtual void run(void) // MThread
+    {
+        RunProlog();
+        ArchiveFile *file;
+        while ((file = m_parent->nextFile()))
+            file->ok = ArchiveCopier::copyFile(file);
+        RunEpilog();
+    }
+
+  private:
+    ArchiveCopier *m_parent;
+};
+
+ArchiveFile *ArchiveCopier::addFile(const QString &source,
+                                    const QString &destination)
+{
+    ArchiveFile *file = new ArchiveFile(source, destination);
+    m_files.append(file);
+    return file;
+}
+
+ArchiveFile *ArchiveCopier::nextFile(void)
+{
+    QMutexLocker locker(&m_lock);
+    if (m_next >= m_files.size())
+        return NULL;
+    return m_files[m_next++];
+}
+
+/// Copies every file added since the last run, returns false if any failed
+bool ArchiveCopier::run(void)
+{
+    int threads = qBound(1, gCoreContext->GetNumSetting(
+                                "MythArchiveCopyThreads", 2), 8);
+    threads = qMin(threads, m_files.size() - m_next);
+
+    QElapsedTimer timer;
+    timer.start();
+    int first = m_next;
+
+    QList<ArchiveCopyThread*> copiers;
+    for (int x = 0; x < threads; x++)
+    {
+        ArchiveCopyThread *copier = new ArchiveCopyThread(this);
+        copiers.append(copier);
+        copier->start();
+    }
+
+    for (int x = 0; x < copiers.size(); x++)
+    {
+        copiers[x]->wait();
+        delete copiers[x];
+    }
+
+    bool ok = true;
+    long long bytes = 0;
+    for (int x = first; x < m_files.size(); x++)
+    {
+        ok &= m_files[x]->ok;
+        bytes += m_files[x]->size;
+    }
+
+    if (threads > 0)
+    {
+        double secs = qMax(timer.elapsed(), (qint64)1) / 1000.0;
+        LOG(VB_JOBQUEUE, LOG_INFO,
+            QString("Copied %1 files, %2 MB in %3 secs (%4 MB/s) "
+                    "using %5 threads")
+                .arg(m_files.size() - first).arg(bytes / (1024 * 1024))
+                .arg(secs, 0, 'f', 1)
+                .arg(bytes / (1024 * 1024) / secs, 0, 'f', 1).arg(threads));
+    }
+
+    return ok;
+}
+
+bool ArchiveCopier::copyFile(ArchiveFile *file)
+{
+    // a reasonably large block keeps the disks streaming when several
+    // files are being copied at once
+    const int blockSize = 4 * 1024 * 1024;
+
+    LOG(VB_JOBQUEUE, LOG_INFO, QString("Copying %1 to %2")
+            .arg(file->source).arg(file->destination));
+
+    RemoteFile src(file->source, false);
+    if (!src.isOpen())
+    {
+        LOG(VB_JOBQUEUE, LOG_ERR,
+            QString("Failed to open %1 for reading").arg(file->source));
+        return false;
+    }
+
+    RemoteFile dst(file->destination, true);
+    if (!dst.isOpen())
+    {
+        LOG(VB_JOBQUEUE, LOG_ERR,
+            QString("Failed to open %1 for writing").arg(file->destination));
+        return false;
+    }
+    dst.SetBlocking(true);
+
+    long long total = src.GetRealFileSize();
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    QByteArray buf(blockSize, 0);
+    bool ok = true;
+    int len;
+
+    QElapsedTimer timer, progress;
+    timer.start();
+    progress.start();
+
+    while ((len = src.Read(buf.data(), blockSize)) > 0)
+    {
+        if (dst.Write(buf.constData(), len) != len)
+        {
+            LOG(VB_JOBQUEUE, LOG_ERR,
+                QString("Failed to write to %1 at offset %2")
+                    .arg(file->destination).arg(file->size));
+            ok = false;
+            break;
+        }
+
+        hash.addData(buf.constData(), len);
+        file->size += len;
+
+        if (progress.elapsed() >= 10000)
+        {
+            LOG(VB_JOBQUEUE, LOG_INFO,
+                QString("%1: %2% copied, %3 MB/s").arg(file->source)
+                    .arg(total > 0 ? file->size * 100 / total : 0)
+                    .arg(file->size / 1024.0 * 1000 / 1024 / timer.elapsed(),
+                         0, 'f', 1));
+            progress.restart();
+        }
+    }
+
+    if (len < 0)
+    {
+        LOG(VB_JOBQUEUE, LOG_ERR, QString("Failed to read from %1 at offset %2")
+                .arg(file->source).arg(file->size));
+        ok = false;
+    }
+
+    src.Close();
+    dst.Close();
+
+    if (!ok)
+    {
+        RemoteFile::DeleteFile(file->destination);
+        return false;
+    }
+
+    file->checksum = hash.result().toHex();
+
+    double secs = qMax(timer.elapsed(), (qint64)1) / 1000.0;
+    LOG(VB_JOBQUEUE, LOG_INFO,
+        QString("Copied %1, %2 MB in %3 secs (%4 MB/s), md5 %5")
+            .arg(file->source).arg(file->size / (1024 * 1024))
+            .arg(secs, 0, 'f', 1)
+            .arg(file->size / (1024.0 * 1024) / secs, 0, 'f', 1)
+            .arg(file->checksum));
+
+    return true;
+}
+
+/// An exported item, whose xml is saved once its files have been copied
+class ExportItem
+{
+  public:
+    ExportItem(const QDomDocument &_doc, const QString &_title,
+               const QString &_xmlFile) :
+        doc(_doc), title(_title), xmlFile(_xmlFile) {}
+
+    QDomDocument        doc;
+    QString             title;
+    QString             xmlFile;
+    QList<ArchiveFile*> files;
+};
+
 class NativeArchive
 {
   public:
@@ -85,15 +318,19 @@ class NativeArchive
 
       int doNativeArchive(const QString &jobFile);
       int doImportArchive(const QString &xmlFile, int chanID);
-      bool copyFile(const QString &source, const QString &destination);
       int importRecording(const QDomElement &itemNode,
                           const QString &xmlFile, int chanID);
       int importVideo(const QDomElement &itemNode, const QString &xmlFile);
       int exportRecording(QDomElement &itemNode, const QString &saveDirectory);
       int exportVideo(QDomElement &itemNode, const QString &saveDirectory);
   private:
+      bool saveExportedItems(void);
+      bool verifyFile(const QDomElement &itemNode, const ArchiveFile *file);
       QString findNodeText(const QDomElement &elem, const QString &nodeName);
       int getFieldList(QStringList &fieldList, const QString &tableName);
+
+      ArchiveCopier       m_exportCopier;
+      QList<ExportItem*>  m_exportItems;
 };
 
 NativeArchive::NativeArchive(void)
@@ -118,18 +355,114 @@ NativeArchive::~NativeArchive(void)
         QFile::remove(tempDir + "/logs/mythburn.lck");
 }
 
-bool NativeArchive::copyFile(const QString &source, const QString &destination)
+/// Copies the files of every exported item, then saves the xml of those
+/// which copied OK with the checksums of their files. The files of an item
+/// that can't be saved are removed, and false is returned if any failed.
+bool NativeArchive::saveExportedItems(void)
 {
-    QString command = QString("mythutil --copyfile --infile '%1' --outfile '%2'")
-                              .arg(source).arg(destination);
-    uint res = myth_system(command);
-    if (res != GENERIC_EXIT_OK)
+    bool allOK = m_exportCopier.run();
+
+    for (int x = 0; x < m_exportItems.size(); x++)
     {
-        LOG(VB_JOBQUEUE, LOG_ERR,
-            QString("Failed while running %1. Result: %2").arg(command).arg(res));
+        ExportItem *item = m_exportItems[x];
+
+        QDomElement checksums = item->doc.createElement("checksums");
+        bool ok = true;
+        for (int y = 0; y < item->files.size(); y++)
+        {
+            const ArchiveFile *file = item->files[y];
+            ok &= file->ok;
+
+            QDomElement elem = item->doc.createElement("file");
+            elem.setAttribute("name", QFileInfo(file->destination).fileName());
+            elem.setAttribute("size", file->size);
+            elem.setAttribute("md5", file->checksum);
+            checksums.appendChild(elem);
+        }
+
+        if (ok)
+        {
+            item->doc.documentElement().appendChild(checksums);
+
+            QFile f(item->xmlFile);
+            if (f.open(QIODevice::WriteOnly))
+            {
+                QTextStream t(&f);
+                t << item->doc.toString(4);
+                f.close();
+            }
+            else
+            {
+                LOG(VB_JOBQUEUE, LOG_ERR,
+                    "MythNativeWizard: Failed to open file for writing - " +
+                    item->xmlFile);
+                ok = false;
+            }
+        }
+
+        if (!ok)
+        {
+            LOG(VB_JOBQUEUE, LOG_ERR, "Failed to archive " + item->title);
+
+            // without its xml the rest of the item can't be imported, so
+            // don't leave it behind (files that failed are already gone)
+            for (int y = 0; y < item->files.size(); y++)
+            {
+                if (item->files[y]->ok)
+                    RemoteFile::DeleteFile(item->files[y]->destination);
+            }
+
+            allOK = false;
+            continue;
+        }
+
+        LOG(VB_JOBQUEUE, LOG_INFO, "Item Archived OK - " + item->title);
+    }
+
+    qDeleteAll(m_exportItems);
+    m_exportItems.clear();
+
+    return allOK;
+}
+
+/// Checks a file copied from an archive against the checksum saved when the
+/// archive was made, archives made before checksums were saved always pass
+bool NativeArchive::verifyFile(const QDomElement &itemNode,
+                               const ArchiveFile *file)
+{
+    if (!file->ok)
         return false;
+
+    QString name = QFileInfo(file->source).fileName();
+    QDomNodeList nodeList = itemNode.elementsByTagName("checksums");
+    if (nodeList.count() < 1)
+    {
+        LOG(VB_JOBQUEUE, LOG_INFO, "No checksum in archive for " + name);
+        return true;
     }
 
+    QDomNodeList files = nodeList.item(0).toElement().elementsByTagName("file");
+    for (int x = 0; x < files.count(); x++)
+    {
+        QDomElement elem = files.item(x).toElement();
+        if (elem.attribute("name") != name)
+            continue;
+
+        if (elem.attribute("md5") != file->checksum ||
+            elem.attribute("size").toLongLong() != file->size)
+        {
+            LOG(VB_JOBQUEUE, LOG_ERR,
+                QString("%1 is damaged, its checksum is %2 but should be %3")
+                    .arg(name).arg(file->checksum).arg(elem.attribute("md5")));
+            RemoteFile::DeleteFile(file->destination);
+            return false;
+        }
+
+        LOG(VB_JOBQUEUE, LOG_INFO, "Checksum OK for " + name);
+        return true;
+    }
+
+    LOG(VB_JOBQUEUE, LOG_INFO, "No checksum in archive for " + name);
     return true;
 }
 
@@ -341,6 +674,12 @@ int NativeArchive::doNativeArchive(const QString &jobFile)
         }
     }
 
+    if (!saveExportedItems())
+    {
+        LOG(VB_JOBQUEUE, LOG_ERR, "Native archive job failed to completed");
+        return 1;
+    }
+
     // burn the dvd if needed
     if (mediaType != AD_FILE && bDoBurn)
     {
@@ -581,38 +920,24 @@ int NativeArchive::exportRecording(QDomElement   &itemNode,
             "Created recordedseek element for " + title);
     }
 
-    // finally save the xml to the file
+    // the files are copied along with those of the other items, and the
+    // xml saved once they have been
     QString baseName = getBaseName(filename);
     QString xmlFile = saveDirectory + title + "/" + baseName + ".xml";
-    QFile f(xmlFile);
-    if (!f.open(QIODevice::WriteOnly))
-    {
-        LOG(VB_JOBQUEUE, LOG_ERR,
-            "MythNativeWizard: Failed to open file for writing - " + xmlFile);
-        return 0;
-    }
-
-    QTextStream t(&f);
-    t << doc.toString(4);
-    f.close();
+    ExportItem *item = new ExportItem(doc, title, xmlFile);
 
-    // copy the file
-    LOG(VB_JOBQUEUE, LOG_INFO, "Copying video file");
-    bool res = copyFile(filename, saveDirectory + title + "/" + baseName);
-    if (!res)
-        return 0;
+    item->files.append(m_exportCopier.addFile(
+                           filename, saveDirectory + title + "/" + baseName));
 
     // copy preview image
     if (QFile::exists(filename + ".png"))
     {
-        LOG(VB_JOBQUEUE, LOG_INFO, "Copying preview image");
-        res = copyFile(filename + ".png", saveDirectory
-                       + title + "/" + baseName + ".png");
-        if (!res)
-            return 0;
+        item->files.append(m_exportCopier.addFile(
+                               filename + ".png", saveDirectory + title
+                               + "/" + baseName + ".png"));
     }
 
-    LOG(VB_JOBQUEUE, LOG_INFO, "Item Archived OK");
+    m_exportItems.append(item);
 
     return 1;
 }
@@ -824,45 +1149,27 @@ int NativeArchive::exportVideo(QDomElement   &itemNode,
         LOG(VB_JOBQUEUE, LOG_INFO, "Created videogenre element for " + title);
     }
 
-    // finally save the xml to the file
+    // the files are copied along with those of the other items, and the
+    // xml saved once they have been
     QFileInfo fileInfo(filename);
     QString xmlFile = saveDirectory + title + "/"
                       + fileInfo.fileName() + ".xml";
-    QFile f(xmlFile);
-    if (!f.open(QIODevice::WriteOnly))
-    {
-        LOG(VB_JOBQUEUE, LOG_INFO,
-            "MythNativeWizard: Failed to open file for writing - " + xmlFile);
-        return 0;
-    }
-
-    QTextStream t(&f);
-    t << doc.toString(4);
-    f.close();
+    ExportItem *item = new ExportItem(doc, title, xmlFile);
 
-    // copy the file
-    LOG(VB_JOBQUEUE, LOG_INFO, "Copying video file");
-    bool res = copyFile(filename, saveDirectory + title
-                        + "/" + fileInfo.fileName());
-    if (!res)
-    {
-        return 0;
-    }
+    item->files.append(m_exportCopier.addFile(
+                           filename, saveDirectory + title
+                           + "/" + fileInfo.fileName()));
 
     // copy the cover image
     fileInfo.setFile(coverFile);
     if (fileInfo.exists())
     {
-        LOG(VB_JOBQUEUE, LOG_INFO, "Copying cover file");
-        bool res = copyFile(coverFile, saveDirectory + title
-                            + "/" + fileInfo.fileName());
-        if (!res)
-        {
-            return 0;
-        }
+        item->files.append(m_exportCopier.addFile(
+                               coverFile, saveDirectory + title
+                               + "/" + fileInfo.fileName()));
     }
 
-    LOG(VB_JOBQUEUE, LOG_INFO, "Item Archived OK");
+    m_exportItems.append(item);
 
     return 1;
 }
@@ -978,17 +1285,23 @@ int NativeArchive::importRecording(const QDomElement &itemNode,
                                                 gCoreContext->GetMasterServerPort(),
                                                 basename , "Default");
 
-    // copy file to recording directory
+    // copy file, and any preview image, to recording directory
+    ArchiveCopier copier;
     LOG(VB_JOBQUEUE, LOG_INFO, "Copying video file to: " + destFile);
-    if (!copyFile(videoFile,  destFile))
-        return 1;
+    ArchiveFile *video = copier.addFile(videoFile, destFile);
 
-    // copy any preview image to recording directory
+    ArchiveFile *preview = NULL;
     if (QFile::exists(videoFile + ".png"))
     {
         LOG(VB_JOBQUEUE, LOG_INFO, "Copying preview image file to: " + destFile + ".png");
-        if (!copyFile(videoFile + ".png", destFile + ".png"))
-            return 1;
+        preview = copier.addFile(videoFile + ".png", destFile + ".png");
+    }
+
+    copier.run();
+    if (!verifyFile(itemNode, video) ||
+        (preview && !verifyFile(itemNode, preview)))
+    {
+        return 1;
     }
 
     // get a list of fields from the xmlFile
@@ -1175,11 +1488,10 @@ int NativeArchive::importVideo(const QDomElement &itemNode, const QString &xmlFi
         }
     }
 
+    ArchiveCopier copier;
     LOG(VB_JOBQUEUE, LOG_INFO, "Copying video file");
-    if (!copyFile(videoFile, path + "/" + basename))
-    {
-        return 1;
-    }
+    ArchiveFile *video = copier.addFile(videoFile, path + "/" + basename);
+    ArchiveFile *cover = NULL;
 
     // copy cover image to Video Artwork dir
     QString artworkDir = gCoreContext->GetSetting("VideoArtworkDir");
@@ -1196,14 +1508,18 @@ int NativeArchive::importVideo(const QDomElement &itemNode, const QString &xmlFi
     {
         LOG(VB_JOBQUEUE, LOG_INFO, "Copying cover file");
 
-        if (!copyFile(archivePath + "/" + coverFilename, artworkDir + "/" + coverFilename))
-        {
-            return 1;
-        }
+        cover = copier.addFile(archivePath + "/" + coverFilename,
+                               artworkDir + "/" + coverFilename);
     }
     else
         coverFilename = "No Cover";
 
+    copier.run();
+    if (!verifyFile(itemNode, video) || (cover && !verifyFile(itemNode, cover)))
+    {
+        return 1;
+    }
+
     // copy videometadata to database
     MSqlQuery query(MSqlQuery::InitCon());
     query.prepare("INSERT INTO videometadata (title, director, plot, rating, inetref, "
@@ -1556,10 +1872,92 @@ static int doImportArchive(const QString &inFile, int chanID)
     return na.doImportArchive(inFile, chanID);
 }
 
+// Reads packets until the decoder gives us a frame, false at the end of the file
+static bool decodeNextFrame(AVFormatContext *inputFC, AVCodecContext *codecCtx,
+                            int videostream, AVFrame *frame)
+{
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    int frameFinished = 0;
+
+    while (!frameFinished)
+    {
+        if (av_read_frame(inputFC, &pkt) < 0)
+            return false;
+
+        if (pkt.stream_index == videostream)
+        {
+            av_frame_unref(frame);
+            avcodec_decode_video2(codecCtx, frame, &frameFinished, &pkt);
+        }
+
+        av_free_packet(&pkt);
+    }
+
+    return true;
+}
+
+// Positions the decoder on the keyframe before targetFrame using the
+// recording's seek table and decodes up to it
+static bool seekToFrameByIndex(AVFormatContext *inputFC, AVCodecContext *codecCtx,
+                               int videostream, AVFrame *frame,
+                               const frm_pos_map_t &posMap, int64_t targetFrame)
+{
+    frm_pos_map_t::const_iterator it = posMap.upperBound(targetFrame);
+    if (it == posMap.constBegin())
+        return false;
+    --it;
+
+    if (av_seek_frame(inputFC, -1, it.value(), AVSEEK_FLAG_BYTE) < 0)
+        return false;
+
+    avcodec_flush_buffers(codecCtx);
+
+    int64_t frameNo = it.key();
+    bool found = decodeNextFrame(inputFC, codecCtx, videostream, frame);
+    while (found && frameNo < targetFrame)
+    {
+        found = decodeNextFrame(inputFC, codecCtx, videostream, frame);
+        frameNo++;
+    }
+
+    return found;
+}
+
+// Seeks to the keyframe before the given time and decodes up to it
+static bool seekToTime(AVFormatContext *inputFC, AVCodecContext *codecCtx,
+                       int videostream, AVFrame *frame, int seconds)
+{
+    AVStream *st = inputFC->streams[videostream];
+    int64_t target = av_rescale_q((int64_t)seconds * AV_TIME_BASE,
+                                  AV_TIME_BASE_Q, st->time_base);
+    if (st->start_time != (int64_t)AV_NOPTS_VALUE)
+        target += st->start_time;
+
+    if (av_seek_frame(inputFC, videostream, target, AVSEEK_FLAG_BACKWARD) < 0)
+        return false;
+
+    avcodec_flush_buffers(codecCtx);
+
+    bool found = decodeNextFrame(inputFC, codecCtx, videostream, frame);
+    while (found)
+    {
+        int64_t pts = av_frame_get_best_effort_timestamp(frame);
+        if (pts == (int64_t)AV_NOPTS_VALUE || pts >= target)
+            break;
+        found = decodeNextFrame(inputFC, codecCtx, videostream, frame);
+    }
+
+    return found;
+}
+
 static int grabThumbnail(QString inFile, QString thumbList, QString outFile, int frameCount)
 {
     av_register_all();
 
+    QElapsedTimer timer;
+    timer.start();
+
     // Open recording
     LOG(VB_JOBQUEUE, LOG_INFO, QString("grabThumbnail(): Opening '%1'")
             .arg(inFile));
@@ -1626,6 +2024,16 @@ static int grabThumbnail(QString inFile, QString thumbList, QString outFile, int
         return 1;
     }
 
+    // a myth recording's seek table takes us straight to the keyframe
+    // before each thumb, anything else is seeked by time
+    frm_pos_map_t posMap;
+    ProgramInfo *progInfo = getProgramInfoForFile(getBaseName(inFile));
+    if (progInfo)
+    {
+        progInfo->QueryPositionMap(posMap, MARK_GOP_BYFRAME);
+        delete progInfo;
+    }
+
     // get list of required thumbs
     QStringList list = thumbList.split(",", QString::SkipEmptyParts);
     MythAVFrame frame;
@@ -1633,7 +2041,6 @@ static int grabThumbnail(QString inFile, QString thumbList, QString outFile, int
     {
         return 1;
     }
-    AVPacket pkt;
     AVPicture orig;
     AVPicture retbuf;
     memset(&orig, 0, sizeof(AVPicture));
@@ -1644,106 +2051,95 @@ static int grabThumbnail(QString inFile, QString thumbList, QString outFile, int
     int bufflen = width * height * 4;
     unsigned char *outputbuf = new unsigned char[bufflen];
 
-    int frameNo = -1, thumbCount = 0;
-    int frameFinished = 0;
-    int keyFrame;
+    // work out what format to save to
+    QString saveFormat = "JPEG";
+    if (outFile.right(4) == ".png")
+        saveFormat = "PNG";
 
-    while (av_read_frame(inputFC, &pkt) >= 0)
+    // frames decoded so far, only used if the file can't be seeked
+    int64_t frameNo = -1;
+    bool seeked = false;
+
+    for (int thumbCount = 1; thumbCount <= list.count(); thumbCount++)
     {
-        if (pkt.stream_index == videostream)
-        {
-            frameNo++;
-            if (list[thumbCount].toInt() == (int)(frameNo / fps))
-            {
-                thumbCount++;
+        int seconds = list[thumbCount - 1].toInt();
+        int64_t targetFrame = (int64_t) ceil(seconds * fps);
+        bool found = false;
 
-                avcodec_flush_buffers(codecCtx);
-                av_frame_unref(frame);
-                avcodec_decode_video2(codecCtx, frame, &frameFinished, &pkt);
-                keyFrame = frame->key_frame;
+        if (!posMap.empty())
+        {
+            found = seekToFrameByIndex(inputFC, codecCtx, videostream, frame,
+                                       posMap, targetFrame);
+            seeked |= found;
+        }
 
-                while (!frameFinished || !keyFrame)
-                {
-                    av_free_packet(&pkt);
-                    int res = av_read_frame(inputFC, &pkt);
-                    if (res < 0)
-                        break;
-                    if (pkt.stream_index == videostream)
-                    {
-                        frameNo++;
-                        av_frame_unref(frame);
-                        avcodec_decode_video2(codecCtx, frame, &frameFinished, &pkt);
-                        keyFrame = frame->key_frame;
-                    }
-                }
+        if (!found && frameNo < 0)
+        {
+            found = seekToTime(inputFC, codecCtx, videostream, frame, seconds);
+            seeked |= found;
+        }
 
-                if (frameFinished)
-                {
-                    // work out what format to save to
-                    QString saveFormat = "JPEG";
-                    if (outFile.right(4) == ".png")
-                        saveFormat = "PNG";
+        if (!found && !seeked)
+        {
+            // can't seek in this file so just read on to the next thumb
+            found = (frameNo >= targetFrame);
+            while (!found &&
+                   decodeNextFrame(inputFC, codecCtx, videostream, frame))
+            {
+                found = (++frameNo >= targetFrame);
+            }
+        }
 
-                    int count = 0;
-                    while (count < frameCount)
-                    {
-                        QString filename = outFile;
-                        if (filename.contains("%1") && filename.contains("%2"))
-                            filename = filename.arg(thumbCount).arg(count+1);
-                        else if (filename.contains("%1"))
-                            filename = filename.arg(thumbCount);
+        if (!found)
+        {
+            LOG(VB_JOBQUEUE, LOG_ERR,
+                QString("grabThumbnail(): Couldn't find a frame at %1 secs")
+                    .arg(seconds));
+            continue;
+        }
 
-                        avpicture_fill(&retbuf, outputbuf,
-                                       AV_PIX_FMT_RGB32, width, height);
+        int count = 0;
+        while (count < frameCount)
+        {
+            QString filename = outFile;
+            if (filename.contains("%1") && filename.contains("%2"))
+                filename = filename.arg(thumbCount).arg(count+1);
+            else if (filename.contains("%1"))
+                filename = filename.arg(thumbCount);
 
-                        AVFrame *tmp = frame;
-                        deinterlacer.DeinterlaceSingle((AVPicture*)tmp,
-                                                       (AVPicture*)tmp);
+            avpicture_fill(&retbuf, outputbuf,
+                           AV_PIX_FMT_RGB32, width, height);
 
-                        copyframe.Copy(&retbuf, AV_PIX_FMT_RGB32,
-                                       (AVPicture*) tmp,
-                                       codecCtx->pix_fmt, width, height);
+            AVFrame *tmp = frame;
+            deinterlacer.DeinterlaceSingle((AVPicture*)tmp,
+                                           (AVPicture*)tmp);
 
-                        QImage img(outputbuf, width, height,
-                                   QImage::Format_RGB32);
+            copyframe.Copy(&retbuf, AV_PIX_FMT_RGB32,
+                           (AVPicture*) tmp,
+                           codecCtx->pix_fmt, width, height);
 
-                        if (!img.save(filename, qPrintable(saveFormat)))
-                        {
-                            LOG(VB_GENERAL, LOG_ERR,
-                                QString("grabThumbnail(): Failed to save "
-                                        "thumb: '%1'")
-                                    .arg(filename));
-                        }
+            QImage img(outputbuf, width, height,
+                       QImage::Format_RGB32);
 
-                        count++;
+            if (!img.save(filename, qPrintable(saveFormat)))
+            {
+                LOG(VB_GENERAL, LOG_ERR,
+                    QString("grabThumbnail(): Failed to save "
+                            "thumb: '%1'")
+                        .arg(filename));
+            }
 
-                        if (count <= frameCount)
-                        {
-                            //grab next frame
-                            frameFinished = false;
-                            while (!frameFinished)
-                            {
-                                int res = av_read_frame(inputFC, &pkt);
-                                if (res < 0)
-                                    break;
-                                if (pkt.stream_index == videostream)
-                                {
-                                    frameNo++;
-                                    avcodec_decode_video2(codecCtx, frame,
-                                                         &frameFinished,
-                                                         &pkt);
-                                }
-                            }
-                        }
-                    }
-                }
+            count++;
 
-                if (thumbCount >= (int) list.count())
+            //grab next frame
+            if (count < frameCount)
+            {
+                if (!decodeNextFrame(inputFC, codecCtx, videostream, frame))
                     break;
+                if (!seeked)
+                    frameNo++;
             }
         }
-
-        av_free_packet(&pkt);
     }
 
     if (outputbuf)
@@ -1752,9 +2148,83 @@ static int grabThumbnail(QString inFile, QString thumbList, QString outFile, int
     // close the codec
     avcodec_close(codecCtx);
 
+    LOG(VB_JOBQUEUE, LOG_INFO,
+        QString("grabThumbnail(): Grabbed %1 thumbs in %2 ms%3")
+            .arg(list.count()).arg(timer.elapsed())
+            .arg(posMap.empty() ? "" : " using the seek table"));
+
     return 0;
 }
 
+/**
+ *  \brief Counts the video packets between two byte offsets of a file, so
+ *         the packets of a long recording can be counted in parallel.
+ *
+ *  A packet belongs to the range its first byte is in. After seeking into
+ *  the middle of a file the demuxer skips the partial packet it lands in,
+ *  which the range before counts. An end of -1 counts to the end of the file.
+ */
+class PacketCounter : public MThread
+{
+  public:
+    PacketCounter(const QString &filename, int streamID,
+                  int64_t start, int64_t end) :
+        MThread("PacketCounter"), m_filename(filename), m_streamID(streamID),
+        m_start(start), m_end(end), m_count(0), m_ok(false) {}
+
+    int64_t GetCount(void) const { return m_count; }
+    bool    IsOK(void) const { return m_ok; }
+
+  protected:
+    virtual void run(void) // MThread
+    {
+        RunProlog();
+        m_ok = Count();
+        RunEpilog();
+    }
+
+  private:
+    bool Count(void)
+    {
+        RemoteAVFormatContext inputFC(m_filename);
+        if (!inputFC.isOpen() || avformat_find_stream_info(inputFC, NULL) < 0)
+            return false;
+
+        if (m_start > 0 &&
+            av_seek_frame(inputFC, -1, m_start, AVSEEK_FLAG_BYTE) < 0)
+            return false;
+
+        AVPacket pkt;
+        av_init_packet(&pkt);
+
+        while (av_read_frame(inputFC, &pkt) >= 0)
+        {
+            if (m_end >= 0 && pkt.pos >= m_end)
+            {
+                av_free_packet(&pkt);
+                break;
+            }
+
+            // stream numbers depend on the order streams are found in, so
+            // the stream is matched on its id
+            if (pkt.pos >= m_start &&
+                inputFC->streams[pkt.stream_index]->id == m_streamID)
+                m_count++;
+
+            av_free_packet(&pkt);
+        }
+
+        return true;
+    }
+
+    QString m_filename;
+    int     m_streamID;
+    int64_t m_start;
+    int64_t m_end;
+    int64_t m_count;
+    bool    m_ok;
+};
+
 static int64_t getFrameCount(AVFormatContext *inputFC, int vid_id)
 {
     AVPacket pkt;
@@ -1776,6 +2246,65 @@ static int64_t getFrameCount(AVFormatContext *inputFC, int vid_id)
     return count;
 }
 
+/// Counts the frames of an MPEG file by scanning parts of it in parallel,
+/// returns -1 if the file can't be split up
+static int64_t getFrameCountParallel(const QString &filename,
+                                     AVFormatContext *inputFC, int vid_id)
+{
+    // only the MPEG demuxers find their way back into the stream after
+    // a byte seek and tell us where each packet started
+    QString format = inputFC->iformat->name;
+    if ((format != "mpegts" && format != "mpeg") ||
+        (inputFC->iformat->flags & AVFMT_NO_BYTE_SEEK) || !inputFC->pb)
+        return -1;
+
+    int64_t size = avio_size(inputFC->pb);
+    int threads = qMin(QThread::idealThreadCount(), 8);
+
+    // not worth it for short files
+    if (threads < 2 || size < 256 * 1024 * 1024)
+        return -1;
+
+    LOG(VB_JOBQUEUE, LOG_INFO,
+        QString("Calculating frame count using %1 threads").arg(threads));
+
+    QList<PacketCounter*> counters;
+    for (int x = 0; x < threads; x++)
+    {
+        PacketCounter *counter = new PacketCounter(
+            filename, inputFC->streams[vid_id]->id, size * x / threads,
+            (x == threads - 1) ? -1 : size * (x + 1) / threads);
+        counters.append(counter);
+        counter->start();
+    }
+
+    int64_t count = 0;
+    bool ok = true;
+    for (int x = 0; x < counters.size(); x++)
+    {
+        counters[x]->wait();
+        count += counters[x]->GetCount();
+        ok &= counters[x]->IsOK();
+        delete counters[x];
+    }
+
+    return ok ? count : -1;
+}
+
+// Gets the frame count of a myth recording, as the recorder left it in
+// the database, returns 0 if it isn't a myth recording or there is none
+static int64_t getTotalFrames(const QString &filename)
+{
+    ProgramInfo *progInfo = getProgramInfoForFile(getBaseName(filename));
+    if (!progInfo)
+        return 0;
+
+    int64_t frames = progInfo->QueryTotalFrames();
+    delete progInfo;
+
+    return frames;
+}
+
 static int64_t getCutFrames(const QString &filename, int64_t lastFrame)
 {
     // only wont the filename
@@ -1856,6 +2385,14 @@ static int64_t getFrameCount(const QString &filename, float fps)
     if (!progInfo)
         return 0;
 
+    // the recorder saves how many frames it wrote
+    int64_t totalFrames = progInfo->QueryTotalFrames();
+    if (totalFrames > 0)
+    {
+        delete progInfo;
+        return totalFrames;
+    }
+
     progInfo->QueryPositionMap(posMap, MARK_GOP_BYFRAME);
     if (!posMap.empty())
     {
@@ -1895,6 +2432,9 @@ static int getFileInfo(QString inFile, QString outFile, int lenMethod)
 {
     av_register_all();
 
+    QElapsedTimer timer;
+    timer.start();
+
     // Open recording
     LOG(VB_JOBQUEUE , LOG_INFO, QString("getFileInfo(): Opening '%1'")
             .arg(inFile));
@@ -2014,8 +2554,13 @@ static int getFileInfo(QString inFile, QString outFile, int lenMethod)
                         }
                         case 1:
                         {
-                            // calc duration of the file by counting the video frames
-                            frameCount = getFrameCount(inputFC, i);
+                            // calc duration of the file by counting the video
+                            // frames, unless the recorder already counted them
+                            frameCount = getTotalFrames(inFile);
+                            if (frameCount <= 0)
+                                frameCount = getFrameCountParallel(inFile, inputFC, i);
+                            if (frameCount < 0)
+                                frameCount = getFrameCount(inputFC, i);
                             LOG(VB_JOBQUEUE, LOG_INFO,
                                 QString("frames = %1").arg(frameCount));
                             duration = (uint)(frameCount / fps);
@@ -2171,6 +2716,9 @@ static int getFileInfo(QString inFile, QString outFile, int lenMethod)
     t << doc.toString(4);
     f.close();
 
+    LOG(VB_JOBQUEUE, LOG_INFO, QString("getFileInfo(): Took %1 ms")
+            .arg(timer.elapsed()));
+
     return 0;
 }
 
@@ -10,7 +10,7 @@ using namespace std;
 #include "dbcheck.h"
 #include "gamesettings.h"
 
-const QString currentDatabaseVersion = "1018";
+const QString currentDatabaseVersion = "1019";
 
 static bool UpdateDBVersionNumber(const QString &newnumber)
 {
@@ -437,5 +437,24 @@ QString("ALTER DATABASE %1 DEFAULT CHARACTER SET utf8 COLLATE utf8_general_ci;")
             return false;
     }
 
+    if (dbver == "1018")
+    {
+        const QString updates[] = {
+
+"CREATE TABLE gamecrccache ("
+"  filepath varchar(255) NOT NULL default '',"
+"  gametype varchar(64) NOT NULL default '',"
+"  filesize bigint(20) NOT NULL default '0',"
+"  mtime int(10) unsigned NOT NULL default '0',"
+"  crcs text NOT NULL,"
+"  KEY filepath (filepath)"
+");",
+""
+};
+
+        if (!performActualUpdate(updates, "1019", dbver))
+            return false;
+    }
+
     return true;
 }
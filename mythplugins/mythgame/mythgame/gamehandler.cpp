@@ -2,7 +2,11 @@
 #include "gamehandler.h"
 #include "rominfo.h"
 #include "rom_metadata.h"
+#include "romscanner.h"
 
+#include <unistd.h> // for usleep()
+
+#include <QCoreApplication>
 #include <QRegExp>
 #include <QDir>
 #include <QList>
@@ -20,6 +24,9 @@
 #define LOC_ERR QString("MythGame:GAMEHANDLER Error: ")
 #define LOC QString("MythGame:GAMEHANDLER: ")
 
+/// Number of ROMs inserted into gamemetadata per query
+static const int kInsertBatchSize = 100;
+
 static QList<GameHandler*> *handlers = NULL;
 
 static void checkHandlers(void)
@@ -141,7 +148,10 @@ void GameHandler::GetMetadata(GameHandler *handler, QString rom, QString* Genre,
     QString key;
     QString tmpcrc;
 
-    *CRC32 = crcinfo(rom, handler->GameType(), &key, &romDB);
+    if (m_crcScanner)
+        *CRC32 = crcinfo(m_crcScanner->keys(rom), &key, &romDB);
+    else
+        *CRC32 = crcinfo(rom, handler->GameType(), &key, &romDB);
 
 #if 0
     LOG(VB_GENERAL, LOG_DEBUG, "Key = " + key);
@@ -373,10 +383,31 @@ static void UpdateGameCounts(QStringList updatelist)
     }
 }
 
+/// Inserts the rows queued by UpdateGameDB() in one query
+static void insertGameMetadata(QStringList &rows, MSqlBindings &bindings)
+{
+    if (rows.isEmpty())
+        return;
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("INSERT INTO gamemetadata "
+                  "(system, romname, gamename, genre, year, gametype, "
+                  "rompath, country, crc_value, diskcount, display, plot, "
+                  "publisher, version, fanart, boxart, screenshot) "
+                  "VALUES " + rows.join(", "));
+    query.bindValues(bindings);
+
+    if (!query.exec())
+        MythDB::DBError("GameHandler::UpdateGameDB - "
+                        "insert gamemetadata", query);
+
+    rows.clear();
+    bindings.clear();
+}
+
 void GameHandler::UpdateGameDB(GameHandler *handler)
 {
     int counter = 0;
-    MSqlQuery query(MSqlQuery::InitCon());
 
     //: %1 is the system name, %2 is the game type
     QString message = tr("Updating %1 (%2) ROM database")
@@ -398,6 +429,37 @@ void GameHandler::UpdateGameDB(GameHandler *handler)
     int indepth = gCoreContext->GetSetting("GameDeepScan").toInt();
     QString screenShotPath = gCoreContext->GetSetting("mythgame.screenshotdir");
 
+    QStringList rows;
+    MSqlBindings bindings;
+
+    // Work out the CRCs of all the new ROMs at once, rather than reading
+    // them one after another as they are inserted
+    RomCRCScanner crcScanner(handler->GameType());
+    if (indepth)
+    {
+        for (iter = m_GameMap.begin(); iter != m_GameMap.end(); ++iter)
+        {
+            if (iter.value().FoundLoc() == inFileSystem)
+                crcScanner.addFile(iter.value().RomFullPath());
+        }
+
+        crcScanner.start();
+        while (!crcScanner.isFinished())
+        {
+            if (m_progressDlg)
+                m_progressDlg->SetProgress(crcScanner.filesDone());
+            qApp->processEvents();
+            usleep(50000);
+        }
+        crcScanner.finish();
+
+        counter = crcScanner.filesDone();
+        if (m_progressDlg)
+            m_progressDlg->SetTotal(m_GameMap.size() + counter);
+
+        m_crcScanner = &crcScanner;
+    }
+
     for (iter = m_GameMap.begin(); iter != m_GameMap.end(); ++iter)
     {
 
@@ -450,33 +512,31 @@ void GameHandler::UpdateGameDB(GameHandler *handler)
             LOG(VB_GENERAL, LOG_INFO, QString("screenshot %1").arg(ScreenShot));
 #endif
 
-            query.prepare("INSERT INTO gamemetadata "
-                          "(system, romname, gamename, genre, year, gametype, "
-                          "rompath, country, crc_value, diskcount, display, plot, "
-                          "publisher, version, fanart, boxart, screenshot) "
-                          "VALUES (:SYSTEM, :ROMNAME, :GAMENAME, :GENRE, :YEAR, "
-                          ":GAMETYPE, :ROMPATH, :COUNTRY, :CRC32, '1', '1', :PLOT, :PUBLISHER, :VERSION, "
-                          ":FANART, :BOXART, :SCREENSHOT)");
-
-            query.bindValue(":SYSTEM",handler->SystemName());
-            query.bindValue(":ROMNAME",iter.value().Rom());
-            query.bindValue(":GAMENAME",GameName);
-            query.bindValue(":GENRE",Genre);
-            query.bindValue(":YEAR",Year);
-            query.bindValue(":GAMETYPE",handler->GameType());
-            query.bindValue(":ROMPATH",iter.value().RomPath());
-            query.bindValue(":COUNTRY",Country);
-            query.bindValue(":CRC32", CRC32);
-            query.bindValue(":PLOT", Plot);
-            query.bindValue(":PUBLISHER", Publisher);
-            query.bindValue(":VERSION", Version);
-            query.bindValue(":FANART", Fanart);
-            query.bindValue(":BOXART", Boxart);
-            query.bindValue(":SCREENSHOT", ScreenShot);
-
-            if (!query.exec())
-                MythDB::DBError("GameHandler::UpdateGameDB - "
-                                "insert gamemetadata", query);
+            QString n = QString::number(rows.size());
+            rows.append(QString("(:SYSTEM, :ROMNAME%1, :GAMENAME%1, "
+                                ":GENRE%1, :YEAR%1, :GAMETYPE, :ROMPATH%1, "
+                                ":COUNTRY%1, :CRC32%1, '1', '1', :PLOT%1, "
+                                ":PUBLISHER%1, :VERSION%1, :FANART%1, "
+                                ":BOXART%1, :SCREENSHOT%1)").arg(n));
+
+            bindings.insert(":SYSTEM",handler->SystemName());
+            bindings.insert(":ROMNAME" + n,iter.value().Rom());
+            bindings.insert(":GAMENAME" + n,GameName);
+            bindings.insert(":GENRE" + n,Genre);
+            bindings.insert(":YEAR" + n,Year);
+            bindings.insert(":GAMETYPE",handler->GameType());
+            bindings.insert(":ROMPATH" + n,iter.value().RomPath());
+            bindings.insert(":COUNTRY" + n,Country);
+            bindings.insert(":CRC32" + n, CRC32);
+            bindings.insert(":PLOT" + n, Plot);
+            bindings.insert(":PUBLISHER" + n, Publisher);
+            bindings.insert(":VERSION" + n, Version);
+            bindings.insert(":FANART" + n, Fanart);
+            bindings.insert(":BOXART" + n, Boxart);
+            bindings.insert(":SCREENSHOT" + n, ScreenShot);
+
+            if (rows.size() >= kInsertBatchSize)
+                insertGameMetadata(rows, bindings);
         }
         else if ((iter.value().FoundLoc() == inDatabase) && (removalprompt))
         {
@@ -488,6 +548,9 @@ void GameHandler::UpdateGameDB(GameHandler *handler)
             m_progressDlg->SetProgress(++counter);
     }
 
+    insertGameMetadata(rows, bindings);
+    m_crcScanner = NULL;
+
     if (m_progressDlg)
     {
         m_progressDlg->Close();
@@ -550,56 +613,6 @@ void GameHandler::VerifyGameDB(GameHandler *handler)
     }
 }
 
-// Recurse through the directory and gather a count on how many files there are to process.
-// This is used for the progressbar info.
-int GameHandler::buildFileCount(QString directory, GameHandler *handler)
-{
-    int filecount = 0;
-    QDir RomDir(directory);
-
-    // If we can't read it's contents move on
-    if (!RomDir.isReadable())
-        return 0;
-
-    RomDir.setFilter(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
-    QFileInfoList List = RomDir.entryInfoList();
-    for (QFileInfoList::const_iterator it = List.begin();
-         it != List.end(); ++it)
-    {
-        QFileInfo Info = *it;
-        QString RomName = Info.fileName();
-
-        if (Info.isDir())
-        {
-            filecount += buildFileCount(Info.filePath(), handler);
-            continue;
-        }
-        else
-        {
-            if (handler->validextensions.count() > 0)
-            {
-                QRegExp r;
-
-                r.setPattern("^" + Info.suffix() + "$");
-                r.setCaseSensitivity(Qt::CaseInsensitive);
-                QStringList result;
-                for (int x = 0; x < handler->validextensions.size(); x++)
-                {
-                    QString extension = handler->validextensions.at(x);
-                    if (extension.contains(r))
-                        result.append(extension);
-                }
-                if (result.isEmpty())
-                    continue;
-            }
-
-            filecount++;
-        }
-    }
-
-    return filecount;
-}
-
 void GameHandler::clearAllGameData(void)
 {
     MythScreenStack *popupStack = GetMythMainWindow()->GetStack("popup stack");
@@ -618,62 +631,26 @@ void GameHandler::clearAllGameData(void)
         delete clearPopup;
 }
 
-void GameHandler::buildFileList(QString directory, GameHandler *handler,
-                                int* filecount)
+void GameHandler::buildFileList(const QFileInfoList &roms,
+                                GameHandler *handler)
 {
-    QDir RomDir(directory);
-
-    // If we can't read its contents move on
-    if (!RomDir.isReadable())
-        return;
+    int filecount = 0;
 
-    RomDir.setSorting( QDir:: DirsFirst | QDir::Name );
-    RomDir.setFilter(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
-    QFileInfoList List = RomDir.entryInfoList();
-    for (QFileInfoList::const_iterator it = List.begin();
-         it != List.end(); ++it)
+    for (QFileInfoList::const_iterator it = roms.begin();
+         it != roms.end(); ++it)
     {
         QFileInfo Info = *it;
         QString RomName = Info.fileName();
         QString GameName = Info.completeBaseName();
 
-        if (Info.isDir())
-        {
-            buildFileList(Info.filePath(), handler, filecount);
-            continue;
-        }
-        else
-        {
-
-            if (handler->validextensions.count() > 0)
-            {
-                QRegExp r;
+        m_GameMap[RomName] = GameScan(RomName,Info.filePath(),inFileSystem,
+                             GameName, Info.absoluteDir().path());
 
-                r.setPattern("^" + Info.suffix() + "$");
-                r.setCaseSensitivity(Qt::CaseInsensitive);
-                QStringList result;
-                for (int x = 0; x < handler->validextensions.size(); x++)
-                {
-                    QString extension = handler->validextensions.at(x);
-                    if (extension.contains(r))
-                        result.append(extension);
-                }
-
-                if (result.isEmpty())
-                    continue;
-            }
+        LOG(VB_GENERAL, LOG_INFO, LOC + QString("Found ROM : (%1) - %2")
+                .arg(handler->SystemName()).arg(RomName));
 
-            m_GameMap[RomName] = GameScan(RomName,Info.filePath(),inFileSystem,
-                                 GameName, Info.absoluteDir().path());
-
-            LOG(VB_GENERAL, LOG_INFO, LOC + QString("Found ROM : (%1) - %2")
-                    .arg(handler->SystemName()).arg(RomName));
-
-            *filecount = *filecount + 1;
-            if (m_progressDlg)
-                m_progressDlg->SetProgress(*filecount);
-
-        }
+        if (m_progressDlg)
+            m_progressDlg->SetProgress(++filecount);
     }
 }
 
@@ -681,13 +658,18 @@ void GameHandler::processGames(GameHandler *handler)
 {
     QString thequery;
     int maxcount = 0;
+    QFileInfoList roms;
     MSqlQuery query(MSqlQuery::InitCon());
 
     if ((!handler->SystemRomPath().isEmpty()) && (handler->GameType() != "PC"))
     {
         QDir d(handler->SystemRomPath());
         if (d.exists())
-            maxcount = buildFileCount(handler->SystemRomPath(),handler);
+        {
+            RomDirWalker walker(handler->ValidExtensions());
+            roms = walker.walk(handler->SystemRomPath());
+            maxcount = roms.size();
+        }
         else
         {
             LOG(VB_GENERAL, LOG_ERR, LOC +
@@ -739,8 +721,7 @@ void GameHandler::processGames(GameHandler *handler)
         if (m_progressDlg)
             m_progressDlg->SetTotal(maxcount);
 
-        int filecount = 0;
-        buildFileList(handler->SystemRomPath(), handler, &filecount);
+        buildFileList(roms, handler);
 
         if (m_progressDlg)
         {
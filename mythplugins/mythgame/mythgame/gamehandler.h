@@ -2,6 +2,7 @@
 #ifndef GAMEHANDLER_H_
 #define GAMEHANDLER_H_
 
+#include <QFileInfoList>
 #include <QStringList>
 #include <QMap>
 #include <QObject>
@@ -14,6 +15,7 @@
 
 class MythMainWindow;
 class GameHandler;
+class RomCRCScanner;
 
 enum GameFound
 {
@@ -64,7 +66,7 @@ class GameHandler : public QObject
         screenshots(QString::null), gameplayerid(0),
         gametype(QString::null),
         m_RemoveAll(false),         m_KeepAll(false),
-        m_progressDlg(NULL) {}
+        m_crcScanner(NULL),         m_progressDlg(NULL) {}
 
     static void updateSettings(GameHandler*);
     static GameHandler *getHandler(uint i);
@@ -83,9 +85,7 @@ class GameHandler : public QObject
 
     void clearAllGameData(void);
 
-    static int buildFileCount(QString directory, GameHandler *handler);
-    void buildFileList(QString directory, GameHandler *handler,
-                       int* filecount);
+    void buildFileList(const QFileInfoList &roms, GameHandler *handler);
 
     void processGames(GameHandler *);
     static void processAllGames(void);
@@ -134,6 +134,9 @@ class GameHandler : public QObject
     bool m_RemoveAll;
     bool m_KeepAll;
 
+    /// CRCs worked out ahead of UpdateGameDB() inserting the ROMs
+    RomCRCScanner *m_crcScanner;
+
   private:
     void CreateProgress(QString message);
     static GameHandler *newInstance;
@@ -21,11 +21,12 @@ INSTALLS += target installscripts installgiantbomb installgiantbombxsl
 # Input
 HEADERS += gamehandler.h rominfo.h gamesettings.h gameui.h
 HEADERS += rom_metadata.h romedit.h gamedetails.h gamescan.h external/unzip.h
-HEADERS += external/ioapi.h
+HEADERS += external/ioapi.h romscanner.h
 
 SOURCES += main.cpp gamehandler.cpp rominfo.cpp gameui.cpp
 SOURCES += gamesettings.cpp dbcheck.cpp rom_metadata.cpp romedit.cpp
 SOURCES += gamedetails.cpp gamescan.cpp external/unzip.c external/ioapi.c
+SOURCES += romscanner.cpp
 
 DEFINES += MPLUGIN_API NOUNCRYPT
 
@@ -46,24 +46,27 @@ static QString crcStr(uLong crc)
     return tmpcrc;
 }
 
-// Return the crc32 info for this rom. (ripped mostly from the old neshandler.cpp source)
-QString crcinfo(QString romname, QString GameType, QString *key, RomDBMap *romDB)
+/** \brief The CRC32 of each ROM image in a file.
+ *
+ *  A plain file has one, keyed "crc:". A zip has one per member, keyed
+ *  "crc:member" as romDB is. Each member's CRC carries on from the one
+ *  before, as it always has. The file is read in large blocks so that
+ *  several of these can run at once without the disks seeking between
+ *  small reads.
+ */
+QStringList romCRCKeys(const QString &romname, const QString &GameType,
+                       qint64 *bytesRead)
 {
-    // Get CRC of file
-    char block[32768] = "";
+    const int blocksize = 1024 * 1024;
+    QByteArray buffer(blocksize, 0);
+    char *block = buffer.data();
     uLong crc = crc32(0, Z_NULL, 0);
-    QString crcRes;
+    QStringList keys;
     char filename_inzip[256];
     unz_file_info file_info;
     int offset;
     unzFile zf;
-    int blocksize;
-
-    blocksize = 8192;
-#if 0
-    LOG(VB_GENERAL, LOG_DEBUG,
-        QString("crcinfo : %1 : %2 :").arg(romname).arg(GameType));
-#endif
+    qint64 total = 0;
 
     if ((zf = unzOpen(qPrintable(romname))))
     {
@@ -85,17 +88,11 @@ QString crcinfo(QString romname, QString GameType, QString *key, RomDBMap *romDB
                 while ((count = unzReadCurrentFile(zf, block, blocksize)) > 0)
                 {
                     crc = crc32(crc, (Bytef *)block, (uInt)count);
+                    total += count;
                 }
-                crcRes = crcStr(crc);
-                *key = QString("%1:%2")
-                             .arg(crcRes)
-                             .arg(filename_inzip);
-
-                if (romDB->contains(*key))
-                {
-                    unzCloseCurrentFile(zf);
-                    break;
-                }
+                keys.append(QString("%1:%2")
+                                .arg(crcStr(crc))
+                                .arg(filename_inzip));
 
                 unzCloseCurrentFile(zf);
             }
@@ -118,14 +115,44 @@ QString crcinfo(QString romname, QString GameType, QString *key, RomDBMap *romDB
             while ((count = f.read(block, blocksize)) > 0)
             {
                 crc = crc32(crc, (Bytef *)block, (uInt)count);
+                total += count;
             }
 
-            crcRes = crcStr(crc);
-            *key = QString("%1:").arg(crcRes);
+            keys.append(QString("%1:").arg(crcStr(crc)));
             f.close();
         }
     }
 
-    return crcRes;
+    if (bytesRead)
+        *bytesRead = total;
+
+    return keys;
 }
 
+/// Picks the first key romDB knows, or the last key if it knows none,
+/// and returns its CRC
+QString crcinfo(const QStringList &keys, QString *key, const RomDBMap *romDB)
+{
+    if (keys.isEmpty())
+        return QString("");
+
+    for (int x = 0; x < keys.size(); x++)
+    {
+        *key = keys.at(x);
+        if (romDB->contains(*key))
+            break;
+    }
+
+    return key->section(':', 0, 0);
+}
+
+// Return the crc32 info for this rom. (ripped mostly from the old neshandler.cpp source)
+QString crcinfo(QString romname, QString GameType, QString *key, RomDBMap *romDB)
+{
+#if 0
+    LOG(VB_GENERAL, LOG_DEBUG,
+        QString("crcinfo : %1 : %2 :").arg(romname).arg(GameType));
+#endif
+
+    return crcinfo(romCRCKeys(romname, GameType), key, romDB);
+}
@@ -2,6 +2,7 @@
 #define ROMMETADATA_H_
 
 #include <QString>
+#include <QStringList>
 #include <QMap>
 
 class RomData
@@ -46,6 +47,9 @@ typedef QMap <QString, RomData> RomDBMap;
 
 QString crcStr(int crc);
 
+QStringList romCRCKeys(const QString &romname, const QString &GameType,
+                       qint64 *bytesRead = NULL);
+QString crcinfo(const QStringList &keys, QString *key, const RomDBMap *romDB);
 QString crcinfo(QString romname, QString GameType, QString *key, RomDBMap *romDB);
 
 #endif
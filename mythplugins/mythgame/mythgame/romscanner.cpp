@@ -0,0 +1,433 @@
+#include <QDateTime>
+#include <QThread>
+#include <QFile>
+#include <QDir>
+
+#include <mythcontext.h>
+#include <mythdbcon.h>
+#include <mythdb.h>
+#include <mythlogging.h>
+#include <mthread.h>
+
+#include "romscanner.h"
+#include "rom_metadata.h"
+
+#define LOC QString("MythGame:ROMSCANNER: ")
+
+/// Number of rows written to gamecrccache per query
+static const int kCacheBatchSize = 100;
+
+static int scanThreadCount(int jobs)
+{
+    return qMin(qBound(1, QThread::idealThreadCount(), 8), qMax(jobs, 1));
+}
+
+class RomWalkThread : public MThread
+{
+  public:
+    explicit RomWalkThread(RomDirWalker *parent) :
+        MThread("RomWalk"), m_parent(parent) {}
+
+  protected:
+    virtual void run(void) // MThread
+    {
+        RunProlog();
+        m_parent->work();
+        RunEpilog();
+    }
+
+  private:
+    RomDirWalker *m_parent;
+};
+
+class RomCRCThread : public MThread
+{
+  public:
+    explicit RomCRCThread(RomCRCScanner *parent) :
+        MThread("RomCRC"), m_parent(parent) {}
+
+  protected:
+    virtual void run(void) // MThread
+    {
+        RunProlog();
+        RomCRCFile *file;
+        while ((file = m_parent->nextFile()))
+        {
+            m_parent->scanFile(file);
+            m_parent->fileDone();
+        }
+        RunEpilog();
+    }
+
+  private:
+    RomCRCScanner *m_parent;
+};
+
+/**
+ * \brief Returns every ROM under \p directory
+ *
+ * They are in the order a serial walk would find them: in each directory
+ * the ROMs of its subdirectories, by name, and then its own, by name.
+ * Where two directories hold ROMs of the same name the last one found is
+ * the one that is kept.
+ */
+QFileInfoList RomDirWalker::walk(const QString &directory)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_queue.clear();
+    m_queue.append(directory);
+    m_subdirs.clear();
+    m_roms.clear();
+    m_dirCount = 0;
+
+    QList<RomWalkThread*> walkers;
+    for (int x = scanThreadCount(8); x > 0; x--)
+    {
+        RomWalkThread *walker = new RomWalkThread(this);
+        walkers.append(walker);
+        walker->start();
+    }
+
+    for (int x = 0; x < walkers.size(); x++)
+    {
+        walkers[x]->wait();
+        delete walkers[x];
+    }
+
+    QFileInfoList found;
+    collect(directory, found);
+    m_subdirs.clear();
+    m_roms.clear();
+
+    double secs = qMax(timer.elapsed(), (qint64)1) / 1000.0;
+    LOG(VB_GENERAL, LOG_INFO, LOC +
+        QString("Found %1 ROMs in %2 directories under %3 in %4 secs "
+                "(%5 files/s)")
+            .arg(found.size()).arg(m_dirCount).arg(directory)
+            .arg(secs, 0, 'f', 1).arg(found.size() / secs, 0, 'f', 0));
+
+    return found;
+}
+
+/// Appends the ROMs under \p directory to \p found, in walk() order
+void RomDirWalker::collect(const QString &directory, QFileInfoList &found) const
+{
+    QStringList dirs = m_subdirs.value(directory);
+    for (QStringList::const_iterator it = dirs.begin(); it != dirs.end(); ++it)
+        collect(*it, found);
+
+    found += m_roms.value(directory);
+}
+
+bool RomDirWalker::isRom(const QFileInfo &info) const
+{
+    if (m_extensions.isEmpty())
+        return true;
+
+    return m_extensions.contains(info.suffix(), Qt::CaseInsensitive);
+}
+
+/// Lists directories from the queue until there are none left and no
+/// other thread is listing one that might add more
+void RomDirWalker::work(void)
+{
+    QMutexLocker locker(&m_lock);
+
+    while (true)
+    {
+        while (m_queue.isEmpty() && m_busy > 0)
+            m_wait.wait(&m_lock);
+
+        if (m_queue.isEmpty())
+        {
+            m_wait.wakeAll();
+            return;
+        }
+
+        QString directory = m_queue.takeFirst();
+        m_busy++;
+        locker.unlock();
+
+        QStringList dirs;
+        QFileInfoList roms;
+        QDir RomDir(directory);
+
+        // If we can't read its contents move on
+        if (RomDir.isReadable())
+        {
+            RomDir.setSorting(QDir::DirsFirst | QDir::Name);
+            RomDir.setFilter(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+            QFileInfoList List = RomDir.entryInfoList();
+            for (QFileInfoList::const_iterator it = List.begin();
+                 it != List.end(); ++it)
+            {
+                if (it->isDir())
+                    dirs.append(it->filePath());
+                else if (isRom(*it))
+                    roms.append(*it);
+            }
+        }
+
+        locker.relock();
+        m_queue += dirs;
+        m_subdirs.insert(directory, dirs);
+        m_roms.insert(directory, roms);
+        m_dirCount++;
+        m_busy--;
+        m_wait.wakeAll();
+    }
+}
+
+RomCRCScanner::~RomCRCScanner()
+{
+    finish();
+    qDeleteAll(m_files);
+}
+
+void RomCRCScanner::addFile(const QString &path)
+{
+    if (m_byPath.contains(path))
+        return;
+
+    RomCRCFile *file = new RomCRCFile(path);
+    m_files.append(file);
+    m_byPath.insert(path, file);
+}
+
+void RomCRCScanner::start(void)
+{
+    loadCache();
+
+    m_timer.start();
+
+    for (int x = scanThreadCount(m_files.size() - m_next); x > 0; x--)
+    {
+        RomCRCThread *scanner = new RomCRCThread(this);
+        m_threads.append(scanner);
+        scanner->start();
+    }
+}
+
+bool RomCRCScanner::isFinished(void)
+{
+    QMutexLocker locker(&m_lock);
+    return m_done >= m_files.size();
+}
+
+int RomCRCScanner::filesDone(void)
+{
+    QMutexLocker locker(&m_lock);
+    return m_done;
+}
+
+/// Waits for the threads, then logs the throughput and updates the cache
+void RomCRCScanner::finish(void)
+{
+    if (m_threads.isEmpty())
+        return;
+
+    for (int x = 0; x < m_threads.size(); x++)
+    {
+        m_threads[x]->wait();
+        delete m_threads[x];
+    }
+
+    int threads = m_threads.size();
+    m_threads.clear();
+
+    int cached = 0;
+    qint64 bytes = 0;
+    for (int x = 0; x < m_files.size(); x++)
+    {
+        if (m_files[x]->cached)
+            cached++;
+        bytes += m_files[x]->bytesRead;
+    }
+
+    double secs = qMax(m_timer.elapsed(), (qint64)1) / 1000.0;
+    LOG(VB_GENERAL, LOG_INFO, LOC +
+        QString("Checked %1 %2 ROMs (%3 cached), read %4 MB in %5 secs "
+                "(%6 MB/s, %7 files/s) using %8 threads")
+            .arg(m_files.size()).arg(m_gametype).arg(cached)
+            .arg(bytes / (1024 * 1024)).arg(secs, 0, 'f', 1)
+            .arg(bytes / (1024.0 * 1024.0) / secs, 0, 'f', 1)
+            .arg(m_files.size() / secs, 0, 'f', 0).arg(threads));
+
+    saveCache();
+    pruneCache();
+}
+
+/// The CRC keys of a file added to the scanner, once it has finished
+QStringList RomCRCScanner::keys(const QString &path) const
+{
+    RomCRCFile *file = m_byPath.value(path);
+    return file ? file->keys : QStringList();
+}
+
+RomCRCFile *RomCRCScanner::nextFile(void)
+{
+    QMutexLocker locker(&m_lock);
+    if (m_next >= m_files.size())
+        return NULL;
+    return m_files[m_next++];
+}
+
+void RomCRCScanner::scanFile(RomCRCFile *file) const
+{
+    QFileInfo info(file->path);
+    file->size = info.size();
+    file->mtime = info.lastModified().toTime_t();
+
+    // m_cache isn't changed while the threads are running
+    QHash<QString, RomCRCFile>::const_iterator it =
+        m_cache.constFind(file->path);
+    if (it != m_cache.constEnd() && it->size == file->size &&
+        it->mtime == file->mtime && !it->keys.isEmpty())
+    {
+        file->keys = it->keys;
+        file->cached = true;
+        return;
+    }
+
+    file->keys = romCRCKeys(file->path, m_gametype, &file->bytesRead);
+}
+
+void RomCRCScanner::fileDone(void)
+{
+    QMutexLocker locker(&m_lock);
+    m_done++;
+}
+
+void RomCRCScanner::loadCache(void)
+{
+    m_cache.clear();
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("SELECT filepath, filesize, mtime, crcs FROM gamecrccache "
+                  "WHERE gametype = :GAMETYPE");
+    query.bindValue(":GAMETYPE", m_gametype);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("RomCRCScanner::loadCache", query);
+        return;
+    }
+
+    while (query.next())
+    {
+        RomCRCFile file(query.value(0).toString());
+        file.size = query.value(1).toLongLong();
+        file.mtime = query.value(2).toUInt();
+        file.keys = query.value(3).toString().split('\n',
+                                                    QString::SkipEmptyParts);
+        m_cache.insert(file.path, file);
+    }
+}
+
+void RomCRCScanner::saveCache(void)
+{
+    QList<RomCRCFile*> changed;
+    for (int x = 0; x < m_files.size(); x++)
+    {
+        RomCRCFile *file = m_files[x];
+
+        // paths too long for the column would never be found again
+        if (!file->cached && !file->keys.isEmpty() && file->path.length() <= 255)
+            changed.append(file);
+    }
+
+    MSqlQuery query(MSqlQuery::InitCon());
+
+    for (int first = 0; first < changed.size(); first += kCacheBatchSize)
+    {
+        int last = qMin(first + kCacheBatchSize, changed.size());
+        QStringList paths, rows;
+        MSqlBindings deleteBindings, insertBindings;
+
+        deleteBindings.insert(":GAMETYPE", m_gametype);
+
+        for (int x = first; x < last; x++)
+        {
+            RomCRCFile *file = changed[x];
+            QString n = QString::number(x - first);
+
+            paths.append(":PATH" + n);
+            deleteBindings.insert(":PATH" + n, file->path);
+
+            rows.append(QString("(:PATH%1, :GAMETYPE, :SIZE%1, :MTIME%1, "
+                                ":CRCS%1)").arg(n));
+            insertBindings.insert(":PATH" + n, file->path);
+            insertBindings.insert(":SIZE" + n, file->size);
+            insertBindings.insert(":MTIME" + n, file->mtime);
+            insertBindings.insert(":CRCS" + n, file->keys.join("\n"));
+        }
+        insertBindings.insert(":GAMETYPE", m_gametype);
+
+        query.prepare("DELETE FROM gamecrccache WHERE gametype = :GAMETYPE "
+                      "AND filepath IN (" + paths.join(", ") + ")");
+        query.bindValues(deleteBindings);
+        if (!query.exec())
+        {
+            MythDB::DBError("RomCRCScanner::saveCache - delete", query);
+            return;
+        }
+
+        query.prepare("INSERT INTO gamecrccache "
+                      "(filepath, gametype, filesize, mtime, crcs) VALUES " +
+                      rows.join(", "));
+        query.bindValues(insertBindings);
+        if (!query.exec())
+        {
+            MythDB::DBError("RomCRCScanner::saveCache - insert", query);
+            return;
+        }
+    }
+}
+
+/// Removes the cache entries of files that no longer exist
+void RomCRCScanner::pruneCache(void)
+{
+    QStringList gone;
+    QHash<QString, RomCRCFile>::const_iterator it = m_cache.constBegin();
+    for (; it != m_cache.constEnd(); ++it)
+    {
+        if (!m_byPath.contains(it.key()) && !QFile::exists(it.key()))
+            gone.append(it.key());
+    }
+
+    MSqlQuery query(MSqlQuery::InitCon());
+
+    for (int first = 0; first < gone.size(); first += kCacheBatchSize)
+    {
+        int last = qMin(first + kCacheBatchSize, gone.size());
+        QStringList paths;
+        MSqlBindings bindings;
+
+        bindings.insert(":GAMETYPE", m_gametype);
+
+        for (int x = first; x < last; x++)
+        {
+            QString n = QString::number(x - first);
+            paths.append(":PATH" + n);
+            bindings.insert(":PATH" + n, gone[x]);
+        }
+
+        query.prepare("DELETE FROM gamecrccache WHERE gametype = :GAMETYPE "
+                      "AND filepath IN (" + paths.join(", ") + ")");
+        query.bindValues(bindings);
+        if (!query.exec())
+        {
+            MythDB::DBError("RomCRCScanner::pruneCache", query);
+            return;
+        }
+    }
+
+    if (!gone.isEmpty())
+    {
+        LOG(VB_GENERAL, LOG_INFO, LOC +
+            QString("Removed %1 deleted %2 ROMs from the CRC cache")
+                .arg(gone.size()).arg(m_gametype));
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef ROMSCANNER_H_
+#define ROMSCANNER_H_
+
+#include <QElapsedTimer>
+#include <QFileInfoList>
+#include <QStringList>
+#include <QWaitCondition>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+
+class MThread;
+
+/** \class RomDirWalker
+ *  \brief Finds the ROMs under a directory, listing its subdirectories on
+ *         several threads at once.
+ */
+class RomDirWalker
+{
+  public:
+    explicit RomDirWalker(const QStringList &extensions) :
+        m_extensions(extensions), m_busy(0), m_dirCount(0) {}
+
+    QFileInfoList walk(const QString &directory);
+
+    void work(void);
+
+  private:
+    bool isRom(const QFileInfo &info) const;
+    void collect(const QString &directory, QFileInfoList &found) const;
+
+    QStringList    m_extensions;
+    QStringList    m_queue;
+    int            m_busy;
+    int            m_dirCount;
+    /// Subdirectories and ROMs of each directory listed, in name order
+    QHash<QString, QStringList>   m_subdirs;
+    QHash<QString, QFileInfoList> m_roms;
+    QMutex         m_lock;
+    QWaitCondition m_wait;
+};
+
+class RomCRCFile
+{
+  public:
+    explicit RomCRCFile(const QString &lpath = QString()) :
+        path(lpath), size(0), mtime(0), cached(false), bytesRead(0) {}
+
+    QString     path;
+    qint64      size;
+    uint        mtime;
+    QStringList keys;      ///< as romCRCKeys() returns them
+    bool        cached;
+    qint64      bytesRead;
+};
+
+/** \class RomCRCScanner
+ *  \brief Works out the CRCs of a batch of ROMs on several threads.
+ *
+ *  CRCs are cached in the gamecrccache table against each file's size and
+ *  modification time, so a rescan only reads files that are new or have
+ *  changed. The cache is updated once the whole batch is done, and entries
+ *  for files that have since been deleted are removed.
+ */
+class RomCRCScanner
+{
+  public:
+    explicit RomCRCScanner(const QString &gametype) :
+        m_gametype(gametype), m_next(0), m_done(0) {}
+    ~RomCRCScanner();
+
+    void addFile(const QString &path);
+
+    void start(void);
+    bool isFinished(void);
+    int  filesDone(void);
+    void finish(void);
+
+    QStringList keys(const QString &path) const;
+
+    RomCRCFile *nextFile(void);
+    void scanFile(RomCRCFile *file) const;
+    void fileDone(void);
+
+  private:
+    void loadCache(void);
+    void saveCache(void);
+    void pruneCache(void);
+
+    QString                     m_gametype;
+    QList<RomCRCFile*>          m_files;
+    QHash<QString, RomCRCFile*> m_byPath;
+    QHash<QString, RomCRCFile>  m_cache;
+    int                         m_next;
+    int                         m_done;
+    QMutex                      m_lock;
+    QList<MThread*>             m_threads;
+    QElapsedTimer               m_timer;
+};
+
+#endif
@@ -6,3 +6,9 @@ TEMPLATE = subdirs
 
 # Directories
 SUBDIRS = mythmusic theme i18n
+
+# unit tests mythmusic
+mythmusic-test.depends = sub-mythmusic
+mythmusic-test.target = buildtestmythmusic
+mythmusic-test.commands = cd mythmusic/test && $(QMAKE) && $(MAKE)
+unix:QMAKE_EXTRA_TARGETS += mythmusic-test
@@ -23,6 +23,8 @@
 #include <QIODevice>
 #include <QFile>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QMutex>
 
 // Myth headers
 #include <mythconfig.h>
@@ -51,6 +53,13 @@ extern "C" {
 #include "libavutil/opt.h"
 }
 
+/// How much of the next track a lookahead decodes before it is needed, in ms
+static const int kLookaheadTime = 2000;
+
+/// A lookahead decodes while the track before it plays, into the same
+/// output, and AudioOutput::DecodeAudio() isn't safe to call concurrently
+static QMutex s_decodeLock;
+
 /****************************************************************************/
 
 typedef QMap<QString,QString> ShoutCastMetaMap;
@@ -244,7 +253,9 @@ avfDecoder::avfDecoder(const QString &file, DecoderFactory *d, AudioOutput *o) :
     m_seekTime(-1.0),             m_devicename(""),
     m_inputFormat(NULL),          m_inputContext(NULL),
     m_audioDec(NULL),             m_inputIsFile(false),
-    m_mdataTimer(NULL),           m_errCode(0)
+    m_mdataTimer(NULL),           m_errCode(0),
+    m_lookahead(kLookaheadNone),  m_spliced(false),
+    m_format(FORMAT_NONE),        m_clockShift(-1)
 {
     MThread::setObjectName("avfDecoder");
     setURL(file);
@@ -297,22 +308,10 @@ bool avfDecoder::initialize()
         return false;
     }
 
-    // register av codecs
-    av_register_all();
-
     output()->PauseUntilBuffered();
 
-    if (m_inputContext)
-        delete m_inputContext;
-
-    m_inputContext = new RemoteAVFormatContext(getURL());
-
-    if (!m_inputContext->isOpen())
-    {
-        error(QString("Could not open url  (%1)").arg(m_url));
-        deinit();
+    if (!openFile())
         return false;
-    }
 
     // if this is a ice/shoutcast or MMS stream start polling for metadata changes and buffer status
     if (getURL().startsWith("http://") || getURL().startsWith("mmsh://"))
@@ -343,6 +342,42 @@ bool avfDecoder::initialize()
         }
     }
 
+    if (!openCodec())
+        return false;
+
+    const AudioSettings settings(m_format, m_audioDec->channels,
+                                 m_audioDec->codec_id,
+                                 m_audioDec->sample_rate, false);
+
+    output()->Reconfigure(settings);
+    output()->SetSourceBitrate(m_audioDec->bit_rate);
+
+    m_inited = true;
+    return true;
+}
+
+bool avfDecoder::openFile(void)
+{
+    // register av codecs
+    av_register_all();
+
+    if (m_inputContext)
+        delete m_inputContext;
+
+    m_inputContext = new RemoteAVFormatContext(getURL());
+
+    if (!m_inputContext->isOpen())
+    {
+        error(QString("Could not open url  (%1)").arg(m_url));
+        deinit();
+        return false;
+    }
+
+    return true;
+}
+
+bool avfDecoder::openCodec(void)
+{
     // determine the stream format
     // this also populates information needed for metadata
     if (avformat_find_stream_info(m_inputContext->getContext(), NULL) < 0)
@@ -391,10 +426,10 @@ bool avfDecoder::initialize()
         return false;
     }
 
-    AudioFormat format =
+    m_format =
         AudioOutputSettings::AVSampleFormatToFormat(m_audioDec->sample_fmt,
                                                     m_audioDec->bits_per_raw_sample);
-    if (format == FORMAT_NONE)
+    if (m_format == FORMAT_NONE)
     {
         error(QString("Error: Unsupported sample format: %1")
               .arg(av_get_sample_fmt_name(m_audioDec->sample_fmt)));
@@ -402,17 +437,278 @@ bool avfDecoder::initialize()
         return false;
     }
 
-    const AudioSettings settings(format, m_audioDec->channels,
-                                 m_audioDec->codec_id,
-                                 m_audioDec->sample_rate, false);
+    return true;
+}
+
+/// Errors found while looking ahead are only logged, the track is then
+/// started the normal way and any error reported then
+void avfDecoder::error(const QString &e)
+{
+    if (m_lookahead != kLookaheadNone)
+        LOG(VB_PLAYBACK, LOG_WARNING,
+            QString("avfDecoder: lookahead for %1 failed - %2")
+                .arg(m_url).arg(e));
+    else
+        Decoder::error(e);
+}
+
+/**
+ *  \brief Starts opening and decoding the start of the file while the track
+ *         before it plays.
+ *
+ *  When the track before reaches its end it hands over the output, if the
+ *  formats match, and this decoder carries on from what it has decoded
+ *  without the output being reset or reconfigured.
+ */
+bool avfDecoder::startLookahead(void)
+{
+    if (!output() || !m_outputBuffer)
+        return false;
+
+    m_inited = m_userStop = m_finish = m_spliced = false;
+    m_seekTime = -1.0;
+    m_pending.clear();
+    m_lookahead = kLookaheadOpening;
+
+    start();
+
+    return true;
+}
+
+bool avfDecoder::isSpliced(void)
+{
+    QMutexLocker locker(getMutex());
+    return m_spliced;
+}
+
+bool avfDecoder::abortLookahead(void)
+{
+    QMutexLocker locker(getMutex());
+    if (m_spliced)
+        return false;
+
+    // also ends the wait of a track handing the output over to us
+    m_userStop = true;
+    cond()->wakeAll();
+    return true;
+}
+
+void avfDecoder::restartClock(int64_t shift)
+{
+    QMutexLocker locker(getMutex());
+    m_clockShift = shift;
+    cond()->wakeAll();
+}
+
+/// Applies a restartClock() request, from the decoder thread
+void avfDecoder::applyClockShift(void)
+{
+    lock();
+    int64_t shift = m_clockShift;
+    m_clockShift = -1;
+    unlock();
+
+    if (shift < 0)
+        return;
+
+    output()->SetTimecode(output()->GetAudiotime() +
+                          output()->GetAudioBufferedTime() - shift);
+}
+
+bool avfDecoder::runLookahead(void)
+{
+    bool ok = openFile() && openCodec();
+
+    if (ok)
+    {
+        int wanted = kLookaheadTime * m_freq / 1000 * m_channels *
+                     AudioOutputSettings::SampleSize(m_format);
+
+        AVPacket pkt;
+        memset(&pkt, 0, sizeof(AVPacket));
+        av_init_packet(&pkt);
+
+        while (!m_userStop && m_pending.size() < wanted)
+        {
+            if (av_read_frame(m_inputContext->getContext(), &pkt) < 0)
+            {
+                // a track this short is simply played from m_pending
+                m_finish = true;
+                break;
+            }
+
+            decodePacket(&pkt, &m_pending);
+            av_packet_unref(&pkt);
+        }
+    }
+
+    lock();
+    m_lookahead = ok ? kLookaheadReady : kLookaheadFailed;
+    cond()->wakeAll();
+    while (ok && !m_spliced && !m_userStop)
+        cond()->wait(getMutex());
+    ok = m_spliced && !m_userStop;
+    m_lookahead = kLookaheadNone;
+    unlock();
+
+    if (!ok)
+    {
+        deinit();
+        return false;
+    }
+
+    LOG(VB_PLAYBACK, LOG_INFO,
+        QString("avfDecoder: spliced %1 with %2 bytes decoded ahead")
+            .arg(m_url).arg(m_pending.size()));
 
-    output()->Reconfigure(settings);
     output()->SetSourceBitrate(m_audioDec->bit_rate);
 
+    // feed what was decoded ahead as if it had just been decoded
+    const int chunk = 64 * 1024;
+    for (int pos = 0; pos < m_pending.size() && !m_userStop; pos += chunk)
+    {
+        output()->AddData(m_pending.data() + pos,
+                          qMin(chunk, m_pending.size() - pos), -1, 0);
+        waitForOutput();
+    }
+    m_pending.clear();
+
     m_inited = true;
     return true;
 }
 
+/// Hands the output over to the lookahead for the next track, if there is
+/// one with a matching format, returns false if the output must be drained
+bool avfDecoder::spliceNext(void)
+{
+    // so the splice time is on the clock the player is already using
+    applyClockShift();
+
+    lock();
+    avfDecoder *next = dynamic_cast<avfDecoder*>(m_next);
+    if (!next)
+    {
+        unlock();
+        return false;
+    }
+
+    m_spliceTime = output()->GetAudiotime() + output()->GetAudioBufferedTime();
+
+    // setNextDecoder() waits for this to clear before the lookahead can be
+    // deleted, our lock isn't held while we wait for it to be ready
+    m_splicing = true;
+    unlock();
+
+    bool spliced = next->spliceFrom(this);
+
+    lock();
+    m_splicing = false;
+    cond()->wakeAll();
+    unlock();
+
+    return spliced;
+}
+
+bool avfDecoder::spliceFrom(avfDecoder *prev)
+{
+    QMutexLocker locker(getMutex());
+
+    // give a lookahead which hasn't opened the file yet until just before
+    // the output runs dry
+    QElapsedTimer timer;
+    timer.start();
+    int64_t wait = prev->output()->GetAudioBufferedTime() - 200;
+    while (m_lookahead == kLookaheadOpening && !m_userStop &&
+           timer.elapsed() < wait)
+    {
+        cond()->wait(getMutex(), qMax(wait - timer.elapsed(), (qint64)1));
+    }
+
+    if (m_lookahead != kLookaheadReady || m_userStop)
+    {
+        LOG(VB_PLAYBACK, LOG_INFO,
+            QString("avfDecoder: lookahead for %1 not ready").arg(m_url));
+        return false;
+    }
+
+    if (output() != prev->output() || m_format != prev->m_format ||
+        m_freq != prev->m_freq || m_channels != prev->m_channels)
+    {
+        LOG(VB_PLAYBACK, LOG_INFO,
+            QString("avfDecoder: %1 has a different format, can't splice")
+                .arg(m_url));
+        return false;
+    }
+
+    LOG(VB_PLAYBACK, LOG_INFO,
+        QString("avfDecoder: splicing with %1 ms of audio still buffered")
+            .arg(prev->output()->GetAudioBufferedTime()));
+
+    m_spliced = true;
+    cond()->wakeAll();
+
+    return true;
+}
+
+/// Decodes a packet and adds the audio to the output, or to pending if set
+bool avfDecoder::decodePacket(AVPacket *pkt, QByteArray *pending)
+{
+    AVPacket tmp_pkt;
+    av_init_packet(&tmp_pkt);
+    tmp_pkt.data = pkt->data;
+    tmp_pkt.size = pkt->size;
+
+    while (tmp_pkt.size > 0 && !m_finish &&
+           !m_userStop && m_seekTime <= 0.0)
+    {
+        int data_size = 0;
+
+        s_decodeLock.lock();
+        int ret = output()->DecodeAudio(m_audioDec,
+                                        m_outputBuffer,
+                                        data_size,
+                                        &tmp_pkt);
+        s_decodeLock.unlock();
+
+        if (ret < 0)
+            return false;
+
+        // Increment the output pointer and count
+        tmp_pkt.size -= ret;
+        tmp_pkt.data += ret;
+
+        if (data_size <= 0)
+            continue;
+
+        if (pending)
+            pending->append((const char *)m_outputBuffer, data_size);
+        else
+            output()->AddData(m_outputBuffer, data_size, -1, 0);
+    }
+
+    return true;
+}
+
+/// Waits until we need to decode or supply more samples
+void avfDecoder::waitForOutput(void)
+{
+    while (!m_finish && !m_userStop && m_seekTime <= 0.0)
+    {
+        applyClockShift();
+
+        int64_t buffered = output()->GetAudioBufferedTime();
+        // never go below 1s buffered
+        if (buffered < 1000)
+            break;
+
+        // wait, restartClock() wakes us early
+        lock();
+        if (m_clockShift < 0 && !m_userStop)
+            cond()->wait(getMutex(), buffered - 1000);
+        unlock();
+    }
+}
+
 void avfDecoder::seek(double pos)
 {
     if (m_inputContext->getContext() && m_inputContext->getContext()->pb &&
@@ -447,13 +743,20 @@ void avfDecoder::deinit()
 void avfDecoder::run()
 {
     RunProlog();
+
+    if (m_lookahead != kLookaheadNone && !runLookahead())
+    {
+        RunEpilog();
+        return;
+    }
+
     if (!m_inited)
     {
         RunEpilog();
         return;
     }
 
-    AVPacket pkt, tmp_pkt;
+    AVPacket pkt;
     memset(&pkt, 0, sizeof(AVPacket));
     av_init_packet(&pkt);
 
@@ -496,62 +799,29 @@ void avfDecoder::run()
                 break;
             }
 
-            av_init_packet(&tmp_pkt);
-            tmp_pkt.data = pkt.data;
-            tmp_pkt.size = pkt.size;
-
-            while (tmp_pkt.size > 0 && !m_finish &&
-                   !m_userStop && m_seekTime <= 0.0)
-            {
-                int data_size = 0;
-
-                int ret = output()->DecodeAudio(m_audioDec,
-                                                m_outputBuffer,
-                                                data_size,
-                                                &tmp_pkt);
-
-                if (ret < 0)
-                    break;
-
-                // Increment the output pointer and count
-                tmp_pkt.size -= ret;
-                tmp_pkt.data += ret;
-
-                if (data_size <= 0)
-                    continue;
-
-                output()->AddData(m_outputBuffer, data_size, -1, 0);
-            }
+            decodePacket(&pkt);
 
             av_packet_unref(&pkt);
 
-            // Wait until we need to decode or supply more samples
-            while (!m_finish && !m_userStop && m_seekTime <= 0.0)
-            {
-                int64_t buffered = output()->GetAudioBufferedTime();
-                // never go below 1s buffered
-                if (buffered < 1000)
-                    break;
-                else
-                {
-                    // wait
-                    usleep((buffered - 1000) * 1000);
-                }
-            }
+            waitForOutput();
         }
     }
 
+    bool spliced = false;
+
     if (m_userStop)
     {
         m_inited = false;
     }
-    else
+    else if (!(spliced = spliceNext()))
     {
         // Drain ao buffer, making sure we play all remaining audio samples
         output()->Drain();
     }
 
-    if (m_finish)
+    if (spliced)
+        m_stat = DecoderEvent::Spliced;
+    else if (m_finish)
         m_stat = DecoderEvent::Finished;
     else if (m_userStop)
         m_stat = DecoderEvent::Stopped;
@@ -25,6 +25,11 @@ class avfDecoder : public QObject, public Decoder
     void seek(double);
     void stop();
 
+    bool startLookahead(void);
+    bool isSpliced(void);
+    bool abortLookahead(void);
+    void restartClock(int64_t shift);
+
   protected slots:
     void checkMetatdata(void);
 
@@ -32,6 +37,17 @@ class avfDecoder : public QObject, public Decoder
     void run();
 
     void deinit();
+    void error(const QString &e);
+
+    bool openFile(void);
+    bool openCodec(void);
+    bool decodePacket(AVPacket *pkt, QByteArray *pending = NULL);
+    void waitForOutput(void);
+    void applyClockShift(void);
+
+    bool runLookahead(void);
+    bool spliceNext(void);
+    bool spliceFrom(avfDecoder *prev);
 
     bool m_inited, m_userStop;
     int m_stat;
@@ -54,6 +70,21 @@ class avfDecoder : public QObject, public Decoder
     QString m_lastMetadata;
 
     int m_errCode;
+
+    // gapless playback
+    typedef enum
+    {
+        kLookaheadNone,
+        kLookaheadOpening,
+        kLookaheadReady,
+        kLookaheadFailed
+    } LookaheadState;
+
+    LookaheadState m_lookahead;
+    bool           m_spliced;
+    AudioFormat    m_format;
+    QByteArray     m_pending;  ///< audio decoded before being spliced
+    int64_t        m_clockShift; ///< restartClock() request, or -1
 };
 
 #endif
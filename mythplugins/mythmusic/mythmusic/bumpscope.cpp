@@ -10,6 +10,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 
 #include <iostream>
 using namespace std;
@@ -17,6 +18,10 @@ using namespace std;
 #include <QCoreApplication>
 #include <QPainter>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 BumpScope::BumpScope() :
     m_image(NULL),
 
@@ -76,6 +81,7 @@ void BumpScope::resize(const QSize &newsize)
     int bufsize = (m_size.height() + 2) * (m_size.width() + 2);
 
     m_rgb_buf = new unsigned char[bufsize];
+    memset(m_rgb_buf, 0, bufsize);
 
     m_bpl = m_size.width() + 2;
 
@@ -99,22 +105,65 @@ void BumpScope::resize(const QSize &newsize)
     generate_cmap(m_color);
 }
 
-void BumpScope::blur_8(unsigned char *ptr, int w, int h, int bpl)
+/// Blurs \p count pixels: each becomes the average of the pixels around
+/// it, less 2 if that is more than 2, so the picture fades as it blurs
+static void blur_row(unsigned char *out, const unsigned char *row,
+                     const unsigned char *above, const unsigned char *below,
+                     int count)
 {
-    (void)w;
-
-    register unsigned int i, sum;
-    register unsigned char *iptr;
+    int i = 0;
 
-    iptr = ptr + bpl + 1;
-    i = bpl * h;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i u = _mm_loadu_si128((const __m128i *)(above + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(below + i));
+        __m128i l = _mm_loadu_si128((const __m128i *)(row + i - 1));
+        __m128i r = _mm_loadu_si128((const __m128i *)(row + i + 1));
+
+        __m128i lo = _mm_add_epi16(
+            _mm_add_epi16(_mm_unpacklo_epi8(u, zero),
+                          _mm_unpacklo_epi8(d, zero)),
+            _mm_add_epi16(_mm_unpacklo_epi8(l, zero),
+                          _mm_unpacklo_epi8(r, zero)));
+        __m128i hi = _mm_add_epi16(
+            _mm_add_epi16(_mm_unpackhi_epi8(u, zero),
+                          _mm_unpackhi_epi8(d, zero)),
+            _mm_add_epi16(_mm_unpackhi_epi8(l, zero),
+                          _mm_unpackhi_epi8(r, zero)));
+        lo = _mm_srli_epi16(lo, 2);
+        hi = _mm_srli_epi16(hi, 2);
+        lo = _mm_sub_epi16(lo, _mm_and_si128(_mm_cmpgt_epi16(lo, two), two));
+        hi = _mm_sub_epi16(hi, _mm_and_si128(_mm_cmpgt_epi16(hi, two), two));
+
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
 
-    while (i--)
+    for (; i < count; i++)
     {
-        sum = (iptr[-bpl] + iptr[-1] + iptr[1] + iptr[bpl]) >> 2;
+        unsigned int sum = (above[i] + row[i - 1] + row[i + 1] + below[i]) >> 2;
         if (sum > 2)
             sum -= 2;
-        *(iptr++) = sum;
+        out[i] = sum;
+    }
+}
+
+void BumpScope::blur_8(unsigned char *ptr, int w, int h, int bpl)
+{
+    // Each row is blurred from the row above, which is already done, and
+    // copies of itself and the row below as they were. The pixels in a row
+    // don't depend on each other, so a row can be done many at a time.
+    m_blur_row.resize(bpl);
+    unsigned char *row = &m_blur_row[0];
+
+    for (int y = 1; y <= h; y++)
+    {
+        unsigned char *line = ptr + y * bpl;
+        memcpy(row, line, bpl);
+        blur_row(line + 1, row + 1, line + 1 - bpl, line + 1 + bpl, w);
     }
 }
 
@@ -54,6 +54,7 @@ private:
 
     vector<vector<unsigned char> > m_phongdat;
     unsigned char *m_rgb_buf;
+    vector<unsigned char> m_blur_row;
     double m_intense1[256];
     double m_intense2[256];
 
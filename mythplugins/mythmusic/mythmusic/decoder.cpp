@@ -27,11 +27,15 @@ QEvent::Type DecoderEvent::Stopped =
     (QEvent::Type) QEvent::registerEventType();
 QEvent::Type DecoderEvent::Finished =
     (QEvent::Type) QEvent::registerEventType();
+QEvent::Type DecoderEvent::Spliced =
+    (QEvent::Type) QEvent::registerEventType();
 QEvent::Type DecoderEvent::Error =
     (QEvent::Type) QEvent::registerEventType();
 
 Decoder::Decoder(DecoderFactory *d, AudioOutput *o) :
-    MThread("MythMusicDecoder"), m_fctry(d), m_out(o)
+    MThread("MythMusicDecoder"), m_next(NULL), m_splicing(false),
+    m_spliceTime(-1),
+    m_fctry(d), m_out(o)
 {
 }
 
@@ -55,6 +59,18 @@ void Decoder::setOutput(AudioOutput *o)
     unlock();
 }
 
+/// Sets the decoder to hand the output over to when this one reaches the end
+/// of its file. Waits for a hand over in progress to finish, call
+/// abortLookahead() on the old one first so that is at once.
+void Decoder::setNextDecoder(Decoder *next)
+{
+    lock();
+    while (m_splicing)
+        cond()->wait(getMutex());
+    m_next = next;
+    unlock();
+}
+
 void Decoder::error(const QString &e)
 {
     QString *str = new QString(e.toUtf8());
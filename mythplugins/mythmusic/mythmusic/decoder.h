@@ -3,6 +3,8 @@
 #ifndef DECODER_H_
 #define DECODER_H_
 
+#include <stdint.h>
+
 #include <QWaitCondition>
 #include <QStringList>
 #include <QEvent>
@@ -47,6 +49,7 @@ class DecoderEvent : public MythEvent
     static Type Decoding;
     static Type Stopped;
     static Type Finished;
+    static Type Spliced;
     static Type Error;
 
   private:
@@ -87,6 +90,23 @@ class Decoder : public MThread, public MythObservable
 
     QString getURL(void) const { return m_url; }
 
+    /// Opens the file and decodes the start of it in the background, so
+    /// it can follow the track playing without a gap. Not all decoders can.
+    virtual bool startLookahead(void) { return false; }
+    /// Whether a lookahead has taken over the output from the track before
+    virtual bool isSpliced(void) { return false; }
+    /// Stops a lookahead unless it has taken over the output already, in
+    /// which case it returns false and keeps playing
+    virtual bool abortLookahead(void) { return true; }
+    /// Moves the output clock back by shift ms, so it restarts at zero at
+    /// the start of a track that was spliced on. The decoder thread does
+    /// this, as it is the only one adding data to the output.
+    virtual void restartClock(int64_t shift) { (void)shift; }
+
+    void setNextDecoder(Decoder *next);
+    /// Output time, in ms, at which the next decoder's track starts
+    int64_t getSpliceTime(void) const { return m_spliceTime; }
+
     // static methods
     static QStringList all();
     static bool supports(const QString &);
@@ -99,6 +119,9 @@ class Decoder : public MThread, public MythObservable
     void error(const QString &);
 
     QString m_url;
+    Decoder *m_next;
+    bool m_splicing;      ///< handing the output over to m_next
+    int64_t m_spliceTime;
 
   private:
     DecoderFactory *m_fctry;
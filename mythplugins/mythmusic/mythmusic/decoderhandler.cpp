@@ -74,6 +74,7 @@ DecoderHandler::DecoderHandler(void) :
     m_state(STOPPED),
     m_playlist_pos(0),
     m_decoder(NULL),
+    m_nextDecoder(NULL),
     m_op(false),
     m_redirects(0)
 {
@@ -189,30 +190,152 @@ void DecoderHandler::stop(void)
 {
     LOG(VB_PLAYBACK, LOG_INFO, QString("DecoderHandler: Stopping decoder"));
 
-    if (m_decoder && m_decoder->isRunning())
+    // ends any hand over to the lookahead before letting go of it
+    if (m_nextDecoder)
+        m_nextDecoder->abortLookahead();
+    if (m_decoder)
+        m_decoder->setNextDecoder(NULL);
+
+    stopDecoder(m_nextDecoder);
+    m_nextDecoder = NULL;
+
+    stopDecoder(m_decoder);
+    m_decoder = NULL;
+
+    doOperationStop();
+
+    m_state = STOPPED;
+}
+
+void DecoderHandler::stopDecoder(Decoder *decoder)
+{
+    if (!decoder)
+        return;
+
+    if (decoder->isRunning())
     {
-        m_decoder->lock();
-        m_decoder->stop();
-        m_decoder->unlock();
+        decoder->lock();
+        decoder->stop();
+        decoder->unlock();
     }
 
-    if (m_decoder)
+    decoder->lock();
+    decoder->cond()->wakeAll();
+    decoder->unlock();
+
+    decoder->wait();
+    delete decoder;
+}
+
+QUrl DecoderHandler::toUrl(const QString &filename)
+{
+    if (QFileInfo(filename).isAbsolute())
+        return QUrl::fromLocalFile(filename);
+
+    return QUrl(filename);
+}
+
+/**
+ *  \brief Creates a decoder to open the next track while this one plays.
+ *
+ *  Returns NULL if the track can't follow this one without a gap, otherwise
+ *  the caller adds its listeners and calls startLookahead(). Once this
+ *  track's decoder reaches the end of its file it hands the output over,
+ *  sending DecoderEvent::Spliced, and splice() must then be called.
+ */
+Decoder *DecoderHandler::prefetch(MusicMetadata *mdata, AudioOutput *output)
+{
+    cancelLookahead();
+
+    if (m_state != ACTIVE || !m_decoder || !m_decoder->isRunning() ||
+        m_playlist.size() != 1 || !output)
+        return NULL;
+
+    // streams, playlists and CDs are always started the normal way
+    QUrl url = toUrl(mdata->Filename());
+    QString extension = QFileInfo(url.path()).suffix().toLower();
+    if (url.scheme() == "http" || url.scheme() == "mmsh" ||
+        extension == "pls" || extension == "m3u" || extension == "asx" ||
+        extension == "cda")
+        return NULL;
+
+    Decoder *decoder = Decoder::create(".mp3", output, true);
+    if (!decoder)
+        return NULL;
+
+    decoder->setURL(url.toString());
+
+    m_nextDecoder = decoder;
+    m_nextMeta = *mdata;
+
+    return m_nextDecoder;
+}
+
+void DecoderHandler::startLookahead(void)
+{
+    if (!m_nextDecoder)
+        return;
+
+    if (!m_nextDecoder->startLookahead())
     {
-        m_decoder->lock();
-        m_decoder->cond()->wakeAll();
-        m_decoder->unlock();
+        delete m_nextDecoder;
+        m_nextDecoder = NULL;
+        return;
     }
 
+    LOG(VB_PLAYBACK, LOG_INFO, QString("Looking ahead to '%1'")
+        .arg(m_nextDecoder->getURL()));
+
+    m_decoder->setNextDecoder(m_nextDecoder);
+}
+
+/// Throws away the lookahead, unless it is already playing
+void DecoderHandler::cancelLookahead(void)
+{
+    if (!m_nextDecoder)
+        return;
+
+    // a hand over waiting for the lookahead gives up at once, one that has
+    // already taken place is left to play
+    bool aborted = m_nextDecoder->abortLookahead();
+
     if (m_decoder)
-    {
-        m_decoder->wait();
-        delete m_decoder;
-        m_decoder = NULL;
-    }
+        m_decoder->setNextDecoder(NULL);
 
-    doOperationStop();
+    if (!aborted)
+        return;
 
-    m_state = STOPPED;
+    stopDecoder(m_nextDecoder);
+    m_nextDecoder = NULL;
+}
+
+/// Makes the lookahead, which the current decoder has handed the output
+/// over to, the current decoder
+bool DecoderHandler::splice(void)
+{
+    if (!m_nextDecoder || !m_nextDecoder->isSpliced())
+        return false;
+
+    // the old decoder has finished, and is only waiting to be deleted
+    m_decoder->wait();
+    delete m_decoder;
+
+    m_decoder = m_nextDecoder;
+    m_nextDecoder = NULL;
+    m_meta = m_nextMeta;
+    m_url = toUrl(m_meta.Filename());
+
+    m_playlist.clear();
+    PlayListFileEntry *entry = new PlayListFileEntry;
+    entry->setFile(m_meta.Filename());
+    m_playlist.add(entry);
+    m_playlist_pos = 0;
+    m_state = ACTIVE;
+
+    LOG(VB_PLAYBACK, LOG_INFO, QString("Now playing '%1' (gapless)")
+        .arg(m_url.toString()));
+
+    return true;
 }
 
 void DecoderHandler::customEvent(QEvent *event)
@@ -20,6 +20,7 @@
 #include "pls.h"
 
 class Decoder;
+class AudioOutput;
 
 /** \brief Events sent by the \p DecoderHandler and it's helper classes.
  */
@@ -87,6 +88,13 @@ class DecoderHandler : public QObject, public MythObservable
 
     void start(MusicMetadata *mdata);
 
+    Decoder *prefetch(MusicMetadata *mdata, AudioOutput *output);
+    void startLookahead(void);
+    void cancelLookahead(void);
+    bool hasLookahead(void) const { return m_nextDecoder != NULL; }
+    MusicMetadata& getLookaheadMetadata() { return m_nextMeta; }
+    bool splice(void);
+
     void stop(void);
     void customEvent(QEvent *e);
     bool done(void);
@@ -111,11 +119,16 @@ class DecoderHandler : public QObject, public MythObservable
     void createPlaylistFromFile(const QUrl &url);
     void createPlaylistFromRemoteUrl(const QUrl &url);
 
+    static QUrl toUrl(const QString &filename);
+    static void stopDecoder(Decoder *decoder);
+
     int               m_state;
     int               m_playlist_pos;
     PlayListFile      m_playlist;
     Decoder          *m_decoder;
+    Decoder          *m_nextDecoder;
     MusicMetadata     m_meta;
+    MusicMetadata     m_nextMeta;
     QUrl              m_url;
     bool              m_op;
     uint              m_redirects;
@@ -35,7 +35,8 @@ using namespace std;
 MainVisual::MainVisual(MythUIVideo *visualizer)
     : QObject(NULL), MythTV::Visual(), m_visualizerVideo(visualizer),
       m_vis(NULL), m_playing(false), m_fps(20), m_samples(SAMPLES_DEFAULT_SIZE),
-      m_updateTimer(NULL)
+      m_updateTimer(NULL), m_statsFrames(0), m_statsProcess(0),
+      m_statsDraw(0)
 {
     setObjectName("MainVisual");
 
@@ -125,6 +126,7 @@ void MainVisual::setVisual(const QString &name)
             m_vis->resize(m_visualizerVideo->GetArea().size());
             m_fps = m_vis->getDesiredFPS();
             m_samples = m_vis->getDesiredSamples();
+            m_statsTimer.invalidate();
 
             QMutexLocker locker(mutex());
             prepare();
@@ -230,21 +232,61 @@ void MainVisual::timeout()
             node = m_nodes.first();
     }
 
+    QElapsedTimer timer;
+    timer.start();
+
     bool stop = true;
     if (m_vis)
         stop = m_vis->process(node);
 
+    qint64 processTime = timer.nsecsElapsed();
+
     if (m_vis && !stop)
     {
         QPainter p(&m_pixmap);
         if (m_vis->draw(&p, m_visualizerVideo->GetBackgroundColor()))
             m_visualizerVideo->UpdateFrame(&m_pixmap);
+
+        updateStats(processTime, timer.nsecsElapsed() - processTime);
     }
 
     if (m_playing && !stop)
         m_updateTimer->start();
 }
 
+/// Logs how long the visualizer takes to analyse and draw a frame, averaged
+/// over ten seconds, so changes to them can be measured on real hardware
+void MainVisual::updateStats(qint64 processTime, qint64 drawTime)
+{
+    if (!VERBOSE_LEVEL_CHECK(VB_PLAYBACK, LOG_DEBUG))
+        return;
+
+    if (!m_statsTimer.isValid())
+    {
+        m_statsTimer.start();
+        m_statsFrames = 0;
+        m_statsProcess = m_statsDraw = 0;
+    }
+
+    m_statsFrames++;
+    m_statsProcess += processTime;
+    m_statsDraw += drawTime;
+
+    if (m_statsTimer.elapsed() < 10000)
+        return;
+
+    LOG(VB_PLAYBACK, LOG_DEBUG,
+        QString("MainVisual: %1 at %2x%3, %4 frames, "
+                "process %5 ms draw %6 ms per frame")
+            .arg(m_visualizers.value(m_currentVisualizer))
+            .arg(m_pixmap.width()).arg(m_pixmap.height())
+            .arg(m_statsFrames)
+            .arg(m_statsProcess / 1e6 / m_statsFrames, 0, 'f', 2)
+            .arg(m_statsDraw / 1e6 / m_statsFrames, 0, 'f', 2));
+
+    m_statsTimer.invalidate();
+}
+
 void MainVisual::resize(const QSize &size)
 {
     m_pixmap = QPixmap(size);
@@ -14,6 +14,7 @@ using namespace std;
 
 #include <QResizeEvent>
 #include <QPaintEvent>
+#include <QElapsedTimer>
 #include <QStringList>
 #include <QHideEvent>
 #include <QWidget>
@@ -61,6 +62,8 @@ class MainVisual :  public QObject, public MythTV::Visual
     void timeout();
 
   private:
+    void updateStats(qint64 processTime, qint64 drawTime);
+
     MythUIVideo *m_visualizerVideo;
     QStringList m_visualizers;
     int m_currentVisualizer;
@@ -71,6 +74,12 @@ class MainVisual :  public QObject, public MythTV::Visual
     int m_fps;
     unsigned long m_samples;
     QTimer *m_updateTimer;
+
+    // Time the visualizer takes per frame, logged with -v playback
+    QElapsedTimer m_statsTimer;
+    int m_statsFrames;
+    qint64 m_statsProcess;
+    qint64 m_statsDraw;
 };
 
 #endif // __mainvisual_h
@@ -13,6 +13,7 @@
 // mythmusic
 #include "musicdata.h"
 #include "musicplayer.h"
+#include "songindex.h"
 
 #include <unistd.h> // for usleep()
 
@@ -28,6 +29,7 @@ MusicData::MusicData(void)
     all_playlists = NULL;
     all_music = NULL;
     all_streams = NULL;
+    song_index = NULL;
     initialized = false;
 }
 
@@ -50,6 +52,12 @@ MusicData::~MusicData(void)
         delete all_streams;
         all_streams = NULL;
     }
+
+    if (song_index)
+    {
+        delete song_index;
+        song_index = NULL;
+    }
 }
 
 void MusicData::scanMusic (void)
@@ -95,6 +103,9 @@ void MusicData::reloadMusic(void)
         usleep(50000);
     }
 
+    if (song_index)
+        song_index->rebuild();
+
     all_playlists->resync();
 
     if (busy)
@@ -141,6 +152,9 @@ void MusicData::loadMusic(void)
         usleep(50000);
     }
 
+    gMusicData->song_index = new SongIndex();
+    gMusicData->song_index->rebuild();
+
     gPlayer->loadStreamPlaylist();
     gPlayer->loadPlaylist();
 
@@ -15,6 +15,7 @@
 class PlaylistContainer;
 class AllMusic;
 class AllStream;
+class SongIndex;
 
 /// send a message to the master BE without blocking the UI thread
 class SendStringListThread : public QRunnable
@@ -55,6 +56,7 @@ class MusicData : public QObject
     PlaylistContainer  *all_playlists;
     AllMusic           *all_music;
     AllStream          *all_streams;
+    SongIndex          *song_index;
     bool                initialized;
 };
 
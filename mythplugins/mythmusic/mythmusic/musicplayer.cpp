@@ -31,6 +31,7 @@
 #include "mainvisual.h"
 #include "miniplayer.h"
 #include "playlistcontainer.h"
+#include "songindex.h"
 
 // how long to wait before updating the lastplay and playcount fields
 #define LASTPLAY_DELAY 15
@@ -40,6 +41,9 @@ QString gCDdevice = "";
 
 ////////////////////////////////////////////////////////////////
 
+/// How long before the end of a track, in seconds, to start opening the next
+static const int kLookaheadStart = 10;
+
 QEvent::Type MusicPlayerEvent::TrackChangeEvent = (QEvent::Type) QEvent::registerEventType();
 QEvent::Type MusicPlayerEvent::VolumeChangeEvent = (QEvent::Type) QEvent::registerEventType();
 QEvent::Type MusicPlayerEvent::TrackAddedEvent = (QEvent::Type) QEvent::registerEventType();
@@ -84,6 +88,9 @@ MusicPlayer::MusicPlayer(QObject *parent)
 
     m_errorCount = 0;
 
+    m_lookaheadTried = false;
+    m_spliceTime = -1;
+
     QString playmode = gCoreContext->GetSetting("PlayMode", "none");
     if (playmode.toLower() == "random")
         setShuffleMode(SHUFFLE_RANDOM);
@@ -386,6 +393,9 @@ void MusicPlayer::stopDecoder(void)
 {
     if (getDecoderHandler())
         getDecoderHandler()->stop();
+
+    m_lookaheadTried = false;
+    m_spliceTime = -1;
 }
 
 bool MusicPlayer::openOutputDevice(void)
@@ -901,6 +911,15 @@ void MusicPlayer::customEvent(QEvent *event)
         else
             m_currentTime = oe->elapsedSeconds() - m_lastTrackStart;
 
+        // writtenBytes() is the output time in ms
+        if (m_spliceTime >= 0)
+        {
+            if ((int64_t)oe->writtenBytes() >= m_spliceTime)
+                gaplessTrackChange();
+        }
+        else
+            updateLookahead();
+
         if (m_playMode != PLAYMODE_RADIO && !m_updatedLastplay)
         {
             // we update the lastplay and playcount after playing
@@ -934,26 +953,19 @@ void MusicPlayer::customEvent(QEvent *event)
         }
         else
         {
-            if (m_playMode != PLAYMODE_RADIO && getCurrentMetadata() &&
-                m_currentTime != getCurrentMetadata()->Length() / 1000)
-            {
-                LOG(VB_GENERAL, LOG_NOTICE, QString("MusicPlayer: Updating track length was %1s, should be %2s")
-                    .arg(getCurrentMetadata()->Length() / 1000).arg(m_currentTime));
-
-                getCurrentMetadata()->setLength(m_currentTime * 1000);
-                getCurrentMetadata()->dumpToDatabase();
-
-                // this will update any track lengths displayed on screen
-                gPlayer->sendMetadataChangedEvent(getCurrentMetadata()->ID());
-
-                // this will force the playlist stats to update
-                MusicPlayerEvent me(MusicPlayerEvent::TrackChangeEvent, m_currentTrack);
-                dispatch(me);
-            }
+            checkTrackLength();
 
+            m_trackChangeTimer.start();
             nextAuto();
         }
     }
+    else if (event->type() == DecoderEvent::Spliced)
+    {
+        // the next track's decoder has taken over the output, the track
+        // starts once what is left of this one has played
+        if (getDecoder())
+            m_spliceTime = getDecoder()->getSpliceTime();
+    }
     else if (event->type() == DecoderEvent::Stopped)
     {
     }
@@ -969,6 +981,131 @@ void MusicPlayer::customEvent(QEvent *event)
     QObject::customEvent(event);
 }
 
+void MusicPlayer::checkTrackLength(void)
+{
+    if (m_playMode != PLAYMODE_RADIO && getCurrentMetadata() &&
+        m_currentTime != getCurrentMetadata()->Length() / 1000)
+    {
+        LOG(VB_GENERAL, LOG_NOTICE, QString("MusicPlayer: Updating track length was %1s, should be %2s")
+            .arg(getCurrentMetadata()->Length() / 1000).arg(m_currentTime));
+
+        getCurrentMetadata()->setLength(m_currentTime * 1000);
+        getCurrentMetadata()->dumpToDatabase();
+
+        // this will update any track lengths displayed on screen
+        gPlayer->sendMetadataChangedEvent(getCurrentMetadata()->ID());
+
+        // this will force the playlist stats to update
+        MusicPlayerEvent me(MusicPlayerEvent::TrackChangeEvent, m_currentTrack);
+        dispatch(me);
+    }
+}
+
+/// Starts opening the next track shortly before this one ends, so it can
+/// follow on without a gap
+void MusicPlayer::updateLookahead(void)
+{
+    if (!m_decoderHandler || !m_isPlaying || m_oneshotMetadata)
+        return;
+
+    MusicMetadata *current = getCurrentMetadata();
+    MusicMetadata *next = getNextMetadata();
+
+    // drop a lookahead the playlist, shuffle or repeat mode has changed under
+    if (m_decoderHandler->hasLookahead() &&
+        (!next || next->ID() != m_decoderHandler->getLookaheadMetadata().ID()))
+    {
+        m_decoderHandler->cancelLookahead();
+        m_lookaheadTried = false;
+    }
+
+    if (m_lookaheadTried || !current || !next ||
+        current->Length() / 1000 - m_currentTime > kLookaheadStart)
+        return;
+
+    m_lookaheadTried = true;
+
+    if (next->Filename() == METADATA_INVALID_FILENAME)
+        return;
+
+    Decoder *decoder = m_decoderHandler->prefetch(next, m_output);
+    if (!decoder)
+        return;
+
+    decoder->addListener(this);
+
+    // add any listeners to the decoder
+    {
+        QMutexLocker locker(m_lock);
+        QSet<QObject*>::const_iterator it = m_listeners.begin();
+        for (; it != m_listeners.end() ; ++it)
+        {
+            decoder->addListener(*it);
+        }
+    }
+
+    m_decoderHandler->startLookahead();
+}
+
+/// The track spliced on to the end of the last one has started playing,
+/// make it the current track as if it had been started the normal way
+void MusicPlayer::gaplessTrackChange(void)
+{
+    int64_t spliceTime = m_spliceTime;
+    m_spliceTime = -1;
+    m_lookaheadTried = false;
+
+    checkTrackLength();
+
+    if (!getCurrentPlaylist())
+    {
+        stop(true);
+        return;
+    }
+
+    if (!m_decoderHandler->splice())
+    {
+        nextAuto();
+        return;
+    }
+
+    // restart the output's clock at the start of the new track
+    getDecoder()->restartClock(spliceTime);
+
+    int trackPos = -1;
+    for (int x = 0; x < getCurrentPlaylist()->getTrackCount(); x++)
+    {
+        if (getCurrentPlaylist()->getSongAt(x)->ID() ==
+            getDecoderHandler()->getMetadata().ID())
+        {
+            trackPos = x;
+            break;
+        }
+    }
+
+    // the track was removed from the playlist while it was being opened
+    if (trackPos < 0)
+    {
+        next();
+        return;
+    }
+
+    changeCurrentTrack(trackPos);
+
+    LOG(VB_PLAYBACK, LOG_INFO,
+        QString("MusicPlayer: Gapless track change to %1")
+            .arg(getDecoderHandler()->getUrl().toString()));
+
+    m_currentTime = 0;
+    m_lastTrackStart = 0;
+    m_updatedLastplay = false;
+    m_errorCount = 0;
+
+    // tell any listeners we've started playing a new track
+    MusicPlayerEvent me(MusicPlayerEvent::TrackChangeEvent, m_currentTrack);
+    dispatch(me);
+}
+
 void MusicPlayer::getBufferStatus(int *bufferAvailable, int *bufferSize)
 {
     *bufferAvailable = m_bufferAvailable;
@@ -1132,6 +1269,11 @@ void MusicPlayer::restorePosition(void)
 
 void MusicPlayer::seek(int pos)
 {
+    // the last moments of a track whose decoder has already handed over to
+    // the next one can't be seeked in
+    if (m_spliceTime >= 0)
+        return;
+
     if (m_output)
     {
         if (getDecoder() && getDecoder()->isRunning())
@@ -1360,6 +1502,15 @@ void MusicPlayer::decSpeed()
     setSpeed(m_playSpeed);
 }
 
+/// Keeps the smart playlist index in step with a track's stats and tags
+void MusicPlayer::updateSongIndex(int trackID)
+{
+    if (!gMusicData->song_index)
+        return;
+
+    gMusicData->song_index->update(trackID);
+}
+
 void MusicPlayer::sendVolumeChangedEvent(void)
 {
     MusicPlayerEvent me(MusicPlayerEvent::VolumeChangeEvent, getVolume(), isMuted());
@@ -1368,12 +1519,16 @@ void MusicPlayer::sendVolumeChangedEvent(void)
 
 void MusicPlayer::sendMetadataChangedEvent(int trackID)
 {
+    updateSongIndex(trackID);
+
     MusicPlayerEvent me(MusicPlayerEvent::MetadataChangedEvent, trackID);
     dispatch(me);
 }
 
 void MusicPlayer::sendTrackStatsChangedEvent(int trackID)
 {
+    updateSongIndex(trackID);
+
     MusicPlayerEvent me(MusicPlayerEvent::TrackStatsChangedEvent, trackID);
     dispatch(me);
 }
@@ -1602,6 +1757,15 @@ void MusicPlayer::decoderHandlerReady(void)
 
         m_isPlaying = true;
         m_updatedLastplay = false;
+
+        if (m_trackChangeTimer.isValid())
+        {
+            LOG(VB_PLAYBACK, LOG_INFO,
+                QString("MusicPlayer: Started the next track %1 ms after the "
+                        "last one finished")
+                    .arg(m_trackChangeTimer.elapsed()));
+            m_trackChangeTimer.invalidate();
+        }
     }
     else
     {
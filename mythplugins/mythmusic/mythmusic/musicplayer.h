@@ -1,6 +1,9 @@
 #ifndef MUSICPLAYER_H_
 #define MUSICPLAYER_H_
 
+// qt
+#include <QElapsedTimer>
+
 // mythtv
 #include <mythdialogs.h>
 #include <audiooutput.h>
@@ -200,11 +203,15 @@ class MusicPlayer : public QObject, public MythObservable
     void updateLastplay(void);
     void updateVolatileMetadata(void);
     void sendVolumeChangedEvent(void);
+    void updateSongIndex(int trackID);
     int  getNotificationID(const QString &hostname);
     void sendNotification(int notificationID, const QString &title, const QString &author, const QString &desc);
 
     void setupDecoderHandler(void);
     void decoderHandlerReady(void);
+    void checkTrackLength(void);
+    void updateLookahead(void);
+    void gaplessTrackChange(void);
 
     int          m_currentTrack;
     int          m_currentTime;
@@ -246,6 +253,11 @@ class MusicPlayer : public QObject, public MythObservable
     int               m_bufferSize;
 
     int               m_errorCount;
+
+    // gapless playback
+    bool              m_lookaheadTried;
+    int64_t           m_spliceTime;
+    QElapsedTimer     m_trackChangeTimer;
 };
 
 Q_DECLARE_METATYPE(MusicPlayer::ResumeMode);
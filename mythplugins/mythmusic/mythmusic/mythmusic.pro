@@ -37,7 +37,7 @@ HEADERS += importmusic.h
 HEADERS += goom/filters.h goom/goomconfig.h goom/goom_core.h goom/graphic.h
 HEADERS += goom/ifs.h goom/lines.h goom/mythgoom.h goom/drawmethods.h
 HEADERS += goom/mmx.h goom/mathtools.h goom/tentacle3d.h goom/v3d.h
-HEADERS += editmetadata.h smartplaylist.h genres.h
+HEADERS += editmetadata.h smartplaylist.h genres.h songindex.h
 HEADERS += musicplayer.h miniplayer.h
 HEADERS += playlistcontainer.h musicdata.h
 HEADERS += musiccommon.h decoderhandler.h pls.h
@@ -57,7 +57,7 @@ SOURCES += genres.cpp importmusic.cpp
 SOURCES += goom/filters.c goom/goom_core.c goom/graphic.c goom/tentacle3d.c
 SOURCES += goom/ifs.c goom/ifs_display.c goom/lines.c goom/surf3d.c
 SOURCES += goom/zoom_filter_mmx.c goom/zoom_filter_xmmx.c goom/mythgoom.cpp
-SOURCES += avfdecoder.cpp editmetadata.cpp smartplaylist.cpp
+SOURCES += avfdecoder.cpp editmetadata.cpp smartplaylist.cpp songindex.cpp
 SOURCES += musicplayer.cpp miniplayer.cpp
 SOURCES += playlistcontainer.cpp musicdata.cpp
 SOURCES += musiccommon.cpp decoderhandler.cpp pls.cpp
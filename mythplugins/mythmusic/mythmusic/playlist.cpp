@@ -17,6 +17,7 @@ using namespace std;
 #include "playlistcontainer.h"
 #include "smartplaylist.h"
 #include "musicplayer.h"
+#include "songindex.h"
 
 // mythtv
 #include <mythcontext.h>
@@ -197,6 +198,17 @@ void Playlist::shuffleTracks(MusicPlayer::ShuffleMode shuffleMode)
             m_parent->FillIntelliWeights(RatingWeight, PlayCountWeight,
                                          LastPlayWeight, RandomWeight);
 
+            // the song index orders the playlist from its columns without
+            // looking up each track's metadata
+            if (gMusicData->song_index)
+            {
+                m_shuffledSongs = m_songs;
+                gMusicData->song_index->intelligentShuffle(
+                    m_shuffledSongs, RatingWeight, PlayCountWeight,
+                    LastPlayWeight);
+                break;
+            }
+
             // compute max/min playcount,lastplay for this playlist
             int playcountMin = 0;
             int playcountMax = 0;
@@ -943,6 +955,7 @@ void Playlist::fillSonglistFromSmartPlaylist(QString category, QString name,
 
     // get smartplaylist items
     QString whereClause = "WHERE ";
+    QList<SmartPLCriteriaRow> criteria;
 
     query.prepare("SELECT field, operator, value1, value2 "
                   "FROM music_smartplaylist_items "
@@ -957,6 +970,8 @@ void Playlist::fillSonglistFromSmartPlaylist(QString category, QString name,
             QString operatorName = query.value(1).toString();
             QString value1 = query.value(2).toString();
             QString value2 = query.value(3).toString();
+            criteria.append(SmartPLCriteriaRow(fieldName, operatorName,
+                                               value1, value2));
             if (!bFirst)
                 whereClause += matchType + getCriteriaSQL(fieldName,
                                            operatorName, value1, value2);
@@ -969,6 +984,18 @@ void Playlist::fillSonglistFromSmartPlaylist(QString category, QString name,
         }
     }
 
+    // try the song index first, it only needs the database for fields
+    // it doesn't hold
+    QList<int> songs;
+    if (gMusicData->song_index &&
+        gMusicData->song_index->evaluate(criteria, matchType == " OR ",
+                                         orderBy, limitTo, songs))
+    {
+        fillSonglistFromList(songs, removeDuplicates,
+                             insertOption, currentTrackID);
+        return;
+    }
+
     // add order by clause
     whereClause += getOrderBySQL(orderBy);
 
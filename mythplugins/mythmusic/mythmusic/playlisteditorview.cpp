@@ -21,6 +21,7 @@
 #include "musiccommon.h"
 #include "playlisteditorview.h"
 #include "smartplaylist.h"
+#include "songindex.h"
 #include "mainvisual.h"
 
 MusicGenericTree::MusicGenericTree(MusicGenericTree *parent,
@@ -1517,6 +1518,7 @@ void PlaylistEditorView::getSmartPlaylistTracks(MusicGenericTree *node, int play
 
     // get smartplaylist items
     QString whereClause = "WHERE ";
+    QList<SmartPLCriteriaRow> criteria;
 
     query.prepare("SELECT field, operator, value1, value2 "
                   "FROM music_smartplaylist_items "
@@ -1531,6 +1533,8 @@ void PlaylistEditorView::getSmartPlaylistTracks(MusicGenericTree *node, int play
             QString operatorName = query.value(1).toString();
             QString value1 = query.value(2).toString();
             QString value2 = query.value(3).toString();
+            criteria.append(SmartPLCriteriaRow(fieldName, operatorName,
+                                               value1, value2));
             if (!bFirst)
                 whereClause += matchType + getCriteriaSQL(fieldName,
                                            operatorName, value1, value2);
@@ -1543,42 +1547,61 @@ void PlaylistEditorView::getSmartPlaylistTracks(MusicGenericTree *node, int play
         }
     }
 
-    // add order by clause
-    whereClause += getOrderBySQL(orderBy);
+    // find the tracks for this smartplaylist, from the song index if it
+    // can evaluate it, otherwise from the database
+    QList<int> songs;
+    QStringList names;
 
-    // add limit
-    if (limitTo > 0)
-        whereClause +=  " LIMIT " + QString::number(limitTo);
-
-
-    // find the tracks for this smartplaylist
-    QString theQuery;
-
-    theQuery = "SELECT song_id, name FROM music_songs "
-               "LEFT JOIN music_directories ON"
-               " music_songs.directory_id=music_directories.directory_id "
-               "LEFT JOIN music_artists ON"
-               " music_songs.artist_id=music_artists.artist_id "
-               "LEFT JOIN music_albums ON"
-               " music_songs.album_id=music_albums.album_id "
-               "LEFT JOIN music_genres ON"
-               " music_songs.genre_id=music_genres.genre_id "
-               "LEFT JOIN music_artists AS music_comp_artists ON "
-               "music_albums.artist_id=music_comp_artists.artist_id ";
-    if (whereClause.length() > 0)
-      theQuery += whereClause;
-
-    if (!query.exec(theQuery))
+    if (gMusicData->song_index &&
+        gMusicData->song_index->evaluate(criteria, matchType == " OR ",
+                                         orderBy, limitTo, songs))
     {
-        MythDB::DBError("Load songlist from query", query);
-        return;
+        for (int x = 0; x < songs.size(); x++)
+            names.append(gMusicData->song_index->title(songs.at(x)));
+    }
+    else
+    {
+        // add order by clause
+        whereClause += getOrderBySQL(orderBy);
+
+        // add limit
+        if (limitTo > 0)
+            whereClause +=  " LIMIT " + QString::number(limitTo);
+
+        QString theQuery;
+
+        theQuery = "SELECT song_id, name FROM music_songs "
+                   "LEFT JOIN music_directories ON"
+                   " music_songs.directory_id=music_directories.directory_id "
+                   "LEFT JOIN music_artists ON"
+                   " music_songs.artist_id=music_artists.artist_id "
+                   "LEFT JOIN music_albums ON"
+                   " music_songs.album_id=music_albums.album_id "
+                   "LEFT JOIN music_genres ON"
+                   " music_songs.genre_id=music_genres.genre_id "
+                   "LEFT JOIN music_artists AS music_comp_artists ON "
+                   "music_albums.artist_id=music_comp_artists.artist_id ";
+        if (whereClause.length() > 0)
+          theQuery += whereClause;
+
+        if (!query.exec(theQuery))
+        {
+            MythDB::DBError("Load songlist from query", query);
+            return;
+        }
+
+        while (query.next())
+        {
+            songs.append(query.value(0).toInt());
+            names.append(query.value(1).toString());
+        }
     }
 
-    while (query.next())
+    for (int x = 0; x < songs.size(); x++)
     {
         MusicGenericTree *newnode =
-                new MusicGenericTree(node, query.value(1).toString(), "trackid");
-        newnode->setInt(query.value(0).toInt());
+                new MusicGenericTree(node, names.at(x), "trackid");
+        newnode->setInt(songs.at(x));
         newnode->setDrawArrow(false);
         bool hasTrack = gPlayer->getCurrentPlaylist() ? gPlayer->getCurrentPlaylist()->checkTrack(newnode->getInt()) : false;
         newnode->setCheck( hasTrack ? MythUIButtonListItem::FullChecked : MythUIButtonListItem::NotChecked);
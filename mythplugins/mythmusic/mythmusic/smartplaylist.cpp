@@ -27,6 +27,7 @@ using namespace std;
 // mythmusic
 #include "musicdata.h"
 #include "smartplaylist.h"
+#include "songindex.h"
 #include "musiccommon.h"
 
 struct SmartPLField
@@ -117,7 +118,7 @@ QString formattedFieldValue(const QVariant &value)
     return result;
 }
 
-static QString evaluateDateValue(QString sDate)
+QString evaluateDateValue(QString sDate)
 {
     if (sDate.startsWith("$DATE"))
     {
@@ -727,6 +728,32 @@ void SmartPlaylistEditor::titleChanged(void)
 }
 
 void SmartPlaylistEditor::updateMatches(void)
+{
+    m_matchesCount = 0;
+
+    QList<SmartPLCriteriaRow> criteria;
+    for (int x = 0; x < m_criteriaRows.size(); x++)
+        criteria.append(*m_criteriaRows.at(x));
+
+    QList<int> songs;
+    if (gMusicData->song_index &&
+        gMusicData->song_index->evaluate(criteria,
+                                         m_matchSelector->GetValue() == tr("Any"),
+                                         QString(), 0, songs))
+    {
+        m_matchesCount = songs.size();
+    }
+    else
+        m_matchesCount = countMatchesFromDB();
+
+    m_matchesText->SetText(QString::number(m_matchesCount));
+
+    m_playlistIsValid = (m_criteriaRows.size() > 0);
+    m_showResultsButton->SetEnabled((m_matchesCount > 0));
+    titleChanged();
+}
+
+int SmartPlaylistEditor::countMatchesFromDB(void)
 {
     QString sql =
         "SELECT count(*) "
@@ -740,19 +767,13 @@ void SmartPlaylistEditor::updateMatches(void)
 
     sql += getWhereClause();
 
-    m_matchesCount = 0;
-
     MSqlQuery query(MSqlQuery::InitCon());
     if (!query.exec(sql))
         MythDB::DBError("SmartPlaylistEditor::updateMatches", query);
     else if (query.next())
-        m_matchesCount = query.value(0).toInt();
+        return query.value(0).toInt();
 
-    m_matchesText->SetText(QString::number(m_matchesCount));
-
-    m_playlistIsValid = (m_criteriaRows.size() > 0);
-    m_showResultsButton->SetEnabled((m_matchesCount > 0));
-    titleChanged();
+    return 0;
 }
 
 void SmartPlaylistEditor::saveClicked(void)
@@ -33,6 +33,9 @@ QString getCriteriaSQL(QString fieldName, QString operatorName,
 QString getSQLFieldName(QString orderBy);
 QString getOrderBySQL(QString orderByFields);
 
+// used by songindex.cpp
+QString evaluateDateValue(QString sDate);
+
 // used by playbackbox.cpp
 QString formattedFieldValue(const QVariant &value);
 
@@ -121,6 +124,7 @@ class SmartPlaylistEditor : public MythScreenType
   private:
     void getSmartPlaylistCategories(void);
     void loadFromDatabase(QString category, QString name);
+    int  countMatchesFromDB(void);
 
     QList<SmartPLCriteriaRow*> m_criteriaRows;
     SmartPLCriteriaRow* m_tempCriteriaRow;
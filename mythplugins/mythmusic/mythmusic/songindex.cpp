@@ -0,0 +1,786 @@
+// c/c++
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+// qt
+#include <QElapsedTimer>
+#include <QRegExp>
+
+// mythtv
+#include <mythlogging.h>
+#include <mythdb.h>
+#include <mythdbcon.h>
+#include <musicmetadata.h>
+
+// mythmusic
+#include "songindex.h"
+
+#define LOC QString("SongIndex: ")
+
+/// A NULL in one of the numeric columns, which sorts first as it does in SQL
+static const int kNull = INT_MIN;
+
+/// QDate::toJulianDay() less this is what MySQL's TO_DAYS() gives
+static const int kToDaysOffset = 1721060;
+
+/// The columns the index holds, joined the way the smart playlist queries
+/// join them
+static const char *kSongIndexQuery =
+    "SELECT music_songs.song_id, music_artists.artist_name, "
+    "music_comp_artists.artist_name, music_albums.album_name, "
+    "music_songs.name, music_genres.genre, music_songs.year, "
+    "music_songs.track, music_songs.rating, music_songs.numplays, "
+    "music_albums.compilation, TO_DAYS(music_songs.lastplay), "
+    "music_songs.lastplay "
+    "FROM music_songs "
+    "LEFT JOIN music_artists ON"
+    " music_songs.artist_id=music_artists.artist_id "
+    "LEFT JOIN music_albums ON"
+    " music_songs.album_id=music_albums.album_id "
+    "LEFT JOIN music_genres ON"
+    " music_songs.genre_id=music_genres.genre_id "
+    "LEFT JOIN music_artists AS music_comp_artists ON"
+    " music_albums.artist_id=music_comp_artists.artist_id ";
+
+enum SongIndexOperator
+{
+    opEqual = 0,
+    opNotEqual,
+    opGreater,
+    opLess,
+    opStartsWith,
+    opEndsWith,
+    opContains,
+    opNotContains,
+    opBetween,
+    opSet,
+    opNotSet,
+    opUnknown
+};
+
+static SongIndexOperator lookupOperator(const QString &name)
+{
+    static const char *names[] =
+    {
+        "is equal to", "is not equal to", "is greater than", "is less than",
+        "starts with", "ends with", "contains", "does not contain",
+        "is between", "is set", "is not set"
+    };
+
+    for (int x = 0; x < (int)opUnknown; x++)
+    {
+        if (name == names[x])
+            return (SongIndexOperator)x;
+    }
+    return opUnknown;
+}
+
+/// Marks the values in \p col that satisfy \p op, which must not be one
+/// of the text operators. These are plain loops over arrays so the
+/// compiler can vectorise them.
+static void scanInts(const int *col, int n, SongIndexOperator op,
+                     int a, int b, uchar *out)
+{
+    int i;
+
+    switch (op)
+    {
+        case opEqual:
+            for (i = 0; i < n; i++)
+                out[i] = col[i] == a;
+            break;
+        case opNotEqual:
+            for (i = 0; i < n; i++)
+                out[i] = col[i] != a;
+            break;
+        case opGreater:
+            for (i = 0; i < n; i++)
+                out[i] = col[i] > a;
+            break;
+        case opLess:
+            for (i = 0; i < n; i++)
+                out[i] = col[i] < a;
+            break;
+        case opBetween:
+            for (i = 0; i < n; i++)
+                out[i] = (col[i] >= a) & (col[i] <= b);
+            break;
+        default:
+            memset(out, 0, n);
+            break;
+    }
+}
+
+/** \brief Returns the key a value is compared by under utf8_general_ci.
+ *
+ *  That collation gives each character the weight of the upper case of its
+ *  base letter, so "é", "E" and "e" are equal, and "ß" equals "s". With
+ *  \p padSpace trailing spaces are dropped, as they are for = and < but
+ *  not for LIKE.
+ */
+static QString collationKey(const QString &value, bool padSpace)
+{
+    QString key;
+    key.reserve(value.size());
+
+    for (int x = 0; x < value.size(); x++)
+    {
+        QChar c = value.at(x);
+        if (c.decompositionTag() == QChar::Canonical)
+            c = c.decomposition().at(0);
+        if (c.unicode() == 0xDF)
+            c = QChar('s');
+        key.append(c.toUpper());
+    }
+
+    if (padSpace)
+    {
+        int end = key.size();
+        while (end > 0 && key.at(end - 1) == QChar(' '))
+            end--;
+        key.truncate(end);
+    }
+
+    return key;
+}
+
+/// Whether the folding in collationKey() is known to match the collation
+/// for every character of \p value, which is true of the Latin scripts
+static bool isFoldable(const QString &value)
+{
+    for (int x = 0; x < value.size(); x++)
+    {
+        if (value.at(x).unicode() > 0x024F)
+            return false;
+    }
+    return true;
+}
+
+/// Whether a non-NULL text value satisfies \p op, as SQL would see it.
+/// \p value and \p a and \p b are all collation keys, the padded form for
+/// the comparisons and the unpadded form for LIKE.
+static bool matchText(const QString &value, const QString &padded,
+                      SongIndexOperator op, const QString &a,
+                      const QString &b)
+{
+    switch (op)
+    {
+        case opSet:
+            return true;
+        case opNotSet:
+            return false;
+        case opEqual:
+            return padded == a;
+        case opNotEqual:
+            return padded != a;
+        case opGreater:
+            return padded > a;
+        case opLess:
+            return padded < a;
+        case opStartsWith:
+            return value.startsWith(a);
+        case opEndsWith:
+            return value.endsWith(a);
+        case opContains:
+            return value.contains(a);
+        case opNotContains:
+            return !value.contains(a);
+        case opBetween:
+            return padded >= a && padded <= b;
+        default:
+            return false;
+    }
+}
+
+/// Orders dictionary codes by the collation keys of their values
+class TextLess
+{
+  public:
+    explicit TextLess(const QStringList &keys) : m_keys(keys) {}
+    bool operator()(int a, int b) const
+    {
+        return m_keys.at(a) < m_keys.at(b);
+    }
+  private:
+    const QStringList &m_keys;
+};
+
+/// Orders rows by a list of sort keys, as ORDER BY would
+class KeysLess
+{
+  public:
+    KeysLess(const QList<QVector<int> > &keys, const QList<bool> &descending)
+        : m_keys(keys), m_descending(descending) {}
+    bool operator()(int a, int b) const
+    {
+        for (int k = 0; k < m_keys.size(); k++)
+        {
+            int ka = m_keys.at(k).at(a), kb = m_keys.at(k).at(b);
+            if (ka != kb)
+                return m_descending.at(k) ? ka > kb : ka < kb;
+        }
+        return false;
+    }
+  private:
+    const QList<QVector<int> > &m_keys;
+    const QList<bool>          &m_descending;
+};
+
+/// Orders rows by a double key, smallest first
+class DoubleLess
+{
+  public:
+    explicit DoubleLess(const QVector<double> &keys) : m_keys(keys) {}
+    bool operator()(int a, int b) const
+    {
+        return m_keys.at(a) < m_keys.at(b);
+    }
+  private:
+    const QVector<double> &m_keys;
+};
+
+int SongIndex::Dictionary::code(const QVariant &value)
+{
+    if (value.isNull())
+        return 0;
+
+    QString text = value.toString();
+    QHash<QString, int>::const_iterator it = lookup.constFind(text);
+    if (it != lookup.constEnd())
+        return it.value();
+
+    int c = values.size();
+    values.append(text);
+    keys.append(collationKey(text, false));
+    padded.append(collationKey(text, true));
+    lookup.insert(text, c);
+    return c;
+}
+
+void SongIndex::Dictionary::clear(void)
+{
+    codes.clear();
+    values.clear();
+    keys.clear();
+    padded.clear();
+    lookup.clear();
+
+    // reserve code 0 for NULL
+    values.append(QString());
+    keys.append(QString());
+    padded.append(QString());
+}
+
+/// Rebuilds the index from all the tracks in the database
+void SongIndex::rebuild(void)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_ids.clear();
+    m_rows.clear();
+    m_year.clear();
+    m_track.clear();
+    m_rating.clear();
+    m_playCount.clear();
+    m_compilation.clear();
+    m_lastPlayDay.clear();
+    m_lastPlayTime.clear();
+    m_present.clear();
+    m_artist.clear();
+    m_compArtist.clear();
+    m_album.clear();
+    m_title.clear();
+    m_genre.clear();
+
+    // Rows are kept in song_id order, the order the database would give
+    // them in if a smart playlist has no order of its own
+    MSqlQuery query(MSqlQuery::InitCon());
+    if (!query.exec(QString(kSongIndexQuery) + "ORDER BY music_songs.song_id"))
+    {
+        MythDB::DBError("SongIndex::rebuild", query);
+        return;
+    }
+
+    int n = query.size();
+    if (n > 0)
+    {
+        m_ids.reserve(n);
+        m_year.reserve(n);
+        m_track.reserve(n);
+        m_rating.reserve(n);
+        m_playCount.reserve(n);
+        m_compilation.reserve(n);
+        m_lastPlayDay.reserve(n);
+        m_lastPlayTime.reserve(n);
+        m_present.reserve(n);
+    }
+
+    while (query.next())
+    {
+        MusicMetadata::IdType id = query.value(0).toUInt();
+        int row = m_ids.size();
+        m_ids.append(id);
+        m_rows.insert(id, row);
+        appendRow();
+        setRow(row, query);
+    }
+
+    LOG(VB_GENERAL, LOG_INFO, LOC + QString("Indexed %1 tracks in %2 ms")
+        .arg(m_ids.size()).arg(timer.elapsed()));
+}
+
+/// Rereads a track from the database, adding it to the index if it is new
+void SongIndex::update(MusicMetadata::IdType trackID)
+{
+    if (ID_TO_REPO(trackID) != RT_Database)
+        return;
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare(QString(kSongIndexQuery) +
+                  "WHERE music_songs.song_id = :ID");
+    query.bindValue(":ID", trackID);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("SongIndex::update", query);
+        return;
+    }
+
+    int row = m_rows.value(trackID, -1);
+
+    if (!query.next())
+    {
+        if (row >= 0)
+            m_present[row] = 0;
+        return;
+    }
+
+    if (row < 0)
+    {
+        row = m_ids.size();
+        m_ids.append(trackID);
+        m_rows.insert(trackID, row);
+        appendRow();
+    }
+
+    setRow(row, query);
+}
+
+void SongIndex::appendRow(void)
+{
+    m_year.append(kNull);
+    m_track.append(kNull);
+    m_rating.append(kNull);
+    m_playCount.append(kNull);
+    m_compilation.append(kNull);
+    m_lastPlayDay.append(kNull);
+    m_lastPlayTime.append(0.0);
+    m_present.append(1);
+    m_artist.codes.append(0);
+    m_compArtist.codes.append(0);
+    m_album.codes.append(0);
+    m_title.codes.append(0);
+    m_genre.codes.append(0);
+}
+
+static int intValue(const QVariant &value)
+{
+    return value.isNull() ? kNull : value.toInt();
+}
+
+void SongIndex::setRow(int row, const MSqlQuery &query)
+{
+    m_artist.codes[row] = m_artist.code(query.value(1));
+    m_compArtist.codes[row] = m_compArtist.code(query.value(2));
+    m_album.codes[row] = m_album.code(query.value(3));
+    m_title.codes[row] = m_title.code(query.value(4));
+    m_genre.codes[row] = m_genre.code(query.value(5));
+
+    m_year[row] = intValue(query.value(6));
+    m_track[row] = intValue(query.value(7));
+    m_rating[row] = intValue(query.value(8));
+    m_playCount[row] = intValue(query.value(9));
+    m_compilation[row] = intValue(query.value(10));
+
+    // TO_DAYS() is NULL for a zero date, as the query would see it
+    m_lastPlayDay[row] = intValue(query.value(11));
+    m_lastPlayTime[row] = query.value(12).toDateTime().toTime_t();
+
+    m_present[row] = 1;
+}
+
+/// The track's name, as music_songs holds it
+QString SongIndex::title(MusicMetadata::IdType trackID) const
+{
+    int row = m_rows.value(trackID, -1);
+    if (row < 0)
+        return QString();
+
+    return m_title.values.at(m_title.codes.at(row));
+}
+
+const QVector<int> *SongIndex::intColumn(const QString &field) const
+{
+    if (field == "Year")
+        return &m_year;
+    if (field == "Track No.")
+        return &m_track;
+    if (field == "Rating")
+        return &m_rating;
+    if (field == "Play Count")
+        return &m_playCount;
+    if (field == "Compilation")
+        return &m_compilation;
+    if (field == "Last Play")
+        return &m_lastPlayDay;
+    return NULL;
+}
+
+const SongIndex::Dictionary *SongIndex::textColumn(const QString &field) const
+{
+    if (field == "Artist")
+        return &m_artist;
+    if (field == "Comp. Artist")
+        return &m_compArtist;
+    if (field == "Album")
+        return &m_album;
+    if (field == "Title")
+        return &m_title;
+    if (field == "Genre")
+        return &m_genre;
+    return NULL;
+}
+
+/// Marks the rows matching one criteria row. Returns false if it can't be
+/// evaluated here and needs to go to the database.
+bool SongIndex::match(const SmartPLCriteriaRow &criteria,
+                      QVector<uchar> &matched) const
+{
+    SongIndexOperator op = lookupOperator(criteria.Operator);
+    if (op == opUnknown)
+        return false;
+
+    int n = m_ids.size();
+    matched.resize(n);
+
+    const Dictionary *text = textColumn(criteria.Field);
+    if (text)
+    {
+        // LIKE treats these specially
+        static const QRegExp wildcards("[%_\\\\]");
+        bool like = (op >= opStartsWith && op <= opNotContains);
+        if (like && criteria.Value1.contains(wildcards))
+            return false;
+
+        if (!isFoldable(criteria.Value1) || !isFoldable(criteria.Value2))
+            return false;
+
+        QString a = collationKey(criteria.Value1, !like);
+        QString b = collationKey(criteria.Value2, true);
+
+        // Test each distinct value once, then look the rows up. Nothing
+        // but IS NULL is true of a NULL.
+        QVector<uchar> hit(text->values.size());
+        hit[0] = (op == opNotSet);
+        for (int c = 1; c < text->values.size(); c++)
+            hit[c] = matchText(text->keys.at(c), text->padded.at(c), op, a, b);
+
+        const int *codes = text->codes.constData();
+        const uchar *hits = hit.constData();
+        uchar *out = matched.data();
+        for (int i = 0; i < n; i++)
+            out[i] = hits[codes[i]];
+
+        return true;
+    }
+
+    const QVector<int> *column = intColumn(criteria.Field);
+    if (!column)
+        return false;
+
+    if (op >= opStartsWith && op <= opNotContains)
+        return false;
+
+    const int *col = column->constData();
+    uchar *out = matched.data();
+
+    if (op == opSet || op == opNotSet)
+    {
+        uchar set = (op == opSet);
+        for (int i = 0; i < n; i++)
+            out[i] = (col[i] != kNull) == set;
+        return true;
+    }
+
+    int values[2] = { 0, 0 };
+    QString text1 = criteria.Value1, text2 = criteria.Value2;
+    int count = (op == opBetween) ? 2 : 1;
+
+    for (int x = 0; x < count; x++)
+    {
+        QString value = x ? text2 : text1;
+        bool ok = true;
+
+        if (column == &m_compilation)
+        {
+            values[x] = (value == "Yes") ? 1 : 0;
+        }
+        else if (column == &m_lastPlayDay)
+        {
+            QDate date = QDate::fromString(evaluateDateValue(value),
+                                           Qt::ISODate);
+            ok = date.isValid();
+            values[x] = date.toJulianDay() - kToDaysOffset;
+        }
+        else
+        {
+            values[x] = value.trimmed().toInt(&ok);
+        }
+
+        if (!ok)
+            return false;
+    }
+
+    scanInts(col, n, op, values[0], values[1], out);
+
+    // Comparisons with NULL are never true
+    for (int i = 0; i < n; i++)
+        out[i] &= (col[i] != kNull);
+
+    return true;
+}
+
+/** \brief Finds the tracks a smart playlist selects.
+ *
+ *  \param criteria the playlist's criteria rows
+ *  \param matchAny true for "Any", false for "All"
+ *  \param orderBy  the playlist's order by setting, e.g. "Artist (A), Year (D)"
+ *  \param limitTo  the most tracks to return, or 0 for no limit
+ *  \param songs    filled with the IDs of the matching tracks, in order
+ *  \return false if the playlist uses a field the index doesn't hold,
+ *          in which case the caller should ask the database
+ */
+bool SongIndex::evaluate(const QList<SmartPLCriteriaRow> &criteria,
+                         bool matchAny, const QString &orderBy, int limitTo,
+                         QList<int> &songs) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int n = m_ids.size();
+    if (n == 0)
+        return false;
+
+    QVector<uchar> result(n, matchAny ? 0 : 1);
+    QVector<uchar> matched;
+    bool any = false;
+
+    for (int x = 0; x < criteria.size(); x++)
+    {
+        // the database skips these too
+        if (getSQLFieldName(criteria.at(x).Field).isEmpty())
+            continue;
+
+        if (!match(criteria.at(x), matched))
+            return false;
+
+        uchar *res = result.data();
+        const uchar *m = matched.constData();
+        if (matchAny)
+        {
+            for (int i = 0; i < n; i++)
+                res[i] |= m[i];
+        }
+        else
+        {
+            for (int i = 0; i < n; i++)
+                res[i] &= m[i];
+        }
+        any = true;
+    }
+
+    if (!any)
+        result.fill(1);
+
+    // tracks that have gone from the database since the index was built
+    const uchar *present = m_present.constData();
+    uchar *res = result.data();
+    for (int i = 0; i < n; i++)
+        res[i] &= present[i];
+
+    QVector<int> rows;
+    rows.reserve(n);
+    for (int i = 0; i < n; i++)
+    {
+        if (result.at(i))
+            rows.append(i);
+    }
+
+    // Build a sort key per matching row for each order by field
+    QList<QVector<int> > keys;
+    QList<bool> descending;
+    QStringList orderFields = orderBy.split(",", QString::SkipEmptyParts);
+    for (int x = 0; x < orderFields.size(); x++)
+    {
+        QString fieldName = orderFields.at(x).trimmed();
+        QString field = fieldName.left(fieldName.length() - 4);
+        if (getSQLFieldName(field).isEmpty())
+            continue;
+
+        QVector<int> key(rows.size());
+
+        const QVector<int> *column = intColumn(field);
+        const Dictionary *text = textColumn(field);
+        if (column)
+        {
+            for (int r = 0; r < rows.size(); r++)
+                key[r] = column->at(rows.at(r));
+        }
+        else if (text)
+        {
+            // rank the distinct values once and sort on the rank, equal
+            // keys get equal ranks and NULL, code 0, sorts first
+            const QStringList &sortKeys = text->padded;
+
+            QVector<int> order(text->values.size() - 1);
+            for (int c = 0; c < order.size(); c++)
+                order[c] = c + 1;
+            stable_sort(order.begin(), order.end(), TextLess(sortKeys));
+
+            QVector<int> rank(text->values.size());
+            rank[0] = 0;
+            for (int c = 0; c < order.size(); c++)
+            {
+                bool tied = c > 0 &&
+                    sortKeys.at(order.at(c)) == sortKeys.at(order.at(c - 1));
+                rank[order.at(c)] = tied ? rank[order.at(c - 1)] : c + 1;
+            }
+
+            for (int r = 0; r < rows.size(); r++)
+                key[r] = rank.at(text->codes.at(rows.at(r)));
+        }
+        else
+            return false;
+
+        keys.append(key);
+        descending.append(fieldName.right(3) == "(D)");
+    }
+
+    QVector<int> order(rows.size());
+    for (int r = 0; r < order.size(); r++)
+        order[r] = r;
+
+    if (!keys.isEmpty())
+    {
+        stable_sort(order.begin(), order.end(), KeysLess(keys, descending));
+    }
+
+    if (limitTo > 0 && order.size() > limitTo)
+        order.resize(limitTo);
+
+    songs.clear();
+    for (int r = 0; r < order.size(); r++)
+        songs.append(m_ids.at(rows.at(order.at(r))));
+
+    LOG(VB_GENERAL, LOG_DEBUG, LOC +
+        QString("Evaluated %1 criteria over %2 tracks in %3 us, %4 matches")
+            .arg(criteria.size()).arg(n)
+            .arg(timer.nsecsElapsed() / 1000).arg(songs.size()));
+
+    return true;
+}
+
+/** \brief Orders \p songs for the intelligent shuffle.
+ *
+ *  Tracks are weighted by rating, play count and how long ago they were
+ *  last played, and the weight of each is divided between the tracks that
+ *  share its rating. The order is a weighted random sample of all the
+ *  tracks, drawn by giving each a random key of u^(1/weight) and sorting
+ *  on it. Tracks the index doesn't hold, such as CD tracks, go first.
+ */
+void SongIndex::intelligentShuffle(QList<MusicMetadata::IdType> &songs,
+                                   int ratingWeight, int playCountWeight,
+                                   int lastPlayWeight) const
+{
+    QList<MusicMetadata::IdType> unindexed;
+    QVector<int> rows;
+    rows.reserve(songs.size());
+
+    for (int x = 0; x < songs.size(); x++)
+    {
+        int row = m_rows.value(songs.at(x), -1);
+        if (row < 0)
+            unindexed.append(songs.at(x));
+        else
+            rows.append(row);
+    }
+
+    int n = rows.size();
+    if (n == 0)
+        return;
+
+    // Gather the columns for this playlist so the rest are straight scans
+    QVector<int> rating(n), playCount(n);
+    QVector<double> lastPlay(n);
+    for (int i = 0; i < n; i++)
+    {
+        rating[i] = max(m_rating.at(rows.at(i)), 0);
+        playCount[i] = max(m_playCount.at(rows.at(i)), 0);
+        lastPlay[i] = m_lastPlayTime.at(rows.at(i));
+    }
+
+    int playCountMin = playCount[0], playCountMax = playCount[0];
+    double lastPlayMin = lastPlay[0], lastPlayMax = lastPlay[0];
+    int ratingMax = 0;
+    for (int i = 0; i < n; i++)
+    {
+        playCountMin = min(playCountMin, playCount[i]);
+        playCountMax = max(playCountMax, playCount[i]);
+        lastPlayMin = min(lastPlayMin, lastPlay[i]);
+        lastPlayMax = max(lastPlayMax, lastPlay[i]);
+        ratingMax = max(ratingMax, rating[i]);
+    }
+
+    QVector<int> ratingCounts(ratingMax + 1, 0);
+    for (int i = 0; i < n; i++)
+        ratingCounts[max(rating[i], 0)]++;
+
+    double playCountRange = playCountMax - playCountMin;
+    double lastPlayRange = lastPlayMax - lastPlayMin;
+    int totalWeight = ratingWeight + playCountWeight + lastPlayWeight;
+    if (totalWeight <= 0)
+        totalWeight = 1;
+
+    QVector<double> keys(n);
+    for (int i = 0; i < n; i++)
+    {
+        double ratingValue = rating[i] / 10.0;
+        double playCountValue = playCountRange == 0 ? 0 :
+            (playCountMin - (double)playCount[i]) / playCountRange + 1;
+        double lastPlayValue = lastPlayRange == 0 ? 0 :
+            (lastPlayMin - lastPlay[i]) / lastPlayRange + 1;
+
+        double weight = (ratingWeight * ratingValue +
+                         playCountWeight * playCountValue +
+                         lastPlayWeight * lastPlayValue) / totalWeight;
+        weight /= ratingCounts[max(rating[i], 0)];
+
+        // -log(u) / weight orders the same as u^(1/weight), reversed
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+        keys[i] = (weight > 0) ? -log(u) / weight : HUGE_VAL;
+    }
+
+    QVector<int> order(n);
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), DoubleLess(keys));
+
+    songs = unindexed;
+    for (int i = 0; i < n; i++)
+        songs.append(m_ids.at(rows.at(order.at(i))));
+}
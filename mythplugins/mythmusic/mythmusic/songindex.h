@@ -0,0 +1,94 @@
+#ifndef SONGINDEX_H_
+#define SONGINDEX_H_
+
+// qt
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include <QVariant>
+
+// mythtv
+#include <musicmetadata.h>
+
+// mythmusic
+#include "smartplaylist.h"
+
+class MSqlQuery;
+
+/** \class SongIndex
+ *  \brief The fields of every track that smart playlists and the
+ *         intelligent shuffle look at, held a column per field.
+ *
+ *  A smart playlist is evaluated by scanning the columns its criteria use,
+ *  rather than by a query joining music_songs to four other tables. The
+ *  columns are read with the same joins, so they hold what the query would
+ *  see, NULLs included, and text is compared the way the utf8_general_ci
+ *  collation compares it. Anything the index can't answer exactly is left
+ *  to the database.
+ *
+ *  The index is built when the music is loaded and each track is reread as
+ *  it is played, rated or edited. It is only used from the UI thread.
+ */
+class SongIndex
+{
+  public:
+    SongIndex(void) {}
+
+    void rebuild(void);
+    void update(MusicMetadata::IdType trackID);
+
+    int count(void) const { return m_ids.size(); }
+    QString title(MusicMetadata::IdType trackID) const;
+
+    bool evaluate(const QList<SmartPLCriteriaRow> &criteria, bool matchAny,
+                  const QString &orderBy, int limitTo,
+                  QList<int> &songs) const;
+
+    void intelligentShuffle(QList<MusicMetadata::IdType> &songs,
+                            int ratingWeight, int playCountWeight,
+                            int lastPlayWeight) const;
+
+  private:
+    /// A text field, stored as a code for each of its distinct values.
+    /// Code 0 is NULL.
+    struct Dictionary
+    {
+        QVector<int>        codes;
+        QStringList         values;
+        QStringList         keys;    ///< collation keys, as LIKE sees them
+        QStringList         padded;  ///< collation keys, as = and < see them
+        QHash<QString, int> lookup;
+
+        Dictionary(void) { clear(); }
+
+        int code(const QVariant &value);
+        void clear(void);
+    };
+
+    void appendRow(void);
+    void setRow(int row, const MSqlQuery &query);
+    bool match(const SmartPLCriteriaRow &criteria,
+               QVector<uchar> &matched) const;
+    const QVector<int> *intColumn(const QString &field) const;
+    const Dictionary *textColumn(const QString &field) const;
+
+    QVector<MusicMetadata::IdType> m_ids;
+    QHash<MusicMetadata::IdType, int> m_rows;
+
+    QVector<int>    m_year;
+    QVector<int>    m_track;
+    QVector<int>    m_rating;
+    QVector<int>    m_playCount;
+    QVector<int>    m_compilation;
+    QVector<int>    m_lastPlayDay;  ///< TO_DAYS() of the last play
+    QVector<double> m_lastPlayTime; ///< as the intelligent shuffle sees it
+    QVector<uchar>  m_present;      ///< 0 once a track has left the database
+
+    Dictionary      m_artist;
+    Dictionary      m_compArtist;
+    Dictionary      m_album;
+    Dictionary      m_title;
+    Dictionary      m_genre;
+};
+
+#endif
@@ -13,6 +13,7 @@
 // C
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 
 // C++
 #include <iostream>
@@ -31,6 +32,10 @@ using namespace std;
 #include "mainvisual.h"
 #include "synaesthesia.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 Synaesthesia::Synaesthesia(void) :
     m_size(0,0),
 
@@ -52,7 +57,6 @@ Synaesthesia::Synaesthesia(void) :
 {
     m_fps = 29;
 
-    coreInit();              // init cosTable, negSinTable, bitReverse
     setStarSize(m_starSize); // init scaleDown, maxStarRadius
     setupPalette();          // init palette
 }
@@ -174,43 +178,6 @@ void Synaesthesia::resize(const QSize &newsize)
 #endif
 }
 
-int Synaesthesia::bitReverser(int i)
-{
-    int sum = 0;
-    for (int j = 0; j < LogSize; j++)
-    {
-        sum = (i & 1) + sum * 2;
-        i >>= 1;
-    }
-    
-    return sum;
-}
-
-void Synaesthesia::fft(double *x, double *y)
-{
-    int n2 = NumSamples, n1;
-    for (int twoToTheK = 1; twoToTheK < NumSamples; twoToTheK *= 2)
-    {
-        n1 = n2;
-        n2 /= 2;
-        for (int j = 0; j < n2; j++)
-        {
-            double c = m_cosTable[j * twoToTheK & (NumSamples - 1)],
-                   s = m_negSinTable[j * twoToTheK & (NumSamples - 1)];
-            for (int i = j; i < NumSamples; i += n1)
-            {
-                int l = i + n2;
-                double xt = x[i] - x[l];
-                x[i] = (x[i] + x[l]);
-                double yt = y[i] - y[l];
-                y[i] = (y[i] + y[l]);
-                x[l] = xt * c - yt * s;
-                y[l] = xt * s + yt * c;
-            }
-        }
-    }
-}
-
 void Synaesthesia::setStarSize(double lsize)
 {
     double fadeModeFudge = (m_fadeMode == Wave ? 0.4 :
@@ -233,16 +200,6 @@ void Synaesthesia::setStarSize(double lsize)
         m_maxStarRadius++;
 }
 
-void Synaesthesia::coreInit(void)
-{
-    for (int i = 0; i < NumSamples; i++)
-    {
-        m_negSinTable[i] = -sin(3.141592 * 2.0 / NumSamples * i);
-        m_cosTable[i] = cos(3.141592 * 2.0 / NumSamples * i);
-        m_bitReverse[i] = bitReverser(i);
-    }
-}
-
 #define output ((unsigned char*)m_outputBmp.data)
 #define lastOutput ((unsigned char*)m_lastOutputBmp.data)
 #define lastLastOutput ((unsigned char*)m_lastLastOutputBmp.data)
@@ -285,8 +242,30 @@ unsigned char Synaesthesia::getPixel(int x, int y, int where)
 
 void Synaesthesia::fadeFade(void)
 {
+    int i = m_outWidth * m_outHeight * 2;
+
+#ifdef __SSE2__
+    // The same as below, sixteen pixels at a time. Masking before the
+    // shift keeps bits from moving between bytes.
+    const __m128i mask4 = _mm_set1_epi8((char)0xf0);
+    const __m128i mask5 = _mm_set1_epi8((char)0xe0);
+    __m128i *vec = (__m128i *)output;
+    for (; i >= 16; i -= 16, vec++)
+    {
+        __m128i x = _mm_loadu_si128(vec);
+        __m128i a = _mm_srli_epi16(_mm_and_si128(x, mask4), 4);
+        __m128i b = _mm_srli_epi16(_mm_and_si128(x, mask5), 5);
+        _mm_storeu_si128(vec, _mm_sub_epi8(_mm_sub_epi8(x, a), b));
+    }
+    register uint32_t *ptr = (uint32_t *)vec;
+#else
     register uint32_t *ptr = (uint32_t *)output;
-    int i = m_outWidth * m_outHeight * 2 / sizeof(uint32_t);
+#endif
+
+    i /= sizeof(uint32_t);
+    if (i <= 0)
+        return;
+
     do {
         uint32_t x = *ptr;
         if (x)
@@ -297,6 +276,77 @@ void Synaesthesia::fadeFade(void)
     } while (--i > 0);
 }
 
+#ifdef __SSE2__
+static inline __m128i fadeLanes(__m128i left, __m128i right, __m128i up,
+                                __m128i down, __m128i cur, __m128i prev,
+                                bool heat)
+{
+    __m128i j = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(left, right),
+                                             _mm_add_epi16(up, down)), 2);
+    j = _mm_sub_epi16(_mm_add_epi16(j, cur), prev);
+    j = _mm_sub_epi16(j, _mm_set1_epi16(1));
+    if (heat)
+        j = _mm_add_epi16(j, _mm_srai_epi16(_mm_sub_epi16(prev, cur), 2));
+    return j;
+}
+#endif
+
+/// Fades \p count bytes of the interior of the picture for the Wave fade
+/// or, with \p heat, the Flame one. Each byte is the average of its
+/// neighbours in the last frame plus its last value, less its value in the
+/// frame before that, clamped to a byte. A zero sum is always clamped to 0.
+static void fadeRow(unsigned char *out, const unsigned char *last,
+                    const unsigned char *lastLast, int count, int step,
+                    bool heat)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i l = _mm_loadu_si128((const __m128i *)(last + i - 2));
+        __m128i r = _mm_loadu_si128((const __m128i *)(last + i + 2));
+        __m128i u = _mm_loadu_si128((const __m128i *)(last + i - step));
+        __m128i d = _mm_loadu_si128((const __m128i *)(last + i + step));
+        __m128i c = _mm_loadu_si128((const __m128i *)(last + i));
+        __m128i p = _mm_loadu_si128((const __m128i *)(lastLast + i));
+
+        __m128i lo = fadeLanes(_mm_unpacklo_epi8(l, zero),
+                               _mm_unpacklo_epi8(r, zero),
+                               _mm_unpacklo_epi8(u, zero),
+                               _mm_unpacklo_epi8(d, zero),
+                               _mm_unpacklo_epi8(c, zero),
+                               _mm_unpacklo_epi8(p, zero), heat);
+        __m128i hi = fadeLanes(_mm_unpackhi_epi8(l, zero),
+                               _mm_unpackhi_epi8(r, zero),
+                               _mm_unpackhi_epi8(u, zero),
+                               _mm_unpackhi_epi8(d, zero),
+                               _mm_unpackhi_epi8(c, zero),
+                               _mm_unpackhi_epi8(p, zero), heat);
+
+        // Packing with unsigned saturation does the clamping
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        int j = ((int(last[i - 2]) + int(last[i + 2]) +
+                  int(last[i - step]) + int(last[i + step])) >> 2) +
+                last[i] - lastLast[i] - 1;
+        if (heat)
+            j += (lastLast[i] - last[i]) >> 2;
+
+        if (j < 0)
+            out[i] = 0;
+        else if (j > 255)
+            out[i] = 255;
+        else
+            out[i] = j;
+    }
+}
+
 void Synaesthesia::fadePixelWave(int x, int y, int where, int step)
 {
     short j = short((int(getPixel(x - 1, y, where - 2)) +
@@ -349,29 +399,8 @@ void Synaesthesia::fadeWave(void)
     for (y = 1, start = m_outWidth * 2 + 2, end = m_outWidth * 4 - 2; 
          y < m_outHeight - 1; y++, start += step, end += step) 
     {
-        int i = start;
-        do
-        {
-            short j = short((int(lastOutput[i - 2]) +
-                             int(lastOutput[i + 2]) +
-                             int(lastOutput[i - step]) +
-                             int(lastOutput[i + step])) >> 2) +
-                lastOutput[i];
-            if (!j)
-            {
-                output[i] = 0;
-            }
-            else
-            {
-                j = j - lastLastOutput[i] - 1;
-                if (j < 0)
-                    output[i] = 0;
-                else if (j & (255*256))
-                    output[i] = 255;
-                else
-                    output[i] = j;
-            }
-        } while(++i < end);
+        fadeRow(output + start, lastOutput + start, lastLastOutput + start,
+                end - start, step, false);
     }
 }
 
@@ -426,28 +455,8 @@ void Synaesthesia::fadeHeat(void)
     for(y = 1, start = m_outWidth * 2 + 2, end = m_outWidth * 4 - 2; 
         y < m_outHeight - 1; y++, start += step, end += step) 
     {
-        int i = start;
-        do
-        {
-            short j = short((int(lastOutput[i - 2]) +
-                             int(lastOutput[i + 2]) +
-                             int(lastOutput[i - step]) +
-                             int(lastOutput[i + step])) >> 2) +
-                lastOutput[i];
-            if (!j)
-                output[i] = 0;
-            else
-            {
-                j = j - lastLastOutput[i] +
-                    ((lastLastOutput[i] - lastOutput[i]) >> 2) - 1;
-                if (j < 0) 
-                    output[i] = 0;
-                else if (j & (255*256))
-                    output[i] = 255;
-                else
-                    output[i] = j;
-            }
-        } while(++i < end);
+        fadeRow(output + start, lastOutput + start, lastLastOutput + start,
+                end - start, step, true);
     }
 }
 
@@ -469,7 +478,6 @@ bool Synaesthesia::process(VisualNode *node)
     if (!node)
         return false;
 
-    double x[NumSamples], y[NumSamples];
     double a[NumSamples], b[NumSamples];
     double energy;
     int clarity[NumSamples];
@@ -477,38 +485,27 @@ bool Synaesthesia::process(VisualNode *node)
 
     int brightFactor = int(Brightness * m_brightnessTwiddler / (m_starSize + 0.01));
 
-    int numSamps = NumSamples;
-    if (node->length < NumSamples)
-        numSamps = node->length;
-
-    memset(x, 0, sizeof(x));
-    memset(y, 0, sizeof(y));
-
-    for (i = 0; i < numSamps; i++) 
-    {
-        x[i] = node->left[i];
-        if (node->right)
-            y[i] = node->right[i];
-        else
-            y[i] = x[i];
-    }
-
-    fft(x, y);
+    // The spectrum is shared with the other visualizers and has half as
+    // many bins as there are rows, so each bin is drawn on two of them.
+    // It holds the left and right channels apart, where the FFT this was
+    // written for carried them as the real and imaginary parts of one
+    // input; a, b and clarity are worked out as they would have been.
+    const float *left = node->spectrum(0);
+    const float *right = node->spectrum(1);
 
     energy = 0.0;
 
-    for (i = 0 + 1; i < NumSamples / 2; i++)
+    for (i = 1; i < NumSamples / 2; i++)
     {
-        double x1 = x[m_bitReverse[i]], 
-               y1 = y[m_bitReverse[i]],
-               x2 = x[m_bitReverse[NumSamples - i]],
-               y2 = y[m_bitReverse[NumSamples - i]],
-               aa, bb;
-        a[i] = sqrt(aa = (x1 + x2) * (x1 + x2) + (y1 - y2) * (y1 - y2));
-        b[i] = sqrt(bb = (x1 - x2) * (x1 - x2) + (y2 + y2) * (y1 + y2));
+        int bin = ((i + 1) / 2) * 2;
+        double lre = left[bin], lim = left[bin + 1],
+               rre = right[bin], rim = right[bin + 1],
+               aa = 4.0 * (lre * lre + lim * lim),
+               bb = 4.0 * (rre * rre + rim * rim);
+        a[i] = sqrt(aa);
+        b[i] = sqrt(bb);
         if (aa + bb != 0.0)
-            clarity[i] = (int)(((x1 + x2) * (x1 - x2) + (y1 + y2) * (y1 - y2)) /
-                         (aa + bb) * 256);
+            clarity[i] = (int)(4.0 * (lim * rre - lre * rim) / (aa + bb) * 256);
         else
             clarity[i] = 0;
 
@@ -8,6 +8,8 @@
 
 class QImage;
 
+// The rows the spectrum is spread over. This was tuned with an FFT of
+// NumSamples points, twice the size of the one the visualizers now share.
 #define LogSize 10
 #define Brightness 150
 #define NumSamples (1<<LogSize)
@@ -29,9 +31,6 @@ public:
 
 private:
     void setupPalette(void);
-    void coreInit(void);
-    int bitReverser(int i);
-    void fft(double *x, double *y);
     void setStarSize(double lsize);
 
     inline void addPixel(int x, int y, int br1, int br2);
@@ -47,9 +46,6 @@ private:
 
     QSize m_size;
 
-    double m_cosTable[NumSamples];
-    double m_negSinTable[NumSamples];
-    int m_bitReverse[NumSamples];
     int m_scaleDown[256];
     int m_maxStarRadius;
     int m_fadeMode;
@@ -0,0 +1,3 @@
+#include "test_gapless.h"
+
+QTEST_APPLESS_MAIN(TestGapless)
@@ -0,0 +1,331 @@
+/*
+ *  Class TestGapless
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QMutex>
+
+#include <audiooutput.h>
+#include <mythcorecontext.h>
+#include <mythdb.h>
+#include <mthread.h>
+
+#include "avfdecoder.h"
+
+/// Length of each test track, in seconds
+static const int kTrackLength = 3;
+
+/**
+ *  Stands in for a sound card: plays what it is given in real time on a
+ *  thread of its own, like the NULL device would if it could be opened,
+ *  and measures the gaps in what it played.
+ *
+ *  A gap is any time, between the first and last audio played, spent
+ *  paused or with nothing to play.
+ */
+class TimingOutput : public AudioOutput, public MThread
+{
+  public:
+    TimingOutput() :
+        MThread("TimingOutput"),
+        m_bytesPerFrame(4), m_samplerate(44100),
+        m_paused(false), m_unpauseWhenReady(false), m_stop(false),
+        m_written(0), m_started(false), m_pendingGap(0), m_gap(0)
+    {
+        start();
+    }
+
+    ~TimingOutput()
+    {
+        m_lock.lock();
+        m_stop = true;
+        m_lock.unlock();
+        wait();
+    }
+
+    /// Gap, in ms, between the first and last audio played so far
+    double Gap(void)
+    {
+        QMutexLocker locker(&m_lock);
+        return m_gap / 1000.0;
+    }
+
+    // AudioOutput
+    void Reconfigure(const AudioSettings &settings)
+    {
+        QMutexLocker locker(&m_lock);
+        int bytesPerFrame = settings.channels *
+            AudioOutputSettings::SampleSize(settings.format);
+        if (bytesPerFrame == m_bytesPerFrame &&
+            settings.samplerate == m_samplerate)
+            return;
+        m_bytesPerFrame = bytesPerFrame;
+        m_samplerate = settings.samplerate;
+        m_buffer.clear();
+    }
+    void SetEffDsp(int) { }
+    void Reset(void)
+    {
+        QMutexLocker locker(&m_lock);
+        m_buffer.clear();
+    }
+    bool AddFrames(void *buffer, int frames, int64_t timecode)
+    {
+        return AddData(buffer, frames * m_bytesPerFrame, timecode, frames);
+    }
+    bool AddData(void *buffer, int len, int64_t timecode, int)
+    {
+        QMutexLocker locker(&m_lock);
+        if (timecode >= 0)
+            m_written = timecode * 1000;
+        m_buffer.append((const char *)buffer, len);
+        m_written += BytesToUsecs(len);
+        return true;
+    }
+    void SetTimecode(int64_t timecode)
+    {
+        QMutexLocker locker(&m_lock);
+        m_written = timecode * 1000;
+    }
+    bool IsPaused(void) const { return m_paused; }
+    void Pause(bool paused)
+    {
+        QMutexLocker locker(&m_lock);
+        m_paused = paused;
+        m_unpauseWhenReady = false;
+    }
+    void PauseUntilBuffered(void)
+    {
+        QMutexLocker locker(&m_lock);
+        m_buffer.clear();
+        m_paused = m_unpauseWhenReady = true;
+    }
+    void Drain(void)
+    {
+        while (GetAudioBufferedTime() > 0)
+            usleep(1000);
+    }
+    int64_t GetAudiotime(void)
+    {
+        QMutexLocker locker(&m_lock);
+        return (m_written - BytesToUsecs(m_buffer.size())) / 1000;
+    }
+    int64_t GetAudioBufferedTime(void)
+    {
+        QMutexLocker locker(&m_lock);
+        return BytesToUsecs(m_buffer.size()) / 1000;
+    }
+    void bufferOutputData(bool) { }
+    int readOutputData(unsigned char *, int) { return 0; }
+
+    // VolumeBase
+    int GetVolumeChannel(int) const { return 100; }
+    void SetVolumeChannel(int, int) { }
+    void SetSWVolume(int, bool) { }
+    int GetSWVolume(void) { return 100; }
+
+  protected:
+    void run(void)
+    {
+        RunProlog();
+
+        QElapsedTimer clock;
+        clock.start();
+        int64_t last = 0;
+
+        m_lock.lock();
+        while (!m_stop)
+        {
+            m_lock.unlock();
+            usleep(5000);
+            m_lock.lock();
+
+            int64_t now = clock.nsecsElapsed() / 1000;
+            int64_t due = now - last;
+            last = now;
+
+            // like AudioOutputBase, wait for 100ms to be buffered
+            if (m_unpauseWhenReady && BytesToUsecs(m_buffer.size()) >= 100000)
+                m_paused = m_unpauseWhenReady = false;
+
+            int64_t played = 0;
+            if (!m_paused)
+            {
+                int bytes = qMin(UsecsToBytes(due), m_buffer.size());
+                m_buffer.remove(0, bytes);
+                played = BytesToUsecs(bytes);
+            }
+
+            // time spent silent only counts once more audio follows it
+            if (m_started)
+                m_pendingGap += due - played;
+            if (played > 0)
+            {
+                m_gap += m_pendingGap;
+                m_pendingGap = 0;
+                m_started = true;
+            }
+        }
+        m_lock.unlock();
+
+        RunEpilog();
+    }
+
+  private:
+    int64_t BytesToUsecs(int bytes) const
+    {
+        return (int64_t)bytes / m_bytesPerFrame * 1000000 / m_samplerate;
+    }
+    int UsecsToBytes(int64_t usecs) const
+    {
+        return usecs * m_samplerate / 1000000 * m_bytesPerFrame;
+    }
+
+    QMutex     m_lock;
+    QByteArray m_buffer;
+    int        m_bytesPerFrame;
+    int        m_samplerate;
+    bool       m_paused;
+    bool       m_unpauseWhenReady;
+    bool       m_stop;
+    int64_t    m_written;    ///< timecode, in us, of the end of m_buffer
+    bool       m_started;
+    int64_t    m_pendingGap; ///< us silent since audio was last played
+    int64_t    m_gap;        ///< us silent between audio played
+};
+
+class TestGapless: public QObject
+{
+    Q_OBJECT
+
+  private:
+    QTemporaryDir m_dir;
+    QString       m_tracks[2];
+
+    /// Writes a 16 bit stereo WAV file of a tone
+    static bool WriteTrack(const QString &path, double frequency)
+    {
+        const int rate = 44100;
+        const quint32 frames = rate * kTrackLength;
+
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+
+        QDataStream out(&file);
+        out.setByteOrder(QDataStream::LittleEndian);
+        out.writeRawData("RIFF", 4);
+        out << (quint32)(36 + frames * 4);
+        out.writeRawData("WAVEfmt ", 8);
+        out << (quint32)16 << (quint16)1 << (quint16)2 << (quint32)rate
+            << (quint32)(rate * 4) << (quint16)4 << (quint16)16;
+        out.writeRawData("data", 4);
+        out << (quint32)(frames * 4);
+
+        for (quint32 i = 0; i < frames; i++)
+        {
+            qint16 sample = 8000 * sin(2 * M_PI * frequency * i / rate);
+            out << sample << sample;
+        }
+
+        return out.status() == QDataStream::Ok;
+    }
+
+    static void Report(const char *path, double gap)
+    {
+        printf("GAPLESS {\"path\":\"%s\",\"gap_ms\":%.1f}\n", path, gap);
+    }
+
+  private slots:
+    // called at the beginning of these sets of tests
+    void initTestCase(void)
+    {
+        QVERIFY(m_dir.isValid());
+
+        gCoreContext = new MythCoreContext("bin_version", NULL);
+        gCoreContext->GetDB()->IgnoreDatabase(true);
+
+        m_tracks[0] = m_dir.path() + "/first.wav";
+        m_tracks[1] = m_dir.path() + "/second.wav";
+        QVERIFY(WriteTrack(m_tracks[0], 440.0));
+        QVERIFY(WriteTrack(m_tracks[1], 660.0));
+    }
+
+    /// The second track is opened while the first plays and takes over the
+    /// output as the first reaches its end, as MusicPlayer does it
+    void SplicedTracksHaveNoGap(void)
+    {
+        TimingOutput output;
+
+        avfDecoder first(m_tracks[0], NULL, &output);
+        QVERIFY(first.initialize());
+
+        avfDecoder second(m_tracks[1], NULL, &output);
+        QVERIFY(second.startLookahead());
+        first.setNextDecoder(&second);
+
+        first.start();
+        QVERIFY(first.wait((kTrackLength + 10) * 1000));
+        QVERIFY(second.isSpliced());
+        QVERIFY(second.wait((kTrackLength + 10) * 1000));
+
+        double gap = output.Gap();
+        Report("spliced", gap);
+
+        // within the output's own 5ms scheduling
+        QVERIFY2(gap < 20.0, qPrintable(QString("%1 ms gap").arg(gap)));
+    }
+
+    /// The first track is drained and the second only then opened, as
+    /// happens when the formats differ or the lookahead isn't ready
+    void DrainedTracksGap(void)
+    {
+        TimingOutput output;
+
+        avfDecoder first(m_tracks[0], NULL, &output);
+        QVERIFY(first.initialize());
+        first.start();
+        QVERIFY(first.wait((kTrackLength + 10) * 1000));
+
+        avfDecoder second(m_tracks[1], NULL, &output);
+        QVERIFY(second.initialize());
+        second.start();
+        QVERIFY(second.wait((kTrackLength + 10) * 1000));
+
+        double gap = output.Gap();
+        Report("drained", gap);
+
+        // at least the 100ms rebuffering after the output was reset
+        QVERIFY(gap >= 100.0);
+    }
+
+    // called at the end of these sets of tests
+    void cleanupTestCase(void)
+    {
+        delete gCoreContext;
+        gCoreContext = NULL;
+    }
+};
@@ -0,0 +1,33 @@
+include ( ../../../../mythconfig.mak )
+include ( ../../../../settings.pro )
+include ( ../../../../programs-libs.pro )
+
+QT += xml sql network
+
+contains(QT_VERSION, ^4\\.[0-9]\\..*) {
+CONFIG += qtestlib
+}
+contains(QT_VERSION, ^5\\.[0-9]\\..*) {
+QT += testlib
+}
+
+TEMPLATE = app
+TARGET = test_gapless
+DEPENDPATH += . ../..
+INCLUDEPATH += . ../..
+INCLUDEPATH += $${SYSROOT}$${PREFIX}/include/mythtv/metadata
+
+# The decoders are tested as built into the plugin
+LIBS += -L../.. -lmythmusic
+LIBS += -lmythmetadata-$$LIBVERSION
+
+QMAKE_LFLAGS += -Wl,$$_RPATH_$(PWD)/../..
+
+# Input
+HEADERS += test_gapless.h
+SOURCES += test_gapless.cpp
+
+QMAKE_CLEAN += $(TARGET) $(TARGETA) $(TARGETD) $(TARGET0) $(TARGET1) $(TARGET2)
+QMAKE_CLEAN += ; rm -f *.gcov *.gcda *.gcno
+
+LIBS += $$EXTRA_LIBS $$LATE_LIBS
@@ -0,0 +1,9 @@
+#include "test_smartplaylist.h"
+
+int main(int argc, char *argv[])
+{
+    // MythContext needs an application
+    QCoreApplication app(argc, argv);
+    TestSmartPlaylist test;
+    return QTest::qExec(&test, argc, argv);
+}
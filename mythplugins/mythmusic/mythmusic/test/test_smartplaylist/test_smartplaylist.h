@@ -0,0 +1,495 @@
+/*
+ *  Class TestSmartPlaylist
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <cstdio>
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVariant>
+#include <QList>
+
+#include <mythcorecontext.h>
+#include <mythcontext.h>
+#include <mythversion.h>
+#include <mythdbcon.h>
+#include <mythdb.h>
+
+#include "smartplaylist.h"
+#include "songindex.h"
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#define MSKIP(MSG) QSKIP(MSG, SkipAll)
+#else
+#define MSKIP(MSG) QSKIP(MSG)
+#endif
+
+Q_DECLARE_METATYPE(QList<SmartPLCriteriaRow>)
+
+/// What the tracks this test adds are filed under, so they can be removed
+static const char *kTestPath = "test_smartplaylist/";
+
+/**
+ *  Checks the song index picks the same tracks as the smart playlist SQL
+ *  does, over the music in the database plus a few tracks added for the
+ *  cases that differ most easily: case, accents, trailing spaces, empty
+ *  strings and NULLs from the joins.
+ *
+ *  This needs a database it adds to. Everything it adds is filed under
+ *  kTestPath, or named "SmartPL Test", and is removed afterwards. Set
+ *  MYTHTV_SMARTPL_TEST=1 to run it against the database in config.xml,
+ *  otherwise it is skipped.
+ */
+class TestSmartPlaylist: public QObject
+{
+    Q_OBJECT
+
+  private:
+    QList<int> m_artists;
+    QList<int> m_albums;
+    QList<int> m_genres;
+    SongIndex  m_index;
+
+    static int Insert(const QString &sql, const QVariantList &values)
+    {
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare(sql);
+        for (int x = 0; x < values.size(); x++)
+            query.addBindValue(values.at(x));
+
+        if (!query.exec())
+        {
+            MythDB::DBError("TestSmartPlaylist::Insert", query);
+            return -1;
+        }
+
+        return query.lastInsertId().toInt();
+    }
+
+    int AddArtist(const QString &name)
+    {
+        int id = Insert("INSERT INTO music_artists (artist_name) VALUES (?)",
+                        QVariantList() << name);
+        m_artists << id;
+        return id;
+    }
+
+    int AddAlbum(const QString &name, int artistID, bool compilation)
+    {
+        int id = Insert("INSERT INTO music_albums "
+                        "(artist_id, album_name, compilation) VALUES (?, ?, ?)",
+                        QVariantList() << artistID << name << (compilation ? 1 : 0));
+        m_albums << id;
+        return id;
+    }
+
+    int AddGenre(const QString &name)
+    {
+        int id = Insert("INSERT INTO music_genres (genre) VALUES (?)",
+                        QVariantList() << name);
+        m_genres << id;
+        return id;
+    }
+
+    static int AddSong(const QString &name, int artistID, int albumID,
+                       int genreID, int year, int rating, int plays,
+                       int daysSincePlayed)
+    {
+        static int count = 0;
+        return Insert("INSERT INTO music_songs "
+                      "(filename, name, artist_id, album_id, genre_id, year, "
+                      " rating, numplays, lastplay, date_entered) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, "
+                      "        NOW() - INTERVAL ? DAY, NOW())",
+                      QVariantList()
+                      << QString("%1%2.mp3").arg(kTestPath).arg(count++)
+                      << name << artistID << albumID << genreID << year
+                      << rating << plays << daysSincePlayed);
+    }
+
+    /// The tracks the playlist's SQL finds, as Playlist would ask for them
+    static bool FromSQL(const QList<SmartPLCriteriaRow> &criteria,
+                        bool matchAny, const QString &orderBy, int limitTo,
+                        QList<int> &songs)
+    {
+        QString matchType = matchAny ? " OR " : " AND ";
+        QString whereClause;
+
+        for (int x = 0; x < criteria.size(); x++)
+        {
+            const SmartPLCriteriaRow &row = criteria.at(x);
+            QString sql = getCriteriaSQL(row.Field, row.Operator,
+                                         row.Value1, row.Value2);
+            if (sql.isEmpty())
+                continue;
+            whereClause += (whereClause.isEmpty() ? "WHERE " : matchType) + sql;
+        }
+
+        whereClause += getOrderBySQL(orderBy);
+        if (limitTo > 0)
+            whereClause += " LIMIT " + QString::number(limitTo);
+
+        MSqlQuery query(MSqlQuery::InitCon());
+        if (!query.exec("SELECT song_id FROM music_songs "
+                        "LEFT JOIN music_directories ON"
+                        " music_songs.directory_id=music_directories.directory_id "
+                        "LEFT JOIN music_artists ON"
+                        " music_songs.artist_id=music_artists.artist_id "
+                        "LEFT JOIN music_albums ON"
+                        " music_songs.album_id=music_albums.album_id "
+                        "LEFT JOIN music_genres ON"
+                        " music_songs.genre_id=music_genres.genre_id "
+                        "LEFT JOIN music_artists AS music_comp_artists ON "
+                        "music_albums.artist_id=music_comp_artists.artist_id " +
+                        whereClause))
+        {
+            MythDB::DBError("TestSmartPlaylist::FromSQL", query);
+            return false;
+        }
+
+        songs.clear();
+        while (query.next())
+            songs << query.value(0).toInt();
+
+        return true;
+    }
+
+    static QList<SmartPLCriteriaRow> Criteria(const QString &field,
+                                              const QString &op,
+                                              const QString &value1 = QString(),
+                                              const QString &value2 = QString())
+    {
+        return QList<SmartPLCriteriaRow>()
+            << SmartPLCriteriaRow(field, op, value1, value2);
+    }
+
+    static void RemoveTestRows(const QString &table, const QString &column,
+                               const QList<int> &ids)
+    {
+        MSqlQuery query(MSqlQuery::InitCon());
+        for (int x = 0; x < ids.size(); x++)
+        {
+            query.prepare(QString("DELETE FROM %1 WHERE %2 = :ID")
+                          .arg(table).arg(column));
+            query.bindValue(":ID", ids.at(x));
+            if (!query.exec())
+                MythDB::DBError("TestSmartPlaylist::RemoveTestRows", query);
+        }
+    }
+
+  private slots:
+    void initTestCase(void)
+    {
+        if (qgetenv("MYTHTV_SMARTPL_TEST").isEmpty())
+            MSKIP("Set MYTHTV_SMARTPL_TEST=1 to run against a database");
+
+        gContext = new MythContext(MYTH_BINARY_VERSION);
+        QVERIFY2(gContext->Init(false), "Unable to connect to the database");
+
+        int accented = AddArtist(QString::fromUtf8("\xc3\x85ngstr\xc3\xb6m SmartPL Test"));
+        int shouting = AddArtist("ANGSTROM SMARTPL TEST  ");
+        int empty = AddArtist("");
+        int various = AddArtist("Various SmartPL Test");
+
+        int album = AddAlbum("SmartPL Test Album", accented, false);
+        int compilation = AddAlbum("SmartPL Test Hits", various, true);
+        int orphan = AddAlbum("SmartPL Test Orphan", 0, false);
+
+        int rock = AddGenre("SmartPL Test Rock");
+        int blank = AddGenre("");
+
+        QVERIFY(accented > 0 && shouting > 0 && empty > 0 && various > 0);
+        QVERIFY(album > 0 && compilation > 0 && orphan > 0);
+        QVERIFY(rock > 0 && blank > 0);
+
+        // 0 is never an id, so those joins give NULL
+        QVERIFY(AddSong(QString::fromUtf8("Stra\xc3\x9f" "e SmartPL Test"),
+                        accented, album, rock, 1995, 8, 3, 2) > 0);
+        QVERIFY(AddSong("strasse smartpl test", shouting, album, 0,
+                        2005, 2, 0, 40) > 0);
+        QVERIFY(AddSong("", empty, compilation, blank, 2000, 10, 12, 400) > 0);
+        QVERIFY(AddSong("SmartPL Test Nobody", 0, orphan, rock,
+                        1980, 0, 1, 0) > 0);
+        QVERIFY(AddSong("SmartPL Test Lost", accented, 0, 0,
+                        0, 5, 7, 10) > 0);
+
+        m_index.rebuild();
+        QVERIFY(m_index.count() >= 5);
+    }
+
+    void CompareWithSQL_data(void)
+    {
+        QTest::addColumn<QList<SmartPLCriteriaRow> >("criteria");
+        QTest::addColumn<bool>("matchAny");
+
+        QString accented = QString::fromUtf8("\xc3\xa5ngstr\xc3\xb6m smartpl test");
+
+        QTest::newRow("accents and case")
+            << Criteria("Artist", "is equal to", "angstrom smartpl test") << false;
+        QTest::newRow("trailing spaces")
+            << Criteria("Artist", "is equal to", accented + "   ") << false;
+        QTest::newRow("not equal")
+            << Criteria("Artist", "is not equal to", "angstrom smartpl test") << false;
+        QTest::newRow("greater")
+            << Criteria("Artist", "is greater than", "ANGSTROM") << false;
+        QTest::newRow("less")
+            << Criteria("Title", "is less than", "strasse") << false;
+        QTest::newRow("between")
+            << Criteria("Artist", "is between", "a", QString::fromUtf8("\xc3\xa1ngz")) << false;
+        QTest::newRow("starts with")
+            << Criteria("Title", "starts with", "STRAS") << false;
+        QTest::newRow("eszett")
+            << Criteria("Title", "starts with", "strase") << false;
+        QTest::newRow("ends with")
+            << Criteria("Artist", "ends with", "test") << false;
+        QTest::newRow("ends with space")
+            << Criteria("Artist", "ends with", "test ") << false;
+        QTest::newRow("contains")
+            << Criteria("Album", "contains", "pl test") << false;
+        QTest::newRow("contains empty")
+            << Criteria("Artist", "contains", "") << false;
+        QTest::newRow("does not contain")
+            << Criteria("Artist", "does not contain", "smartpl") << false;
+        QTest::newRow("artist set")
+            << Criteria("Artist", "is set") << false;
+        QTest::newRow("artist not set")
+            << Criteria("Artist", "is not set") << false;
+        QTest::newRow("genre empty")
+            << Criteria("Genre", "is equal to", "") << false;
+        QTest::newRow("genre not set")
+            << Criteria("Genre", "is not set") << false;
+        QTest::newRow("genre not rock")
+            << Criteria("Genre", "is not equal to", "smartpl test rock") << false;
+        QTest::newRow("comp artist")
+            << Criteria("Comp. Artist", "starts with", "various") << false;
+        QTest::newRow("comp artist not set")
+            << Criteria("Comp. Artist", "is not set") << false;
+        QTest::newRow("compilation")
+            << Criteria("Compilation", "is equal to", "Yes") << false;
+        QTest::newRow("not compilation")
+            << Criteria("Compilation", "is not equal to", "Yes") << false;
+        QTest::newRow("compilation not set")
+            << Criteria("Compilation", "is not set") << false;
+        QTest::newRow("year")
+            << Criteria("Year", "is between", "1990", "2000") << false;
+        QTest::newRow("rating")
+            << Criteria("Rating", "is greater than", "5") << false;
+        QTest::newRow("play count")
+            << Criteria("Play Count", "is equal to", "0") << false;
+        QTest::newRow("last play")
+            << Criteria("Last Play", "is less than", "$DATE - 30 days") << false;
+        QTest::newRow("last play between")
+            << Criteria("Last Play", "is between", "$DATE - 30 days", "$DATE") << false;
+
+        QList<SmartPLCriteriaRow> both;
+        both << SmartPLCriteriaRow("Artist", "contains", "smartpl", "")
+             << SmartPLCriteriaRow("Year", "is greater than", "1990", "");
+        QTest::newRow("all") << both << false;
+        QTest::newRow("any") << both << true;
+    }
+
+    /// The same tracks either way. SQL doesn't order equal keys, so the
+    /// tracks are compared in song_id order.
+    void CompareWithSQL(void)
+    {
+        QFETCH(QList<SmartPLCriteriaRow>, criteria);
+        QFETCH(bool, matchAny);
+
+        QList<int> fromIndex, fromSQL;
+        QVERIFY(m_index.evaluate(criteria, matchAny, QString(), 0, fromIndex));
+        QVERIFY(FromSQL(criteria, matchAny, QString(), 0, fromSQL));
+
+        qSort(fromIndex);
+        qSort(fromSQL);
+        QCOMPARE(fromIndex, fromSQL);
+    }
+
+    /// What the index can't answer exactly is left to the database
+    void FallsBackToSQL(void)
+    {
+        QList<int> songs;
+        QVERIFY(!m_index.evaluate(Criteria("Artist", "contains", "50%"),
+                                  false, QString(), 0, songs));
+        QVERIFY(!m_index.evaluate(Criteria("Date Imported", "is set"),
+                                  false, QString(), 0, songs));
+        QVERIFY(!m_index.evaluate(Criteria("Artist", "is equal to",
+                                           QString::fromUtf8("\xd0\x90")),
+                                  false, QString(), 0, songs));
+    }
+
+    /// A track is reread when the player says it has changed
+    void UpdateRereadsTrack(void)
+    {
+        QList<int> songs;
+        QList<SmartPLCriteriaRow> criteria =
+            Criteria("Title", "is equal to", "SmartPL Test Nobody");
+        QVERIFY(m_index.evaluate(criteria, false, QString(), 0, songs));
+        QCOMPARE(songs.size(), 1);
+        int id = songs.at(0);
+
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare("UPDATE music_songs SET name = 'SmartPL Test Renamed' "
+                      "WHERE song_id = :ID");
+        query.bindValue(":ID", id);
+        QVERIFY(query.exec());
+
+        m_index.update(id);
+        QVERIFY(m_index.evaluate(criteria, false, QString(), 0, songs));
+        QCOMPARE(songs.size(), 0);
+        QCOMPARE(m_index.title(id), QString("SmartPL Test Renamed"));
+    }
+
+    /**
+     * Benchmark 50 smart playlists against both paths.
+     *
+     * MYTHTV_SMARTPL_BENCH_TRACKS sets how many tracks are added for it
+     * (150000 makes the usual report), it is skipped if it isn't set. The
+     * results are printed on a line starting "SMARTPLBENCH ".
+     */
+    void PlaylistBench(void)
+    {
+        QByteArray env = qgetenv("MYTHTV_SMARTPL_BENCH_TRACKS");
+        if (env.isEmpty())
+            MSKIP("Set MYTHTV_SMARTPL_BENCH_TRACKS to the number of tracks");
+        int tracks = env.toInt();
+        QVERIFY(tracks > 0);
+
+        QList<int> artists, albums, genres;
+        for (int x = 0; x < 200; x++)
+            artists << AddArtist(QString("SmartPL Test Artist %1").arg(x));
+        for (int x = 0; x < 500; x++)
+            albums << AddAlbum(QString("SmartPL Test Album %1").arg(x),
+                               artists.at(x % artists.size()), x % 25 == 0);
+        for (int x = 0; x < 20; x++)
+            genres << AddGenre(QString("SmartPL Test Genre %1").arg(x));
+
+        // added a batch at a time, one at a time would take longer than
+        // the rest of the test
+        MSqlQuery query(MSqlQuery::InitCon());
+        for (int first = 0; first < tracks; first += 1000)
+        {
+            QStringList rows;
+            for (int x = first; x < qMin(first + 1000, tracks); x++)
+            {
+                int album = x % albums.size();
+                rows << QString("('%1bench/%2.mp3', 'SmartPL Test Track %2', "
+                                "%3, %4, %5, %6, %7, %8, "
+                                "NOW() - INTERVAL %9 DAY, NOW())")
+                    .arg(kTestPath).arg(x)
+                    .arg(artists.at(album % artists.size()))
+                    .arg(albums.at(album)).arg(genres.at(x % genres.size()))
+                    .arg(1950 + x % 70).arg(x % 11).arg(x % 50)
+                    .arg(x % 1000);
+            }
+
+            QVERIFY(query.exec("INSERT INTO music_songs "
+                               "(filename, name, artist_id, album_id, "
+                               " genre_id, year, rating, numplays, lastplay, "
+                               " date_entered) VALUES " + rows.join(",")));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        m_index.rebuild();
+        qint64 rebuildTime = timer.nsecsElapsed();
+
+        qint64 indexTime = 0, sqlTime = 0;
+        const int playlists = 50;
+
+        for (int p = 0; p < playlists; p++)
+        {
+            QList<SmartPLCriteriaRow> criteria;
+            bool matchAny = false;
+            QString orderBy;
+            int limitTo = 0;
+
+            switch (p % 5)
+            {
+                case 0:
+                    criteria << SmartPLCriteriaRow("Year", "is between",
+                                    QString::number(1950 + p),
+                                    QString::number(1960 + p))
+                             << SmartPLCriteriaRow("Rating", "is greater than",
+                                    QString::number(p % 10), "");
+                    orderBy = "Artist (A), Year (D)";
+                    break;
+                case 1:
+                    criteria << SmartPLCriteriaRow("Artist", "starts with",
+                                    QString("SmartPL Test Artist %1").arg(p), "")
+                             << SmartPLCriteriaRow("Genre", "is equal to",
+                                    QString("SmartPL Test Genre %1").arg(p % 20), "");
+                    matchAny = true;
+                    limitTo = 500;
+                    break;
+                case 2:
+                    criteria << SmartPLCriteriaRow("Title", "contains",
+                                    QString("Track %1").arg(p), "");
+                    orderBy = "Title (A)";
+                    break;
+                case 3:
+                    criteria << SmartPLCriteriaRow("Play Count", "is less than",
+                                    QString::number(p), "")
+                             << SmartPLCriteriaRow("Last Play", "is greater than",
+                                    "$DATE - 100 days", "");
+                    break;
+                default:
+                    criteria << SmartPLCriteriaRow("Album", "is equal to",
+                                    QString("smartpl test album %1").arg(p), "")
+                             << SmartPLCriteriaRow("Comp. Artist", "contains",
+                                    "7", "");
+                    matchAny = true;
+                    orderBy = "Play Count (D)";
+                    break;
+            }
+
+            QList<int> fromIndex, fromSQL;
+
+            timer.restart();
+            QVERIFY(m_index.evaluate(criteria, matchAny, orderBy, limitTo,
+                                     fromIndex));
+            indexTime += timer.nsecsElapsed();
+
+            timer.restart();
+            QVERIFY(FromSQL(criteria, matchAny, orderBy, limitTo, fromSQL));
+            sqlTime += timer.nsecsElapsed();
+
+            QCOMPARE(fromIndex.size(), fromSQL.size());
+        }
+
+        printf("SMARTPLBENCH {\"tracks\":%d,\"playlists\":%d,"
+               "\"rebuild_ms\":%.1f,\"index_ms\":%.1f,\"sql_ms\":%.1f}\n",
+               m_index.count(), playlists, rebuildTime / 1000000.0,
+               indexTime / 1000000.0, sqlTime / 1000000.0);
+    }
+
+    void cleanupTestCase(void)
+    {
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare("DELETE FROM music_songs WHERE filename LIKE :PATH");
+        query.bindValue(":PATH", QString("%1%").arg(kTestPath));
+        if (!query.exec())
+            MythDB::DBError("TestSmartPlaylist::cleanupTestCase", query);
+
+        RemoveTestRows("music_artists", "artist_id", m_artists);
+        RemoveTestRows("music_albums", "album_id", m_albums);
+        RemoveTestRows("music_genres", "genre_id", m_genres);
+
+        delete gContext;
+        gContext = NULL;
+    }
+};
@@ -0,0 +1,10 @@
+#include "test_visualizers.h"
+
+int main(int argc, char *argv[])
+{
+    // Painting needs a GUI application, run with QT_QPA_PLATFORM=offscreen
+    // when there is no display
+    QApplication app(argc, argv);
+    TestVisualizers test;
+    return QTest::qExec(&test, argc, argv);
+}
@@ -0,0 +1,178 @@
+/*
+ *  Class TestVisualizers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QPainter>
+#include <QImage>
+
+#include <mythcorecontext.h>
+#include <mythdb.h>
+
+#include "visualize.h"
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#define MSKIP(MSG) QSKIP(MSG, SkipSingle)
+#else
+#define MSKIP(MSG) QSKIP(MSG)
+#endif
+
+/// Visualizers drawn from the audio alone, AlbumArt needs a player
+static const char *kVisualizers[] =
+{
+    "StereoScope", "MonoScope", "Spectrum", "Squares", "Piano",
+    "Synaesthesia", "BumpScope", "Goom", NULL
+};
+
+class TestVisualizers: public QObject
+{
+    Q_OBJECT
+
+  private:
+    static const VisFactory *Find(const QString &name)
+    {
+        const VisFactory *factory = VisFactory::VisFactories();
+        for (; factory; factory = factory->next())
+        {
+            if (factory->name() == name)
+                return factory;
+        }
+        return NULL;
+    }
+
+    /// One block of two tones, moving a little each frame so the
+    /// visualizers don't settle on a still picture
+    static VisualNode *MakeNode(int frame)
+    {
+        const int rate = 44100;
+        short *left = new short[SAMPLES_DEFAULT_SIZE];
+        short *right = new short[SAMPLES_DEFAULT_SIZE];
+        double low = 220.0 + (frame % 100) * 4.0;
+        double high = 3000.0 - (frame % 100) * 20.0;
+
+        for (int i = 0; i < SAMPLES_DEFAULT_SIZE; i++)
+        {
+            double t = (double)(frame * SAMPLES_DEFAULT_SIZE + i) / rate;
+            left[i] = 12000 * sin(2 * M_PI * low * t);
+            right[i] = 6000 * sin(2 * M_PI * low * t) +
+                       6000 * sin(2 * M_PI * high * t);
+        }
+
+        return new VisualNode(left, right, SAMPLES_DEFAULT_SIZE,
+                              frame * SAMPLES_DEFAULT_SIZE * 1000 / rate);
+    }
+
+  private slots:
+    // called at the beginning of these sets of tests
+    void initTestCase(void)
+    {
+        gCoreContext = new MythCoreContext("bin_version", NULL);
+        gCoreContext->GetDB()->IgnoreDatabase(true);
+    }
+
+    void VisualizersAreRegistered(void)
+    {
+        for (int i = 0; kVisualizers[i]; i++)
+        {
+            QVERIFY2(Find(kVisualizers[i]),
+                     qPrintable(QString("%1 is missing").arg(kVisualizers[i])));
+        }
+    }
+
+    /**
+     * Benchmark rendering frames to an image, as MainVisual does.
+     *
+     * MYTHTV_VISBENCH_FRAMES sets how many frames each visualizer draws,
+     * it is skipped if it isn't set. MYTHTV_VISBENCH_PLUGINS can give a
+     * comma separated list of the visualizers to run. The results are
+     * printed on a line per visualizer starting "VISBENCH ".
+     */
+    void RenderBench(void)
+    {
+        QByteArray env = qgetenv("MYTHTV_VISBENCH_FRAMES");
+        if (env.isEmpty())
+            MSKIP("Set MYTHTV_VISBENCH_FRAMES to the number of frames");
+        int frames = env.toInt();
+        QVERIFY(frames > 0);
+
+        QStringList names = QString::fromLocal8Bit(
+            qgetenv("MYTHTV_VISBENCH_PLUGINS"))
+            .split(',', QString::SkipEmptyParts);
+        if (names.isEmpty())
+        {
+            for (int i = 0; kVisualizers[i]; i++)
+                names << kVisualizers[i];
+        }
+
+        // the size of a full screen visualizer on a 720p theme
+        QImage image(1280, 720, QImage::Format_RGB32);
+
+        foreach (const QString &name, names)
+        {
+            const VisFactory *factory = Find(name);
+            QVERIFY2(factory, qPrintable(name + " is missing"));
+
+            VisualBase *vis = factory->create(NULL, name);
+            QVERIFY(vis);
+            vis->resize(image.size());
+            image.fill(Qt::black);
+
+            qint64 process = 0;
+            qint64 draw = 0;
+            QElapsedTimer timer;
+
+            for (int frame = 0; frame < frames; frame++)
+            {
+                VisualNode *node = MakeNode(frame);
+
+                timer.start();
+                vis->process(node);
+                process += timer.nsecsElapsed();
+
+                timer.start();
+                QPainter painter(&image);
+                vis->draw(&painter, Qt::black);
+                painter.end();
+                draw += timer.nsecsElapsed();
+
+                delete node;
+            }
+
+            delete vis;
+
+            printf("VISBENCH {\"plugin\":\"%s\",\"frames\":%d,"
+                   "\"width\":%d,\"height\":%d,\"process_ms\":%.3f,"
+                   "\"draw_ms\":%.3f,\"fps\":%.1f}\n",
+                   qPrintable(name), frames, image.width(), image.height(),
+                   process / 1e6 / frames, draw / 1e6 / frames,
+                   frames * 1e9 / qMax(process + draw, (qint64)1));
+        }
+    }
+
+    // called at the end of these sets of tests
+    void cleanupTestCase(void)
+    {
+        delete gCoreContext;
+        gCoreContext = NULL;
+    }
+};
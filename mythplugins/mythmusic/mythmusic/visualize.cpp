@@ -11,6 +11,7 @@
 
 // C
 #include <cmath>
+#include <cstring>
 
 // C++
 #include <iostream>
@@ -35,8 +36,162 @@ using namespace std;
 #include "decoder.h"
 #include "musicplayer.h"
 
-#define FFTW_N 512
-// static_assert(FFTW_N==SAMPLES_DEFAULT_SIZE)
+extern "C" {
+#include <libavcodec/avfft.h>
+#include <libavutil/mem.h>
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Converts \p count samples to float and applies the window to them.
+/// \p out and \p window must be 16 byte aligned.
+static void window_from_short(float *out, const short *in,
+                              const float *window, unsigned long count)
+{
+    unsigned long i = 0;
+
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(in + i));
+        // Unpacking each short into the top half of an int and shifting
+        // it back down sign extends it
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_store_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo),
+                                         _mm_load_ps(window + i)));
+        _mm_store_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi),
+                                             _mm_load_ps(window + i + 4)));
+    }
+#endif
+
+    for (; i < count; i++)
+        out[i] = in[i] * window[i];
+}
+
+/** \class SpectrumAnalyser
+ *  \brief The FFT shared by all the visualizers.
+ *
+ *  A real DFT of SPECTRUM_N Hann windowed samples using FFmpeg's av_rdft,
+ *  which has SIMD versions for the CPUs FFmpeg supports. Nodes are only
+ *  analysed from the UI thread, so the scratch buffer needs no locking.
+ */
+class SpectrumAnalyser
+{
+  public:
+    static SpectrumAnalyser *Get(void)
+    {
+        static SpectrumAnalyser s_analyser;
+        return &s_analyser;
+    }
+
+    void Transform(const short *in, unsigned long count, float *out);
+
+  private:
+    SpectrumAnalyser();
+    ~SpectrumAnalyser();
+
+    RDFTContext *m_rdft;
+    float       *m_window;
+    float       *m_buf;
+};
+
+SpectrumAnalyser::SpectrumAnalyser() :
+    m_rdft(NULL),
+    m_window((float *)av_malloc(sizeof(float) * SPECTRUM_N)),
+    m_buf((float *)av_malloc(sizeof(float) * SPECTRUM_N))
+{
+    int bits = 0;
+    while ((1 << bits) < SPECTRUM_N)
+        bits++;
+
+    m_rdft = av_rdft_init(bits, DFT_R2C);
+    if (!m_rdft)
+        LOG(VB_GENERAL, LOG_ERR, "SpectrumAnalyser: Unable to set up the "
+                                 "FFT, spectrum visualizers will be blank");
+
+    // The window halves the amplitude of a steady tone, so it is scaled
+    // by two to keep levels where the visualizers were tuned for them
+    for (int i = 0; i < SPECTRUM_N; i++)
+        m_window[i] = 1.0 - cos(2.0 * M_PI * i / SPECTRUM_N);
+}
+
+SpectrumAnalyser::~SpectrumAnalyser()
+{
+    if (m_rdft)
+        av_rdft_end(m_rdft);
+    av_free(m_window);
+    av_free(m_buf);
+}
+
+/// Transforms \p count samples, zero padded to SPECTRUM_N, into
+/// SPECTRUM_BINS interleaved re/im pairs in \p out
+void SpectrumAnalyser::Transform(const short *in, unsigned long count,
+                                 float *out)
+{
+    if (!m_rdft)
+    {
+        memset(out, 0, sizeof(float) * SPECTRUM_BINS * 2);
+        return;
+    }
+
+    if (count > SPECTRUM_N)
+        count = SPECTRUM_N;
+
+    window_from_short(m_buf, in, m_window, count);
+    memset(m_buf + count, 0, sizeof(float) * (SPECTRUM_N - count));
+
+    av_rdft_calc(m_rdft, m_buf);
+
+    // av_rdft packs the (real) Nyquist bin in with the DC bin
+    out[0] = m_buf[0];
+    out[1] = 0.0f;
+    memcpy(out + 2, m_buf + 2, sizeof(float) * (SPECTRUM_N - 2));
+    out[SPECTRUM_N] = m_buf[1];
+    out[SPECTRUM_N + 1] = 0.0f;
+}
+
+void VisualNode::analyse(void)
+{
+    SpectrumAnalyser *analyser = SpectrumAnalyser::Get();
+
+    m_spectrum = new float[SPECTRUM_BINS * 2 * 2];
+    m_power = new float[SPECTRUM_BINS * 2];
+
+    analyser->Transform(left, length, m_spectrum);
+    if (right)
+        analyser->Transform(right, length, m_spectrum + SPECTRUM_BINS * 2);
+    else
+        memcpy(m_spectrum + SPECTRUM_BINS * 2, m_spectrum,
+               sizeof(float) * SPECTRUM_BINS * 2);
+
+    for (int c = 0; c < 2; c++)
+    {
+        const float *bin = m_spectrum + c * SPECTRUM_BINS * 2;
+        float *power = m_power + c * SPECTRUM_BINS;
+        for (int i = 0; i < SPECTRUM_BINS; i++)
+            power[i] = bin[2 * i] * bin[2 * i] +
+                       bin[2 * i + 1] * bin[2 * i + 1];
+    }
+}
+
+const float *VisualNode::spectrum(int channel)
+{
+    if (!m_spectrum)
+        analyse();
+
+    return m_spectrum + (channel ? SPECTRUM_BINS * 2 : 0);
+}
+
+const float *VisualNode::power(int channel)
+{
+    if (!m_spectrum)
+        analyse();
+
+    return m_power + (channel ? SPECTRUM_BINS : 0);
+}
 
 
 VisFactory* VisFactory::g_pVisFactories = 0;
@@ -579,51 +734,20 @@ static class MonoScopeFactory : public VisFactory
 ///////////////////////////////////////////////////////////////////////////////
 // Spectrum
 //
-// NOTE: This visualiser requires mythplugins to be compiled with --enable-fft
 
-#if FFTW3_SUPPORT
 Spectrum::Spectrum()
-    : lin(NULL), rin(NULL), lout(NULL), rout(NULL)
 {
-    // Setup the "magical" audio data transformations
-    // provided by the Fast Fourier Transforms library
     analyzerBarWidth = 6;
     scaleFactor = 2.0;
     falloff = 10.0;
     m_fps = 15;
 
-    lin = (myth_fftw_float*) av_malloc(sizeof(myth_fftw_float)*FFTW_N);
-    memset(lin, 0, sizeof(myth_fftw_float)*FFTW_N);
-
-    rin = (myth_fftw_float*) av_malloc(sizeof(myth_fftw_float)*FFTW_N);
-    memset(rin, 0, sizeof(myth_fftw_float)*FFTW_N);
-
-    lout = (myth_fftw_complex*) av_malloc(sizeof(myth_fftw_complex)*(FFTW_N/2+1));
-    memset(lout, 0, sizeof(myth_fftw_complex)*(FFTW_N/2+1));
-
-    rout = (myth_fftw_complex*) av_malloc(sizeof(myth_fftw_complex)*(FFTW_N/2+1));
-    memset(rout, 0, sizeof(myth_fftw_complex)*(FFTW_N/2+1));
-
-    lplan = fftw_plan_dft_r2c_1d(FFTW_N, lin, (myth_fftw_complex_cast*)lout, FFTW_MEASURE);
-    rplan = fftw_plan_dft_r2c_1d(FFTW_N, rin, (myth_fftw_complex_cast*)rout, FFTW_MEASURE);
-
     startColor = QColor(0,0,255);
     targetColor = QColor(255,0,0);
 }
 
 Spectrum::~Spectrum()
 {
-    if (lin)
-        av_free(lin);
-    if (rin)
-        av_free(rin);
-    if (lout)
-        av_free(lout);
-    if (rout)
-        av_free(rout);
-
-    fftw_destroy_plan(lplan);
-    fftw_destroy_plan(rplan);
 }
 
 void Spectrum::resize(const QSize &newsize)
@@ -658,11 +782,9 @@ void Spectrum::resize(const QSize &newsize)
         magnitudes[os] = 0.0;
     }
 
-    scaleFactor = double( size.height() / 2 ) / log( (double)(FFTW_N) );
+    scaleFactor = double( size.height() / 2 ) / log( (double)(SPECTRUM_N) );
 }
 
-template<typename T> T sq(T a) { return a*a; };
-
 bool Spectrum::process(VisualNode *node)
 {
     // Take a bunch of data in *node
@@ -676,34 +798,22 @@ bool Spectrum::process(VisualNode *node)
     double *magnitudesp = magnitudes.data();
     double magL, magR, tmp;
 
+    static const float silence[SPECTRUM_BINS] = { 0 };
+    const float *powerL = silence, *powerR = silence;
     if (node)
     {
-        i = node->length;
-        if (i > FFTW_N)
-            i = FFTW_N;
-        fast_real_set_from_short(lin, node->left, i);
-        if (node->right)
-            fast_real_set_from_short(rin, node->right, i);
+        powerL = node->power(0);
+        powerR = node->power(1);
     }
-    else
-        i = 0;
-
-    fast_reals_set(lin + i, rin + i, 0, FFTW_N - i);
-
-    fftw_execute(lplan);
-    fftw_execute(rplan);
 
     index = 1;
 
     for (i = 0; (int)i < rects.size(); i++, w += analyzerBarWidth)
     {
-        // The 1D output is Hermitian symmetric (Yk = Yn-k) so Yn = Y0 etc.
-        // The dft_r2c_1d plan doesn't output these redundant values
-        // and furthermore they're not allocated in the ctor
-        tmp = 2 * sq(real(lout[index])); // + sq(real(lout[FFTW_N - index]));
+        tmp = powerL[index];
         magL = (tmp > 1.) ? (log(tmp) - 22.0) * scaleFactor : 0.;
 
-        tmp = 2 * sq(real(rout[index])); // + sq(real(rout[FFTW_N - index]));
+        tmp = powerR[index];
         magR = (tmp > 1.) ? (log(tmp) - 22.0) * scaleFactor : 0.;
 
         if (magL > size.height() / 2)
@@ -828,7 +938,6 @@ static class SpectrumFactory : public VisFactory
 ///////////////////////////////////////////////////////////////////////////////
 // Squares
 //
-// NOTE: This visualiser requires mythplugins to be compiled with --enable-fftw
 
 Squares::Squares() :
     actualSize(0,0), pParent(NULL), fake_height(0), number_of_squares(16)
@@ -917,8 +1026,6 @@ static class SquaresFactory : public VisFactory
     }
 }SquaresFactory;
 
-#endif // FFTW3_SUPPORT
-
 Piano::Piano()
     : piano_data(NULL), audio_data(NULL)
 {
@@ -28,30 +28,20 @@
 #include "constants.h"
 #include "config.h"
 
-#include <complex>
-extern "C" {
-#ifdef FFTW3_SUPPORT
-#include <fftw3.h>
-#define myth_fftw_float double /* need to use different plan function to change */
-#define fftw_real myth_fftw_float
-#define myth_fftw_complex std::complex<myth_fftw_float>
-#if (myth_fftw_float == double)
-#define myth_fftw_complex_cast fftw_complex
-#elif (myth_fftw_float == float)
-#define myth_fftw_complex_cast fftwf_complex
-#endif
-#endif
-}
-
 #define SAMPLES_DEFAULT_SIZE 512
 
+// Size of the FFT shared by the visualizers, and the bins it produces
+#define SPECTRUM_N SAMPLES_DEFAULT_SIZE
+#define SPECTRUM_BINS (SPECTRUM_N / 2 + 1)
+
 class MainVisual;
 
 class VisualNode
 {
   public:
     VisualNode(short *l, short *r, unsigned long n, unsigned long o)
-        : left(l), right(r), length(n), offset(o)
+        : left(l), right(r), length(n), offset(o),
+          m_spectrum(NULL), m_power(NULL)
     {
         // left and right are allocated and then passed to this class
         // the code that allocated left and right should give up all ownership
@@ -61,10 +51,26 @@ class VisualNode
     {
         delete [] left;
         delete [] right;
+        delete [] m_spectrum;
+        delete [] m_power;
     }
 
+    /// Hann windowed spectrum of a channel (0 left, 1 right) as
+    /// SPECTRUM_BINS interleaved re/im pairs. It is computed the first
+    /// time any visualizer asks, so the FFT is done once per node however
+    /// many visualizers look at it.
+    const float *spectrum(int channel);
+    /// Power (re^2 + im^2) of each of the SPECTRUM_BINS bins of a channel
+    const float *power(int channel);
+
     short *left, *right;
     unsigned long length, offset;
+
+  private:
+    void analyse(void);
+
+    float *m_spectrum;
+    float *m_power;
 };
 
 class VisualBase
@@ -159,7 +165,6 @@ class LogScale
     int s, r;
 };
 
-#ifdef FFTW3_SUPPORT
 class Spectrum : public VisualBase
 {
     // This class draws bars (up and down)
@@ -185,10 +190,6 @@ class Spectrum : public VisualBase
     LogScale scale;
     double scaleFactor, falloff;
     int analyzerBarWidth;
-
-    fftw_plan lplan, rplan;
-    myth_fftw_float *lin, *rin;
-    myth_fftw_complex *lout, *rout;
 };
 
 class Squares : public Spectrum
@@ -209,8 +210,6 @@ class Squares : public Spectrum
     int number_of_squares;
 };
 
-#endif // FFTW3_SUPPORT
-
 class Piano : public VisualBase
 {
     // This class draws bars (up and down)
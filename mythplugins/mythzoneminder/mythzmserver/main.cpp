@@ -19,7 +19,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <cerrno>
 #include <map>
+#include <vector>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -28,6 +30,12 @@
 #include <fcntl.h>
 #include <signal.h>
 
+#ifdef linux
+#  include <sys/epoll.h>
+#else
+#  include <poll.h>
+#endif
+
 #include "zmserver.h"
 
 // default port to listen on
@@ -48,22 +56,163 @@
 
 using namespace std;
 
+// Watches the sockets for input, or for room to write queued output.
+// Uses epoll where there is one and poll() elsewhere.
+class SocketPoller
+{
+  public:
+    typedef struct
+    {
+        int  fd;
+        bool read;   // readable, or hung up
+        bool write;  // writable, or failed
+    } Event;
+
+    SocketPoller(void)
+    {
+#ifdef linux
+        m_epollfd = epoll_create(64);
+#endif
+    }
+
+    ~SocketPoller()
+    {
+#ifdef linux
+        if (m_epollfd != -1)
+            close(m_epollfd);
+#endif
+    }
+
+    bool isValid(void) const
+    {
+#ifdef linux
+        return m_epollfd != -1;
+#else
+        return true;
+#endif
+    }
+
+    // a socket with output waiting is only watched for writing, so a
+    // client isn't read from until it has taken its last reply
+    void add(int fd)
+    {
+#ifdef linux
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(m_epollfd, EPOLL_CTL_ADD, fd, &ev);
+#else
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        m_fds.push_back(pfd);
+#endif
+    }
+
+    void setWriting(int fd, bool writing)
+    {
+#ifdef linux
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = writing ? EPOLLOUT : EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(m_epollfd, EPOLL_CTL_MOD, fd, &ev);
+#else
+        for (size_t x = 0; x < m_fds.size(); x++)
+            if (m_fds[x].fd == fd)
+                m_fds[x].events = writing ? POLLOUT : POLLIN;
+#endif
+    }
+
+    void remove(int fd)
+    {
+#ifdef linux
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        epoll_ctl(m_epollfd, EPOLL_CTL_DEL, fd, &ev);
+#else
+        for (size_t x = 0; x < m_fds.size(); x++)
+        {
+            if (m_fds[x].fd == fd)
+            {
+                m_fds.erase(m_fds.begin() + x);
+                break;
+            }
+        }
+#endif
+    }
+
+    // returns the number of events, 0 on timeout or -1 on error
+    int wait(int timeout, vector<Event> &events)
+    {
+        events.clear();
+
+#ifdef linux
+        struct epoll_event ev[64];
+        int res = epoll_wait(m_epollfd, ev, 64, timeout);
+
+        for (int x = 0; x < res; x++)
+        {
+            Event event;
+            event.fd = ev[x].data.fd;
+            event.read = ev[x].events & (EPOLLIN | EPOLLHUP | EPOLLERR);
+            event.write = ev[x].events & (EPOLLOUT | EPOLLHUP | EPOLLERR);
+            events.push_back(event);
+        }
+#else
+        int res = poll(&m_fds[0], m_fds.size(), timeout);
+
+        for (size_t x = 0; res > 0 && x < m_fds.size(); x++)
+        {
+            if (m_fds[x].revents == 0)
+                continue;
+
+            Event event;
+            event.fd = m_fds[x].fd;
+            event.read = m_fds[x].revents & (POLLIN | POLLHUP | POLLERR);
+            event.write = m_fds[x].revents & (POLLOUT | POLLHUP | POLLERR);
+            events.push_back(event);
+        }
+
+        if (res > 0)
+            res = events.size();
+#endif
+
+        if (res == -1 && errno == EINTR)
+            return 0;
+
+        return res;
+    }
+
+  private:
+#ifdef linux
+    int m_epollfd;
+#else
+    vector<struct pollfd> m_fds;
+#endif
+};
+
+static bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
 int main(int argc, char **argv)
 {
-    fd_set master;                  // master file descriptor list
-    fd_set read_fds;                // temp file descriptor list for select()
+    SocketPoller poller;            // watches the sockets
+    vector<SocketPoller::Event> events; // sockets ready after wait()
     struct sockaddr_in myaddr;      // server address
     struct sockaddr_in remoteaddr;  // client address
-    struct timeval timeout;         // maximum time to wait for data
-    int res;                        // result from select()
-    int fdmax;                      // maximum file descriptor number
+    int res;                        // result from wait()
     int listener;                   // listening socket descriptor
     int newfd;                      // newly accept()ed socket descriptor
     char buf[4096];                 // buffer for client data
     int nbytes;
     int yes=1;                      // for setsockopt() SO_REUSEADDR, below
     socklen_t addrlen;
-    int i;
     bool quit = false;              // quit flag
 
     bool debug = false;             // debug mode enabled
@@ -223,9 +372,11 @@ int main(int argc, char **argv)
     // connect to the DB
     connectToDatabase();
 
-    // clear the master and temp sets
-    FD_ZERO(&master);
-    FD_ZERO(&read_fds);
+    if (!poller.isValid())
+    {
+        perror("epoll_create");
+        return EXIT_SOCKET_ERROR;
+    }
 
     // get the listener
     if ((listener = socket(AF_INET, SOCK_STREAM, 0)) == -1)
@@ -260,104 +411,134 @@ int main(int argc, char **argv)
         return EXIT_SOCKET_ERROR;
     }
 
-    cout << "Listening on port: " << port << endl;
+    // so a client that went away before we got to accept() it can't
+    // block us
+    if (!setNonBlocking(listener))
+    {
+        perror("fcntl");
+        return EXIT_SOCKET_ERROR;
+    }
 
-    // add the listener to the master set
-    FD_SET(listener, &master);
+    cout << "Listening on port: " << port << endl;
 
-    // keep track of the biggest file descriptor
-    fdmax = listener; // so far, it's this one
+    // watch the listener
+    poller.add(listener);
 
     // main loop
     while (!quit)
     {
-        // the maximum time select() should wait
-        timeout.tv_sec = DB_CHECK_TIME;
-        timeout.tv_usec = 0;
-
-        read_fds = master; // copy it
-        res = select(fdmax+1, &read_fds, NULL, NULL, &timeout);
+        // the maximum time we should wait
+        res = poller.wait(DB_CHECK_TIME * 1000, events);
 
         if (res == -1)
         {
-            perror("select");
+            perror("epoll_wait");
             return EXIT_SOCKET_ERROR;
         }
         else if (res == 0)
         {
-            // select timed out
+            // timed out
             // just kick the DB connection to keep it alive
             kickDatabase(debug);
             continue;
         }
 
-        // run through the existing connections looking for data to read
-        for (i = 0; i <= fdmax; i++)
+        // run through the sockets that are ready
+        for (size_t x = 0; x < events.size() && !quit; x++)
         {
-            if (FD_ISSET(i, &read_fds))
+            int i = events[x].fd;
+
+            if (i == listener)
             {
-                // we got one!!
-                if (i == listener) 
+                // handle new connections
+                while (true)
                 {
-                    // handle new connections
                     addrlen = sizeof(remoteaddr);
                     if ((newfd = accept(listener,
                                         (struct sockaddr *) &remoteaddr,
-                                                               &addrlen)) == -1)
+                                                           &addrlen)) == -1)
                     {
-                        perror("accept");
+                        if (errno != EAGAIN && errno != EWOULDBLOCK &&
+                            errno != EINTR)
+                            perror("accept");
+                        break;
                     }
-                    else
+
+                    // one slow client mustn't hold up the others
+                    if (!setNonBlocking(newfd))
                     {
-                        // add to master set
-                        FD_SET(newfd, &master);
-                        if (newfd > fdmax)
-                        {    // keep track of the maximum
-                            fdmax = newfd;
-                        }
-
-                        // create new ZMServer and add to map
-                        ZMServer *server = new ZMServer(newfd, debug);
-                        serverList[newfd] = server;
-
-                        printf("new connection from %s on socket %d\n",
-                               inet_ntoa(remoteaddr.sin_addr), newfd);
+                        perror("fcntl");
+                        close(newfd);
+                        continue;
                     }
+
+                    poller.add(newfd);
+
+                    // create new ZMServer and add to map
+                    ZMServer *server = new ZMServer(newfd, debug);
+                    serverList[newfd] = server;
+
+                    printf("new connection from %s on socket %d\n",
+                           inet_ntoa(remoteaddr.sin_addr), newfd);
                 }
-                else
+
+                continue;
+            }
+
+            map<int, ZMServer*>::iterator it = serverList.find(i);
+            if (it == serverList.end())
+                continue;
+
+            ZMServer *server = it->second;
+            bool writing = server->hasPendingOutput();
+            bool ok = true;
+
+            if (writing)
+            {
+                // send the rest of the last reply
+                if (events[x].write)
+                    ok = server->flush();
+            }
+            else if (events[x].read)
+            {
+                // handle data from a client
+                if ((nbytes = recv(i, buf, sizeof(buf) - 1, 0)) <= 0)
                 {
-                    // handle data from a client
-                    if ((nbytes = recv(i, buf, sizeof(buf), 0)) <= 0)
+                    // got error or connection closed by client
+                    if (nbytes == 0)
                     {
-                        // got error or connection closed by client
-                        if (nbytes == 0)
-                        {
-                            // connection closed
-                            printf("socket %d hung up\n", i);
-                        }
-                        else
-                        {
-                            perror("recv");
-                        }
-
-                        close(i);
-
-                        // remove from master set
-                        FD_CLR(i, &master);
-
-                        // remove from server list
-                        ZMServer *server = serverList[i];
-                        if (server)
-                            delete server;
-                        serverList.erase(i);
+                        // connection closed
+                        printf("socket %d hung up\n", i);
+                        ok = false;
                     }
-                    else
+                    else if (errno != EAGAIN && errno != EWOULDBLOCK &&
+                             errno != EINTR)
                     {
-                        ZMServer *server = serverList[i];
-                        quit = server->processRequest(buf, nbytes);
+                        perror("recv");
+                        ok = false;
                     }
                 }
+                else
+                {
+                    quit = server->processRequest(buf, nbytes);
+                    ok = server->flush();
+                }
             }
+
+            if (!ok)
+            {
+                poller.remove(i);
+                close(i);
+
+                // remove from server list
+                delete server;
+                serverList.erase(it);
+                continue;
+            }
+
+            // wait for room to send the rest of the reply, if there is any
+            if (writing != server->hasPendingOutput())
+                poller.setWriting(i, !writing);
         }
     }
 
@@ -368,6 +549,8 @@ int main(int argc, char **argv)
         delete it->second;
     }
 
+    FrameBroadcaster::clear();
+
     mysql_close(&g_dbConn);
 
     return EXIT_OK;
@@ -0,0 +1,3 @@
+#include "test_eventindex.h"
+
+QTEST_APPLESS_MAIN(TestEventIndex)
@@ -0,0 +1,274 @@
+/*
+ *  Class TestEventIndex
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <sys/types.h>
+#include <cstdio>
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+#include "zmserver.h"
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#define MSKIP(MSG) QSKIP(MSG, SkipSingle)
+#else
+#define MSKIP(MSG) QSKIP(MSG)
+#endif
+
+/**
+ *  Tests the event index without a database, by handing it rows as a
+ *  refresh would have read them.
+ */
+class TestEventIndex: public QObject
+{
+    Q_OBJECT
+
+  private:
+    static void Reset(void)
+    {
+        EventIndex::s_events.clear();
+        EventIndex::s_eventsByID.clear();
+        EventIndex::s_dates.clear();
+        EventIndex::s_openEvents.clear();
+        EventIndex::s_monitorNames.clear();
+        EventIndex::s_changes.clear();
+        EventIndex::s_lists.clear();
+        EventIndex::s_listsGeneration = 0;
+        EventIndex::s_generation = 0;
+        EventIndex::s_trimmedGeneration = 0;
+        EventIndex::s_maxEventID = 0;
+        EventIndex::s_sweepFrom = 0;
+        EventIndex::s_started = 1000;
+        EventIndex::s_lastRefresh = 0;
+        EventIndex::s_loaded = true;
+
+        EventIndex::s_monitorNames[1] = "Front";
+        EventIndex::s_monitorNames[2] = "Back";
+    }
+
+    static void Update(int eventID, int monitorID, const string &startTime,
+                       bool continuous = false, const string &name = "Event")
+    {
+        EventRow row;
+        row.eventID = eventID;
+        row.name = name;
+        row.monitorID = monitorID;
+        row.startTime = startTime;
+        row.length = "10.00";
+        row.continuous = continuous;
+        row.open = false;
+        EventIndex::updateEvent(row);
+    }
+
+    static void Remove(int eventID)
+    {
+        EventIndex::removeEvent(eventID);
+    }
+
+    static void EndRefresh(void)
+    {
+        EventIndex::endRefresh();
+    }
+
+    static QList<int> Changed(const string &token, int monitorID,
+                              const string &date, bool includeContinuous,
+                              QList<int> *removed = NULL)
+    {
+        vector<const EventRow *> changed;
+        vector<int> gone;
+        if (!EventIndex::findChanges(token, monitorID, date, includeContinuous,
+                                     changed, gone))
+        {
+            return QList<int>() << -1;
+        }
+
+        QList<int> ids;
+        for (uint x = 0; x < changed.size(); x++)
+            ids << changed[x]->eventID;
+        qSort(ids);
+
+        if (removed)
+        {
+            removed->clear();
+            for (uint x = 0; x < gone.size(); x++)
+                *removed << gone[x];
+            qSort(*removed);
+        }
+
+        return ids;
+    }
+
+  private slots:
+    void init(void)
+    {
+        Reset();
+        Update(1, 1, "2016-01-01 10:00:00");
+        Update(2, 1, "2016-01-02 10:00:00");
+        Update(3, 2, "2016-01-01 11:00:00", true);
+        EndRefresh();
+    }
+
+    void ListIsOrderedOldestFirst(void)
+    {
+        const vector<const EventRow *> &events =
+            EventIndex::findEvents(-1, "<ANY>", true);
+        QCOMPARE((int)events.size(), 3);
+        QCOMPARE(events[0]->eventID, 1);
+        QCOMPARE(events[1]->eventID, 3);
+        QCOMPARE(events[2]->eventID, 2);
+
+        // continuous events are only left out when showing all monitors
+        QCOMPARE((int)EventIndex::findEvents(-1, "<ANY>", false).size(), 2);
+        QCOMPARE((int)EventIndex::findEvents(2, "<ANY>", false).size(), 1);
+        QCOMPARE((int)EventIndex::findEvents(1, "2016-01-02", true).size(), 1);
+    }
+
+    void ListIsKeptUntilTheIndexChanges(void)
+    {
+        const vector<const EventRow *> *first =
+            &EventIndex::findEvents(1, "<ANY>", true);
+        QCOMPARE((int)first->size(), 2);
+
+        // another page of the same list isn't built again
+        QCOMPARE(&EventIndex::findEvents(1, "<ANY>", true), first);
+
+        Update(4, 1, "2016-01-03 10:00:00");
+        EndRefresh();
+
+        const vector<const EventRow *> &events =
+            EventIndex::findEvents(1, "<ANY>", true);
+        QCOMPARE((int)events.size(), 3);
+        QCOMPARE(events[2]->eventID, 4);
+    }
+
+    void ChangesAreSent(void)
+    {
+        string token = EventIndex::getToken();
+
+        Update(1, 1, "2016-01-01 10:00:00", false, "Renamed");
+        Update(4, 1, "2016-01-01 12:00:00");
+        Remove(2);
+        EndRefresh();
+
+        QList<int> removed;
+        QCOMPARE(Changed(token, 1, "<ANY>", true, &removed),
+                 QList<int>() << 1 << 4);
+        QCOMPARE(removed, QList<int>() << 2);
+
+        // nothing since the new token
+        QCOMPARE(Changed(EventIndex::getToken(), 1, "<ANY>", true, &removed),
+                 QList<int>());
+        QCOMPARE(removed, QList<int>());
+    }
+
+    void EventLeavingTheListIsRemoved(void)
+    {
+        string token = EventIndex::getToken();
+
+        // moved to another day, and made continuous
+        Update(1, 1, "2016-01-05 10:00:00");
+        Update(2, 1, "2016-01-02 10:00:00", true);
+        EndRefresh();
+
+        QList<int> removed;
+        QCOMPARE(Changed(token, 1, "2016-01-01", true, &removed), QList<int>());
+        QCOMPARE(removed, QList<int>() << 1);
+
+        QCOMPARE(Changed(token, -1, "<ANY>", false, &removed),
+                 QList<int>() << 1);
+        QCOMPARE(removed, QList<int>() << 2);
+    }
+
+    void EventJoiningTheListIsSent(void)
+    {
+        string token = EventIndex::getToken();
+
+        Update(2, 1, "2016-01-01 09:00:00");
+        Update(3, 2, "2016-01-01 11:00:00", false);
+        EndRefresh();
+
+        QList<int> removed;
+        QCOMPARE(Changed(token, -1, "2016-01-01", false, &removed),
+                 QList<int>() << 2 << 3);
+        QCOMPARE(removed, QList<int>());
+    }
+
+    void EventThatCameAndWentIsNotSent(void)
+    {
+        string token = EventIndex::getToken();
+
+        Update(4, 1, "2016-01-01 12:00:00");
+        EndRefresh();
+        Remove(4);
+        EndRefresh();
+
+        QList<int> removed;
+        QCOMPARE(Changed(token, 1, "<ANY>", true, &removed), QList<int>());
+        QCOMPARE(removed, QList<int>());
+    }
+
+    void OldTokenResyncs(void)
+    {
+        QCOMPARE(Changed("1:0", 1, "<ANY>", true), QList<int>() << -1);
+        QCOMPARE(Changed("1000:5", 1, "<ANY>", true), QList<int>() << -1);
+    }
+
+    /**
+     * Benchmark paging through a large list, as the event browser does.
+     *
+     * MYTHTV_ZMBENCH_EVENTS sets how many events there are, it is skipped
+     * if it isn't set. The results are printed on a line starting
+     * "ZMBENCH ".
+     */
+    void PagingBench(void)
+    {
+        QByteArray env = qgetenv("MYTHTV_ZMBENCH_EVENTS");
+        if (env.isEmpty())
+            MSKIP("Set MYTHTV_ZMBENCH_EVENTS to the number of events");
+        int count = env.toInt();
+        QVERIFY(count > 0);
+
+        Reset();
+        char startTime[20];
+        for (int x = 0; x < count; x++)
+        {
+            snprintf(startTime, sizeof(startTime), "2016-%02d-%02d %02d:%02d:00",
+                     1 + x / 20000 % 12, 1 + x / 1000 % 28, x / 60 % 24, x % 60);
+            Update(x + 1, 1 + x % 4, startTime, x % 10 == 0);
+        }
+        EndRefresh();
+
+        const int pageSize = 100;
+        QElapsedTimer timer;
+        timer.start();
+
+        int pages = 0;
+        int total = 0;
+        do
+        {
+            const vector<const EventRow *> &events =
+                EventIndex::findEvents(-1, "<ANY>", false);
+            total = events.size();
+            pages++;
+        } while (pages * pageSize < total);
+
+        qint64 elapsed = timer.nsecsElapsed();
+        printf("ZMBENCH {\"events\":%d,\"pages\":%d,\"ms\":%.1f}\n",
+               total, pages, elapsed / 1000000.0);
+    }
+};
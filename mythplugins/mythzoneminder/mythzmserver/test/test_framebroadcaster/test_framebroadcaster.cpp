@@ -0,0 +1,3 @@
+#include "test_framebroadcaster.h"
+
+QTEST_APPLESS_MAIN(TestFrameBroadcaster)
@@ -0,0 +1,213 @@
+/*
+ *  Class TestFrameBroadcaster
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+
+#include "zmserver.h"
+
+static const int kMonitorID = 7;
+static const int kWidth     = 4;
+static const int kHeight    = 2;
+static const int kFrames    = 3;
+static const int kSubpixBGR = 5;  // ZM_SUBPIX_ORDER_BGR
+
+/**
+ *  Tests the live frame cache against a ZM 1.26 style mmap file, written
+ *  here the way zmc would write it.
+ */
+class TestFrameBroadcaster: public QObject
+{
+    Q_OBJECT
+
+  private:
+    QTemporaryDir  m_dir;
+    int            m_fd;
+    size_t         m_size;
+    unsigned char *m_map;
+    SharedData26  *m_shared;
+    struct timeval *m_timestamps;
+    unsigned char *m_images;
+    MONITOR       *m_monitor;
+
+    /// Writes a frame whose pixels are all the given BGR colour
+    void WriteFrame(int index, int seconds, unsigned char b, unsigned char g,
+                    unsigned char r)
+    {
+        unsigned char *image = m_images + index * kWidth * kHeight * 3;
+        for (int x = 0; x < kWidth * kHeight; x++)
+        {
+            image[x * 3 + 0] = b;
+            image[x * 3 + 1] = g;
+            image[x * 3 + 2] = r;
+        }
+        m_timestamps[index].tv_sec = seconds;
+        m_timestamps[index].tv_usec = 0;
+        m_shared->last_write_index = index;
+    }
+
+    static bool IsColour(const LiveFrame *frame, unsigned char r,
+                         unsigned char g, unsigned char b)
+    {
+        if (frame->data.size() != (size_t) kWidth * kHeight * 3)
+            return false;
+
+        for (int x = 0; x < kWidth * kHeight; x++)
+        {
+            if (frame->data[x * 3 + 0] != r || frame->data[x * 3 + 1] != g ||
+                frame->data[x * 3 + 2] != b)
+                return false;
+        }
+        return true;
+    }
+
+  private slots:
+    // called at the beginning of these sets of tests
+    void initTestCase(void)
+    {
+        QVERIFY(m_dir.isValid());
+
+        g_majorVersion = 1;
+        g_minorVersion = 26;
+        g_revisionVersion = 0;
+    }
+
+    // called before each test case
+    void init(void)
+    {
+        // same layout as MONITOR::initMonitor() expects for ZM 1.26
+        size_t header = sizeof(SharedData26) + sizeof(TriggerData26) +
+                        kFrames * sizeof(struct timeval);
+        size_t images = (header + 15) & ~(size_t) 15;
+        m_size = sizeof(SharedData26) + sizeof(TriggerData26) +
+                 kFrames * sizeof(struct timeval) +
+                 kFrames * kWidth * kHeight * 3 + 64;
+
+        QString path = QString("%1/zm.mmap.%2").arg(m_dir.path())
+                           .arg(kMonitorID);
+        m_fd = open(path.toLocal8Bit().constData(),
+                    O_RDWR | O_CREAT | O_TRUNC, 0600);
+        QVERIFY(m_fd >= 0);
+        QCOMPARE(ftruncate(m_fd, m_size), 0);
+
+        void *map = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         m_fd, 0);
+        QVERIFY(map != MAP_FAILED);
+
+        m_map = (unsigned char *) map;
+        m_shared = (SharedData26 *) m_map;
+        m_timestamps = (struct timeval *)
+            (m_map + sizeof(SharedData26) + sizeof(TriggerData26));
+        m_images = m_map + images;
+
+        m_shared->size = sizeof(SharedData26);
+        m_shared->valid = 1;
+        m_shared->state = IDLE;
+        m_shared->format = kSubpixBGR;
+        m_shared->imagesize = kWidth * kHeight * 3;
+
+        m_monitor = new MONITOR;
+        m_monitor->mon_id = kMonitorID;
+        m_monitor->width = kWidth;
+        m_monitor->height = kHeight;
+        m_monitor->bytes_per_pixel = 3;
+        m_monitor->image_buffer_count = kFrames;
+        m_monitor->initMonitor(false, m_dir.path().toStdString(), 0);
+        QVERIFY(m_monitor->isValid());
+    }
+
+    // called after each test case
+    void cleanup(void)
+    {
+        FrameBroadcaster::clear();
+
+        munmap(m_monitor->shm_ptr, m_size);
+        close(m_monitor->mapFile);
+        delete m_monitor;
+
+        munmap(m_map, m_size);
+        close(m_fd);
+    }
+
+    void FrameIsConvertedToRGB(void)
+    {
+        WriteFrame(1, 100, 10, 20, 30);
+
+        LiveFrame *frame = FrameBroadcaster::getFrame(m_monitor);
+        QVERIFY(frame != NULL);
+        QCOMPARE(frame->index, 1);
+        QCOMPARE(frame->status, string("Idle"));
+        QVERIFY(IsColour(frame, 30, 20, 10));
+    }
+
+    void SameFrameIsConvertedOnce(void)
+    {
+        WriteFrame(0, 100, 10, 20, 30);
+        LiveFrame *first = FrameBroadcaster::getFrame(m_monitor);
+
+        // not written by zmc as a new frame, so not looked at again
+        m_images[0] = 99;
+        LiveFrame *second = FrameBroadcaster::getFrame(m_monitor);
+
+        QCOMPARE(second, first);
+        QVERIFY(IsColour(second, 30, 20, 10));
+    }
+
+    void SameSlotAfterWrappingIsNewFrame(void)
+    {
+        WriteFrame(2, 100, 10, 20, 30);
+        LiveFrame *first = FrameBroadcaster::getFrame(m_monitor);
+        QVERIFY(IsColour(first, 30, 20, 10));
+
+        // zmc has gone round the ring buffer back to the same slot
+        WriteFrame(2, 101, 1, 2, 3);
+        LiveFrame *second = FrameBroadcaster::getFrame(m_monitor);
+
+        // nobody else holds the old frame, so its buffer is reused
+        QCOMPARE(second, first);
+        QVERIFY(IsColour(second, 3, 2, 1));
+    }
+
+    void FrameBeingSentIsKept(void)
+    {
+        WriteFrame(0, 100, 10, 20, 30);
+        LiveFrame *sending = FrameBroadcaster::getFrame(m_monitor);
+        sending->incrRef();
+
+        WriteFrame(1, 101, 1, 2, 3);
+        LiveFrame *latest = FrameBroadcaster::getFrame(m_monitor);
+
+        QVERIFY(latest != sending);
+        QVERIFY(IsColour(sending, 30, 20, 10));
+        QVERIFY(IsColour(latest, 3, 2, 1));
+
+        sending->decrRef();
+    }
+
+    void BadWriteIndexHasNoFrame(void)
+    {
+        m_shared->last_write_index = kFrames;
+        QVERIFY(FrameBroadcaster::getFrame(m_monitor) == NULL);
+    }
+};
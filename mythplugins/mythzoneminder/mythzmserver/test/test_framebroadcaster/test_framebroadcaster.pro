@@ -0,0 +1,29 @@
+include ( ../../../../mythconfig.mak )
+include ( ../../../../settings.pro )
+
+contains(QT_VERSION, ^4\\.[0-9]\\..*) {
+CONFIG += qtestlib
+}
+contains(QT_VERSION, ^5\\.[0-9]\\..*) {
+QT += testlib
+}
+
+TEMPLATE = app
+TARGET = test_framebroadcaster
+DEPENDPATH += . ../..
+INCLUDEPATH += . ../..
+
+QMAKE_LIBS += $$system(mysql_config --libs)
+
+linux: DEFINES += linux
+
+# Input
+HEADERS += test_framebroadcaster.h
+SOURCES += test_framebroadcaster.cpp
+
+# The server is a single program, its code is built in here
+HEADERS += ../../zmserver.h
+SOURCES += ../../zmserver.cpp
+
+QMAKE_CLEAN += $(TARGET) $(TARGETA) $(TARGETD) $(TARGET0) $(TARGET1) $(TARGET2)
+QMAKE_CLEAN += ; rm -f *.gcov *.gcda *.gcno
@@ -18,8 +18,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <climits>
+#include <algorithm>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/stat.h>
@@ -49,11 +52,21 @@
 #include "zmserver.h"
 
 // the version of the protocol we understand
-#define ZM_PROTOCOL_VERSION "11"
+#define ZM_PROTOCOL_VERSION "12"
 
 // the maximum image size we are ever likely to get from ZM
 #define MAX_IMAGE_SIZE  (2048*1536*3)
 
+// the most chunks of queued output handed to the kernel in one call
+#define MAX_IOVECS 16
+
+// the most event changes remembered for clients catching up, a client
+// that is further behind reloads the whole event list
+#define MAX_EVENT_CHANGES 50000
+
+// the most filtered event lists kept for paging through
+#define MAX_EVENT_LISTS 16
+
 #define ADD_STR(list,s)  list += s; list += "[]:[]";
 // TODO rewrite after we require C++11, see http://en.cppreference.com/w/cpp/string/basic_string/to_string
 #define ADD_INT(list,n)  sprintf(m_buf, "%d", (int)n); list += m_buf; list += "[]:[]";
@@ -233,7 +246,7 @@ MONITOR::MONITOR(void) :
     image_buffer_count(0),  width(0), height(0), bytes_per_pixel(3), mon_id(0),
     shared_images(NULL), last_read(0), status(""), palette(0),
     controllable(0), trackMotion(0), mapFile(-1), shm_ptr(NULL),
-    shared_data(NULL), shared_data26(NULL), id("")
+    shared_data(NULL), shared_data26(NULL), shared_timestamps(NULL), id("")
 {
 }
 
@@ -343,6 +356,9 @@ void MONITOR::initMonitor(bool debug, string mmapPath, int shmKey)
         shared_data = NULL;
         shared_data26 = (SharedData26*)shm_ptr;
 
+        shared_timestamps = (struct timeval *) ((unsigned char*) shm_ptr +
+            sizeof(SharedData26) + sizeof(TriggerData26));
+
         shared_images = (unsigned char*) shm_ptr +
             sizeof(SharedData26) + sizeof(TriggerData26) +
             ((image_buffer_count) * sizeof(struct timeval));
@@ -358,6 +374,9 @@ void MONITOR::initMonitor(bool debug, string mmapPath, int shmKey)
         shared_data26 = NULL;
         shared_data = (SharedData*)shm_ptr;
 
+        shared_timestamps = (struct timeval *) ((unsigned char*) shm_ptr +
+            sizeof(SharedData) + sizeof(TriggerData));
+
         shared_images = (unsigned char*) shm_ptr +
             sizeof(SharedData) + sizeof(TriggerData) +
             ((image_buffer_count) * sizeof(struct timeval));
@@ -422,6 +441,656 @@ int MONITOR::getFrameSize(void)
     return shared_data26->imagesize;
 }
 
+struct timeval MONITOR::getImageTime(int index)
+{
+    return shared_timestamps[index];
+}
+
+///////////////////////////////////////////////////////////////////////
+
+LiveFrame::LiveFrame(void) :
+    index(-1), status(""), m_refs(1)
+{
+    timestamp.tv_sec = 0;
+    timestamp.tv_usec = 0;
+}
+
+void LiveFrame::decrRef(void)
+{
+    if (--m_refs == 0)
+        delete this;
+}
+
+///////////////////////////////////////////////////////////////////////
+
+map<int, LiveFrame *> FrameBroadcaster::s_frames;
+
+// returns the latest frame of the monitor, converting it only if no client
+// has asked for it yet, or NULL if ZM hasn't written a frame yet
+LiveFrame *FrameBroadcaster::getFrame(MONITOR *monitor)
+{
+    int index = monitor->getLastWriteIndex();
+
+    // sanity check the write index
+    if (index < 0 || index >= monitor->image_buffer_count)
+        return NULL;
+
+    // the timestamp tells a new frame apart from one which happens to be
+    // in the same slot after ZM has gone round the whole ring buffer
+    struct timeval timestamp = monitor->getImageTime(index);
+
+    LiveFrame *frame = NULL;
+    map<int, LiveFrame *>::iterator it = s_frames.find(monitor->mon_id);
+    if (it != s_frames.end())
+        frame = it->second;
+
+    if (frame && frame->index == index &&
+        frame->timestamp.tv_sec == timestamp.tv_sec &&
+        frame->timestamp.tv_usec == timestamp.tv_usec)
+    {
+        return frame;
+    }
+
+    // clients still sending the previous frame keep their own reference
+    // to it, otherwise its buffer is reused
+    if (!frame || frame->isShared())
+    {
+        if (frame)
+            frame->decrRef();
+        frame = new LiveFrame;
+        s_frames[monitor->mon_id] = frame;
+    }
+
+    frame->index = index;
+    frame->timestamp = timestamp;
+
+    switch (monitor->getState())
+    {
+        case IDLE:
+            frame->status = "Idle";
+            break;
+        case PREALARM:
+            frame->status = "Pre Alarm";
+            break;
+        case ALARM:
+            frame->status = "Alarm";
+            break;
+        case ALERT:
+            frame->status = "Alert";
+            break;
+        case TAPE:
+            frame->status = "Tape";
+            break;
+        default:
+            frame->status = "Unknown";
+            break;
+    }
+
+    frame->data.resize(monitor->width * monitor->height * 3);
+    if (!frame->data.empty())
+        convertFrame(monitor, index, &frame->data[0]);
+
+    return frame;
+}
+
+void FrameBroadcaster::clear(void)
+{
+    for (map<int, LiveFrame *>::iterator it = s_frames.begin();
+         it != s_frames.end(); ++it)
+    {
+        it->second->decrRef();
+    }
+
+    s_frames.clear();
+}
+
+///////////////////////////////////////////////////////////////////////
+
+map<int, map<EventKey, EventRow> > EventIndex::s_events;
+map<int, EventRow *>               EventIndex::s_eventsByID;
+map<int, map<string, int> >        EventIndex::s_dates;
+set<int>                           EventIndex::s_openEvents;
+map<int, string>                   EventIndex::s_monitorNames;
+deque<EventChange>                 EventIndex::s_changes;
+map<string, vector<const EventRow *> > EventIndex::s_lists;
+int                                EventIndex::s_listsGeneration = 0;
+int                                EventIndex::s_generation = 0;
+int                                EventIndex::s_trimmedGeneration = 0;
+int                                EventIndex::s_maxEventID = 0;
+int                                EventIndex::s_sweepFrom = 0;
+time_t                             EventIndex::s_started = 0;
+time_t                             EventIndex::s_lastRefresh = 0;
+bool                               EventIndex::s_loaded = false;
+
+// returns false if the database couldn't be read
+bool EventIndex::refresh(bool debug)
+{
+    time_t now = time(NULL);
+
+    if (s_loaded && now - s_lastRefresh < EVENT_INDEX_REFRESH_TIME)
+        return true;
+
+    if (s_started == 0)
+        s_started = now;
+
+    if (!loadMonitorNames())
+        return false;
+
+    if (!s_loaded)
+    {
+        if (!loadEvents("", debug))
+            return false;
+
+        s_loaded = true;
+    }
+    else
+    {
+        // new events, and those that were still being recorded last time
+        stringstream where;
+        where << "WHERE E.Id > " << s_maxEventID;
+
+        if (!s_openEvents.empty())
+        {
+            where << " OR E.Id IN (";
+            for (set<int>::iterator it = s_openEvents.begin();
+                 it != s_openEvents.end(); ++it)
+            {
+                if (it != s_openEvents.begin())
+                    where << ",";
+                where << *it;
+            }
+            where << ")";
+        }
+
+        if (!loadEvents(where.str(), debug) || !checkRemoved(debug) ||
+            !sweepEvents(debug))
+        {
+            return false;
+        }
+    }
+
+    s_lastRefresh = now;
+
+    endRefresh();
+
+    return true;
+}
+
+// the changes made since the last refresh become the next generation
+void EventIndex::endRefresh(void)
+{
+    if (!s_changes.empty() && s_changes.back().generation > s_generation)
+        s_generation++;
+}
+
+bool EventIndex::loadMonitorNames(void)
+{
+    if (mysql_query(&g_dbConn, "SELECT Id, Name FROM Monitors"))
+    {
+        fprintf(stderr, "%s\n", mysql_error(&g_dbConn));
+        return false;
+    }
+
+    MYSQL_RES *res = mysql_store_result(&g_dbConn);
+    MYSQL_ROW row;
+
+    s_monitorNames.clear();
+    while ((row = mysql_fetch_row(res)))
+        s_monitorNames[atoi(row[0])] = row[1] ? row[1] : "";
+
+    mysql_free_result(res);
+
+    return true;
+}
+
+bool EventIndex::loadEvents(const string &where, bool debug, set<int> *seen)
+{
+    string sql("SELECT E.Id, E.Name, E.MonitorId, E.StartTime, E.Length, "
+               "E.Cause, E.EndTime IS NULL OR E.EndTime = 0 "
+               "FROM Events AS E ");
+    sql += where;
+
+    if (mysql_query(&g_dbConn, sql.c_str()))
+    {
+        fprintf(stderr, "%s\n", mysql_error(&g_dbConn));
+        return false;
+    }
+
+    MYSQL_RES *res = mysql_store_result(&g_dbConn);
+    MYSQL_ROW row;
+
+    if (debug)
+        cout << "Event index loaded " << mysql_num_rows(res) << " events" << endl;
+
+    while ((row = mysql_fetch_row(res)))
+    {
+        EventRow event;
+        event.eventID = atoi(row[0]);
+        event.name = row[1] ? row[1] : "";
+        event.monitorID = atoi(row[2]);
+        event.startTime = row[3] ? row[3] : "";
+        event.length = row[4] ? row[4] : "";
+        event.continuous = (row[5] && strcmp(row[5], "Continuous") == 0);
+        event.open = (row[6] && atoi(row[6]) != 0);
+
+        if (seen)
+            seen->insert(event.eventID);
+
+        updateEvent(event);
+    }
+
+    mysql_free_result(res);
+
+    return true;
+}
+
+// a monitor that has the number of events we think it has is assumed not
+// to have lost any, anything this misses is caught by the sweep
+bool EventIndex::checkRemoved(bool debug)
+{
+    if (mysql_query(&g_dbConn,
+                    "SELECT MonitorId, COUNT(*) FROM Events GROUP BY MonitorId"))
+    {
+        fprintf(stderr, "%s\n", mysql_error(&g_dbConn));
+        return false;
+    }
+
+    MYSQL_RES *res = mysql_store_result(&g_dbConn);
+    MYSQL_ROW row;
+    map<int, uint> counts;
+
+    while ((row = mysql_fetch_row(res)))
+        counts[atoi(row[0])] = atoi(row[1]);
+
+    mysql_free_result(res);
+
+    set<int> monitors;
+    stringstream changed;
+    for (map<int, map<EventKey, EventRow> >::iterator it = s_events.begin();
+         it != s_events.end(); ++it)
+    {
+        if (it->second.empty() || counts[it->first] == it->second.size())
+            continue;
+
+        if (!monitors.empty())
+            changed << ",";
+        changed << it->first;
+        monitors.insert(it->first);
+    }
+
+    if (monitors.empty())
+        return true;
+
+    if (debug)
+        cout << "Looking for removed events from monitors: " << changed.str() << endl;
+
+    string sql("SELECT Id FROM Events WHERE MonitorId IN (");
+    sql += changed.str() + ")";
+
+    if (mysql_query(&g_dbConn, sql.c_str()))
+    {
+        fprintf(stderr, "%s\n", mysql_error(&g_dbConn));
+        return false;
+    }
+
+    res = mysql_store_result(&g_dbConn);
+    set<int> present;
+
+    while ((row = mysql_fetch_row(res)))
+        present.insert(atoi(row[0]));
+
+    mysql_free_result(res);
+
+    vector<int> gone;
+    for (map<int, EventRow *>::iterator it = s_eventsByID.begin();
+         it != s_eventsByID.end(); ++it)
+    {
+        if (monitors.find(it->second->monitorID) != monitors.end() &&
+            present.find(it->first) == present.end())
+        {
+            gone.push_back(it->first);
+        }
+    }
+
+    for (uint x = 0; x < gone.size(); x++)
+        removeEvent(gone[x]);
+
+    return true;
+}
+
+// Rereads the next EVENT_INDEX_SWEEP_SIZE events, in Id order, to catch
+// renamed events and the like. Reading the whole table at once would keep
+// every client waiting while it was done.
+bool EventIndex::sweepEvents(bool debug)
+{
+    stringstream where;
+    where << "WHERE E.Id > " << s_sweepFrom
+          << " ORDER BY E.Id LIMIT " << EVENT_INDEX_SWEEP_SIZE;
+
+    set<int> seen;
+    if (!loadEvents(where.str(), debug, &seen))
+        return false;
+
+    // a short read reached the end of the table, so nothing we have past
+    // what was read is still there either
+    bool wrapped = (seen.size() < EVENT_INDEX_SWEEP_SIZE);
+    int last = seen.empty() ? s_sweepFrom : *seen.rbegin();
+
+    vector<int> gone;
+    for (map<int, EventRow *>::iterator it =
+             s_eventsByID.upper_bound(s_sweepFrom);
+         it != s_eventsByID.end() && (wrapped || it->first <= last); ++it)
+    {
+        if (seen.find(it->first) == seen.end())
+            gone.push_back(it->first);
+    }
+
+    for (uint x = 0; x < gone.size(); x++)
+        removeEvent(gone[x]);
+
+    s_sweepFrom = wrapped ? 0 : last;
+
+    return true;
+}
+
+void EventIndex::updateEvent(const EventRow &row)
+{
+    if (row.eventID > s_maxEventID)
+        s_maxEventID = row.eventID;
+
+    EventRow before;
+    map<int, EventRow *>::iterator it = s_eventsByID.find(row.eventID);
+    bool existed = (it != s_eventsByID.end());
+
+    if (existed)
+    {
+        EventRow *event = it->second;
+        before = *event;
+
+        if (event->monitorID == row.monitorID &&
+            event->startTime == row.startTime)
+        {
+            if (event->name == row.name && event->length == row.length &&
+                event->continuous == row.continuous && event->open == row.open)
+            {
+                return;
+            }
+
+            event->name = row.name;
+            event->length = row.length;
+            event->continuous = row.continuous;
+            event->open = row.open;
+
+            if (!row.open)
+                s_openEvents.erase(row.eventID);
+
+            logChange(&before, event);
+            return;
+        }
+
+        // it has moved, take it out of its old place
+        eraseEvent(it);
+    }
+
+    EventRow &event =
+        s_events[row.monitorID][EventKey(row.startTime, row.eventID)];
+    event = row;
+    s_eventsByID[row.eventID] = &event;
+    s_dates[row.monitorID][row.startTime.substr(0, 10)]++;
+
+    if (row.open)
+        s_openEvents.insert(row.eventID);
+
+    logChange(existed ? &before : NULL, &event);
+}
+
+void EventIndex::removeEvent(int eventID)
+{
+    map<int, EventRow *>::iterator it = s_eventsByID.find(eventID);
+    if (it == s_eventsByID.end())
+        return;
+
+    logChange(it->second, NULL);
+    eraseEvent(it);
+}
+
+void EventIndex::eraseEvent(map<int, EventRow *>::iterator it)
+{
+    EventRow *event = it->second;
+    int eventID = it->first;
+
+    map<string, int> &dates = s_dates[event->monitorID];
+    string date = event->startTime.substr(0, 10);
+    if (--dates[date] <= 0)
+        dates.erase(date);
+
+    s_openEvents.erase(eventID);
+    s_eventsByID.erase(it);
+    s_events[event->monitorID].erase(EventKey(event->startTime, eventID));
+}
+
+// before is NULL for a new event and after is NULL for a removed one
+void EventIndex::logChange(const EventRow *before, const EventRow *after)
+{
+    // nobody can be catching up with the first load
+    if (!s_loaded)
+        return;
+
+    EventChange change;
+    change.generation = s_generation + 1;
+    change.eventID = before ? before->eventID : after->eventID;
+    change.existed = (before != NULL);
+    change.oldMonitorID = before ? before->monitorID : 0;
+    change.oldStartTime = before ? before->startTime : "";
+    change.oldContinuous = before ? before->continuous : false;
+    change.removed = (after == NULL);
+    change.monitorID = after ? after->monitorID : 0;
+    change.startTime = after ? after->startTime : "";
+    change.continuous = after ? after->continuous : false;
+    s_changes.push_back(change);
+
+    while (s_changes.size() > MAX_EVENT_CHANGES)
+    {
+        s_trimmedGeneration = s_changes.front().generation;
+        s_changes.pop_front();
+    }
+}
+
+// returns -1 for <ANY> and -2 if there is no such monitor
+int EventIndex::getMonitorID(const string &monitorName)
+{
+    if (monitorName == "<ANY>")
+        return -1;
+
+    for (map<int, string>::iterator it = s_monitorNames.begin();
+         it != s_monitorNames.end(); ++it)
+    {
+        if (it->second == monitorName)
+            return it->first;
+    }
+
+    return -2;
+}
+
+string EventIndex::getMonitorName(int monitorID)
+{
+    map<int, string>::iterator it = s_monitorNames.find(monitorID);
+    if (it != s_monitorNames.end())
+        return it->second;
+
+    return "";
+}
+
+// as before, continuous events are only left out when showing all monitors
+bool EventIndex::matches(int monitorID, const string &startTime,
+                         bool continuous, int wantMonitorID,
+                         const string &date, bool includeContinuous)
+{
+    if (wantMonitorID != -1 && monitorID != wantMonitorID)
+        return false;
+
+    if (date != "<ANY>" && startTime.compare(0, 10, date) != 0)
+        return false;
+
+    if (wantMonitorID == -1 && !includeContinuous && continuous)
+        return false;
+
+    return true;
+}
+
+static bool earlierEvent(const EventRow *a, const EventRow *b)
+{
+    if (a->startTime != b->startTime)
+        return a->startTime < b->startTime;
+
+    return a->eventID < b->eventID;
+}
+
+// Returns the matching events, oldest first. The list is kept until the
+// index next changes so a client paging through it doesn't have it built
+// again for every page.
+const vector<const EventRow *> &EventIndex::findEvents(int monitorID,
+                                                       const string &date,
+                                                       bool includeContinuous)
+{
+    if (s_listsGeneration != s_generation || s_lists.size() >= MAX_EVENT_LISTS)
+    {
+        s_lists.clear();
+        s_listsGeneration = s_generation;
+    }
+
+    stringstream key;
+    key << monitorID << ":" << includeContinuous << ":" << date;
+
+    map<string, vector<const EventRow *> >::iterator cached =
+        s_lists.find(key.str());
+    if (cached != s_lists.end())
+        return cached->second;
+
+    vector<const EventRow *> &events = s_lists[key.str()];
+
+    for (map<int, map<EventKey, EventRow> >::iterator it = s_events.begin();
+         it != s_events.end(); ++it)
+    {
+        if (monitorID != -1 && it->first != monitorID)
+            continue;
+
+        map<EventKey, EventRow>::iterator first = it->second.begin();
+        map<EventKey, EventRow>::iterator last = it->second.end();
+
+        // the events of one day are next to each other
+        if (date != "<ANY>")
+        {
+            first = it->second.lower_bound(EventKey(date, 0));
+            last = it->second.lower_bound(EventKey(date + "~", 0));
+        }
+
+        size_t merged = events.size();
+
+        for (; first != last; ++first)
+        {
+            const EventRow &event = first->second;
+            if (matches(event.monitorID, event.startTime, event.continuous,
+                        monitorID, date, includeContinuous))
+            {
+                events.push_back(&event);
+            }
+        }
+
+        // each monitor's events are already in order
+        inplace_merge(events.begin(), events.begin() + merged, events.end(),
+                      earlierEvent);
+    }
+
+    return events;
+}
+
+void EventIndex::findDates(int monitorID, bool oldestFirst,
+                           vector<string> &dates)
+{
+    set<string> found;
+
+    for (map<int, map<string, int> >::iterator it = s_dates.begin();
+         it != s_dates.end(); ++it)
+    {
+        if (monitorID != -1 && it->first != monitorID)
+            continue;
+
+        for (map<string, int>::iterator dit = it->second.begin();
+             dit != it->second.end(); ++dit)
+        {
+            found.insert(dit->first);
+        }
+    }
+
+    dates.assign(found.begin(), found.end());
+
+    if (!oldestFirst)
+        reverse(dates.begin(), dates.end());
+}
+
+string EventIndex::getToken(void)
+{
+    stringstream token;
+    token << s_started << ":" << s_generation;
+    return token.str();
+}
+
+// returns false if the token is too old, or from before a restart, and
+// the client has to reload the whole list
+bool EventIndex::findChanges(const string &token, int monitorID,
+                             const string &date, bool includeContinuous,
+                             vector<const EventRow *> &changed,
+                             vector<int> &removed)
+{
+    changed.clear();
+    removed.clear();
+
+    long long started;
+    int generation;
+    if (sscanf(token.c_str(), "%20lld:%10d", &started, &generation) != 2 ||
+        started != (long long) s_started || generation > s_generation ||
+        generation < s_trimmedGeneration)
+    {
+        return false;
+    }
+
+    // the client has each event as it was before the first change since
+    // the token, and needs it as it is after the last
+    map<int, pair<const EventChange *, const EventChange *> > events;
+    for (deque<EventChange>::reverse_iterator it = s_changes.rbegin();
+         it != s_changes.rend() && it->generation > generation; ++it)
+    {
+        pair<const EventChange *, const EventChange *> &event =
+            events[it->eventID];
+        if (!event.second)
+            event.second = &(*it);
+        event.first = &(*it);
+    }
+
+    for (map<int, pair<const EventChange *, const EventChange *> >::iterator
+             it = events.begin(); it != events.end(); ++it)
+    {
+        const EventChange *first = it->second.first;
+        const EventChange *last = it->second.second;
+
+        bool wasListed = first->existed &&
+            matches(first->oldMonitorID, first->oldStartTime,
+                    first->oldContinuous, monitorID, date, includeContinuous);
+        bool isListed = !last->removed &&
+            matches(last->monitorID, last->startTime, last->continuous,
+                    monitorID, date, includeContinuous);
+
+        map<int, EventRow *>::iterator eit = s_eventsByID.find(it->first);
+        if (isListed && eit != s_eventsByID.end())
+            changed.push_back(eit->second);
+        else if (isListed || wasListed)
+            removed.push_back(it->first);
+    }
+
+    return true;
+}
+
 ///////////////////////////////////////////////////////////////////////
 
 ZMServer::ZMServer(int sock, bool debug)
@@ -431,6 +1100,8 @@ ZMServer::ZMServer(int sock, bool debug)
 
     m_sock = sock;
     m_debug = debug;
+    m_outOffset = 0;
+    m_sendFailed = false;
 
     // get the shared memory key
     char buf[100];
@@ -499,6 +1170,9 @@ ZMServer::ZMServer(int sock, bool debug)
 
 ZMServer::~ZMServer()
 {
+    while (!m_outQueue.empty())
+        popChunk();
+
     for (uint x = 0; x < m_monitors.size(); x++)
     {
         MONITOR *mon = m_monitors.at(x);
@@ -577,6 +1251,8 @@ bool ZMServer::processRequest(char* buf, int nbytes)
         handleGetAlarmStates();
     else if (tokens[0] == "GET_EVENT_LIST")
         handleGetEventList(tokens);
+    else if (tokens[0] == "GET_EVENT_CHANGES")
+        handleGetEventChanges(tokens);
     else if (tokens[0] == "GET_EVENT_DATES")
         handleGetEventDates(tokens);
     else if (tokens[0] == "GET_EVENT_FRAME")
@@ -605,45 +1281,181 @@ bool ZMServer::processRequest(char* buf, int nbytes)
     return false;
 }
 
-bool ZMServer::send(const string &s) const
+// the length of the message goes first, followed by the message and any
+// data that goes with it
+static string makeHeader(const string &s)
 {
-    // send length
-    size_t len = s.size();
     char buf[9];
-    sprintf(buf, "%8u", (unsigned int) len);
-    int status = ::send(m_sock, buf, 8, MSG_NOSIGNAL);
-    if (status == -1)
-        return false;
+    sprintf(buf, "%8u", (unsigned int) s.size());
+    return string(buf, 8);
+}
 
-    // send message
-    status = ::send(m_sock, s.c_str(), s.size(), MSG_NOSIGNAL);
-    if ( status == -1 )
-        return false;
+bool ZMServer::send(const string &s)
+{
+    queueString(makeHeader(s) + s);
+    return flush();
+}
+
+// the buffer is written straight to the socket, only what it won't take
+// now is copied to be sent later
+bool ZMServer::send(const string &s, const unsigned char *buffer, int dataLen)
+{
+    string header = makeHeader(s) + s;
+    size_t sent = 0;
+
+    if (m_outQueue.empty() && !m_sendFailed)
+    {
+        struct iovec iov[2];
+        iov[0].iov_base = (void *) header.data();
+        iov[0].iov_len = header.size();
+        iov[1].iov_base = (void *) buffer;
+        iov[1].iov_len = dataLen;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+
+        ssize_t len;
+        do
+            len = sendmsg(m_sock, &msg, MSG_NOSIGNAL);
+        while (len == -1 && errno == EINTR);
+
+        if (len == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            if (m_debug)
+                cout << "Failed to send to socket " << m_sock << " : "
+                     << strerror(errno) << endl;
+            m_sendFailed = true;
+            return false;
+        }
+
+        if (len > 0)
+            sent = len;
+    }
+
+    if (sent < header.size())
+    {
+        queueString(header.substr(sent));
+        sent = 0;
+    }
     else
-        return true;
+    {
+        sent -= header.size();
+    }
+
+    if (sent < (size_t) dataLen)
+        queueString(string((const char *) buffer + sent, dataLen - sent));
+
+    return flush();
 }
 
-bool ZMServer::send(const string &s, const unsigned char *buffer, int dataLen) const
+bool ZMServer::send(const string &s, LiveFrame *frame)
 {
-    // send length
-    size_t len = s.size();
-    char buf[9];
-    sprintf(buf, "%8u", (unsigned int) len);
-    int status = ::send(m_sock, buf, 8, MSG_NOSIGNAL);
-    if (status == -1)
-        return false;
+    queueString(makeHeader(s) + s);
 
-    // send message
-    status = ::send(m_sock, s.c_str(), s.size(), MSG_NOSIGNAL);
-    if ( status == -1 )
-        return false;
+    // the frame is shared with the other clients, not copied
+    OutChunk chunk;
+    chunk.frame = frame;
+    frame->incrRef();
+    m_outQueue.push_back(chunk);
 
-    // send data
-    status = ::send(m_sock, buffer, dataLen, MSG_NOSIGNAL);
-    if ( status == -1 )
-        return false;
+    return flush();
+}
 
-    return true;
+void ZMServer::queueString(const string &s)
+{
+    OutChunk chunk;
+    chunk.str = s;
+    chunk.frame = NULL;
+    m_outQueue.push_back(chunk);
+}
+
+void ZMServer::popChunk(void)
+{
+    if (m_outQueue.front().frame)
+        m_outQueue.front().frame->decrRef();
+    m_outQueue.pop_front();
+    m_outOffset = 0;
+}
+
+static void chunkData(const OutChunk &chunk, const unsigned char *&data,
+                      size_t &size)
+{
+    if (chunk.frame)
+    {
+        data = chunk.frame->data.empty() ? NULL : &chunk.frame->data[0];
+        size = chunk.frame->data.size();
+    }
+    else
+    {
+        data = (const unsigned char *) chunk.str.data();
+        size = chunk.str.size();
+    }
+}
+
+bool ZMServer::flush(void)
+{
+    while (!m_sendFailed && !m_outQueue.empty())
+    {
+        struct iovec iov[MAX_IOVECS];
+        int count = 0;
+
+        for (deque<OutChunk>::const_iterator it = m_outQueue.begin();
+             it != m_outQueue.end() && count < MAX_IOVECS; ++it, ++count)
+        {
+            const unsigned char *data;
+            size_t size;
+            chunkData(*it, data, size);
+
+            size_t skip = (count == 0) ? m_outOffset : 0;
+            iov[count].iov_base = (void *) (data + skip);
+            iov[count].iov_len = size - skip;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        ssize_t sent = sendmsg(m_sock, &msg, MSG_NOSIGNAL);
+        if (sent == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // the socket is full, the rest goes when it has drained
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+
+            if (m_debug)
+                cout << "Failed to send to socket " << m_sock << " : "
+                     << strerror(errno) << endl;
+            m_sendFailed = true;
+            break;
+        }
+
+        // drop whatever has been sent completely
+        size_t left = sent;
+        while (!m_outQueue.empty())
+        {
+            const unsigned char *data;
+            size_t size;
+            chunkData(m_outQueue.front(), data, size);
+
+            size_t rest = size - m_outOffset;
+            if (left < rest)
+            {
+                m_outOffset += left;
+                break;
+            }
+
+            left -= rest;
+            popChunk();
+        }
+    }
+
+    return !m_sendFailed;
 }
 
 void ZMServer::sendError(string error)
@@ -748,11 +1560,27 @@ void ZMServer::handleGetAlarmStates(void)
     send(outStr);
 }
 
+void ZMServer::addEvent(string &outStr, const EventRow *event)
+{
+    string startTime = event->startTime;
+    if (startTime.size() > 10)
+        startTime[10] = 'T';
+
+    ADD_INT(outStr, event->eventID)
+    ADD_STR(outStr, event->name)
+    ADD_INT(outStr, event->monitorID)
+    ADD_STR(outStr, EventIndex::getMonitorName(event->monitorID))
+    ADD_STR(outStr, startTime)
+    ADD_STR(outStr, event->length)
+}
+
+// the optional offset and count ask for one page of the list, the reply
+// then starts with the size of the whole list
 void ZMServer::handleGetEventList(vector<string> tokens)
 {
     string outStr("");
 
-    if (tokens.size() != 5)
+    if (tokens.size() != 5 && tokens.size() != 7)
     {
         sendError(ERROR_TOKEN_COUNT);
         return;
@@ -762,83 +1590,107 @@ void ZMServer::handleGetEventList(vector<string> tokens)
     bool oldestFirst = (tokens[2] == "1");
     string date = tokens[3];
     bool includeContinuous = (tokens[4] == "1");
+    bool paged = (tokens.size() == 7);
 
     if (m_debug)
         cout << "Loading events for monitor: " << monitor << ", date: " << date << endl;
 
-    ADD_STR(outStr, "OK")
+    if (!EventIndex::refresh(m_debug))
+    {
+        sendError(ERROR_MYSQL_QUERY);
+        return;
+    }
 
-    MYSQL_RES *res;
-    MYSQL_ROW row;
+    const vector<const EventRow *> &events =
+        EventIndex::findEvents(EventIndex::getMonitorID(monitor), date,
+                               includeContinuous);
 
-    string sql("SELECT E.Id, E.Name, M.Id AS MonitorID, M.Name AS MonitorName, E.StartTime,  "
-            "E.Length, M.Width, M.Height, M.DefaultRate, M.DefaultScale "
-            "from Events as E inner join Monitors as M on E.MonitorId = M.Id ");
+    int total = events.size();
+    int first = 0;
+    int eventCount = total;
 
-    if (monitor != "<ANY>")
+    if (paged)
     {
-        sql += "WHERE M.Name = '" + monitor + "' ";
-
-        if (date != "<ANY>")
-            sql += "AND DATE(E.StartTime) = DATE('" + date + "') ";
+        first = min(max(atoi(tokens[5].c_str()), 0), total);
+        eventCount = min(max(atoi(tokens[6].c_str()), 0), total - first);
     }
-    else
+
+    if (m_debug)
+        cout << "Got " << eventCount << " of " << total << " events" << endl;
+
+    ADD_STR(outStr, "OK")
+
+    if (paged)
     {
-        if (date != "<ANY>")
-        {
-            sql += "WHERE DATE(E.StartTime) = DATE('" + date + "') ";
+        ADD_INT(outStr, total)
+    }
 
-            if (!includeContinuous)
-                sql += "AND Cause != 'Continuous' ";
-        }
-        else
-            if (!includeContinuous)
-                sql += "WHERE Cause != 'Continuous' ";
+    ADD_INT(outStr, eventCount)
+
+    for (int x = first; x < first + eventCount; x++)
+        addEvent(outStr, events[oldestFirst ? x : total - 1 - x]);
+
+    send(outStr);
+}
+
+// Sends the events that were added, changed or removed since the client
+// was given the token, or RESYNC if it has to reload the whole list. The
+// reply always carries the token to use next time.
+void ZMServer::handleGetEventChanges(vector<string> tokens)
+{
+    string outStr("");
+
+    if (tokens.size() != 5)
+    {
+        sendError(ERROR_TOKEN_COUNT);
+        return;
     }
 
-    if (oldestFirst)
-        sql += "ORDER BY E.StartTime ASC";
-    else
-        sql += "ORDER BY E.StartTime DESC";
+    string monitor = tokens[1];
+    string date = tokens[2];
+    bool includeContinuous = (tokens[3] == "1");
+    string token = tokens[4];
 
-    if (mysql_query(&g_dbConn, sql.c_str()))
+    if (m_debug)
+        cout << "Loading event changes for monitor: " << monitor
+             << ", date: " << date << ", since: " << token << endl;
+
+    if (!EventIndex::refresh(m_debug))
     {
-        fprintf(stderr, "%s\n", mysql_error(&g_dbConn));
         sendError(ERROR_MYSQL_QUERY);
         return;
     }
 
-    res = mysql_store_result(&g_dbConn);
-    int eventCount = mysql_num_rows(res);
+    ADD_STR(outStr, "OK")
+    ADD_STR(outStr, EventIndex::getToken())
+
+    vector<const EventRow *> changed;
+    vector<int> removed;
+
+    if (!EventIndex::findChanges(token, EventIndex::getMonitorID(monitor),
+                                 date, includeContinuous, changed, removed))
+    {
+        ADD_STR(outStr, "RESYNC")
+        send(outStr);
+        return;
+    }
 
     if (m_debug)
-        cout << "Got " << eventCount << " events" << endl;
+        cout << "Got " << changed.size() << " changed and "
+             << removed.size() << " removed events" << endl;
 
-    ADD_INT(outStr, eventCount)
+    ADD_STR(outStr, "DELTA")
 
-    for (int x = 0; x < eventCount; x++)
+    ADD_INT(outStr, changed.size())
+    for (uint x = 0; x < changed.size(); x++)
+        addEvent(outStr, changed[x]);
+
+    ADD_INT(outStr, removed.size())
+    for (uint x = 0; x < removed.size(); x++)
     {
-        row = mysql_fetch_row(res);
-        if (row)
-        {
-            ADD_STR(outStr, row[0]) // eventID
-            ADD_STR(outStr, row[1]) // event name
-            ADD_STR(outStr, row[2]) // monitorID
-            ADD_STR(outStr, row[3]) // monitor name
-            row[4][10] = 'T';
-            ADD_STR(outStr, row[4]) // start time
-            ADD_STR(outStr, row[5]) // length
-        }
-        else
-        {
-            cout << "Failed to get mysql row" << endl;
-            sendError(ERROR_MYSQL_ROW);
-            return;
-        }
+        ADD_INT(outStr, removed[x])
     }
 
-    mysql_free_result(res);
-
     send(outStr);
 }
 
@@ -858,54 +1710,27 @@ void ZMServer::handleGetEventDates(vector<string> tokens)
     if (m_debug)
         cout << "Loading event dates for monitor: " << monitor << endl;
 
-    ADD_STR(outStr, "OK")
-
-    MYSQL_RES *res;
-    MYSQL_ROW row;
-
-    string sql("SELECT DISTINCT DATE(E.StartTime) "
-            "from Events as E inner join Monitors as M on E.MonitorId = M.Id ");
-
-    if (monitor != "<ANY>")
-        sql += "WHERE M.Name = '" + monitor + "' ";
-
-    if (oldestFirst)
-        sql += "ORDER BY E.StartTime ASC";
-    else
-        sql += "ORDER BY E.StartTime DESC";
-
-    if (mysql_query(&g_dbConn, sql.c_str()))
+    if (!EventIndex::refresh(m_debug))
     {
-        fprintf(stderr, "%s\n", mysql_error(&g_dbConn));
         sendError(ERROR_MYSQL_QUERY);
         return;
     }
 
-    res = mysql_store_result(&g_dbConn);
-    int dateCount = mysql_num_rows(res);
+    vector<string> dates;
+    EventIndex::findDates(EventIndex::getMonitorID(monitor), oldestFirst, dates);
 
     if (m_debug)
-        cout << "Got " << dateCount << " dates" << endl;
+        cout << "Got " << dates.size() << " dates" << endl;
 
-    ADD_INT(outStr, dateCount)
+    ADD_STR(outStr, "OK")
+
+    ADD_INT(outStr, dates.size())
 
-    for (int x = 0; x < dateCount; x++)
+    for (uint x = 0; x < dates.size(); x++)
     {
-        row = mysql_fetch_row(res);
-        if (row)
-        {
-            ADD_STR(outStr, row[0]) // event date
-        }
-        else
-        {
-            cout << "Failed to get mysql row" << endl;
-            sendError(ERROR_MYSQL_ROW);
-            return;
-        }
+        ADD_STR(outStr, dates[x]) // event date
     }
 
-    mysql_free_result(res);
-
     send(outStr);
 }
 
@@ -1265,8 +2090,6 @@ void ZMServer::handleGetAnalysisFrame(vector<string> tokens)
 
 void ZMServer::handleGetLiveFrame(vector<string> tokens)
 {
-    static unsigned char buffer[MAX_IMAGE_SIZE];
-
     // we need to periodically kick the DB connection here to make sure it
     // stays alive because the user may have left the frontend on the live
     // view which doesn't query the DB at all and eventually the connection
@@ -1308,8 +2131,12 @@ void ZMServer::handleGetLiveFrame(vector<string> tokens)
         return;
     }
 
-    // read a frame from the shared memory
-    int dataSize = getFrame(buffer, sizeof(buffer), monitor);
+    // is there a new frame available?
+    LiveFrame *frame = NULL;
+    if (monitor->getLastWriteIndex() != monitor->last_read)
+        frame = FrameBroadcaster::getFrame(monitor);
+
+    int dataSize = frame ? frame->data.size() : 0;
 
     if (m_debug)
         cout << "Frame size: " <<  dataSize << endl;
@@ -1323,6 +2150,9 @@ void ZMServer::handleGetLiveFrame(vector<string> tokens)
         return;
     }
 
+    monitor->last_read = frame->index;
+    monitor->status = frame->status;
+
     // add status
     ADD_STR(outStr, monitor->status)
 
@@ -1330,21 +2160,24 @@ void ZMServer::handleGetLiveFrame(vector<string> tokens)
     ADD_INT(outStr, dataSize)
 
     // send the data
-    send(outStr, buffer, dataSize);
+    send(outStr, frame);
 }
 
+// the optional offset and count ask for one page of the list, the reply
+// then starts with the number of frames in the whole event
 void ZMServer::handleGetFrameList(vector<string> tokens)
 {
     string eventID;
     string outStr("");
 
-    if (tokens.size() != 2)
+    if (tokens.size() != 2 && tokens.size() != 4)
     {
         sendError(ERROR_TOKEN_COUNT);
         return;
     }
 
     eventID = tokens[1];
+    bool paged = (tokens.size() == 4);
 
     if (m_debug)
         cout << "Loading frames for event: " << eventID << endl;
@@ -1370,21 +2203,35 @@ void ZMServer::handleGetFrameList(vector<string> tokens)
     row = mysql_fetch_row(res);
 
     // make sure we have some frames to display
-    if (row[1] == NULL || row[2] == NULL)
+    if (row == NULL || row[1] == NULL || row[2] == NULL)
     {
+        mysql_free_result(res);
         sendError(ERROR_NO_FRAMES);
         return;
     }
 
-    string cause = row[0];
+    string cause = row[0] ? row[0] : "";
     double length = atof(row[1]);
     int frameCount = atoi(row[2]);
 
     mysql_free_result(res);
 
+    int first = 0;
+    int count = INT_MAX;
+
+    if (paged)
+    {
+        first = max(atoi(tokens[2].c_str()), 0);
+        count = max(atoi(tokens[3].c_str()), 0);
+        ADD_INT(outStr, frameCount)
+    }
+
     if (cause == "Continuous")
     {
         // event is a continuous recording so guess the frame delta's
+        int total = frameCount;
+        first = min(first, total);
+        frameCount = min(count, total - first);
 
         if (m_debug)
             cout << "Got " << frameCount << " frames (continuous event)" << endl;
@@ -1393,13 +2240,12 @@ void ZMServer::handleGetFrameList(vector<string> tokens)
 
         if (frameCount > 0)
         {
-            double delta = length / frameCount;
+            double delta = length / total;
+            char str[32];
+            snprintf(str, sizeof(str), "%f", delta);
 
             for (int x = 0; x < frameCount; x++)
             {
-                char str[10];
-                sprintf(str, "%f", delta);
-
                 ADD_STR(outStr, "Normal") // Type
                 ADD_STR(outStr, str)      // Delta
             }
@@ -1411,6 +2257,13 @@ void ZMServer::handleGetFrameList(vector<string> tokens)
         sql += "WHERE EventID = " + eventID + " ";
         sql += "ORDER BY FrameID";
 
+        if (paged)
+        {
+            char limit[64];
+            snprintf(limit, sizeof(limit), " LIMIT %d, %d", first, count);
+            sql += limit;
+        }
+
         if (mysql_query(&g_dbConn, sql.c_str()))
         {
             fprintf(stderr, "%s\n", mysql_error(&g_dbConn));
@@ -1437,6 +2290,7 @@ void ZMServer::handleGetFrameList(vector<string> tokens)
             else
             {
                 cout << "handleGetFrameList: Failed to get mysql row " << x << endl;
+                mysql_free_result(res);
                 sendError(ERROR_MYSQL_ROW);
                 return;
             }
@@ -1529,6 +2383,9 @@ void ZMServer::handleDeleteEvent(vector<string> tokens)
         return;
     }
 
+    // make sure the next look at the event list doesn't still show it
+    EventIndex::invalidate();
+
     // run zmaudit.pl to clean everything up
     string command(g_binPath + "/zmaudit.pl &");
     errno = 0;
@@ -1569,6 +2426,8 @@ void ZMServer::handleDeleteEventList(vector<string> tokens)
         return;
     }
 
+    EventIndex::invalidate();
+
     ADD_STR(outStr, "OK")
     send(outStr);
 }
@@ -1665,48 +2524,14 @@ void ZMServer::getMonitorList(void)
     mysql_free_result(res);
 }
 
-int ZMServer::getFrame(unsigned char *buffer, int bufferSize, MONITOR *monitor)
+void FrameBroadcaster::convertFrame(MONITOR *monitor, int index,
+                                    unsigned char *buffer)
 {
-    (void) bufferSize;
-
-    // is there a new frame available?
-    if (monitor->getLastWriteIndex() == monitor->last_read)
-        return 0;
-
-    // sanity check last_read
-    if (monitor->getLastWriteIndex() < 0 ||
-            monitor->getLastWriteIndex() >= monitor->image_buffer_count)
-        return 0;
-
-    monitor->last_read = monitor->getLastWriteIndex();
-
-    switch (monitor->getState())
-    {
-        case IDLE:
-            monitor->status = "Idle";
-            break;
-        case PREALARM:
-            monitor->status = "Pre Alarm";
-            break;
-        case ALARM:
-            monitor->status = "Alarm";
-            break;
-        case ALERT:
-            monitor->status = "Alert";
-            break;
-        case TAPE:
-            monitor->status = "Tape";
-            break;
-        default:
-            monitor->status = "Unknown";
-            break;
-    }
-
     // FIXME: should do some sort of compression JPEG??
     // just copy the data to our buffer for now
 
     // fixup the colours if necessary we aim to always send RGB24 images
-    unsigned char *data = monitor->shared_images + monitor->getFrameSize() * monitor->last_read;
+    unsigned char *data = monitor->shared_images + monitor->getFrameSize() * index;
     unsigned int rpos = 0;
     unsigned int wpos = 0;
 
@@ -1795,8 +2620,6 @@ int ZMServer::getFrame(unsigned char *buffer, int bufferSize, MONITOR *monitor)
             break;
         }
     }
-
-    return monitor->width * monitor->height * 3;
 }
 
 string ZMServer::getZMSetting(const string &setting)
@@ -18,10 +18,13 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include <string>
 #include <sstream>
 #include <vector>
+#include <deque>
 #include <map>
+#include <set>
 #include <mysql/mysql.h>
 
 using namespace std;
@@ -46,6 +49,11 @@ extern int     g_minorVersion;
 extern int     g_revisionVersion;
 
 #define DB_CHECK_TIME 60
+
+// how often, in seconds, the event index looks for new and removed events,
+// and how many events it rereads each time to catch any other changes
+#define EVENT_INDEX_REFRESH_TIME 2
+#define EVENT_INDEX_SWEEP_SIZE   1000
 extern time_t  g_lastDBKick;
 
 const string FUNCTION_MONITOR = "Monitor";
@@ -163,6 +171,7 @@ class MONITOR
     int getSubpixelOrder(void);
     int getState(void);
     int getFrameSize(void);
+    struct timeval getImageTime(int index);
 
     string name;
     string type;
@@ -186,9 +195,142 @@ class MONITOR
   private:
     SharedData *shared_data;
     SharedData26 *shared_data26;
+    struct timeval *shared_timestamps;
     string id;
 };
 
+// A live frame converted to RGB24, shared by every client sending it
+class LiveFrame
+{
+  public:
+    LiveFrame(void);
+
+    void incrRef(void) { m_refs++; }
+    void decrRef(void);
+    bool isShared(void) const { return m_refs > 1; }
+
+    int index;
+    struct timeval timestamp;
+    string status;
+    vector<unsigned char> data;
+
+  private:
+    ~LiveFrame() {}
+
+    int m_refs;
+};
+
+// Keeps the latest frame of each monitor so a new frame is read out of the
+// shared memory and converted once, however many clients are watching it
+class FrameBroadcaster
+{
+  public:
+    static LiveFrame *getFrame(MONITOR *monitor);
+    static void clear(void);
+
+  private:
+    static void convertFrame(MONITOR *monitor, int index,
+                             unsigned char *buffer);
+
+    static map<int, LiveFrame *> s_frames;
+};
+
+// Something waiting to be written to a client, either a string or a
+// reference to a live frame
+typedef struct
+{
+    string     str;
+    LiveFrame *frame;
+} OutChunk;
+
+// one row of the Events table, as the clients see it
+typedef struct
+{
+    int    eventID;
+    string name;
+    int    monitorID;
+    string startTime;
+    string length;
+    bool   continuous;
+    bool   open;        // still being recorded, its length will change
+} EventRow;
+
+// an event that was added, changed or removed by a refresh, with where it
+// was before so a client can be told it has left the list it is showing
+typedef struct
+{
+    int    generation;
+    int    eventID;
+    bool   existed;
+    int    oldMonitorID;
+    string oldStartTime;
+    bool   oldContinuous;
+    bool   removed;
+    int    monitorID;
+    string startTime;
+    bool   continuous;
+} EventChange;
+
+// events are ordered by their start time
+typedef pair<string, int> EventKey;
+
+// An in memory copy of the Events table, shared by every ZMServer. It is
+// refreshed incrementally so the event browser can be given a page of
+// events, or just what has changed since it last looked, without another
+// query over the whole table.
+class EventIndex
+{
+  public:
+    static bool refresh(bool debug);
+    static void invalidate(void) { s_lastRefresh = 0; }
+
+    static int  getMonitorID(const string &monitorName);
+    static string getMonitorName(int monitorID);
+    static const vector<const EventRow *> &findEvents(int monitorID,
+                                                      const string &date,
+                                                      bool includeContinuous);
+    static void findDates(int monitorID, bool oldestFirst,
+                          vector<string> &dates);
+    static bool findChanges(const string &token, int monitorID,
+                            const string &date, bool includeContinuous,
+                            vector<const EventRow *> &changed,
+                            vector<int> &removed);
+    static string getToken(void);
+
+  private:
+    friend class TestEventIndex;
+
+    static bool loadMonitorNames(void);
+    static bool loadEvents(const string &where, bool debug,
+                           set<int> *seen = NULL);
+    static bool checkRemoved(bool debug);
+    static bool sweepEvents(bool debug);
+    static void updateEvent(const EventRow &row);
+    static void removeEvent(int eventID);
+    static void eraseEvent(map<int, EventRow *>::iterator it);
+    static void logChange(const EventRow *before, const EventRow *after);
+    static void endRefresh(void);
+    static bool matches(int monitorID, const string &startTime,
+                        bool continuous, int wantMonitorID,
+                        const string &date, bool includeContinuous);
+
+    static map<int, map<EventKey, EventRow> > s_events;
+    static map<int, EventRow *>               s_eventsByID;
+    static map<int, map<string, int> >        s_dates;
+    static set<int>                           s_openEvents;
+    static map<int, string>                   s_monitorNames;
+    static deque<EventChange>                 s_changes;
+    static map<string, vector<const EventRow *> > s_lists;
+    static int                                s_listsGeneration;
+    static int                                s_generation;
+    static int                                s_trimmedGeneration;
+    static int                                s_maxEventID;
+    static int                                s_sweepFrom;
+    static time_t                             s_started;
+    static time_t                             s_lastRefresh;
+    static bool                               s_loaded;
+};
+
 class ZMServer
 {
   public:
@@ -197,13 +339,20 @@ class ZMServer
 
     bool processRequest(char* buf, int nbytes);
 
+    // writes as much queued output as the socket will take, returns false
+    // if the client has gone away
+    bool flush(void);
+    bool hasPendingOutput(void) const { return !m_outQueue.empty(); }
+
   private:
     string getZMSetting(const string &setting);
-    bool send(const string &s) const;
-    bool send(const string &s, const unsigned char *buffer, int dataLen) const;
+    bool send(const string &s);
+    bool send(const string &s, const unsigned char *buffer, int dataLen);
+    bool send(const string &s, LiveFrame *frame);
+    void queueString(const string &s);
+    void popChunk(void);
     void sendError(string error);
     void getMonitorList(void);
-    int  getFrame(unsigned char *buffer, int bufferSize, MONITOR *monitor);
     long long getDiskSpace(const string &filename, long long &total, long long &used);
     void tokenize(const string &command, vector<string> &tokens);
     void handleHello(void);
@@ -217,6 +366,8 @@ class ZMServer
     void handleGetMonitorList(void);
     void handleGetCameraList(void);
     void handleGetEventList(vector<string> tokens);
+    void handleGetEventChanges(vector<string> tokens);
+    void addEvent(string &outStr, const EventRow *event);
     void handleGetEventFrame(vector<string> tokens);
     void handleGetAnalysisFrame(vector<string> tokens);
     void handleGetLiveFrame(vector<string> tokens);
@@ -240,6 +391,9 @@ class ZMServer
     key_t                m_shmKey;
     string               m_mmapPath;
     char                 m_buf[10];
+    deque<OutChunk>      m_outQueue;
+    size_t               m_outOffset;
+    bool                 m_sendFailed;
 };
 
 
@@ -3,3 +3,8 @@ TEMPLATE = subdirs
 # Directories
 SUBDIRS = mythzoneminder mythzmserver theme i18n
 
+# unit tests mythzmserver
+mythzmserver-test.depends = sub-mythzmserver
+mythzmserver-test.target = buildtestmythzmserver
+mythzmserver-test.commands = cd mythzmserver/test && $(QMAKE) && $(MAKE)
+unix:QMAKE_EXTRA_TARGETS += mythzmserver-test
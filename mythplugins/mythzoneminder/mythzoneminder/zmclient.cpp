@@ -3,9 +3,12 @@
 */
 
 #include <unistd.h>
+#include <algorithm>
 
 // qt
 #include <QTimer>
+#include <QMap>
+#include <QSet>
 
 //myth
 #include "mythcontext.h"
@@ -19,10 +22,13 @@
 #include "zmminiplayer.h"
 
 // the protocol version we understand
-#define ZM_PROTOCOL_VERSION "11"
+#define ZM_PROTOCOL_VERSION "12"
 
 #define BUFFER_SIZE  (2048*1536*3)
 
+// how many events to ask for at a time
+#define EVENT_PAGE_SIZE 5000
+
 ZMClient::ZMClient()
     : QObject(NULL),
       m_listLock(QMutex::Recursive),
@@ -406,57 +412,209 @@ bool ZMClient::updateAlarmStates(void)
     return changed;
 }
 
+static Event *readEvent(QStringList::Iterator &it)
+{
+    int eventID = (*it++).toInt();
+    QString eventName = *it++;
+    int monitorID = (*it++).toInt();
+    QString monitorName = *it++;
+    QDateTime startTime = QDateTime::fromString(*it++, Qt::ISODate);
+    QString length = *it++;
+
+    return new Event(eventID, eventName, monitorID, monitorName,
+                     startTime, length);
+}
+
+static bool eventEarlier(const Event *a, const Event *b)
+{
+    return a->startTime() < b->startTime();
+}
+
+static bool eventLater(const Event *a, const Event *b)
+{
+    return a->startTime() > b->startTime();
+}
+
 void ZMClient::getEventList(const QString &monitorName, bool oldestFirst,
                             const QString &date, bool includeContinuous,
                             vector<Event*> *eventList)
 {
     eventList->clear();
 
-    QStringList strList("GET_EVENT_LIST");
-    strList << monitorName << (oldestFirst ? "1" : "0") ;
-    strList << date;
+    // events are fetched a page at a time so a long list doesn't turn
+    // into one huge message
+    QSet<int> seen;
+    int offset = 0;
+    int total = 1;
+
+    while (offset < total)
+    {
+        QStringList strList("GET_EVENT_LIST");
+        strList << monitorName << (oldestFirst ? "1" : "0") ;
+        strList << date;
+        strList << (includeContinuous ? "1" : "0") ;
+        strList << QString::number(offset) << QString::number(EVENT_PAGE_SIZE);
+
+        if (!sendReceiveStringList(strList))
+            return;
+
+        // sanity check
+        if (strList.size() < 3)
+        {
+            LOG(VB_GENERAL, LOG_ERR, "ZMClient response too short");
+            return;
+        }
+
+        bool bOK, bOK2;
+        total = strList[1].toInt(&bOK);
+        int eventCount = strList[2].toInt(&bOK2);
+        if (!bOK || !bOK2)
+        {
+            LOG(VB_GENERAL, LOG_ERR, "ZMClient received bad int in getEventList()");
+            return;
+        }
+
+        // sanity check
+        if ((int)(strList.size() - 3) / 6 != eventCount)
+        {
+            LOG(VB_GENERAL, LOG_ERR,
+                "ZMClient got a mismatch between the number of events and "
+                "the expected number of stringlist items in getEventList()");
+            return;
+        }
+
+        // the list got shorter while we were fetching it
+        if (eventCount == 0)
+            break;
+
+        QStringList::Iterator it = strList.begin();
+        it++; it++; it++;
+        for (int x = 0; x < eventCount; x++)
+        {
+            Event *event = readEvent(it);
+
+            // and events that were added in the meantime can push ones we
+            // already have onto the next page
+            if (seen.contains(event->eventID()))
+            {
+                delete event;
+                continue;
+            }
+
+            seen.insert(event->eventID());
+            eventList->push_back(event);
+        }
+
+        offset += eventCount;
+    }
+}
+
+/**
+ *  \brief Brings an event list up to date with the server.
+ *
+ *  Given the sync token from the last call, with the same filter, only the
+ *  events that were added, changed or removed since are fetched. Otherwise,
+ *  or if the server can't tell what changed, the whole list is reloaded.
+ *  The token to pass next time is returned in syncToken.
+ */
+void ZMClient::syncEventList(const QString &monitorName, bool oldestFirst,
+                             const QString &date, bool includeContinuous,
+                             QString &syncToken, vector<Event*> *eventList)
+{
+    QStringList strList("GET_EVENT_CHANGES");
+    strList << monitorName << date;
     strList << (includeContinuous ? "1" : "0") ;
+    strList << (syncToken.isEmpty() ? "<NONE>" : syncToken);
+
+    syncToken.clear();
 
     if (!sendReceiveStringList(strList))
         return;
 
     // sanity check
-    if (strList.size() < 2)
+    if (strList.size() < 3)
     {
         LOG(VB_GENERAL, LOG_ERR, "ZMClient response too short");
         return;
     }
 
-    bool bOK;
-    int eventCount = strList[1].toInt(&bOK);
-    if (!bOK)
+    QString newToken = strList[1];
+
+    if (strList[2] != "DELTA")
     {
-        LOG(VB_GENERAL, LOG_ERR, "ZMClient received bad int in getEventList()");
+        getEventList(monitorName, oldestFirst, date, includeContinuous,
+                     eventList);
+        syncToken = newToken;
         return;
     }
 
+    bool bOK = (strList.size() >= 4);
+    int changedCount = bOK ? strList[3].toInt(&bOK) : 0;
+    int removedCount = 0;
+    if (bOK && strList.size() >= 5 + changedCount * 6)
+        removedCount = strList[4 + changedCount * 6].toInt(&bOK);
+    else
+        bOK = false;
+
     // sanity check
-    if ((int)(strList.size() - 2) / 6 != eventCount)
+    if (!bOK || strList.size() != 5 + changedCount * 6 + removedCount)
     {
         LOG(VB_GENERAL, LOG_ERR,
             "ZMClient got a mismatch between the number of events and "
-            "the expected number of stringlist items in getEventList()");
+            "the expected number of stringlist items in syncEventList()");
         return;
     }
 
-    QStringList::Iterator it = strList.begin();
-    it++; it++;
-    for (int x = 0; x < eventCount; x++)
+    QMap<int, Event*> changed;
+    QSet<int> removed;
+
+    QStringList::Iterator it = strList.begin() + 4;
+    for (int x = 0; x < changedCount; x++)
     {
-        eventList->push_back(
-            new Event(
-                (*it++).toInt(), /* eventID */
-                *it++, /* eventName */
-                (*it++).toInt(), /* monitorID */
-                *it++, /* monitorName */
-                QDateTime::fromString(*it++, Qt::ISODate), /* startTime */
-                *it++ /* length */));
+        Event *event = readEvent(it);
+        changed.insert(event->eventID(), event);
     }
+
+    it++;
+    for (int x = 0; x < removedCount; x++)
+        removed.insert((*it++).toInt());
+
+    LOG(VB_GENERAL, LOG_DEBUG,
+        QString("ZMClient event list sync: %1 changed, %2 removed")
+            .arg(changedCount).arg(removedCount));
+
+    // update the events we already have
+    vector<Event*>::iterator eit = eventList->begin();
+    while (eit != eventList->end())
+    {
+        int eventID = (*eit)->eventID();
+
+        if (removed.contains(eventID))
+        {
+            delete *eit;
+            eit = eventList->erase(eit);
+            continue;
+        }
+
+        if (changed.contains(eventID))
+        {
+            delete *eit;
+            *eit = changed.take(eventID);
+        }
+
+        ++eit;
+    }
+
+    // and put the new ones in their place
+    QMap<int, Event*>::iterator cit = changed.begin();
+    for (; cit != changed.end(); ++cit)
+    {
+        eit = std::upper_bound(eventList->begin(), eventList->end(), *cit,
+                               oldestFirst ? eventEarlier : eventLater);
+        eventList->insert(eit, *cit);
+    }
+
+    syncToken = newToken;
 }
 
 void ZMClient::getEventDates(const QString &monitorName, bool oldestFirst,
@@ -44,6 +44,9 @@ class MPUBLIC ZMClient : public QObject
     void updateMonitorStatus(void);
     void getEventList(const QString &monitorName, bool oldestFirst,
                       const QString &date, bool includeContinuous, vector<Event*> *eventList);
+    void syncEventList(const QString &monitorName, bool oldestFirst,
+                       const QString &date, bool includeContinuous,
+                       QString &syncToken, vector<Event*> *eventList);
     void getEventFrame(Event *event, int frameNo, MythImage **image);
     void getAnalyseFrame(Event *event, int frameNo, QImage &image);
     int  getLiveFrame(int monitorID, QString &status, unsigned char* buffer, int bufferSize);
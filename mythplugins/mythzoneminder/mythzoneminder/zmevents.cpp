@@ -192,7 +192,17 @@ void ZMEvents::getEventList(void)
         if (m_dateSelector->GetValue() != tr("All Dates"))
             date = m_dateList[m_dateSelector->GetCurrentPos() - 1];
 
-        zm->getEventList(monitorName, m_oldestFirst, date, m_showContinuous, m_eventList);
+        // only what has changed is fetched while the filter stays the same
+        QString filter = QString("%1|%2|%3|%4").arg(monitorName).arg(date)
+            .arg(m_oldestFirst).arg(m_showContinuous);
+        if (filter != m_syncFilter)
+        {
+            m_syncFilter = filter;
+            m_syncToken.clear();
+        }
+
+        zm->syncEventList(monitorName, m_oldestFirst, date, m_showContinuous,
+                          m_syncToken, m_eventList);
 
         updateUIList();
     }
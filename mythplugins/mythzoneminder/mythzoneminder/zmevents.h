@@ -64,6 +64,8 @@ public:
     int                  m_layout;
 
     std::vector<Event *>     *m_eventList;
+    QString              m_syncToken;
+    QString              m_syncFilter;
     QStringList          m_dateList;
     int                  m_savedPosition;
     int                  m_currentCamera;
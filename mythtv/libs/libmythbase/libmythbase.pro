@@ -34,6 +34,9 @@ HEADERS += threadedfilewriter.h mythsingledownload.h codecutil.h
 HEADERS += mythsession.h
 HEADERS += ../../external/qjsonwrapper/qjsonwrapper/Json.h
 HEADERS += cleanupguard.h
+HEADERS += mythtrace.h
+HEADERS += mythmetrics.h
+HEADERS += mythdbsnapshot.h
 
 SOURCES += mthread.cpp mthreadpool.cpp
 SOURCES += mythsocket.cpp
@@ -55,6 +58,9 @@ SOURCES += threadedfilewriter.cpp mythsingledownload.cpp codecutil.cpp
 SOURCES += mythsession.cpp
 SOURCES += ../../external/qjsonwrapper/qjsonwrapper/Json.cpp
 SOURCES += cleanupguard.cpp
+SOURCES += mythtrace.cpp
+SOURCES += mythmetrics.cpp
+SOURCES += mythdbsnapshot.cpp
 
 unix {
     SOURCES += mythsystemunix.cpp
@@ -84,6 +90,8 @@ inc.files += plist.h bswap.h signalhandling.h ffmpeg-mmx.h mythdate.h
 inc.files += mythplugin.h mythpluginapi.h mythqtcompat.h
 inc.files += remotefile.h mythsystemlegacy.h mythtypes.h
 inc.files += threadedfilewriter.h mythsingledownload.h mythsession.h
+inc.files += mythtrace.h
+inc.files += mythmetrics.h
 
 # Allow both #include <blah.h> and #include <libmythbase/blah.h>
 inc2.path  = $${PREFIX}/include/mythtv/libmythbase
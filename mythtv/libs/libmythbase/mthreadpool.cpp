@@ -94,6 +94,7 @@ using namespace std;
 #include "logging.h"
 #include "mthread.h"
 #include "mythdb.h"
+#include "mythmetrics.h"
 
 typedef QPair<QRunnable*,QString> MPoolEntry;
 typedef QList<MPoolEntry> MPoolQueue;
@@ -254,8 +255,11 @@ QList<MThreadPool*> MThreadPoolPrivate::s_all_pools;
 MThreadPool::MThreadPool(const QString &name) :
     m_priv(new MThreadPoolPrivate(name))
 {
-    QMutexLocker locker(&MThreadPoolPrivate::s_pool_lock);
-    MThreadPoolPrivate::s_all_pools.push_back(this);
+    {
+        QMutexLocker locker(&MThreadPoolPrivate::s_pool_lock);
+        MThreadPoolPrivate::s_all_pools.push_back(this);
+    }
+    MythMetrics::AddCollector(CollectMetrics);
 }
 
 MThreadPool::~MThreadPool()
@@ -346,6 +350,39 @@ void MThreadPool::ShutdownAllPools(void)
     }
 }
 
+/// Sets the pool size gauges, called when the metrics are written out
+void MThreadPool::CollectMetrics(void)
+{
+    QMutexLocker locker(&MThreadPoolPrivate::s_pool_lock);
+    QList<MThreadPool*>::iterator it;
+    for (it = MThreadPoolPrivate::s_all_pools.begin();
+         it != MThreadPoolPrivate::s_all_pools.end(); ++it)
+    {
+        MThreadPoolPrivate *priv = (*it)->m_priv;
+        QString label = MythMetrics::Label("pool", priv->m_name);
+
+        QMutexLocker pool_locker(&priv->m_lock);
+
+        int queued = 0;
+        MPoolQueues::const_iterator qit = priv->m_run_queues.begin();
+        for (; qit != priv->m_run_queues.end(); ++qit)
+            queued += (*qit).size();
+
+        MythMetrics::Gauge("mythtv_threadpool_running_threads",
+                           "Pool threads running a task", label)
+            ->Set(priv->m_running_threads.size());
+        MythMetrics::Gauge("mythtv_threadpool_available_threads",
+                           "Idle pool threads", label)
+            ->Set(priv->m_avail_threads.size());
+        MythMetrics::Gauge("mythtv_threadpool_max_threads",
+                           "Maximum number of pool threads", label)
+            ->Set(priv->GetRealMaxThread());
+        MythMetrics::Gauge("mythtv_threadpool_queued_tasks",
+                           "Tasks waiting for a pool thread", label)
+            ->Set(queued);
+    }
+}
+
 void MThreadPool::start(QRunnable *runnable, QString debugName, int priority)
 {
     QMutexLocker locker(&m_priv->m_lock);
@@ -50,6 +50,7 @@ class MBASE_PUBLIC MThreadPool
     void NotifyDone(MPoolThread*);
     void ReleaseThread(void);
 
+    static void CollectMetrics(void);
 
     MThreadPoolPrivate *m_priv;
 };
@@ -67,6 +67,7 @@ using namespace std;
 #include "logging.h"
 #include "mythmiscutil.h"
 #include "mythdate.h"
+#include "mythtrace.h"
 
 #define TERMWIDTH 79
 
@@ -2424,6 +2425,12 @@ void MythCommandLineParser::addLogging(
                 ->SetDeprecated("this is now the default, see --enable-dblog");
     add("--enable-dblog", "enabledblog", false, "Enable logging to database.", "")
                 ->SetGroup("Logging");
+    add("--trace", "trace", "",
+        "Record trace events for a comma separated list of categories: "
+        "recorder, stream, scheduler, server, player, ui or all.\n"
+        "Events are written out on a TRACE_DUMP message, for example "
+        "from mythutil --dumptrace.", "")
+                ->SetGroup("Logging");
 
     add(QStringList( QStringList() << "-l" << "--logfile" ),
         "logfile", "", "", "")
@@ -2610,6 +2617,15 @@ int MythCommandLineParser::ConfigureLogging(QString mask, unsigned int progress)
 
     logStart(logfile, progress, quiet, facility, level, dblog, propagate, noserver);
 
+    if (toBool("trace"))
+    {
+        bool ok = false;
+        int categories = MythTrace::ParseCategories(toString("trace"), &ok);
+        if (!ok)
+            return GENERIC_EXIT_INVALID_CMDLINE;
+        MythTrace::SetCategories(categories);
+    }
+
     return GENERIC_EXIT_OK;
 }
 
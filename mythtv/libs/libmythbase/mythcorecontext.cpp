@@ -47,6 +47,7 @@ using namespace std;
 #include "serverpool.h"
 #include "mythdate.h"
 #include "mythplugin.h"
+#include "mythtrace.h"
 
 #define LOC      QString("MythCoreContext::%1(): ").arg(__func__)
 
@@ -1459,6 +1460,10 @@ void MythCoreContext::readyRead(MythSocket *sock)
             LOG(VB_NETWORK, LOG_INFO, LOC + "Received remote 'Clear Cache' request");
             ClearSettingsCache();
         }
+        else if (MythTrace::HandleMessage(message))
+        {
+            // Every process records and writes out its own trace events
+        }
         else if (message.startsWith("FILE_WRITTEN"))
         {
             QString file;
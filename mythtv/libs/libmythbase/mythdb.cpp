@@ -1,15 +1,19 @@
 #include <vector>
 using namespace std;
 
+#include <cstdlib>
+
 #include <QReadWriteLock>
 #include <QTextStream>
 #include <QSqlError>
+#include <QAtomicInt>
 #include <QMutex>
 #include <QFile>
 #include <QHash>
 #include <QDir>
 
 #include "mythdb.h"
+#include "mythdbsnapshot.h"
 #include "mythdbcon.h"
 #include "mythlogging.h"
 #include "mythdirs.h"
@@ -62,7 +66,7 @@ struct SingleSetting
 
 typedef QHash<QString,QString> SettingsMap;
 
-class MythDBPrivate
+class MythDBPrivate : public SettingsSnapshotCache
 {
   public:
     MythDBPrivate();
@@ -87,13 +91,25 @@ class MythDBPrivate
 
     bool haveDBConnection;
     bool haveSchema;
+
+    /// Set MYTHDB_NO_SETTINGS_SNAPSHOT to compare against the old behaviour
+    bool snapshotDisabled;
+
+    QAtomicInt settingsQueries;
+    QAtomicInt snapshotHits;
+    QAtomicInt snapshotLoads;
+
+  protected:
+    SnapshotPtr LoadSnapshot(void); // SettingsSnapshotCache
 };
 
 static const int settings_reserve = 61;
 
 MythDBPrivate::MythDBPrivate() :
     ignoreDatabase(false), suppressDBMessages(true), useSettingsCache(false),
-    haveDBConnection(false), haveSchema(false)
+    haveDBConnection(false), haveSchema(false),
+    snapshotDisabled(getenv("MYTHDB_NO_SETTINGS_SNAPSHOT") != NULL),
+    settingsQueries(0), snapshotHits(0), snapshotLoads(0)
 {
     m_localhostname.clear();
     settingsCache.reserve(settings_reserve);
@@ -104,6 +120,112 @@ MythDBPrivate::~MythDBPrivate()
     LOG(VB_DATABASE, LOG_INFO, "Destroying MythDBPrivate");
 }
 
+SnapshotPtr MythDBPrivate::LoadSnapshot(void)
+{
+    MSqlQuery query(MSqlQuery::InitCon());
+    if (!query.isConnected())
+        return SnapshotPtr();
+
+    settingsQueries.fetchAndAddOrdered(1);
+    if (!query.exec("SELECT value, data, hostname FROM settings"))
+    {
+        if (!suppressDBMessages)
+            MythDB::DBError("LoadSnapshot", query);
+        return SnapshotPtr();
+    }
+
+    SettingsSnapshot *snap = new SettingsSnapshot();
+    if (query.size() > 0)
+        snap->keys.reserve(query.size() * 2);
+
+    while (query.next())
+    {
+        QString key  = query.value(0).toString();
+        QString data = query.value(1).toString();
+        QString host = query.value(2).toString().toLower();
+
+        QString lower = key.toLower();
+        QHash<QString,int>::const_iterator kit = snap->keys.find(lower);
+        int id;
+        if (kit == snap->keys.end())
+        {
+            id = snap->global.size();
+            lower.squeeze();
+            snap->keys[lower] = id;
+            if (key != lower)
+            {
+                key.squeeze();
+                snap->keys[key] = id;
+            }
+            snap->global.append(QString());
+        }
+        else
+        {
+            id = *kit;
+        }
+
+        if (data.isNull())
+            data = "";
+        data.squeeze();
+
+        if (host.isEmpty())
+        {
+            snap->global[id] = data;
+            continue;
+        }
+
+        QHash<QString,int>::const_iterator hit = snap->hosts.find(host);
+        int index;
+        if (hit == snap->hosts.end())
+        {
+            index = snap->hostValues.size();
+            host.squeeze();
+            snap->hosts[host] = index;
+            snap->hostValues.append(QVector<QString>());
+        }
+        else
+        {
+            index = *hit;
+        }
+        snap->hostValues[index].resize(snap->global.size());
+        snap->hostValues[index][id] = data;
+    }
+
+    // Overrides apply both to the local host and to lookups without a host
+    settingsCacheLock.lockForRead();
+    SettingsMap::const_iterator oit = overriddenSettings.begin();
+    for (; oit != overriddenSettings.end(); ++oit)
+    {
+        if (!snap->keys.contains(oit.key()))
+        {
+            snap->keys[oit.key()] = snap->global.size();
+            snap->global.append(QString());
+        }
+        if (!snap->hosts.contains(m_localhostname))
+        {
+            snap->hosts[m_localhostname] = snap->hostValues.size();
+            snap->hostValues.append(QVector<QString>());
+        }
+        int id = snap->keys[oit.key()];
+        int index = snap->hosts[m_localhostname];
+        snap->hostValues[index].resize(snap->global.size());
+        snap->hostValues[index][id] = *oit;
+        snap->global[id] = *oit;
+    }
+    settingsCacheLock.unlock();
+
+    for (int i = 0; i < snap->hostValues.size(); ++i)
+        snap->hostValues[i].resize(snap->global.size());
+    snap->localHost = snap->hosts.value(m_localhostname, -1);
+
+    snapshotLoads.fetchAndAddOrdered(1);
+    LOG(VB_DATABASE, LOG_INFO,
+        QString("Loaded settings snapshot: %1 keys on %2 hosts")
+            .arg(snap->global.size()).arg(snap->hostValues.size()));
+
+    return SnapshotPtr(snap);
+}
+
 MythDB::MythDB()
 {
     d = new MythDBPrivate();
@@ -111,9 +233,23 @@ MythDB::MythDB()
 
 MythDB::~MythDB()
 {
+    LOG(VB_DATABASE, LOG_INFO,
+        QString("Settings: %1 queries, %2 snapshot loads, %3 snapshot hits")
+            .arg(GetSettingsQueryCount())
+            .arg(d->snapshotLoads.fetchAndAddOrdered(0))
+            .arg(d->snapshotHits.fetchAndAddOrdered(0)));
     delete d;
 }
 
+/**
+ *  \brief Returns how many queries of the settings table this process has
+ *         made to read settings.
+ */
+int MythDB::GetSettingsQueryCount(void) const
+{
+    return d->settingsQueries.fetchAndAddOrdered(0);
+}
+
 MDBManager *MythDB::GetDBManager(void)
 {
     return &(d->m_dbmanager);
@@ -361,11 +497,28 @@ bool MythDB::ClearSettingOnHost(const QString &key, const QString &host)
     return SaveSettingOnHost(key, kClearSettingValue, host);
 }
 
+/// Returns the snapshot if settings may be answered from it at all
+static inline SnapshotPtr usable_snapshot(MythDB *db, MythDBPrivate *d)
+{
+    if (!d->useSettingsCache || d->snapshotDisabled || d->ignoreDatabase ||
+        !db->HaveValidDatabase())
+        return SnapshotPtr();
+    return d->GetSnapshot();
+}
+
 QString MythDB::GetSetting(const QString &_key, const QString &defaultval)
 {
-    QString key = _key.toLower();
     QString value = defaultval;
 
+    SnapshotPtr snap = usable_snapshot(this, d);
+    if (snap && snap->Lookup(_key, snap->localHost, defaultval, true, value))
+    {
+        d->snapshotHits.fetchAndAddOrdered(1);
+        return value;
+    }
+
+    QString key = _key.toLower();
+
     d->settingsCacheLock.lockForRead();
     if (d->useSettingsCache)
     {
@@ -400,6 +553,7 @@ QString MythDB::GetSetting(const QString &_key, const QString &defaultval)
     query.bindValue(":KEY", key);
     query.bindValue(":HOSTNAME", d->m_localhostname);
 
+    d->settingsQueries.fetchAndAddOrdered(1);
     if (query.exec() && query.next())
     {
         value = query.value(0).toString();
@@ -412,6 +566,7 @@ QString MythDB::GetSetting(const QString &_key, const QString &defaultval)
             "WHERE value = :KEY AND hostname IS NULL");
         query.bindValue(":KEY", key);
 
+        d->settingsQueries.fetchAndAddOrdered(1);
         if (query.exec() && query.next())
         {
             value = query.value(0).toString();
@@ -435,6 +590,27 @@ QString MythDB::GetSetting(const QString &_key, const QString &defaultval)
 
 bool MythDB::GetSettings(QMap<QString,QString> &_key_value_pairs)
 {
+    SnapshotPtr snap = usable_snapshot(this, d);
+    if (snap)
+    {
+        QMap<QString,QString> values;
+        QMap<QString,QString>::const_iterator it = _key_value_pairs.begin();
+        for (; it != _key_value_pairs.end(); ++it)
+        {
+            QString value;
+            if (!snap->Lookup(it.key(), snap->localHost, *it, true, value))
+                break;
+            values[it.key()] = value;
+        }
+
+        if (it == _key_value_pairs.end())
+        {
+            d->snapshotHits.fetchAndAddOrdered(values.size());
+            _key_value_pairs = values;
+            return true;
+        }
+    }
+
     QMap<QString,bool> done;
     typedef QMap<QString,QString>::iterator KVIt;
     KVIt kvit = _key_value_pairs.begin();
@@ -508,6 +684,7 @@ bool MythDB::GetSettings(QMap<QString,QString> &_key_value_pairs)
     keylist = keylist.left(keylist.length() - 1);
 
     MSqlQuery query(MSqlQuery::InitCon());
+    d->settingsQueries.fetchAndAddOrdered(1);
     if (!query.exec(
             QString(
                 "SELECT value, data, hostname "
@@ -594,9 +771,18 @@ double MythDB::GetFloatSetting(const QString &key)
 QString MythDB::GetSettingOnHost(const QString &_key, const QString &_host,
                                  const QString &defaultval)
 {
+    QString value = defaultval;
+
+    SnapshotPtr snap = usable_snapshot(this, d);
+    if (snap && snap->Lookup(_key, snap->HostIndex(_host), defaultval,
+                             false, value))
+    {
+        d->snapshotHits.fetchAndAddOrdered(1);
+        return value;
+    }
+
     QString key   = _key.toLower();
     QString host  = _host.toLower();
-    QString value = defaultval;
     QString myKey = host + ' ' + key;
 
     d->settingsCacheLock.lockForRead();
@@ -639,6 +825,7 @@ QString MythDB::GetSettingOnHost(const QString &_key, const QString &_host,
     query.bindValue(":VALUE", key);
     query.bindValue(":HOSTNAME", host);
 
+    d->settingsQueries.fetchAndAddOrdered(1);
     if (query.exec() && query.next())
     {
         value = query.value(0).toString();
@@ -788,6 +975,8 @@ void MythDB::OverrideSettingForSession(
     d->settingsCache[mk]      = mv;
     d->settingsCache[mk2]     = mv;
     d->settingsCacheLock.unlock();
+
+    d->DropSnapshot();
 }
 
 /// \brief Clears session Overrides for the given setting.
@@ -811,6 +1000,8 @@ void MythDB::ClearOverrideSettingForSession(const QString &key)
         d->settingsCache.erase(sit);
 
     d->settingsCacheLock.unlock();
+
+    d->DropSnapshot();
 }
 
 static void clear(
@@ -868,6 +1059,18 @@ void MythDB::ClearSettingsCache(const QString &_key)
     }
 
     d->settingsCacheLock.unlock();
+
+    // A full clear is what CLEAR_SETTINGS_CACHE from the backend does,
+    // anything may have changed so the whole snapshot is reloaded.
+    if (_key.isEmpty())
+    {
+        d->DropSnapshot();
+    }
+    else
+    {
+        QString key = _key.toLower();
+        d->MarkStale(key.contains(' ') ? key.section(QChar(' '), 1) : key);
+    }
 }
 
 void MythDB::ActivateSettingsCache(bool activate)
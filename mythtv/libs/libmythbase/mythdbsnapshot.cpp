@@ -0,0 +1,145 @@
+#include "mythdbsnapshot.h"
+
+int SettingsSnapshot::HostIndex(const QString &host) const
+{
+    QHash<QString,int>::const_iterator it = hosts.find(host);
+    if (it == hosts.end())
+        it = hosts.find(host.toLower());
+    return (it == hosts.end()) ? -1 : *it;
+}
+
+/**
+ *  \brief Looks up key for the host with the given index.
+ *
+ *  \return false if the snapshot can not answer for this key, because it has
+ *          been changed since the snapshot was loaded. A key which is not in
+ *          the snapshot at all is answered with defaultval.
+ */
+bool SettingsSnapshot::Lookup(const QString &key, int host,
+                              const QString &defaultval,
+                              bool fallbackToGlobal, QString &value) const
+{
+    QHash<QString,int>::const_iterator it = keys.find(key);
+    if (it == keys.end())
+    {
+        QString lower = key.toLower();
+        if (stale.contains(lower))
+            return false;
+        it = keys.find(lower);
+    }
+    else if (!stale.isEmpty() && stale.contains(key.toLower()))
+    {
+        return false;
+    }
+
+    value = defaultval;
+    if (it == keys.end())
+        return true;
+
+    if (host >= 0 && !hostValues[host][*it].isNull())
+        value = hostValues[host][*it];
+    else if (fallbackToGlobal && !global[*it].isNull())
+        value = global[*it];
+
+    return true;
+}
+
+SettingsSnapshotCache::SettingsSnapshotCache() :
+    snapshotGeneration(0), snapshotTried(-1), snapshotLoading(false)
+{
+}
+
+/**
+ *  \brief Returns the current settings snapshot, loading it if needed.
+ *
+ *  Returns a null pointer if there is no usable snapshot, in which case the
+ *  caller should use the per-key cache and queries as before.
+ */
+SnapshotPtr SettingsSnapshotCache::GetSnapshot(void)
+{
+    LocalSnapshot *local = localSnapshot.localData();
+    if (!local)
+    {
+        local = new LocalSnapshot();
+        localSnapshot.setLocalData(local);
+    }
+
+    int generation = snapshotGeneration.fetchAndAddOrdered(0);
+    if (local->generation == generation)
+        return local->snapshot;
+
+    bool load = false;
+    {
+        QMutexLocker locker(&snapshotLock);
+        generation = snapshotGeneration.fetchAndAddOrdered(0);
+        local->snapshot   = snapshot;
+        local->generation = generation;
+        // Only one thread loads the snapshot, and only once per generation
+        // so a failing query is not repeated for every setting.
+        if (!snapshot && snapshotTried != generation)
+        {
+            snapshotTried = generation;
+            snapshotLoading = true;
+            pendingStale.clear();
+            load = true;
+        }
+    }
+
+    if (!load)
+        return local->snapshot;
+
+    // Loading opens a database connection, which may itself save delayed
+    // settings and clear the cache, so the lock can not be held here.
+    SnapshotPtr loaded = LoadSnapshot();
+
+    QMutexLocker locker(&snapshotLock);
+    snapshotLoading = false;
+    if (!loaded)
+        return SnapshotPtr();
+
+    if (snapshotGeneration.fetchAndAddOrdered(0) != generation)
+        return SnapshotPtr(); // cleared while loading, it may be out of date
+
+    // Settings saved while loading may have been read before they changed
+    if (!pendingStale.isEmpty())
+    {
+        SettingsSnapshot *copy = new SettingsSnapshot(*loaded);
+        copy->stale += pendingStale;
+        loaded = SnapshotPtr(copy);
+        pendingStale.clear();
+    }
+
+    snapshot = loaded;
+    local->snapshot   = snapshot;
+    local->generation = snapshotGeneration.fetchAndAddOrdered(1) + 1;
+    return local->snapshot;
+}
+
+/// Forgets the snapshot, the next lookup loads a new one.
+void SettingsSnapshotCache::DropSnapshot(void)
+{
+    QMutexLocker locker(&snapshotLock);
+    snapshot.clear();
+    snapshotGeneration.fetchAndAddOrdered(1);
+}
+
+/// Publishes a copy of the snapshot in which key is no longer answered, so
+/// that saving one setting does not reload every setting.
+void SettingsSnapshotCache::MarkStale(const QString &key)
+{
+    QMutexLocker locker(&snapshotLock);
+    if (!snapshot)
+    {
+        if (snapshotLoading)
+            pendingStale.insert(key);
+        return;
+    }
+
+    if (snapshot->stale.contains(key))
+        return;
+
+    SettingsSnapshot *copy = new SettingsSnapshot(*snapshot);
+    copy->stale.insert(key);
+    snapshot = SnapshotPtr(copy);
+    snapshotGeneration.fetchAndAddOrdered(1);
+}
@@ -0,0 +1,98 @@
+#ifndef MYTHDBSNAPSHOT_H_
+#define MYTHDBSNAPSHOT_H_
+
+#include <QThreadStorage>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QVector>
+#include <QString>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+
+#include "mythbaseexp.h"
+
+/**
+ *  \class SettingsSnapshot
+ *
+ *  \brief Every row of the settings table, for all hosts, as of one query.
+ *
+ *  A snapshot is never modified once it has been published, so any number
+ *  of threads can read it without locking. Keys are interned: each distinct
+ *  key gets an id once, and values are looked up by id in one vector for
+ *  the global (hostname IS NULL) rows and one vector per host.
+ */
+class MBASE_PUBLIC SettingsSnapshot
+{
+  public:
+    SettingsSnapshot() : localHost(-1) {}
+
+    bool Lookup(const QString &key, int host, const QString &defaultval,
+                bool fallbackToGlobal, QString &value) const;
+    int  HostIndex(const QString &host) const;
+
+    /// key, in both its lower case and its database spelling -> key id
+    QHash<QString,int> keys;
+    /// lower case hostname -> index in hostValues
+    QHash<QString,int> hosts;
+    /// key id -> value of the global setting, null if there is none
+    QVector<QString>   global;
+    /// host index -> key id -> value of the host setting, null if none
+    QVector<QVector<QString> > hostValues;
+    /// index of the local host in hostValues, -1 if it has no settings
+    int localHost;
+    /// lower case keys cleared since the snapshot was loaded
+    QSet<QString> stale;
+};
+
+typedef QSharedPointer<const SettingsSnapshot> SnapshotPtr;
+
+/// Each thread's own reference to the current snapshot, so looking a setting
+/// up only has to compare the generation number.
+class LocalSnapshot
+{
+  public:
+    LocalSnapshot() : generation(-1) {}
+    int         generation;
+    SnapshotPtr snapshot;
+};
+
+/**
+ *  \class SettingsSnapshotCache
+ *
+ *  \brief Publishes the current SettingsSnapshot to every thread.
+ *
+ *  The snapshot is loaded by LoadSnapshot() on first use, by one thread
+ *  and without holding the lock. Keys cleared while it loads are marked
+ *  stale in it before it is published, since the load may have read them
+ *  before they were saved.
+ */
+class MBASE_PUBLIC SettingsSnapshotCache
+{
+  public:
+    SettingsSnapshotCache();
+    virtual ~SettingsSnapshotCache() {}
+
+    SnapshotPtr GetSnapshot(void);
+    void        DropSnapshot(void);
+    void        MarkStale(const QString &key);
+
+  protected:
+    /// Reads every setting, returns a null pointer if it can't
+    virtual SnapshotPtr LoadSnapshot(void) = 0;
+
+  private:
+    /// Protects snapshot, snapshotTried, snapshotLoading and pendingStale,
+    /// readers only take it when snapshotGeneration has moved on since
+    /// their last lookup
+    QMutex snapshotLock;
+    SnapshotPtr snapshot;
+    QAtomicInt snapshotGeneration;
+    int snapshotTried;
+    bool snapshotLoading;
+    /// Keys cleared while the snapshot was loading
+    QSet<QString> pendingStale;
+    QThreadStorage<LocalSnapshot*> localSnapshot;
+};
+
+#endif
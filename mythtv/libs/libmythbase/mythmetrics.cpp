@@ -0,0 +1,278 @@
+#include "mythmetrics.h"
+
+#include <QMap>
+#include <QMutex>
+#include <QList>
+
+#include "mythlogging.h"
+
+#define LOC QString("Metrics: ")
+
+static void append_value(QByteArray &out, const QByteArray &name,
+                         const QByteArray &labels, const QByteArray &value)
+{
+    out += name;
+    if (!labels.isEmpty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+void MythCounter::Write(QByteArray &out, const QByteArray &name,
+                        const QByteArray &labels) const
+{
+    append_value(out, name, labels, QByteArray::number((qlonglong)Value()));
+}
+
+void MythGauge::Write(QByteArray &out, const QByteArray &name,
+                      const QByteArray &labels) const
+{
+    append_value(out, name, labels, QByteArray::number((qlonglong)Value()));
+}
+
+MythHistogram::MythHistogram(const QVector<int64_t> &bounds, double scale) :
+    MythMetric(kHistogram), m_bounds(bounds),
+    m_scale((scale > 0.0) ? scale : 1.0),
+    m_buckets(new std::atomic<int64_t>[bounds.size() + 1]),
+    m_sum(0), m_count(0)
+{
+    for (int i = 0; i <= m_bounds.size(); ++i)
+        m_buckets[i].store(0, std::memory_order_relaxed);
+}
+
+MythHistogram::~MythHistogram()
+{
+    delete [] m_buckets;
+}
+
+void MythHistogram::Observe(int64_t value)
+{
+    // Bucket lists are short, a linear search beats a binary one here
+    int i = 0;
+    int size = m_bounds.size();
+    while (i < size && value > m_bounds[i])
+        ++i;
+
+    m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MythHistogram::Write(QByteArray &out, const QByteArray &name,
+                          const QByteArray &labels) const
+{
+    QByteArray bucket = name + "_bucket";
+    QByteArray prefix = labels.isEmpty() ? QByteArray() : labels + ',';
+
+    // Exposed buckets are cumulative
+    int64_t cumulative = 0;
+    for (int i = 0; i < m_bounds.size(); ++i)
+    {
+        cumulative += m_buckets[i].load(std::memory_order_relaxed);
+        append_value(out, bucket, prefix + "le=\"" +
+                     QByteArray::number(m_bounds[i] / m_scale) + '"',
+                     QByteArray::number((qlonglong)cumulative));
+    }
+    cumulative += m_buckets[m_bounds.size()].load(std::memory_order_relaxed);
+    append_value(out, bucket, prefix + "le=\"+Inf\"",
+                 QByteArray::number((qlonglong)cumulative));
+
+    append_value(out, name + "_sum", labels,
+                 QByteArray::number(m_sum.load(std::memory_order_relaxed) /
+                                    m_scale));
+    append_value(out, name + "_count", labels,
+                 QByteArray::number(
+                     (qlonglong)m_count.load(std::memory_order_relaxed)));
+}
+
+namespace
+{
+    class Family
+    {
+      public:
+        Family() : type(MythMetric::kCounter) {}
+
+        QByteArray                       help;
+        MythMetric::MetricType           type;
+        QMap<QByteArray, MythMetric*>    series; ///< keyed on labels
+    };
+
+    QMutex                       s_lock;
+    QMap<QByteArray, Family>     s_families;
+    QList<MythMetricsCollector>  s_collectors;
+}
+
+static const char *type_name(MythMetric::MetricType type)
+{
+    switch (type)
+    {
+        case MythMetric::kCounter:   return "counter";
+        case MythMetric::kGauge:     return "gauge";
+        case MythMetric::kHistogram: return "histogram";
+    }
+    return "untyped";
+}
+
+/// Returns the existing series, or NULL after adding a family for it if
+/// this is the first use of name. Must be called with s_lock held.
+static MythMetric *find_metric(const QString &name, const QString &help,
+                               const QString &labels,
+                               MythMetric::MetricType type, bool *mismatch)
+{
+    QByteArray key = name.toLatin1();
+    *mismatch = false;
+
+    QMap<QByteArray, Family>::iterator it = s_families.find(key);
+    if (it == s_families.end())
+    {
+        Family family;
+        family.help = help.toUtf8();
+        family.type = type;
+        s_families.insert(key, family);
+        return NULL;
+    }
+
+    if ((*it).type != type)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("'%1' is already registered as a %2, not a %3")
+                .arg(name).arg(type_name((*it).type)).arg(type_name(type)));
+        *mismatch = true;
+        return NULL;
+    }
+
+    return (*it).series.value(labels.toUtf8(), NULL);
+}
+
+static void add_metric(const QString &name, const QString &labels,
+                       MythMetric *metric)
+{
+    s_families[name.toLatin1()].series.insert(labels.toUtf8(), metric);
+}
+
+MythCounter *MythMetrics::Counter(const QString &name, const QString &help,
+                                  const QString &labels)
+{
+    QMutexLocker locker(&s_lock);
+
+    bool mismatch;
+    MythMetric *metric = find_metric(name, help, labels,
+                                     MythMetric::kCounter, &mismatch);
+    if (metric)
+        return static_cast<MythCounter*>(metric);
+
+    // On a type mismatch the caller gets a working counter which is
+    // simply never written out
+    MythCounter *counter = new MythCounter();
+    if (!mismatch)
+        add_metric(name, labels, counter);
+    return counter;
+}
+
+MythGauge *MythMetrics::Gauge(const QString &name, const QString &help,
+                              const QString &labels)
+{
+    QMutexLocker locker(&s_lock);
+
+    bool mismatch;
+    MythMetric *metric = find_metric(name, help, labels,
+                                     MythMetric::kGauge, &mismatch);
+    if (metric)
+        return static_cast<MythGauge*>(metric);
+
+    MythGauge *gauge = new MythGauge();
+    if (!mismatch)
+        add_metric(name, labels, gauge);
+    return gauge;
+}
+
+MythHistogram *MythMetrics::Histogram(const QString &name,
+                                      const QString &help,
+                                      const QVector<int64_t> &bounds,
+                                      double scale, const QString &labels)
+{
+    QMutexLocker locker(&s_lock);
+
+    bool mismatch;
+    MythMetric *metric = find_metric(name, help, labels,
+                                     MythMetric::kHistogram, &mismatch);
+    if (metric)
+        return static_cast<MythHistogram*>(metric);
+
+    MythHistogram *histogram = new MythHistogram(bounds, scale);
+    if (!mismatch)
+        add_metric(name, labels, histogram);
+    return histogram;
+}
+
+QVector<int64_t> MythMetrics::LatencyBuckets(void)
+{
+    QVector<int64_t> bounds;
+    bounds << 100 << 250 << 500
+           << 1000 << 2500 << 5000
+           << 10000 << 25000 << 50000
+           << 100000 << 250000 << 500000
+           << 1000000 << 2500000 << 5000000 << 10000000;
+    return bounds;
+}
+
+QString MythMetrics::Label(const QString &key, const QString &value)
+{
+    QString escaped = value;
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    escaped.replace('\n', "\\n");
+    return QString("%1=\"%2\"").arg(key).arg(escaped);
+}
+
+void MythMetrics::AddCollector(MythMetricsCollector collector)
+{
+    QMutexLocker locker(&s_lock);
+    if (!s_collectors.contains(collector))
+        s_collectors.append(collector);
+}
+
+/**
+ *  \brief Runs the collectors and returns every metric in the Prometheus
+ *         text exposition format, version 0.0.4.
+ */
+QByteArray MythMetrics::Exposition(void)
+{
+    s_lock.lock();
+    QList<MythMetricsCollector> collectors = s_collectors;
+    s_lock.unlock();
+
+    // Collectors register metrics themselves, so they run unlocked
+    QList<MythMetricsCollector>::const_iterator cit;
+    for (cit = collectors.begin(); cit != collectors.end(); ++cit)
+        (*cit)();
+
+    QByteArray out;
+    QMutexLocker locker(&s_lock);
+
+    QMap<QByteArray, Family>::const_iterator it;
+    for (it = s_families.begin(); it != s_families.end(); ++it)
+    {
+        if ((*it).series.isEmpty())
+            continue;
+
+        QByteArray help = (*it).help;
+        help.replace('\\', "\\\\");
+        help.replace('\n', "\\n");
+
+        out += "# HELP " + it.key() + ' ' + help + '\n';
+        out += QByteArray("# TYPE ") + it.key() + ' ' +
+               type_name((*it).type) + '\n';
+
+        QMap<QByteArray, MythMetric*>::const_iterator sit;
+        for (sit = (*it).series.begin(); sit != (*it).series.end(); ++sit)
+            (*sit)->Write(out, it.key(), sit.key());
+    }
+
+    return out;
+}
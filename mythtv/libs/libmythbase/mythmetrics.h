@@ -0,0 +1,164 @@
+#ifndef MYTHMETRICS_H_
+#define MYTHMETRICS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+#include "mythbaseexp.h"
+
+// Metric values are 64 bit, which QAtomicInt can not hold and the
+// QAtomicInteger template needs a newer Qt than we require, hence
+// std::atomic. Every update uses relaxed ordering, a scrape only needs
+// each value to be read atomically, not in any order with the others.
+
+/**
+ *  \class MythMetric
+ *
+ *  \brief A single time series, one metric name with one set of labels.
+ */
+class MBASE_PUBLIC MythMetric
+{
+  public:
+    typedef enum
+    {
+        kCounter,
+        kGauge,
+        kHistogram,
+    } MetricType;
+
+    virtual ~MythMetric() {}
+
+    MetricType GetType(void) const { return m_type; }
+
+    /// Appends the exposition lines of this series
+    virtual void Write(QByteArray &out, const QByteArray &name,
+                       const QByteArray &labels) const = 0;
+
+  protected:
+    explicit MythMetric(MetricType type) : m_type(type) {}
+
+  private:
+    MetricType m_type;
+};
+
+/// A value which only ever goes up, such as bytes written or errors seen
+class MBASE_PUBLIC MythCounter : public MythMetric
+{
+  public:
+    MythCounter() : MythMetric(kCounter), m_value(0) {}
+
+    void    Add(int64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Value(void) const  { return m_value.load(std::memory_order_relaxed); }
+
+    void Write(QByteArray &out, const QByteArray &name,
+               const QByteArray &labels) const;
+
+  private:
+    std::atomic<int64_t> m_value;
+};
+
+/// A value which goes up and down, such as a queue length
+class MBASE_PUBLIC MythGauge : public MythMetric
+{
+  public:
+    MythGauge() : MythMetric(kGauge), m_value(0) {}
+
+    void    Set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+    void    Add(int64_t n)     { m_value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Value(void) const  { return m_value.load(std::memory_order_relaxed); }
+
+    void Write(QByteArray &out, const QByteArray &name,
+               const QByteArray &labels) const;
+
+  private:
+    std::atomic<int64_t> m_value;
+};
+
+/**
+ *  \brief Counts observations into fixed buckets.
+ *
+ *  Observations are integers (microseconds, bytes) so that they can be
+ *  summed atomically, scale converts them to the unit the metric is
+ *  exposed in, e.g. 1000000 for microseconds exposed as seconds.
+ */
+class MBASE_PUBLIC MythHistogram : public MythMetric
+{
+  public:
+    MythHistogram(const QVector<int64_t> &bounds, double scale);
+   ~MythHistogram();
+
+    void Observe(int64_t value);
+
+    void Write(QByteArray &out, const QByteArray &name,
+               const QByteArray &labels) const;
+
+  private:
+    QVector<int64_t>      m_bounds; ///< inclusive upper bounds, ascending
+    double                m_scale;
+    std::atomic<int64_t> *m_buckets; ///< one more than m_bounds, for +Inf
+    std::atomic<int64_t>  m_sum;
+    std::atomic<int64_t>  m_count;
+};
+
+/// Observes the microseconds between its construction and destruction
+class MBASE_PUBLIC MythHistogramTimer
+{
+  public:
+    explicit MythHistogramTimer(MythHistogram *histogram) :
+        m_histogram(histogram) { m_timer.start(); }
+   ~MythHistogramTimer()
+    {
+        if (m_histogram)
+            m_histogram->Observe(m_timer.nsecsElapsed() / 1000);
+    }
+
+  private:
+    MythHistogram *m_histogram;
+    QElapsedTimer  m_timer;
+};
+
+typedef void (*MythMetricsCollector)(void);
+
+/**
+ *  \class MythMetrics
+ *
+ *  \brief Process wide registry of metrics, written out in the Prometheus
+ *         text exposition format.
+ *
+ *  Looking a metric up takes a lock, so callers look it up once and keep
+ *  the pointer. Metrics are never deleted, updating one is a single
+ *  relaxed atomic operation and is safe on per packet paths.
+ *
+ *  Values which are expensive to keep up to date can instead be set by a
+ *  collector, which is called just before the metrics are written out.
+ */
+class MBASE_PUBLIC MythMetrics
+{
+  public:
+    static MythCounter   *Counter(const QString &name, const QString &help,
+                                  const QString &labels = QString());
+    static MythGauge     *Gauge(const QString &name, const QString &help,
+                                const QString &labels = QString());
+    static MythHistogram *Histogram(const QString &name, const QString &help,
+                                    const QVector<int64_t> &bounds,
+                                    double scale,
+                                    const QString &labels = QString());
+
+    /// Bounds in microseconds from 100us to 10s, for latency histograms
+    static QVector<int64_t> LatencyBuckets(void);
+
+    /// Returns key="value" with value escaped, join several with ','
+    static QString Label(const QString &key, const QString &value);
+
+    static void AddCollector(MythMetricsCollector collector);
+
+    static QByteArray Exposition(void);
+};
+
+#endif
@@ -3,7 +3,6 @@
 #ifndef _MYTHSYSTEM_UNIX_H_
 #define _MYTHSYSTEM_UNIX_H_
 
-#include <sys/select.h>
 #include <signal.h>
 
 #include <QObject>
@@ -27,6 +26,31 @@ typedef QMap<pid_t, QPointer<MythSystemLegacyUnix> > MSMap_t;
 typedef QMap<int, QBuffer *> PMap_t;
 typedef QList<QPointer<MythSystemLegacyUnix> > MSList_t;
 
+/// Waits for any of a set of file descriptors to become ready, and can be
+/// woken from another thread. Uses epoll on Linux and poll() elsewhere.
+class MythSystemLegacyPoller
+{
+    public:
+        MythSystemLegacyPoller();
+        ~MythSystemLegacyPoller();
+
+        void       Add(int fd, bool write = false);
+        void       Remove(int fd);
+        void       Wake(void);
+        /// Waits up to timeout ms, or until woken if timeout is negative,
+        /// and returns the descriptors which are ready
+        QList<int> Wait(int timeout);
+
+    private:
+        int             m_wakefd[2]; ///< the same eventfd twice on Linux
+#ifdef __linux__
+        int             m_epollfd;
+#else
+        QMutex          m_lock;
+        QMap<int, bool> m_fds;       ///< true for descriptors to write to
+#endif
+};
+
 class MythSystemLegacyIOHandler: public MThread
 {
     public:
@@ -40,19 +64,16 @@ class MythSystemLegacyIOHandler: public MThread
         void   wake();
 
     private:
-        void   HandleRead(int fd, QBuffer *buff);
+        bool   HandleRead(int fd, QBuffer *buff);
         void   HandleWrite(int fd, QBuffer *buff);
-        void   BuildFDs();
+        void   Drop(int fd);
 
-        QMutex          m_pWaitLock;
-        QWaitCondition  m_pWait;
         QMutex          m_pLock;
+        QWaitCondition  m_pRemoved;
         PMap_t          m_pMap;
 
-        fd_set m_fds;
-        int    m_maxfd;
+        MythSystemLegacyPoller m_poller;
         bool   m_read;
-        char   m_readbuf[65536];
 };
 
 class MythSystemLegacyManager : public MThread
@@ -63,12 +84,16 @@ class MythSystemLegacyManager : public MThread
         void run(void);
         void append(MythSystemLegacyUnix *);
         void jumpAbort(void);
+        void wake(void) { m_poller.Wake(); }
     private:
+        int  NextTimeout(void) const;
+
         MSMap_t    m_pMap;
+        QMap<pid_t, int> m_pidfds; ///< pidfd for each child, where supported
         QMutex     m_mapLock;
         bool       m_jumpAbort;
         QMutex     m_jumpLock;
-        QWaitCondition m_wait;
+        MythSystemLegacyPoller m_poller;
 };
 
 class MythSystemLegacySignalManager : public MThread
@@ -0,0 +1,561 @@
+// POSIX headers
+#include <unistd.h> // for getpid
+
+// Qt headers
+#include <QCoreApplication>
+#include <QThreadStorage>
+#include <QStringList>
+#include <QAtomicInt>
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <QSet>
+#include <QList>
+#include <QFile>
+#include <QDir>
+
+// MythTV headers
+#include "mythtrace.h"
+#include "mythlogging.h"
+#include "compat.h"
+
+#define LOC QString("Trace: ")
+
+QAtomicInt MythTrace::s_categories(kTraceNone);
+
+namespace
+{
+    const struct
+    {
+        int         category;
+        const char *name;
+    } kCategoryNames[] =
+    {
+        { kTraceRecorder,  "recorder"  },
+        { kTraceStream,    "stream"    },
+        { kTraceScheduler, "scheduler" },
+        { kTraceServer,    "server"    },
+        { kTracePlayer,    "player"    },
+        { kTraceUI,        "ui"        },
+        { kTraceNone,      NULL        },
+    };
+
+    /// Events kept for each thread, the oldest are overwritten first
+    const int kBufferSize = 16384;
+    /// Buffers of exited threads kept until written out, so threads that
+    /// come and go (e.g. thread pool workers) can't grow memory forever
+    const int kMaxExitedBuffers = 32;
+
+    class TraceEvent
+    {
+      public:
+        const char *name;
+        QString     detail;
+        int64_t     timestamp;
+        int64_t     value;     ///< duration, counter value or async id
+        int         category;
+        char        phase;     ///< Chrome trace event phase
+    };
+
+    class TraceBuffer
+    {
+      public:
+        TraceBuffer() : next(0), thread(0), exited(false), serial(0) {}
+
+        void Add(const TraceEvent &event)
+        {
+            QMutexLocker locker(&lock);
+            if (events.size() < kBufferSize)
+            {
+                events.append(event);
+                return;
+            }
+            events[next] = event;
+            next = (next + 1) % kBufferSize;
+        }
+
+        /// Only ever contended while the buffers are being written out
+        QMutex              lock;
+        QVector<TraceEvent> events;
+        int                 next;   ///< oldest event once the buffer is full
+        quint64             thread;
+        QString             threadName;
+        bool                exited; ///< only changed with s_buffersLock held
+        quint64             serial; ///< unique, unlike the buffer's address
+    };
+
+    /// Owned by the thread, marks its buffer as orphaned when the thread
+    /// exits so the events survive until they have been written out.
+    class TraceBufferHolder
+    {
+      public:
+        explicit TraceBufferHolder(TraceBuffer *b) : buffer(b) {}
+       ~TraceBufferHolder();
+        TraceBuffer *buffer;
+    };
+
+    QMutex                             s_buffersLock;
+    QList<TraceBuffer*>                s_buffers;
+    QThreadStorage<TraceBufferHolder*> s_localBuffer;
+    QAtomicInt                         s_nextFlowId(1);
+    quint64                            s_nextSerial = 1;
+}
+
+/// Deletes the oldest buffers of exited threads until at most keep are
+/// left, s_buffersLock must be held.
+static void prune_exited(int keep)
+{
+    int exited = 0;
+    QList<TraceBuffer*>::const_iterator cit;
+    for (cit = s_buffers.begin(); cit != s_buffers.end(); ++cit)
+        exited += (*cit)->exited ? 1 : 0;
+
+    QList<TraceBuffer*>::iterator it = s_buffers.begin();
+    while (exited > keep && it != s_buffers.end())
+    {
+        if (!(*it)->exited)
+        {
+            ++it;
+            continue;
+        }
+
+        delete *it;
+        it = s_buffers.erase(it);
+        --exited;
+    }
+}
+
+TraceBufferHolder::~TraceBufferHolder()
+{
+    QMutexLocker locker(&s_buffersLock);
+
+    // no other thread adds to it, and it can't be written out without
+    // s_buffersLock, so the buffer lock isn't needed
+    buffer->exited = true;
+
+    // nothing left to write out
+    if (buffer->events.isEmpty())
+    {
+        s_buffers.removeOne(buffer);
+        delete buffer;
+    }
+
+    prune_exited(kMaxExitedBuffers);
+}
+
+static const char *category_name(int category)
+{
+    for (int i = 0; kCategoryNames[i].name; ++i)
+    {
+        if (kCategoryNames[i].category & category)
+            return kCategoryNames[i].name;
+    }
+    return "general";
+}
+
+static TraceBuffer *local_buffer(void)
+{
+    TraceBufferHolder *holder = s_localBuffer.localData();
+    if (holder)
+        return holder->buffer;
+
+    TraceBuffer *buffer = new TraceBuffer();
+    buffer->thread = (quint64)QThread::currentThreadId();
+
+    QThread *thread = QThread::currentThread();
+    if (thread && QCoreApplication::instance() &&
+        thread == QCoreApplication::instance()->thread())
+        buffer->threadName = "main";
+    else if (thread)
+        buffer->threadName = thread->objectName();
+
+    s_localBuffer.setLocalData(new TraceBufferHolder(buffer));
+
+    QMutexLocker locker(&s_buffersLock);
+    buffer->serial = s_nextSerial++;
+    s_buffers.append(buffer);
+    return buffer;
+}
+
+static void add_event(int category, const char *name, char phase,
+                      int64_t timestamp, int64_t value,
+                      const QString &detail)
+{
+    // the category may have been turned off since the caller checked
+    if (!MythTrace::IsEnabled(category))
+        return;
+
+    TraceEvent event;
+    event.name      = name;
+    event.detail    = detail;
+    event.timestamp = timestamp;
+    event.value     = value;
+    event.category  = category;
+    event.phase     = phase;
+
+    local_buffer()->Add(event);
+}
+
+void MythTrace::SetCategories(int categories)
+{
+    categories &= MYTH_TRACE_COMPILED_CATEGORIES;
+    s_categories.fetchAndStoreOrdered(categories);
+    LOG(VB_GENERAL, LOG_NOTICE, LOC + QString("Tracing: %1")
+        .arg(CategoryString(categories)));
+}
+
+/**
+ *  \brief Parses a comma separated list of category names, or "all" or
+ *         "none", into a category mask.
+ */
+int MythTrace::ParseCategories(const QString &list, bool *ok)
+{
+    int categories = kTraceNone;
+    bool valid = true;
+
+    QStringList names = list.toLower().split(',', QString::SkipEmptyParts);
+    QStringList::const_iterator it;
+    for (it = names.begin(); it != names.end(); ++it)
+    {
+        QString name = (*it).trimmed();
+        if (name == "all")
+        {
+            categories = kTraceAll;
+            continue;
+        }
+        if (name == "none")
+        {
+            categories = kTraceNone;
+            continue;
+        }
+
+        int i = 0;
+        for (; kCategoryNames[i].name; ++i)
+        {
+            if (name == kCategoryNames[i].name)
+            {
+                categories |= kCategoryNames[i].category;
+                break;
+            }
+        }
+
+        if (!kCategoryNames[i].name)
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC +
+                QString("Unknown trace category '%1'").arg(name));
+            valid = false;
+        }
+    }
+
+    if (ok)
+        *ok = valid;
+    return categories;
+}
+
+QString MythTrace::CategoryString(int categories)
+{
+    if (categories == kTraceNone)
+        return "none";
+
+    QStringList names;
+    for (int i = 0; kCategoryNames[i].name; ++i)
+    {
+        if (categories & kCategoryNames[i].category)
+            names << kCategoryNames[i].name;
+    }
+    return names.join(",");
+}
+
+int64_t MythTrace::Now(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+uint64_t MythTrace::NewFlowId(void)
+{
+    // The process id keeps ids apart in traces merged from several processes
+    return ((uint64_t)getpid() << 32) |
+           (uint32_t)s_nextFlowId.fetchAndAddOrdered(1);
+}
+
+void MythTrace::Complete(int category, const char *name,
+                         int64_t start, int64_t duration,
+                         const QString &detail)
+{
+    add_event(category, name, 'X', start, duration, detail);
+}
+
+void MythTrace::Instant(int category, const char *name,
+                        const QString &detail)
+{
+    add_event(category, name, 'i', Now(), 0, detail);
+}
+
+void MythTrace::Counter(int category, const char *name, int64_t value)
+{
+    add_event(category, name, 'C', Now(), value, QString());
+}
+
+void MythTrace::AsyncBegin(int category, const char *name, uint64_t id)
+{
+    add_event(category, name, 'b', Now(), (int64_t)id, QString());
+}
+
+void MythTrace::AsyncStep(int category, const char *name, uint64_t id,
+                          const QString &detail)
+{
+    add_event(category, name, 'n', Now(), (int64_t)id, detail);
+}
+
+void MythTrace::AsyncEnd(int category, const char *name, uint64_t id)
+{
+    add_event(category, name, 'e', Now(), (int64_t)id, QString());
+}
+
+static QByteArray json_string(const QString &str)
+{
+    QByteArray utf8 = str.toUtf8();
+    QByteArray result;
+    result.reserve(utf8.size() + 2);
+    result += '"';
+    for (int i = 0; i < utf8.size(); ++i)
+    {
+        char c = utf8[i];
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            result += QString().sprintf("\\u%04x", (unsigned char)c)
+                .toLatin1();
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+static void append_event(QByteArray &out, const TraceEvent &event,
+                         qint64 pid, quint64 tid)
+{
+    out += ",\n{\"name\":";
+    out += json_string(QString::fromUtf8(event.name));
+    out += ",\"cat\":\"";
+    out += category_name(event.category);
+    out += "\",\"ph\":\"";
+    out += event.phase;
+    out += "\",\"ts\":";
+    out += QByteArray::number((qlonglong)event.timestamp);
+    out += ",\"pid\":";
+    out += QByteArray::number(pid);
+    out += ",\"tid\":";
+    out += QByteArray::number(tid);
+
+    switch (event.phase)
+    {
+        case 'X':
+            out += ",\"dur\":";
+            out += QByteArray::number((qlonglong)event.value);
+            break;
+        case 'i':
+            out += ",\"s\":\"t\"";
+            break;
+        case 'C':
+            out += ",\"args\":{\"value\":";
+            out += QByteArray::number((qlonglong)event.value);
+            out += "}";
+            break;
+        default:
+            out += ",\"id\":\"0x";
+            out += QByteArray::number((qulonglong)event.value, 16);
+            out += "\"";
+            break;
+    }
+
+    if (!event.detail.isEmpty() && event.phase != 'C')
+    {
+        out += ",\"args\":{\"detail\":";
+        out += json_string(event.detail);
+        out += "}";
+    }
+
+    out += "}";
+}
+
+/**
+ *  \brief Returns the events recorded so far by every thread in the Chrome
+ *         trace event format.
+ *
+ *  The serial numbers of the buffers of threads that had already exited
+ *  are added to exited, as nothing more can be added to those buffers.
+ */
+static QByteArray to_json(QSet<quint64> *exited)
+{
+    qint64 pid = getpid();
+    QByteArray out;
+
+    out += "{\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":";
+    out += QByteArray::number(pid);
+    out += ",\"args\":{\"name\":";
+    out += json_string(QCoreApplication::applicationName());
+    out += "}}";
+
+    QMutexLocker locker(&s_buffersLock);
+    QList<TraceBuffer*>::const_iterator it;
+    for (it = s_buffers.begin(); it != s_buffers.end(); ++it)
+    {
+        TraceBuffer *buffer = *it;
+        QMutexLocker bufferLocker(&buffer->lock);
+
+        if (!buffer->threadName.isEmpty())
+        {
+            out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":";
+            out += QByteArray::number(pid);
+            out += ",\"tid\":";
+            out += QByteArray::number(buffer->thread);
+            out += ",\"args\":{\"name\":";
+            out += json_string(buffer->threadName);
+            out += "}}";
+        }
+
+        int count = buffer->events.size();
+        for (int i = 0; i < count; ++i)
+        {
+            append_event(out, buffer->events[(buffer->next + i) % count],
+                         pid, buffer->thread);
+        }
+
+        if (exited && buffer->exited)
+            exited->insert(buffer->serial);
+    }
+
+    out += "\n]}\n";
+    return out;
+}
+
+QByteArray MythTrace::ToJSON(void)
+{
+    return to_json(NULL);
+}
+
+bool MythTrace::Write(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Unable to write trace to '%1'").arg(filename));
+        return false;
+    }
+
+    QSet<quint64> exited;
+    QByteArray json = to_json(&exited);
+    if (file.write(json) != json.size())
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Error writing trace to '%1'").arg(filename));
+        return false;
+    }
+
+    // the events of threads that had exited are in the file now
+    s_buffersLock.lock();
+    QList<TraceBuffer*>::iterator it = s_buffers.begin();
+    while (it != s_buffers.end())
+    {
+        if (exited.contains((*it)->serial))
+        {
+            delete *it;
+            it = s_buffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    s_buffersLock.unlock();
+
+    LOG(VB_GENERAL, LOG_NOTICE, LOC +
+        QString("Wrote trace to '%1'").arg(filename));
+    return true;
+}
+
+/// \brief Returns directory/<application>-<pid>.trace.json, the directory
+///        defaults to the temporary directory.
+QString MythTrace::DefaultFilename(const QString &directory)
+{
+    QString dir = directory.isEmpty() ? QDir::tempPath() : directory;
+    return QString("%1/%2-%3.trace.json").arg(dir)
+        .arg(QCoreApplication::applicationName()).arg(getpid());
+}
+
+/// \brief Discards all recorded events and the buffers of exited threads.
+void MythTrace::Clear(void)
+{
+    QMutexLocker locker(&s_buffersLock);
+    QList<TraceBuffer*>::iterator it = s_buffers.begin();
+    while (it != s_buffers.end())
+    {
+        TraceBuffer *buffer = *it;
+        buffer->lock.lock();
+        bool exited = buffer->exited;
+        buffer->events.clear();
+        buffer->next = 0;
+        buffer->lock.unlock();
+
+        if (exited)
+        {
+            delete buffer;
+            it = s_buffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/**
+ *  \brief Handles the trace control messages sent by mythutil and the
+ *         Myth service.
+ *
+ *  "TRACE <categories>" changes the recorded categories, "TRACE_DUMP
+ *  [directory]" writes this process' events to DefaultFilename(directory)
+ *  and "TRACE_CLEAR" discards them.
+ *
+ *  \return true if message was a trace control message
+ */
+bool MythTrace::HandleMessage(const QString &message)
+{
+    QString command = message.section(' ', 0, 0);
+
+    if (command == "TRACE")
+    {
+        bool ok = false;
+        int categories = ParseCategories(message.section(' ', 1), &ok);
+        if (ok)
+            SetCategories(categories);
+        return true;
+    }
+
+    if (command == "TRACE_DUMP")
+    {
+        Write(DefaultFilename(message.section(' ', 1).trimmed()));
+        return true;
+    }
+
+    if (command == "TRACE_CLEAR")
+    {
+        Clear();
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,159 @@
+#ifndef MYTHTRACE_H_
+#define MYTHTRACE_H_
+
+#include <stdint.h>
+
+#include <QByteArray>
+#include <QString>
+#include <QAtomicInt>
+
+#include "mythbaseexp.h"
+
+/**
+ *  Trace categories. A process only records the categories which have been
+ *  enabled, with --trace on the command line, "mythutil --settrace" or the
+ *  Myth/SetTrace service, so instrumented code costs one test of a global
+ *  mask when tracing is off.
+ */
+enum TraceCategory
+{
+    kTraceNone      = 0x0000,
+    kTraceRecorder  = 0x0001, ///< recorder write path
+    kTraceStream    = 0x0002, ///< stream handlers and device read buffers
+    kTraceScheduler = 0x0004, ///< scheduler phases
+    kTraceServer    = 0x0008, ///< MainServer protocol commands
+    kTracePlayer    = 0x0010, ///< player decode and display loops
+    kTraceUI        = 0x0020, ///< user interface
+    kTraceAll       = 0xffff
+};
+
+/// Categories compiled into this build. Building with, for example,
+/// -DMYTH_TRACE_COMPILED_CATEGORIES=0 removes all trace points.
+#ifndef MYTH_TRACE_COMPILED_CATEGORIES
+#define MYTH_TRACE_COMPILED_CATEGORIES kTraceAll
+#endif
+
+/**
+ *  \class MythTrace
+ *
+ *  \brief Low overhead trace events: spans, counters and async flows.
+ *
+ *  Each thread records events into its own ring buffer, so recording never
+ *  contends with other threads. Timestamps are wall clock microseconds, so
+ *  traces written by the backend and a frontend line up in one timeline.
+ *
+ *  Buffers are written in the Chrome trace event format, which both
+ *  chrome://tracing and the Perfetto UI read. A "TRACE_DUMP" message makes
+ *  every process write its own file, named after the application and
+ *  process id.
+ *
+ *  Event names must be string literals (or otherwise outlive the process),
+ *  only a pointer to them is kept.
+ */
+class MBASE_PUBLIC MythTrace
+{
+  public:
+    static inline bool IsEnabled(int category)
+    {
+        return (MYTH_TRACE_COMPILED_CATEGORIES & category) &&
+               (s_categories.load() & category);
+    }
+
+    static void    SetCategories(int categories);
+    static int     GetCategories(void) { return s_categories.load(); }
+    static int     ParseCategories(const QString &list, bool *ok = NULL);
+    static QString CategoryString(int categories);
+
+    /// Wall clock time in microseconds
+    static int64_t  Now(void);
+    /// Returns a process wide unique id for async flows
+    static uint64_t NewFlowId(void);
+
+    static void Complete(int category, const char *name,
+                         int64_t start, int64_t duration,
+                         const QString &detail = QString());
+    static void Instant(int category, const char *name,
+                        const QString &detail = QString());
+    static void Counter(int category, const char *name, int64_t value);
+    static void AsyncBegin(int category, const char *name, uint64_t id);
+    static void AsyncStep(int category, const char *name, uint64_t id,
+                          const QString &detail = QString());
+    static void AsyncEnd(int category, const char *name, uint64_t id);
+
+    static QByteArray ToJSON(void);
+    static bool       Write(const QString &filename);
+    static QString    DefaultFilename(const QString &directory = QString());
+    static void       Clear(void);
+
+    static bool HandleMessage(const QString &message);
+
+  private:
+    static QAtomicInt s_categories;
+};
+
+/**
+ *  \class MythTraceSpan
+ *
+ *  \brief Records a complete event covering its own lifetime.
+ */
+class MBASE_PUBLIC MythTraceSpan
+{
+  public:
+    MythTraceSpan(int category, const char *name) :
+        m_category(category), m_name(name),
+        m_start(MythTrace::IsEnabled(category) ? MythTrace::Now() : -1) {}
+    MythTraceSpan(int category, const char *name, const QString &detail) :
+        m_category(category), m_name(name),
+        m_start(MythTrace::IsEnabled(category) ? MythTrace::Now() : -1),
+        m_detail(detail) {}
+   ~MythTraceSpan()
+    {
+        if (m_start >= 0)
+            MythTrace::Complete(m_category, m_name, m_start,
+                                MythTrace::Now() - m_start, m_detail);
+    }
+
+    bool IsActive(void) const { return m_start >= 0; }
+    void SetDetail(const QString &detail) { m_detail = detail; }
+
+  private:
+    int         m_category;
+    const char *m_name;
+    int64_t     m_start;
+    QString     m_detail;
+};
+
+#define MYTH_TRACE_CONCAT2(a, b) a##b
+#define MYTH_TRACE_CONCAT(a, b) MYTH_TRACE_CONCAT2(a, b)
+#define MYTH_TRACE_VAR MYTH_TRACE_CONCAT(myth_trace_span_, __LINE__)
+
+/// Records a span from here to the end of the enclosing scope
+#define MYTH_TRACE_SPAN(category, name) \
+    MythTraceSpan MYTH_TRACE_VAR(category, name)
+
+/// As MYTH_TRACE_SPAN, detail is only evaluated when the category is enabled
+#define MYTH_TRACE_SPAN_DETAIL(category, name, detail) \
+    MythTraceSpan MYTH_TRACE_VAR(category, name, \
+        MythTrace::IsEnabled(category) ? QString(detail) : QString())
+
+#define MYTH_TRACE_INSTANT(category, name, detail) \
+    do { if (MythTrace::IsEnabled(category)) \
+             MythTrace::Instant(category, name, detail); } while (0)
+
+#define MYTH_TRACE_COUNTER(category, name, value) \
+    do { if (MythTrace::IsEnabled(category)) \
+             MythTrace::Counter(category, name, value); } while (0)
+
+#define MYTH_TRACE_ASYNC_BEGIN(category, name, id) \
+    do { if (MythTrace::IsEnabled(category)) \
+             MythTrace::AsyncBegin(category, name, id); } while (0)
+
+#define MYTH_TRACE_ASYNC_STEP(category, name, id, detail) \
+    do { if (MythTrace::IsEnabled(category)) \
+             MythTrace::AsyncStep(category, name, id, detail); } while (0)
+
+#define MYTH_TRACE_ASYNC_END(category, name, id) \
+    do { if (MythTrace::IsEnabled(category)) \
+             MythTrace::AsyncEnd(category, name, id); } while (0)
+
+#endif
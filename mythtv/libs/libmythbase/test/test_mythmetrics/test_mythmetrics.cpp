@@ -0,0 +1,3 @@
+#include "test_mythmetrics.h"
+
+QTEST_APPLESS_MAIN(TestMythMetrics)
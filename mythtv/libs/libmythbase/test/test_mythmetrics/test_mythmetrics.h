@@ -0,0 +1,139 @@
+/*
+ *  Class TestMythMetrics
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "mythmetrics.h"
+
+static int s_collected = 0;
+
+static void collect(void)
+{
+    ++s_collected;
+    MythMetrics::Gauge("test_collected_gauge", "Set by a collector")
+        ->Set(s_collected);
+}
+
+class TestMythMetrics: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void CounterAccumulates(void)
+    {
+        MythCounter *counter =
+            MythMetrics::Counter("test_counter_total", "A counter");
+        counter->Add();
+        counter->Add(41);
+        QCOMPARE((qlonglong)counter->Value(), 42LL);
+
+        QVERIFY(MythMetrics::Exposition().contains(
+                    "# TYPE test_counter_total counter\n"
+                    "test_counter_total 42\n"));
+    }
+
+    void SameNameReturnsSameMetric(void)
+    {
+        MythGauge *a = MythMetrics::Gauge("test_same_gauge", "A gauge");
+        MythGauge *b = MythMetrics::Gauge("test_same_gauge", "A gauge");
+        QCOMPARE(a, b);
+
+        MythGauge *c = MythMetrics::Gauge("test_same_gauge", "A gauge",
+                                          MythMetrics::Label("x", "1"));
+        QVERIFY(a != c);
+    }
+
+    void TypeMismatchIsNotExposed(void)
+    {
+        MythMetrics::Gauge("test_mismatch", "A gauge")->Set(7);
+        MythCounter *counter = MythMetrics::Counter("test_mismatch", "Oops");
+        QVERIFY(counter);
+        counter->Add(100);
+
+        QByteArray out = MythMetrics::Exposition();
+        QVERIFY(out.contains("test_mismatch 7\n"));
+        QVERIFY(!out.contains("test_mismatch 100\n"));
+    }
+
+    void LabelsAreEscaped(void)
+    {
+        QCOMPARE(MythMetrics::Label("device", "a\"b\\c"),
+                 QString("device=\"a\\\"b\\\\c\""));
+
+        MythMetrics::Gauge("test_labelled", "Labelled",
+                           MythMetrics::Label("device", "/dev/dvb0"))->Set(3);
+        QVERIFY(MythMetrics::Exposition().contains(
+                    "test_labelled{device=\"/dev/dvb0\"} 3\n"));
+    }
+
+    void HistogramBucketsAreCumulative(void)
+    {
+        QVector<int64_t> bounds;
+        bounds << 10 << 100;
+        MythHistogram *histogram =
+            MythMetrics::Histogram("test_histogram", "A histogram",
+                                   bounds, 1000.0);
+        histogram->Observe(5);
+        histogram->Observe(10);
+        histogram->Observe(50);
+        histogram->Observe(5000);
+
+        QByteArray out = MythMetrics::Exposition();
+        QVERIFY(out.contains("# TYPE test_histogram histogram\n"));
+        QVERIFY(out.contains("test_histogram_bucket{le=\"0.01\"} 2\n"));
+        QVERIFY(out.contains("test_histogram_bucket{le=\"0.1\"} 3\n"));
+        QVERIFY(out.contains("test_histogram_bucket{le=\"+Inf\"} 4\n"));
+        QVERIFY(out.contains("test_histogram_sum 5.065\n"));
+        QVERIFY(out.contains("test_histogram_count 4\n"));
+    }
+
+    void CollectorsRunOnExposition(void)
+    {
+        MythMetrics::AddCollector(collect);
+        MythMetrics::AddCollector(collect);
+
+        int before = s_collected;
+        QByteArray out = MythMetrics::Exposition();
+        QCOMPARE(s_collected, before + 1);
+        QVERIFY(out.contains(QByteArray("test_collected_gauge ") +
+                             QByteArray::number(s_collected) + '\n'));
+    }
+
+    void HelpIsWrittenOncePerName(void)
+    {
+        MythMetrics::Counter("test_family_total", "Family",
+                             MythMetrics::Label("direction", "read"));
+        MythMetrics::Counter("test_family_total", "Family",
+                             MythMetrics::Label("direction", "write"));
+
+        QByteArray out = MythMetrics::Exposition();
+        QCOMPARE(out.count("# HELP test_family_total"), 1);
+        QVERIFY(out.contains("test_family_total{direction=\"read\"} 0\n"));
+        QVERIFY(out.contains("test_family_total{direction=\"write\"} 0\n"));
+    }
+
+    void CounterUpdateBenchmark(void)
+    {
+        MythCounter *counter =
+            MythMetrics::Counter("test_benchmark_total", "Benchmark");
+        QBENCHMARK
+        {
+            counter->Add();
+        }
+    }
+};
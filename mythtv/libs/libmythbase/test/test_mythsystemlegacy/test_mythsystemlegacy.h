@@ -23,6 +23,8 @@
 #include <QtTest/QtTest>
 #include <QTemporaryFile>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QDir>
 
 #include <iostream>
 using namespace std;
@@ -35,6 +37,7 @@ using namespace std;
 
 #include "mythcorecontext.h"
 #include "mythsystemlegacy.h"
+#include "exitcodes.h"
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #define MSKIP(MSG) QSKIP(MSG, SkipSingle)
@@ -61,6 +64,27 @@ class TestMythSystemLegacy: public QObject
         (void) s.Wait();
     }
 
+    // Each time a sleeping thread wakes up is a voluntary context switch
+    static qlonglong ContextSwitches(void)
+    {
+        qlonglong total = 0;
+        QDir tasks("/proc/self/task");
+        QStringList tids = tasks.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (int i = 0; i < tids.size(); ++i)
+        {
+            QFile status(tasks.filePath(tids[i] + "/status"));
+            if (!status.open(QIODevice::ReadOnly))
+                continue;
+            QList<QByteArray> lines = status.readAll().split('\n');
+            for (int j = 0; j < lines.size(); ++j)
+            {
+                if (lines[j].startsWith("voluntary_ctxt_switches:"))
+                    total += lines[j].mid(24).trimmed().toLongLong();
+            }
+        }
+        return total;
+    }
+
   private slots:
     // called at the beginning of these sets of tests
     void initTestCase(void)
@@ -193,6 +217,44 @@ class TestMythSystemLegacy: public QObject
 #endif
     }
 
+    // Spawns MYTHTV_SPAWN_BENCH_COUNT short processes and prints the time
+    // taken, then how often the helper threads wake up when there is
+    // nothing running, on a line starting "SPAWNBENCH ". It is skipped if
+    // MYTHTV_SPAWN_BENCH_COUNT isn't set.
+    void spawn_benchmark(void)
+    {
+        QByteArray env = qgetenv("MYTHTV_SPAWN_BENCH_COUNT");
+        if (env.isEmpty())
+            MSKIP("Set MYTHTV_SPAWN_BENCH_COUNT to the number of processes");
+        if (!QFile::exists("/proc/self/task"))
+            MSKIP("Counting wakeups needs /proc");
+
+        int count = env.toInt();
+        QVERIFY(count > 0);
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < count; ++i)
+        {
+            MythSystemLegacy cmd("/bin/true", kMSStdOut);
+            Go(cmd);
+            QCOMPARE(cmd.GetStatus(), (uint)GENERIC_EXIT_OK);
+        }
+        qint64 elapsed = timer.elapsed();
+
+        // Let everything settle, then count wakeups while idle. This
+        // thread's own sleep accounts for one.
+        usleep(200 * 1000);
+        qlonglong before = ContextSwitches();
+        usleep(2 * 1000 * 1000);
+        qlonglong wakeups = ContextSwitches() - before - 1;
+
+        printf("SPAWNBENCH {\"processes\":%d,\"wall_ms\":%lld,"
+               "\"per_process_us\":%.1f,\"idle_wakeups_per_sec\":%.1f}\n",
+               count, (long long)elapsed, elapsed * 1000.0 / count,
+               wakeups / 2.0);
+    }
+
     // TODO flags to test
     // TODO kMSAutoCleanup        -- automatically delete if backgrounded
     // TODO kMSDisableUDPListener -- disable MythMessage UDP listener
@@ -0,0 +1,3 @@
+#include "test_mythtrace.h"
+
+QTEST_APPLESS_MAIN(TestMythTrace)
@@ -0,0 +1,190 @@
+/*
+ *  Class TestMythTrace
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include "mythtrace.h"
+
+/// Records one event and exits
+class TraceThread : public QThread
+{
+  protected:
+    void run(void)
+    {
+        MYTH_TRACE_INSTANT(kTraceUI, "from exited thread", QString());
+    }
+};
+
+class TestMythTrace: public QObject
+{
+    Q_OBJECT
+
+  private:
+    static QString CountedDetail(int *calls)
+    {
+        ++(*calls);
+        return QString("counted");
+    }
+
+  private slots:
+    // called before each test case
+    void init(void)
+    {
+        MythTrace::SetCategories(kTraceNone);
+        MythTrace::Clear();
+    }
+
+    void ParsesCategoryList(void)
+    {
+        bool ok = false;
+        int categories = MythTrace::ParseCategories("recorder,Player", &ok);
+        QVERIFY(ok);
+        QCOMPARE(categories, (int)(kTraceRecorder | kTracePlayer));
+        QCOMPARE(MythTrace::CategoryString(categories),
+                 QString("recorder,player"));
+    }
+
+    void ParsesAllAndNone(void)
+    {
+        QCOMPARE(MythTrace::ParseCategories("all"), (int)kTraceAll);
+        QCOMPARE(MythTrace::ParseCategories("all,none"), (int)kTraceNone);
+        QCOMPARE(MythTrace::CategoryString(kTraceNone), QString("none"));
+    }
+
+    void RejectsUnknownCategory(void)
+    {
+        bool ok = true;
+        MythTrace::ParseCategories("recorder,bogus", &ok);
+        QVERIFY(!ok);
+    }
+
+    void DisabledCategoryRecordsNothing(void)
+    {
+        MythTrace::SetCategories(kTraceScheduler);
+        {
+            MYTH_TRACE_SPAN(kTracePlayer, "not recorded");
+        }
+        MYTH_TRACE_COUNTER(kTracePlayer, "not recorded counter", 1);
+        QVERIFY(!MythTrace::ToJSON().contains("not recorded"));
+    }
+
+    void EnabledSpanIsWritten(void)
+    {
+        MythTrace::SetCategories(kTraceServer);
+        {
+            MYTH_TRACE_SPAN_DETAIL(kTraceServer, "test span",
+                                   QString("say \"hi\""));
+        }
+        QByteArray json = MythTrace::ToJSON();
+        QVERIFY(json.contains("\"name\":\"test span\""));
+        QVERIFY(json.contains("\"cat\":\"server\""));
+        QVERIFY(json.contains("\"ph\":\"X\""));
+        QVERIFY(json.contains("say \\\"hi\\\""));
+    }
+
+    void SpanDetailIsOneStatement(void)
+    {
+        MythTrace::SetCategories(kTraceServer);
+        bool inIf = true;
+        if (inIf)
+            MYTH_TRACE_SPAN_DETAIL(kTraceServer, "if span", QString("inside"));
+        else
+            MYTH_TRACE_INSTANT(kTraceServer, "else branch", QString());
+
+        QByteArray json = MythTrace::ToJSON();
+        QVERIFY(json.contains("\"name\":\"if span\""));
+        QVERIFY(json.contains("inside"));
+        QVERIFY(!json.contains("else branch"));
+    }
+
+    void DisabledDetailIsNotBuilt(void)
+    {
+        int calls = 0;
+        MythTrace::SetCategories(kTraceRecorder);
+        {
+            MYTH_TRACE_SPAN_DETAIL(kTraceServer, "off", CountedDetail(&calls));
+        }
+        QCOMPARE(calls, 0);
+        {
+            MYTH_TRACE_SPAN_DETAIL(kTraceRecorder, "on", CountedDetail(&calls));
+        }
+        QCOMPARE(calls, 1);
+    }
+
+    void ExitedThreadIsFreedOnceWritten(void)
+    {
+        MythTrace::SetCategories(kTraceUI);
+
+        TraceThread thread;
+        thread.start();
+        QVERIFY(thread.wait(10000));
+
+        // kept after the thread exits, until it has been written out
+        QVERIFY(MythTrace::ToJSON().contains("from exited thread"));
+
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        QVERIFY(MythTrace::Write(file.fileName()));
+        QVERIFY(file.readAll().contains("from exited thread"));
+
+        QVERIFY(!MythTrace::ToJSON().contains("from exited thread"));
+    }
+
+    void CountersAndAsyncEventsAreWritten(void)
+    {
+        MythTrace::SetCategories(kTraceAll);
+        uint64_t id = MythTrace::NewFlowId();
+        MYTH_TRACE_ASYNC_BEGIN(kTraceScheduler, "flow", id);
+        MYTH_TRACE_COUNTER(kTraceStream, "bytes", 1234);
+        MYTH_TRACE_ASYNC_END(kTraceScheduler, "flow", id);
+
+        QByteArray json = MythTrace::ToJSON();
+        QVERIFY(json.contains("\"args\":{\"value\":1234}"));
+        QVERIFY(json.contains("\"ph\":\"b\""));
+        QVERIFY(json.contains("\"ph\":\"e\""));
+        QVERIFY(json.contains(QByteArray::number((qulonglong)id, 16)));
+    }
+
+    void ClearDiscardsEvents(void)
+    {
+        MythTrace::SetCategories(kTraceAll);
+        MYTH_TRACE_INSTANT(kTraceUI, "cleared", QString());
+        MythTrace::Clear();
+        QVERIFY(!MythTrace::ToJSON().contains("cleared"));
+    }
+
+    void HandlesControlMessages(void)
+    {
+        QVERIFY(MythTrace::HandleMessage("TRACE scheduler,stream"));
+        QCOMPARE(MythTrace::GetCategories(),
+                 (int)(kTraceScheduler | kTraceStream));
+        QVERIFY(MythTrace::HandleMessage("TRACE none"));
+        QCOMPARE(MythTrace::GetCategories(), (int)kTraceNone);
+        QVERIFY(!MythTrace::HandleMessage("CLEAR_SETTINGS_CACHE"));
+    }
+
+    void DisabledSpanCost(void)
+    {
+        QBENCHMARK
+        {
+            MYTH_TRACE_SPAN(kTracePlayer, "benchmark");
+        }
+    }
+};
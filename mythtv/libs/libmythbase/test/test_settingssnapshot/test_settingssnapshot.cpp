@@ -0,0 +1,3 @@
+#include "test_settingssnapshot.h"
+
+QTEST_APPLESS_MAIN(TestSettingsSnapshot)
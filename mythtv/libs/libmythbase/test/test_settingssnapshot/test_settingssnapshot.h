@@ -0,0 +1,147 @@
+/*
+ *  Class TestSettingsSnapshot
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "mythdbsnapshot.h"
+
+/**
+ *  Hands out a snapshot with "Theme" set to "Old", and can clear or save
+ *  settings part way through the load, as another thread might.
+ */
+class FakeSnapshotCache : public SettingsSnapshotCache
+{
+  public:
+    FakeSnapshotCache() : m_loads(0), m_dropWhileLoading(false) {}
+
+    QStringList m_saveWhileLoading;
+    int         m_loads;
+    bool        m_dropWhileLoading;
+
+  protected:
+    SnapshotPtr LoadSnapshot(void)
+    {
+        m_loads++;
+
+        SettingsSnapshot *snap = new SettingsSnapshot();
+        snap->keys["theme"] = 0;
+        snap->keys["Theme"] = 0;
+        snap->global.append("Old");
+        snap->keys["volume"] = 1;
+        snap->global.append("50");
+
+        // the settings table has been read, now another thread saves
+        foreach (const QString &key, m_saveWhileLoading)
+            MarkStale(key);
+        m_saveWhileLoading.clear();
+        if (m_dropWhileLoading)
+        {
+            DropSnapshot();
+            m_dropWhileLoading = false;
+        }
+
+        return SnapshotPtr(snap);
+    }
+};
+
+class TestSettingsSnapshot: public QObject
+{
+    Q_OBJECT
+
+  private:
+    static bool Lookup(const SnapshotPtr &snap, const QString &key,
+                       QString &value)
+    {
+        return snap->Lookup(key, snap->localHost, "default", true, value);
+    }
+
+  private slots:
+    void SnapshotAnswers(void)
+    {
+        FakeSnapshotCache cache;
+        SnapshotPtr snap = cache.GetSnapshot();
+        QVERIFY(snap);
+
+        QString value;
+        QVERIFY(Lookup(snap, "Theme", value));
+        QCOMPARE(value, QString("Old"));
+        QVERIFY(Lookup(snap, "Missing", value));
+        QCOMPARE(value, QString("default"));
+
+        // the same snapshot is handed out until something changes
+        QCOMPARE(cache.GetSnapshot(), snap);
+        QCOMPARE(cache.m_loads, 1);
+    }
+
+    void SaveAfterLoadIsNotAnswered(void)
+    {
+        FakeSnapshotCache cache;
+        QVERIFY(cache.GetSnapshot());
+
+        cache.MarkStale("theme");
+
+        SnapshotPtr snap = cache.GetSnapshot();
+        QString value;
+        QVERIFY(!Lookup(snap, "Theme", value));
+        QVERIFY(Lookup(snap, "volume", value));
+        QCOMPARE(value, QString("50"));
+        QCOMPARE(cache.m_loads, 1);
+    }
+
+    /// A setting saved after the load read it, but before the snapshot
+    /// was published, must not be answered with the value read
+    void SaveDuringLoadIsNotAnswered(void)
+    {
+        FakeSnapshotCache cache;
+        cache.m_saveWhileLoading << "theme";
+
+        SnapshotPtr snap = cache.GetSnapshot();
+        QVERIFY(snap);
+        QString value;
+        QVERIFY(!Lookup(snap, "Theme", value));
+        QVERIFY(Lookup(snap, "volume", value));
+
+        // and it stays stale for later lookups
+        QCOMPARE(cache.GetSnapshot(), snap);
+        QVERIFY(!Lookup(cache.GetSnapshot(), "theme", value));
+        QCOMPARE(cache.m_loads, 1);
+    }
+
+    void SaveBeforeLoadIsForgotten(void)
+    {
+        FakeSnapshotCache cache;
+        cache.MarkStale("theme");
+
+        SnapshotPtr snap = cache.GetSnapshot();
+        QString value;
+        QVERIFY(Lookup(snap, "theme", value));
+        QCOMPARE(value, QString("Old"));
+    }
+
+    void DropDuringLoadDiscardsIt(void)
+    {
+        FakeSnapshotCache cache;
+        cache.m_dropWhileLoading = true;
+
+        QVERIFY(!cache.GetSnapshot());
+        QCOMPARE(cache.m_loads, 1);
+
+        QVERIFY(cache.GetSnapshot());
+        QCOMPARE(cache.m_loads, 2);
+    }
+};
@@ -22,6 +22,8 @@
 #include "mythtimer.h"
 #include "compat.h"
 #include "mythdate.h"
+#include "mythtrace.h"
+#include "mythmetrics.h"
 
 #define LOC QString("TFW(%1:%2): ").arg(filename).arg(fd)
 
@@ -41,6 +43,30 @@ void TFWSyncThread::run(void)
     RunEpilog();
 }
 
+static MythGauge *buffered_bytes(void)
+{
+    static MythGauge *gauge = MythMetrics::Gauge(
+        "mythtv_filewriter_buffered_bytes",
+        "Bytes waiting in file writer buffers to be written to disk");
+    return gauge;
+}
+
+static MythCounter *written_bytes(void)
+{
+    static MythCounter *counter = MythMetrics::Counter(
+        "mythtv_filewriter_written_bytes_total",
+        "Bytes written to disk by file writers");
+    return counter;
+}
+
+static MythCounter *buffer_full(void)
+{
+    static MythCounter *counter = MythMetrics::Counter(
+        "mythtv_filewriter_buffer_full_total",
+        "Times a write found the file writer buffer full");
+    return counter;
+}
+
 const uint ThreadedFileWriter::kMaxBufferSize   = 8 * 1024 * 1024;
 const uint ThreadedFileWriter::kMinWriteSize    = 64 * 1024;
 const uint ThreadedFileWriter::kMaxBlockSize    = 1 * 1024 * 1024;
@@ -174,6 +200,8 @@ ThreadedFileWriter::~ThreadedFileWriter()
         writeThread = NULL;
     }
 
+    buffered_bytes()->Add(-(int64_t)totalBufferUse);
+
     while (!writeBuffers.empty())
     {
         delete writeBuffers.front();
@@ -228,6 +256,7 @@ uint ThreadedFileWriter::Write(const void *data, uint count)
 
         if ((totalBufferUse + towrite) > (kMaxBufferSize * (m_blocking ? 1 : 8)))
         {
+            buffer_full()->Add();
             if (!m_blocking)
             {
                 LOG(VB_GENERAL, LOG_ERR, LOC +
@@ -249,6 +278,7 @@ uint ThreadedFileWriter::Write(const void *data, uint count)
                 m_warned = true;
             }
             // wait until some was written to disk, and try again
+            MYTH_TRACE_SPAN_DETAIL(kTraceRecorder, "write blocked", filename);
             if (!bufferWasFreed.wait(locker.mutex(), 1000))
             {
                 LOG(VB_GENERAL, LOG_DEBUG, LOC +
@@ -283,6 +313,7 @@ uint ThreadedFileWriter::Write(const void *data, uint count)
         }
 
         totalBufferUse += towrite;
+        buffered_bytes()->Add(towrite);
 
         const char *cdata = (const char*) data + written;
         buf->data.insert(buf->data.end(), cdata, cdata+towrite);
@@ -491,9 +522,14 @@ void ThreadedFileWriter::DiskLoop(void)
         TFWBuffer *buf = writeBuffers.front();
         writeBuffers.pop_front();
         totalBufferUse -= buf->data.size();
+        buffered_bytes()->Add(-(int64_t)buf->data.size());
         bufferWasFreed.wakeAll();
         minWriteTimer.start();
 
+        MYTH_TRACE_SPAN_DETAIL(kTraceRecorder, "disk write", filename);
+        MYTH_TRACE_COUNTER(kTraceRecorder, "write buffer bytes",
+                           totalBufferUse);
+
         //////////////////////////////////////////
 
         const void *data = &(buf->data[0]);
@@ -540,6 +576,7 @@ void ThreadedFileWriter::DiskLoop(void)
             {
                 tot += ret;
                 total_written += ret;
+                written_bytes()->Add(ret);
                 LOG(VB_FILE, LOG_DEBUG, LOC +
                     QString("total written so far: %1 bytes")
                     .arg(total_written));
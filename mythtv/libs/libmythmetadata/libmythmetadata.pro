@@ -26,7 +26,7 @@ HEADERS += musicmetadata.h musicutils.h metaio.h metaiotaglib.h
 HEADERS += metaioflacvorbis.h metaioavfcomment.h metaiomp4.h
 HEADERS += metaiowavpack.h metaioid3.h metaiooggvorbis.h
 HEADERS += imagetypes.h imagemetadata.h imagethumbs.h imagescanner.h imagemanager.h
-HEADERS += musicfilescanner.h metadatagrabber.h lyricsdata.h
+HEADERS += musicfilescanner.h metadatagrabber.h metadatagrabberpool.h lyricsdata.h
 
 SOURCES += cleanup.cpp  dbaccess.cpp  dirscan.cpp  globals.cpp
 SOURCES += parentalcontrols.cpp  videoscan.cpp  videoutils.cpp
@@ -38,7 +38,8 @@ SOURCES += musicmetadata.cpp musicutils.cpp metaio.cpp metaiotaglib.cpp
 SOURCES += metaioflacvorbis.cpp metaioavfcomment.cpp metaiomp4.cpp
 SOURCES += metaiowavpack.cpp metaioid3.cpp metaiooggvorbis.cpp
 SOURCES += imagemetadata.cpp imagethumbs.cpp imagescanner.cpp imagemanager.cpp
-SOURCES += musicfilescanner.cpp metadatagrabber.cpp lyricsdata.cpp
+SOURCES += musicfilescanner.cpp metadatagrabber.cpp metadatagrabberpool.cpp
+SOURCES += lyricsdata.cpp
 
 INCLUDEPATH += ../libmythbase ../libmythtv
 INCLUDEPATH += ../.. ../ ./ ../libmythui
@@ -93,7 +94,8 @@ inc.files += metaio.h metaiotaglib.h
 inc.files += metaioflacvorbis.h metaioavfcomment.h metaiomp4.h
 inc.files += metaiowavpack.h metaioid3.h metaiooggvorbis.h
 inc.files += imagetypes.h imagemetadata.h imagemanager.h
-inc.files += musicfilescanner.h metadatagrabber.h lyricsdata.h
+inc.files += musicfilescanner.h metadatagrabber.h metadatagrabberpool.h
+inc.files += lyricsdata.h
 
 INSTALLS += inc
 
@@ -1,5 +1,6 @@
 // qt
 #include <QCoreApplication>
+#include <QRunnable>
 #include <QEvent>
 #include <QDir>
 #include <QUrl>
@@ -22,10 +23,31 @@ QEvent::Type MetadataLookupEvent::kEventType =
 QEvent::Type MetadataLookupFailure::kEventType =
     (QEvent::Type) QEvent::registerEventType();
 
+class MetadataLookupRunnable : public QRunnable
+{
+  public:
+    MetadataLookupRunnable(MetadataDownload *parent,
+                           const RefCountHandler<MetadataLookup> &lookup) :
+        m_parent(parent), m_lookup(lookup) {}
+
+    void run(void)
+    {
+        m_parent->handleLookup(m_lookup);
+        m_parent->lookupFinished();
+    }
+
+  private:
+    MetadataDownload               *m_parent;
+    RefCountHandler<MetadataLookup> m_lookup;
+};
+
 MetadataDownload::MetadataDownload(QObject *parent) :
-    MThread("MetadataDownload")
+    MThread("MetadataDownload"), m_pool("MetadataLookup"), m_running(0)
 {
     m_parent = parent;
+    // Each lookup mostly waits on a grabber, so run several at once
+    m_pool.setMaxThreadCount(
+        qMax(1, gCoreContext->GetNumSetting("MetadataGrabberWorkers", 4)));
 }
 
 MetadataDownload::~MetadataDownload()
@@ -45,6 +67,7 @@ void MetadataDownload::addLookup(MetadataLookup *lookup)
 
     m_lookupList.append(lookup);
     lookup->DecrRef();
+    m_wait.wakeAll();
     if (!isRunning())
         start();
 }
@@ -60,6 +83,7 @@ void MetadataDownload::prependLookup(MetadataLookup *lookup)
 
     m_lookupList.prepend(lookup);
     lookup->DecrRef();
+    m_wait.wakeAll();
     if (!isRunning())
         start();
 }
@@ -76,127 +100,160 @@ void MetadataDownload::run()
 {
     RunProlog();
 
+    m_mutex.lock();
     while (true)
     {
-        m_mutex.lock();
-        if (m_lookupList.isEmpty())
+        if (m_lookupList.isEmpty() && m_running == 0)
         {
             // no more to process, we're done
-            m_mutex.unlock();
             break;
         }
-        // Ref owns the MetadataLookup object for the duration of the loop
-        // and it will be deleted automatically when the loop completes
+        if (m_lookupList.isEmpty() || m_running >= m_pool.maxThreadCount())
+        {
+            // a running lookup may queue a follow up lookup when it finishes
+            m_wait.wait(&m_mutex);
+            continue;
+        }
+        // The runnable owns the MetadataLookup object until it is finished
+        // and it will be deleted automatically then
         RefCountHandler<MetadataLookup> ref = m_lookupList.takeFirstAndDecr();
+        m_running++;
         m_mutex.unlock();
-        MetadataLookup *lookup = ref;
-        MetadataLookupList list;
 
-        // Go go gadget Metadata Lookup
-        if (lookup->GetType() == kMetadataVideo ||
-            lookup->GetType() == kMetadataRecording)
+        m_pool.start(new MetadataLookupRunnable(this, ref), "MetadataLookup");
+
+        m_mutex.lock();
+    }
+    m_mutex.unlock();
+
+    RunEpilog();
+}
+
+/// True once cancel() has been called, lookups then report to nobody
+bool MetadataDownload::isCancelled(void)
+{
+    QMutexLocker lock(&m_mutex);
+    return !m_parent;
+}
+
+/// Posts event to our parent, cancel() may clear it from another thread
+void MetadataDownload::postToParent(QEvent *event)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_parent)
+        QCoreApplication::postEvent(m_parent, event);
+    else
+        delete event;
+}
+
+void MetadataDownload::lookupFinished(void)
+{
+    QMutexLocker lock(&m_mutex);
+    m_running--;
+    m_wait.wakeAll();
+}
+
+void MetadataDownload::handleLookup(MetadataLookup *lookup)
+{
+    MetadataLookupList list;
+
+    // Go go gadget Metadata Lookup
+    if (lookup->GetType() == kMetadataVideo ||
+        lookup->GetType() == kMetadataRecording)
+    {
+        if (lookup->GetSubtype() == kProbableTelevision)
+            list = handleTelevision(lookup);
+        else if (lookup->GetSubtype() == kProbableMovie)
+            list = handleMovie(lookup);
+        else
         {
-            if (lookup->GetSubtype() == kProbableTelevision)
-                list = handleTelevision(lookup);
-            else if (lookup->GetSubtype() == kProbableMovie)
-                list = handleMovie(lookup);
-            else
-            {
-                // will try both movie and TV
-                list = handleVideoUndetermined(lookup);
-            }
+            // will try both movie and TV
+            list = handleVideoUndetermined(lookup);
+        }
 
-            if ((list.isEmpty() ||
-                 (list.size() > 1 && !lookup->GetAutomatic())) &&
-                lookup->GetSubtype() == kProbableTelevision)
-            {
-                list.append(handleMovie(lookup));
-            }
-            else if ((list.isEmpty() ||
-                      (list.size() > 1 && !lookup->GetAutomatic())) &&
-                     lookup->GetSubtype() == kProbableMovie)
+        if ((list.isEmpty() ||
+             (list.size() > 1 && !lookup->GetAutomatic())) &&
+            lookup->GetSubtype() == kProbableTelevision)
+        {
+            list.append(handleMovie(lookup));
+        }
+        else if ((list.isEmpty() ||
+                  (list.size() > 1 && !lookup->GetAutomatic())) &&
+                 lookup->GetSubtype() == kProbableMovie)
+        {
+            list.append(handleTelevision(lookup));
+        }
+    }
+    else if (lookup->GetType() == kMetadataGame)
+        list = handleGame(lookup);
+
+    // inform parent we have lookup ready for it
+    if (!list.isEmpty() && !isCancelled())
+    {
+        // If there's only one result, don't bother asking
+        // our parent about it, just add it to the back of
+        // the queue in kLookupData mode.
+        if (list.count() == 1 && list[0]->GetStep() == kLookupSearch)
+        {
+            MetadataLookup *newlookup = list.takeFirst();
+
+            newlookup->SetStep(kLookupData);
+            prependLookup(newlookup);
+            // Type may have changed
+            LookupType ret = GuessLookupType(newlookup);
+            if (ret != kUnknownVideo)
             {
-                list.append(handleTelevision(lookup));
+                newlookup->SetSubtype(ret);
             }
+            return;
         }
-        else if (lookup->GetType() == kMetadataGame)
-            list = handleGame(lookup);
 
-        // inform parent we have lookup ready for it
-        if (m_parent && !list.isEmpty())
+        // If we're in automatic mode, we need to make
+        // these decisions on our own.  Pass to title match.
+        if (list[0]->GetAutomatic() && list.count() > 1
+            && list[0]->GetStep() == kLookupSearch)
         {
-            // If there's only one result, don't bother asking
-            // our parent about it, just add it to the back of
-            // the queue in kLookupData mode.
-            if (list.count() == 1 && list[0]->GetStep() == kLookupSearch)
+            MetadataLookup *bestLookup = findBestMatch(list, lookup->GetTitle());
+            if (bestLookup)
             {
-                MetadataLookup *newlookup = list.takeFirst();
+                MetadataLookup *newlookup = bestLookup;
 
+                // bestlookup is owned by list, we need an extra reference
+                newlookup->IncrRef();
                 newlookup->SetStep(kLookupData);
-                prependLookup(newlookup);
                 // Type may have changed
                 LookupType ret = GuessLookupType(newlookup);
                 if (ret != kUnknownVideo)
                 {
                     newlookup->SetSubtype(ret);
                 }
-                continue;
+                prependLookup(newlookup);
+                return;
             }
 
-            // If we're in automatic mode, we need to make
-            // these decisions on our own.  Pass to title match.
-            if (list[0]->GetAutomatic() && list.count() > 1
-                && list[0]->GetStep() == kLookupSearch)
-            {
-                MetadataLookup *bestLookup = findBestMatch(list, lookup->GetTitle());
-                if (bestLookup)
-                {
-                    MetadataLookup *newlookup = bestLookup;
-
-                    // bestlookup is owned by list, we need an extra reference
-                    newlookup->IncrRef();
-                    newlookup->SetStep(kLookupData);
-                    // Type may have changed
-                    LookupType ret = GuessLookupType(newlookup);
-                    if (ret != kUnknownVideo)
-                    {
-                        newlookup->SetSubtype(ret);
-                    }
-                    prependLookup(newlookup);
-                    continue;
-                }
-
-                QCoreApplication::postEvent(m_parent,
-                    new MetadataLookupFailure(MetadataLookupList() << lookup));
-            }
+            postToParent(
+                new MetadataLookupFailure(MetadataLookupList() << lookup));
+        }
 
+        LOG(VB_GENERAL, LOG_INFO,
+            QString("Returning Metadata Results: %1 %2 %3")
+                .arg(lookup->GetTitle()).arg(lookup->GetSeason())
+                .arg(lookup->GetEpisode()));
+        postToParent(new MetadataLookupEvent(list));
+    }
+    else
+    {
+        if (list.isEmpty())
+        {
             LOG(VB_GENERAL, LOG_INFO,
-                QString("Returning Metadata Results: %1 %2 %3")
+                QString("Metadata Lookup Failed: No Results %1 %2 %3")
                     .arg(lookup->GetTitle()).arg(lookup->GetSeason())
                     .arg(lookup->GetEpisode()));
-            QCoreApplication::postEvent(m_parent,
-                new MetadataLookupEvent(list));
-        }
-        else
-        {
-            if (list.isEmpty())
-            {
-                LOG(VB_GENERAL, LOG_INFO,
-                    QString("Metadata Lookup Failed: No Results %1 %2 %3")
-                        .arg(lookup->GetTitle()).arg(lookup->GetSeason())
-                        .arg(lookup->GetEpisode()));
-            }
-            if (m_parent)
-            {
-                // list is always empty here
-                list.append(lookup);
-                QCoreApplication::postEvent(m_parent,
-                    new MetadataLookupFailure(list));
-            }
         }
+        // list is always empty here, unless we were cancelled
+        list.append(lookup);
+        postToParent(new MetadataLookupFailure(list));
     }
-
-    RunEpilog();
 }
 
 MetadataLookup* MetadataDownload::findBestMatch(MetadataLookupList list,
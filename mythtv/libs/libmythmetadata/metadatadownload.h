@@ -3,9 +3,11 @@
 
 #include <QStringList>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QEvent>
 
 #include "metadatacommon.h"
+#include "mthreadpool.h"
 #include "mthread.h"
 
 class META_PUBLIC MetadataLookupEvent : public QEvent
@@ -32,8 +34,16 @@ class META_PUBLIC MetadataLookupFailure : public QEvent
     static Type kEventType;
 };
 
+/**
+ *  \class MetadataDownload
+ *
+ *  \brief Runs queued lookups, up to MetadataGrabberWorkers (default 4)
+ *         of them at once.
+ */
 class META_PUBLIC MetadataDownload : public MThread
 {
+    friend class MetadataLookupRunnable;
+
   public:
 
     explicit MetadataDownload(QObject *parent);
@@ -59,6 +69,11 @@ class META_PUBLIC MetadataDownload : public MThread
     QString getNFOPath(QString filename);
 
   private:
+    void                handleLookup(MetadataLookup *lookup);
+    void                lookupFinished(void);
+    bool                isCancelled(void);
+    void                postToParent(QEvent *event);
+
     // Video handling
     MetadataLookupList  handleMovie(MetadataLookup* lookup);
     MetadataLookupList  handleTelevision(MetadataLookup* lookup);
@@ -77,9 +92,12 @@ class META_PUBLIC MetadataDownload : public MThread
                                  bool passseas = true);
     MetadataLookupList  readNFO(QString NFOpath, MetadataLookup* lookup);
 
-    QObject            *m_parent;
+    QObject            *m_parent; ///< protected by m_mutex
     MetadataLookupList  m_lookupList;
     QMutex              m_mutex;
+    QWaitCondition      m_wait;
+    MThreadPool         m_pool;
+    int                 m_running; ///< lookups started and not yet finished
 
 };
 
@@ -9,6 +9,7 @@
 // MythTV headers
 #include "metadatagrabber.h"
 #include "metadatacommon.h"
+#include "metadatagrabberpool.h"
 #include "mythsystemlegacy.h"
 #include "exitcodes.h"
 #include "mythdate.h"
@@ -311,27 +312,27 @@ QString MetaGrabberScript::CleanedInetref(const QString &inetref)
 MetaGrabberScript::MetaGrabberScript(void) :
     m_name(""), m_author(""), m_thumbnail(""), m_fullcommand(""), m_command(""),
     m_type(kGrabberInvalid), m_typestring(""), m_description(""), m_accepts(),
-    m_version(0.0), m_valid(false)
+    m_version(0.0), m_worker(false), m_valid(false)
 {
 }
 
 MetaGrabberScript::MetaGrabberScript(const QString &path,
                                      const QDomElement &dom) :
-    m_valid(false)
+    m_worker(false), m_valid(false)
 {
     m_fullcommand = path;
     ParseGrabberVersion(dom);
 }
 
 MetaGrabberScript::MetaGrabberScript(const QDomElement &dom) :
-    m_valid(false)
+    m_worker(false), m_valid(false)
 {
     ParseGrabberVersion(dom);
     
 }
 
 MetaGrabberScript::MetaGrabberScript(const QString &path) :
-    m_type(kGrabberInvalid), m_version(0.0), m_valid(false)
+    m_type(kGrabberInvalid), m_version(0.0), m_worker(false), m_valid(false)
 {
     if (path.isEmpty())
         return;
@@ -372,7 +373,7 @@ MetaGrabberScript::MetaGrabberScript(const MetaGrabberScript &other) :
     m_command(other.m_command), m_type(other.m_type),
     m_typestring(other.m_typestring), m_description(other.m_description),
     m_accepts(other.m_accepts), m_version(other.m_version),
-    m_valid(other.m_valid)
+    m_worker(other.m_worker), m_valid(other.m_valid)
 {
 }
 
@@ -390,6 +391,7 @@ MetaGrabberScript& MetaGrabberScript::operator=(const MetaGrabberScript &other)
         m_description = other.m_description;
         m_accepts = other.m_accepts;
         m_version = other.m_version;
+        m_worker = other.m_worker;
         m_valid = other.m_valid;
     }
 
@@ -406,6 +408,8 @@ void MetaGrabberScript::ParseGrabberVersion(const QDomElement &item)
     m_description   = item.firstChildElement("description").text();
     m_version       = item.firstChildElement("version").text().toFloat();
     m_typestring    = item.firstChildElement("type").text().toLower();
+    m_worker        = item.firstChildElement("worker").text().toLower()
+                          == "true";
 
     if (!m_typestring.isEmpty() && grabberTypeStrings.contains(m_typestring))
         m_type = grabberTypeStrings[m_typestring];
@@ -446,17 +450,16 @@ bool MetaGrabberScript::Test(void)
 MetadataLookupList MetaGrabberScript::RunGrabber(const QStringList &args,
                         MetadataLookup *lookup, bool passseas)
 {
-    MythSystemLegacy grabber(m_fullcommand, args, kMSStdOut);
     MetadataLookupList list;
 
     LOG(VB_GENERAL, LOG_INFO, QString("Running Grabber: %1 %2")
         .arg(m_fullcommand).arg(args.join(" ")));
 
-    grabber.Run();
-    if (grabber.Wait() != GENERIC_EXIT_OK)
+    QByteArray result;
+    if (MetaGrabberPool::Run(m_fullcommand, args, m_worker, result) !=
+        GENERIC_EXIT_OK)
         return list;
 
-    QByteArray result = grabber.ReadAll();
     if (!result.isEmpty())
     {
         QDomDocument doc;
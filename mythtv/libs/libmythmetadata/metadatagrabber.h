@@ -66,6 +66,8 @@ class META_PUBLIC MetaGrabberScript : public QObject
     QString       GetDescription(void) const  { return m_description; }
 
     bool Accepts(const QString &tag) const { return m_accepts.contains(tag); }
+    /// True if the grabber can be kept running to answer several lookups
+    bool          SupportsWorker(void) const  { return m_worker; }
 
     void          toMap(InfoMap &metadataMap) const;
 
@@ -88,6 +90,7 @@ class META_PUBLIC MetaGrabberScript : public QObject
     QString m_description;
     QStringList m_accepts;
     float m_version;
+    bool m_worker;
     bool m_valid;
 
     void ParseGrabberVersion(const QDomElement &item);
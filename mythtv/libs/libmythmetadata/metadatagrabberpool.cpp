@@ -0,0 +1,463 @@
+// Qt headers
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QProcess>
+#include <QSaveFile>
+#include <QWaitCondition>
+
+// MythTV headers
+#include "metadatagrabberpool.h"
+#include "mythsystemlegacy.h"
+#include "mythcorecontext.h"
+#include "exitcodes.h"
+#include "mythdate.h"
+#include "mythdirs.h"
+#include "mythlogging.h"
+#include "mthread.h"
+
+#define LOC QString("Metadata Grabber Pool: ")
+
+/// How long, in ms, a worker may take to start, or to answer one request
+static const int kWorkerStartTimeout   = 10000;
+static const int kWorkerRequestTimeout = 300000;
+/// How long, in ms, a worker waits for a request before exiting
+static const int kWorkerIdleTimeout    = 60000;
+/// Consecutive worker failures before a grabber is run once per lookup
+static const int kWorkerMaxFailures    = 3;
+/// How often, in seconds, Put() clears expired entries from the cache
+static const int kCachePruneInterval   = 60 * 60;
+
+namespace
+{
+    class GrabberRequest
+    {
+      public:
+        explicit GrabberRequest(const QStringList &_args) :
+            args(_args), status(GENERIC_EXIT_NOT_OK),
+            done(false), handled(false) {}
+
+        QStringList args;
+        QByteArray  output;
+        uint        status;
+        bool        done;    ///< answered, or given up on
+        bool        handled; ///< answered by a worker
+    };
+
+    class GrabberWorker;
+
+    /// The workers and pending requests of one grabber
+    class GrabberWorkers
+    {
+      public:
+        GrabberWorkers() :
+            live(0), idle(0), failures(0), unsupported(false) {}
+
+        QList<GrabberRequest*> queue;
+        QList<GrabberWorker*>  workers; ///< including any that have exited
+        int                    live;
+        int                    idle;
+        int                    failures;
+        bool                   unsupported;
+    };
+
+    class GrabberWorker : public MThread
+    {
+      public:
+        GrabberWorker(const QString &command, GrabberWorkers *grabber) :
+            MThread("MetaGrabber"), m_command(command), m_grabber(grabber),
+            m_nextId(1) {}
+
+      protected:
+        virtual void run(void); // MThread
+
+      private:
+        bool Process(QProcess &process, GrabberRequest *request);
+
+        QString         m_command;
+        GrabberWorkers *m_grabber;
+        int             m_nextId;
+    };
+
+    // All of the above is protected by s_lock
+    QMutex                           s_lock;
+    QWaitCondition                   s_requestReady;
+    QWaitCondition                   s_requestDone;
+    QMap<QString, GrabberWorkers*>   s_grabbers;
+    bool                             s_stopping = false;
+
+    QMutex                           s_pruneLock;
+    QDateTime                        s_lastPrune;
+}
+
+void GrabberWorker::run(void)
+{
+    RunProlog();
+
+    QProcess process;
+    process.setStandardErrorFile(QProcess::nullDevice());
+    process.start(m_command, QStringList() << "--worker");
+
+    bool ok = process.waitForStarted(kWorkerStartTimeout);
+    if (!ok)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + QString("Unable to start %1: %2")
+            .arg(m_command).arg(process.errorString()));
+    }
+
+    s_lock.lock();
+    while (ok && !s_stopping)
+    {
+        if (m_grabber->queue.isEmpty())
+        {
+            m_grabber->idle++;
+            bool woken = s_requestReady.wait(&s_lock, kWorkerIdleTimeout);
+            m_grabber->idle--;
+            if (!woken && m_grabber->queue.isEmpty())
+                break;
+            continue;
+        }
+
+        GrabberRequest *request = m_grabber->queue.takeFirst();
+        s_lock.unlock();
+
+        ok = Process(process, request);
+
+        s_lock.lock();
+        request->handled = ok;
+        request->done = true;
+        if (ok)
+            m_grabber->failures = 0;
+        s_requestDone.wakeAll();
+    }
+
+    if (!ok && ++m_grabber->failures >= kWorkerMaxFailures &&
+        !m_grabber->unsupported)
+    {
+        LOG(VB_GENERAL, LOG_WARNING, LOC +
+            QString("Giving up on workers for %1, running it once per lookup")
+                .arg(m_command));
+        m_grabber->unsupported = true;
+    }
+
+    // With nobody left to answer them, queued requests are run the old way
+    if (--m_grabber->live == 0 || m_grabber->unsupported)
+    {
+        while (!m_grabber->queue.isEmpty())
+            m_grabber->queue.takeFirst()->done = true;
+        s_requestDone.wakeAll();
+    }
+    s_lock.unlock();
+
+    // Closing stdin tells the worker to exit
+    process.closeWriteChannel();
+    if (!process.waitForFinished(2000))
+    {
+        process.kill();
+        process.waitForFinished();
+    }
+
+    RunEpilog();
+}
+
+bool GrabberWorker::Process(QProcess &process, GrabberRequest *request)
+{
+    int id = m_nextId++;
+
+    QJsonObject message;
+    message.insert("id", id);
+    message.insert("args", QJsonArray::fromStringList(request->args));
+    process.write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (process.bytesToWrite() > 0)
+    {
+        if (!process.waitForBytesWritten(kWorkerRequestTimeout))
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC + QString("Unable to write to %1: %2")
+                .arg(m_command).arg(process.errorString()));
+            return false;
+        }
+    }
+
+    while (!process.canReadLine())
+    {
+        int left = kWorkerRequestTimeout - timer.elapsed();
+        if (left <= 0 || !process.waitForReadyRead(left))
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC + QString("No answer from %1: %2")
+                .arg(m_command).arg(process.errorString()));
+            return false;
+        }
+    }
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(process.readLine(), &error);
+    QJsonObject reply = doc.object();
+    if (error.error != QJsonParseError::NoError ||
+        reply.value("id").toInt() != id)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + QString("Bad answer from %1: %2")
+            .arg(m_command).arg(error.errorString()));
+        return false;
+    }
+
+    request->status = reply.value("status").toInt(GENERIC_EXIT_NOT_OK);
+    request->output = reply.value("output").toString().toUtf8();
+
+    return true;
+}
+
+QString MetaGrabberCache::GetDirectory(void)
+{
+    return GetConfDir() + "/cache/metadata-grabber/";
+}
+
+QString MetaGrabberCache::Key(const QString &command, const QStringList &args)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(command.toUtf8());
+
+    QStringList::const_iterator it = args.begin();
+    for (; it != args.end(); ++it)
+    {
+        hash.addData("", 1);
+        hash.addData(it->toUtf8());
+    }
+
+    return hash.result().toHex();
+}
+
+bool MetaGrabberCache::Get(const QString &command, const QStringList &args,
+                           QByteArray &result)
+{
+    int ttl = gCoreContext->GetNumSetting("MetadataGrabberCacheTTL", 24);
+    if (ttl <= 0)
+        return false;
+
+    QFileInfo info(GetDirectory() + Key(command, args));
+    if (!info.exists())
+        return false;
+
+    if (info.lastModified().secsTo(MythDate::current()) > ttl * 60 * 60)
+    {
+        QFile::remove(info.filePath());
+        return false;
+    }
+
+    QFile file(info.filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    result = file.readAll();
+    return !result.isEmpty();
+}
+
+void MetaGrabberCache::Put(const QString &command, const QStringList &args,
+                           const QByteArray &result)
+{
+    QDateTime now = MythDate::current();
+    s_pruneLock.lock();
+    bool prune = !s_lastPrune.isValid() ||
+                 s_lastPrune.secsTo(now) >= kCachePruneInterval;
+    if (prune)
+        s_lastPrune = now;
+    s_pruneLock.unlock();
+
+    // Also when the cache is off, to remove what it held before
+    if (prune)
+        Prune();
+
+    if (gCoreContext->GetNumSetting("MetadataGrabberCacheTTL", 24) <= 0)
+        return;
+
+    QDir dir(GetDirectory());
+    if (!dir.exists() && !dir.mkpath("."))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            "Unable to create cache directory " + dir.path());
+        return;
+    }
+
+    // Written aside and renamed, so concurrent lookups never see half of it
+    QSaveFile file(dir.filePath(Key(command, args)));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(result) != result.size() || !file.commit())
+    {
+        LOG(VB_GENERAL, LOG_WARNING, LOC +
+            "Unable to write cache entry " + file.fileName());
+    }
+}
+
+/**
+ *  \brief Removes expired entries, and with them any left behind by a
+ *         lookup that was killed while writing one. With the cache off
+ *         everything is removed.
+ *
+ *  Entries are otherwise only removed when looked up again, so without
+ *  this the cache grows with every title ever looked up.
+ */
+void MetaGrabberCache::Prune(void)
+{
+    int ttl = gCoreContext->GetNumSetting("MetadataGrabberCacheTTL", 24);
+    QDateTime now = MythDate::current();
+
+    QDir dir(GetDirectory());
+    QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::Hidden);
+
+    int removed = 0;
+    QFileInfoList::const_iterator it = entries.begin();
+    for (; it != entries.end(); ++it)
+    {
+        if (ttl > 0 && it->lastModified().secsTo(now) <= ttl * 60 * 60)
+            continue;
+        if (QFile::remove(it->filePath()))
+            removed++;
+    }
+
+    if (removed)
+    {
+        LOG(VB_GENERAL, LOG_DEBUG, LOC +
+            QString("Removed %1 expired cache entries").arg(removed));
+    }
+}
+
+void MetaGrabberCache::Clear(void)
+{
+    QDir dir(GetDirectory());
+    QStringList files = dir.entryList(QDir::Files);
+
+    QStringList::const_iterator it = files.begin();
+    for (; it != files.end(); ++it)
+        dir.remove(*it);
+}
+
+/**
+ *  \brief Runs a grabber and returns its exit status, with what it printed
+ *         in result.
+ *
+ *  Cached output is returned without running anything. If worker is set
+ *  the grabber is run in a worker where possible.
+ */
+uint MetaGrabberPool::Run(const QString &command, const QStringList &args,
+                          bool worker, QByteArray &result)
+{
+    if (MetaGrabberCache::Get(command, args, result))
+    {
+        LOG(VB_GENERAL, LOG_DEBUG, LOC + QString("Using cached %1 %2")
+            .arg(command).arg(args.join(" ")));
+        return GENERIC_EXIT_OK;
+    }
+
+    uint status = GENERIC_EXIT_NOT_OK;
+    if (!worker || !RunInWorker(command, args, result, status))
+    {
+        MythSystemLegacy grabber(command, args, kMSStdOut);
+        grabber.Run();
+        status = grabber.Wait();
+        result = grabber.ReadAll();
+    }
+
+    if (status == GENERIC_EXIT_OK && !result.isEmpty())
+        MetaGrabberCache::Put(command, args, result);
+
+    return status;
+}
+
+/// Returns false if no worker could answer, the grabber must then be run
+/// the old way
+bool MetaGrabberPool::RunInWorker(const QString &command,
+                                  const QStringList &args,
+                                  QByteArray &result, uint &status)
+{
+    int maxWorkers =
+        qMax(1, gCoreContext->GetNumSetting("MetadataGrabberWorkers", 4));
+
+    QMutexLocker locker(&s_lock);
+
+    if (s_stopping)
+        return false;
+
+    GrabberWorkers *grabber = s_grabbers.value(command);
+    if (!grabber)
+    {
+        grabber = new GrabberWorkers();
+        s_grabbers.insert(command, grabber);
+    }
+
+    if (grabber->unsupported)
+        return false;
+
+    // Clean up after workers which exited while idle
+    QList<GrabberWorker*>::iterator it = grabber->workers.begin();
+    while (it != grabber->workers.end())
+    {
+        if ((*it)->isFinished())
+        {
+            (*it)->wait();
+            delete *it;
+            it = grabber->workers.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    GrabberRequest request(args);
+    grabber->queue.append(&request);
+
+    if (grabber->idle < grabber->queue.size() && grabber->live < maxWorkers)
+    {
+        GrabberWorker *worker = new GrabberWorker(command, grabber);
+        grabber->workers.append(worker);
+        grabber->live++;
+        worker->start();
+    }
+    s_requestReady.wakeAll();
+
+    while (!request.done)
+        s_requestDone.wait(&s_lock);
+
+    if (!request.handled)
+        return false;
+
+    result = request.output;
+    status = request.status;
+    return true;
+}
+
+void MetaGrabberPool::Shutdown(void)
+{
+    QList<GrabberWorker*> workers;
+
+    s_lock.lock();
+    s_stopping = true;
+    s_requestReady.wakeAll();
+
+    QMap<QString, GrabberWorkers*>::const_iterator it = s_grabbers.begin();
+    for (; it != s_grabbers.end(); ++it)
+        workers += (*it)->workers;
+    s_lock.unlock();
+
+    QList<GrabberWorker*>::iterator wit = workers.begin();
+    for (; wit != workers.end(); ++wit)
+    {
+        (*wit)->wait();
+        delete *wit;
+    }
+
+    s_lock.lock();
+    qDeleteAll(s_grabbers);
+    s_grabbers.clear();
+    s_stopping = false;
+    s_lock.unlock();
+}
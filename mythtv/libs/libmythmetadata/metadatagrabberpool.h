@@ -0,0 +1,72 @@
+#ifndef METADATAGRABBERPOOL_H_
+#define METADATAGRABBERPOOL_H_
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include "mythmetaexp.h"
+
+/**
+ *  \class MetaGrabberCache
+ *
+ *  \brief On disk cache of grabber output, keyed on the grabber and its
+ *         full argument list, which carries the query and the language.
+ *
+ *  Entries expire after MetadataGrabberCacheTTL hours (default 24),
+ *  a TTL of 0 disables the cache. Only successful runs are cached.
+ *  Expired entries are removed hourly while grabbers are being run.
+ */
+class META_PUBLIC MetaGrabberCache
+{
+  public:
+    static bool Get(const QString &command, const QStringList &args,
+                    QByteArray &result);
+    static void Put(const QString &command, const QStringList &args,
+                    const QByteArray &result);
+    static void Prune(void);
+    static void Clear(void);
+
+    static QString GetDirectory(void);
+
+  private:
+    static QString Key(const QString &command, const QStringList &args);
+};
+
+/**
+ *  \class MetaGrabberPool
+ *
+ *  \brief Runs grabber scripts, keeping those that support it running
+ *         between lookups instead of starting an interpreter for each one.
+ *
+ *  A grabber which lists \<worker\>true\</worker\> in its -v output is
+ *  started with --worker and then reads one request per line on stdin,
+ *
+ *      {"id":1,"args":["-l","en","-a","US","-M","Title"]}
+ *
+ *  answering each with one line on stdout, in the order received,
+ *
+ *      {"id":1,"status":0,"output":"<?xml ... </metadata>"}
+ *
+ *  where args are the command line the grabber would otherwise have been
+ *  run with, status its exit code and output what it would have printed.
+ *
+ *  Up to MetadataGrabberWorkers (default 4) copies of each grabber run at
+ *  once, and exit after a minute without requests. A grabber whose workers
+ *  fail to start or answer is run the old way, once per lookup.
+ */
+class META_PUBLIC MetaGrabberPool
+{
+  public:
+    static uint Run(const QString &command, const QStringList &args,
+                    bool worker, QByteArray &result);
+
+    /// Stops every worker, call before exiting
+    static void Shutdown(void);
+
+  private:
+    static bool RunInWorker(const QString &command, const QStringList &args,
+                            QByteArray &result, uint &status);
+};
+
+#endif // METADATAGRABBERPOOL_H_
@@ -0,0 +1,3 @@
+#include "test_metadatagrabberpool.h"
+
+QTEST_APPLESS_MAIN(TestMetaGrabberPool)
@@ -0,0 +1,198 @@
+/*
+ *  Class TestMetaGrabberPool
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <sys/types.h>
+#include <utime.h>
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+#include "metadatagrabberpool.h"
+#include "mythcorecontext.h"
+#include "exitcodes.h"
+#include "mythdirs.h"
+#include "mythdb.h"
+
+// Stand in for a grabber script. In worker mode it answers each request
+// with its pid, so the test can tell which process answered.
+static const char *kStandInGrabber =
+    "#!/bin/sh\n"
+    "dir=$(dirname \"$0\")\n"
+    "case \"$1\" in\n"
+    "    --worker)\n"
+    "        [ -n \"$NO_WORKER\" ] && exit 1\n"
+    "        echo $$ >> \"$dir/starts\"\n"
+    "        while read -r line; do\n"
+    "            echo \"$line\" >> \"$dir/requests\"\n"
+    "            id=$(echo \"$line\" | sed 's/.*\"id\":\\([0-9]*\\).*/\\1/')\n"
+    "            echo \"{\\\"id\\\":$id,\\\"status\\\":0,"
+                        "\\\"output\\\":\\\"worker $$\\\"}\"\n"
+    "        done\n"
+    "        ;;\n"
+    "    *)\n"
+    "        echo \"$*\" >> \"$dir/requests\"\n"
+    "        echo oneshot\n"
+    "        ;;\n"
+    "esac\n";
+
+class TestMetaGrabberPool: public QObject
+{
+    Q_OBJECT
+
+  private:
+    QTemporaryDir m_dir;
+    QString       m_grabber;
+
+    int Lines(const QString &name)
+    {
+        QFile file(m_dir.path() + '/' + name);
+        if (!file.open(QIODevice::ReadOnly))
+            return 0;
+        return file.readAll().count('\n');
+    }
+
+    static QStringList Args(const QString &title)
+    {
+        return QStringList() << "-l" << "en" << "-a" << "US"
+                             << "-M" << title;
+    }
+
+  private slots:
+    // called at the beginning of these sets of tests
+    void initTestCase(void)
+    {
+        QVERIFY(m_dir.isValid());
+
+        // Keeps the cache out of the real configuration directory
+        qputenv("MYTHCONFDIR", m_dir.path().toLocal8Bit());
+        InitializeMythDirs();
+
+        gCoreContext = new MythCoreContext("bin_version", NULL);
+        gCoreContext->GetDB()->IgnoreDatabase(true);
+
+        m_grabber = m_dir.path() + "/standin.sh";
+        QFile script(m_grabber);
+        QVERIFY(script.open(QIODevice::WriteOnly));
+        script.write(kStandInGrabber);
+        script.close();
+        script.setPermissions(QFile::ReadOwner | QFile::WriteOwner |
+                              QFile::ExeOwner);
+    }
+
+    // called before each test
+    void init(void)
+    {
+        MetaGrabberCache::Clear();
+        QFile::remove(m_dir.path() + "/starts");
+        QFile::remove(m_dir.path() + "/requests");
+        qunsetenv("NO_WORKER");
+    }
+
+    // called after each test
+    void cleanup(void)
+    {
+        MetaGrabberPool::Shutdown();
+    }
+
+    void WorkerIsReused(void)
+    {
+        QByteArray first, second;
+        QCOMPARE(MetaGrabberPool::Run(m_grabber, Args("One"), true, first),
+                 (uint)GENERIC_EXIT_OK);
+        QCOMPARE(MetaGrabberPool::Run(m_grabber, Args("Two"), true, second),
+                 (uint)GENERIC_EXIT_OK);
+
+        QVERIFY(first.startsWith("worker "));
+        QCOMPARE(first, second);
+        QCOMPARE(Lines("starts"), 1);
+        QCOMPARE(Lines("requests"), 2);
+    }
+
+    void ResultIsCached(void)
+    {
+        QByteArray first, second;
+        MetaGrabberPool::Run(m_grabber, Args("Cached"), true, first);
+        MetaGrabberPool::Run(m_grabber, Args("Cached"), true, second);
+
+        QCOMPARE(first, second);
+        QCOMPARE(Lines("requests"), 1);
+
+        // A different language is a different query
+        QStringList args = Args("Cached");
+        args[1] = "de";
+        MetaGrabberPool::Run(m_grabber, args, true, second);
+        QCOMPARE(Lines("requests"), 2);
+    }
+
+    void OneShotWithoutWorker(void)
+    {
+        QByteArray result;
+        QCOMPARE(MetaGrabberPool::Run(m_grabber, Args("Once"), false, result),
+                 (uint)GENERIC_EXIT_OK);
+
+        QCOMPARE(result.trimmed(), QByteArray("oneshot"));
+        QCOMPARE(Lines("starts"), 0);
+    }
+
+    void FallsBackWhenWorkerFails(void)
+    {
+        qputenv("NO_WORKER", "1");
+
+        QByteArray result;
+        QCOMPARE(MetaGrabberPool::Run(m_grabber, Args("Broken"), true, result),
+                 (uint)GENERIC_EXIT_OK);
+
+        QCOMPARE(result.trimmed(), QByteArray("oneshot"));
+        QCOMPARE(Lines("starts"), 0);
+    }
+
+    void PruneRemovesExpired(void)
+    {
+        QByteArray result;
+        MetaGrabberPool::Run(m_grabber, Args("Old"), false, result);
+        MetaGrabberPool::Run(m_grabber, Args("New"), false, result);
+
+        QDir dir(MetaGrabberCache::GetDirectory());
+        QStringList entries = dir.entryList(QDir::Files);
+        QCOMPARE(entries.size(), 2);
+
+        // Age one entry past the default 24 hour TTL
+        struct utimbuf times;
+        times.actime = times.modtime = time(NULL) - 25 * 60 * 60;
+        QCOMPARE(utime(dir.filePath(entries[0]).toLocal8Bit().constData(),
+                       &times), 0);
+
+        MetaGrabberCache::Prune();
+        QCOMPARE(dir.entryList(QDir::Files), QStringList() << entries[1]);
+
+        // With the cache turned off nothing is kept
+        gCoreContext->OverrideSettingForSession("MetadataGrabberCacheTTL", "0");
+        MetaGrabberCache::Prune();
+        gCoreContext->ClearOverrideSettingForSession("MetadataGrabberCacheTTL");
+        QVERIFY(dir.entryList(QDir::Files).isEmpty());
+    }
+
+    // called at the end of these sets of tests
+    void cleanupTestCase(void)
+    {
+        delete gCoreContext;
+        gCoreContext = NULL;
+    }
+};
@@ -44,7 +44,7 @@
 class SERVICE_PUBLIC MythServices : public Service  //, public QScriptable ???
 {
     Q_OBJECT
-    Q_CLASSINFO( "version"    , "5.0" );
+    Q_CLASSINFO( "version"    , "5.1" );
     Q_CLASSINFO( "AddStorageGroupDir_Method",    "POST" )
     Q_CLASSINFO( "RemoveStorageGroupDir_Method", "POST" )
     Q_CLASSINFO( "PutSetting_Method",            "POST" )
@@ -56,6 +56,8 @@ class SERVICE_PUBLIC MythServices : public Service  //, public QScriptable ???
     Q_CLASSINFO( "CheckDatabase_Method",         "POST" )
     Q_CLASSINFO( "ProfileSubmit_Method",         "POST" )
     Q_CLASSINFO( "ProfileDelete_Method",         "POST" )
+    Q_CLASSINFO( "SetTrace_Method",              "POST" )
+    Q_CLASSINFO( "DumpTrace_Method",             "POST" )
 
     public:
 
@@ -173,6 +175,10 @@ class SERVICE_PUBLIC MythServices : public Service  //, public QScriptable ???
         virtual QString             ProfileText         ( void ) = 0;
 
         virtual DTC::BackendInfo*   GetBackendInfo      ( void ) = 0;
+
+        virtual bool                SetTrace            ( const QString &Categories ) = 0;
+
+        virtual bool                DumpTrace           ( const QString &Directory ) = 0;
 };
 
 #endif
@@ -20,6 +20,7 @@ using namespace std;
 #include "programinfo.h" // for subtitle types and audio and video properties
 #include "scheduledrecording.h" // for ScheduledRecording
 #include "compat.h" // for gmtime_r on windows.
+#include "mythmetrics.h"
 
 const uint EITHelper::kChunkSize = 20;
 EITCache *EITHelper::eitcache = new EITCache();
@@ -34,6 +35,22 @@ static void init_fixup(FixupMap &fix);
 
 #define LOC QString("EITHelper: ")
 
+static MythGauge *queued_events(void)
+{
+    static MythGauge *gauge = MythMetrics::Gauge(
+        "mythtv_eit_queued_events",
+        "EIT events waiting to be written to the database");
+    return gauge;
+}
+
+static MythCounter *inserted_events(void)
+{
+    static MythCounter *counter = MythMetrics::Counter(
+        "mythtv_eit_inserted_events_total",
+        "EIT events written to the database");
+    return counter;
+}
+
 EITHelper::EITHelper() :
     eitfixup(new EITFixUp()),
     gps_offset(-1 * GPS_LEAP_SECONDS),
@@ -46,6 +63,7 @@ EITHelper::EITHelper() :
 EITHelper::~EITHelper()
 {
     QMutexLocker locker(&eitList_lock);
+    queued_events()->Add(-(int64_t)db_events.size());
     while (db_events.size())
         delete db_events.dequeue();
 
@@ -75,6 +93,7 @@ uint EITHelper::ProcessEvents(void)
     for (uint i = 0; (i < kChunkSize) && (db_events.size() > 0); i++)
     {
         DBEventEIT *event = db_events.dequeue();
+        queued_events()->Add(-1);
         eitList_lock.unlock();
 
         eitfixup->Fix(*event);
@@ -89,6 +108,8 @@ uint EITHelper::ProcessEvents(void)
     if (!insertCount)
         return 0;
 
+    inserted_events()->Add(insertCount);
+
     if (incomplete_events.size() || unmatched_etts.size())
     {
         LOG(VB_EIT, LOG_INFO,
@@ -696,6 +717,7 @@ void EITHelper::AddEIT(const DVBEventInformationTable *eit)
         event->items = items;
 
         db_events.enqueue(event);
+        queued_events()->Add(1);
     }
 }
 
@@ -807,6 +829,7 @@ void EITHelper::AddEIT(const PremiereContentInformationTable *cit)
             event->items = items;
 
             db_events.enqueue(event);
+            queued_events()->Add(1);
         }
     }
 }
@@ -858,6 +881,7 @@ void EITHelper::CompleteEvent(uint atsc_major, uint atsc_minor,
                                      starttime, endtime,
                                      fixup.value(atsc_key), subtitle_type,
                                      audio_properties, video_properties));
+    queued_events()->Add(1);
 }
 
 uint EITHelper::GetChanID(uint atsc_major, uint atsc_minor)
@@ -0,0 +1,444 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+#include <QStringList>
+#include <QThread>
+#include <QFile>
+#include <QDir>
+
+#include "jobadmission.h"
+#include "jobqueue.h"
+#include "programtypes.h"
+#include "mythcorecontext.h"
+#include "mythdate.h"
+#include "mythdb.h"
+#include "mythlogging.h"
+#include "compat.h"
+
+#define LOC     QString("JobAdmission: ")
+
+/// Measurements are reused if they are more recent than this (ms)
+static const int kMinMeasureInterval = 2000;
+
+JobAdmission::JobAdmission(const QString &hostname) :
+    m_hostname(hostname), m_cpuBusy(0), m_cpuTotal(0),
+    m_devicesFound(false)
+{
+    LoadSettings();
+}
+
+/**
+ * \brief Reads the limits, and looks for changes to the recording
+ *        directories and the cgroup settings.
+ *
+ * Called on every pass of the queue, so changed settings take effect
+ * without restarting the backend.
+ */
+void JobAdmission::LoadSettings(void)
+{
+    m_limits.maxCPU =
+        gCoreContext->GetNumSetting("JobQueueMaxCPUUsage", 90);
+    m_limits.maxWriteLatency =
+        gCoreContext->GetNumSetting("JobQueueMaxWriteLatency", 100);
+    m_limits.maxWhileRecording =
+        gCoreContext->GetNumSetting("JobQueueMaxJobsWhileRecording", 1);
+    m_limits.maxOfClass[kTranscodeJobs] =
+        gCoreContext->GetNumSetting("JobQueueMaxTranscodeJobs", 0);
+    m_limits.maxOfClass[kCommFlagJobs] =
+        gCoreContext->GetNumSetting("JobQueueMaxCommFlagJobs", 0);
+    m_limits.maxOfClass[kMetadataJobs] =
+        gCoreContext->GetNumSetting("JobQueueMaxMetadataJobs", 0);
+    m_limits.maxOfClass[kUserJobs] =
+        gCoreContext->GetNumSetting("JobQueueMaxUserJobs", 0);
+
+    FindRecordingDevices();
+
+    QString cgroupSettings = QString("%1 %2 %3")
+        .arg(gCoreContext->GetSetting("JobQueueCGroup", ""))
+        .arg(gCoreContext->GetNumSetting("JobQueueCGroupCPUWeight", 20))
+        .arg(gCoreContext->GetNumSetting("JobQueueCGroupIOWeight", 20));
+    if (cgroupSettings != m_cgroupSettings)
+    {
+        m_cgroupSettings = cgroupSettings;
+        SetupCGroup();
+    }
+}
+
+JobAdmission::JobClass JobAdmission::ClassOf(int jobType)
+{
+    if (jobType & JOB_USERJOB)
+        return kUserJobs;
+    if (jobType == JOB_TRANSCODE)
+        return kTranscodeJobs;
+    if (jobType == JOB_METADATA)
+        return kMetadataJobs;
+    return kCommFlagJobs;
+}
+
+/// Takes new measurements, unless the last ones are still fresh
+void JobAdmission::Measure(void)
+{
+    if (m_measured.isValid() && m_measured.elapsed() < kMinMeasureInterval)
+        return;
+    m_measured.start();
+
+    m_load.cpu = MeasureCPU();
+    m_load.writeLatency = MeasureWriteLatency();
+    m_load.recordings = CountRecordings();
+}
+
+/**
+ * \brief Returns why a job of \p jobType should wait, or an empty string
+ *        if it can start now.
+ *
+ * \p running is the number of jobs running on this host,
+ * \p runningOfClass the number running of each JobClass.
+ */
+QString JobAdmission::Defer(int jobType, int running,
+                            const int *runningOfClass) const
+{
+    return Defer(m_limits, m_load, jobType, running, runningOfClass);
+}
+
+QString JobAdmission::Defer(const Limits &limits, const Load &load,
+                            int jobType, int running,
+                            const int *runningOfClass)
+{
+    JobClass jobClass = ClassOf(jobType);
+    int maxOfClass = limits.maxOfClass[jobClass];
+    if (maxOfClass > 0 && runningOfClass[jobClass] >= maxOfClass)
+    {
+        return QString("%1 '%2' job(s) already running")
+            .arg(runningOfClass[jobClass]).arg(JobQueue::JobText(jobType));
+    }
+
+    if (load.recordings > 0 && running >= limits.maxWhileRecording)
+    {
+        return QString("%1 recording(s) in progress and %2 job(s) running")
+            .arg(load.recordings).arg(running);
+    }
+
+    // Metadata lookups hardly load the host, and one job can always run
+    if (jobClass == kMetadataJobs || running == 0)
+        return QString();
+
+    if (limits.maxCPU > 0 && load.cpu > limits.maxCPU)
+    {
+        return QString("CPU is %1% busy, the limit is %2%")
+            .arg(load.cpu).arg(limits.maxCPU);
+    }
+
+    if (limits.maxWriteLatency > 0 &&
+        load.writeLatency > limits.maxWriteLatency)
+    {
+        return QString("recording disk writes take %1ms, the limit is %2ms")
+            .arg(load.writeLatency).arg(limits.maxWriteLatency);
+    }
+
+    return QString();
+}
+
+QString JobAdmission::LoadString(const Load &load)
+{
+    return QString("CPU %1, write latency %2, %3 recording(s)")
+        .arg(load.cpu < 0 ? QString("unknown") :
+             QString("%1%").arg(load.cpu))
+        .arg(load.writeLatency < 0 ? QString("unknown") :
+             QString("%1ms").arg(load.writeLatency))
+        .arg(load.recordings);
+}
+
+/**
+ * \brief Returns \p command prefixed so that it runs in the jobs' cgroup,
+ *        if one is set up.
+ *
+ * myth_system() always runs commands through the shell, writing 0 to
+ * cgroup.procs moves that shell, which the job then inherits.
+ */
+QString JobAdmission::CGroupCommand(const QString &command) const
+{
+    if (m_cgroup.isEmpty())
+        return command;
+
+    return QString("echo 0 > '%1/cgroup.procs' 2>/dev/null; %2")
+        .arg(m_cgroup).arg(command);
+}
+
+/**
+ * \brief Parses the first line of /proc/stat into the time the CPUs have
+ *        been busy and the total time.
+ */
+bool JobAdmission::ParseCPUStat(const QByteArray &stat,
+                                quint64 &busy, quint64 &total)
+{
+    int end = stat.indexOf('\n');
+    QList<QByteArray> fields = stat.left(end < 0 ? stat.size() : end)
+                               .simplified().split(' ');
+    if (fields.size() < 5 || fields[0] != "cpu")
+        return false;
+
+    total = 0;
+    quint64 idle = 0;
+    for (int i = 1; i < fields.size(); i++)
+    {
+        // guest time is already counted in user time
+        if (i > 8)
+            break;
+        quint64 value = fields[i].toULongLong();
+        total += value;
+        if (i == 4 || i == 5) // idle, iowait
+            idle += value;
+    }
+    busy = total - idle;
+    return true;
+}
+
+/**
+ * \brief Finds the completed writes, and the time spent on them, of
+ *        \p device in the contents of /proc/diskstats.
+ */
+bool JobAdmission::ParseDiskStats(const QByteArray &stats, quint64 device,
+                                  quint64 &writes, quint64 &writeMS)
+{
+    QList<QByteArray> lines = stats.split('\n');
+    QList<QByteArray>::const_iterator it = lines.begin();
+    for ( ; it != lines.end(); ++it)
+    {
+        QList<QByteArray> fields = it->simplified().split(' ');
+        if (fields.size() < 11)
+            continue;
+
+        quint64 number = (fields[0].toULongLong() << 32) |
+                          fields[1].toULongLong();
+        if (number != device)
+            continue;
+
+        writes  = fields[7].toULongLong();
+        writeMS = fields[10].toULongLong();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * \brief Percentage of time the CPUs were busy between two samples of
+ *        /proc/stat, or -1 if the counters didn't move forward.
+ *
+ * The busy time can appear to go back when a CPU goes offline.
+ */
+int JobAdmission::CPUPercent(quint64 lastBusy, quint64 lastTotal,
+                             quint64 busy, quint64 total)
+{
+    if (!lastTotal || total <= lastTotal)
+        return -1;
+    if (busy <= lastBusy)
+        return 0;
+    return qMin((busy - lastBusy) * 100 / (total - lastTotal), (quint64)100);
+}
+
+/// Percentage of time the CPUs were busy since the last measurement
+int JobAdmission::MeasureCPU(void)
+{
+#ifdef __linux__
+    QFile file("/proc/stat");
+    if (file.open(QIODevice::ReadOnly))
+    {
+        quint64 busy, total;
+        if (ParseCPUStat(file.readLine(512), busy, total))
+        {
+            int percent = CPUPercent(m_cpuBusy, m_cpuTotal, busy, total);
+            bool first = (m_cpuTotal == 0);
+            m_cpuBusy = busy;
+            m_cpuTotal = total;
+            if (!first)
+                return percent;
+        }
+    }
+#endif
+
+    // No earlier sample to compare with, use the load average
+    double loadavg;
+    if (getloadavg(&loadavg, 1) != 1)
+        return -1;
+    int cpus = qMax(QThread::idealThreadCount(), 1);
+    return qMin((int)(loadavg * 100 / cpus), 100);
+}
+
+/// Average time taken by the writes to the recording devices since the
+/// last measurement, for the slowest of them
+int JobAdmission::MeasureWriteLatency(void)
+{
+#ifdef __linux__
+    if (m_devices.isEmpty())
+        return -1;
+
+    QFile file("/proc/diskstats");
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+    QByteArray stats = file.readAll();
+
+    int latency = -1;
+    QMap<quint64, DiskWrites>::iterator it = m_devices.begin();
+    for ( ; it != m_devices.end(); ++it)
+    {
+        quint64 writes, writeMS;
+        if (!ParseDiskStats(stats, it.key(), writes, writeMS))
+            continue;
+
+        if ((*it).writes && writes >= (*it).writes)
+        {
+            quint64 count = writes - (*it).writes;
+            int ms = count ? (writeMS - (*it).writeMS) / count : 0;
+            latency = qMax(latency, ms);
+        }
+        (*it).writes = writes;
+        (*it).writeMS = writeMS;
+    }
+    return latency;
+#else
+    return -1;
+#endif
+}
+
+/// Number of recordings in progress on this host
+int JobAdmission::CountRecordings(void) const
+{
+    // Recorders refresh their in use mark well within the hour
+    QDateTime oneHourAgo = MythDate::current().addSecs(-61 * 60);
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("SELECT COUNT(*) FROM inuseprograms "
+                  "WHERE recusage = :RECUSAGE AND hostname = :HOSTNAME "
+                  "AND lastupdatetime > :ONEHOURAGO");
+    query.bindValue(":RECUSAGE", kRecorderInUseID);
+    query.bindValue(":HOSTNAME", m_hostname);
+    query.bindValue(":ONEHOURAGO", oneHourAgo);
+
+    if (!query.exec() || !query.next())
+    {
+        MythDB::DBError("JobAdmission::CountRecordings", query);
+        return 0;
+    }
+    return query.value(0).toInt();
+}
+
+/// Looks up the block devices this host's storage group directories are on,
+/// keeping the write counts of those already known
+void JobAdmission::FindRecordingDevices(void)
+{
+#ifdef __linux__
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("SELECT DISTINCT dirname FROM storagegroup "
+                  "WHERE hostname = :HOSTNAME");
+    query.bindValue(":HOSTNAME", m_hostname);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("JobAdmission::FindRecordingDevices", query);
+        return;
+    }
+
+    QMap<quint64, DiskWrites> devices;
+    QStringList names;
+    while (query.next())
+    {
+        QString dirname = query.value(0).toString();
+        struct stat st;
+        if (stat(dirname.toLocal8Bit().constData(), &st) != 0)
+            continue;
+
+        // Network and some virtual filesystems have no block device
+        if (major(st.st_dev) == 0)
+            continue;
+
+        quint64 device = ((quint64)major(st.st_dev) << 32) | minor(st.st_dev);
+        if (!devices.contains(device))
+        {
+            devices.insert(device, m_devices.value(device, DiskWrites()));
+            names.append(QString("%1:%2").arg(major(st.st_dev))
+                         .arg(minor(st.st_dev)));
+        }
+    }
+
+    bool changed = (devices.keys() != m_devices.keys()) || !m_devicesFound;
+    m_devices = devices;
+    m_devicesFound = true;
+
+    if (changed)
+    {
+        LOG(VB_JOBQUEUE, LOG_INFO, LOC +
+            QString("Watching write latency of recording devices %1")
+            .arg(names.isEmpty() ? QString("(none)") : names.join(", ")));
+    }
+#endif
+}
+
+/**
+ * \brief Creates the cgroup jobs are run in and sets its weights, if
+ *        JobQueueCGroup is set.
+ *
+ * The parent group must have the cpu and io controllers enabled in its
+ * cgroup.subtree_control, and be writable by this user.
+ */
+void JobAdmission::SetupCGroup(void)
+{
+    m_cgroup.clear();
+
+    QString path = gCoreContext->GetSetting("JobQueueCGroup", "");
+    if (path.isEmpty())
+        return;
+
+#ifdef __linux__
+    if (!QDir().mkpath(path) || !QFile::exists(path + "/cgroup.procs"))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Unable to create cgroup '%1', jobs will run without it")
+            .arg(path));
+        return;
+    }
+
+    int cpuWeight = qBound(1, gCoreContext->GetNumSetting(
+                               "JobQueueCGroupCPUWeight", 20), 10000);
+    int ioWeight  = qBound(1, gCoreContext->GetNumSetting(
+                               "JobQueueCGroupIOWeight", 20), 10000);
+
+    QFile cpu(path + "/cpu.weight");
+    if (!cpu.open(QIODevice::WriteOnly) ||
+        cpu.write(QByteArray::number(cpuWeight)) < 0)
+    {
+        LOG(VB_GENERAL, LOG_WARNING, LOC +
+            QString("Unable to set CPU weight of cgroup '%1'").arg(path));
+    }
+
+    QFile io(path + "/io.weight");
+    if (!io.open(QIODevice::WriteOnly) ||
+        io.write("default " + QByteArray::number(ioWeight)) < 0)
+    {
+        LOG(VB_GENERAL, LOG_WARNING, LOC +
+            QString("Unable to set IO weight of cgroup '%1'").arg(path));
+    }
+
+    if (access((path + "/cgroup.procs").toLocal8Bit().constData(), W_OK) != 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Unable to move jobs into cgroup '%1', "
+                    "jobs will run without it").arg(path));
+        return;
+    }
+
+    m_cgroup = path;
+    LOG(VB_JOBQUEUE, LOG_INFO, LOC +
+        QString("Running jobs in cgroup '%1' with CPU weight %2, IO weight %3")
+        .arg(path).arg(cpuWeight).arg(ioWeight));
+#else
+    LOG(VB_GENERAL, LOG_WARNING, LOC +
+        "JobQueueCGroup is set, but cgroups are only supported on Linux");
+#endif
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,117 @@
+#ifndef JOBADMISSION_H_
+#define JOBADMISSION_H_
+
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QString>
+#include <QMap>
+
+#include "mythtvexp.h"
+
+/** \class JobAdmission
+ *  \brief Decides whether the JobQueue may start another job, going by
+ *         how busy this host is.
+ *
+ *  Jobs are held back while the CPU is busy, while writes to the
+ *  recording filesystems are slow, or while too many recordings are in
+ *  progress on this host, so that they don't starve the recorders.
+ *  There are also optional limits on the number of jobs of each type.
+ *  The resource checks only hold back a job when another one is already
+ *  running, so the queue always makes progress.
+ *
+ *  Jobs can also be run in a cgroup v2 group with lower CPU and IO
+ *  weights than the recorders, see CGroupCommand().
+ */
+class MTV_PUBLIC JobAdmission
+{
+  public:
+    /// Job types that have their own concurrency limit
+    enum JobClass
+    {
+        kTranscodeJobs = 0,
+        kCommFlagJobs,
+        kMetadataJobs,
+        kUserJobs,
+        kJobClasses
+    };
+
+    class Limits
+    {
+      public:
+        Limits(void) :
+            maxCPU(90), maxWriteLatency(100), maxWhileRecording(1)
+        {
+            for (int i = 0; i < kJobClasses; i++)
+                maxOfClass[i] = 0;
+        }
+
+        int maxCPU;             ///< percent, 0 for no limit
+        int maxWriteLatency;    ///< ms, 0 for no limit
+        int maxWhileRecording;  ///< jobs while recordings are in progress
+        int maxOfClass[kJobClasses]; ///< 0 for no limit
+    };
+
+    class Load
+    {
+      public:
+        Load(void) : cpu(-1), writeLatency(-1), recordings(0) {}
+
+        int cpu;                ///< percent busy, -1 if unknown
+        int writeLatency;       ///< ms per write, -1 if unknown
+        int recordings;         ///< in progress on this host
+    };
+
+    explicit JobAdmission(const QString &hostname);
+
+    void LoadSettings(void);
+    void Measure(void);
+
+    QString Defer(int jobType, int running, const int *runningOfClass) const;
+    QString LoadString(void) const { return LoadString(m_load); }
+    QString CGroupCommand(const QString &command) const;
+
+    static JobClass ClassOf(int jobType);
+    static QString Defer(const Limits &limits, const Load &load, int jobType,
+                         int running, const int *runningOfClass);
+    static QString LoadString(const Load &load);
+    static int CPUPercent(quint64 lastBusy, quint64 lastTotal,
+                          quint64 busy, quint64 total);
+
+    static bool ParseCPUStat(const QByteArray &stat,
+                             quint64 &busy, quint64 &total);
+    static bool ParseDiskStats(const QByteArray &stats, quint64 device,
+                               quint64 &writes, quint64 &writeMS);
+
+  private:
+    void FindRecordingDevices(void);
+    void SetupCGroup(void);
+    int  MeasureCPU(void);
+    int  MeasureWriteLatency(void);
+    int  CountRecordings(void) const;
+
+    QString        m_hostname;
+    Limits         m_limits;
+    Load           m_load;
+    QElapsedTimer  m_measured;
+
+    quint64        m_cpuBusy;
+    quint64        m_cpuTotal;
+
+    class DiskWrites
+    {
+      public:
+        DiskWrites(void) : writes(0), writeMS(0) {}
+        quint64 writes;
+        quint64 writeMS;
+    };
+    /// Block devices the recording directories are on, by device number
+    QMap<quint64, DiskWrites> m_devices;
+    bool           m_devicesFound;
+
+    QString        m_cgroup;   ///< empty unless jobs can be moved into it
+    QString        m_cgroupSettings; ///< the settings m_cgroup was set up from
+};
+
+#endif
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,350 @@
+#include <QStringList>
+
+#include "jobdistributor.h"
+#include "mythcorecontext.h"
+#include "storagegroup.h"
+#include "mythdate.h"
+#include "mythdb.h"
+#include "mythlogging.h"
+
+#define LOC     QString("JobDistributor: ")
+
+QString JobHostStatus::toString(void) const
+{
+    return QString("%1 %2 %3 %4 %5 %6")
+        .arg(MythDate::toString(heartbeat, MythDate::ISODate))
+        .arg(checkFrequency).arg(running).arg(maxJobs).arg(deferred)
+        .arg(load);
+}
+
+bool JobHostStatus::fromString(const QString &status)
+{
+    QStringList fields = status.split(' ');
+    if (fields.size() < 5)
+        return false;
+
+    heartbeat = MythDate::fromString(fields[0]);
+    checkFrequency = fields[1].toInt();
+    running = fields[2].toInt();
+    maxJobs = fields[3].toInt();
+    deferred = fields[4].toInt();
+    load = QStringList(fields.mid(5)).join(" ");
+
+    return heartbeat.isValid() && checkFrequency > 0;
+}
+
+/// A host is given three of its queue checks, and a minute for slow
+/// database updates, to report in
+int JobHostStatus::AliveSecs(void) const
+{
+    return checkFrequency * 3 + 60;
+}
+
+bool JobHostStatus::IsAlive(const QDateTime &now) const
+{
+    return heartbeat.isValid() && heartbeat.secsTo(now) <= AliveSecs();
+}
+
+JobDistributor::JobDistributor(const QString &hostname) :
+    m_hostname(hostname), m_enabled(true), m_claimDelay(60)
+{
+    LoadSettings();
+}
+
+void JobDistributor::LoadSettings(void)
+{
+    m_enabled = !gCoreContext->GetNumSetting("JobsRunOnRecordHost", 0);
+    m_claimDelay = gCoreContext->GetNumSetting("JobQueueRemoteClaimDelay", 60);
+}
+
+/// The database's time, which all the hosts share
+QDateTime JobDistributor::DatabaseTime(void)
+{
+    MSqlQuery query(MSqlQuery::InitCon());
+    if (!query.exec("SELECT NOW()") || !query.next())
+    {
+        MythDB::DBError("JobDistributor::DatabaseTime", query);
+        return QDateTime();
+    }
+    return MythDate::as_utc(query.value(0).toDateTime());
+}
+
+/// Reports this host's status to the other job queues
+void JobDistributor::Heartbeat(const JobHostStatus &status)
+{
+    JobHostStatus stamped = status;
+    stamped.heartbeat = DatabaseTime();
+    if (!stamped.heartbeat.isValid())
+        return;
+
+    gCoreContext->SaveSettingOnHost("JobQueueHostStatus", stamped.toString(),
+                                    m_hostname);
+}
+
+/// Reads the status the other hosts last reported
+void JobDistributor::LoadHosts(void)
+{
+    m_hosts.clear();
+
+    m_now = DatabaseTime();
+    if (!m_now.isValid())
+        return;
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("SELECT hostname, data FROM settings "
+                  "WHERE value = 'JobQueueHostStatus' AND hostname != :HOST");
+    query.bindValue(":HOST", m_hostname);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("JobDistributor::LoadHosts", query);
+        return;
+    }
+
+    while (query.next())
+    {
+        JobHostStatus status;
+        if (status.fromString(query.value(1).toString()))
+            m_hosts.insert(query.value(0).toString(), status);
+    }
+
+    // Forget what was found out about jobs that have since finished
+    if (m_located.size() > 1000)
+        m_located.clear();
+}
+
+/**
+ * \brief Whether this host should claim the unassigned \p job now.
+ *
+ * \p busy is true if this host is already running jobs.
+ */
+bool JobDistributor::ShouldClaim(const JobQueueEntry &job, bool busy)
+{
+    if (!m_enabled || !m_now.isValid())
+        return true;
+
+    Location location = FindRecording(job);
+
+    bool otherAlive = false, otherIdle = false, otherLocalIdle = false;
+    QMap<QString, JobHostStatus>::const_iterator it = m_hosts.begin();
+    for ( ; it != m_hosts.end(); ++it)
+    {
+        if (!(*it).IsAlive(m_now))
+            continue;
+
+        otherAlive = true;
+        if ((*it).IsIdle())
+        {
+            otherIdle = true;
+            otherLocalIdle |= (it.key() == location.recordedOn);
+        }
+    }
+
+    // No one else to leave it to
+    if (!otherAlive)
+        return true;
+
+    return ShouldClaim(job, location.local, busy, otherIdle, otherLocalIdle,
+                       m_claimDelay, m_now);
+}
+
+/**
+ * \brief Whether to claim \p job now, when there are other hosts that
+ *        could run it.
+ *
+ * \p local is true if the recording is on this host's disks, \p busy if
+ * this host is running jobs already. \p otherIdle is true if another host
+ * isn't, and \p otherLocalIdle if one of those has the recording on its
+ * own disks.
+ *
+ * Until \p claimDelay seconds have passed the job is left to the best
+ * placed host: an idle one with the recording, then any idle one, then
+ * a busy one with the recording.
+ */
+bool JobDistributor::ShouldClaim(const JobQueueEntry &job, bool local,
+                                 bool busy, bool otherIdle,
+                                 bool otherLocalIdle, int claimDelay,
+                                 const QDateTime &now)
+{
+    QDateTime queued = qMax(job.inserttime, job.schedruntime);
+    if (!queued.isValid() || queued.secsTo(now) >= claimDelay)
+        return true;
+
+    if (!busy)
+        return local || !otherLocalIdle;
+    return local && !otherIdle;
+}
+
+/**
+ * \brief Whether \p job, assigned to \p owner, should go back in the queue
+ *        because \p owner has stopped reporting.
+ *
+ * Jobs that haven't started are put back as soon as \p owner misses its
+ * reports. One that has started may still be running on a host that is
+ * only slow to report, and starting it again elsewhere would have two
+ * hosts working on the same file, so it is only put back once \p owner
+ * has been silent for twice as long and the job's own status hasn't
+ * changed in that time either. A running job updates its status time
+ * with every progress comment.
+ */
+bool JobDistributor::ShouldFailOver(const JobQueueEntry &job,
+                                    const JobHostStatus &owner,
+                                    const QDateTime &now)
+{
+    if (owner.IsAlive(now))
+        return false;
+
+    if (job.status == JOB_QUEUED)
+        return true;
+
+    if (job.status != JOB_STARTING && job.status != JOB_RUNNING)
+        return false;
+
+    int gone = owner.AliveSecs() * 2;
+    return (owner.heartbeat.secsTo(now) > gone) &&
+        job.statustime.isValid() && (job.statustime.secsTo(now) > gone);
+}
+
+/**
+ * \brief Puts \p job back in the queue if its host has stopped reporting.
+ *
+ * Hosts that have never reported are left alone, they may be running a
+ * version without heartbeats.
+ */
+bool JobDistributor::TryFailOver(const JobQueueEntry &job)
+{
+    if (!m_enabled || !m_now.isValid() || !m_hosts.contains(job.hostname))
+        return false;
+
+    const JobHostStatus &owner = m_hosts[job.hostname];
+    if (!ShouldFailOver(job, owner, m_now))
+        return false;
+
+    QString comment = QObject::tr("%1 stopped responding, requeued")
+                      .arg(job.hostname);
+    if (job.status == JOB_QUEUED)
+    {
+        if (!MoveJob(job, "", comment))
+            return false;
+    }
+    else if (!RequeueJob(job, comment))
+        return false;
+
+    LOG(VB_GENERAL, LOG_WARNING, LOC +
+        QString("Requeued %1 '%2' job #%3 from %4, not heard from it since %5")
+        .arg(JobQueue::StatusText(job.status))
+        .arg(JobQueue::JobText(job.type)).arg(job.id).arg(job.hostname)
+        .arg(MythDate::toString(owner.heartbeat, MythDate::ISODate)));
+    return true;
+}
+
+/**
+ * \brief Finds whether the recording of \p job is in this host's storage
+ *        groups, and which host recorded it.
+ *
+ * The host that recorded it is taken to have it on its own disks.
+ */
+JobDistributor::Location JobDistributor::FindRecording(const JobQueueEntry &job)
+{
+    Location location;
+    if (!job.chanid)
+        return location;
+
+    QHash<int, Location>::const_iterator it = m_located.constFind(job.id);
+    if (it != m_located.constEnd())
+        return *it;
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("SELECT hostname, storagegroup, basename FROM recorded "
+                  "WHERE chanid = :CHANID AND starttime = :STARTTIME");
+    query.bindValue(":CHANID", job.chanid);
+    query.bindValue(":STARTTIME", job.recstartts);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("JobDistributor::FindRecording", query);
+        return location;
+    }
+
+    location.local = false;
+    if (query.next())
+    {
+        location.recordedOn = query.value(0).toString();
+        if (location.recordedOn == m_hostname)
+            location.local = true;
+        else
+        {
+            StorageGroup sgroup(query.value(1).toString(), m_hostname, false);
+            location.local =
+                !sgroup.FindFile(query.value(2).toString()).isEmpty();
+        }
+    }
+
+    m_located.insert(job.id, location);
+    return location;
+}
+
+/**
+ * \brief Moves \p job to \p newHostname, as long as it is still assigned
+ *        to the host it was read with and hasn't started.
+ */
+bool JobDistributor::MoveJob(const JobQueueEntry &job,
+                             const QString &newHostname,
+                             const QString &comment)
+{
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("UPDATE jobqueue "
+                  "SET hostname = :NEWHOST, comment = :COMMENT "
+                  "WHERE id = :ID AND hostname = :OLDHOST "
+                  "  AND status = :QUEUED");
+    query.bindValue(":NEWHOST", newHostname);
+    query.bindValue(":COMMENT", comment);
+    query.bindValue(":ID", job.id);
+    query.bindValue(":OLDHOST", job.hostname);
+    query.bindValue(":QUEUED", JOB_QUEUED);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("JobDistributor::MoveJob", query);
+        return false;
+    }
+
+    return query.numRowsAffected() > 0;
+}
+
+/**
+ * \brief Puts \p job, which its host had started, back in the queue for
+ *        any host, as long as neither its host, status nor status time
+ *        have changed since it was read.
+ *
+ * The status time is part of the condition so that a host which only
+ * seemed to be gone, and reported progress since, keeps the job, and so
+ * that of several hosts failing it over at once only one succeeds.
+ */
+bool JobDistributor::RequeueJob(const JobQueueEntry &job,
+                                const QString &comment)
+{
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("UPDATE jobqueue "
+                  "SET hostname = '', status = :QUEUED, cmds = :RUN, "
+                  "    comment = :COMMENT "
+                  "WHERE id = :ID AND hostname = :OLDHOST "
+                  "  AND status = :STATUS AND statustime = :STATUSTIME");
+    query.bindValue(":QUEUED", JOB_QUEUED);
+    query.bindValue(":RUN", JOB_RUN);
+    query.bindValue(":COMMENT", comment);
+    query.bindValue(":ID", job.id);
+    query.bindValue(":OLDHOST", job.hostname);
+    query.bindValue(":STATUS", job.status);
+    query.bindValue(":STATUSTIME", job.statustime);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("JobDistributor::RequeueJob", query);
+        return false;
+    }
+
+    return query.numRowsAffected() > 0;
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
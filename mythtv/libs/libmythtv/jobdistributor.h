@@ -0,0 +1,110 @@
+#ifndef JOBDISTRIBUTOR_H_
+#define JOBDISTRIBUTOR_H_
+
+#include <QDateTime>
+#include <QString>
+#include <QHash>
+#include <QMap>
+
+#include "mythtvexp.h"
+#include "jobqueue.h"
+
+/// What a host's job queue last reported about itself
+class MTV_PUBLIC JobHostStatus
+{
+  public:
+    JobHostStatus(void) :
+        checkFrequency(0), running(0), maxJobs(0), deferred(0) {}
+
+    QString toString(void) const;
+    bool    fromString(const QString &status);
+
+    int  AliveSecs(void) const;
+    bool IsAlive(const QDateTime &now) const;
+    bool IsIdle(void) const { return running == 0 && deferred == 0; }
+
+    QDateTime heartbeat;      ///< database time of the report
+    int       checkFrequency; ///< secs between the host's queue checks
+    int       running;
+    int       maxJobs;
+    int       deferred;       ///< queued jobs it is holding back
+    QString   load;           ///< as JobAdmission::LoadString()
+};
+
+/** \class JobDistributor
+ *  \brief Spreads the jobs in the queue over the backends that run a
+ *         job queue.
+ *
+ *  Every job queue reports how busy it is in the settings table
+ *  (JobQueueHostStatus) each time it looks at the queue, which doubles
+ *  as its heartbeat. The time of the report is the database's, so a
+ *  host whose clock is out doesn't look dead to the others. Using the
+ *  other hosts' reports this:
+ *
+ *   - leaves unassigned jobs for JobQueueRemoteClaimDelay seconds to
+ *     the host best placed to run them, idle hosts before busy ones and
+ *     hosts with the recording in their own storage group directories
+ *     before others,
+ *   - puts queued jobs assigned to a host that has stopped reporting back
+ *     in the queue for another host to pick up. Jobs that have started
+ *     are only put back once the host has been silent for twice as long
+ *     and the job hasn't reported any progress in that time, the host
+ *     may just be slow to report.
+ *
+ *  Jobs only get a host when one claims them to start them straight
+ *  away, so there is never a queue of jobs on a busy host to take work
+ *  from. Spreading the jobs is done by which host claims them.
+ *
+ *  Every change of a job's host is a single UPDATE conditional on the
+ *  host and status it had, and for a started job its status time, so two
+ *  backends can never both take the same job.
+ *  None of this applies when JobsRunOnRecordHost is set.
+ */
+class MTV_PUBLIC JobDistributor
+{
+  public:
+    explicit JobDistributor(const QString &hostname);
+
+    void LoadSettings(void);
+    void Heartbeat(const JobHostStatus &status);
+    void LoadHosts(void);
+
+    bool ShouldClaim(const JobQueueEntry &job, bool busy);
+    bool TryFailOver(const JobQueueEntry &job);
+
+    static bool ShouldClaim(const JobQueueEntry &job, bool local, bool busy,
+                            bool otherIdle, bool otherLocalIdle,
+                            int claimDelay, const QDateTime &now);
+    static bool ShouldFailOver(const JobQueueEntry &job,
+                               const JobHostStatus &owner,
+                               const QDateTime &now);
+
+  private:
+    /// Where the recording of a job is
+    class Location
+    {
+      public:
+        Location(void) : local(true) {}
+
+        bool    local;      ///< in this host's storage groups
+        QString recordedOn; ///< host that recorded it
+    };
+
+    Location FindRecording(const JobQueueEntry &job);
+    bool MoveJob(const JobQueueEntry &job, const QString &newHostname,
+                 const QString &comment);
+    bool RequeueJob(const JobQueueEntry &job, const QString &comment);
+    static QDateTime DatabaseTime(void);
+
+    QString m_hostname;
+    bool    m_enabled;      ///< false when JobsRunOnRecordHost is set
+    int     m_claimDelay;
+    QDateTime m_now;        ///< database time the hosts were loaded
+
+    QMap<QString, JobHostStatus> m_hosts;   ///< other hosts, by name
+    QHash<int, Location>         m_located; ///< FindRecording() by job id
+};
+
+#endif
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -18,6 +18,8 @@ using namespace std;
 
 #include "exitcodes.h"
 #include "jobqueue.h"
+#include "jobadmission.h"
+#include "jobdistributor.h"
 #include "programinfo.h"
 #include "mythcorecontext.h"
 #include "mythdate.h"
@@ -43,15 +45,21 @@ using namespace std;
 
 #define LOC     QString("JobQueue: ")
 
-JobQueue::JobQueue(bool master) :
-    m_hostname(gCoreContext->GetHostName()),
+/**
+ * \param hostname the host to run jobs for, this one if it is empty
+ */
+JobQueue::JobQueue(bool master, const QString &hostname) :
+    m_hostname(hostname.isEmpty() ? gCoreContext->GetHostName() : hostname),
     jobsRunning(0),
     jobQueueCPU(0),
     m_pginfo(NULL),
     runningJobsLock(new QMutex(QMutex::Recursive)),
     isMaster(master),
+    m_admission(new JobAdmission(m_hostname)),
+    m_distributor(new JobDistributor(m_hostname)),
     queueThread(new MThread("JobQueue", this)),
-    processQueue(false)
+    processQueue(false),
+    queueChanged(false)
 {
     jobQueueCPU = gCoreContext->GetNumSetting("JobQueueCPU", 0);
 
@@ -81,6 +89,8 @@ JobQueue::~JobQueue(void)
 
     gCoreContext->removeListener(this);
 
+    delete m_distributor;
+    delete m_admission;
     delete runningJobsLock;
 }
 
@@ -91,6 +101,15 @@ void JobQueue::customEvent(QEvent *e)
         MythEvent *me = (MythEvent *)e;
         QString message = me->Message();
 
+        // Look at the queue straight away when a job may be waiting for
+        // us, rather than at the next JobQueueCheckFrequency poll
+        if (message == "JOBQUEUE_CHANGED" ||
+            message.startsWith("SYSTEM_EVENT REC_FINISHED"))
+        {
+            WakeQueue();
+            return;
+        }
+
         if (message.startsWith("LOCAL_JOB"))
         {
             // LOCAL_JOB action ID jobID
@@ -163,6 +182,20 @@ void JobQueue::run(void)
     ProcessQueue();
 }
 
+/// Makes the queue thread look at the queue again now
+void JobQueue::WakeQueue(void)
+{
+    QMutexLocker locker(&queueThreadCondLock);
+    queueChanged = true;
+    queueThreadCond.wakeAll();
+}
+
+/// Tells the job queues on every host that there is something new to do
+void JobQueue::NotifyQueueChanged(void)
+{
+    gCoreContext->SendMessage("JOBQUEUE_CHANGED");
+}
+
 void JobQueue::ProcessQueue(void)
 {
     LOG(VB_JOBQUEUE, LOG_INFO, LOC + "ProcessQueue() started");
@@ -183,10 +216,13 @@ void JobQueue::ProcessQueue(void)
     bool inTimeWindow = true;
     bool startedJobAlready = false;
     QMap<int, RunningJobInfo>::Iterator rjiter;
+    int runningOfClass[JobAdmission::kJobClasses];
+    int jobsDeferred;
 
     QMutexLocker locker(&queueThreadCondLock);
     while (processQueue)
     {
+        queueChanged = false;
         locker.unlock();
 
         startedJobAlready = false;
@@ -195,6 +231,7 @@ void JobQueue::ProcessQueue(void)
         LOG(VB_JOBQUEUE, LOG_INFO, LOC +
             QString("Currently set to run up to %1 job(s) max.")
                         .arg(maxJobs));
+        m_admission->LoadSettings();
 
         jobStatus.clear();
 
@@ -208,6 +245,9 @@ void JobQueue::ProcessQueue(void)
         runningJobsLock->unlock();
 
         jobsRunning = 0;
+        jobsDeferred = 0;
+        for (int x = 0; x < JobAdmission::kJobClasses; x++)
+            runningOfClass[x] = 0;
         GetJobsInQueue(jobs);
 
         if (jobs.size())
@@ -222,7 +262,18 @@ void JobQueue::ProcessQueue(void)
                      (status == JOB_STARTING) ||
                      (status == JOB_PAUSED)) &&
                     (hostname == m_hostname))
-                jobsRunning++;
+                {
+                    jobsRunning++;
+                    runningOfClass[JobAdmission::ClassOf(jobs[x].type)]++;
+                }
+            }
+
+            if (inTimeWindow)
+            {
+                m_admission->Measure();
+                LOG(VB_JOBQUEUE, LOG_INFO, LOC + "Load: " +
+                    m_admission->LoadString());
+                m_distributor->LoadHosts();
             }
 
             message = QString("Currently Running %1 jobs.")
@@ -271,6 +322,13 @@ void JobQueue::ProcessQueue(void)
                     (!hostname.isEmpty()) &&
                     (hostname != m_hostname))
                 {
+                    // Its host has stopped reporting in, let anyone take it
+                    if (m_distributor->TryFailOver(jobs[x]))
+                    {
+                        NotifyQueueChanged();
+                        continue;
+                    }
+
                     // Setting the status here will prevent us from processing
                     // any other jobs for this recording until this one is
                     // completed on the remote host.
@@ -435,6 +493,35 @@ void JobQueue::ProcessQueue(void)
                 if (startedJobAlready)
                     continue;
 
+                // Would another job slow down the recordings?
+                if (inTimeWindow)
+                {
+                    QString reason = m_admission->Defer(
+                        jobs[x].type, jobsRunning, runningOfClass);
+                    if (!reason.isEmpty())
+                    {
+                        message = QString("Deferring '%1' job for %2, %3")
+                                          .arg(JobText(jobs[x].type))
+                                          .arg(logInfo).arg(reason);
+                        LOG(VB_JOBQUEUE, LOG_INFO, LOC + message);
+                        jobsDeferred++;
+                        continue;
+                    }
+                }
+
+                // Give a host with the recording on its own disks, or one
+                // with nothing to do, the first chance at it
+                if ((inTimeWindow) &&
+                    (hostname.isEmpty()) &&
+                    (!m_distributor->ShouldClaim(jobs[x], jobsRunning > 0)))
+                {
+                    message = QString("Leaving '%1' job for %2 to another "
+                                      "host for now")
+                                      .arg(JobText(jobs[x].type)).arg(logInfo);
+                    LOG(VB_JOBQUEUE, LOG_INFO, LOC + message);
+                    continue;
+                }
+
                 if ((inTimeWindow) &&
                     (hostname.isEmpty()) &&
                     (!ChangeJobHost(jobID, m_hostname)))
@@ -456,9 +543,10 @@ void JobQueue::ProcessQueue(void)
                 }
 
                 message = QString("Processing '%1' job for %2, "
-                                  "current status is '%3'")
+                                  "current status is '%3' (%4)")
                                   .arg(JobText(jobs[x].type)).arg(logInfo)
-                                  .arg(StatusText(status));
+                                  .arg(StatusText(status))
+                                  .arg(m_admission->LoadString());
                 LOG(VB_JOBQUEUE, LOG_INFO, LOC + message);
 
                 ProcessJob(jobs[x]);
@@ -467,6 +555,16 @@ void JobQueue::ProcessQueue(void)
             }
         }
 
+        // Tell the other hosts how busy we are, this is also how they
+        // know we are still here
+        JobHostStatus hostStatus;
+        hostStatus.checkFrequency = qMax(sleepTime, 1);
+        hostStatus.running = jobsRunning;
+        hostStatus.maxJobs = maxJobs;
+        hostStatus.deferred = jobsDeferred;
+        hostStatus.load = m_admission->LoadString();
+        m_distributor->Heartbeat(hostStatus);
+
         if (QCoreApplication::applicationName() == MYTH_APPNAME_MYTHJOBQUEUE)
         {
             if (jobsRunning > 0)
@@ -490,8 +588,10 @@ void JobQueue::ProcessQueue(void)
         }
 
 
+        // Events that arrived while the queue was being looked at mean
+        // it needs another look straight away.
         locker.relock();
-        if (processQueue)
+        if (processQueue && !queueChanged)
         {
             int st = (startedJobAlready) ? (5 * 1000) : (sleepTime * 1000);
             if (st > 0)
@@ -609,6 +709,8 @@ bool JobQueue::QueueJob(int jobType, uint chanid, const QDateTime &recstartts,
         return false;
     }
 
+    NotifyQueueChanged();
+
     return true;
 }
 
@@ -921,6 +1023,10 @@ bool JobQueue::ChangeJobCmds(int jobID, int newCmds)
         return false;
     }
 
+    // JOB_RUN is set by the queue itself once it has acted on a command
+    if (newCmds != JOB_RUN)
+        NotifyQueueChanged();
+
     return true;
 }
 
@@ -943,6 +1049,9 @@ bool JobQueue::ChangeJobCmds(int jobType, uint chanid,
         return false;
     }
 
+    if (newCmds != JOB_RUN)
+        NotifyQueueChanged();
+
     return true;
 }
 
@@ -1049,7 +1158,8 @@ int JobQueue::GetRunningJobID(uint chanid, const QDateTime &recstartts)
     {
         RunningJobInfo jInfo = *it;
 
-        if ((jInfo.pginfo->GetChanID()             == chanid) &&
+        if (jInfo.pginfo &&
+            (jInfo.pginfo->GetChanID()             == chanid) &&
             (jInfo.pginfo->GetRecordingStartTime() == recstartts))
         {
             runningJobsLock->unlock();
@@ -1833,6 +1943,9 @@ void JobQueue::RemoveRunningJob(int id)
     }
 
     runningJobsLock->unlock();
+
+    // A job slot is free
+    WakeQueue();
 }
 
 QString JobQueue::PrettyPrint(off_t bytes)
@@ -1994,7 +2107,7 @@ void JobQueue::DoTranscodeThread(int jobID)
                                            .arg(command));
 
         GetMythDB()->GetDBManager()->CloseDatabases();
-        uint result = myth_system(command);
+        uint result = myth_system(m_admission->CGroupCommand(command));
         int status = GetJobStatus(jobID);
 
         if ((result == GENERIC_EXIT_DAEMONIZING_ERROR) ||
@@ -2169,7 +2282,7 @@ void JobQueue::DoMetadataLookupThread(int jobID)
             .arg(command));
 
     GetMythDB()->GetDBManager()->CloseDatabases();
-    retVal = myth_system(command);
+    retVal = myth_system(m_admission->CGroupCommand(command));
     int priority = LOG_NOTICE;
     QString comment;
 
@@ -2306,7 +2419,8 @@ void JobQueue::DoFlagCommercialsThread(int jobID)
             .arg(command));
 
     GetMythDB()->GetDBManager()->CloseDatabases();
-    breaksFound = myth_system(command, kMSLowExitVal);
+    breaksFound = myth_system(m_admission->CGroupCommand(command),
+                              kMSLowExitVal);
     int priority = LOG_NOTICE;
     QString comment;
 
@@ -2424,7 +2538,7 @@ void JobQueue::DoUserJobThread(int jobID)
     LOG(VB_JOBQUEUE, LOG_INFO, LOC + QString("Running command: '%1'")
                                        .arg(command));
     GetMythDB()->GetDBManager()->CloseDatabases();
-    uint result = myth_system(command);
+    uint result = myth_system(m_admission->CGroupCommand(command));
 
     if ((result == GENERIC_EXIT_DAEMONIZING_ERROR) ||
         (result == GENERIC_EXIT_CMD_NOT_FOUND))
@@ -14,6 +14,8 @@
 #include "mythtvexp.h"
 
 class MThread;
+class JobAdmission;
+class JobDistributor;
 class ProgramInfo;
 class RecordingInfo;
 
@@ -119,7 +121,7 @@ class MTV_PUBLIC JobQueue : public QObject, public QRunnable
 
     friend class QueueProcessorThread;
   public:
-    JobQueue(bool master);
+    explicit JobQueue(bool master, const QString &hostname = QString());
     ~JobQueue(void);
     void customEvent(QEvent *e);
 
@@ -208,6 +210,8 @@ class MTV_PUBLIC JobQueue : public QObject, public QRunnable
 
     void run(void); // QRunnable
     void ProcessQueue(void);
+    void WakeQueue(void);
+    static void NotifyQueueChanged(void);
 
     void ProcessJob(JobQueueEntry job);
 
@@ -250,10 +254,15 @@ class MTV_PUBLIC JobQueue : public QObject, public QRunnable
 
     bool isMaster;
 
+    JobAdmission *m_admission;
+    JobDistributor *m_distributor;
+
     MThread *queueThread;
     QWaitCondition queueThreadCond;
     QMutex queueThreadCondLock;
     bool processQueue;
+    /// Set when something changed since the queue was last looked at
+    bool queueChanged;
 };
 
 #endif
@@ -118,7 +118,8 @@ HEADERS += recordinginfo.h
 HEADERS += dbcheck.h
 HEADERS += videodbcheck.h
 HEADERS += tvremoteutil.h           tv.h
-HEADERS += jobqueue.h
+HEADERS += jobqueue.h               jobadmission.h
+HEADERS += jobdistributor.h
 HEADERS += filtermanager.h          recordingprofile.h
 HEADERS += remoteencoder.h          videosource.h
 HEADERS += cardutil.h               sourceutil.h
@@ -148,7 +149,8 @@ SOURCES += recordinginfo.cpp
 SOURCES += dbcheck.cpp
 SOURCES += videodbcheck.cpp
 SOURCES += tvremoteutil.cpp         tv.cpp
-SOURCES += jobqueue.cpp
+SOURCES += jobqueue.cpp             jobadmission.cpp
+SOURCES += jobdistributor.cpp
 SOURCES += filtermanager.cpp        recordingprofile.cpp
 SOURCES += remoteencoder.cpp        videosource.cpp
 SOURCES += cardutil.cpp             sourceutil.cpp
@@ -591,9 +593,11 @@ using_backend {
     HEADERS += recorders/recorderbase.h
     HEADERS += recorders/DeviceReadBuffer.h
     HEADERS += recorders/dtvrecorder.h
+    HEADERS += recorders/commflagtap.h
     SOURCES += recorders/recorderbase.cpp
     SOURCES += recorders/DeviceReadBuffer.cpp
     SOURCES += recorders/dtvrecorder.cpp
+    SOURCES += recorders/commflagtap.cpp
 
     # Import recorder
     HEADERS += recorders/importrecorder.h
@@ -690,6 +694,7 @@ using_backend {
 
     HEADERS += recorders/rtp/udppacket.h
     HEADERS += recorders/rtp/udppacketbuffer.h
+    HEADERS += recorders/rtp/udppacketreceiver.h
     HEADERS += recorders/rtp/packetbuffer.h
     HEADERS += recorders/rtp/rtppacketbuffer.h
     HEADERS += recorders/rtp/rtpdatapacket.h
@@ -705,6 +710,7 @@ using_backend {
 
     SOURCES += recorders/rtp/packetbuffer.cpp
     SOURCES += recorders/rtp/rtppacketbuffer.cpp
+    SOURCES += recorders/rtp/udppacketreceiver.cpp
 
     # Support for HTTP TS streams
     HEADERS += recorders/httptsstreamhandler.h
@@ -717,12 +723,14 @@ using_backend {
     HEADERS += recorders/HLS/HLSPlaylistWorker.h
     HEADERS += recorders/HLS/HLSReader.h
     HEADERS += recorders/HLS/HLSSegment.h
+    HEADERS += recorders/HLS/HLSSegmentFetcher.h
     HEADERS += recorders/HLS/HLSStream.h
     HEADERS += recorders/HLS/HLSStreamWorker.h
 
     SOURCES += recorders/HLS/HLSPlaylistWorker.cpp
     SOURCES += recorders/HLS/HLSReader.cpp
     SOURCES += recorders/HLS/HLSSegment.cpp
+    SOURCES += recorders/HLS/HLSSegmentFetcher.cpp
     SOURCES += recorders/HLS/HLSStream.cpp
     SOURCES += recorders/HLS/HLSStreamWorker.cpp
 
@@ -43,6 +43,7 @@ using namespace std;
 #include "interactivetv.h"
 #include "mythsystemevent.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
 #include "mythmiscutil.h"
 #include "icringbuffer.h"
 #include "audiooutput.h"
@@ -1923,6 +1924,7 @@ void MythPlayer::AVSync(VideoFrame *buffer, bool limit_delay)
             LOG(VB_PLAYBACK | VB_TIMESTAMP, LOG_INFO,
                 LOC + QString("AVSync waitforframe %1 %2")
                     .arg(avsync_adjustment).arg(m_double_framerate));
+            MYTH_TRACE_SPAN(kTracePlayer, "wait for frame");
             vsync_delay_clock = videosync->WaitForFrame
                                 (frameDelay + avsync_adjustment + repeat_delay);
         }
@@ -1933,7 +1935,10 @@ void MythPlayer::AVSync(VideoFrame *buffer, bool limit_delay)
         }
         //currentaudiotime = AVSyncGetAudiotime();
         LOG(VB_PLAYBACK | VB_TIMESTAMP, LOG_INFO, LOC + "AVSync show");
-        videoOutput->Show(ps);
+        {
+            MYTH_TRACE_SPAN(kTracePlayer, "show");
+            videoOutput->Show(ps);
+        }
 
         if (videoOutput->IsErrored())
         {
@@ -2055,6 +2060,7 @@ void MythPlayer::AVSync(VideoFrame *buffer, bool limit_delay)
             if (avsync_delay > 2000000 && limit_delay)
                 avsync_delay = 90000;
             avsync_avg = (avsync_delay + (avsync_avg * 3)) / 4;
+            MYTH_TRACE_COUNTER(kTracePlayer, "avsync avg", avsync_avg);
 
             int avsync_used = avsync_avg;
             if (labs(avsync_used) > labs(avsync_delay))
@@ -2232,6 +2238,8 @@ void MythPlayer::DisplayNormalFrame(bool check_prebuffer)
     if (allpaused || (check_prebuffer && !PrebufferEnoughFrames()))
         return;
 
+    MYTH_TRACE_SPAN(kTracePlayer, "display frame");
+
     // clear the buffering state
     SetBuffering(false);
 
@@ -3477,7 +3485,10 @@ bool MythPlayer::DecoderGetFrame(DecodeType decodetype, bool unsafe)
     }
 
     if (ffrew_skip == 1 || decodeOneFrame)
+    {
+        MYTH_TRACE_SPAN(kTracePlayer, "decode frame");
         ret = decoder->GetFrame(decodetype);
+    }
     else if (ffrew_skip != 0)
         ret = DecoderGetFrameFFREW();
     decoder_change_lock.unlock();
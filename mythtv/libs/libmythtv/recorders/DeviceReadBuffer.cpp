@@ -5,6 +5,8 @@ using namespace std;
 #include "mythcorecontext.h"
 #include "mythbaseutil.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
+#include "mythmetrics.h"
 #include "tspacket.h"
 #include "mthread.h"
 #include "compat.h"
@@ -18,6 +20,30 @@ using namespace std;
 
 #define LOC QString("DevRdB(%1): ").arg(videodevice)
 
+static MythCounter *read_bytes(void)
+{
+    static MythCounter *counter = MythMetrics::Counter(
+        "mythtv_device_read_bytes_total",
+        "Bytes read from capture devices into device read buffers");
+    return counter;
+}
+
+static MythCounter *driver_overflows(void)
+{
+    static MythCounter *counter = MythMetrics::Counter(
+        "mythtv_device_driver_overflows_total",
+        "Capture device driver buffer overflows");
+    return counter;
+}
+
+static MythGauge *used_gauge(const QString &device)
+{
+    return MythMetrics::Gauge(
+        "mythtv_device_buffer_used_bytes",
+        "Bytes waiting in a device read buffer",
+        MythMetrics::Label("device", device));
+}
+
 DeviceReadBuffer::DeviceReadBuffer(
     DeviceReaderCB *cb, bool use_poll, bool error_exit_on_poll_timeout)
     : MThread("DeviceReadBuffer"),
@@ -42,7 +68,7 @@ DeviceReadBuffer::DeviceReadBuffer(
       // statistics
       max_used(0),                  avg_used(0),
       avg_buf_write_cnt(0),         avg_buf_read_cnt(0),
-      avg_buf_sleep_cnt(0)
+      avg_buf_sleep_cnt(0),         usedMetric(NULL)
 {
     for (int i = 0; i < 2; i++)
     {
@@ -83,6 +109,7 @@ bool DeviceReadBuffer::Setup(const QString &streamName, int streamfd,
     videodevice   = streamName;
     videodevice   = (videodevice == QString::null) ? "" : videodevice;
     _stream_fd    = streamfd;
+    usedMetric    = used_gauge(videodevice);
 
     // Setup device ringbuffer
     eof           = false;
@@ -163,10 +190,12 @@ void DeviceReadBuffer::Reset(const QString &streamName, int streamfd)
     videodevice   = streamName;
     videodevice   = (videodevice == QString::null) ? "" : videodevice;
     _stream_fd    = streamfd;
+    usedMetric    = used_gauge(videodevice);
 
     used          = 0;
     readPtr       = buffer;
     writePtr      = buffer;
+    usedMetric->Set(0);
 
     error         = false;
 }
@@ -181,7 +210,13 @@ void DeviceReadBuffer::Stop(void)
         locker.unlock();
         WakePoll();
         wait();
+        locker.relock();
     }
+
+    // Nothing fills the buffer once it is stopped, so don't leave the
+    // device showing its last fill level
+    if (usedMetric)
+        usedMetric->Set(0);
     LOG(VB_RECORD, LOG_INFO, LOC + "Stop() -- end");
 }
 
@@ -307,6 +342,8 @@ void DeviceReadBuffer::IncrWritePointer(uint len)
     used     += len;
     writePtr += len;
     writePtr  = (writePtr >= endPtr) ? buffer + (writePtr - endPtr) : writePtr;
+    usedMetric->Set(used);
+    read_bytes()->Add(len);
 #if REPORT_RING_STATS
     max_used = max(used, max_used);
     avg_used = ((avg_used * avg_buf_write_cnt) + used) / (avg_buf_write_cnt+1);
@@ -321,6 +358,7 @@ void DeviceReadBuffer::IncrReadPointer(uint len)
     used    -= len;
     readPtr += len;
     readPtr  = (readPtr == endPtr) ? buffer : readPtr;
+    usedMetric->Set(used);
 #if REPORT_RING_STATS
     ++avg_buf_read_cnt;
 #endif
@@ -598,6 +636,7 @@ bool DeviceReadBuffer::CheckForErrors(
         }
         if (EOVERFLOW == errno)
         {
+            driver_overflows()->Add();
             LOG(VB_GENERAL, LOG_ERR, LOC + "Driver buffers overflowed");
             return false;
         }
@@ -673,6 +712,8 @@ uint DeviceReadBuffer::Read(unsigned char *buf, const uint count)
         IncrReadPointer(cnt);
     }
 
+    MYTH_TRACE_COUNTER(kTraceStream, "device buffer used", GetUsed());
+
 #if REPORT_RING_STATS
     ReportStats();
 #endif
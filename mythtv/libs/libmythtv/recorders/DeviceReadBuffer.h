@@ -13,6 +13,9 @@
 #include "mythtimer.h"
 #include "tspacket.h"
 #include "mthread.h"
+#include "mythtvexp.h"
+
+class MythGauge;
 
 class DeviceReaderCB
 {
@@ -30,7 +33,7 @@ class DeviceReaderCB
  *  of long blocking conditions on writing to disk or accessing the
  *  database.
  */
-class DeviceReadBuffer : protected MThread
+class MTV_PUBLIC DeviceReadBuffer : protected MThread
 {
   public:
     DeviceReadBuffer(DeviceReaderCB *callback,
@@ -59,6 +62,7 @@ class DeviceReadBuffer : protected MThread
 
     uint Read(unsigned char *buf, uint count);
     uint GetUsed(void) const;
+    uint GetSize(void) const { return size; }
 
   private:
     virtual void run(void); // MThread
@@ -123,6 +127,7 @@ class DeviceReadBuffer : protected MThread
     size_t           avg_buf_read_cnt;
     size_t           avg_buf_sleep_cnt;
     MythTimer        lastReport;
+    MythGauge       *usedMetric;
 };
 
 #endif // _DEVICEREADBUFFER_H_
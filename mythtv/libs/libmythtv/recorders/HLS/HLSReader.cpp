@@ -1,7 +1,9 @@
-#include <sys/time.h>
 #include <unistd.h>
 
+#include "mythcorecontext.h"
+
 #include "HLSReader.h"
+#include "HLSSegmentFetcher.h"
 #include "HLS/m3u.h"
 
 #define LOC QString("%1: ").arg(m_curstream ? m_curstream->Url() : "HLSReader")
@@ -19,20 +21,15 @@ static QUrl RelativeURI (const QString& baseString, const QString& uriString)
     return base.resolved(uri);
 }
 
-static uint64_t MDate(void)
-{
-    timeval  t;
-    gettimeofday(&t, NULL);
-    return t.tv_sec * 1000000ULL + t.tv_usec;
-}
-
 HLSReader::HLSReader(void)
     : m_curstream(NULL), m_cur_seq(-1), m_bitrate_index(0),
       m_fatal(false), m_cancel(false),
       m_throttle(true), m_aesmsg(false),
       m_playlistworker(NULL), m_streamworker(NULL),
       m_playlist_size(0), m_bandwidthcheck(false), m_prebuffer_cnt(10),
-      m_debug(false), m_debug_cnt(0), m_slow_cnt(0)
+      m_debug(false), m_debug_cnt(0), m_slow_cnt(0),
+      m_prefetch(3), m_throughput(0),
+      m_streamed_seq(-1), m_streamed_bytes(0)
 {
 }
 
@@ -57,6 +54,11 @@ bool HLSReader::Open(const QString & m3u, int bitrate_index)
     Close(true);
     m_cancel = false;
 
+    // QNetworkAccessManager only opens six connections to a host
+    m_prefetch = qBound(1, gCoreContext->GetNumSetting(
+                            "HLSPrefetchSegments", 3), 6);
+    m_throughput = 0;
+
     QByteArray buffer;
 
 #ifdef HLS_USE_MYTHDOWNLOADMANAGER // MythDownloadManager leaks memory
@@ -169,10 +171,6 @@ void HLSReader::Cancel(bool quiet)
 
     m_cancel = true;
 
-    m_throttle_lock.lock();
-    m_throttle_cond.wakeAll();
-    m_throttle_lock.unlock();
-
     QMutexLocker lock(&m_stream_lock);
 
     if (m_curstream)
@@ -199,8 +197,6 @@ void HLSReader::Throttle(bool val)
     m_throttle = val;
     if (val)
         m_prebuffer_cnt += 4;
-    else
-        m_throttle_cond.wakeAll();
     m_throttle_lock.unlock();
 }
 
@@ -639,7 +635,13 @@ bool HLSReader::LoadMetaPlaylists(MythSingleDownload& downloader)
     StreamContainer::iterator   Istream;
 
     m_stream_lock.lock();
-    if (m_bandwidthcheck /* && !m_segments.empty() */)
+    if (m_bandwidthcheck && m_throughput > 0 && m_streams.size() > 1)
+    {
+        // Pick the variant the measured download rate can sustain
+        SelectBitrate(m_curstream->Id(), m_throughput);
+        m_bandwidthcheck = false;
+    }
+    else if (m_bandwidthcheck /* && !m_segments.empty() */)
     {
         int buffered = PercentBuffered();
 
@@ -766,7 +768,45 @@ void HLSReader::IncreaseBitrate(int progid)
     }
 }
 
-bool HLSReader::LoadSegments(MythSingleDownload& downloader)
+/**
+ * \brief Switches to the highest bitrate variant of \p progid that can
+ *        be downloaded at \p throughput with some headroom, or the
+ *        lowest one if none can.
+ */
+void HLSReader::SelectBitrate(int progid, uint64_t throughput)
+{
+    uint64_t budget = throughput / 10 * 8;
+    HLSRecStream *best = NULL;
+    HLSRecStream *lowest = NULL;
+    StreamContainer::const_iterator Istream;
+
+    for (Istream = m_streams.begin(); Istream != m_streams.end(); ++Istream)
+    {
+        if ((*Istream)->Id() != progid)
+            continue;
+        if ((*Istream)->Bitrate() == 0)
+            return; // can't compare variants without a bitrate
+        if (lowest == NULL || (*Istream)->Bitrate() < lowest->Bitrate())
+            lowest = *Istream;
+        if ((*Istream)->Bitrate() <= budget &&
+            (best == NULL || (*Istream)->Bitrate() > best->Bitrate()))
+            best = *Istream;
+    }
+
+    if (best == NULL)
+        best = lowest;
+
+    if (best && best != m_curstream)
+    {
+        LOG(VB_RECORD, LOG_INFO, LOC +
+            QString("Measured %1 kbit/s, switching bitrate %2 -> %3")
+            .arg(throughput / 1000).arg(m_curstream->Bitrate())
+            .arg(best->Bitrate()));
+        m_curstream = best;
+    }
+}
+
+bool HLSReader::LoadSegments(HLSSegmentFetcher& fetcher)
 {
     LOG(VB_RECORD, LOG_DEBUG, LOC + "LoadSegment -- start");
 
@@ -777,99 +817,10 @@ bool HLSReader::LoadSegments(MythSingleDownload& downloader)
         return false;
     }
 
-    HLSRecStream *hls;
-    HLSRecSegment seg;
-    long          throttle;
-    for (;;)
-    {
-        m_seq_lock.lock();
-        if (m_cancel || m_segments.empty())
-        {
-            m_seq_lock.unlock();
-            break;
-        }
-
-        seg = m_segments.front();
-        if (m_segments.size() > m_playlist_size)
-        {
-            LOG(VB_RECORD, (m_debug ? LOG_INFO : LOG_DEBUG), LOC +
-                QString("Downloading segment %1 (1 of %2) with %3 behind")
-                .arg(seg.Sequence())
-                .arg(m_segments.size() + m_playlist_size)
-                .arg(m_segments.size() - m_playlist_size));
-        }
-        else
-        {
-            LOG(VB_RECORD, (m_debug ? LOG_INFO : LOG_DEBUG), LOC +
-                QString("Downloading segment %1 (%2 of %3)")
-                .arg(seg.Sequence())
-                .arg(m_playlist_size - m_segments.size() + 1)
-                .arg(m_playlist_size));
-        }
-        m_seq_lock.unlock();
-
-        m_stream_lock.lock();
-        hls = m_curstream;
-        m_stream_lock.unlock();
-        if (!hls)
-        {
-            LOG(VB_RECORD, LOG_DEBUG, LOC + "LoadSegment -- no current stream");
-            return false;
-        }
-
-        throttle = DownloadSegmentData(downloader, hls,
-                                       seg, m_playlist_size);
-
-        m_seq_lock.lock();
-        if (throttle < 0)
-        {
-            if (m_segments.size() > m_playlist_size)
-            {
-                SegmentContainer::iterator Iseg = m_segments.begin() +
-                                          (m_segments.size() - m_playlist_size);
-                m_segments.erase(m_segments.begin(), Iseg);
-            }
-            m_seq_lock.unlock();
-            return false;
-        }
-        else
-        {
-            m_cur_seq = m_segments.front().Sequence();
-            m_segments.pop_front();
-        }
-
-        m_seq_lock.unlock();
-
-        if (m_throttle && throttle == 0)
-            throttle = 2;
-        else if (throttle > 8)
-            throttle = 8;
-        if (throttle > 0)
-        {
-            LOG(VB_RECORD, LOG_INFO, LOC +
-                QString("Throttling -- sleeping %1 secs.")
-                .arg(throttle));
-            throttle *= 1000;
-            m_throttle_lock.lock();
-            if (m_throttle_cond.wait(&m_throttle_lock, throttle))
-                LOG(VB_RECORD, LOG_INFO, LOC + "Throttle aborted");
-            m_throttle_lock.unlock();
-            LOG(VB_RECORD, LOG_INFO, LOC + "Throttle done");
-        }
-        else
-            usleep(5000);
-
-        if (m_prebuffer_cnt == 0)
-        {
-            m_bandwidthcheck = (m_bitrate_index == 0);
-            m_prebuffer_cnt = 2;
-        }
-        else
-            --m_prebuffer_cnt;
-    }
+    bool ret = fetcher.Run();
 
     LOG(VB_RECORD, LOG_DEBUG, LOC + "LoadSegment -- end");
-    return true;
+    return ret;
 }
 
 uint HLSReader::PercentBuffered(void) const
@@ -880,12 +831,53 @@ uint HLSReader::PercentBuffered(void) const
             static_cast<float>(m_playlist_size)) * 100.0;
 }
 
-int HLSReader::DownloadSegmentData(MythSingleDownload& downloader,
-                                   HLSRecStream* hls,
-                                   HLSRecSegment& segment, int playlist_size)
+/**
+ * \brief Finds the first queued segment after sequence \p after, or the
+ *        first one if \p after is negative.
+ */
+bool HLSReader::NextSegment(int64_t after, HLSRecSegment& segment,
+                            HLSRecStream*& hls)
 {
+    m_seq_lock.lock();
+    int idx = 0;
+    while (idx < m_segments.size() && after >= 0 &&
+           m_segments[idx].Sequence() <= after)
+        ++idx;
+    if (m_cancel || idx >= m_segments.size())
+    {
+        m_seq_lock.unlock();
+        return false;
+    }
+
+    segment = m_segments[idx];
+    if (m_segments.size() > m_playlist_size)
+    {
+        LOG(VB_RECORD, (m_debug ? LOG_INFO : LOG_DEBUG), LOC +
+            QString("Downloading segment %1 (%2 of %3) with %4 behind")
+            .arg(segment.Sequence()).arg(idx + 1)
+            .arg(m_segments.size() + m_playlist_size)
+            .arg(m_segments.size() - m_playlist_size));
+    }
+    else
+    {
+        LOG(VB_RECORD, (m_debug ? LOG_INFO : LOG_DEBUG), LOC +
+            QString("Downloading segment %1 (%2 of %3)")
+            .arg(segment.Sequence())
+            .arg(m_playlist_size - m_segments.size() + idx + 1)
+            .arg(m_playlist_size));
+    }
+    m_seq_lock.unlock();
+
+    m_stream_lock.lock();
+    hls = m_curstream;
+    m_stream_lock.unlock();
+    if (!hls)
+    {
+        LOG(VB_RECORD, LOG_DEBUG, LOC + "LoadSegment -- no current stream");
+        return false;
+    }
+
     uint64_t bandwidth = hls->AverageBandwidth();
-    int estimated_time = 0;
 
     LOG(VB_RECORD, LOG_DEBUG, LOC +
         QString("Downloading %1 bandwidth %2 bitrate %3")
@@ -895,7 +887,7 @@ int HLSReader::DownloadSegmentData(MythSingleDownload& downloader,
     if ((bandwidth > 0) && (hls->Bitrate() > 0))
     {
         uint64_t size = (segment.Duration() * hls->Bitrate()); /* bits */
-        estimated_time = (int)(size / bandwidth);
+        int estimated_time = (int)(size / bandwidth);
         if (estimated_time > segment.Duration())
         {
             LOG(VB_RECORD, LOG_WARNING, LOC +
@@ -908,53 +900,62 @@ int HLSReader::DownloadSegmentData(MythSingleDownload& downloader,
         }
     }
 
-    QByteArray buffer;
-    uint64_t   start = MDate();
+    return true;
+}
 
-#ifdef HLS_USE_MYTHDOWNLOADMANAGER // MythDownloadManager leaks memory
-                                   // and can only handle six download at a time
-    if (!HLSReader::DownloadURL(segment.Url(), &buffer))
-    {
-        LOG(VB_RECORD, LOG_ERR, LOC +
-            QString("%1 failed").arg(segment.Sequence()));
-        if (estimated_time * 2 < segment.Duration())
-        {
-            if (!HLSReader::DownloadURL(segment.Url(), &buffer))
-            {
-                LOG(VB_RECORD, LOG_ERR, LOC + QString("%1 failed")
-                    .arg(segment.Sequence()));
-                return -1;
-            }
-        }
-        else
-            return 0;
-    }
-#else
-    if (!downloader.DownloadURL(segment.Url(), &buffer))
+/**
+ * \brief Appends segment data to the stream buffer as it arrives.
+ *
+ * \p offset is where \p data starts within the segment. When a failed
+ * segment is downloaded again the part already passed on is skipped.
+ */
+void HLSReader::StreamSegmentData(int64_t sequence, qint64 offset,
+                                  const char *data, qint64 len)
+{
+    QMutexLocker lock(&m_buflock);
+
+    if (sequence != m_streamed_seq)
     {
-        LOG(VB_RECORD, LOG_ERR, LOC + QString("%1 failed: %2")
-            .arg(segment.Sequence()).arg(downloader.ErrorString()));
-        return -1;
+        m_streamed_seq = sequence;
+        m_streamed_bytes = 0;
     }
-#endif
 
-    uint64_t downloadduration = (MDate() - start) / 1000;
+    qint64 skip = qMax(m_streamed_bytes - offset, (qint64)0);
+    if (skip >= len)
+        return;
+
+    m_buffer.append(data + skip, len - skip);
+    m_streamed_bytes = offset + len;
+}
 
 #ifdef USING_LIBCRYPTO
-    /* If the segment is encrypted, decode it */
-    if (segment.HasKeyPath())
-    {
-        if (!hls->DecodeData(downloader, hls->IVLoaded() ? hls->AESIV() : NULL,
-                             segment.KeyPath(),
-                             buffer, segment.Sequence()))
-            return 0;
-    }
+bool HLSReader::DecodeSegment(MythSingleDownload& downloader,
+                              HLSRecStream* hls,
+                              const HLSRecSegment& segment, QByteArray& data)
+{
+    return hls->DecodeData(downloader, hls->IVLoaded() ? hls->AESIV() : NULL,
+                           segment.KeyPath(), data, segment.Sequence());
+}
 #endif
 
-    int segment_len = buffer.size();
+/**
+ * \brief Bookkeeping once all of a segment has been passed on.
+ *
+ * \p throughput is the measured rate of all the downloads in flight.
+ * Returns how many seconds to hold off requesting more segments for,
+ * or -1 if the recording can't keep up.
+ */
+int HLSReader::SegmentDownloaded(HLSRecStream* hls,
+                                 const HLSRecSegment& segment,
+                                 qint64 segment_len, qint64 download_ms,
+                                 uint64_t throughput)
+{
+    int playlist_size = m_playlist_size;
 
     m_buflock.lock();
-    if (m_buffer.size() > segment_len * playlist_size)
+    // what was already waiting before this segment arrived
+    qint64 waiting = qMax(m_buffer.size() - segment_len, (qint64)0);
+    if (waiting > segment_len * playlist_size)
     {
         LOG(VB_RECORD, LOG_WARNING, LOC +
             QString("streambuffer is not reading fast enough. "
@@ -964,13 +965,14 @@ int HLSReader::DownloadSegmentData(MythSingleDownload& downloader,
         {
             m_slow_cnt = 15;
             m_fatal = true;
+            m_buflock.unlock();
             return -1;
         }
     }
     else if (m_slow_cnt > 0)
         --m_slow_cnt;
 
-    if (m_buffer.size() >= segment_len * playlist_size * 2)
+    if (waiting >= segment_len * playlist_size * 2)
     {
         LOG(VB_RECORD, LOG_WARNING, LOC +
             QString("streambuffer is not reading fast enough. "
@@ -978,8 +980,6 @@ int HLSReader::DownloadSegmentData(MythSingleDownload& downloader,
             .arg(m_buffer.size()).arg(segment_len));
         m_buffer.remove(0, segment_len);
     }
-
-    m_buffer += buffer;
     m_buflock.unlock();
 
     if (hls->Bitrate() == 0 && segment.Duration() > 0)
@@ -989,25 +989,59 @@ int HLSReader::DownloadSegmentData(MythSingleDownload& downloader,
                                    ((double)segment.Duration())));
     }
 
-    if (downloadduration < 1)
-        downloadduration = 1;
-
     /* bits/sec */
-    bandwidth = segment_len * 8 * 1000ULL / downloadduration;
-    hls->AverageBandwidth(bandwidth);
-    hls->SetCurrentByteRate(static_cast<uint64_t>
-                            ((static_cast<double>(segment_len) /
-                              static_cast<double>(segment.Duration()))));
+    hls->AverageBandwidth(throughput);
+    if (segment.Duration() > 0)
+    {
+        hls->SetCurrentByteRate(static_cast<uint64_t>
+                                ((static_cast<double>(segment_len) /
+                                  static_cast<double>(segment.Duration()))));
+    }
+    m_throughput = m_throughput ? (m_throughput * 3 + throughput) / 4 :
+                                  throughput;
 
     LOG(VB_RECORD, (m_debug ? LOG_INFO : LOG_DEBUG), LOC +
         QString("%1 took %3ms for %4 bytes: "
                 "bandwidth:%5kiB/s")
         .arg(segment.Sequence())
-        .arg(downloadduration)
+        .arg(download_ms)
         .arg(segment_len)
-        .arg(bandwidth / 8192.0));
+        .arg(throughput / 8192.0));
+
+    m_seq_lock.lock();
+    while (!m_segments.empty() &&
+           m_segments.front().Sequence() <= segment.Sequence())
+        m_segments.pop_front();
+    m_cur_seq = segment.Sequence();
+    m_seq_lock.unlock();
+
+    int throttle = m_slow_cnt;
+    if (m_throttle && throttle == 0)
+        throttle = 2;
+    else if (throttle > 8)
+        throttle = 8;
+
+    if (m_prebuffer_cnt == 0)
+    {
+        m_bandwidthcheck = (m_bitrate_index == 0);
+        m_prebuffer_cnt = 2;
+    }
+    else
+        --m_prebuffer_cnt;
+
+    return throttle;
+}
 
-    return m_slow_cnt;
+/// Drops the segments the recording has fallen too far behind to need
+void HLSReader::SegmentFailed(void)
+{
+    QMutexLocker lock(&m_seq_lock);
+    if (m_segments.size() > m_playlist_size)
+    {
+        SegmentContainer::iterator Iseg = m_segments.begin() +
+                                          (m_segments.size() - m_playlist_size);
+        m_segments.erase(m_segments.begin(), Iseg);
+    }
 }
 
 void HLSReader::PlaylistGood(void)
@@ -7,13 +7,14 @@
 #include <QTextStream>
 
 /*
-  Use MythSingleDownload.
+  Use MythSingleDownload for the playlists.
 
   MythDownloadManager leaks memory and QNetworkAccessManager can only
   handle six simultaneous downloads.  Each HLS stream can be
   downloading the playlist and the segments at the same time, so the
   limit of six could impact performance if recording more than three
-  HLS channels.
+  HLS channels.  The segments are fetched by an HLSSegmentFetcher,
+  which has a QNetworkAccessManager of its own for each stream.
 */
 
 #ifdef HLS_USE_MYTHDOWNLOADMANAGER
@@ -31,10 +32,13 @@
 #include "HLSPlaylistWorker.h"
 
 
+class HLSSegmentFetcher;
+
 class MTV_PUBLIC  HLSReader
 {
     friend class HLSStreamWorker;
     friend class HLSPlaylistWorker;
+    friend class HLSSegmentFetcher;
 
   public:
     typedef QMap<QString, HLSRecStream* > StreamContainer;
@@ -70,7 +74,7 @@ class MTV_PUBLIC  HLSReader
 
   protected:
     void Cancel(bool quiet = false);
-    bool LoadSegments(MythSingleDownload& downloader);
+    bool LoadSegments(HLSSegmentFetcher& fetcher);
     uint PercentBuffered(void) const;
     int  TargetDuration(void) const
     { return (m_curstream ? m_curstream->TargetDuration() : 0); }
@@ -85,11 +89,22 @@ class MTV_PUBLIC  HLSReader
     bool ParseM3U8(const QByteArray & buffer, HLSRecStream* stream = NULL);
     void DecreaseBitrate(int progid);
     void IncreaseBitrate(int progid);
-
-    // Downloading
-    bool LoadSegments(HLSRecStream & hlsstream);
-    int DownloadSegmentData(MythSingleDownload& downloader, HLSRecStream* hls,
-			    HLSRecSegment& segment, int playlist_size);
+    void SelectBitrate(int progid, uint64_t throughput);
+
+    // Downloading, called by HLSSegmentFetcher
+    int  SegmentPrefetch(void) const { return m_prefetch; }
+    bool NextSegment(int64_t after, HLSRecSegment& segment,
+                     HLSRecStream*& hls);
+    void StreamSegmentData(int64_t sequence, qint64 offset,
+                           const char *data, qint64 len);
+    int  SegmentDownloaded(HLSRecStream* hls, const HLSRecSegment& segment,
+                           qint64 segment_len, qint64 download_ms,
+                           uint64_t throughput);
+    void SegmentFailed(void);
+#ifdef USING_LIBCRYPTO
+    bool DecodeSegment(MythSingleDownload& downloader, HLSRecStream* hls,
+                       const HLSRecSegment& segment, QByteArray& data);
+#endif
 
     // Debug
     void EnableDebugging(void);
@@ -122,7 +137,6 @@ class MTV_PUBLIC  HLSReader
     QMutex     m_seq_lock;
     mutable QMutex m_stream_lock;
     QMutex     m_throttle_lock;
-    QWaitCondition  m_throttle_cond;
     bool       m_debug;
     int        m_debug_cnt;
 
@@ -130,6 +144,10 @@ class MTV_PUBLIC  HLSReader
     int         m_slow_cnt;
     QByteArray  m_buffer;
     QMutex      m_buflock;
+    int         m_prefetch;        // segments downloaded at once
+    uint64_t    m_throughput;      // measured download rate (bits/second)
+    int64_t     m_streamed_seq;    // segment last passed to m_buffer
+    qint64      m_streamed_bytes;  // how much of it has been passed on
 };
 
 #endif
@@ -0,0 +1,344 @@
+#include <QNetworkRequest>
+#include <QEventLoop>
+
+#include "mythlogging.h"
+
+#include "HLSReader.h"
+#include "HLSSegmentFetcher.h"
+
+#define LOC QString("%1 fetcher: ").arg(m_parent->StreamURL().isEmpty() ? "Segment" : m_parent->StreamURL())
+
+/// How often stalls, throttling and cancelation are checked (ms)
+static const int kTickInterval = 250;
+
+HLSSegmentFetcher::HLSSegmentFetcher(HLSReader *parent)
+    : m_parent(parent), m_loop(NULL), m_last_seq(-1),
+      m_cancel(false), m_failed(false),
+      m_hold_ms(0), m_hold_throttled(false), m_busy_bytes(0)
+{
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(Tick()));
+}
+
+HLSSegmentFetcher::~HLSSegmentFetcher(void)
+{
+    AbortAll();
+}
+
+/**
+ * \brief Downloads the segments queued by the HLSReader
+ *
+ * Returns once they have all been passed on, or on failure.
+ */
+bool HLSSegmentFetcher::Run(void)
+{
+    m_cancel   = false;
+    m_failed   = false;
+    m_last_seq = -1;
+    m_hold_ms  = 0;
+
+    StartDownloads();
+    if (m_downloads.isEmpty())
+        return !m_failed;
+
+    QEventLoop loop;
+    m_loop = &loop;
+    m_timer.start(kTickInterval);
+
+    loop.exec();
+
+    m_timer.stop();
+    m_loop = NULL;
+    AbortAll();
+
+    return !m_failed;
+}
+
+/// Requests segments until the configured number are in flight
+void HLSSegmentFetcher::StartDownloads(void)
+{
+    if (m_hold_ms > 0 || m_failed)
+        return;
+
+    // One at a time while throttled, there is no hurry
+    int limit = m_parent->IsThrottled() ? 1 : m_parent->SegmentPrefetch();
+
+    while (m_downloads.size() < limit && !m_cancel)
+    {
+        Download *download = new Download;
+        if (!m_parent->NextSegment(m_last_seq, download->segment,
+                                   download->stream))
+        {
+            delete download;
+            break;
+        }
+        m_last_seq = download->segment.Sequence();
+#ifdef USING_LIBCRYPTO
+        download->whole = download->segment.HasKeyPath();
+#endif
+
+        if (m_downloads.isEmpty())
+        {
+            m_busy.start();
+            m_busy_bytes = 0;
+        }
+        m_downloads.append(download);
+
+        download->started.start();
+        Request(download, download->segment.Url());
+    }
+}
+
+void HLSSegmentFetcher::Request(Download *download, const QUrl &url)
+{
+    QNetworkRequest req(url);
+    req.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                     QNetworkRequest::AlwaysNetwork);
+
+    download->reply = m_mgr.get(req);
+    download->progress.start();
+
+    connect(download->reply, SIGNAL(readyRead()), this, SLOT(ReadyRead()));
+    connect(download->reply, SIGNAL(finished()),  this, SLOT(Finished()));
+}
+
+HLSSegmentFetcher::Download *HLSSegmentFetcher::FindDownload(
+    QObject *reply) const
+{
+    QList<Download*>::const_iterator it = m_downloads.begin();
+    for ( ; it != m_downloads.end(); ++it)
+    {
+        if ((*it)->reply == reply)
+            return *it;
+    }
+    return NULL;
+}
+
+void HLSSegmentFetcher::ReadyRead(void)
+{
+    Download *download = FindDownload(sender());
+    if (download)
+        ReadData(download);
+}
+
+/// Passes on or holds whatever has arrived for \p download
+void HLSSegmentFetcher::ReadData(Download *download)
+{
+    QNetworkReply *reply = download->reply;
+
+    // Leave the body of redirects and errors for Finished() to discard
+    QVariant status =
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    if (status.isValid() &&
+        (status.toInt() < 200 || status.toInt() >= 300))
+        return;
+
+    QByteArray data = reply->readAll();
+    if (data.isEmpty())
+        return;
+
+    download->progress.restart();
+    m_busy_bytes += data.size();
+
+    if (download == m_downloads.front() && !download->whole)
+    {
+        m_parent->StreamSegmentData(download->segment.Sequence(),
+                                    download->offset,
+                                    data.constData(), data.size());
+    }
+    else
+    {
+        download->held += data;
+    }
+    download->offset += data.size();
+}
+
+void HLSSegmentFetcher::Finished(void)
+{
+    Download *download = FindDownload(sender());
+    if (!download)
+        return;
+
+    QNetworkReply *reply = download->reply;
+    QUrl redirect =
+        reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        Fail(QString("%1 failed: %2")
+             .arg(download->segment.Sequence()).arg(reply->errorString()));
+        return;
+    }
+
+    if (!redirect.isEmpty())
+    {
+        if (++download->redirects > 3)
+        {
+            Fail(QString("%1: too many redirects")
+                 .arg(download->segment.Url().toString()));
+            return;
+        }
+        redirect = reply->url().resolved(redirect);
+        LOG(VB_RECORD, LOG_INFO, LOC + QString("%1 -> %2")
+            .arg(reply->url().toString()).arg(redirect.toString()));
+
+        download->reply = NULL;
+        reply->disconnect(this);
+        reply->deleteLater();
+        Request(download, redirect);
+        return;
+    }
+
+    ReadData(download);
+
+    download->finished = true;
+    download->reply = NULL;
+    reply->disconnect(this);
+    reply->deleteLater();
+
+    Advance();
+}
+
+/// Completes the finished segments at the front, then tops up the
+/// downloads in flight
+void HLSSegmentFetcher::Advance(void)
+{
+    while (!m_downloads.isEmpty() && m_downloads.front()->finished)
+    {
+        Download *download = m_downloads.takeFirst();
+        bool ok = Complete(download);
+        delete download;
+        if (!ok)
+        {
+            Fail("unable to keep up");
+            return;
+        }
+
+        // The next segment can now go straight to the reader
+        if (!m_downloads.isEmpty() && !m_downloads.front()->whole)
+        {
+            Download *next = m_downloads.front();
+            if (!next->held.isEmpty())
+            {
+                m_parent->StreamSegmentData(next->segment.Sequence(), 0,
+                                            next->held.constData(),
+                                            next->held.size());
+                next->held.clear();
+            }
+        }
+    }
+
+    StartDownloads();
+
+    if (m_downloads.isEmpty() && m_hold_ms == 0)
+        Quit();
+}
+
+bool HLSSegmentFetcher::Complete(Download *download)
+{
+#ifdef USING_LIBCRYPTO
+    if (download->whole)
+    {
+        if (m_parent->DecodeSegment(m_keys, download->stream,
+                                    download->segment, download->held))
+        {
+            m_parent->StreamSegmentData(download->segment.Sequence(), 0,
+                                        download->held.constData(),
+                                        download->held.size());
+        }
+    }
+#endif
+
+    // Throughput of all the downloads together, individual segments
+    // take longer when they share the connection.
+    qint64 elapsed = qMax(m_busy.elapsed(), (qint64)1);
+    uint64_t throughput = m_busy_bytes * 8 * 1000ULL / elapsed;
+    m_busy.restart();
+    m_busy_bytes = 0;
+
+    int throttle = m_parent->SegmentDownloaded(download->stream,
+                                               download->segment,
+                                               download->offset,
+                                               download->started.elapsed(),
+                                               throughput);
+    if (throttle < 0)
+        return false;
+
+    if (throttle > 0)
+    {
+        LOG(VB_RECORD, LOG_INFO, LOC +
+            QString("Throttling -- holding off for %1 secs.").arg(throttle));
+        m_hold_ms = throttle * 1000;
+        m_hold_throttled = m_parent->IsThrottled();
+        m_hold.start();
+    }
+
+    return true;
+}
+
+void HLSSegmentFetcher::Tick(void)
+{
+    if (m_cancel || m_parent->m_cancel)
+    {
+        if (!m_parent->m_cancel)
+            Fail("canceled");
+        else
+            Quit();
+        return;
+    }
+
+    // A stalled segment holds up everything after it, give up on it
+    // and start again rather than wait for the network to time out.
+    int stall_ms = qMin(qMax(m_parent->TargetDuration() * 2, 10), 30) * 1000;
+    QList<Download*>::const_iterator it = m_downloads.begin();
+    for ( ; it != m_downloads.end(); ++it)
+    {
+        if ((*it)->reply && (*it)->progress.elapsed() > stall_ms)
+        {
+            Fail(QString("%1 stalled for %2 secs")
+                 .arg((*it)->segment.Sequence()).arg(stall_ms / 1000));
+            return;
+        }
+    }
+
+    if (m_hold_ms > 0 &&
+        (m_hold.elapsed() >= m_hold_ms ||
+         (m_hold_throttled && !m_parent->IsThrottled())))
+    {
+        LOG(VB_RECORD, LOG_INFO, LOC + "Throttle done");
+        m_hold_ms = 0;
+        StartDownloads();
+    }
+
+    if (m_downloads.isEmpty() && m_hold_ms == 0)
+        Quit();
+}
+
+void HLSSegmentFetcher::Fail(const QString &reason)
+{
+    LOG(VB_RECORD, LOG_ERR, LOC + reason);
+    m_failed = true;
+    AbortAll();
+    m_parent->SegmentFailed();
+    Quit();
+}
+
+void HLSSegmentFetcher::AbortAll(void)
+{
+    while (!m_downloads.isEmpty())
+    {
+        Download *download = m_downloads.takeFirst();
+        if (download->reply)
+        {
+            download->reply->disconnect(this);
+            download->reply->abort();
+            download->reply->deleteLater();
+        }
+        delete download;
+    }
+}
+
+void HLSSegmentFetcher::Quit(void)
+{
+    if (m_loop)
+        m_loop->quit();
+}
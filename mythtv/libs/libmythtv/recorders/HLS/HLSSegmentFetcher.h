@@ -0,0 +1,100 @@
+#ifndef _HLS_Segment_Fetcher_h_
+#define _HLS_Segment_Fetcher_h_
+
+#include <stdint.h>
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QObject>
+#include <QTimer>
+#include <QList>
+
+#include "mythsingledownload.h"
+#include "HLSSegment.h"
+
+class QEventLoop;
+class HLSReader;
+class HLSRecStream;
+
+/** \class HLSSegmentFetcher
+ *  \brief Downloads the queued segments of an HLS recording, several at
+ *         a time.
+ *
+ *  All the requests go through one QNetworkAccessManager, which keeps
+ *  its HTTP connections alive from one segment to the next. The oldest
+ *  segment in flight is handed to the HLSReader as its data arrives,
+ *  the data of later ones is held until it is done so the transport
+ *  stream stays in order.
+ *
+ *  Run() must be called from the thread the fetcher was created in.
+ */
+class HLSSegmentFetcher : public QObject
+{
+    Q_OBJECT
+
+  public:
+    explicit HLSSegmentFetcher(HLSReader *parent);
+    ~HLSSegmentFetcher(void);
+
+    bool Run(void);
+    void Cancel(void) { m_cancel = true; }
+
+  private slots:
+    void ReadyRead(void);
+    void Finished(void);
+    void Tick(void);
+
+  private:
+    class Download
+    {
+      public:
+        Download(void) :
+            stream(NULL), reply(NULL), offset(0),
+            redirects(0), finished(false), whole(false) {}
+
+        HLSRecSegment  segment;
+        HLSRecStream  *stream;
+        QNetworkReply *reply;
+        QByteArray     held;      ///< data not yet passed to the reader
+        qint64         offset;    ///< bytes of the segment received so far
+        int            redirects;
+        bool           finished;
+        bool           whole;     ///< only usable once complete (encrypted)
+        QElapsedTimer  started;
+        QElapsedTimer  progress;  ///< time since data last arrived
+    };
+
+    void StartDownloads(void);
+    void Request(Download *download, const QUrl &url);
+    void ReadData(Download *download);
+    void Advance(void);
+    bool Complete(Download *download);
+    void Fail(const QString &reason);
+    void AbortAll(void);
+    void Quit(void);
+    Download *FindDownload(QObject *reply) const;
+
+    HLSReader            *m_parent;
+    QNetworkAccessManager m_mgr;
+    MythSingleDownload    m_keys;      ///< for AES keys
+    QList<Download*>      m_downloads; ///< in sequence order, oldest first
+    QEventLoop           *m_loop;
+    QTimer                m_timer;
+    int64_t               m_last_seq;  ///< last segment requested
+    volatile bool         m_cancel;
+    bool                  m_failed;
+
+    /// Don't request more segments until this has run for m_hold_ms
+    QElapsedTimer         m_hold;
+    qint64                m_hold_ms;
+    bool                  m_hold_throttled;
+
+    /// Bytes received by all the downloads since m_busy was started, it
+    /// only runs while something is downloading
+    QElapsedTimer         m_busy;
+    qint64                m_busy_bytes;
+};
+
+#endif
@@ -1,11 +1,12 @@
 #include "HLSReader.h"
 #include "HLSStreamWorker.h"
+#include "HLSSegmentFetcher.h"
 
 #define LOC QString("%1 worker: ").arg(m_parent->StreamURL().isEmpty() ? "Stream" : m_parent->StreamURL())
 
 HLSStreamWorker::HLSStreamWorker(HLSReader *parent)
     : MThread("HLSStream"),
-      m_parent(parent), m_downloader(NULL),
+      m_parent(parent), m_fetcher(NULL),
       m_cancel(false), m_wokenup(false)
 {
     LOG(VB_RECORD, LOG_DEBUG, LOC + "ctor");
@@ -28,9 +29,9 @@ void HLSStreamWorker::Cancel(void)
 
 void HLSStreamWorker::CancelCurrentDownload(void)
 {
-    QMutexLocker locker(&m_downloader_lock);
-    if (m_downloader)
-        m_downloader->Cancel();
+    QMutexLocker locker(&m_fetcher_lock);
+    if (m_fetcher)
+        m_fetcher->Cancel();
 }
 
 void HLSStreamWorker::run(void)
@@ -38,9 +39,10 @@ void HLSStreamWorker::run(void)
     LOG(VB_RECORD, LOG_INFO, LOC + "run -- begin");
     RunProlog();
 
-    m_downloader_lock.lock();
-    m_downloader = new MythSingleDownload;
-    m_downloader_lock.unlock();
+    // The fetcher's network replies belong to this thread
+    m_fetcher_lock.lock();
+    m_fetcher = new HLSSegmentFetcher(m_parent);
+    m_fetcher_lock.unlock();
 
     uint64_t delay;
     int retries = 0;
@@ -51,7 +53,7 @@ void HLSStreamWorker::run(void)
             LOG(VB_GENERAL, LOG_CRIT, LOC + "Fatal error detected");
             break;
         }
-        if (!m_parent->LoadSegments(*m_downloader))
+        if (!m_parent->LoadSegments(*m_fetcher))
         {
             LOG(VB_RECORD, LOG_WARNING, LOC +
                 QString("download failed, retry #%1").arg(++retries));
@@ -59,10 +61,10 @@ void HLSStreamWorker::run(void)
             // Asking QNetworkAccessManager to redownload after a
             // failure seems to result in another failure, even if the
             // segment is now available.  So, create a new instance.
-            m_downloader_lock.lock();
-            delete m_downloader;
-            m_downloader = new MythSingleDownload;
-            m_downloader_lock.unlock();
+            m_fetcher_lock.lock();
+            delete m_fetcher;
+            m_fetcher = new HLSSegmentFetcher(m_parent);
+            m_fetcher_lock.unlock();
 
             if (retries == 1)   // first error
                 continue;       // will retry immediately
@@ -94,9 +96,10 @@ void HLSStreamWorker::run(void)
         m_lock.unlock();
     }
 
-    m_downloader->Cancel();
-    delete m_downloader;
-    m_downloader = NULL;
+    m_fetcher_lock.lock();
+    delete m_fetcher;
+    m_fetcher = NULL;
+    m_fetcher_lock.unlock();
 
     LOG(VB_RECORD, LOG_INFO, LOC + "run -- end");
     RunEpilog();
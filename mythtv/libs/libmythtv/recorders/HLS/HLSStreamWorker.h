@@ -8,6 +8,7 @@
 #include "mthread.h"
 
 class HLSReader;
+class HLSSegmentFetcher;
 
 class HLSStreamWorker : public MThread
 {
@@ -27,11 +28,11 @@ class HLSStreamWorker : public MThread
 
     // Class vars
     HLSReader      *m_parent;
-    MythSingleDownload *m_downloader;
+    HLSSegmentFetcher *m_fetcher;
     bool            m_cancel;
     bool            m_wokenup;
     mutable QMutex  m_lock;
-    QMutex          m_downloader_lock;
+    QMutex          m_fetcher_lock;
     QWaitCondition  m_waitcond;
 };
 
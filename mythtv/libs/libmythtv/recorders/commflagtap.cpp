@@ -0,0 +1,650 @@
+/**
+ *  CommFlagTap -- commercial flagging while a recording is made
+ *  Distributed as part of MythTV under GPL v2 and later.
+ */
+
+#include <cmath>
+
+#include <algorithm>
+using namespace std;
+
+#include <QRunnable>
+
+#include "commflagtap.h"
+#include "mythcorecontext.h"
+#include "recordinginfo.h"
+#include "mthreadpool.h"
+#include "mythlogging.h"
+#include "tspacket.h"
+#include "jobqueue.h"
+
+#define LOC QString("CommFlagTap: ")
+
+/// About four seconds of video, at most, waits for the decoder
+const uint CommFlagTap::kMaxQueuedFrames = 120;
+const uint CommFlagTap::kMaxQueuedBytes  = 16 * 1024 * 1024;
+/// ms the decoder is given to catch up once the recording has stopped
+const uint CommFlagTap::kFinishTimeout   = 30000;
+
+/// Most blank frames added to the end of a break, as MAX_BLANK_FRAMES
+static const uint64_t kMaxBlankFrames = 60;
+
+/// Saves the breaks once the decoder has caught up, and owns the tap
+class CommFlagTapSaver : public QRunnable
+{
+  public:
+    CommFlagTapSaver(CommFlagTap *tap, const RecordingInfo &rec) :
+        m_tap(tap), m_rec(rec) {}
+    ~CommFlagTapSaver() { delete m_tap; }
+
+    virtual void run(void)
+    {
+        frm_dir_map_t breaks;
+        if (!m_tap->GetBreaks(breaks, CommFlagTap::kFinishTimeout))
+        {
+            LOG(VB_GENERAL, LOG_INFO, LOC +
+                QString("Queueing commercial flagging of %1")
+                .arg(m_rec.MakeUniqueKey()));
+            JobQueue::QueueRecordingJobs(m_rec, JOB_COMMFLAG);
+            return;
+        }
+
+        m_rec.SaveCommBreakList(breaks);
+        m_rec.SaveCommFlagged(COMM_FLAG_DONE);
+    }
+
+  private:
+    CommFlagTap   *m_tap;
+    RecordingInfo  m_rec;
+};
+
+CommFlagTap::CommFlagTap(AVCodecID codec) :
+    MThread("CommFlagTap"),
+    m_codecId(codec),
+    m_haveCurrent(false),           m_firstFrame(-1),
+    m_fps(0.0),
+    m_queuedBytes(0),               m_dropping(false),
+    m_finishing(false),             m_abort(false),
+    m_framesSeen(0),                m_framesAnalysed(0),
+    m_framesDropped(0),
+    m_lag(0.0),                     m_maxLag(0.0),
+    m_context(NULL),                m_parser(NULL),
+    m_frame(NULL),                  m_lastFrameNumber(0),
+    m_framesDecoded(0),             m_decodeErrors(0)
+{
+    m_maxDiff =
+        gCoreContext->GetNumSetting("CommDetectBlankFrameMaxDiff", 25);
+    m_darkBrightness =
+        gCoreContext->GetNumSetting("CommDetectDarkBrightness", 80);
+    m_dimBrightness =
+        gCoreContext->GetNumSetting("CommDetectDimBrightness", 120);
+    m_minBreakLength =
+        gCoreContext->GetNumSetting("CommDetectMinCommBreakLength", 60);
+
+    m_clock.start();
+    start();
+}
+
+CommFlagTap::~CommFlagTap()
+{
+    {
+        QMutexLocker locker(&m_lock);
+        m_abort = true;
+        m_finishing = true;
+        m_wait.wakeAll();
+    }
+    wait();
+}
+
+/**
+ * \brief Marks the start of a frame in the next packet handed over.
+ *
+ * The previous frame is queued for the decoder, or dropped if the
+ * decoder is too far behind. Nothing is queued until the first keyframe.
+ */
+void CommFlagTap::FrameStart(uint64_t frameNumber, bool keyframe)
+{
+    if (m_firstFrame < 0)
+        m_firstFrame = frameNumber;
+
+    if (m_haveCurrent)
+        Enqueue();
+    else if (!keyframe)
+        return;
+
+    m_current = Chunk();
+    m_current.frameNumber = frameNumber;
+    m_current.keyframe    = keyframe;
+    m_haveCurrent = true;
+}
+
+/// Adds the payload of a video packet, less any PES header, to the frame
+void CommFlagTap::AddPacket(const TSPacket &tspacket)
+{
+    if (!m_haveCurrent || !tspacket.HasPayload())
+        return;
+
+    const uint8_t *data = tspacket.data() + tspacket.AFCOffset();
+    const uint8_t *end  = tspacket.data() + TSPacket::kSize;
+
+    if (tspacket.PayloadStart())
+    {
+        if ((end - data < 9) || data[0] || data[1] || (data[2] != 0x01))
+            return;
+        data += 9 + data[8];
+    }
+
+    if (data < end)
+        m_current.data.append((const char*)data, end - data);
+}
+
+void CommFlagTap::Enqueue(void)
+{
+    QMutexLocker locker(&m_lock);
+
+    m_framesSeen++;
+
+    if (m_dropping && !m_current.keyframe)
+    {
+        m_framesDropped++;
+        return;
+    }
+
+    if (((uint)m_queue.size() >= kMaxQueuedFrames) ||
+        (m_queuedBytes + m_current.data.size() > kMaxQueuedBytes))
+    {
+        if (!m_dropping)
+        {
+            LOG(VB_COMMFLAG, LOG_WARNING, LOC +
+                QString("Analysis is %1 frames behind, dropping frames "
+                        "up to the next keyframe").arg(m_queue.size()));
+        }
+        m_dropping = true;
+        m_framesDropped++;
+        return;
+    }
+
+    m_current.resync = m_dropping;
+    m_current.queued = m_clock.elapsed();
+    m_dropping = false;
+
+    m_queuedBytes += m_current.data.size();
+    m_queue.append(m_current);
+    m_wait.wakeAll();
+}
+
+/**
+ * \brief Tells the decoder there are no more frames to come.
+ *
+ * This doesn't wait for the decoder, the breaks are found later on by
+ * GetBreaks(), normally from SaveInBackground().
+ *
+ * \return false if the recording still needs to be flagged, because the
+ *         tap didn't see it from the first frame or too many frames were
+ *         dropped.
+ */
+bool CommFlagTap::Finish(double fps)
+{
+    if (m_haveCurrent)
+    {
+        Enqueue();
+        m_haveCurrent = false;
+    }
+
+    m_fps = (fps > 0.0) ? fps : 29.97;
+
+    QMutexLocker locker(&m_lock);
+
+    // No point going on if it is going to be flagged again anyway
+    if (m_firstFrame != 0)
+    {
+        LOG(VB_GENERAL, LOG_WARNING, LOC +
+            QString("Started %1 frames into the recording, leaving it to "
+                    "the commercial flagging job").arg(m_firstFrame));
+        m_abort = true;
+    }
+    else if (m_framesDropped > m_framesSeen / 50)
+    {
+        LOG(VB_GENERAL, LOG_WARNING, LOC +
+            QString("Dropped %1 of %2 frames, leaving it to the "
+                    "commercial flagging job")
+            .arg(m_framesDropped).arg(m_framesSeen));
+        m_abort = true;
+    }
+
+    m_finishing = true;
+    m_wait.wakeAll();
+
+    return !m_abort;
+}
+
+/**
+ * \brief Waits up to \p timeout ms for the decoder to catch up after
+ *        Finish(), then finds the commercial breaks.
+ *
+ * \return false if the recording still needs to be flagged, because the
+ *         decoder fell too far behind or could not decode the video.
+ */
+bool CommFlagTap::GetBreaks(frm_dir_map_t &breaks, uint timeout)
+{
+    if (!wait(timeout))
+    {
+        QMutexLocker locker(&m_lock);
+        LOG(VB_GENERAL, LOG_WARNING, LOC +
+            QString("Gave up on %1 frames still to analyse")
+            .arg(m_queue.size()));
+        m_abort = true;
+        locker.unlock();
+        wait();
+    }
+
+    uint64_t seen = GetFramesSeen();
+
+    LOG(VB_COMMFLAG, LOG_INFO, LOC +
+        QString("Analysed %1 of %2 frames, %3 dropped, %4 decoded "
+                "with %5 errors, %6 blank, at most %7 s behind live")
+        .arg(GetFramesAnalysed()).arg(seen).arg(GetFramesDropped())
+        .arg(m_framesDecoded).arg(m_decodeErrors)
+        .arg(m_blankFrames.size()).arg(GetMaxLag(), 0, 'f', 2));
+
+    if (m_abort || !seen || (m_framesDecoded < seen / 2))
+    {
+        LOG(VB_GENERAL, LOG_WARNING, LOC + "Unable to keep up with the "
+            "recording, leaving it to the commercial flagging job");
+        return false;
+    }
+
+    breaks = FindBreaks(m_blankFrames, m_fps, m_minBreakLength);
+
+    LOG(VB_COMMFLAG, LOG_INFO, LOC +
+        QString("Found %1 commercial breaks").arg(breaks.size() / 2));
+
+    return true;
+}
+
+/**
+ * \brief Saves the breaks \p tap finds to \p rec once its decoder has
+ *        caught up, or queues the commercial flagging job if it can't.
+ *
+ * This takes over \p tap, which must have been Finish()ed.
+ */
+void CommFlagTap::SaveInBackground(CommFlagTap *tap, const RecordingInfo &rec)
+{
+    MThreadPool::globalInstance()->start(
+        new CommFlagTapSaver(tap, rec), "CommFlagTapSave");
+}
+
+uint64_t CommFlagTap::GetFramesSeen(void) const
+{
+    QMutexLocker locker(&m_lock);
+    return m_framesSeen;
+}
+
+uint64_t CommFlagTap::GetFramesAnalysed(void) const
+{
+    QMutexLocker locker(&m_lock);
+    return m_framesAnalysed;
+}
+
+uint64_t CommFlagTap::GetFramesDropped(void) const
+{
+    QMutexLocker locker(&m_lock);
+    return m_framesDropped;
+}
+
+double CommFlagTap::GetLag(void) const
+{
+    QMutexLocker locker(&m_lock);
+    return m_lag;
+}
+
+double CommFlagTap::GetMaxLag(void) const
+{
+    QMutexLocker locker(&m_lock);
+    return m_maxLag;
+}
+
+void CommFlagTap::run(void)
+{
+    RunProlog();
+
+    bool ok = OpenDecoder();
+
+    QElapsedTimer reported;
+    reported.start();
+
+    while (!m_abort)
+    {
+        Chunk chunk;
+        {
+            QMutexLocker locker(&m_lock);
+            while (m_queue.isEmpty() && !m_finishing)
+                m_wait.wait(&m_lock);
+            if (m_queue.isEmpty() || m_abort)
+                break;
+            chunk = m_queue.takeFirst();
+            m_queuedBytes -= chunk.data.size();
+        }
+
+        if (ok)
+            Decode(chunk);
+
+        QMutexLocker locker(&m_lock);
+        m_framesAnalysed++;
+        m_lag = (m_clock.elapsed() - chunk.queued) / 1000.0;
+        m_maxLag = max(m_maxLag, m_lag);
+
+        if (reported.elapsed() >= 60000)
+        {
+            LOG(VB_COMMFLAG, LOG_INFO, LOC +
+                QString("Analysis is %1 s behind live, %2 frames waiting, "
+                        "%3 dropped")
+                .arg(m_lag, 0, 'f', 2).arg(m_queue.size())
+                .arg(m_framesDropped));
+            reported.restart();
+        }
+    }
+
+    if (ok && !m_abort)
+    {
+        // Whatever the parser and decoder are still holding on to
+        uint8_t *data = NULL;
+        int size = 0;
+        av_parser_parse2(m_parser, m_context, &data, &size, NULL, 0,
+                         AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+        if (size > 0)
+            DecodePacket(data, size, m_parser->pts);
+        while (DecodePacket(NULL, 0, AV_NOPTS_VALUE))
+            ;
+    }
+
+    CloseDecoder();
+
+    RunEpilog();
+}
+
+bool CommFlagTap::OpenDecoder(void)
+{
+    AVCodec *codec = avcodec_find_decoder(m_codecId);
+    m_parser = av_parser_init(m_codecId);
+    if (!codec || !m_parser)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + QString("Unable to decode %1 video")
+            .arg(avcodec_get_name(m_codecId)));
+        return false;
+    }
+
+    m_context = avcodec_alloc_context3(codec);
+    m_frame = av_frame_alloc();
+    if (!m_context || !m_frame)
+        return false;
+
+    // Only the brightness is looked at, the pictures needn't be pretty
+    m_context->skip_loop_filter = AVDISCARD_ALL;
+    m_context->flags2 |= AV_CODEC_FLAG2_FAST;
+    m_context->thread_count = 1;
+
+    QMutexLocker locker(avcodeclock);
+    if (avcodec_open2(m_context, codec, NULL) < 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + QString("Unable to open %1 decoder")
+            .arg(avcodec_get_name(m_codecId)));
+        return false;
+    }
+
+    return true;
+}
+
+void CommFlagTap::CloseDecoder(void)
+{
+    if (m_parser)
+    {
+        av_parser_close(m_parser);
+        m_parser = NULL;
+    }
+
+    if (m_context)
+    {
+        QMutexLocker locker(avcodeclock);
+        avcodec_free_context(&m_context);
+    }
+
+    av_frame_free(&m_frame);
+}
+
+/**
+ * The frame number of each chunk is passed through the parser and the
+ * decoder as its timestamp, so the pictures that come out can be matched
+ * to the recorder's frame numbers despite any reordering.
+ */
+void CommFlagTap::Decode(const Chunk &chunk)
+{
+    if (chunk.resync)
+    {
+        // Frames before this keyframe were dropped, start again from it
+        avcodec_flush_buffers(m_context);
+        av_parser_close(m_parser);
+        m_parser = av_parser_init(m_codecId);
+    }
+
+    const uint8_t *data = (const uint8_t*)chunk.data.constData();
+    int size = chunk.data.size();
+
+    while (size > 0)
+    {
+        uint8_t *pkt = NULL;
+        int pktsize = 0;
+        int used = av_parser_parse2(m_parser, m_context, &pkt, &pktsize,
+                                    data, size, chunk.frameNumber,
+                                    chunk.frameNumber, 0);
+        if ((used < 0) || (!used && !pktsize))
+            break;
+
+        data += used;
+        size -= used;
+
+        if (pktsize > 0)
+            DecodePacket(pkt, pktsize, m_parser->pts);
+    }
+}
+
+/// \return true if a picture was decoded
+bool CommFlagTap::DecodePacket(uint8_t *data, int size, int64_t pts)
+{
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    pkt.data = data;
+    pkt.size = size;
+    pkt.pts  = pts;
+    pkt.dts  = pts;
+
+    int gotPicture = 0;
+    if (avcodec_decode_video2(m_context, m_frame, &gotPicture, &pkt) < 0)
+    {
+        m_decodeErrors++;
+        return false;
+    }
+
+    if (gotPicture)
+        Analyse(m_frame);
+
+    return gotPicture;
+}
+
+void CommFlagTap::Analyse(AVFrame *frame)
+{
+    uint64_t frameNumber = (frame->pkt_pts == AV_NOPTS_VALUE) ?
+        m_lastFrameNumber + 1 : (uint64_t)frame->pkt_pts;
+    m_lastFrameNumber = frameNumber;
+    m_framesDecoded++;
+
+    // All of these start with a full size 8 bit luma plane
+    switch (frame->format)
+    {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUV444P:
+        case AV_PIX_FMT_YUVJ444P:
+        case AV_PIX_FMT_NV12:
+            break;
+        default:
+            return;
+    }
+
+    if (IsBlank(frame->data[0], frame->width, frame->height,
+                frame->linesize[0], m_maxDiff, m_darkBrightness,
+                m_dimBrightness))
+    {
+        m_blankFrames.append(frameNumber);
+    }
+}
+
+/**
+ * \brief Whether a picture is blank, by the same tests ClassicCommDetector
+ *        uses when it isn't being aggressive.
+ *
+ * Every fourth pixel of every fourth line is looked at, leaving out a
+ * twentieth of the picture at each edge.
+ */
+bool CommFlagTap::IsBlank(const uint8_t *luma, int width, int height,
+                          int stride, int maxDiff, int darkBrightness,
+                          int dimBrightness)
+{
+    int xborder = width / 20;
+    int yborder = height / 20;
+
+    int minimum = 255, maximum = 0;
+    int64_t total = 0;
+    int count = 0;
+
+    for (int y = yborder; y < height - yborder; y += 4)
+    {
+        const uint8_t *row = luma + y * stride;
+        for (int x = xborder; x < width - xborder; x += 4)
+        {
+            int value = row[x];
+            minimum = min(minimum, value);
+            maximum = max(maximum, value);
+            total += value;
+            count++;
+        }
+    }
+
+    if (!count)
+        return false;
+
+    int average = total / count;
+
+    if ((maximum - minimum) <= maxDiff)
+        return true;
+
+    if (maximum < darkBrightness)
+        return true;
+
+    return (maximum < dimBrightness) && (average < minimum + 10);
+}
+
+/**
+ * \brief Finds the commercial breaks from the blank frames, as
+ *        ClassicCommDetector::BuildBlankFrameCommList() does.
+ *
+ * A commercial runs from one group of blank frames to another a usual
+ * spot length later. Commercials that follow on from each other make up
+ * a break, which is kept if it is at least \p minBreakLength seconds.
+ */
+frm_dir_map_t CommFlagTap::FindBreaks(const QList<uint64_t> &blankFrames,
+                                      double fps, int minBreakLength)
+{
+    // Spot lengths in seconds, and how many frames out they may be
+    static const int kSpots[][2] =
+    {
+        {   5, 11 }, {  10, 13 }, {  15, 16 }, {  20, 17 }, {  30, 18 },
+        {  40,  3 }, {  45,  3 }, {  60, 20 }, {  90, 20 }, { 120, 20 },
+    };
+    static const int kSpotCount = sizeof(kSpots) / sizeof(kSpots[0]);
+
+    frm_dir_map_t breaks;
+
+    QList<uint64_t> frames = blankFrames;
+    qSort(frames);
+
+    // Group consecutive blank frames
+    QList<uint64_t> runStart, runEnd;
+    for (int i = 0; i < frames.size(); ++i)
+    {
+        if (!runEnd.isEmpty() && (frames[i] <= runEnd.last() + 1))
+            runEnd.last() = max(runEnd.last(), frames[i]);
+        else
+        {
+            runStart.append(frames[i]);
+            runEnd.append(frames[i]);
+        }
+    }
+
+    // Find the commercials, each ends where the next group begins
+    QList<int> commStart, commEnd;
+    const double longest = kSpots[kSpotCount - 1][0] * fps + 20;
+    int i = 0;
+    while (i < runStart.size())
+    {
+        int match = -1;
+        for (int x = i + 1; (x < runStart.size()) && (match < 0); ++x)
+        {
+            double gap = runStart[x] - runStart[i];
+            if (gap > longest)
+                break;
+            for (int s = 0; s < kSpotCount; ++s)
+            {
+                if (fabs(gap - kSpots[s][0] * fps) < kSpots[s][1])
+                {
+                    match = x;
+                    break;
+                }
+            }
+        }
+
+        if (match < 0)
+        {
+            ++i;
+            continue;
+        }
+
+        commStart.append(i);
+        commEnd.append(match);
+        i = match;
+    }
+
+    // Join up the commercials into breaks
+    const double shortest = minBreakLength * fps;
+    for (int c = 0; c < commStart.size(); )
+    {
+        int last = c;
+        while ((last + 1 < commStart.size()) &&
+               (commStart[last + 1] == commEnd[last]))
+        {
+            ++last;
+        }
+
+        uint64_t start = runStart[commStart[c]];
+        // End half way into the blank frames after the last commercial
+        int closing = commEnd[last];
+        uint64_t end = runStart[closing] - 1 +
+            min((runEnd[closing] - runStart[closing] + 1) / 2,
+                kMaxBlankFrames);
+
+        if (end - start + 1 >= shortest)
+        {
+            // A break right at the start runs from the start
+            if (breaks.isEmpty() && (start < 30 * fps))
+                start = 0;
+            breaks[start] = MARK_COMM_START;
+            breaks[end]   = MARK_COMM_END;
+        }
+
+        c = last + 1;
+    }
+
+    return breaks;
+}
@@ -0,0 +1,143 @@
+// -*- Mode: c++ -*-
+/**
+ *  CommFlagTap -- commercial flagging while a recording is made
+ *  Distributed as part of MythTV under GPL v2 and later.
+ */
+
+#ifndef COMMFLAGTAP_H
+#define COMMFLAGTAP_H
+
+#include <stdint.h>
+
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QMutex>
+#include <QList>
+
+#include "programtypes.h"
+#include "mythtvexp.h"
+#include "mthread.h"
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+class RecordingInfo;
+class TSPacket;
+
+/** \class CommFlagTap
+ *  \brief Flags the commercials in a recording as it is made, so the
+ *         breaks are ready as soon as the recording ends.
+ *
+ *  DTVRecorder hands over the packets of the video stream it writes,
+ *  and marks each frame start found by FindMPEG2Keyframes() or
+ *  FindH264Keyframes(). The frames are decoded and checked for blank
+ *  frames on a thread of their own, and the breaks are found from the
+ *  blank frames as ClassicCommDetector's blank frame method does.
+ *
+ *  Only a few seconds of frames are ever held for the decoder. When it
+ *  falls further behind, frames are dropped up to the next keyframe
+ *  rather than holding up the recorder, and if too many are lost the
+ *  recording is left for the commercial flagging job.
+ *
+ *  Once the recording stops, SaveInBackground() takes over the tap so
+ *  the decoder can catch up and the breaks be saved without holding up
+ *  the next recording on the tuner.
+ */
+class MTV_PUBLIC CommFlagTap : protected MThread
+{
+  public:
+    explicit CommFlagTap(AVCodecID codec);
+    ~CommFlagTap();
+
+    // These are called by the recorder and never wait on the decoder
+    void FrameStart(uint64_t frameNumber, bool keyframe);
+    void AddPacket(const TSPacket &tspacket);
+
+    bool Finish(double fps);
+    bool GetBreaks(frm_dir_map_t &breaks, uint timeout);
+
+    static void SaveInBackground(CommFlagTap *tap, const RecordingInfo &rec);
+
+    uint64_t GetFramesSeen(void)     const;
+    uint64_t GetFramesAnalysed(void) const;
+    uint64_t GetFramesDropped(void)  const;
+    /// Seconds the last frame analysed waited to be, behind live
+    double   GetLag(void)            const;
+    double   GetMaxLag(void)         const;
+    /// Only valid once GetBreaks() has returned
+    uint64_t GetBlankFrames(void)    const { return m_blankFrames.size(); }
+
+    static bool IsBlank(const uint8_t *luma, int width, int height,
+                        int stride, int maxDiff, int darkBrightness,
+                        int dimBrightness);
+    static frm_dir_map_t FindBreaks(const QList<uint64_t> &blankFrames,
+                                    double fps, int minBreakLength);
+
+    static const uint kMaxQueuedFrames;
+    static const uint kMaxQueuedBytes;
+    static const uint kFinishTimeout;
+
+  protected:
+    virtual void run(void); // MThread
+
+  private:
+    class Chunk
+    {
+      public:
+        Chunk(void) :
+            frameNumber(0), keyframe(false), resync(false), queued(0) {}
+
+        uint64_t   frameNumber;
+        bool       keyframe;
+        bool       resync;     ///< frames before it were dropped
+        QByteArray data;       ///< video elementary stream
+        qint64     queued;     ///< ms on m_clock when handed over
+    };
+
+    void Enqueue(void);
+    bool OpenDecoder(void);
+    void CloseDecoder(void);
+    void Decode(const Chunk &chunk);
+    bool DecodePacket(uint8_t *data, int size, int64_t pts);
+    void Analyse(AVFrame *frame);
+
+    AVCodecID              m_codecId;
+
+    // Recorder thread only
+    Chunk                  m_current;
+    bool                   m_haveCurrent;
+    int64_t                m_firstFrame;
+    double                 m_fps;
+
+    mutable QMutex         m_lock;
+    QWaitCondition         m_wait;
+    QList<Chunk>           m_queue;
+    uint                   m_queuedBytes;
+    bool                   m_dropping;  ///< until the next keyframe
+    volatile bool          m_finishing;
+    volatile bool          m_abort;
+    uint64_t               m_framesSeen;
+    uint64_t               m_framesAnalysed;
+    uint64_t               m_framesDropped;
+    double                 m_lag;
+    double                 m_maxLag;
+    QElapsedTimer          m_clock;
+
+    // Decoder thread only
+    AVCodecContext        *m_context;
+    AVCodecParserContext  *m_parser;
+    AVFrame               *m_frame;
+    uint64_t               m_lastFrameNumber;
+    uint64_t               m_framesDecoded;
+    uint64_t               m_decodeErrors;
+    QList<uint64_t>        m_blankFrames;
+
+    int                    m_maxDiff;
+    int                    m_darkBrightness;
+    int                    m_dimBrightness;
+    int                    m_minBreakLength;
+};
+
+#endif // COMMFLAGTAP_H
@@ -28,6 +28,8 @@
 #include "ringbuffer.h"
 #include "tv_rec.h"
 #include "mythsystemevent.h"
+#include "mythmetrics.h"
+#include "commflagtap.h"
 
 extern "C" {
 #include "libavcodec/mpegvideo.h"
@@ -64,6 +66,11 @@ DTVRecorder::DTVRecorder(TVRec *rec) :
     // H.264 support
     _pes_synced(false),
     _seen_sps(false),
+    // commercial flagging while recording
+    _commflag_option(false),
+    _commflag_tap(NULL),
+    _commflag_pid(0),
+    _commflag_done(false),
     // settings
     _wait_for_keyframe_option(true),
     _has_written_other_keyframe(false),
@@ -111,6 +118,9 @@ DTVRecorder::~DTVRecorder(void)
 
     SetStreamData(NULL);
 
+    delete _commflag_tap;
+    _commflag_tap = NULL;
+
     if (_input_pat)
     {
         delete _input_pat;
@@ -144,6 +154,8 @@ void DTVRecorder::SetOption(const QString &name, int value)
         _wait_for_keyframe_option = (value == 1);
     else if (name == "recordmpts")
         _record_mpts = (value == 1);
+    else if (name == "commflagtap")
+        _commflag_option = (value == 1);
     else
         RecorderBase::SetOption(name, value);
 }
@@ -173,9 +185,30 @@ void DTVRecorder::FinishRecording(void)
         SetTotalFrames(_frames_written_count);
     }
 
+    if (_commflag_tap)
+        _commflag_done = _commflag_tap->Finish(GetFrameRate());
+
     RecorderBase::FinishRecording();
 }
 
+/**
+ *  \brief Hands over the commercial flagging of the recording once it
+ *         has finished, if it was flagged from start to end.
+ *
+ *  The caller owns the CommFlagTap returned, NULL if the recording
+ *  still needs to be flagged.
+ */
+CommFlagTap *DTVRecorder::TakeCommFlagTap(void)
+{
+    if (!_commflag_done)
+        return NULL;
+
+    CommFlagTap *tap = _commflag_tap;
+    _commflag_tap = NULL;
+    _commflag_done = false;
+    return tap;
+}
+
 void DTVRecorder::ResetForNewFile(void)
 {
     LOG(VB_RECORD, LOG_INFO, LOC + "ResetForNewFile(void)");
@@ -577,7 +610,11 @@ bool DTVRecorder::FindMPEG2Keyframes(const TSPacket* tspacket)
         _buffer_packets = false;  // We now know if it is a keyframe, or not
         _frames_seen_count++;
         if (!_wait_for_keyframe_option || _first_keyframe >= 0)
+        {
+            if (_commflag_tap)
+                _commflag_tap->FrameStart(_frames_written_count, hasKeyFrame);
             UpdateFramesWritten();
+        }
         else
         {
             /* Found a frame that is not a keyframe, and we want to
@@ -988,7 +1025,11 @@ bool DTVRecorder::FindH264Keyframes(const TSPacket *tspacket)
         _buffer_packets = false;  // We now know if this is a keyframe
         _frames_seen_count++;
         if (!_wait_for_keyframe_option || _first_keyframe >= 0)
+        {
+            if (_commflag_tap)
+                _commflag_tap->FrameStart(_frames_written_count, hasKeyFrame);
             UpdateFramesWritten();
+        }
         else
         {
             /* Found a frame that is not a keyframe, and we want to
@@ -1445,6 +1486,14 @@ void DTVRecorder::HandleSingleProgramPMT(ProgramMapTable *pmt, bool insert)
         DTVRecorder::BufferedWrite(_scratch[i], insert);
 }
 
+static MythCounter *continuity_errors(void)
+{
+    static MythCounter *counter = MythMetrics::Counter(
+        "mythtv_recorder_continuity_errors_total",
+        "MPEG-TS continuity counter errors seen by all recorders");
+    return counter;
+}
+
 bool DTVRecorder::ProcessTSPacket(const TSPacket &tspacket)
 {
     const uint pid = tspacket.PID();
@@ -1457,6 +1506,7 @@ bool DTVRecorder::ProcessTSPacket(const TSPacket &tspacket)
     if ((pid != 0x1fff) && !CheckCC(pid, tspacket.ContinuityCounter()))
     {
         int v = _continuity_error_count.fetchAndAddRelaxed(1) + 1;
+        continuity_errors()->Add();
         double erate = v * 100.0 / _packet_count.fetchAndAddRelaxed(0);
         LOG(VB_RECORD, LOG_WARNING, LOC +
             QString("PID 0x%1 discontinuity detected ((%2+1)%16!=%3) %4%")
@@ -1496,6 +1546,15 @@ bool DTVRecorder::ProcessVideoTSPacket(const TSPacket &tspacket)
 
     uint streamType = _stream_id[tspacket.PID()];
 
+    // Start before the first frame, so it sees the whole recording
+    if (_commflag_option && !_commflag_tap &&
+        (m_primaryVideoCodec != AV_CODEC_ID_NONE))
+    {
+        LOG(VB_RECORD, LOG_INFO, LOC + "Flagging commercials while recording");
+        _commflag_pid = tspacket.PID();
+        _commflag_tap = new CommFlagTap(m_primaryVideoCodec);
+    }
+
     if (tspacket.HasPayload() && tspacket.PayloadStart())
     {
         if (_buffer_packets && _first_keyframe >= 0 && !_payload_buffer.empty())
@@ -1519,6 +1578,9 @@ bool DTVRecorder::ProcessVideoTSPacket(const TSPacket &tspacket)
         LOG(VB_RECORD, LOG_ERR, LOC +
             "ProcessVideoTSPacket: unknown stream type!");
 
+    if (_commflag_tap && (tspacket.PID() == _commflag_pid))
+        _commflag_tap->AddPacket(tspacket);
+
     return ProcessAVTSPacket(tspacket);
 }
 
@@ -1566,6 +1628,7 @@ bool DTVRecorder::ProcessAVTSPacket(const TSPacket &tspacket)
     if ((pid != 0x1fff) && !CheckCC(pid, tspacket.ContinuityCounter()))
     {
         int v = _continuity_error_count.fetchAndAddRelaxed(1) + 1;
+        continuity_errors()->Add();
         double erate = v * 100.0 / _packet_count.fetchAndAddRelaxed(0);
         LOG(VB_RECORD, LOG_WARNING, LOC +
             QString("A/V PID 0x%1 discontinuity detected ((%2+1)%16!=%3) %4%")
@@ -21,11 +21,12 @@ using namespace std;
 #include "H264Parser.h"
 
 class MPEGStreamData;
+class CommFlagTap;
 class TSPacket;
 class QTime;
 class StreamID;
 
-class DTVRecorder :
+class MTV_PUBLIC DTVRecorder :
     public RecorderBase,
     public MPEGStreamListener,
     public MPEGSingleProgramStreamListener,
@@ -60,6 +61,8 @@ class DTVRecorder :
     virtual void ClearStatistics(void);
     virtual RecordingQuality *GetRecordingQuality(const RecordingInfo*) const;
 
+    CommFlagTap *TakeCommFlagTap(void);
+
     // MPEG Stream Listener
     void HandlePAT(const ProgramAssociationTable*);
     void HandleCAT(const ConditionalAccessTable*) {}
@@ -149,6 +152,12 @@ class DTVRecorder :
     bool _seen_sps;
     H264Parser m_h264_parser;
 
+    // commercial flagging while recording
+    bool         _commflag_option;
+    CommFlagTap *_commflag_tap;
+    uint         _commflag_pid;
+    bool         _commflag_done;
+
     /// Wait for the a GOP/SEQ-start before sending data
     bool _wait_for_keyframe_option;
 
@@ -19,6 +19,7 @@
 #include "dvbtypes.h" // for pid filtering
 #include "diseqc.h" // for rotor retune
 #include "mythlogging.h"
+#include "mythtrace.h"
 
 #define LOC      QString("DVBSH(%1): ").arg(_device)
 
@@ -261,11 +262,14 @@ void DVBStreamHandler::RunTS(void)
             continue;
         }
 
-        StreamDataList::const_iterator sit = _stream_data_list.begin();
-        for (; sit != _stream_data_list.end(); ++sit)
-            remainder = sit.key()->ProcessData(buffer, len);
+        {
+            MYTH_TRACE_SPAN(kTraceStream, "DVB process data");
+            StreamDataList::const_iterator sit = _stream_data_list.begin();
+            for (; sit != _stream_data_list.end(); ++sit)
+                remainder = sit.key()->ProcessData(buffer, len);
 
-        WriteMPTS(buffer, len - remainder);
+            WriteMPTS(buffer, len - remainder);
+        }
 
         _listener_lock.unlock();
 
@@ -16,6 +16,7 @@
 #include "mpegstreamdata.h"
 #include "cardutil.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
 
 #define LOC      QString("HDHRSH(%1): ").arg(_device)
 
@@ -174,11 +175,14 @@ void HDHRStreamHandler::run(void)
             continue;
         }
 
-        StreamDataList::const_iterator sit = _stream_data_list.begin();
-        for (; sit != _stream_data_list.end(); ++sit)
-            remainder = sit.key()->ProcessData(data_buffer, data_length);
+        {
+            MYTH_TRACE_SPAN(kTraceStream, "HDHR process data");
+            StreamDataList::const_iterator sit = _stream_data_list.begin();
+            for (; sit != _stream_data_list.end(); ++sit)
+                remainder = sit.key()->ProcessData(data_buffer, data_length);
 
-        WriteMPTS(data_buffer, data_length - remainder);
+            WriteMPTS(data_buffer, data_length - remainder);
+        }
 
         _listener_lock.unlock();
         if (remainder != 0)
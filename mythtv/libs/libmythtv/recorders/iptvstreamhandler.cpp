@@ -19,11 +19,13 @@
 #include "iptvstreamhandler.h"
 #include "rtppacketbuffer.h"
 #include "udppacketbuffer.h"
+#include "udppacketreceiver.h"
 #include "rtptsdatapacket.h"
 #include "rtpdatapacket.h"
 #include "rtpfecpacket.h"
 #include "rtcpdatapacket.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
 #include "cetonrtsp.h"
 
 #define LOC QString("IPTVSH(%1): ").arg(_device)
@@ -115,6 +117,7 @@ IPTVStreamHandler::IPTVStreamHandler(const IPTVTuningData &tuning) :
 {
     memset(m_sockets, 0, sizeof(m_sockets));
     memset(m_read_helpers, 0, sizeof(m_read_helpers));
+    memset(m_receivers, 0, sizeof(m_receivers));
     m_use_rtp_streaming = m_tuning.IsRTP();
 }
 
@@ -223,8 +226,10 @@ void IPTVStreamHandler::run(void)
             // the requested server
             m_sender[i] = dest_addr;
         }
+#if !HAVE_RECVMMSG
         m_read_helpers[i] = new IPTVStreamHandlerReadHelper(
             this, m_sockets[i], i);
+#endif
 
         // we need to open the descriptor ourselves so we
         // can set some socket options
@@ -284,6 +289,21 @@ void IPTVStreamHandler::run(void)
             m_buffer = new RTPPacketBuffer(tuning.GetBitrate(0));
         else
             m_buffer = new UDPPacketBuffer(tuning.GetBitrate(0));
+
+#if HAVE_RECVMMSG
+        // Read each socket on its own thread, in batches, rather than
+        // one datagram per readyRead() in this thread's event loop
+        for (uint i = 0; i < IPTV_SOCKET_COUNT; i++)
+        {
+            if (!m_sockets[i] || m_sockets[i]->socketDescriptor() < 0)
+                continue;
+            m_receivers[i] = new UDPPacketReceiver(
+                _device, m_buffer, m_sockets[i]->socketDescriptor(),
+                i, m_sender[i]);
+            m_receivers[i]->start();
+        }
+#endif
+
         m_write_helper =
             new IPTVStreamHandlerWriteHelper(this);
         m_write_helper->Start();
@@ -313,7 +333,14 @@ void IPTVStreamHandler::run(void)
         exec();
     }
 
-    // Clean up
+    // Clean up, the receivers first as they use the sockets and buffer
+#if HAVE_RECVMMSG
+    for (uint i = 0; i < IPTV_SOCKET_COUNT; i++)
+    {
+        delete m_receivers[i];
+        m_receivers[i] = NULL;
+    }
+#endif
     for (uint i = 0; i < IPTV_SOCKET_COUNT; i++)
     {
         if (m_sockets[i])
@@ -446,6 +473,7 @@ void IPTVStreamHandlerWriteHelper::timerEvent(QTimerEvent* event)
 
         int remainder = 0;
         {
+            MYTH_TRACE_SPAN(kTraceStream, "IPTV process data");
             QMutexLocker locker(&m_parent->_listener_lock);
             QByteArray &data = packet.GetDataReference();
             IPTVStreamHandler::StreamDataList::const_iterator sit;
@@ -505,6 +533,7 @@ void IPTVStreamHandlerWriteHelper::timerEvent(QTimerEvent* event)
                 QString("Processing RTP packet(seq:%1 ts:%2)")
                 .arg(m_last_sequence_number).arg(m_last_timestamp));
 
+            MYTH_TRACE_SPAN(kTraceStream, "RTP process data");
             m_parent->_listener_lock.lock();
 
             int remainder = 0;
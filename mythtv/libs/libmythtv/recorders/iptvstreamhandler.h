@@ -26,6 +26,7 @@ class DTVSignalMonitor;
 class MPEGStreamData;
 class PacketBuffer;
 class IPTVChannel;
+class UDPPacketReceiver;
 
 class IPTVStreamHandlerReadHelper : QObject
 {
@@ -99,6 +100,8 @@ class IPTVStreamHandler : public StreamHandler
     IPTVTuningData m_tuning;
     QUdpSocket *m_sockets[IPTV_SOCKET_COUNT];
     IPTVStreamHandlerReadHelper *m_read_helpers[IPTV_SOCKET_COUNT];
+    /// Used instead of the read helpers where recvmmsg() is available
+    UDPPacketReceiver *m_receivers[IPTV_SOCKET_COUNT];
     QHostAddress m_sender[IPTV_SOCKET_COUNT];
     IPTVStreamHandlerWriteHelper *m_write_helper;
     PacketBuffer *m_buffer;
@@ -11,9 +11,14 @@
 #include "packetbuffer.h"
 #include "compat.h" // for random on windows
 
+/// Number of packets allocated up front, enough for a few hundred
+/// milliseconds of a typical multicast channel
+static const uint kArenaPacketCount = 512;
+
 PacketBuffer::PacketBuffer(unsigned int bitrate) :
     m_bitrate(bitrate),
-    m_next_empty_packet_key(0ULL)
+    m_next_empty_packet_key(0ULL),
+    m_available_head(0)
 {
     while (!m_next_empty_packet_key)
     {
@@ -21,41 +26,72 @@ PacketBuffer::PacketBuffer(unsigned int bitrate) :
             (random() << 24) ^ (random() << 16) ^
             (random() << 8) ^ random();
     }
+
+    // Preallocate the packet arena so the receive path doesn't have to
+    // go to the allocator until the stream outruns it.
+    m_empty_packets.reserve(kArenaPacketCount * 2);
+    m_available_packets.reserve(kArenaPacketCount * 2);
+    for (uint i = 0; i < kArenaPacketCount; i++)
+    {
+        UDPPacket packet(m_next_empty_packet_key++);
+        packet.GetDataReference().reserve(kArenaPacketSize);
+        m_empty_packets.push_back(packet);
+    }
 }
 
 bool PacketBuffer::HasAvailablePacket(void) const
 {
-    return !m_available_packets.empty();
+    QMutexLocker locker(&m_lock);
+    return m_available_head < m_available_packets.size();
 }
 
 UDPPacket PacketBuffer::PopDataPacket(void)
 {
-    if (m_available_packets.empty())
+    QMutexLocker locker(&m_lock);
+
+    if (m_available_head >= m_available_packets.size())
         return UDPPacket(0);
 
-    UDPPacket packet(m_available_packets.front());
-    m_available_packets.pop_front();
+    UDPPacket packet(m_available_packets[m_available_head]);
+
+    // drop our reference so the data isn't shared when it is reused
+    m_available_packets[m_available_head++] = UDPPacket(0);
+
+    if (m_available_head >= m_available_packets.size())
+    {
+        m_available_packets.clear();
+        m_available_head = 0;
+    }
 
     return packet;
 }
 
 UDPPacket PacketBuffer::GetEmptyPacket(void)
 {
-    QMap<uint64_t, UDPPacket>::iterator it = m_empty_packets.begin();
-    if (it == m_empty_packets.end())
+    QMutexLocker locker(&m_lock);
+
+    if (m_empty_packets.empty())
     {
-        return UDPPacket(m_next_empty_packet_key++);
+        UDPPacket packet(m_next_empty_packet_key++);
+        packet.GetDataReference().reserve(kArenaPacketSize);
+        return packet;
     }
 
-    UDPPacket packet(*it);
-    m_empty_packets.erase(it);
+    UDPPacket packet(m_empty_packets.back());
+    m_empty_packets.pop_back();
 
     return packet;
 }
 
 void PacketBuffer::FreePacket(const UDPPacket &packet)
+{
+    QMutexLocker locker(&m_lock);
+    FreePacketLocked(packet);
+}
+
+void PacketBuffer::FreePacketLocked(const UDPPacket &packet)
 {
     uint64_t top = packet.GetKey() & (0xFFFFFFFFULL<<32);
     if (top == (m_next_empty_packet_key & (0xFFFFFFFFULL<<32)))
-        m_empty_packets[packet.GetKey()] = packet;
+        m_empty_packets.push_back(packet);
 }
@@ -7,12 +7,20 @@
 #ifndef _PACKET_BUFFER_H_
 #define _PACKET_BUFFER_H_
 
-#include <QList>
-#include <QMap>
+#include <vector>
+using namespace std;
 
+#include <QMutex>
+
+#include "mythtvexp.h"
 #include "udppacket.h"
 
-class PacketBuffer
+/** \brief Hands out reusable UDPPackets and queues them once filled.
+ *
+ *  Packets are pushed by the socket receive thread and popped by the
+ *  stream handler, so all the public methods are thread safe.
+ */
+class MTV_PUBLIC PacketBuffer
 {
   public:
     PacketBuffer(unsigned int bitrate);
@@ -40,17 +48,33 @@ class PacketBuffer
      */
     void FreePacket(const UDPPacket &);
 
+    /// Size the packets in the preallocated arena are reserved at
+    static const int kArenaPacketSize = 2048;
+
   protected:
+    /// FreePacket() for use by subclasses which already hold m_lock
+    void FreePacketLocked(const UDPPacket &);
+
+    /// Queues a packet for PopDataPacket(), m_lock must be held
+    void AddAvailablePacket(const UDPPacket &packet)
+    {
+        m_available_packets.push_back(packet);
+    }
+
+    mutable QMutex m_lock;
+
     uint m_bitrate;
 
     /// Packets key to use for next empty packet
     uint64_t m_next_empty_packet_key;
     
-    /// Packets ready for reuse
-    QMap<uint64_t, UDPPacket> m_empty_packets;
+    /// Packets ready for reuse, used as a stack so the most recently
+    /// freed (and most likely cached) buffer is handed out first
+    vector<UDPPacket> m_empty_packets;
 
-    /// Ordered list of available packets
-    QList<UDPPacket> m_available_packets;
+    /// Ordered list of available packets, consumed from m_available_head
+    vector<UDPPacket> m_available_packets;
+    size_t m_available_head;
 };
 
 #endif // _PACKET_BUFFER_H_
@@ -11,11 +11,45 @@ using namespace std;
 #include "rtpdatapacket.h"
 #include "rtpfecpacket.h"
 
+RTPPacketBuffer::RTPPacketBuffer(unsigned int bitrate) :
+    PacketBuffer(bitrate),
+    m_large_sequence_number_seen_recently(0),
+    m_current_sequence(0ULL),
+    m_ring(kRingSize),
+    m_ring_used(kRingSize, false),
+    m_ring_started(false),
+    m_ring_head(0ULL),
+    m_ring_count(0)
+{
+}
+
+/// Moves the packet at the head of the ring, if any, onto the ordered
+/// list and advances the head. m_lock must be held.
+void RTPPacketBuffer::ReleaseRingHead(void)
+{
+    uint slot = m_ring_head & (kRingSize - 1);
+    if (m_ring_used[slot])
+    {
+/*
+        LOG(VB_RECORD, LOG_DEBUG, QString("Popping %1 as %2")
+            .arg(m_ring[slot].GetSequenceNumber()).arg(m_ring_head));
+*/
+        AddAvailablePacket(m_ring[slot]);
+        // drop our reference so the data isn't shared when it is reused
+        m_ring[slot] = RTPDataPacket();
+        m_ring_used[slot] = false;
+        m_ring_count--;
+    }
+    m_ring_head++;
+}
+
 void RTPPacketBuffer::PushDataPacket(const UDPPacket &udp_packet)
 {
     RTPDataPacket packet(udp_packet);
 
-    uint key = packet.GetSequenceNumber();
+    uint64_t key = packet.GetSequenceNumber();
+
+    QMutexLocker locker(&m_lock);
 
     bool large_was_seen_recently = m_large_sequence_number_seen_recently > 0;
     m_large_sequence_number_seen_recently = 
@@ -41,25 +75,59 @@ void RTPPacketBuffer::PushDataPacket(const UDPPacket &udp_packet)
         .arg(m_large_sequence_number_seen_recently));
 */
 
-    m_unordered_packets[key] = packet;
+    if (!m_ring_started)
+    {
+        // Leave room for packets sent before this one to arrive after it
+        const uint64_t kSlack = kRingSize / 4;
+        m_ring_head = (key > kSlack) ? key - kSlack : 0ULL;
+        m_ring_started = true;
+    }
 
-    // TODO pushing packets onto the ordered list should be based on
-    // the bitrate and the M+N of the FEC.. but for now...
-    const int kHighWaterMark = 500;
-    const int kLowWaterMark  = 100;
-    if (m_unordered_packets.size() > kHighWaterMark)
+    if (key < m_ring_head)
     {
-        while (m_unordered_packets.size() > kLowWaterMark)
+        if (m_ring_head - key < kRingSize)
         {
-            QMap<uint64_t, RTPDataPacket>::iterator it =
-                m_unordered_packets.begin();
-/*
-            LOG(VB_RECORD, LOG_DEBUG, QString("Popping %1 as %2")
-                .arg((*it).GetSequenceNumber()).arg(it.key()));
-*/
-            m_available_packets.push_back(*it);
-            m_unordered_packets.erase(it);
+            // Too late to reorder, its neighbours have already gone
+            AddAvailablePacket(packet);
+            return;
         }
+
+        // The sequence jumped backwards, e.g. the sender restarted
+        while (m_ring_count)
+            ReleaseRingHead();
+        m_ring_head = key;
+    }
+    else if (key - m_ring_head >= kRingSize)
+    {
+        // Make room by releasing the oldest packets, if the jump is
+        // further than the ring just start again from this packet.
+        uint64_t new_head = key - kRingSize + 1;
+        while (m_ring_count && m_ring_head < new_head)
+            ReleaseRingHead();
+        m_ring_head = max(m_ring_head, new_head);
+    }
+
+    uint slot = key & (kRingSize - 1);
+    if (m_ring_used[slot])
+    {
+        // duplicate, keep the newest copy
+        FreePacketLocked(m_ring[slot]);
+    }
+    else
+    {
+        m_ring_used[slot] = true;
+        m_ring_count++;
+    }
+    m_ring[slot] = packet;
+
+    // TODO pushing packets onto the ordered list should be based on
+    // the bitrate and the M+N of the FEC.. but for now...
+    const uint kHighWaterMark = 500;
+    const uint kLowWaterMark  = 100;
+    if (m_ring_count > kHighWaterMark)
+    {
+        while (m_ring_count > kLowWaterMark)
+            ReleaseRingHead();
     }
 }
 
@@ -7,20 +7,16 @@
 #ifndef _RTP_PACKET_BUFFER_H_
 #define _RTP_PACKET_BUFFER_H_
 
-#include <QMap>
+#include <vector>
+using namespace std;
 
 #include "rtpdatapacket.h"
 #include "packetbuffer.h"
 
-class RTPPacketBuffer : public PacketBuffer
+class MTV_PUBLIC RTPPacketBuffer : public PacketBuffer
 {
   public:
-    RTPPacketBuffer(unsigned int bitrate) :
-        PacketBuffer(bitrate),
-        m_large_sequence_number_seen_recently(0),
-        m_current_sequence(0ULL)
-    {
-    }
+    RTPPacketBuffer(unsigned int bitrate);
 
     /// Adds RFC 3550 RTP data packet
     virtual void PushDataPacket(const UDPPacket&);
@@ -28,12 +24,23 @@ class RTPPacketBuffer : public PacketBuffer
     /// Adds SMPTE 2022 Forward Error Correction Stream packet
     virtual void PushFECPacket(const UDPPacket&, unsigned int fec_stream_num);
 
+    /// Number of packets the reordering ring can hold, a power of two
+    static const uint kRingSize = 2048;
+
   private:
+    void ReleaseRingHead(void);
+
     int m_large_sequence_number_seen_recently;
     uint64_t m_current_sequence;
 
-    /// The key is the RTP sequence number + sequence if applicable
-    QMap<uint64_t, RTPDataPacket> m_unordered_packets;
+    /// Unordered packets, indexed by the extended sequence number
+    /// (the RTP sequence number + sequence if applicable) modulo kRingSize
+    vector<RTPDataPacket> m_ring;
+    vector<bool>          m_ring_used;
+    bool                  m_ring_started;
+    /// Extended sequence number of the oldest slot not yet released
+    uint64_t              m_ring_head;
+    uint                  m_ring_count;
 };
 
 #endif // _RTP_PACKET_BUFFER_H_
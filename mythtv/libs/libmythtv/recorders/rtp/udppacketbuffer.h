@@ -17,7 +17,8 @@ class UDPPacketBuffer : public PacketBuffer
     /// Adds Raw UDP data packet
     virtual void PushDataPacket(const UDPPacket &packet)
     {
-        m_available_packets.push_back(packet);
+        QMutexLocker locker(&m_lock);
+        AddAvailablePacket(packet);
     }
 
     /// Frees the packet, there is no FEC used by Raw UDP
@@ -0,0 +1,170 @@
+/* -*- Mode: c++ -*-
+ * UDPPacketReceiver
+ * Distributed as part of MythTV under GPL v2 and later.
+ */
+
+#include "udppacketreceiver.h"
+
+#if HAVE_RECVMMSG
+
+// POSIX headers
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+
+// C++ headers
+#include <vector>
+using namespace std;
+
+// MythTV headers
+#include "packetbuffer.h"
+#include "mythlogging.h"
+
+#define LOC QString("UDPRecv(%1:%2): ").arg(m_device).arg(m_stream)
+
+/// Most datagrams read per recvmmsg() call
+static const uint kBatchSize = 64;
+
+/// Largest possible UDP payload, used once a datagram is truncated
+static const int kMaxDatagramSize = 65536;
+
+UDPPacketReceiver::UDPPacketReceiver(
+    const QString &device, PacketBuffer *buffer, int fd,
+    uint stream, const QHostAddress &sender) :
+    MThread("UDPPacketReceiver"),
+    m_device(device), m_buffer(buffer), m_fd(fd),
+    m_stream(stream), m_sender(sender),
+    m_max_size(PacketBuffer::kArenaPacketSize),
+    m_stop(false), m_datagrams(0), m_calls(0)
+{
+}
+
+UDPPacketReceiver::~UDPPacketReceiver()
+{
+    Stop();
+}
+
+void UDPPacketReceiver::Stop(void)
+{
+    m_stop = true;
+    wait();
+}
+
+void UDPPacketReceiver::run(void)
+{
+    RunProlog();
+
+    LOG(VB_RECORD, LOG_INFO, LOC + "run() -- begin");
+
+    vector<UDPPacket>        packets(kBatchSize);
+    vector<struct mmsghdr>   msgs(kBatchSize);
+    vector<struct iovec>     iovs(kBatchSize);
+    vector<sockaddr_storage> addrs(kBatchSize);
+
+    for (uint i = 0; i < kBatchSize; i++)
+        packets[i] = m_buffer->GetEmptyPacket();
+
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+
+    bool sender_null = m_sender.isNull();
+
+    while (!m_stop)
+    {
+        // wake up regularly so Stop() doesn't have to wait on the sender
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, 100);
+        if (ret < 0 && errno != EINTR)
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC + "poll() failed" + ENO);
+            break;
+        }
+        if (ret <= 0)
+            continue;
+
+        for (uint i = 0; i < kBatchSize; i++)
+        {
+            // within the reserved capacity, so this doesn't allocate
+            QByteArray &data = packets[i].GetDataReference();
+            data.resize(m_max_size);
+
+            iovs[i].iov_base = data.data();
+            iovs[i].iov_len  = data.size();
+
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name    = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov     = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen  = 1;
+        }
+
+        int count = recvmmsg(m_fd, &msgs[0], kBatchSize, MSG_DONTWAIT, NULL);
+        if (count < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                continue;
+            LOG(VB_GENERAL, LOG_ERR, LOC + "recvmmsg() failed" + ENO);
+            break;
+        }
+        m_calls++;
+
+        for (int i = 0; i < count; i++)
+        {
+            QByteArray &data = packets[i].GetDataReference();
+
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                if (m_max_size < kMaxDatagramSize)
+                {
+                    LOG(VB_GENERAL, LOG_WARNING, LOC +
+                        QString("Datagram larger than %1 bytes dropped, "
+                                "increasing the read size to %2")
+                        .arg(m_max_size).arg(kMaxDatagramSize));
+                    m_max_size = kMaxDatagramSize;
+                }
+                continue;
+            }
+
+            data.resize(msgs[i].msg_len);
+
+            if (!sender_null)
+            {
+                QHostAddress sender(
+                    reinterpret_cast<sockaddr*>(&addrs[i]));
+                if (sender != m_sender)
+                {
+                    LOG(VB_RECORD, LOG_WARNING, LOC +
+                        QString("Received %1 bytes from non expected "
+                                "sender:%2 (expected:%3) ignoring")
+                        .arg(data.size()).arg(sender.toString())
+                        .arg(m_sender.toString()));
+                    continue;
+                }
+            }
+
+            if (0 == m_stream)
+                m_buffer->PushDataPacket(packets[i]);
+            else
+                m_buffer->PushFECPacket(packets[i], m_stream - 1);
+
+            // the buffer has the packet now, take a fresh one for the slot
+            packets[i] = m_buffer->GetEmptyPacket();
+            m_datagrams++;
+        }
+    }
+
+    for (uint i = 0; i < kBatchSize; i++)
+        m_buffer->FreePacket(packets[i]);
+
+    LOG(VB_RECORD, LOG_INFO, LOC +
+        QString("run() -- end, %1 datagrams in %2 calls (%3 per call)")
+        .arg(m_datagrams).arg(m_calls)
+        .arg(m_calls ? (double)m_datagrams / m_calls : 0.0, 0, 'f', 1));
+
+    RunEpilog();
+}
+
+#endif // HAVE_RECVMMSG
@@ -0,0 +1,59 @@
+/* -*- Mode: c++ -*-
+ * UDPPacketReceiver
+ * Distributed as part of MythTV under GPL v2 and later.
+ */
+
+#ifndef _UDP_PACKET_RECEIVER_H_
+#define _UDP_PACKET_RECEIVER_H_
+
+#include "mythconfig.h"
+
+#if HAVE_RECVMMSG
+
+#include <QHostAddress>
+#include <QString>
+
+#include "mythtvexp.h"
+#include "mthread.h"
+
+class PacketBuffer;
+
+/** \class UDPPacketReceiver
+ *  \brief Reads datagrams from a bound UDP socket on its own thread,
+ *         many per system call, straight into a PacketBuffer.
+ *
+ *  The socket is owned by the caller and must outlive the thread,
+ *  call Stop() before closing it.
+ */
+class MTV_PUBLIC UDPPacketReceiver : public MThread
+{
+  public:
+    /// \param stream  0 for the data stream, otherwise FEC stream + 1
+    /// \param sender  if not null datagrams from anyone else are dropped
+    UDPPacketReceiver(const QString &device, PacketBuffer *buffer, int fd,
+                      uint stream, const QHostAddress &sender);
+    ~UDPPacketReceiver();
+
+    void Stop(void);
+
+    uint64_t GetDatagramCount(void) const { return m_datagrams; }
+    uint64_t GetCallCount(void)     const { return m_calls;     }
+
+  protected:
+    virtual void run(void); // MThread
+
+  private:
+    QString         m_device;
+    PacketBuffer   *m_buffer;
+    int             m_fd;
+    uint            m_stream;
+    QHostAddress    m_sender;
+    int             m_max_size;
+    volatile bool   m_stop;
+    uint64_t        m_datagrams;
+    uint64_t        m_calls;
+};
+
+#endif // HAVE_RECVMMSG
+
+#endif // _UDP_PACKET_RECEIVER_H_
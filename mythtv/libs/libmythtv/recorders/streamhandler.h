@@ -52,7 +52,7 @@ typedef QMap<uint,PIDInfo*> PIDInfoMap;
 // _add_rm_lock -> _listener_lock
 //              -> _start_stop_lock
 
-class StreamHandler : protected MThread, public DeviceReaderCB
+class MTV_PUBLIC StreamHandler : protected MThread, public DeviceReaderCB
 {
   public:
     virtual void AddListener(MPEGStreamData *data,
@@ -0,0 +1,3 @@
+#include "test_commflagtap.h"
+
+QTEST_APPLESS_MAIN(TestCommFlagTap)
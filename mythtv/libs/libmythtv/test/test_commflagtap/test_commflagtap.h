@@ -0,0 +1,134 @@
+/*
+ *  Class TestCommFlagTap
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QByteArray>
+
+#include "recorders/commflagtap.h"
+
+class TestCommFlagTap: public QObject
+{
+    Q_OBJECT
+
+  private:
+    static const int kWidth  = 64;
+    static const int kHeight = 48;
+
+    static bool IsBlank(const QByteArray &picture)
+    {
+        return CommFlagTap::IsBlank(
+            (const uint8_t*)picture.constData(), kWidth, kHeight, kWidth,
+            25, 80, 120);
+    }
+
+    /// Adds \p count blank frames from \p frame
+    static void AddBlanks(QList<uint64_t> &blanks, uint64_t frame,
+                          int count = 3)
+    {
+        for (int i = 0; i < count; i++)
+            blanks.append(frame + i);
+    }
+
+  private slots:
+    void BlankFrames(void)
+    {
+        QByteArray picture(kWidth * kHeight, 16);
+        QVERIFY(IsBlank(picture));
+
+        // A dim speck doesn't stop it being blank, a bright one does
+        picture[10 * kWidth + 11] = 100;
+        QVERIFY(IsBlank(picture));
+        picture[10 * kWidth + 11] = (char)200;
+        QVERIFY(!IsBlank(picture));
+
+        for (int y = 0; y < kHeight; y++)
+            for (int x = 0; x < kWidth; x++)
+                picture[y * kWidth + x] = 16 + x * 3;
+        QVERIFY(!IsBlank(picture));
+
+        // The edges are left out
+        picture.fill(16);
+        for (int x = 0; x < kWidth; x++)
+            picture[x] = (char)235;
+        QVERIFY(IsBlank(picture));
+    }
+
+    /**
+     * Four 30 second spots five minutes in make one break, which ends
+     * half way into the blank frames after the last spot.
+     */
+    void Break(void)
+    {
+        QList<uint64_t> blanks;
+        AddBlanks(blanks, 3000);
+        for (int i = 0; i < 5; i++)
+            AddBlanks(blanks, 7500 + i * 750);
+
+        frm_dir_map_t breaks = CommFlagTap::FindBreaks(blanks, 25.0, 60);
+        QCOMPARE(breaks.size(), 2);
+        QCOMPARE(breaks.value(7500), MARK_COMM_START);
+        QCOMPARE(breaks.value(10500), MARK_COMM_END);
+    }
+
+    void BreakOrder(void)
+    {
+        // Frames come out of the decoder in presentation order
+        QList<uint64_t> blanks;
+        for (int i = 4; i >= 0; i--)
+            AddBlanks(blanks, 7500 + i * 750);
+        blanks.swap(0, 1);
+
+        frm_dir_map_t breaks = CommFlagTap::FindBreaks(blanks, 25.0, 60);
+        QCOMPARE(breaks.size(), 2);
+        QVERIFY(breaks.contains(7500));
+    }
+
+    void ShortBreak(void)
+    {
+        QList<uint64_t> blanks;
+        AddBlanks(blanks, 7500);
+        AddBlanks(blanks, 8250);
+
+        QVERIFY(CommFlagTap::FindBreaks(blanks, 25.0, 60).isEmpty());
+        QCOMPARE(CommFlagTap::FindBreaks(blanks, 25.0, 30).size(), 2);
+    }
+
+    void BreakAtStart(void)
+    {
+        QList<uint64_t> blanks;
+        AddBlanks(blanks, 250, 1);
+        AddBlanks(blanks, 1000, 1);
+        AddBlanks(blanks, 1750, 1);
+
+        frm_dir_map_t breaks = CommFlagTap::FindBreaks(blanks, 25.0, 60);
+        QCOMPARE(breaks.size(), 2);
+        QCOMPARE(breaks.value(0), MARK_COMM_START);
+        QCOMPARE(breaks.value(1749), MARK_COMM_END);
+    }
+
+    void NoSpots(void)
+    {
+        QList<uint64_t> blanks;
+        AddBlanks(blanks, 1000);
+        AddBlanks(blanks, 1000 + 25 * 37);
+        AddBlanks(blanks, 9000);
+
+        QVERIFY(CommFlagTap::FindBreaks(blanks, 25.0, 0).isEmpty());
+        QVERIFY(CommFlagTap::FindBreaks(QList<uint64_t>(), 25.0, 0).isEmpty());
+    }
+};
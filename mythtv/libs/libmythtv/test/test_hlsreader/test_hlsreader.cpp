@@ -0,0 +1,10 @@
+#include "test_hlsreader.h"
+
+// The reader's downloads need an event loop, so unlike the other tests
+// this one has an application object.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    TestHLSReader test;
+    return QTest::qExec(&test, argc, argv);
+}
@@ -0,0 +1,233 @@
+/*
+ *  Class TestHLSReader
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHash>
+#include <QSet>
+
+#include "HLSReader.h"
+#include "mythcorecontext.h"
+#include "mythdb.h"
+
+/// Number of segments in the generated playlist
+static const int kSegments = 8;
+/// Transport stream packets in each segment
+static const int kSegmentPackets = 400;
+/// Segment whose response is held back, so later ones finish first
+static const int kSlowSegment = 1;
+
+/// The transport stream packets of segment \p seq, each one numbered so
+/// the order they come out of the reader in can be checked
+static QByteArray MakeSegment(int seq)
+{
+    QByteArray data(kSegmentPackets * 188, (char)seq);
+    for (int i = 0; i < kSegmentPackets; i++)
+    {
+        char *packet = data.data() + i * 188;
+        packet[0] = 0x47;
+        packet[1] = seq;
+        packet[2] = (i >> 8) & 0xFF;
+        packet[3] = i & 0xFF;
+    }
+    return data;
+}
+
+/** \class HLSTestServer
+ *  \brief A minimal keep-alive HTTP server serving a VOD playlist of
+ *         generated segments.
+ *
+ *  It records which connections the segments were requested over, so
+ *  the test can check how many were used at once and that they were
+ *  reused.
+ */
+class HLSTestServer : public QTcpServer
+{
+    Q_OBJECT
+
+  public:
+    HLSTestServer(void) : m_segmentRequests(0)
+    {
+        connect(this, SIGNAL(newConnection()), SLOT(NewConnection()));
+    }
+
+    QString PlaylistURL(void) const
+    {
+        return QString("http://127.0.0.1:%1/index.m3u8").arg(serverPort());
+    }
+
+    int SegmentConnections(void) const { return m_segmentSockets.size(); }
+    int SegmentRequests(void) const { return m_segmentRequests; }
+
+  private slots:
+    void NewConnection(void)
+    {
+        while (hasPendingConnections())
+        {
+            QTcpSocket *socket = nextPendingConnection();
+            connect(socket, SIGNAL(readyRead()), SLOT(ReadRequest()));
+            connect(socket, SIGNAL(disconnected()),
+                    socket, SLOT(deleteLater()));
+        }
+    }
+
+    void ReadRequest(void)
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+        if (!socket)
+            return;
+
+        QByteArray &pending = m_requests[socket];
+        pending += socket->readAll();
+
+        int end;
+        while ((end = pending.indexOf("\r\n\r\n")) >= 0)
+        {
+            QByteArray request = pending.left(end);
+            pending.remove(0, end + 4);
+
+            QList<QByteArray> words = request.left(request.indexOf("\r\n"))
+                                      .split(' ');
+            Respond(socket, words.size() > 1 ? words[1] : QByteArray());
+        }
+    }
+
+    void SendSlowSegment(void)
+    {
+        if (m_slowSocket)
+            Send(m_slowSocket, MakeSegment(kSlowSegment));
+    }
+
+  private:
+    void Respond(QTcpSocket *socket, const QByteArray &path)
+    {
+        if (path == "/index.m3u8")
+        {
+            QByteArray playlist("#EXTM3U\n"
+                                "#EXT-X-VERSION:3\n"
+                                "#EXT-X-TARGETDURATION:2\n"
+                                "#EXT-X-MEDIA-SEQUENCE:0\n");
+            for (int seq = 0; seq < kSegments; seq++)
+                playlist += QString("#EXTINF:2.0,\nseg%1.ts\n")
+                            .arg(seq).toLatin1();
+            playlist += "#EXT-X-ENDLIST\n";
+            Send(socket, playlist);
+            return;
+        }
+
+        int seq = -1;
+        if (path.startsWith("/seg") && path.endsWith(".ts"))
+            seq = path.mid(4, path.size() - 7).toInt();
+        if (seq < 0 || seq >= kSegments)
+        {
+            socket->write("HTTP/1.1 404 Not Found\r\n"
+                          "Content-Length: 0\r\n\r\n");
+            return;
+        }
+
+        m_segmentSockets.insert(socket);
+        m_segmentRequests++;
+
+        if (seq == kSlowSegment)
+        {
+            m_slowSocket = socket;
+            QTimer::singleShot(300, this, SLOT(SendSlowSegment()));
+            return;
+        }
+        Send(socket, MakeSegment(seq));
+    }
+
+    static void Send(QTcpSocket *socket, const QByteArray &body)
+    {
+        socket->write(QString("HTTP/1.1 200 OK\r\n"
+                              "Content-Length: %1\r\n"
+                              "Connection: keep-alive\r\n\r\n")
+                      .arg(body.size()).toLatin1());
+        socket->write(body);
+    }
+
+    QHash<QTcpSocket*, QByteArray> m_requests;
+    QSet<QTcpSocket*>              m_segmentSockets;
+    QPointer<QTcpSocket>           m_slowSocket;
+    int                            m_segmentRequests;
+};
+
+class TestHLSReader: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase(void)
+    {
+        gCoreContext = new MythCoreContext("bin_version", NULL);
+        // HLSPrefetchSegments comes from its default of 3
+        gCoreContext->GetDB()->IgnoreDatabase(true);
+    }
+
+    /**
+     * Segments are downloaded several at a time over kept-alive
+     * connections, but come out of the reader in playlist order even
+     * when a later one finishes first.
+     */
+    void ParallelSegments(void)
+    {
+        HLSTestServer server;
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+
+        QByteArray expected;
+        for (int seq = 0; seq < kSegments; seq++)
+            expected += MakeSegment(seq);
+
+        // The server runs on this thread, Open() and the wait below
+        // keep its events going.
+        HLSReader reader;
+        QVERIFY(reader.Open(server.PlaylistURL()));
+        reader.Throttle(false);
+
+        QByteArray received;
+        uint8_t buffer[65536];
+        QElapsedTimer timer;
+        timer.start();
+        while (received.size() < expected.size() && timer.elapsed() < 20000)
+        {
+            int len = reader.Read(buffer, sizeof(buffer));
+            if (len > 0)
+                received.append((const char *)buffer, len);
+            else
+                QTest::qWait(10);
+        }
+        reader.Close();
+
+        QCOMPARE(received.size(), expected.size());
+        QVERIFY(received == expected);
+
+        QCOMPARE(server.SegmentRequests(), kSegments);
+        // More than one segment in flight, never more than the limit,
+        // and connections reused from one segment to the next.
+        QVERIFY(server.SegmentConnections() > 1);
+        QVERIFY(server.SegmentConnections() <= 3);
+    }
+
+    void cleanupTestCase(void)
+    {
+        delete gCoreContext;
+        gCoreContext = NULL;
+    }
+};
@@ -19,11 +19,26 @@
  */
 
 #include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QUdpSocket>
+
+#include "mythconfig.h"
+
+#if HAVE_RECVMMSG
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
 
 #include "iptvtuningdata.h"
 #include "channelscan/iptvchannelfetcher.h"
 #include "recorders/rtp/rtpdatapacket.h"
 #include "recorders/rtp/rtptsdatapacket.h"
+#include "recorders/rtp/rtppacketbuffer.h"
+#include "recorders/rtp/udppacketbuffer.h"
+#include "recorders/rtp/udppacketreceiver.h"
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #define MSKIP(MSG) QSKIP(MSG, SkipSingle)
@@ -31,6 +46,43 @@
 #define MSKIP(MSG) QSKIP(MSG)
 #endif
 
+/// Fills \p packet with a minimal RTP header carrying \p seq and
+/// \p payload_size bytes of payload
+static void MakeRTPPacket(UDPPacket &packet, uint seq, int payload_size = 188)
+{
+    QByteArray &data = packet.GetDataReference();
+    data.fill(0, 12 + payload_size);
+    data[0] = 0x80; // version 2
+    data[1] = RTPDataPacket::kPayLoadTypeTS;
+    data[2] = (seq >> 8) & 0xFF;
+    data[3] = seq & 0xFF;
+}
+
+/// Pushes the RTP packets \p seqs into \p buffer
+static void PushRTPPackets(RTPPacketBuffer &buffer, const QList<uint> &seqs)
+{
+    for (int i = 0; i < seqs.size(); i++)
+    {
+        UDPPacket packet(buffer.GetEmptyPacket());
+        MakeRTPPacket(packet, seqs[i]);
+        buffer.PushDataPacket(packet);
+    }
+}
+
+/// Pops all the available packets from \p buffer, returning their
+/// sequence numbers
+static QList<uint> PopRTPPackets(RTPPacketBuffer &buffer)
+{
+    QList<uint> seqs;
+    while (buffer.HasAvailablePacket())
+    {
+        RTPDataPacket packet(buffer.PopDataPacket());
+        seqs.append(packet.GetSequenceNumber());
+        buffer.FreePacket(packet);
+    }
+    return seqs;
+}
+
 class TestIPTVRecorder: public QObject
 {
     Q_OBJECT
@@ -451,4 +503,170 @@ class TestIPTVRecorder: public QObject
         QCOMPARE (ts_packet2.GetTSData()[0], (uint8_t)0x47);
         QCOMPARE (ts_packet2.GetTSDataSize(), (unsigned int)7 * 188);
     }
+
+    /**
+     * Test RTP packets are released in sequence order
+     */
+    void RTPReorder(void)
+    {
+        RTPPacketBuffer buffer(0);
+
+        /* swap every pair, 1 0 3 2 5 4 ... */
+        QList<uint> seqs;
+        for (uint i = 0; i < 600; i += 2)
+            seqs << i + 1 << i;
+        PushRTPPackets(buffer, seqs);
+
+        /* 501 held triggers a release of all but the newest 100 */
+        QList<uint> popped = PopRTPPackets(buffer);
+        QCOMPARE (popped.size(), 401);
+        for (int i = 0; i < popped.size(); i++)
+            QCOMPARE (popped[i], (uint)i);
+
+        /* a duplicate replaces the held copy rather than adding one */
+        seqs.clear();
+        seqs << 599;
+        for (uint i = 600; i < 1000; i++)
+            seqs << i;
+        PushRTPPackets(buffer, seqs);
+        popped = PopRTPPackets(buffer);
+        QCOMPARE (popped.size(), 401);
+        for (int i = 0; i < popped.size(); i++)
+            QCOMPARE (popped[i], (uint)i + 401);
+    }
+
+    /**
+     * Test RTP packet order survives the sequence number wrapping
+     */
+    void RTPSequenceWrap(void)
+    {
+        RTPPacketBuffer buffer(0);
+
+        QList<uint> seqs;
+        for (uint i = 0; i < 1200; i++)
+            seqs << ((65000 + i) & 0xFFFF);
+        seqs.swap(10, 11);
+        seqs.swap(540, 541);
+        PushRTPPackets(buffer, seqs);
+
+        QList<uint> popped = PopRTPPackets(buffer);
+        QCOMPARE (popped.size(), 802);
+        for (int i = 0; i < popped.size(); i++)
+            QCOMPARE (popped[i], (uint)(65000 + i) & 0xFFFF);
+    }
+
+    /**
+     * Test a jump beyond the reorder ring flushes what was held first
+     */
+    void RTPSequenceJump(void)
+    {
+        RTPPacketBuffer buffer(0);
+
+        QList<uint> seqs;
+        seqs << 100 << 102 << 101 << 100 + 3 * RTPPacketBuffer::kRingSize;
+        PushRTPPackets(buffer, seqs);
+
+        QList<uint> popped = PopRTPPackets(buffer);
+        QCOMPARE (popped.size(), 3);
+        QCOMPARE (popped[0], 100U);
+        QCOMPARE (popped[1], 101U);
+        QCOMPARE (popped[2], 102U);
+    }
+
+    /**
+     * Benchmark the batched receive path with a loopback sender.
+     *
+     * MYTHTV_UDPBENCH_PACKETS sets how many 1328 byte datagrams are
+     * sent, it is skipped if it isn't set. The results are printed on a
+     * line starting "UDPBENCH ", timed up to the last datagram received.
+     */
+    void UDPReceiveBench(void)
+    {
+#if !HAVE_RECVMMSG
+        MSKIP ("recvmmsg() is not available on this platform");
+#else
+        QByteArray env = qgetenv("MYTHTV_UDPBENCH_PACKETS");
+        if (env.isEmpty())
+            MSKIP ("Set MYTHTV_UDPBENCH_PACKETS to the number of datagrams");
+        int count = env.toInt();
+        QVERIFY (count > 0);
+
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        QVERIFY (fd >= 0);
+        int buf_size = 4 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *)&buf_size,
+                   sizeof(buf_size));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        QVERIFY (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        socklen_t addr_len = sizeof(addr);
+        QVERIFY (getsockname(fd, (struct sockaddr*)&addr, &addr_len) == 0);
+        quint16 port = ntohs(addr.sin_port);
+
+        UDPPacketBuffer buffer(0);
+        UDPPacketReceiver *receiver = new UDPPacketReceiver(
+            "bench", &buffer, fd, 0, QHostAddress(QHostAddress::LocalHost));
+        receiver->start();
+
+        QUdpSocket sender;
+        UDPPacket datagram;
+        MakeRTPPacket(datagram, 0, 7 * 188);
+        const QByteArray &data = datagram.GetDataReference();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        int received = 0;
+        qint64 last = 0;
+        for (int sent = 0; sent < count; )
+        {
+            /* send in bursts, like a multicast source does */
+            for (int i = 0; i < 64 && sent < count; i++, sent++)
+            {
+                sender.writeDatagram(data.constData(), data.size(),
+                                     QHostAddress::LocalHost, port);
+            }
+            while (buffer.HasAvailablePacket())
+            {
+                buffer.FreePacket(buffer.PopDataPacket());
+                received++;
+                last = timer.nsecsElapsed();
+            }
+        }
+
+        /* collect the stragglers */
+        QElapsedTimer idle;
+        idle.start();
+        while (received < count && idle.elapsed() < 500)
+        {
+            if (!buffer.HasAvailablePacket())
+            {
+                usleep(1000);
+                continue;
+            }
+            buffer.FreePacket(buffer.PopDataPacket());
+            received++;
+            last = timer.nsecsElapsed();
+            idle.restart();
+        }
+
+        /* the wait for stragglers that never came isn't counted */
+        double secs = qMax(last, (qint64)1) / 1000000000.0;
+        receiver->Stop();
+        uint64_t calls = receiver->GetCallCount();
+        delete receiver;
+        close(fd);
+
+        printf("UDPBENCH {\"sent\": %d, \"received\": %d, "
+               "\"packets_per_sec\": %.0f, \"datagrams_per_call\": %.1f}\n",
+               count, received, received / secs,
+               calls ? (double)received / calls : 0.0);
+
+        QVERIFY (received > 0);
+        QVERIFY (calls <= (uint64_t)received);
+#endif
+    }
 };
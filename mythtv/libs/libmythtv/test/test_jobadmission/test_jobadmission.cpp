@@ -0,0 +1,3 @@
+#include "test_jobadmission.h"
+
+QTEST_APPLESS_MAIN(TestJobAdmission)
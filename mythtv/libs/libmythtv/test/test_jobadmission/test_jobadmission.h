@@ -0,0 +1,147 @@
+/*
+ *  Class TestJobAdmission
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "jobadmission.h"
+#include "jobqueue.h"
+
+class TestJobAdmission: public QObject
+{
+    Q_OBJECT
+
+  private:
+    static QString Defer(const JobAdmission::Limits &limits,
+                         const JobAdmission::Load &load, int jobType,
+                         int running, int transcodes = 0)
+    {
+        int runningOfClass[JobAdmission::kJobClasses] = { 0, 0, 0, 0 };
+        runningOfClass[JobAdmission::kTranscodeJobs] = transcodes;
+        return JobAdmission::Defer(limits, load, jobType, running,
+                                   runningOfClass);
+    }
+
+  private slots:
+    void ClassOf(void)
+    {
+        QCOMPARE(JobAdmission::ClassOf(JOB_TRANSCODE),
+                 JobAdmission::kTranscodeJobs);
+        QCOMPARE(JobAdmission::ClassOf(JOB_COMMFLAG),
+                 JobAdmission::kCommFlagJobs);
+        QCOMPARE(JobAdmission::ClassOf(JOB_METADATA),
+                 JobAdmission::kMetadataJobs);
+        QCOMPARE(JobAdmission::ClassOf(JOB_USERJOB3),
+                 JobAdmission::kUserJobs);
+    }
+
+    /**
+     * A busy host holds back a second job, but never the first one.
+     */
+    void ResourceLimits(void)
+    {
+        JobAdmission::Limits limits;
+        JobAdmission::Load load;
+        load.cpu = 95;
+        load.writeLatency = 20;
+
+        QVERIFY(Defer(limits, load, JOB_COMMFLAG, 0).isEmpty());
+        QVERIFY(!Defer(limits, load, JOB_COMMFLAG, 1).isEmpty());
+        // metadata lookups hardly use the CPU
+        QVERIFY(Defer(limits, load, JOB_METADATA, 1).isEmpty());
+
+        load.cpu = 50;
+        QVERIFY(Defer(limits, load, JOB_COMMFLAG, 1).isEmpty());
+
+        load.writeLatency = 250;
+        QVERIFY(!Defer(limits, load, JOB_TRANSCODE, 1).isEmpty());
+
+        limits.maxWriteLatency = 0;
+        QVERIFY(Defer(limits, load, JOB_TRANSCODE, 1).isEmpty());
+
+        // Unknown measurements don't hold anything back
+        load.cpu = -1;
+        load.writeLatency = -1;
+        QVERIFY(Defer(limits, load, JOB_TRANSCODE, 2).isEmpty());
+    }
+
+    void RecordingLimit(void)
+    {
+        JobAdmission::Limits limits;
+        JobAdmission::Load load;
+        load.recordings = 2;
+
+        QVERIFY(Defer(limits, load, JOB_TRANSCODE, 0).isEmpty());
+        QVERIFY(!Defer(limits, load, JOB_METADATA, 1).isEmpty());
+
+        limits.maxWhileRecording = 0;
+        QVERIFY(!Defer(limits, load, JOB_TRANSCODE, 0).isEmpty());
+
+        load.recordings = 0;
+        QVERIFY(Defer(limits, load, JOB_TRANSCODE, 2).isEmpty());
+    }
+
+    void ClassLimit(void)
+    {
+        JobAdmission::Limits limits;
+        JobAdmission::Load load;
+        limits.maxOfClass[JobAdmission::kTranscodeJobs] = 1;
+
+        QVERIFY(Defer(limits, load, JOB_TRANSCODE, 0, 0).isEmpty());
+        QVERIFY(!Defer(limits, load, JOB_TRANSCODE, 1, 1).isEmpty());
+        QVERIFY(Defer(limits, load, JOB_COMMFLAG, 1, 1).isEmpty());
+    }
+
+    void ParseCPUStat(void)
+    {
+        QByteArray stat("cpu  100 5 50 800 40 3 2 0 10 0\n"
+                        "cpu0 50 2 25 400 20 1 1 0 5 0\n");
+        quint64 busy = 0, total = 0;
+        QVERIFY(JobAdmission::ParseCPUStat(stat, busy, total));
+        QCOMPARE(total, (quint64)1000);
+        QCOMPARE(busy, (quint64)160);
+
+        QVERIFY(!JobAdmission::ParseCPUStat("intr 1 2 3\n", busy, total));
+    }
+
+    void CPUPercent(void)
+    {
+        QCOMPARE(JobAdmission::CPUPercent(100, 1000, 150, 1100), 50);
+        // no earlier sample, or no time passed
+        QCOMPARE(JobAdmission::CPUPercent(0, 0, 150, 1100), -1);
+        QCOMPARE(JobAdmission::CPUPercent(100, 1000, 150, 1000), -1);
+        // busy time going back, as when a CPU goes offline
+        QCOMPARE(JobAdmission::CPUPercent(500, 1000, 400, 1100), 0);
+        QCOMPARE(JobAdmission::CPUPercent(100, 1000, 300, 1100), 100);
+    }
+
+    void ParseDiskStats(void)
+    {
+        QByteArray stats(
+            "   8       0 sda 100 0 800 50 200 10 1600 400 0 300 450\n"
+            "   8       1 sda1 90 0 700 40 150 10 1200 900 0 250 940\n");
+        quint64 writes = 0, writeMS = 0;
+
+        QVERIFY(JobAdmission::ParseDiskStats(stats, (8ULL << 32) | 1,
+                                             writes, writeMS));
+        QCOMPARE(writes, (quint64)150);
+        QCOMPARE(writeMS, (quint64)900);
+
+        QVERIFY(!JobAdmission::ParseDiskStats(stats, (8ULL << 32) | 2,
+                                              writes, writeMS));
+    }
+};
@@ -0,0 +1,3 @@
+#include "test_jobdistributor.h"
+
+QTEST_APPLESS_MAIN(TestJobDistributor)
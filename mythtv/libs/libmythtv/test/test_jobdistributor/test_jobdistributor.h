@@ -0,0 +1,175 @@
+/*
+ *  Class TestJobDistributor
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "jobdistributor.h"
+#include "jobqueue.h"
+
+class TestJobDistributor: public QObject
+{
+    Q_OBJECT
+
+  private:
+    QDateTime m_now;
+
+    JobQueueEntry Job(int queuedSecsAgo)
+    {
+        JobQueueEntry job;
+        job.id = 1;
+        job.chanid = 1001;
+        job.type = JOB_COMMFLAG;
+        job.cmds = JOB_RUN;
+        job.flags = 0;
+        job.status = JOB_QUEUED;
+        job.inserttime = m_now.addSecs(-queuedSecsAgo);
+        job.schedruntime = job.inserttime;
+        job.statustime = job.inserttime;
+        job.hostname = "backend2";
+        return job;
+    }
+
+    JobHostStatus Host(int heartbeatSecsAgo, int running, int deferred)
+    {
+        JobHostStatus host;
+        host.heartbeat = m_now.addSecs(-heartbeatSecsAgo);
+        host.checkFrequency = 60;
+        host.running = running;
+        host.maxJobs = 2;
+        host.deferred = deferred;
+        return host;
+    }
+
+  private slots:
+    void initTestCase(void)
+    {
+        m_now = QDateTime(QDate(2015, 3, 1), QTime(20, 0, 0), Qt::UTC);
+    }
+
+    void StatusString(void)
+    {
+        JobHostStatus status = Host(0, 1, 2);
+        status.load = "CPU 95%, writes 20 ms, 1 recording";
+
+        JobHostStatus read;
+        QVERIFY(read.fromString(status.toString()));
+        QCOMPARE(read.heartbeat, status.heartbeat);
+        QCOMPARE(read.checkFrequency, 60);
+        QCOMPARE(read.running, 1);
+        QCOMPARE(read.maxJobs, 2);
+        QCOMPARE(read.deferred, 2);
+        QCOMPARE(read.load, status.load);
+
+        QVERIFY(!read.fromString(""));
+        QVERIFY(!read.fromString("garbage 1 2 3 4"));
+    }
+
+    void Heartbeat(void)
+    {
+        QVERIFY(Host(0, 0, 0).IsAlive(m_now));
+        QVERIFY(Host(240, 0, 0).IsAlive(m_now));
+        QVERIFY(!Host(241, 0, 0).IsAlive(m_now));
+        QVERIFY(!JobHostStatus().IsAlive(m_now));
+    }
+
+    void Idle(void)
+    {
+        QVERIFY(Host(0, 0, 0).IsIdle());
+        QVERIFY(!Host(0, 1, 0).IsIdle());
+        QVERIFY(!Host(0, 0, 1).IsIdle());
+    }
+
+    /**
+     * A new job is left to the best placed host until the claim delay has
+     * passed: an idle one with the recording on its own disks, then any
+     * idle one, then a busy one with the recording.
+     */
+    void Claim(void)
+    {
+        JobQueueEntry job = Job(10);
+
+        // local, idle
+        QVERIFY(JobDistributor::ShouldClaim(job, true, false, true, true, 60,
+                                            m_now));
+        // local, busy, but no one else is idle
+        QVERIFY(JobDistributor::ShouldClaim(job, true, true, false, false, 60,
+                                            m_now));
+        // local but busy, another host is idle
+        QVERIFY(!JobDistributor::ShouldClaim(job, true, true, true, false, 60,
+                                             m_now));
+        // not local, idle, and so is a host with the recording
+        QVERIFY(!JobDistributor::ShouldClaim(job, false, false, true, true, 60,
+                                             m_now));
+        // not local and busy
+        QVERIFY(!JobDistributor::ShouldClaim(job, false, true, false, false,
+                                             60, m_now));
+
+        // Waited long enough, anyone can take it
+        job = Job(60);
+        QVERIFY(JobDistributor::ShouldClaim(job, false, true, true, true, 60,
+                                            m_now));
+        QVERIFY(JobDistributor::ShouldClaim(Job(0), false, true, true, true, 0,
+                                            m_now));
+
+        // Scheduled to run later, the wait starts then
+        job = Job(120);
+        job.schedruntime = m_now.addSecs(-30);
+        QVERIFY(!JobDistributor::ShouldClaim(job, false, true, true, true, 60,
+                                             m_now));
+    }
+
+    /**
+     * A busy master that recorded it and an idle slave without it: the
+     * slave takes it straight away rather than both waiting it out.
+     */
+    void ClaimBusyLocal(void)
+    {
+        JobQueueEntry job = Job(10);
+
+        bool master = JobDistributor::ShouldClaim(job, true, true, true, false,
+                                                  60, m_now);
+        bool slave = JobDistributor::ShouldClaim(job, false, false, false,
+                                                 false, 60, m_now);
+        QVERIFY(!master);
+        QVERIFY(slave);
+
+        // With both idle only the one with the recording takes it
+        master = JobDistributor::ShouldClaim(job, true, false, true, false,
+                                             60, m_now);
+        slave = JobDistributor::ShouldClaim(job, false, false, true, true,
+                                            60, m_now);
+        QVERIFY(master);
+        QVERIFY(!slave);
+    }
+
+    void FailOver(void)
+    {
+        JobQueueEntry job = Job(600);
+
+        QVERIFY(JobDistributor::ShouldFailOver(job, Host(600, 0, 0), m_now));
+        QVERIFY(!JobDistributor::ShouldFailOver(job, Host(10, 2, 0), m_now));
+
+        // Started jobs may still be running on a host slow to report
+        job.status = JOB_RUNNING;
+        QVERIFY(!JobDistributor::ShouldFailOver(job, Host(600, 0, 0), m_now));
+        job.status = JOB_STARTING;
+        QVERIFY(!JobDistributor::ShouldFailOver(job, Host(600, 0, 0), m_now));
+        job.status = JOB_PAUSED;
+        QVERIFY(!JobDistributor::ShouldFailOver(job, Host(600, 0, 0), m_now));
+    }
+};
@@ -0,0 +1,9 @@
+#include "test_jobqueuehosts.h"
+
+int main(int argc, char *argv[])
+{
+    // The job queues need an application for their events
+    QCoreApplication app(argc, argv);
+    TestJobQueueHosts test;
+    return QTest::qExec(&test, argc, argv);
+}
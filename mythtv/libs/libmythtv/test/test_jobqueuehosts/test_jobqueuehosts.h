@@ -0,0 +1,403 @@
+/*
+ *  Class TestJobQueueHosts
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <unistd.h>
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVariant>
+#include <QFile>
+#include <QDir>
+#include <QMap>
+
+#include "mythcorecontext.h"
+#include "mythcontext.h"
+#include "mythversion.h"
+#include "mythdate.h"
+#include "mythdbcon.h"
+#include "mythdb.h"
+#include "jobdistributor.h"
+#include "jobqueue.h"
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#define MSKIP(MSG) QSKIP(MSG, SkipAll)
+#else
+#define MSKIP(MSG) QSKIP(MSG)
+#endif
+
+/**
+ *  Two job queues, running jobs for two made up hosts, sharing one
+ *  database as two backends would.
+ *
+ *  This needs a database it may make a mess of. It queues user jobs,
+ *  adds a recording and changes this host's job queue settings, all of
+ *  which it puts back afterwards, and any other backend using it would
+ *  pick up the jobs too. Set MYTHTV_JOBQUEUE_TEST=1 to run it against
+ *  the database in config.xml, otherwise it is skipped.
+ */
+class TestJobQueueHosts: public QObject
+{
+    Q_OBJECT
+
+  private:
+    static const uint kChanID = 99901;
+
+    QString m_hostA;
+    QString m_hostB;
+    QString m_hostDead;
+    QString m_args;         ///< marks the jobs this queues
+    QString m_ranFile;      ///< the user job adds its job id to this
+    QMap<QString, QVariant> m_saved;
+    QDateTime m_recstartts;
+    JobQueue *m_queueA;
+    JobQueue *m_queueB;
+
+    /// Saves \p value for this host, remembering what was there before
+    void SetSetting(const QString &key, const QString &value)
+    {
+        if (!m_saved.contains(key))
+        {
+            MSqlQuery query(MSqlQuery::InitCon());
+            query.prepare("SELECT data FROM settings "
+                          "WHERE value = :KEY AND hostname = :HOST");
+            query.bindValue(":KEY", key);
+            query.bindValue(":HOST", gCoreContext->GetHostName());
+            m_saved[key] = (query.exec() && query.next()) ?
+                query.value(0) : QVariant();
+        }
+        gCoreContext->SaveSetting(key, value);
+    }
+
+    static QDateTime DatabaseTime(void)
+    {
+        MSqlQuery query(MSqlQuery::InitCon());
+        if (!query.exec("SELECT NOW()") || !query.next())
+            return QDateTime();
+        return MythDate::as_utc(query.value(0).toDateTime());
+    }
+
+    int QueueTestJob(int type, const QString &host, int status = JOB_QUEUED,
+                     uint chanid = 0, const QDateTime &recstartts = QDateTime())
+    {
+        if (!JobQueue::QueueJob(type, chanid, recstartts, m_args, "", host, 0,
+                                status))
+            return 0;
+
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare("SELECT MAX(id) FROM jobqueue WHERE args = :ARGS");
+        query.bindValue(":ARGS", m_args);
+        if (!query.exec() || !query.next())
+            return 0;
+        return query.value(0).toInt();
+    }
+
+    static QVariant JobField(int jobID, const QString &field)
+    {
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare(QString("SELECT %1 FROM jobqueue WHERE id = :ID")
+                      .arg(field));
+        query.bindValue(":ID", jobID);
+        if (!query.exec() || !query.next())
+            return QVariant();
+        return query.value(0);
+    }
+
+    static int JobStatus(int jobID)
+        { return JobField(jobID, "status").toInt(); }
+    static QString JobHost(int jobID)
+        { return JobField(jobID, "hostname").toString(); }
+
+    /// Makes m_hostDead look as if it stopped reporting an hour ago
+    bool KillDeadHost(void)
+    {
+        JobHostStatus dead;
+        dead.heartbeat = DatabaseTime().addSecs(-3600);
+        dead.checkFrequency = 60;
+        dead.maxJobs = 2;
+        return dead.heartbeat.isValid() &&
+            gCoreContext->SaveSettingOnHost("JobQueueHostStatus",
+                                            dead.toString(), m_hostDead);
+    }
+
+    /// Waits up to \p secs for \p jobID to reach \p status
+    static bool WaitForStatus(int jobID, int status, int secs)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (JobStatus(jobID) != status)
+        {
+            if (timer.elapsed() > secs * 1000)
+                return false;
+            QTest::qWait(250);
+        }
+        return true;
+    }
+
+    /// Waits up to \p secs for a host to claim \p jobID
+    static bool WaitForHost(int jobID, int secs)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (JobHost(jobID).isEmpty())
+        {
+            if (timer.elapsed() > secs * 1000)
+                return false;
+            QTest::qWait(250);
+        }
+        return true;
+    }
+
+    /// Waits up to \p secs for \p host to report it is running jobs
+    static bool WaitForBusy(const QString &host, int secs)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (true)
+        {
+            MSqlQuery query(MSqlQuery::InitCon());
+            query.prepare("SELECT data FROM settings "
+                          "WHERE value = 'JobQueueHostStatus' "
+                          "AND hostname = :HOST");
+            query.bindValue(":HOST", host);
+
+            JobHostStatus status;
+            if (query.exec() && query.next())
+                status.fromString(query.value(0).toString());
+            if (status.running > 0)
+                return true;
+            if (timer.elapsed() > secs * 1000)
+                return false;
+            QTest::qWait(250);
+        }
+    }
+
+    /// How many times the user job ran for \p jobID
+    int RunCount(int jobID)
+    {
+        QFile file(m_ranFile);
+        if (!file.open(QIODevice::ReadOnly))
+            return 0;
+
+        int count = 0;
+        QStringList lines = QString(file.readAll()).split('\n');
+        for (int i = 0; i < lines.size(); i++)
+            count += (lines[i].trimmed().toInt() == jobID);
+        return count;
+    }
+
+  public:
+    TestJobQueueHosts(void) :
+        m_hostA("test-jobqueue-a"), m_hostB("test-jobqueue-b"),
+        m_hostDead("test-jobqueue-dead"), m_args("test_jobqueuehosts"),
+        m_queueA(NULL), m_queueB(NULL)
+    {
+    }
+
+  private slots:
+    void initTestCase(void)
+    {
+        if (qgetenv("MYTHTV_JOBQUEUE_TEST").isEmpty())
+            MSKIP("Set MYTHTV_JOBQUEUE_TEST=1 to run against a database");
+
+        gContext = new MythContext(MYTH_BINARY_VERSION);
+        QVERIFY2(gContext->Init(false), "Unable to connect to the database");
+
+        m_ranFile = QDir::temp().filePath(
+            QString("test_jobqueuehosts-%1").arg(getpid()));
+        QFile::remove(m_ranFile);
+
+        SetSetting("JobQueueCheckFrequency", "1");
+        SetSetting("JobQueueMaxSimultaneousJobs", "2");
+        SetSetting("JobQueueMaxCPUUsage", "0");
+        SetSetting("JobQueueMaxWriteLatency", "0");
+        SetSetting("JobQueueWindowStart", "00:00");
+        SetSetting("JobQueueWindowEnd", "23:59");
+        SetSetting("JobsRunOnRecordHost", "0");
+        SetSetting("JobQueueRemoteClaimDelay", "60");
+        SetSetting("JobAllowUserJob1", "1");
+        SetSetting("JobAllowUserJob2", "1");
+        SetSetting("UserJob1",
+                   QString("echo %JOBID% >> '%1'; sleep 1").arg(m_ranFile));
+        SetSetting("UserJob2", "sleep 8");
+
+        m_queueA = new JobQueue(false, m_hostA);
+        m_queueB = new JobQueue(false, m_hostB);
+    }
+
+    void cleanupTestCase(void)
+    {
+        if (!gContext)
+            return;
+
+        delete m_queueA;
+        m_queueA = NULL;
+        delete m_queueB;
+        m_queueB = NULL;
+
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare("DELETE FROM jobqueue WHERE args = :ARGS");
+        query.bindValue(":ARGS", m_args);
+        query.exec();
+
+        query.prepare("DELETE FROM settings WHERE value = 'JobQueueHostStatus' "
+                      "AND hostname IN (:HOSTA, :HOSTB, :HOSTDEAD)");
+        query.bindValue(":HOSTA", m_hostA);
+        query.bindValue(":HOSTB", m_hostB);
+        query.bindValue(":HOSTDEAD", m_hostDead);
+        query.exec();
+
+        if (m_recstartts.isValid())
+        {
+            query.prepare("DELETE FROM recorded "
+                          "WHERE chanid = :CHANID AND starttime = :START");
+            query.bindValue(":CHANID", kChanID);
+            query.bindValue(":START", m_recstartts);
+            query.exec();
+        }
+
+        QMap<QString, QVariant>::const_iterator it = m_saved.begin();
+        for ( ; it != m_saved.end(); ++it)
+        {
+            if ((*it).isNull())
+                GetMythDB()->ClearSettingOnHost(it.key(),
+                                                gCoreContext->GetHostName());
+            else
+                gCoreContext->SaveSetting(it.key(), (*it).toString());
+        }
+        gCoreContext->ClearSettingsCache();
+
+        QFile::remove(m_ranFile);
+
+        delete gContext;
+        gContext = NULL;
+    }
+
+    /**
+     * Both hosts take some of the jobs, and every job runs exactly once.
+     */
+    void SpreadsJobs(void)
+    {
+        QList<int> ids;
+        for (int i = 0; i < 6; i++)
+        {
+            int jobID = QueueTestJob(JOB_USERJOB1, "");
+            QVERIFY(jobID);
+            ids << jobID;
+        }
+
+        QStringList hosts;
+        for (int i = 0; i < ids.size(); i++)
+        {
+            QVERIFY(WaitForStatus(ids[i], JOB_FINISHED, 60));
+            QCOMPARE(RunCount(ids[i]), 1);
+            hosts << JobHost(ids[i]);
+        }
+
+        QVERIFY(hosts.contains(m_hostA));
+        QVERIFY(hosts.contains(m_hostB));
+    }
+
+    /**
+     * A queued job left on a host that stopped reporting an hour ago is
+     * run elsewhere, one it had started and still reports progress on is
+     * left alone.
+     */
+    void FailsOverQueuedJobs(void)
+    {
+        QVERIFY(KillDeadHost());
+
+        int queued = QueueTestJob(JOB_USERJOB1, m_hostDead);
+        int running = QueueTestJob(JOB_USERJOB1, m_hostDead, JOB_RUNNING);
+        QVERIFY(queued);
+        QVERIFY(running);
+
+        QVERIFY(WaitForStatus(queued, JOB_FINISHED, 30));
+        QVERIFY(JobHost(queued) == m_hostA || JobHost(queued) == m_hostB);
+        QCOMPARE(RunCount(queued), 1);
+
+        QCOMPARE(JobStatus(running), (int)JOB_RUNNING);
+        QCOMPARE(JobHost(running), m_hostDead);
+        QCOMPARE(RunCount(running), 0);
+    }
+
+    /**
+     * A job the dead host had started, and which hasn't changed since it
+     * stopped reporting, is run again elsewhere, once.
+     */
+    void FailsOverStalledJobs(void)
+    {
+        QVERIFY(KillDeadHost());
+
+        int stalled = QueueTestJob(JOB_USERJOB1, m_hostDead, JOB_RUNNING);
+        QVERIFY(stalled);
+
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare("UPDATE jobqueue SET statustime = :STATUSTIME "
+                      "WHERE id = :ID");
+        query.bindValue(":STATUSTIME", DatabaseTime().addSecs(-3600));
+        query.bindValue(":ID", stalled);
+        QVERIFY(query.exec());
+
+        QVERIFY(WaitForStatus(stalled, JOB_FINISHED, 30));
+        QVERIFY(JobHost(stalled) == m_hostA || JobHost(stalled) == m_hostB);
+        QCOMPARE(RunCount(stalled), 1);
+    }
+
+    /**
+     * The host that recorded it is busy and the other is idle, the idle
+     * one takes it without waiting out JobQueueRemoteClaimDelay.
+     */
+    void IdleHostTakesBusyHostsRecording(void)
+    {
+        int busy = QueueTestJob(JOB_USERJOB2, m_hostA);
+        QVERIFY(busy);
+        QVERIFY(WaitForStatus(busy, JOB_RUNNING, 30));
+        QVERIFY(WaitForBusy(m_hostA, 30));
+
+        QDateTime now = DatabaseTime();
+        QVERIFY(now.isValid());
+        m_recstartts = now.addSecs(-7200);
+        m_recstartts = m_recstartts.addMSecs(-m_recstartts.time().msec());
+
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare("INSERT INTO recorded (chanid, starttime, endtime, "
+                      "  title, season, episode, inetref, hostname, basename) "
+                      "VALUES (:CHANID, :START, :END, :TITLE, 0, 0, '', "
+                      "  :HOST, :BASENAME)");
+        query.bindValue(":CHANID", kChanID);
+        query.bindValue(":START", m_recstartts);
+        query.bindValue(":END", m_recstartts.addSecs(1800));
+        query.bindValue(":TITLE", m_args);
+        query.bindValue(":HOST", m_hostA);
+        query.bindValue(":BASENAME", QString("%1_%2.ts").arg(kChanID)
+                        .arg(m_recstartts.toString("yyyyMMddhhmmss")));
+        QVERIFY(query.exec());
+
+        QElapsedTimer timer;
+        timer.start();
+        int job = QueueTestJob(JOB_USERJOB1, "", JOB_QUEUED, kChanID,
+                               m_recstartts);
+        QVERIFY(job);
+        QVERIFY(WaitForHost(job, 30));
+        QCOMPARE(JobHost(job), m_hostB);
+        QVERIFY(timer.elapsed() < 60 * 1000);
+
+        QVERIFY(WaitForStatus(busy, JOB_FINISHED, 30));
+    }
+};
@@ -0,0 +1,534 @@
+/*
+ *  Recording pipeline benchmark harness
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+// POSIX headers
+#include <sys/poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+
+// C++ headers
+#include <algorithm>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// Qt headers
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+// MythTV headers
+#include "recorderbench.h"
+#include "recorders/DeviceReadBuffer.h"
+#include "mpeg/mpegstreamdata.h"
+#include "mpeg/mpegtables.h"
+#include "mpeg/tspacket.h"
+#include "mythlogging.h"
+
+#define LOC QString("RecBench(%1): ").arg(_device)
+
+static int64_t thread_cpu_time(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
+bool ReplaySource::Load(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_name = QFileInfo(filename).fileName();
+    m_data = file.readAll();
+
+    // Replay whole packets only, starting at the first sync byte
+    int start = 0;
+    while (start < m_data.size() && m_data[start] != SYNC_BYTE)
+        ++start;
+    m_data = m_data.mid(start);
+    m_data.truncate(m_data.size() - (m_data.size() % TSPacket::kSize));
+
+    Analyse();
+
+    return !m_data.isEmpty();
+}
+
+static void append_packets(QByteArray &out, const PSIPTable &table, uint &cc)
+{
+    vector<TSPacket> packets;
+    table.GetAsTSPackets(packets, cc);
+    for (uint i = 0; i < packets.size(); ++i)
+        out.append((const char*)packets[i].data(), TSPacket::kSize);
+    cc = (cc + packets.size()) & 0xf;
+}
+
+static void append_timestamp(QByteArray &out, uint prefix, uint64_t ts)
+{
+    out.append((char)(prefix | ((ts >> 29) & 0x0e) | 0x01));
+    out.append((char)((ts >> 22) & 0xff));
+    out.append((char)(((ts >> 14) & 0xfe) | 0x01));
+    out.append((char)((ts >> 7) & 0xff));
+    out.append((char)(((ts << 1) & 0xfe) | 0x01));
+}
+
+/// Appends a PES packet as TS packets, with a PCR in the first one
+static void append_pes(QByteArray &out, uint pid, const QByteArray &pes,
+                       uint64_t pcr, uint &cc)
+{
+    int offset = 0;
+    bool first = true;
+
+    while (offset < pes.size())
+    {
+        unsigned char pkt[188];
+        memset(pkt, 0xff, sizeof(pkt));
+
+        // Adaptation field: length byte plus, in the first packet,
+        // a flags byte and a 6 byte PCR
+        int afc = first ? 8 : 0;
+        int left = pes.size() - offset;
+        if (left < 184 - afc)
+            afc = 184 - left;
+        int payload = 184 - afc;
+
+        pkt[0] = SYNC_BYTE;
+        pkt[1] = (first ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+        pkt[2] = pid & 0xff;
+        pkt[3] = (afc ? 0x30 : 0x10) | cc;
+        cc = (cc + 1) & 0xf;
+
+        if (afc)
+        {
+            pkt[4] = afc - 1;
+            if (afc > 1)
+                pkt[5] = 0x00;
+        }
+        if (first)
+        {
+            pkt[5] = 0x10; // PCR present
+            pkt[6]  = (pcr >> 25) & 0xff;
+            pkt[7]  = (pcr >> 17) & 0xff;
+            pkt[8]  = (pcr >> 9) & 0xff;
+            pkt[9]  = (pcr >> 1) & 0xff;
+            pkt[10] = ((pcr & 1) << 7) | 0x7e;
+            pkt[11] = 0x00;
+        }
+
+        memcpy(pkt + 4 + afc, pes.constData() + offset, payload);
+        out.append((const char*)pkt, sizeof(pkt));
+
+        offset += payload;
+        first = false;
+    }
+}
+
+/**
+ *  \brief Creates a single program stream of MPEG-2 video at bitrate.
+ *
+ *  The video is just sequence, GOP and picture headers padded out to the
+ *  frame size, which is all DTVRecorder looks at to find keyframes.
+ */
+void ReplaySource::Synthesize(uint seconds, uint bitrate)
+{
+    static const uint kFrameRate  = 25;
+    static const uint kGOPLength  = 12;
+    static const uint kPMTPID     = 0x100;
+    static const uint kVideoPID   = 0x101;
+
+    m_name = QString("synthetic-%1kbps").arg(bitrate / 1000);
+    m_data.clear();
+
+    vector<uint> pnums(1, 1), pmtpids(1, kPMTPID);
+    ProgramAssociationTable *pat =
+        ProgramAssociationTable::Create(1, 0, pnums, pmtpids);
+    vector<uint> pids(1, kVideoPID), types(1, StreamID::MPEG2Video);
+    ProgramMapTable *pmt =
+        ProgramMapTable::Create(1, kPMTPID, kVideoPID, 0, pids, types);
+
+    const uint frameSize = bitrate / 8 / kFrameRate;
+    uint patcc = 0, pmtcc = 0, vidcc = 0;
+
+    for (uint frame = 0; frame < seconds * kFrameRate; ++frame)
+    {
+        bool keyframe = (frame % kGOPLength) == 0;
+        uint64_t pcr = (uint64_t)frame * 90000 / kFrameRate;
+
+        if (keyframe)
+        {
+            append_packets(m_data, *pat, patcc);
+            append_packets(m_data, *pmt, pmtcc);
+        }
+
+        QByteArray pes;
+        pes.append("\x00\x00\x01\xe0\x00\x00\x80\x80\x05", 9);
+        append_timestamp(pes, 0x20, pcr + 9000);
+
+        if (keyframe)
+        {
+            // 720x576, 4:3, 25 fps
+            pes.append("\x00\x00\x01\xb3\x2d\x02\x40\x23"
+                       "\xff\xff\xe0\x18", 12);
+            pes.append("\x00\x00\x01\xb8\x00\x08\x00\x00", 8);
+        }
+
+        uint temporal = frame % kGOPLength;
+        uint type = keyframe ? 1 : 2; // I or P
+        pes.append("\x00\x00\x01\x00", 4);
+        pes.append((char)(temporal >> 2));
+        pes.append((char)(((temporal & 3) << 6) | (type << 3)));
+        pes.append("\xff\xf8", 2);
+
+        // 0xff padding can not be mistaken for a start code
+        if ((uint)pes.size() < frameSize)
+            pes.append(QByteArray(frameSize - pes.size(), '\xff'));
+
+        append_pes(m_data, kVideoPID, pes, pcr, vidcc);
+    }
+
+    delete pat;
+    delete pmt;
+
+    Analyse();
+}
+
+/// Finds the first program and estimates the real time byte rate from
+/// the first PCR PID
+void ReplaySource::Analyse(void)
+{
+    m_byteRate = 0.0;
+    m_program  = -1;
+
+    int pcrpid = -1;
+    int64_t firstPCR = -1, lastPCR = -1;
+    int firstOffset = 0, lastOffset = 0;
+
+    const unsigned char *data = (const unsigned char*)m_data.constData();
+    for (int off = 0; off + (int)TSPacket::kSize <= m_data.size();
+         off += TSPacket::kSize)
+    {
+        const TSPacket *pkt = reinterpret_cast<const TSPacket*>(data + off);
+        uint pid = pkt->PID();
+
+        if (m_program < 0 && pid == MPEG_PAT_PID && pkt->PayloadStart())
+        {
+            const unsigned char *payload = data + off + pkt->AFCOffset();
+            const unsigned char *end = data + off + TSPacket::kSize;
+            const unsigned char *sec = payload + 1 + payload[0];
+            if (sec + 3 <= end)
+            {
+                uint len = ((sec[1] & 0x0f) << 8) | sec[2];
+                const unsigned char *entries_end = sec + 3 + len - 4;
+                for (const unsigned char *e = sec + 8;
+                     e + 4 <= entries_end && e + 4 <= end; e += 4)
+                {
+                    uint pnum = (e[0] << 8) | e[1];
+                    if (pnum) // 0 is the NIT
+                    {
+                        m_program = pnum;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!pkt->HasAdaptationField() || data[off + 4] < 7 ||
+            !(data[off + 5] & 0x10))
+            continue;
+
+        if (pcrpid < 0)
+            pcrpid = pid;
+        if ((int)pid != pcrpid)
+            continue;
+
+        const unsigned char *p = data + off + 6;
+        int64_t base = ((int64_t)p[0] << 25) | (p[1] << 17) | (p[2] << 9) |
+                       (p[3] << 1) | (p[4] >> 7);
+        if (firstPCR < 0)
+        {
+            firstPCR    = base;
+            firstOffset = off;
+        }
+        else if (base > lastPCR)
+        {
+            lastPCR    = base;
+            lastOffset = off;
+        }
+    }
+
+    if (lastPCR > firstPCR && firstPCR >= 0)
+    {
+        m_byteRate = (lastOffset - firstOffset) * 90000.0 /
+                     (lastPCR - firstPCR);
+    }
+    else
+    {
+        // No usable PCRs, assume an ATSC multiplex
+        m_byteRate = 19392658 / 8.0;
+    }
+}
+
+ReplayFeeder::ReplayFeeder(const ReplaySource &source, int fd, double speed) :
+    MThread("ReplayFeeder"),
+    m_source(source), m_fd(fd), m_speed(speed), m_running(true),
+    m_packetsFed(0), m_packetsDropped(0)
+{
+}
+
+/// Writes all of data, waiting for room in the pipe
+bool ReplayFeeder::WriteFully(const char *data, uint len)
+{
+    while (len && m_running)
+    {
+        ssize_t ret = write(m_fd, data, len);
+        if (ret > 0)
+        {
+            data += ret;
+            len  -= ret;
+            continue;
+        }
+        if (ret < 0 && errno != EAGAIN && errno != EINTR)
+            return false;
+
+        struct pollfd polls;
+        polls.fd      = m_fd;
+        polls.events  = POLLOUT;
+        polls.revents = 0;
+        poll(&polls, 1, 100);
+    }
+    return !len;
+}
+
+void ReplayFeeder::run(void)
+{
+    RunProlog();
+
+    // About 10 ms of a DVB-T multiplex per write
+    static const uint kChunk = TSPacket::kSize * 64;
+    // Pipe writes up to PIPE_BUF are all or nothing, so a paced write
+    // never leaves part of a packet behind
+    static const uint kAtomic = (PIPE_BUF / TSPacket::kSize) * TSPacket::kSize;
+
+    const QByteArray &data = m_source.GetData();
+    const double rate = m_source.GetByteRate() * m_speed;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    uint64_t fed = 0;
+    int offset = 0;
+
+    while (m_running && !data.isEmpty())
+    {
+        if (rate > 0.0)
+        {
+            int64_t due  = (int64_t)(fed * 1000000.0 / rate);
+            int64_t now  = timer.nsecsElapsed() / 1000;
+            if (due > now)
+            {
+                usleep(min(due - now, (int64_t)100000));
+                continue;
+            }
+        }
+
+        uint len = min((int)kChunk, data.size() - offset);
+        const char *chunk = data.constData() + offset;
+
+        bool ok = true;
+        if (rate > 0.0)
+        {
+            // Like a tuner, drop what the reader has not made room for
+            for (uint done = 0; ok && done < len; done += kAtomic)
+            {
+                uint part = min(kAtomic, len - done);
+                ssize_t ret = write(m_fd, chunk + done, part);
+                if (ret == (ssize_t)part)
+                    m_packetsFed += part / TSPacket::kSize;
+                else if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+                    m_packetsDropped += part / TSPacket::kSize;
+                else
+                    ok = false;
+            }
+        }
+        else
+        {
+            ok = WriteFully(chunk, len);
+            if (ok)
+                m_packetsFed += len / TSPacket::kSize;
+        }
+
+        if (!ok)
+        {
+            LOG(VB_GENERAL, LOG_ERR, "ReplayFeeder: write failed" + ENO);
+            break;
+        }
+
+        fed    += len;
+        offset  = (offset + len) % data.size();
+    }
+
+    RunEpilog();
+}
+
+BenchStreamHandler::BenchStreamHandler(const QString &device, int fd) :
+    StreamHandler(device), m_fd(fd),
+    m_bufferSize(0), m_bufferHighWater(0), m_cpuTime(0)
+{
+}
+
+void BenchStreamHandler::run(void)
+{
+    RunProlog();
+
+    int64_t cpustart = thread_cpu_time();
+
+    DeviceReadBuffer *drb = new DeviceReadBuffer(this, true, false);
+    if (!drb->Setup(_device, m_fd))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + "Failed to allocate DRB buffer");
+        delete drb;
+        _error = true;
+        RunEpilog();
+        return;
+    }
+    m_bufferSize = drb->GetSize();
+
+    uint buffer_size = TSPacket::kSize * 15000;
+    unsigned char *buffer = new unsigned char[buffer_size];
+
+    SetRunning(true, true, false);
+
+    drb->Start();
+
+    int remainder = 0;
+    while (_running_desired && !_error)
+    {
+        UpdateFiltersFromStreamData();
+
+        m_bufferHighWater = max(m_bufferHighWater, drb->GetUsed());
+
+        ssize_t len = drb->Read(
+            &(buffer[remainder]), buffer_size - remainder);
+
+        if (!_running_desired)
+            break;
+
+        if (drb->IsErrored() || drb->IsEOF())
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC + "Device error or EOF detected");
+            _error = true;
+        }
+
+        len += remainder;
+
+        if (len < 10) // 10 bytes = 4 bytes TS header + 6 bytes PES header
+        {
+            remainder = len;
+            continue;
+        }
+
+        if (!_listener_lock.tryLock())
+        {
+            remainder = len;
+            continue;
+        }
+
+        if (_stream_data_list.empty())
+        {
+            _listener_lock.unlock();
+            continue;
+        }
+
+        StreamDataList::const_iterator sit = _stream_data_list.begin();
+        for (; sit != _stream_data_list.end(); ++sit)
+            remainder = sit.key()->ProcessData(buffer, len);
+
+        _listener_lock.unlock();
+
+        if (remainder > 0 && (len > remainder)) // leftover bytes
+            memmove(buffer, &(buffer[len - remainder]), remainder);
+    }
+
+    RemoveAllPIDFilters();
+
+    if (drb->IsRunning())
+        drb->Stop();
+
+    delete drb;
+    delete[] buffer;
+
+    m_cpuTime = thread_cpu_time() - cpustart;
+
+    SetRunning(false, true, false);
+    RunEpilog();
+}
+
+BenchRecorder::BenchRecorder(BenchStreamHandler *handler, int program) :
+    DTVRecorder(NULL), m_stream_handler(handler)
+{
+    SetStreamData(new MPEGStreamData(program, -1, false));
+}
+
+void BenchRecorder::run(void)
+{
+    ResetForNewFile();
+
+    {
+        QMutexLocker locker(&pauseLock);
+        request_recording = true;
+        recording = true;
+        recordingWait.wakeAll();
+    }
+
+    _stream_data->AddAVListener(this);
+    _stream_data->AddWritingListener(this);
+    m_stream_handler->AddListener(_stream_data);
+
+    while (IsRecordingRequested() && !IsErrored())
+    {
+        if (PauseAndWait())
+            continue;
+
+        {
+            QMutexLocker locker(&pauseLock);
+            if (!request_recording || request_pause)
+                continue;
+            unpauseWait.wait(&pauseLock, 100);
+        }
+
+        if (_input_pmt && !m_stream_handler->IsRunning())
+            _error = "Stream handler died unexpectedly.";
+    }
+
+    m_stream_handler->RemoveListener(_stream_data);
+    _stream_data->RemoveWritingListener(this);
+    _stream_data->RemoveAVListener(this);
+
+    FinishRecording();
+
+    QMutexLocker locker(&pauseLock);
+    recording = false;
+    recordingWait.wakeAll();
+}
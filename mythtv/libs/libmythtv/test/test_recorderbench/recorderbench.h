@@ -0,0 +1,147 @@
+/*
+ *  Recording pipeline benchmark harness
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef RECORDERBENCH_H_
+#define RECORDERBENCH_H_
+
+#include <stdint.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include "recorders/streamhandler.h"
+#include "recorders/dtvrecorder.h"
+#include "recorders/commflagtap.h"
+#include "mthread.h"
+
+/** \class ReplaySource
+ *  \brief A transport stream held in memory for replaying, either read
+ *         from a captured file or synthesized.
+ */
+class ReplaySource
+{
+  public:
+    ReplaySource() : m_byteRate(0.0), m_program(-1) {}
+
+    bool Load(const QString &filename);
+    void Synthesize(uint seconds, uint bitrate);
+
+    const QString    &GetName(void)     const { return m_name; }
+    const QByteArray &GetData(void)     const { return m_data; }
+    /// Bytes per second at real time, from the PCRs in the stream
+    double            GetByteRate(void) const { return m_byteRate; }
+    /// First program in the PAT, -1 if there is no PAT
+    int               GetProgram(void)  const { return m_program; }
+
+  private:
+    void Analyse(void);
+
+    QString    m_name;
+    QByteArray m_data;
+    double     m_byteRate;
+    int        m_program;
+};
+
+/** \class ReplayFeeder
+ *  \brief Writes a ReplaySource, looping, into a pipe standing in for a
+ *         tuner device.
+ *
+ *  At a speed above zero the stream is paced at that multiple of real
+ *  time and, like a tuner, data which does not fit in the pipe is
+ *  dropped. At speed zero it is written as fast as it is read.
+ */
+class ReplayFeeder : public MThread
+{
+  public:
+    ReplayFeeder(const ReplaySource &source, int fd, double speed);
+
+    void Stop(void) { m_running = false; }
+
+    uint64_t GetPacketsFed(void)     const { return m_packetsFed; }
+    uint64_t GetPacketsDropped(void) const { return m_packetsDropped; }
+
+  protected:
+    virtual void run(void); // MThread
+
+  private:
+    bool WriteFully(const char *data, uint len);
+
+    const ReplaySource &m_source;
+    int                 m_fd;
+    double              m_speed;
+    volatile bool       m_running;
+    uint64_t            m_packetsFed;
+    uint64_t            m_packetsDropped;
+};
+
+/** \class BenchStreamHandler
+ *  \brief Reads a pipe through a DeviceReadBuffer, the same way the
+ *         ASI and DVB stream handlers read their devices.
+ */
+class BenchStreamHandler : public StreamHandler
+{
+  public:
+    BenchStreamHandler(const QString &device, int fd);
+   ~BenchStreamHandler() {}
+
+    virtual void AddListener(MPEGStreamData *data,
+                             bool allow_section_reader = false,
+                             bool needs_drb            = false,
+                             QString output_file       = QString())
+    {
+        StreamHandler::AddListener(data, false, true, output_file);
+    } // StreamHandler
+
+    uint    GetBufferSize(void)      const { return m_bufferSize; }
+    uint    GetBufferHighWater(void) const { return m_bufferHighWater; }
+    /// CPU time used by the handler thread, which also runs the recorder's
+    /// packet processing, in microseconds
+    int64_t GetCPUTime(void)         const { return m_cpuTime; }
+
+  private:
+    virtual void run(void); // MThread
+
+    int     m_fd;
+    uint    m_bufferSize;
+    uint    m_bufferHighWater;
+    int64_t m_cpuTime;
+};
+
+/** \class BenchRecorder
+ *  \brief DTVRecorder fed by a BenchStreamHandler, as ASIRecorder is fed
+ *         by an ASIStreamHandler.
+ */
+class BenchRecorder : public DTVRecorder
+{
+  public:
+    BenchRecorder(BenchStreamHandler *handler, int program);
+
+    virtual void run(void);
+
+    uint GetPacketCount(void) const
+        { return _packet_count.fetchAndAddRelaxed(0); }
+    uint GetContinuityErrorCount(void) const
+        { return _continuity_error_count.fetchAndAddRelaxed(0); }
+    /// NULL unless commercials are flagged as it records
+    CommFlagTap *GetCommFlagTap(void) { return _commflag_tap; }
+
+  private:
+    BenchStreamHandler *m_stream_handler;
+};
+
+#endif
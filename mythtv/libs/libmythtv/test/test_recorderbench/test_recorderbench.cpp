@@ -0,0 +1,3 @@
+#include "test_recorderbench.h"
+
+QTEST_APPLESS_MAIN(TestRecorderBench)
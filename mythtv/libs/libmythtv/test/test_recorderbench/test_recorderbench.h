@@ -0,0 +1,375 @@
+/*
+ *  Class TestRecorderBench
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <QtTest/QtTest>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "recorderbench.h"
+#include "recorders/DeviceReadBuffer.h"
+#include "ringbuffer.h"
+#include "tspacket.h"
+#include "mythcorecontext.h"
+#include "mythmetrics.h"
+#include "mythdb.h"
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#define MSKIP(MSG) QSKIP(MSG, SkipSingle)
+#else
+#define MSKIP(MSG) QSKIP(MSG)
+#endif
+
+/**
+ *  Replays transport streams through DeviceReadBuffer, a StreamHandler,
+ *  MPEGStreamData, DTVRecorder and ThreadedFileWriter, the path every
+ *  DVB, ASI and HDHomeRun recording takes, and reports how it kept up.
+ *
+ *  It is skipped unless MYTHTV_RECBENCH_STREAMS is set. The settings are:
+ *
+ *   MYTHTV_RECBENCH_STREAMS  number of concurrent recordings
+ *   MYTHTV_RECBENCH_FILES    comma separated captured .ts files, used
+ *                            round robin across the recordings, a
+ *                            synthetic stream is used if not set
+ *   MYTHTV_RECBENCH_SPEED    multiple of real time, 0 for as fast as
+ *                            the pipeline will take it (1)
+ *   MYTHTV_RECBENCH_SECONDS  how long to record for (3)
+ *   MYTHTV_RECBENCH_DIR      where to write the recordings (temp dir)
+ *   MYTHTV_RECBENCH_OUTPUT   file to write the JSON results to, they are
+ *                            always printed on a line starting "RECBENCH "
+ *   MYTHTV_RECBENCH_COMMFLAG 1 to flag commercials as it records, and
+ *                            report how far behind live the analysis got
+ *                            and how long it took to catch up once the
+ *                            recording stopped
+ *
+ *  Dropped packets are those the stand in tuner could not hand over
+ *  because the pipeline had not made room for them, and are not counted
+ *  as fed. Continuity errors
+ *  include one per PID each time a captured file loops.
+ */
+class TestRecorderBench: public QObject
+{
+    Q_OBJECT
+
+  private:
+    /// Nothing to pause or to tell about priority data
+    class NullReaderCB : public DeviceReaderCB
+    {
+      public:
+        void ReaderPaused(int) {}
+        void PriorityEvent(int) {}
+    };
+
+    static QString Env(const char *name, const QString &defaultval)
+    {
+        QByteArray value = qgetenv(name);
+        return value.isEmpty() ? defaultval : QString::fromLocal8Bit(value);
+    }
+
+    static double CPUSeconds(void)
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+               usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+
+    static QString JSONString(const QString &str)
+    {
+        QString escaped = str;
+        escaped.replace('\\', "\\\\");
+        escaped.replace('"', "\\\"");
+        return '"' + escaped + '"';
+    }
+
+    class Recording
+    {
+      public:
+        Recording() :
+            source(NULL), ringbuffer(NULL), handler(NULL),
+            recorder(NULL), thread(NULL), feeder(NULL)
+        {
+            fds[0] = fds[1] = -1;
+        }
+
+        const ReplaySource *source;
+        QString             filename;
+        int                 fds[2];
+        RingBuffer         *ringbuffer;
+        BenchStreamHandler *handler;
+        BenchRecorder      *recorder;
+        MThread            *thread;
+        ReplayFeeder       *feeder;
+    };
+
+  private slots:
+    // called at the beginning of these sets of tests
+    void initTestCase(void)
+    {
+        gCoreContext = new MythCoreContext("bin_version", NULL);
+        // Settings come from their defaults, there is no database here
+        gCoreContext->GetDB()->IgnoreDatabase(true);
+    }
+
+    /**
+     * The buffer fill gauge goes back to 0 when the buffer is stopped,
+     * rather than showing whatever was left in it.
+     */
+    void StopClearsBufferGauge(void)
+    {
+        int fds[2];
+        QVERIFY(pipe(fds) == 0);
+
+        QByteArray packets(TSPacket::kSize * 100, 0x47);
+        QCOMPARE(write(fds[1], packets.constData(), packets.size()),
+                 (ssize_t)packets.size());
+
+        NullReaderCB cb;
+        DeviceReadBuffer *drb = new DeviceReadBuffer(&cb, true, false);
+        QVERIFY(drb->Setup("recbench-gauge", fds[0]));
+        MythGauge *used = MythMetrics::Gauge(
+            "mythtv_device_buffer_used_bytes",
+            "Bytes waiting in a device read buffer",
+            MythMetrics::Label("device", "recbench-gauge"));
+
+        drb->Start();
+        QElapsedTimer timer;
+        timer.start();
+        while (drb->GetUsed() < (uint)packets.size() && timer.elapsed() < 5000)
+            usleep(10000);
+        QCOMPARE(drb->GetUsed(), (uint)packets.size());
+        QCOMPARE(used->Value(), (int64_t)packets.size());
+
+        drb->Stop();
+        QCOMPARE(used->Value(), (int64_t)0);
+
+        delete drb;
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    void RecordingPipeline(void)
+    {
+        if (qgetenv("MYTHTV_RECBENCH_STREAMS").isEmpty())
+            MSKIP("Set MYTHTV_RECBENCH_STREAMS to the number of recordings");
+
+        QStringList files = Env("MYTHTV_RECBENCH_FILES", QString())
+            .split(',', QString::SkipEmptyParts);
+        int     streams = Env("MYTHTV_RECBENCH_STREAMS", "2").toInt();
+        double  speed   = Env("MYTHTV_RECBENCH_SPEED", "1").toDouble();
+        int     seconds = Env("MYTHTV_RECBENCH_SECONDS", "3").toInt();
+        QString dir     = Env("MYTHTV_RECBENCH_DIR", QDir::tempPath());
+        QString output  = Env("MYTHTV_RECBENCH_OUTPUT", QString());
+        bool    commflag = Env("MYTHTV_RECBENCH_COMMFLAG", "0").toInt();
+
+        QVERIFY(streams > 0);
+        QVERIFY(seconds > 0);
+
+        QVector<ReplaySource> sources(files.isEmpty() ? 1 : files.size());
+        if (files.isEmpty())
+        {
+            sources[0].Synthesize(4, 8000000);
+        }
+        for (int i = 0; i < files.size(); ++i)
+        {
+            QVERIFY2(sources[i].Load(files[i]),
+                     qPrintable("Unable to read " + files[i]));
+            QVERIFY2(sources[i].GetProgram() > 0,
+                     qPrintable("No PAT found in " + files[i]));
+        }
+
+        // Writer buffers are shared by all recordings, only the total
+        // is available
+        MythGauge *writerBuffered = MythMetrics::Gauge(
+            "mythtv_filewriter_buffered_bytes",
+            "Bytes waiting in file writer buffers to be written to disk");
+
+        QVector<Recording> recs(streams);
+        for (int i = 0; i < streams; ++i)
+        {
+            Recording &rec = recs[i];
+            rec.source   = &sources[i % sources.size()];
+            rec.filename = QString("%1/recbench-%2-%3.ts")
+                .arg(dir).arg(getpid()).arg(i);
+
+            QVERIFY(pipe(rec.fds) == 0);
+            fcntl(rec.fds[1], F_SETFL, O_NONBLOCK);
+#ifdef F_SETPIPE_SZ
+            // About what a DVB demux device buffers
+            fcntl(rec.fds[1], F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
+            rec.ringbuffer = RingBuffer::Create(rec.filename, true, false);
+            QVERIFY(rec.ringbuffer && rec.ringbuffer->IsOpen());
+
+            rec.handler  = new BenchStreamHandler(
+                QString("recbench%1").arg(i), rec.fds[0]);
+            rec.recorder = new BenchRecorder(rec.handler,
+                                             rec.source->GetProgram());
+            rec.recorder->SetRingBuffer(rec.ringbuffer);
+            if (commflag)
+                rec.recorder->SetOption("commflagtap", 1);
+            rec.thread   = new MThread(QString("RecBench%1").arg(i),
+                                       rec.recorder);
+            rec.feeder   = new ReplayFeeder(*rec.source, rec.fds[1], speed);
+        }
+
+        double cpustart = CPUSeconds();
+
+        for (int i = 0; i < streams; ++i)
+        {
+            recs[i].thread->start();
+            while (!recs[i].recorder->IsRecording())
+                usleep(1000);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int i = 0; i < streams; ++i)
+            recs[i].feeder->start();
+
+        int64_t writerHighWater = 0;
+        while (timer.elapsed() < seconds * 1000)
+        {
+            writerHighWater = max(writerHighWater, writerBuffered->Value());
+            usleep(10000);
+        }
+
+        for (int i = 0; i < streams; ++i)
+            recs[i].feeder->Stop();
+        for (int i = 0; i < streams; ++i)
+            recs[i].feeder->wait();
+
+        double wall = timer.nsecsElapsed() / 1e9;
+
+        QVector<double> stopTime(streams);
+        for (int i = 0; i < streams; ++i)
+        {
+            QElapsedTimer stopping;
+            stopping.start();
+            recs[i].recorder->StopRecording();
+            recs[i].thread->wait();
+            stopTime[i] = stopping.nsecsElapsed() / 1e9;
+        }
+
+        double cpu = CPUSeconds() - cpustart;
+
+        QStringList results;
+        uint64_t totalPackets = 0;
+        for (int i = 0; i < streams; ++i)
+        {
+            Recording &rec = recs[i];
+
+            uint packets = rec.recorder->GetPacketCount();
+            totalPackets += packets;
+
+            QString commflagResult;
+            CommFlagTap *tap = rec.recorder->GetCommFlagTap();
+            if (tap)
+            {
+                // As the backend does once the recording has stopped
+                QElapsedTimer catchup;
+                catchup.start();
+                frm_dir_map_t breaks;
+                bool flagged =
+                    tap->GetBreaks(breaks, CommFlagTap::kFinishTimeout);
+                double catchupTime = catchup.nsecsElapsed() / 1e9;
+
+                commflagResult = QString(
+                    ",\"commflag\":{\"frames_seen\":%1,"
+                    "\"frames_analysed\":%2,\"frames_dropped\":%3,"
+                    "\"blank_frames\":%4,\"max_lag_sec\":%5,"
+                    "\"catchup_sec\":%6,\"flagged\":%7}")
+                    .arg(tap->GetFramesSeen())
+                    .arg(tap->GetFramesAnalysed())
+                    .arg(tap->GetFramesDropped())
+                    .arg(tap->GetBlankFrames())
+                    .arg(tap->GetMaxLag(), 0, 'f', 3)
+                    .arg(catchupTime, 0, 'f', 3)
+                    .arg(flagged ? "true" : "false");
+            }
+
+            results << QString(
+                "{\"source\":%1,\"packets_fed\":%2,\"packets_dropped\":%3,"
+                "\"packets_recorded\":%4,\"packets_per_sec\":%5,"
+                "\"continuity_errors\":%6,\"frames_written\":%7,"
+                "\"bytes_written\":%8,\"device_buffer_size\":%9,"
+                "\"device_buffer_high_water\":%10,"
+                "\"handler_cpu_sec\":%11,\"stop_sec\":%12%13}")
+                .arg(JSONString(rec.source->GetName()))
+                .arg(rec.feeder->GetPacketsFed())
+                .arg(rec.feeder->GetPacketsDropped())
+                .arg(packets)
+                .arg(packets / wall, 0, 'f', 1)
+                .arg(rec.recorder->GetContinuityErrorCount())
+                .arg(rec.recorder->GetFramesWritten())
+                .arg(rec.ringbuffer->GetWritePosition())
+                .arg(rec.handler->GetBufferSize())
+                .arg(rec.handler->GetBufferHighWater())
+                .arg(rec.handler->GetCPUTime() / 1e6, 0, 'f', 3)
+                .arg(stopTime[i], 0, 'f', 3)
+                .arg(commflagResult);
+
+            delete rec.feeder;
+            delete rec.thread;
+            delete rec.recorder;
+            delete rec.handler;
+            delete rec.ringbuffer;
+            close(rec.fds[0]);
+            close(rec.fds[1]);
+            QFile::remove(rec.filename);
+        }
+
+        QString json = QString(
+            "{\"streams\":%1,\"speed\":%2,\"seconds\":%3,"
+            "\"packets_per_sec\":%4,\"process_cpu_sec\":%5,"
+            "\"cpu_per_stream\":%6,\"writer_buffer_high_water\":%7,"
+            "\"recordings\":[%8]}")
+            .arg(streams).arg(speed).arg(wall, 0, 'f', 3)
+            .arg(totalPackets / wall, 0, 'f', 1)
+            .arg(cpu, 0, 'f', 3)
+            .arg(cpu / wall / streams, 0, 'f', 4)
+            .arg(writerHighWater)
+            .arg(results.join(","));
+
+        printf("RECBENCH %s\n", json.toUtf8().constData());
+
+        if (!output.isEmpty())
+        {
+            QFile file(output);
+            QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+            file.write(json.toUtf8() + '\n');
+        }
+
+        QVERIFY(totalPackets > 0);
+    }
+
+    // called at the end of these sets of tests
+    void cleanupTestCase(void)
+    {
+        delete gCoreContext;
+        gCoreContext = NULL;
+    }
+};
@@ -20,6 +20,7 @@
 #include "storagegroup.h"
 #include "tvremoteutil.h"
 #include "dtvrecorder.h"
+#include "commflagtap.h"
 #include "livetvchain.h"
 #include "programinfo.h"
 #include "mythlogging.h"
@@ -51,7 +52,9 @@ QMap<uint,TVRec*> TVRec::inputs;
 
 static bool is_dishnet_eit(uint inputid);
 static int init_jobs(const RecordingInfo *rec, RecordingProfile &profile,
-                     bool on_host, bool transcode_bfr_comm, bool on_line_comm);
+                     bool on_host, bool transcode_bfr_comm, bool on_line_comm,
+                     bool in_recorder_comm);
+static void queue_live_commflag(const RecordingInfo *rec, bool on_host);
 static void apply_broken_dvb_driver_crc_hack(ChannelBase*, MPEGStreamData*);
 static int eit_start_rand(uint inputid, int eitTransportTimeout);
 
@@ -91,7 +94,8 @@ TVRec::TVRec(int _inputid)
       recorderThread(NULL),
       // Configuration variables from database
       transcodeFirst(false),
-      earlyCommFlag(false),         runJobOnHostOnly(false),
+      earlyCommFlag(false),         commFlagInRecorder(false),
+      runJobOnHostOnly(false),
       eitCrawlIdleStart(60),        eitTransportTimeout(5*60),
       audioSampleRateDB(0),
       overRecordSecNrml(0),         overRecordSecCat(0),
@@ -112,6 +116,7 @@ TVRec::TVRec(int _inputid)
       m_recStatus(RecStatus::Unknown),
       // Current recording info
       curRecording(NULL),
+      commFlagTap(NULL),
       overrecordseconds(0),
       // Pseudo LiveTV recording
       pseudoLiveTVRecording(NULL),
@@ -165,6 +170,7 @@ bool TVRec::Init(void)
     transcodeFirst    =
         gCoreContext->GetNumSetting("AutoTranscodeBeforeAutoCommflag", 0);
     earlyCommFlag     = gCoreContext->GetNumSetting("AutoCommflagWhileRecording", 0);
+    commFlagInRecorder = gCoreContext->GetNumSetting("CommFlagInRecorder", 0);
     runJobOnHostOnly  = gCoreContext->GetNumSetting("JobsRunOnRecordHost", 0);
     eitTransportTimeout =
         max(gCoreContext->GetNumSetting("EITTransportTimeout", 5) * 60, 6);
@@ -995,6 +1001,14 @@ void TVRec::FinishedRecording(RecordingInfo *curRec, RecordingQuality *recq)
         JobQueue::RemoveJobsFromMask(JOB_COMMFLAG,  *autoJob);
         JobQueue::RemoveJobsFromMask(JOB_TRANSCODE, *autoJob);
     }
+    if (commFlagTap && JobQueue::JobIsInMask(JOB_COMMFLAG, *autoJob))
+    {
+        // The recorder flagged it, the job is queued later only if the
+        // commercials it found can't be saved
+        JobQueue::RemoveJobsFromMask(JOB_COMMFLAG, *autoJob);
+        CommFlagTap::SaveInBackground(commFlagTap, *curRec);
+        commFlagTap = NULL;
+    }
     if (*autoJob != JOB_NONE)
         JobQueue::QueueRecordingJobs(*curRec, *autoJob);
     autoRunJobs.erase(autoJob);
@@ -1140,6 +1154,11 @@ void TVRec::TeardownRecorder(uint request_flags)
 
         recq = recorder->GetRecordingQuality(curRecording);
 
+        // FinishedRecording() saves the commercials if the recorder
+        // flagged them, instead of queueing the job
+        if (curRecording && GetDTVRecorder())
+            commFlagTap = GetDTVRecorder()->TakeCommFlagTap();
+
         QMutexLocker locker(&stateChangeLock);
         delete recorder;
         recorder = NULL;
@@ -1163,6 +1182,10 @@ void TVRec::TeardownRecorder(uint request_flags)
         curRecording = NULL;
     }
 
+    // Left over if FinishedRecording() didn't queue any jobs
+    delete commFlagTap;
+    commFlagTap = NULL;
+
     pauseNotify = true;
 
     if (GetDTVChannel())
@@ -2778,7 +2801,7 @@ void TVRec::InitAutoRunJobs(RecordingInfo *rec, AutoRunInitType t,
         }
         autoRunJobs[rec->MakeUniqueKey()] =
             init_jobs(rec, *recpro, runJobOnHostOnly,
-                      transcodeFirst, earlyCommFlag);
+                      transcodeFirst, earlyCommFlag, commFlagInRecorder);
     }
     else
     {
@@ -4068,7 +4091,8 @@ MPEGStreamData *TVRec::TuningSignalCheck(void)
 }
 
 static int init_jobs(const RecordingInfo *rec, RecordingProfile &profile,
-                      bool on_host, bool transcode_bfr_comm, bool on_line_comm)
+                      bool on_host, bool transcode_bfr_comm, bool on_line_comm,
+                      bool in_recorder_comm)
 {
     if (!rec)
         return 0; // no jobs for Live TV recordings..
@@ -4109,14 +4133,13 @@ static int init_jobs(const RecordingInfo *rec, RecordingProfile &profile,
     // we need to be allowed to commercial flag before transcoding?
     rt &= JobQueue::JobIsNotInMask(JOB_TRANSCODE, jobs) ||
         !transcode_bfr_comm;
+    // the recorder flags it as it records instead, when it can, which
+    // TuningNewRecorder() only knows once it has made the recorder, so
+    // the real-time job is queued there if it can't
+    rt &= !in_recorder_comm;
     if (rt)
     {
-        // queue up real-time (i.e. on-line) commercial flagging.
-        QString host = (on_host) ? gCoreContext->GetHostName() : "";
-        JobQueue::QueueJob(JOB_COMMFLAG,
-                           rec->GetChanID(),
-                           rec->GetRecordingStartTime(), "", "",
-                           host, JOB_LIVE_REC);
+        queue_live_commflag(rec, on_host);
 
         // don't do regular comm flagging, we won't need it.
         JobQueue::RemoveJobsFromMask(JOB_COMMFLAG, jobs);
@@ -4125,6 +4148,16 @@ static int init_jobs(const RecordingInfo *rec, RecordingProfile &profile,
     return jobs;
 }
 
+/// Queues up real-time (i.e. on-line) commercial flagging of \p rec
+static void queue_live_commflag(const RecordingInfo *rec, bool on_host)
+{
+    QString host = (on_host) ? gCoreContext->GetHostName() : "";
+    JobQueue::QueueJob(JOB_COMMFLAG,
+                       rec->GetChanID(),
+                       rec->GetRecordingStartTime(), "", "",
+                       host, JOB_LIVE_REC);
+}
+
 QString TVRec::LoadProfile(void *tvchain, RecordingInfo *rec,
                            RecordingProfile &profile)
 {
@@ -4280,6 +4313,30 @@ void TVRec::TuningNewRecorder(MPEGStreamData *streamData)
     if (rec)
         recorder->SetRecording(rec);
 
+    // Flag commercials as it records, if they are to be flagged before
+    // anything else changes the file. This must be set before the stream
+    // data, which may hand over a cached PMT straight away. Only the DTV
+    // recorders can, for the others the real-time job init_jobs() left
+    // to the recorder is queued as it would have been without it.
+    if (rec && commFlagInRecorder)
+    {
+        QHash<QString,int>::iterator autoJob =
+            autoRunJobs.find(rec->MakeUniqueKey());
+        if ((autoJob != autoRunJobs.end()) &&
+            JobQueue::JobIsInMask(JOB_COMMFLAG, *autoJob) &&
+            (JobQueue::JobIsNotInMask(JOB_TRANSCODE, *autoJob) ||
+             !transcodeFirst))
+        {
+            if (GetDTVRecorder())
+                recorder->SetOption("commflagtap", 1);
+            else if (earlyCommFlag)
+            {
+                queue_live_commflag(rec, runJobOnHostOnly);
+                JobQueue::RemoveJobsFromMask(JOB_COMMFLAG, *autoJob);
+            }
+        }
+    }
+
     if (GetDTVRecorder() && streamData)
     {
         const Setting *setting = profile.byName("recordingtype");
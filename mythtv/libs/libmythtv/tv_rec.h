@@ -40,6 +40,7 @@ class LiveTVChain;
 
 class RecorderBase;
 class DTVRecorder;
+class CommFlagTap;
 class DVBRecorder;
 class HDHRRecorder;
 class ASIRecorder;
@@ -360,6 +361,7 @@ class MTV_PUBLIC TVRec : public SignalMonitorListener, public QRunnable
     // Configuration variables from database
     bool    transcodeFirst;
     bool    earlyCommFlag;
+    bool    commFlagInRecorder;
     bool    runJobOnHostOnly;
     int     eitCrawlIdleStart;
     int     eitTransportTimeout;
@@ -405,6 +407,7 @@ class MTV_PUBLIC TVRec : public SignalMonitorListener, public QRunnable
     RecordingInfo *curRecording;
     QDateTime    recordEndTime;
     QHash<QString,int> autoRunJobs; // RecordingInfo::MakeUniqueKey()->autoRun
+    CommFlagTap *commFlagTap; // flagged as it recorded, to be saved
     int          overrecordseconds;
 
     // Pending recording info
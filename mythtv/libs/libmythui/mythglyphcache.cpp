@@ -0,0 +1,406 @@
+// QT headers
+#include <QPainter>
+#include <QTextLayout>
+#include <QRawFont>
+#include <QFontMetrics>
+#include <QtCore/qmath.h>
+
+// libmythbase headers
+#include "mythlogging.h"
+
+// libmythui headers
+#include "mythfontproperties.h"
+#include "mythimage.h"
+
+// Own header
+#include "mythglyphcache.h"
+
+#define LOC QString("GlyphCache: ")
+
+// Small enough to be a cheap texture upload when a page gains glyphs
+static const int kPageSize = 512;
+// Once every page is full the whole atlas is thrown away and refilled
+static const int kMaxPages = 6;
+// Number of shaped strings kept for DrawText()
+static const int kMaxRuns  = 4096;
+// Empty border kept around every glyph to avoid bleeding when scaled
+static const int kPadding  = 1;
+
+MythGlyphCache::MythGlyphCache(MythPainter *parent)
+  : m_parent(parent), m_cursorX(0), m_cursorY(0), m_shelfHeight(0),
+    m_runs(kMaxRuns),
+    m_runHits(0), m_runMisses(0), m_runEvictions(0), m_atlasResets(0),
+    m_fallbacks(0)
+{
+}
+
+MythGlyphCache::~MythGlyphCache()
+{
+    Clear();
+}
+
+void MythGlyphCache::Clear(void)
+{
+    for (int i = 0; i < m_pages.size(); ++i)
+        m_pages[i]->DecrRef();
+    m_pages.clear();
+
+    m_glyphs.clear();
+    m_faces.clear();
+    m_runs.clear();
+
+    m_cursorX = m_cursorY = m_shelfHeight = 0;
+}
+
+bool MythGlyphCache::CanDraw(const MythFontProperties &font)
+{
+    return !font.hasOutline() && !font.hasShadow() &&
+           font.GetBrush().style() == Qt::SolidPattern;
+}
+
+/**
+ *  \brief Draw a single line of plain text, shaping it only on first use
+ *
+ *  Follows the placement used by MythPainter::DrawTextPriv(), including
+ *  centering the line vertically when the rect is taller than the font.
+ *  Returns false if the caller must fall back to the string image cache.
+ */
+bool MythGlyphCache::DrawText(const QRect &r, const QString &msg, int flags,
+                              const MythFontProperties &font, int alpha,
+                              const QRect &boundRect)
+{
+    if (msg.isEmpty() || !CanDraw(font) || (flags & Qt::TextWordWrap) ||
+        msg.contains('\n'))
+    {
+        ++m_fallbacks;
+        return false;
+    }
+
+    QRgb color = font.color().rgba();
+    QString key = font.GetHash() + QString::number(color) + msg;
+
+    ShapedRun *run = m_runs.object(key);
+    if (run)
+        ++m_runHits;
+    else
+    {
+        ++m_runMisses;
+
+        QFont face = font.face();
+        face.setStyleStrategy(QFont::OpenGLCompatible);
+
+        QTextLayout layout(msg, face);
+        layout.setCacheEnabled(true);
+        layout.beginLayout();
+        QTextLine line = layout.createLine();
+        layout.endLayout();
+
+        if (!line.isValid())
+        {
+            ++m_fallbacks;
+            return false;
+        }
+
+        run = new ShapedRun;
+        run->size = QSize(qRound(line.naturalTextWidth()),
+                          QFontMetrics(face).height());
+
+        QList<QGlyphRun> glyphRuns = layout.glyphRuns();
+        if (!Place(glyphRuns, color, QPointF(0, 0), run->glyphs) &&
+            !Place(glyphRuns, color, QPointF(0, 0), run->glyphs))
+        {
+            delete run;
+            ++m_fallbacks;
+            return false;
+        }
+
+        int before = m_runs.count();
+        m_runs.insert(key, run);
+        m_runEvictions += qMax(before + 1 - m_runs.count(), 0);
+    }
+
+    // Same vertical padding as DrawTextPriv()
+    int padY = (r.height() - run->size.height()) / 2;
+    QRect area(r.x(), r.y() + padY, r.width(), r.height());
+
+    int x = area.x();
+    if (flags & Qt::AlignRight)
+        x = area.right() + 1 - run->size.width();
+    else if (flags & Qt::AlignHCenter)
+        x = area.x() + (area.width() - run->size.width()) / 2;
+
+    int y = area.y();
+    if (flags & Qt::AlignBottom)
+        y = area.bottom() + 1 - run->size.height();
+    else if (flags & Qt::AlignVCenter)
+        y = area.y() + (area.height() - run->size.height()) / 2;
+
+    QRect clip = r;
+    if (!boundRect.isEmpty())
+        clip = clip.intersected(boundRect);
+
+    Draw(run->glyphs, QPoint(x, y), clip, alpha);
+    return true;
+}
+
+/**
+ *  \brief Draw already laid out paragraphs, as used by MythUIText
+ *
+ *  Mirrors MythPainter::GetImageFromTextLayout(): the layouts are drawn at
+ *  the canvas offset and the result is clipped to the destination size.
+ */
+bool MythGlyphCache::DrawTextLayout(const QRect &canvasRect,
+                                    const LayoutVector &layouts,
+                                    const FormatVector &formats,
+                                    const MythFontProperties &font, int alpha,
+                                    const QRect &destRect)
+{
+    if (!formats.isEmpty() || !CanDraw(font))
+    {
+        ++m_fallbacks;
+        return false;
+    }
+
+    QRgb color = font.color().rgba();
+    QPoint origin = destRect.topLeft() + canvasRect.topLeft();
+    QRect clip(destRect.topLeft(),
+               QSize(qMin(canvasRect.width(), destRect.width()),
+                     qMin(canvasRect.height(), destRect.height())));
+
+    QVector<PlacedGlyph> placed;
+    LayoutVector::const_iterator it;
+    for (it = layouts.begin(); it != layouts.end(); ++it)
+    {
+        QList<QGlyphRun> glyphRuns = (*it)->glyphRuns();
+        QPointF position = (*it)->position();
+
+        placed.clear();
+        if (!Place(glyphRuns, color, position, placed) &&
+            !Place(glyphRuns, color, position, placed))
+        {
+            ++m_fallbacks;
+            return false;
+        }
+
+        Draw(placed, origin, clip, alpha);
+    }
+
+    return true;
+}
+
+/**
+ *  \brief Look up (adding when missing) every glyph of the runs
+ *
+ *  Returns false if the atlas had to be reset part way through, in which
+ *  case glyphs placed earlier are gone and the caller should try again.
+ */
+bool MythGlyphCache::Place(const QList<QGlyphRun> &runs, QRgb color,
+                           const QPointF &origin,
+                           QVector<PlacedGlyph> &placed)
+{
+    uint64_t resets = m_atlasResets;
+    placed.clear();
+
+    QList<QGlyphRun>::const_iterator it;
+    for (it = runs.begin(); it != runs.end(); ++it)
+    {
+        QRawFont rawFont = (*it).rawFont();
+        QString faceKey = QString("%1|%2|%3|%4|%5")
+            .arg(rawFont.familyName()).arg(rawFont.styleName())
+            .arg(rawFont.pixelSize()).arg(rawFont.weight()).arg(color);
+
+        QVector<quint32> indexes   = (*it).glyphIndexes();
+        QVector<QPointF> positions = (*it).positions();
+
+        for (int i = 0; i < indexes.size() && i < positions.size(); ++i)
+        {
+            int glyph = m_faces[faceKey].value(indexes[i], -1);
+            if (glyph < 0)
+            {
+                glyph = AddGlyph(rawFont, indexes[i], color);
+                if (glyph < 0 || resets != m_atlasResets)
+                    return false;
+                m_faces[faceKey].insert(indexes[i], glyph);
+            }
+
+            if (m_glyphs[glyph].page >= 0)
+            {
+                QPointF pos = origin + positions[i];
+                placed.append(PlacedGlyph(glyph, pos.toPoint()));
+            }
+        }
+    }
+
+    return true;
+}
+
+int MythGlyphCache::AddGlyph(const QRawFont &rawFont, quint32 index,
+                             QRgb color)
+{
+    qreal ascent  = rawFont.ascent();
+    qreal descent = rawFont.descent();
+
+    QVector<QPointF> advances =
+        rawFont.advancesForGlyphIndexes(QVector<quint32>() << index);
+    qreal advance = advances.isEmpty() ? 0 : advances[0].x();
+
+    // Leave room for glyphs reaching outside their advance
+    int margin = qCeil(ascent / 2) + 1;
+    int width  = qCeil(advance) + (2 * margin);
+    int height = qCeil(ascent + descent) + (2 * margin);
+
+    if (width <= 0 || height <= 0)
+        return -1;
+
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(0);
+
+    QGlyphRun run;
+    run.setRawFont(rawFont);
+    run.setGlyphIndexes(QVector<quint32>() << index);
+    run.setPositions(QVector<QPointF>() << QPointF(margin, margin + ascent));
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QColor::fromRgba(color));
+    painter.drawGlyphRun(QPointF(0, 0), run);
+    painter.end();
+
+    // Trim to the pixels actually covered
+    int left = width, right = -1, top = height, bottom = -1;
+    for (int y = 0; y < height; ++y)
+    {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < width; ++x)
+        {
+            if (!qAlpha(line[x]))
+                continue;
+            left   = qMin(left, x);
+            right  = qMax(right, x);
+            top    = qMin(top, y);
+            bottom = qMax(bottom, y);
+        }
+    }
+
+    Glyph glyph;
+
+    if (right >= 0)
+    {
+        QRect used(left, top, right - left + 1, bottom - top + 1);
+        glyph.offset = QPoint(left - margin, top - margin - qRound(ascent));
+
+        if (!AddToAtlas(image.copy(used), glyph))
+            return -1;
+    }
+
+    m_glyphs.append(glyph);
+    return m_glyphs.size() - 1;
+}
+
+bool MythGlyphCache::AddToAtlas(const QImage &image, Glyph &glyph)
+{
+    int width  = image.width() + kPadding;
+    int height = image.height() + kPadding;
+
+    if (width > kPageSize || height > kPageSize)
+        return false;
+
+    if (!m_pages.isEmpty() && m_cursorX + width > kPageSize)
+    {
+        m_cursorX = 0;
+        m_cursorY += m_shelfHeight;
+        m_shelfHeight = 0;
+    }
+
+    if (m_pages.isEmpty() || m_cursorY + height > kPageSize)
+    {
+        if (m_pages.size() >= kMaxPages)
+        {
+            LOG(VB_GUI, LOG_INFO, LOC +
+                QString("Atlas full (%1 glyphs), starting over")
+                    .arg(m_glyphs.size()));
+            Clear();
+            ++m_atlasResets;
+        }
+
+        QImage blank(kPageSize, kPageSize,
+                     QImage::Format_ARGB32_Premultiplied);
+        blank.fill(0);
+
+        MythImage *page = m_parent->GetFormatImage();
+        page->SetFileName(QString("GlyphAtlas: %1").arg(m_pages.size()));
+        page->Assign(blank);
+        m_pages.append(page);
+
+        m_cursorX = m_cursorY = m_shelfHeight = 0;
+    }
+
+    MythImage *page = m_pages.last();
+
+    QPainter painter(page);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(m_cursorX, m_cursorY, image);
+    painter.end();
+    page->SetChanged();
+
+    glyph.page = m_pages.size() - 1;
+    glyph.src  = QRect(QPoint(m_cursorX, m_cursorY), image.size());
+
+    m_cursorX += width;
+    m_shelfHeight = qMax(m_shelfHeight, height);
+
+    return true;
+}
+
+/**
+ *  \brief Draw the glyphs with one DrawImages() call per atlas page
+ *
+ *  Drawing glyph by glyph costs the painter's per image overhead for every
+ *  character, which is more than the string image path saves.
+ */
+void MythGlyphCache::Draw(const QVector<PlacedGlyph> &glyphs,
+                          const QPoint &origin, const QRect &clip, int alpha)
+{
+    QVector<QVector<QRect> > dests(m_pages.size());
+    QVector<QVector<QRect> > srcs(m_pages.size());
+
+    QVector<PlacedGlyph>::const_iterator it;
+    for (it = glyphs.begin(); it != glyphs.end(); ++it)
+    {
+        const Glyph &glyph = m_glyphs[(*it).glyph];
+
+        QRect dest(origin + (*it).pos + glyph.offset, glyph.src.size());
+        QRect visible = dest.intersected(clip);
+        if (visible.isEmpty())
+            continue;
+
+        QRect src(glyph.src.topLeft() + (visible.topLeft() - dest.topLeft()),
+                  visible.size());
+        dests[glyph.page].append(visible);
+        srcs[glyph.page].append(src);
+    }
+
+    for (int page = 0; page < m_pages.size(); ++page)
+    {
+        if (!dests[page].isEmpty())
+            m_parent->DrawImages(m_pages[page], dests[page], srcs[page],
+                                 alpha);
+    }
+}
+
+QStringList MythGlyphCache::GetStats(void) const
+{
+    int used = m_pages.isEmpty() ? 0 :
+        (100 * (m_cursorY + m_shelfHeight)) / kPageSize;
+
+    QStringList stats;
+    stats << QString("Glyph atlas: %1 pages (last %2% full) %3 glyphs "
+                     "%4 resets")
+                 .arg(m_pages.size()).arg(used).arg(m_glyphs.size())
+                 .arg(m_atlasResets);
+    stats << QString("Text runs: %1 cached %2 hits %3 misses %4 evicted "
+                     "%5 fallbacks")
+                 .arg(m_runs.count()).arg(m_runHits).arg(m_runMisses)
+                 .arg(m_runEvictions).arg(m_fallbacks);
+    return stats;
+}
@@ -0,0 +1,104 @@
+#ifndef MYTHGLYPHCACHE_H_
+#define MYTHGLYPHCACHE_H_
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QCache>
+#include <QRect>
+#include <QPoint>
+#include <QGlyphRun>
+
+#include "mythpainter.h"
+
+class MythImage;
+class MythFontProperties;
+
+/**
+ *  \class MythGlyphCache
+ *
+ *  \brief Draws plain text by compositing glyphs from a shared atlas.
+ *
+ *  The string cache in MythPainter renders every distinct string into its
+ *  own image, so scrolling through guide cells or recording titles keeps
+ *  rasterizing new strings and evicting old ones. This cache instead keeps
+ *  each glyph once (per font and colour) in a few atlas images and keeps
+ *  the shaped glyph positions of recently drawn strings, so drawing a new
+ *  string only rasterizes glyphs that have never been seen before.
+ *
+ *  Only plain text is handled: fonts with an outline, a shadow or a non
+ *  solid brush, word wrapped text and formatted layouts are left to the
+ *  existing image based path.
+ */
+class MythGlyphCache
+{
+  public:
+    explicit MythGlyphCache(MythPainter *parent);
+   ~MythGlyphCache();
+
+    bool DrawText(const QRect &r, const QString &msg, int flags,
+                  const MythFontProperties &font, int alpha,
+                  const QRect &boundRect);
+    bool DrawTextLayout(const QRect &canvasRect, const LayoutVector &layouts,
+                        const FormatVector &formats,
+                        const MythFontProperties &font, int alpha,
+                        const QRect &destRect);
+
+    QStringList GetStats(void) const;
+
+  private:
+    class Glyph
+    {
+      public:
+        Glyph() : page(-1) {}
+        int    page;   ///< atlas page, -1 for glyphs with no pixels
+        QRect  src;    ///< location within the page
+        QPoint offset; ///< top left relative to the pen position
+    };
+
+    class PlacedGlyph
+    {
+      public:
+        PlacedGlyph() : glyph(-1) {}
+        PlacedGlyph(int g, const QPoint &p) : glyph(g), pos(p) {}
+        int    glyph;
+        QPoint pos;
+    };
+
+    class ShapedRun
+    {
+      public:
+        QVector<PlacedGlyph> glyphs;
+        QSize                size;
+    };
+
+    static bool CanDraw(const MythFontProperties &font);
+    bool Place(const QList<QGlyphRun> &runs, QRgb color,
+               const QPointF &origin, QVector<PlacedGlyph> &placed);
+    int  AddGlyph(const QRawFont &rawFont, quint32 index, QRgb color);
+    bool AddToAtlas(const QImage &image, Glyph &glyph);
+    void Draw(const QVector<PlacedGlyph> &glyphs, const QPoint &origin,
+              const QRect &clip, int alpha);
+    void Clear(void);
+
+    MythPainter         *m_parent;
+
+    QVector<MythImage *> m_pages;
+    int                  m_cursorX;
+    int                  m_cursorY;
+    int                  m_shelfHeight;
+
+    QVector<Glyph>       m_glyphs;
+    /// (raw font, colour) -> glyph index -> entry in m_glyphs
+    QHash<QString, QHash<quint32, int> > m_faces;
+    QCache<QString, ShapedRun> m_runs;
+
+    uint64_t m_runHits;
+    uint64_t m_runMisses;
+    uint64_t m_runEvictions;
+    uint64_t m_atlasResets;
+    uint64_t m_fallbacks;
+};
+
+#endif
@@ -19,6 +19,7 @@ using namespace std;
 #include <QTimer>
 #include <QDesktopWidget>
 #include <QHash>
+#include <QSet>
 #include <QFile>
 #include <QDir>
 #include <QEvent>
@@ -46,6 +47,7 @@ using namespace std;
 #include "mythmedia.h"
 #include "mythmiscutil.h"
 #include "mythdate.h"
+#include "mythtimer.h"
 
 // libmythui headers
 #include "myththemebase.h"
@@ -58,6 +60,7 @@ using namespace std;
 #include "mythuiactions.h"
 #include "mythrect.h"
 #include "mythuidefines.h"
+#include "mythfontproperties.h"
 
 #ifdef USING_APPLEREMOTE
 #include "AppleRemoteListener.h"
@@ -80,6 +83,7 @@ using namespace std;
 #include "mythpainter_qt.h"
 #include "mythgesture.h"
 #include "mythuihelper.h"
+#include "mythuiimage.h"
 #include "mythdialogbox.h"
 
 #ifdef _WIN32
@@ -126,6 +130,81 @@ struct MPData {
     MediaPlayCallback playFn;
 };
 
+/// Paint timings shown by the frame statistics overlay
+class FrameStats
+{
+  public:
+    enum { kBuckets = 8 };
+
+    FrameStats() { Reset(); }
+
+    void Reset(void)
+    {
+        painted = idle = layerHits = layerBuilds = layerDrops = 0;
+        layersHeld = 0;
+        layerBytes = 0;
+        for (int i = 0; i < kBuckets; ++i)
+            histogram[i] = 0;
+    }
+
+    /// Bucket i counts frames taking less than 2^i ms, the last the rest
+    void AddFrame(int64_t usecs)
+    {
+        int bucket = 0;
+        for (int64_t ms = usecs / 1000; ms > 0 && bucket < kBuckets - 1;
+             ms >>= 1)
+            ++bucket;
+
+        ++histogram[bucket];
+        ++painted;
+    }
+
+    QStringList Describe(void) const
+    {
+        QStringList lines;
+        lines << QString("Frames painted: %1  idle ticks: %2")
+                     .arg(painted).arg(idle);
+        lines << QString("Layer blits: %1  layer builds: %2")
+                     .arg(layerHits).arg(layerBuilds);
+        lines << QString("Layers held: %1 (%2 KB)  dropped: %3")
+                     .arg(layersHeld).arg(layerBytes / 1024).arg(layerDrops);
+
+        for (int i = 0; i < kBuckets; ++i)
+        {
+            QString label = (i < kBuckets - 1) ?
+                QString("< %1 ms").arg(1 << i) :
+                QString(">= %1 ms").arg(1 << (kBuckets - 2));
+            lines << QString("%1: %2").arg(label, 9).arg(histogram[i]);
+        }
+
+        return lines;
+    }
+
+    uint64_t painted;
+    uint64_t idle;
+    uint64_t layerHits;
+    uint64_t layerBuilds;
+    uint64_t layerDrops;  ///< layers thrown away because their screen redrew
+    int      layersHeld;  ///< layers with an image, as of the last draw
+    int64_t  layerBytes;  ///< memory of those images
+    uint64_t histogram[kBuckets];
+};
+
+/**
+ *  A cached rendering of a whole screen. Screens below the top of the
+ *  stack rarely change, so once they have been clean for a while they are
+ *  drawn once into an image and then composited with a single blit until
+ *  they mark themselves dirty again.
+ */
+class ScreenLayer
+{
+  public:
+    ScreenLayer() : image(NULL), cleanTicks(0) {}
+
+    MythImage *image;
+    int        cleanTicks;
+};
+
 class MythMainWindowPrivate
 {
   public:
@@ -192,6 +271,9 @@ class MythMainWindowPrivate
 
         m_pendingUpdate(false),
 
+        useLayers(false),
+        showFrameStats(false),
+
         idleTimer(NULL),
         idleTime(0),
         standby(false),
@@ -205,6 +287,12 @@ class MythMainWindowPrivate
 
     int TranslateKeyNum(QKeyEvent *e);
 
+    void InvalidateLayer(ScreenLayer &layer, bool redrawn = false);
+    void ClearLayers(void);
+    void BuildLayers(MythPainter *p, const QVector<MythScreenType *> &screens);
+    QRect FrameStatsRect(void) const;
+    void DrawFrameStats(MythPainter *p);
+
     float wmult, hmult;
     int screenwidth, screenheight;
 
@@ -290,6 +378,12 @@ class MythMainWindowPrivate
 
     bool m_pendingUpdate;
 
+    QHash<MythScreenType *, ScreenLayer> layers;
+    bool useLayers;
+    FrameStats frameStats;
+    bool showFrameStats;
+    MythTimer frameStatsTimer;
+
     QTimer *idleTimer;
     int  idleTime;
     bool standby;
@@ -331,6 +425,120 @@ int MythMainWindowPrivate::TranslateKeyNum(QKeyEvent* e)
     return keynum;
 }
 
+// Screens must stay clean for this many draw ticks before being retained
+static const int kLayerSettleTicks = 10;
+// Each layer holds a full screen image, so keep the number bounded
+static const int kMaxLayers = 4;
+
+/// Throws away the image of \p layer, \p redrawn when it is because its
+/// screen has changed rather than gone away
+void MythMainWindowPrivate::InvalidateLayer(ScreenLayer &layer, bool redrawn)
+{
+    if (layer.image && redrawn)
+        ++frameStats.layerDrops;
+    if (layer.image)
+        layer.image->DecrRef();
+    layer.image = NULL;
+    layer.cleanTicks = 0;
+}
+
+void MythMainWindowPrivate::ClearLayers(void)
+{
+    QHash<MythScreenType *, ScreenLayer>::iterator it = layers.begin();
+    for (; it != layers.end(); ++it)
+        InvalidateLayer(*it);
+    layers.clear();
+}
+
+/**
+ *  Render any screen that has settled into its own layer. The topmost
+ *  screen is never retained since that is where input, and therefore
+ *  most of the changes, happen.
+ */
+void MythMainWindowPrivate::BuildLayers(MythPainter *p,
+                                        const QVector<MythScreenType *> &screens)
+{
+    int count = 0;
+
+    for (int i = 0; i < screens.size() - 1 && count < kMaxLayers; ++i)
+    {
+        QHash<MythScreenType *, ScreenLayer>::iterator it =
+            layers.find(screens[i]);
+        if (it == layers.end())
+            continue;
+
+        ScreenLayer &layer = *it;
+
+        if (screens[i]->NeedsRedraw())
+        {
+            InvalidateLayer(layer, true);
+            continue;
+        }
+
+        if (!layer.image && layer.cleanTicks >= kLayerSettleTicks)
+        {
+            QSize size(uiScreenRect.right() + 1, uiScreenRect.bottom() + 1);
+            QImage blank(size, QImage::Format_ARGB32_Premultiplied);
+            blank.fill(0);
+
+            layer.image = p->GetFormatImage();
+            layer.image->Assign(blank);
+
+            p->Begin(layer.image);
+            screens[i]->Draw(p, 0, 0, 255, uiScreenRect);
+            p->End();
+
+            layer.image->SetChanged();
+            ++frameStats.layerBuilds;
+        }
+
+        if (layer.image)
+            ++count;
+    }
+
+    frameStats.layersHeld = 0;
+    frameStats.layerBytes = 0;
+    QHash<MythScreenType *, ScreenLayer>::const_iterator it = layers.begin();
+    for (; it != layers.end(); ++it)
+    {
+        if (!(*it).image)
+            continue;
+        ++frameStats.layersHeld;
+        frameStats.layerBytes += (*it).image->byteCount();
+    }
+}
+
+QRect MythMainWindowPrivate::FrameStatsRect(void) const
+{
+    // Frame statistics followed by up to three lines of text cache stats
+    // and two lines of image loader stats
+    return QRect(uiScreenRect.left() + 10, uiScreenRect.top() + 10,
+                 480, 20 * (FrameStats::kBuckets + 8) + 10);
+}
+
+void MythMainWindowPrivate::DrawFrameStats(MythPainter *p)
+{
+    QRect area = FrameStatsRect();
+
+    p->SetClipRect(area);
+    p->DrawRect(area, QBrush(Qt::black), QPen(Qt::NoPen), 192);
+
+    MythFontProperties font;
+    font.SetFace(QFont("Droid Sans Mono"));
+    font.SetColor(Qt::white);
+    font.SetPointSize(10);
+
+    QStringList lines = frameStats.Describe() + p->GetTextCacheStats() +
+                        MythUIImage::GetLoaderStats();
+    QRect line(area.left() + 5, area.top() + 5, area.width() - 10, 20);
+    for (int i = 0; i < lines.size(); ++i)
+    {
+        p->DrawText(line, lines[i], Qt::AlignLeft | Qt::AlignVCenter,
+                    font, 255, line);
+        line.translate(0, 20);
+    }
+}
+
 static MythMainWindow *mainWin = NULL;
 static QMutex mainLock;
 
@@ -584,6 +792,7 @@ MythMainWindow::~MythMainWindow()
     gCoreContext->removeListener(this);
 
     d->drawTimer->stop();
+    d->ClearLayers();
 
     while (!d->stackList.isEmpty())
     {
@@ -750,6 +959,8 @@ void MythMainWindow::animate(void)
     if (!d->repaintRegion.isEmpty())
         redraw = true;
 
+    QSet<MythScreenType *> seen;
+
     QVector<MythScreenStack *>::Iterator it;
     for (it = d->stackList.begin(); it != d->stackList.end(); ++it)
     {
@@ -768,12 +979,44 @@ void MythMainWindow::animate(void)
                 (*screenit)->ResetNeedsRedraw();
                 d->repaintRegion = d->repaintRegion.united(topDirty);
                 redraw = true;
+
+                if (d->useLayers)
+                    d->InvalidateLayer(d->layers[*screenit], true);
+            }
+            else if (d->useLayers)
+            {
+                ++d->layers[*screenit].cleanTicks;
             }
+
+            seen.insert(*screenit);
         }
     }
 
+    // Forget layers of screens which have gone away
+    QHash<MythScreenType *, ScreenLayer>::iterator lit = d->layers.begin();
+    while (lit != d->layers.end())
+    {
+        if (seen.contains(lit.key()))
+        {
+            ++lit;
+            continue;
+        }
+
+        d->InvalidateLayer(*lit);
+        lit = d->layers.erase(lit);
+    }
+
+    if (d->showFrameStats && d->frameStatsTimer.elapsed() >= 1000)
+    {
+        d->repaintRegion = d->repaintRegion.united(d->FrameStatsRect());
+        d->frameStatsTimer.restart();
+        redraw = true;
+    }
+
     if (redraw && !(d->render && d->render->IsShared()))
         d->paintwin->update(d->repaintRegion);
+    else if (!redraw)
+        ++d->frameStats.idle;
 
     for (it = d->stackList.begin(); it != d->stackList.end(); ++it)
         (*it)->ScheduleInitIfNeeded();
@@ -846,6 +1089,23 @@ void MythMainWindow::draw(MythPainter *painter /* = 0 */)
     if (!painter)
         return;
 
+    MythTimer frameTimer;
+    frameTimer.start();
+
+    QVector<MythScreenType *> drawList;
+    QVector<MythScreenStack *>::Iterator it;
+    for (it = d->stackList.begin(); it != d->stackList.end(); ++it)
+    {
+        QVector<MythScreenType *> redrawList;
+        (*it)->GetDrawOrder(redrawList);
+        drawList += redrawList;
+    }
+
+    // Layers belong to the window painter, not to screenshot painters
+    bool useLayers = d->useLayers && painter == d->painter;
+    if (useLayers)
+        d->BuildLayers(painter, drawList);
+
     painter->Begin(d->paintwin);
 
     if (!painter->SupportsClipping())
@@ -861,23 +1121,50 @@ void MythMainWindow::draw(MythPainter *painter /* = 0 */)
         if (rects[i] != d->uiScreenRect)
             painter->SetClipRect(rects[i]);
 
-        QVector<MythScreenStack *>::Iterator it;
-        for (it = d->stackList.begin(); it != d->stackList.end(); ++it)
+        QVector<MythScreenType *>::Iterator screenit;
+        for (screenit = drawList.begin(); screenit != drawList.end();
+             ++screenit)
         {
-            QVector<MythScreenType *> redrawList;
-            (*it)->GetDrawOrder(redrawList);
+            MythImage *layer = NULL;
+            if (useLayers)
+                layer = d->layers.value(*screenit).image;
 
-            QVector<MythScreenType *>::Iterator screenit;
-            for (screenit = redrawList.begin(); screenit != redrawList.end();
-                 ++screenit)
+            if (layer)
             {
-                (*screenit)->Draw(painter, 0, 0, 255, rects[i]);
+                painter->DrawImage(rects[i], layer, rects[i], 255);
+                ++d->frameStats.layerHits;
             }
+            else
+                (*screenit)->Draw(painter, 0, 0, 255, rects[i]);
         }
     }
 
+    if (d->showFrameStats && painter->SupportsClipping())
+        d->DrawFrameStats(painter);
+
     painter->End();
     d->repaintRegion = QRegion();
+
+    d->frameStats.AddFrame(frameTimer.nsecsElapsed() / 1000);
+
+    if (painter == d->painter)
+        emit FrameDrawn();
+}
+
+/**
+ *  \brief Show or hide the frame timing histogram in the top left corner
+ */
+void MythMainWindow::SetFrameStatsOverlay(bool show)
+{
+    d->showFrameStats = show;
+    d->frameStats.Reset();
+    d->frameStatsTimer.start();
+    d->repaintRegion = d->repaintRegion.united(d->FrameStatsRect());
+}
+
+bool MythMainWindow::GetFrameStatsOverlay(void) const
+{
+    return d->showFrameStats;
 }
 
 // virtual
@@ -1107,6 +1394,7 @@ void MythMainWindow::Init(QString forcedpainter)
 
     if (d->painter)
     {
+        d->ClearLayers();
         d->oldpainter = d->painter;
         d->painter = NULL;
     }
@@ -1200,6 +1488,11 @@ void MythMainWindow::Init(QString forcedpainter)
         setAutoFillBackground(false);
     }
 
+    // Retained layers only pay off where every draw call costs CPU time
+    d->useLayers = (d->painter->GetName() == "Qt" ||
+                    d->painter->GetName() == "QImage") &&
+                   GetMythDB()->GetNumSetting("UIRetainedLayers", 1);
+
     d->paintwin->move(0, 0);
     ResizePainterWindow(size());
     d->paintwin->raise();
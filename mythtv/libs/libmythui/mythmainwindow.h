@@ -131,6 +131,8 @@ class MUI_PUBLIC MythMainWindow : public QWidget
     uint PopDrawDisabled(void);
     void SetEffectsEnabled(bool enable);
     void draw(MythPainter *painter = 0);
+    void SetFrameStatsOverlay(bool show);
+    bool GetFrameStatsOverlay(void) const;
 
     void ResetIdleTimer(void);
     void PauseIdleTimer(bool pause);
@@ -151,6 +153,8 @@ class MUI_PUBLIC MythMainWindow : public QWidget
 
   signals:
     void signalRemoteScreenShot(QString filename, int x, int y);
+    /// Emitted after each frame has been drawn to the screen
+    void FrameDrawn(void);
 
   protected:
     explicit MythMainWindow(const bool useDB = true);
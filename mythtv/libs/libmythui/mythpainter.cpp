@@ -14,6 +14,7 @@
 // libmythui headers
 #include "mythfontproperties.h"
 #include "mythimage.h"
+#include "mythglyphcache.h"
 #include "mythuianimation.h"	// UIEffects
 
 // Own header
@@ -21,7 +22,7 @@
 
 MythPainter::MythPainter()
   : m_Parent(0), m_HardwareCacheSize(0), m_SoftwareCacheSize(0),
-    m_showBorders(false), m_showNames(false)
+    m_glyphCache(NULL), m_showBorders(false), m_showNames(false)
 {
     SetMaximumCacheSizes(
         gCoreContext->GetNumSetting("UIPainterMaxCacheHW",64),
@@ -30,6 +31,9 @@ MythPainter::MythPainter()
 
 void MythPainter::Teardown(void)
 {
+    delete m_glyphCache;
+    m_glyphCache = NULL;
+
     ExpireImages(0);
 
     QMutexLocker locker(&m_allocationLock);
@@ -77,10 +81,21 @@ void MythPainter::DrawImage(const QPoint &topLeft, MythImage *im, int alpha)
     DrawImage(topLeft.x(), topLeft.y(), im, alpha);
 }
 
+void MythPainter::DrawImages(MythImage *im, const QVector<QRect> &dests,
+                             const QVector<QRect> &srcs, int alpha)
+{
+    for (int i = 0; i < dests.size() && i < srcs.size(); ++i)
+        DrawImage(dests[i], im, srcs[i], alpha);
+}
+
 void MythPainter::DrawText(const QRect &r, const QString &msg,
                            int flags, const MythFontProperties &font,
                            int alpha, const QRect &boundRect)
 {
+    if (m_glyphCache &&
+        m_glyphCache->DrawText(r, msg, flags, font, alpha, boundRect))
+        return;
+
     MythImage *im = GetImageFromString(msg, flags, r, font);
     if (!im)
         return;
@@ -133,6 +148,11 @@ void MythPainter::DrawTextLayout(const QRect & canvasRect,
     if (canvasRect.isNull())
         return;
 
+    if (m_glyphCache &&
+        m_glyphCache->DrawTextLayout(canvasRect, layouts, formats, font,
+                                     alpha, destRect))
+        return;
+
     QRect      canvas(canvasRect);
     QRect      dest(destRect);
 
@@ -601,6 +621,33 @@ void MythPainter::ExpireImages(int64_t max)
     }
 }
 
+void MythPainter::EnableGlyphCache(void)
+{
+    if (m_glyphCache)
+        return;
+
+    if (!gCoreContext->GetNumSetting("UIGlyphAtlas", 1))
+        return;
+
+    LOG(VB_GUI, LOG_INFO, QString("%1 painter: using glyph atlas for text")
+        .arg(GetName()));
+    m_glyphCache = new MythGlyphCache(this);
+}
+
+QStringList MythPainter::GetTextCacheStats(void)
+{
+    QStringList stats;
+
+    if (m_glyphCache)
+        stats = m_glyphCache->GetStats();
+
+    stats << QString("String cache: %1 images %2/%3 KB")
+                 .arg(m_StringToImageMap.size())
+                 .arg(m_SoftwareCacheSize / 1024)
+                 .arg(m_MaxSoftwareCacheSize / 1024);
+    return stats;
+}
+
 // the following assume graphics hardware operates natively at 32bpp
 void MythPainter::SetMaximumCacheSizes(int hardware, int software)
 {
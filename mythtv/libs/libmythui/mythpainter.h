@@ -8,6 +8,7 @@
 #include <QPaintDevice>
 #include <QMutex>
 #include <QSet>
+#include <QStringList>
 
 class QRect;
 class QRegion;
@@ -24,6 +25,7 @@ class QColor;
 
 class MythFontProperties;
 class MythImage;
+class MythGlyphCache;
 class UIEffects;
 
 typedef QVector<QTextLayout *>            LayoutVector;
@@ -62,6 +64,11 @@ class MUI_PUBLIC MythPainter
     void DrawImage(int x, int y, MythImage *im, int alpha);
     void DrawImage(const QPoint &topLeft, MythImage *im, int alph);
 
+    /// Draws several parts of the same image, such as the glyphs of a
+    /// string from one atlas page. The default draws them one at a time.
+    virtual void DrawImages(MythImage *im, const QVector<QRect> &dests,
+                            const QVector<QRect> &srcs, int alpha);
+
     virtual void DrawText(const QRect &dest, const QString &msg, int flags,
                           const MythFontProperties &font, int alpha,
                           const QRect &boundRect);
@@ -98,6 +105,9 @@ class MUI_PUBLIC MythPainter
 
     void SetMaximumCacheSizes(int hardware, int software);
 
+    /// Describes the state of the text caches, for debugging overlays.
+    QStringList GetTextCacheStats(void);
+
   protected:
     void DrawTextPriv(MythImage *im, const QString &msg, int flags,
                       const QRect &r, const MythFontProperties &font);
@@ -125,6 +135,11 @@ class MUI_PUBLIC MythPainter
 
     void CheckFormatImage(MythImage *im);
 
+    /// Draw plain text from a glyph atlas instead of an image per string.
+    /// Only worthwhile for painters that can draw many sub-rects of an
+    /// image for about the cost of one, see DrawImages().
+    void EnableGlyphCache(void);
+
     QPaintDevice *m_Parent;
     int m_HardwareCacheSize;
     int m_MaxHardwareCacheSize;
@@ -139,6 +154,8 @@ class MUI_PUBLIC MythPainter
     QMap<QString, MythImage *> m_StringToImageMap;
     std::list<QString>         m_StringExpireList;
 
+    MythGlyphCache *m_glyphCache;
+
     bool m_showBorders;
     bool m_showNames;
 };
@@ -13,6 +13,7 @@
 MythQImagePainter::MythQImagePainter() :
     MythPainter(), painter(NULL), copy(false)
 {
+    EnableGlyphCache();
 }
 
 MythQImagePainter::~MythQImagePainter()
@@ -157,6 +158,48 @@ void MythQImagePainter::DrawImage(const QRect &r, MythImage *im,
     painter->setOpacity(1.0);
 }
 
+/**
+ *  \brief Draw many parts of one image, e.g. glyphs from an atlas page
+ *
+ *  The paint mode and opacity are worked out once for the whole batch
+ *  rather than for every part, as the region bookkeeping in
+ *  CheckPaintMode() costs more than blitting a small glyph.
+ */
+void MythQImagePainter::DrawImages(MythImage *im, const QVector<QRect> &dests,
+                                   const QVector<QRect> &srcs, int alpha)
+{
+    if (!painter)
+    {
+        LOG(VB_GENERAL, LOG_ERR,
+            "FATAL ERROR: DrawImages called with no painter");
+        return;
+    }
+
+    int count = qMin(dests.size(), srcs.size());
+    if (!count)
+        return;
+
+    QRect area;
+    for (int i = 0; i < count; ++i)
+        area |= QRect(dests[i].topLeft(), srcs[i].size());
+
+    CheckPaintMode(area);
+
+    // The parts may overlap each other, so they can't be copied over
+    // one another even where nothing was painted before
+    if (copy && count > 1)
+    {
+        copy = false;
+        painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+    }
+
+    const QImage &image = *im;
+    painter->setOpacity(static_cast<float>(alpha) / 255.0);
+    for (int i = 0; i < count; ++i)
+        painter->drawImage(dests[i].topLeft(), image, srcs[i]);
+    painter->setOpacity(1.0);
+}
+
 void MythQImagePainter::DrawText(const QRect &r, const QString &msg,
                                  int flags, const MythFontProperties &font,
                                  int alpha, const QRect &boundRect)
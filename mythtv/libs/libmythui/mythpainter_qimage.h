@@ -34,6 +34,8 @@ class MUI_PUBLIC MythQImagePainter : public MythPainter
 
     virtual void DrawImage(const QRect &dest, MythImage *im, const QRect &src,
                            int alpha);
+    virtual void DrawImages(MythImage *im, const QVector<QRect> &dests,
+                            const QVector<QRect> &srcs, int alpha);
     virtual void DrawText(const QRect &dest, const QString &msg, int flags,
                           const MythFontProperties &font, int alpha,
                           const QRect &boundRect);
@@ -100,6 +100,10 @@ void MythUIButtonList::Const(void)
 
     m_nextItemLoaded = 0;
 
+    m_provider = NULL;
+    m_prefetch = 20;
+    m_lastTopPosition = 0;
+
     SetCanTakeFocus(true);
 
     connect(this, SIGNAL(TakingFocus()), this, SLOT(Select()));
@@ -113,6 +117,8 @@ MythUIButtonList::~MythUIButtonList()
 
     while (!m_itemList.isEmpty())
         delete m_itemList.takeFirst();
+
+    ClearVirtualItems();
 }
 
 void MythUIButtonList::Select()
@@ -159,7 +165,7 @@ void MythUIButtonList::Reset()
 {
     m_ButtonToItem.clear();
 
-    if (m_itemList.isEmpty())
+    if (m_itemList.isEmpty() && !m_provider)
         return;
 
     m_clearing = true;
@@ -167,6 +173,9 @@ void MythUIButtonList::Reset()
     while (!m_itemList.isEmpty())
         delete m_itemList.takeFirst();
 
+    ClearVirtualItems();
+    m_provider = NULL;
+
     m_clearing = false;
 
     m_selPosition = 0;
@@ -252,7 +261,7 @@ MythUIGroup *MythUIButtonList::PrepareButton(int buttonIdx, int itemIdx,
 {
     MythUIStateType *realButton;
     MythUIGroup *buttonstate;
-    MythUIButtonListItem *buttonItem = m_itemList[itemIdx];
+    MythUIButtonListItem *buttonItem = ItemAt(itemIdx);
 
     buttonIdx += button_shift;
 
@@ -1336,7 +1345,7 @@ void MythUIButtonList::CalculateButtonPositions(void)
             }
 
 
-            if (((m_itemList.count() - m_topPosition)
+            if (((m_itemCount - m_topPosition)
                  < static_cast<int>(m_itemsVisible)) &&
                 (m_selPosition - (static_cast<int>(m_itemsVisible) - 1)
                  < m_topPosition))
@@ -1348,8 +1357,7 @@ void MythUIButtonList::CalculateButtonPositions(void)
         }
     }
 
-    QList<MythUIButtonListItem *>::iterator it = m_itemList.begin() +
-                                                 m_topPosition;
+    int curItem = m_topPosition;
 
     if (m_scrollStyle == ScrollCenter || m_scrollStyle == ScrollGroupCenter)
     {
@@ -1360,13 +1368,13 @@ void MythUIButtonList::CalculateButtonPositions(void)
             if (m_wrapStyle == WrapItems && button > 0 &&
                 m_itemCount >= (int)m_itemsVisible)
             {
-                it = m_itemList.end() - button;
+                curItem = m_itemCount - button;
                 button = 0;
             }
         }
         else if ((m_itemCount - m_selPosition) < (int)(m_itemsVisible / 2))
         {
-            it = m_itemList.begin() + m_selPosition - (m_itemsVisible / 2);
+            curItem = m_selPosition - (m_itemsVisible / 2);
         }
     }
     else if (m_drawFromBottom && m_itemCount < (int)m_itemsVisible)
@@ -1380,15 +1388,13 @@ void MythUIButtonList::CalculateButtonPositions(void)
     MythUIStateType *realButton = NULL;
     MythUIButtonListItem *buttonItem = NULL;
 
-    if (it < m_itemList.begin())
-        it = m_itemList.begin();
-
-    int curItem = it < m_itemList.end() ? GetItemPos(*it) : 0;
+    if (curItem < 0)
+        curItem = 0;
 
-    while (it < m_itemList.end() && button < (int)m_itemsVisible)
+    while (curItem < m_itemCount && button < (int)m_itemsVisible)
     {
         realButton = m_ButtonList[button];
-        buttonItem = *it;
+        buttonItem = ItemAt(curItem);
 
         if (!realButton || !buttonItem)
             break;
@@ -1405,15 +1411,13 @@ void MythUIButtonList::CalculateButtonPositions(void)
         buttonItem->SetToRealButton(realButton, selected);
         realButton->SetVisible(true);
 
-        if (m_wrapStyle == WrapItems && it == (m_itemList.end() - 1) &&
+        if (m_wrapStyle == WrapItems && curItem == m_itemCount - 1 &&
             m_itemCount >= (int)m_itemsVisible)
         {
-            it = m_itemList.begin();
             curItem = 0;
         }
         else
         {
-            ++it;
             ++curItem;
         }
 
@@ -1427,9 +1431,9 @@ void MythUIButtonList::CalculateButtonPositions(void)
 void MythUIButtonList::SanitizePosition(void)
 {
     if (m_selPosition < 0)
-        m_selPosition = (m_wrapStyle > WrapNone) ? m_itemList.size() - 1 : 0;
-    else if (m_selPosition >= m_itemList.size())
-        m_selPosition = (m_wrapStyle > WrapNone) ? 0 : m_itemList.size() - 1;
+        m_selPosition = (m_wrapStyle > WrapNone) ? m_itemCount - 1 : 0;
+    else if (m_selPosition >= m_itemCount)
+        m_selPosition = (m_wrapStyle > WrapNone) ? 0 : m_itemCount - 1;
 }
 
 void MythUIButtonList::CalculateArrowStates()
@@ -1463,6 +1467,8 @@ void MythUIButtonList::CalculateArrowStates()
     else
         DistributeButtons();
 
+    PrefetchImages();
+    TrimVirtualItems();
     updateLCD();
 
     m_needsUpdate = false;
@@ -1500,6 +1506,10 @@ void MythUIButtonList::ItemVisible(MythUIButtonListItem *item)
 
 void MythUIButtonList::InsertItem(MythUIButtonListItem *item, int listPosition)
 {
+    // Rows of a virtualized list only come from the provider
+    if (m_provider)
+        return;
+
     bool wasEmpty = m_itemList.isEmpty();
 
     if (listPosition >= 0 && listPosition <= m_itemList.count())
@@ -1581,6 +1591,12 @@ void MythUIButtonList::SetValueByData(QVariant data)
     if (!m_initialized)
         Init();
 
+    if (m_provider)
+    {
+        SetItemCurrent(m_provider->FindRowByData(data));
+        return;
+    }
+
     for (int i = 0; i < m_itemList.size(); ++i)
     {
         MythUIButtonListItem *item = m_itemList.at(i);
@@ -1595,7 +1611,7 @@ void MythUIButtonList::SetValueByData(QVariant data)
 
 void MythUIButtonList::SetItemCurrent(MythUIButtonListItem *item)
 {
-    int newIndex = m_itemList.indexOf(item);
+    int newIndex = GetItemPos(item);
     SetItemCurrent(newIndex);
 }
 
@@ -1604,7 +1620,7 @@ void MythUIButtonList::SetItemCurrent(int current, int topPosition)
     if (!m_initialized)
         Init();
 
-    if (current == -1 || current >= m_itemList.size())
+    if (current == -1 || current >= m_itemCount)
         return;
 
     if (current == m_selPosition &&
@@ -1625,11 +1641,11 @@ void MythUIButtonList::SetItemCurrent(int current, int topPosition)
 
 MythUIButtonListItem *MythUIButtonList::GetItemCurrent() const
 {
-    if (m_itemList.isEmpty() || m_selPosition >= m_itemList.size() ||
+    if (m_itemCount == 0 || m_selPosition >= m_itemCount ||
         m_selPosition < 0)
         return NULL;
 
-    return m_itemList.at(m_selPosition);
+    return ItemAt(m_selPosition);
 }
 
 int MythUIButtonList::GetIntValue() const
@@ -1671,8 +1687,8 @@ MythRect MythUIButtonList::GetButtonArea(void) const
 
 MythUIButtonListItem *MythUIButtonList::GetItemFirst() const
 {
-    if (!m_itemList.empty())
-        return m_itemList[0];
+    if (m_itemCount > 0)
+        return ItemAt(0);
 
     return NULL;
 }
@@ -1680,6 +1696,16 @@ MythUIButtonListItem *MythUIButtonList::GetItemFirst() const
 MythUIButtonListItem *MythUIButtonList::GetItemNext(MythUIButtonListItem *item)
 const
 {
+    if (m_provider)
+    {
+        int pos = GetItemPos(item);
+
+        if (pos < 0 || pos + 1 >= m_itemCount)
+            return 0;
+
+        return ItemAt(pos + 1);
+    }
+
     QListIterator<MythUIButtonListItem *> it(m_itemList);
 
     if (!it.findNext(item))
@@ -1714,10 +1740,10 @@ bool MythUIButtonList::IsEmpty() const
 
 MythUIButtonListItem *MythUIButtonList::GetItemAt(int pos) const
 {
-    if (pos < 0 || pos >= m_itemList.size())
+    if (pos < 0 || pos >= m_itemCount)
         return NULL;
 
-    return m_itemList.at(pos);
+    return ItemAt(pos);
 }
 
 MythUIButtonListItem *MythUIButtonList::GetItemByData(QVariant data)
@@ -1725,6 +1751,9 @@ MythUIButtonListItem *MythUIButtonList::GetItemByData(QVariant data)
     if (!m_initialized)
         Init();
 
+    if (m_provider)
+        return GetItemAt(m_provider->FindRowByData(data));
+
     for (int i = 0; i < m_itemList.size(); ++i)
     {
         MythUIButtonListItem *item = m_itemList.at(i);
@@ -1741,13 +1770,16 @@ int MythUIButtonList::GetItemPos(MythUIButtonListItem *item) const
     if (!item)
         return -1;
 
+    if (m_provider)
+        return m_virtualRows.value(item, -1);
+
     return m_itemList.indexOf(item);
 }
 
 void MythUIButtonList::InitButton(int itemIdx, MythUIStateType* & realButton,
                                   MythUIButtonListItem* & buttonItem)
 {
-    buttonItem = m_itemList[itemIdx];
+    buttonItem = ItemAt(itemIdx);
 
     if (m_maxVisible == 0)
     {
@@ -1879,7 +1911,7 @@ int MythUIButtonList::PageUp(void)
 int MythUIButtonList::PageDown(void)
 {
     int pos        = m_selPosition;
-    int num_items  = m_itemList.size();
+    int num_items  = m_itemCount;
     int total      = 0;
     MythUIGroup     *buttonstate;
     MythUIStateType *realButton;
@@ -1985,7 +2017,7 @@ bool MythUIButtonList::MoveUp(MovementUnit unit, uint amount)
 {
     int pos = m_selPosition;
 
-    if (pos == -1 || m_itemList.isEmpty() || !m_initialized)
+    if (pos == -1 || m_itemCount == 0 || !m_initialized)
         return false;
 
     switch (unit)
@@ -1994,7 +2026,7 @@ bool MythUIButtonList::MoveUp(MovementUnit unit, uint amount)
             if (m_selPosition > 0)
                 --m_selPosition;
             else if (m_wrapStyle > WrapNone)
-                m_selPosition = m_itemList.size() - 1;
+                m_selPosition = m_itemCount - 1;
             else if (m_wrapStyle == WrapCaptive)
                 return true;
 
@@ -2005,7 +2037,7 @@ bool MythUIButtonList::MoveUp(MovementUnit unit, uint amount)
                 --m_selPosition;
             else if (m_wrapStyle == WrapFlowing)
                 if (m_selPosition == 0)
-                    --m_selPosition = m_itemList.size() - 1;
+                    --m_selPosition = m_itemCount - 1;
                 else
                     --m_selPosition;
             else if (m_wrapStyle > WrapNone)
@@ -2020,20 +2052,20 @@ bool MythUIButtonList::MoveUp(MovementUnit unit, uint amount)
             {
                 m_selPosition -= m_columns;
                 if (m_selPosition < 0)
-                    m_selPosition += m_itemList.size();
+                    m_selPosition += m_itemCount;
                 else
-                    m_selPosition %= m_itemList.size();
+                    m_selPosition %= m_itemCount;
             }
             else if ((pos - m_columns) >= 0)
                 m_selPosition -= m_columns;
             else if (m_wrapStyle > WrapNone)
             {
-                m_selPosition = ((m_itemList.size() - 1) / m_columns) *
+                m_selPosition = ((m_itemCount - 1) / m_columns) *
                                 m_columns + pos;
 
                 if ((m_selPosition / m_columns)
-                    < ((m_itemList.size() - 1) / m_columns))
-                    m_selPosition = m_itemList.size() - 1;
+                    < ((m_itemCount - 1) / m_columns))
+                    m_selPosition = m_itemCount - 1;
 
                 if (m_layout == LayoutVertical)
                     m_topPosition = qMax(0, m_selPosition - (int)m_itemsVisible + 1);
@@ -2052,7 +2084,7 @@ bool MythUIButtonList::MoveUp(MovementUnit unit, uint amount)
             break;
 
         case MoveMid:
-            m_selPosition = (int)(m_itemList.size() / 2);
+            m_selPosition = (int)(m_itemCount / 2);
             break;
 
         case MoveMax:
@@ -2065,7 +2097,7 @@ bool MythUIButtonList::MoveUp(MovementUnit unit, uint amount)
                 if (m_selPosition > 0)
                     --m_selPosition;
                 else if (m_wrapStyle > WrapNone)
-                    m_selPosition = m_itemList.size() - 1;
+                    m_selPosition = m_itemCount - 1;
             }
 
             break;
@@ -2088,13 +2120,13 @@ bool MythUIButtonList::MoveDown(MovementUnit unit, uint amount)
 {
     int pos = m_selPosition;
 
-    if (pos == -1 || m_itemList.isEmpty() || !m_initialized)
+    if (pos == -1 || m_itemCount == 0 || !m_initialized)
         return false;
 
     switch (unit)
     {
         case MoveItem:
-            if (m_selPosition < m_itemList.size() - 1)
+            if (m_selPosition < m_itemCount - 1)
                 ++m_selPosition;
             else if (m_wrapStyle > WrapNone)
                 m_selPosition = 0;
@@ -2107,7 +2139,7 @@ bool MythUIButtonList::MoveDown(MovementUnit unit, uint amount)
             if ((pos + 1) % m_columns > 0)
                 ++m_selPosition;
             else if (m_wrapStyle == WrapFlowing)
-                if (m_selPosition < m_itemList.size() - 1)
+                if (m_selPosition < m_itemCount - 1)
                     ++m_selPosition;
                 else
                     m_selPosition = 0;
@@ -2119,19 +2151,19 @@ bool MythUIButtonList::MoveDown(MovementUnit unit, uint amount)
             break;
 
         case MoveRow:
-            if (m_itemList.empty() || m_columns < 1)
+            if (m_itemCount == 0 || m_columns < 1)
                 return true;
             if (m_scrollStyle != ScrollFree)
             {
                 m_selPosition += m_columns;
-                m_selPosition %= m_itemList.size();
+                m_selPosition %= m_itemCount;
             }
-            else if (((m_itemList.size() - 1) / qMax(m_columns, 0))
+            else if (((m_itemCount - 1) / qMax(m_columns, 0))
                      > (pos / m_columns))
             {
                 m_selPosition += m_columns;
-                if (m_selPosition >= m_itemList.size())
-                    m_selPosition = m_itemList.size() - 1;
+                if (m_selPosition >= m_itemCount)
+                    m_selPosition = m_itemCount - 1;
             }
             else if (m_wrapStyle > WrapNone)
                 m_selPosition = (pos % m_columns);
@@ -2156,7 +2188,7 @@ bool MythUIButtonList::MoveDown(MovementUnit unit, uint amount)
         case MoveByAmount:
             for (uint i = 0; i < amount; ++i)
             {
-                if (m_selPosition < m_itemList.size() - 1)
+                if (m_selPosition < m_itemCount - 1)
                     ++m_selPosition;
                 else if (m_wrapStyle > WrapNone)
                     m_selPosition = 0;
@@ -2186,25 +2218,24 @@ bool MythUIButtonList::MoveToNamedPosition(const QString &position_name)
     if (!m_initialized)
         Init();
 
-    if (m_selPosition < 0 || m_itemList.isEmpty() || !m_initialized)
+    if (m_selPosition < 0 || m_itemCount == 0 || !m_initialized)
         return false;
 
     bool found_it = false;
     int selectedPosition = 0;
-    QList<MythUIButtonListItem *>::iterator it = m_itemList.begin();
+    MythUIButtonListItem *scratch = NULL;
 
-    while (it != m_itemList.end())
+    for (; selectedPosition < m_itemCount; ++selectedPosition)
     {
-        if ((*it)->GetText() == position_name)
+        if (PeekItemAt(selectedPosition, scratch)->GetText() == position_name)
         {
             found_it = true;
             break;
         }
-
-        ++it;
-        ++selectedPosition;
     }
 
+    ReleaseScratchItem(scratch);
+
     if (!found_it || m_selPosition == selectedPosition)
         return false;
 
@@ -2214,7 +2245,8 @@ bool MythUIButtonList::MoveToNamedPosition(const QString &position_name)
 
 bool MythUIButtonList::MoveItemUpDown(MythUIButtonListItem *item, bool up)
 {
-    if (GetItemCurrent() != item)
+    // Row order of a virtualized list belongs to the provider
+    if (m_provider || GetItemCurrent() != item)
         return false;
 
     if (item == m_itemList.first() && up)
@@ -2264,6 +2296,11 @@ void MythUIButtonList::SetAllChecked(MythUIButtonListItem::CheckState state)
 
     while (it.hasNext())
         it.next()->setChecked(state);
+
+    // Only affects the rows currently held, the provider owns the rest
+    QHash<int, MythUIButtonListItem *>::iterator vit = m_virtualItems.begin();
+    for (; vit != m_virtualItems.end(); ++vit)
+        (*vit)->setChecked(state);
 }
 
 void MythUIButtonList::Init()
@@ -2675,6 +2712,321 @@ int MythUIButtonList::StopLoad(void)
     return m_nextItemLoaded;
 }
 
+/**
+ *  \brief Switch the list to virtualized mode
+ *
+ *  Any existing items are deleted. From now on rows are requested from
+ *  the provider as they come into view, with an additional \p prefetch
+ *  rows either side of the visible window. The provider is not owned by
+ *  the list and must outlive it or be removed with Reset().
+ */
+void MythUIButtonList::SetProvider(MythUIButtonListProvider *provider,
+                                   int prefetch)
+{
+    Reset();
+
+    m_provider    = provider;
+    m_prefetch    = qMax(prefetch, 0);
+    m_itemCount   = provider ? provider->GetCount() : 0;
+    m_selPosition = 0;
+    m_topPosition = 0;
+
+    Update();
+
+    if (m_itemCount > 0)
+    {
+        emit itemSelected(GetItemCurrent());
+        emit DependChanged(false);
+    }
+}
+
+/// Tell a virtualized list that the provider gained \p count rows at \p row
+void MythUIButtonList::RowsInserted(int row, int count)
+{
+    if (!m_provider || count <= 0)
+        return;
+
+    bool wasEmpty = (m_itemCount == 0);
+
+    ShiftVirtualItems(row, count);
+    m_itemCount = m_provider->GetCount();
+
+    if (wasEmpty)
+    {
+        m_selPosition = m_topPosition = 0;
+        emit itemSelected(GetItemCurrent());
+        emit DependChanged(false);
+    }
+    else
+    {
+        if (row <= m_selPosition)
+            m_selPosition += count;
+
+        if (row <= m_topPosition)
+            m_topPosition += count;
+    }
+
+    Update();
+}
+
+/// Tell a virtualized list that the provider lost \p count rows at \p row
+void MythUIButtonList::RowsRemoved(int row, int count)
+{
+    if (!m_provider || count <= 0)
+        return;
+
+    m_ButtonToItem.clear();
+
+    for (int i = row; i < row + count; ++i)
+    {
+        MythUIButtonListItem *item = m_virtualItems.take(i);
+        if (item)
+        {
+            m_virtualRows.remove(item);
+            item->ClearContents();
+            m_spareItems.append(item);
+        }
+    }
+
+    ShiftVirtualItems(row + count, -count);
+    m_itemCount = m_provider->GetCount();
+
+    if (m_selPosition >= row + count)
+        m_selPosition -= count;
+    else if (m_selPosition >= row)
+        m_selPosition = row;
+
+    if (m_topPosition >= row + count)
+        m_topPosition -= count;
+    else if (m_topPosition >= row)
+        m_topPosition = row;
+
+    m_selPosition = qMax(qMin(m_selPosition, m_itemCount - 1), 0);
+    m_topPosition = qMax(qMin(m_topPosition, m_itemCount - 1), 0);
+
+    Update();
+
+    emit itemSelected(GetItemCurrent());
+
+    if (IsEmpty())
+        emit DependChanged(true);
+}
+
+/// Refill any held items for rows whose contents changed in the provider
+void MythUIButtonList::RowsChanged(int row, int count)
+{
+    if (!m_provider)
+        return;
+
+    for (int i = row; i < row + count; ++i)
+    {
+        MythUIButtonListItem *item = m_virtualItems.value(i, NULL);
+        if (item)
+        {
+            item->ClearContents();
+            m_provider->FillItem(i, item);
+        }
+    }
+
+    Update();
+}
+
+MythUIButtonListItem *MythUIButtonList::ItemAt(int pos) const
+{
+    if (!m_provider)
+        return m_itemList.at(pos);
+
+    MythUIButtonListItem *item = m_virtualItems.value(pos, NULL);
+    if (item)
+        return item;
+
+    if (!m_spareItems.isEmpty())
+        item = m_spareItems.takeLast();
+    else
+        item = new MythUIButtonListItem(
+            const_cast<MythUIButtonList *>(this), QString());
+
+    m_provider->FillItem(pos, item);
+    m_virtualItems.insert(pos, item);
+    m_virtualRows.insert(item, pos);
+
+    return item;
+}
+
+/**
+ *  \brief Returns the item of row \p pos without holding on to it
+ *
+ *  For scanning a virtualized list. A row that isn't already held is
+ *  filled into \p scratch, which is taken from the spare items the first
+ *  time and refilled for every row after that, so a scan of any number of
+ *  rows only uses one extra item. The item returned is only good until
+ *  the next call, and \p scratch must be given back to
+ *  ReleaseScratchItem() when the scan is done.
+ */
+MythUIButtonListItem *MythUIButtonList::PeekItemAt(
+    int pos, MythUIButtonListItem *&scratch) const
+{
+    if (!m_provider)
+        return m_itemList.at(pos);
+
+    MythUIButtonListItem *item = m_virtualItems.value(pos, NULL);
+    if (item)
+        return item;
+
+    if (scratch)
+        scratch->ClearContents();
+    else if (!m_spareItems.isEmpty())
+        scratch = m_spareItems.takeLast();
+    else
+        scratch = new MythUIButtonListItem(
+            const_cast<MythUIButtonList *>(this), QString());
+
+    m_provider->FillItem(pos, scratch);
+    return scratch;
+}
+
+/// Return the item used by PeekItemAt() to the spare items
+void MythUIButtonList::ReleaseScratchItem(MythUIButtonListItem *scratch) const
+{
+    if (!scratch)
+        return;
+
+    scratch->ClearContents();
+    m_spareItems.append(scratch);
+}
+
+/**
+ *  \brief Recycle items outside the visible window and prefetch margin
+ *
+ *  Called after each layout pass. The current item and anything still
+ *  attached to a button are always kept so pointers handed out through
+ *  itemSelected() and itemVisible() remain valid.
+ */
+void MythUIButtonList::TrimVirtualItems(void)
+{
+    if (!m_provider)
+        return;
+
+    int first = m_topPosition - m_prefetch;
+    int last  = m_topPosition + (int)m_itemsVisible + m_prefetch;
+    QList<MythUIButtonListItem *> shown = m_ButtonToItem.values();
+
+    QMutableHashIterator<int, MythUIButtonListItem *> it(m_virtualItems);
+    while (it.hasNext())
+    {
+        it.next();
+
+        if ((it.key() >= first && it.key() < last) ||
+            it.key() == m_selPosition || shown.contains(it.value()))
+            continue;
+
+        m_virtualRows.remove(it.value());
+        it.value()->ClearContents();
+        m_spareItems.append(it.value());
+        it.remove();
+    }
+
+    // Don't let the pool grow past what a window can use
+    int maxSpare = (int)m_itemsVisible + (2 * m_prefetch);
+    m_clearing = true;
+    while (m_spareItems.size() > maxSpare)
+        delete m_spareItems.takeLast();
+    m_clearing = false;
+
+    last = qMin(last, m_itemCount);
+    for (int i = qMax(first, 0); i < last; ++i)
+        ItemAt(i);
+}
+
+/**
+ *  \brief Queue the images of the next page in the scroll direction
+ *
+ *  The loads go through the template button's image widgets so they are
+ *  cached at the size the buttons will show them, and use the lowest
+ *  priority so they never hold up images which are already on screen.
+ */
+void MythUIButtonList::PrefetchImages(void)
+{
+    int direction = (m_topPosition < m_lastTopPosition) ? -1 : 1;
+    m_lastTopPosition = m_topPosition;
+
+    if (m_ButtonList.isEmpty() || m_itemCount <= (int)m_itemsVisible)
+        return;
+
+    MythUIGroup *buttonstate = dynamic_cast<MythUIGroup *>
+                               (m_ButtonList[0]->GetState("active"));
+    if (!buttonstate)
+        return;
+
+    QList<MythUIType *> *children = buttonstate->GetAllChildren();
+    QList<MythUIType *>::iterator child = children->begin();
+    for (; child != children->end(); ++child)
+    {
+        MythUIImage *image = dynamic_cast<MythUIImage *>(*child);
+        if (image)
+            image->CancelPrefetch();
+    }
+
+    int first = m_topPosition + direction * (int)m_itemsVisible;
+
+    for (int i = 0; i < (int)m_itemsVisible; ++i)
+    {
+        int pos = first + i;
+
+        if (m_wrapStyle == WrapItems)
+            pos = ((pos % m_itemCount) + m_itemCount) % m_itemCount;
+        else if (pos < 0 || pos >= m_itemCount)
+            continue;
+
+        MythUIButtonListItem *item = ItemAt(pos);
+        if (!item)
+            continue;
+
+        InfoMap::const_iterator it = item->m_imageFilenames.constBegin();
+        for (; it != item->m_imageFilenames.constEnd(); ++it)
+        {
+            MythUIImage *image = dynamic_cast<MythUIImage *>
+                                 (buttonstate->GetChild(it.key()));
+            if (image)
+                image->Prefetch(it.value());
+        }
+    }
+}
+
+void MythUIButtonList::ClearVirtualItems(void)
+{
+    bool clearing = m_clearing;
+    m_clearing = true;
+
+    QHash<int, MythUIButtonListItem *>::iterator it = m_virtualItems.begin();
+    for (; it != m_virtualItems.end(); ++it)
+        delete *it;
+    m_virtualItems.clear();
+    m_virtualRows.clear();
+
+    while (!m_spareItems.isEmpty())
+        delete m_spareItems.takeFirst();
+
+    m_clearing = clearing;
+}
+
+/// Move held items at or after \p row by \p offset rows
+void MythUIButtonList::ShiftVirtualItems(int row, int offset)
+{
+    QHash<int, MythUIButtonListItem *> shifted;
+
+    QHash<int, MythUIButtonListItem *>::const_iterator it =
+        m_virtualItems.constBegin();
+    for (; it != m_virtualItems.constEnd(); ++it)
+    {
+        int pos = (it.key() >= row) ? it.key() + offset : it.key();
+        shifted.insert(pos, it.value());
+        m_virtualRows.insert(it.value(), pos);
+    }
+
+    m_virtualItems = shifted;
+}
+
 QPoint MythUIButtonList::GetButtonPosition(int column, int row) const
 {
     int x = m_contentsRect.x() +
@@ -3082,12 +3434,19 @@ bool MythUIButtonList::DoFind(bool doMove, bool searchForward)
         }
     }
 
+    // Rows of a virtualized list are looked at one at a time, without
+    // holding on to them
+    MythUIButtonListItem *scratch = NULL;
+
     while (true)
     {
-        found = GetItemAt(currPos)->FindText(m_searchStr, m_searchFields, m_searchStartsWith);
+        found = PeekItemAt(currPos, scratch)->FindText(m_searchStr,
+                                                       m_searchFields,
+                                                       m_searchStartsWith);
 
         if (found)
         {
+            ReleaseScratchItem(scratch);
             SetItemCurrent(currPos);
             return true;
         }
@@ -3111,6 +3470,7 @@ bool MythUIButtonList::DoFind(bool doMove, bool searchForward)
             break;
     }
 
+    ReleaseScratchItem(scratch);
     return false;
 }
 
@@ -3180,6 +3540,35 @@ MythUIButtonListItem::~MythUIButtonListItem()
     m_images.clear();
 }
 
+/// Return a recycled item of a virtualized list to its blank state
+void MythUIButtonListItem::ClearContents(void)
+{
+    if (m_image)
+        m_image->DecrRef();
+    m_image = NULL;
+
+    QMap<QString, MythImage*>::iterator it;
+    for (it = m_images.begin(); it != m_images.end(); ++it)
+    {
+        if (*it)
+            (*it)->DecrRef();
+    }
+    m_images.clear();
+
+    m_text.clear();
+    m_fontState.clear();
+    m_imageFilename.clear();
+    m_checkable = false;
+    m_state     = CantCheck;
+    m_data      = QVariant();
+    m_showArrow = false;
+    m_isVisible = false;
+
+    m_strings.clear();
+    m_imageFilenames.clear();
+    m_states.clear();
+}
+
 void MythUIButtonListItem::SetText(const QString &text, const QString &name,
                                    const QString &state)
 {
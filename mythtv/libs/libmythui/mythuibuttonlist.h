@@ -103,6 +103,8 @@ class MUI_PUBLIC MythUIButtonListItem
     virtual void SetToRealButton(MythUIStateType *button, bool selected);
 
   protected:
+    void ClearContents(void);
+
     MythUIButtonList *m_parent;
     QString         m_text;
     QString         m_fontState;
@@ -123,6 +125,34 @@ class MUI_PUBLIC MythUIButtonListItem
     friend class MythGenericTree;
 };
 
+/**
+ * \class MythUIButtonListProvider
+ *
+ * \brief Supplies the rows of a virtualized MythUIButtonList
+ *
+ * Rather than creating a MythUIButtonListItem for every row up front, a
+ * screen with a very large list can hand the list a provider. The list
+ * then only asks for the rows in the visible window plus a prefetch margin
+ * and recycles the item objects as the view scrolls.
+ *
+ * Items returned by a virtualized list stay valid only while they are
+ * visible or current; do not hold on to them across redraws.
+ */
+class MUI_PUBLIC MythUIButtonListProvider
+{
+  public:
+    virtual ~MythUIButtonListProvider() {}
+
+    /// Total number of rows in the list
+    virtual int GetCount(void) const = 0;
+
+    /// Fill in the text, images, states and data of a blank item
+    virtual void FillItem(int row, MythUIButtonListItem *item) = 0;
+
+    /// Returns the row holding the given data, or -1 if not found
+    virtual int FindRowByData(const QVariant &/*data*/) const { return -1; }
+};
+
 /**
  * \class MythUIButtonList
  *
@@ -205,6 +235,12 @@ class MUI_PUBLIC MythUIButtonList : public MythUIType
     void LoadInBackground(int start = 0, int pageSize = 20);
     int  StopLoad(void);
 
+    void SetProvider(MythUIButtonListProvider *provider, int prefetch = 20);
+    MythUIButtonListProvider *GetProvider(void) const { return m_provider; }
+    void RowsInserted(int row, int count = 1);
+    void RowsRemoved(int row, int count = 1);
+    void RowsChanged(int row, int count = 1);
+
   public slots:
     void Select();
     void Deselect();
@@ -275,6 +311,15 @@ class MUI_PUBLIC MythUIButtonList : public MythUIType
 
     void SanitizePosition(void);
 
+    MythUIButtonListItem *ItemAt(int pos) const;
+    MythUIButtonListItem *PeekItemAt(int pos,
+                                     MythUIButtonListItem *&scratch) const;
+    void ReleaseScratchItem(MythUIButtonListItem *scratch) const;
+    void TrimVirtualItems(void);
+    void ClearVirtualItems(void);
+    void ShiftVirtualItems(int row, int offset);
+    void PrefetchImages(void);
+
     /**/
 
     LayoutType  m_layout;
@@ -321,12 +366,20 @@ class MUI_PUBLIC MythUIButtonList : public MythUIType
 
     int m_selPosition;
     int m_topPosition;
+    int m_lastTopPosition;
     int m_itemCount;
     bool m_keepSelAtBottom;
 
     QList<MythUIButtonListItem*> m_itemList;
     int m_nextItemLoaded;
 
+    MythUIButtonListProvider *m_provider;
+    int m_prefetch;
+    mutable QHash<int, MythUIButtonListItem*> m_virtualItems;
+    /// Reverse of m_virtualItems, so an item's row is found without a scan
+    mutable QHash<MythUIButtonListItem*, int> m_virtualRows;
+    mutable QList<MythUIButtonListItem*> m_spareItems;
+
     bool m_drawFromBottom;
 
     QString     m_lcdTitle;
@@ -1,6 +1,9 @@
 #include "mythuihelper.h"
 
 #include <cmath>
+#include <ctime>
+#include <sys/types.h> // for utime
+#include <utime.h>     // for utime
 
 #include <QImage>
 #include <QPixmap>
@@ -18,6 +21,7 @@
 #include <QAtomicInt>
 #include <QEventLoop>
 #include <QTimer>
+#include <QDataStream>
 
 // mythbase headers
 #include "mythdirs.h"
@@ -43,6 +47,88 @@
 
 #define LOC      QString("MythUIHelper: ")
 
+// Images in the disk cache are stored uncompressed so that reading them back
+// costs no more than the file read. Bump the version if the layout changes.
+static const quint32 kRawImageMagic   = 0x4d585249; // "MXRI"
+static const quint32 kRawImageVersion = 1;
+
+static bool SaveRawImage(const QImage &image, const QString &filename)
+{
+    QString tmpfile = filename + ".tmp";
+    QFile f(tmpfile);
+
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << kRawImageMagic << kRawImageVersion
+           << (qint32)image.width() << (qint32)image.height()
+           << (qint32)image.format() << (qint32)image.bytesPerLine();
+
+    qint64 size = (qint64)image.bytesPerLine() * image.height();
+    bool ok = (stream.status() == QDataStream::Ok) &&
+              (f.write((const char *)image.constBits(), size) == size);
+    f.close();
+
+    QFile::remove(filename);
+    if (!ok || !QFile::rename(tmpfile, filename))
+    {
+        QFile::remove(tmpfile);
+        return false;
+    }
+
+    return true;
+}
+
+/// Returns false if filename isn't a raw image, e.g. a cache file written
+/// by an older version in a compressed format.
+static bool LoadRawImage(MythImage *image, const QString &filename)
+{
+    QFile f(filename);
+
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic = 0, version = 0;
+    qint32 width = 0, height = 0, format = 0, bytesPerLine = 0;
+
+    stream >> magic >> version;
+    if (magic != kRawImageMagic || version != kRawImageVersion)
+        return false;
+
+    stream >> width >> height >> format >> bytesPerLine;
+    if (stream.status() != QDataStream::Ok || width <= 0 || height <= 0 ||
+        format <= QImage::Format_Invalid || format >= QImage::NImageFormats)
+        return false;
+
+    QImage raw(width, height, (QImage::Format)format);
+    if (raw.isNull() || raw.bytesPerLine() != bytesPerLine)
+        return false;
+
+    qint64 size = (qint64)bytesPerLine * height;
+    if (f.read((char *)raw.bits(), size) != size)
+        return false;
+
+    image->Assign(raw);
+    image->SetFileName(filename);
+    return true;
+}
+
+/// Marks a disk cache file as just used, for the least recently used
+/// pruning in UpdateDiskCacheSize(). Only the access time is changed, the
+/// modification time is what cached copies are checked against.
+static void TouchCacheFile(const QFileInfo &file)
+{
+    struct utimbuf times;
+    times.actime  = time(NULL);
+    times.modtime = file.lastModified().toTime_t();
+    utime(file.absoluteFilePath().toLocal8Bit().constData(), &times);
+}
+
 static MythUIHelper *mythui = NULL;
 static QMutex uiLock;
 QString MythUIHelper::x11_display;
@@ -121,6 +207,10 @@ public:
     QAtomicInt m_cacheSize;
     QAtomicInt m_maxCacheSize;
 
+    QMutex  m_diskCacheLock;
+    qint64  m_diskCacheSize;    ///< bytes, -1 until the directory is read
+    qint64  m_maxDiskCacheSize;
+
     // The part of the screen(s) allocated for the GUI. Unless
     // overridden by the user, defaults to drawable area above.
     int m_screenxbase, m_screenybase;
@@ -165,6 +255,7 @@ MythUIHelperPrivate::MythUIHelperPrivate(MythUIHelper *p)
       m_baseWidth(800), m_baseHeight(600), m_isWide(false),
       m_cacheLock(new QMutex(QMutex::Recursive)),
       m_cacheSize(0), m_maxCacheSize(30 * 1024 * 1024),
+      m_diskCacheSize(-1), m_maxDiskCacheSize(512 * 1024 * 1024),
       m_screenxbase(0), m_screenybase(0), m_screenwidth(0), m_screenheight(0),
       screensaver(NULL), screensaverEnabled(false), display_res(NULL),
       screenSetup(false), m_imageThreadPool(new MThreadPool("MythUIHelper")),
@@ -435,6 +526,12 @@ void MythUIHelper::Init(MythUIMenuCallbacks &cbs)
     LOG(VB_GUI, LOG_INFO, LOC +
         QString("MythUI Image Cache size set to %1 bytes")
         .arg(d->m_maxCacheSize.fetchAndAddRelease(0)));
+
+    // Cached images are stored uncompressed, so they need a limit of their own
+    QMutexLocker locker(&d->m_diskCacheLock);
+    d->m_maxDiskCacheSize =
+        (qint64)GetMythDB()->GetNumSetting("UIDiskCacheSize", 512) *
+        1024 * 1024;
 }
 
 MythUIMenuCallbacks *MythUIHelper::GetMenuCBs(void)
@@ -602,8 +699,17 @@ MythImage *MythUIHelper::CacheImage(const QString &url, MythImage *im,
         if (!themedir.exists())
             themedir.mkdir(GetMythUI()->GetThemeCacheDir());
 
-        // Save to disk cache
-        im->save(dstfile, "PNG");
+        // Save to disk cache, already scaled and converted
+        qint64 oldSize = QFileInfo(dstfile).size();
+        if (SaveRawImage(*im, dstfile))
+        {
+            UpdateDiskCacheSize(QFileInfo(dstfile).size() - oldSize);
+        }
+        else
+        {
+            LOG(VB_GUI | VB_FILE, LOG_WARNING, LOC +
+                QString("Unable to save (%1) to cache").arg(dstfile));
+        }
     }
 
     // delete the oldest cached images until we fall below threshold.
@@ -777,6 +883,11 @@ void MythUIHelper::ClearOldImageCache(void)
 
     d->themecachedir += '/';
 
+    // the theme or resolution may have changed, count the files again
+    d->m_diskCacheLock.lock();
+    d->m_diskCacheSize = -1;
+    d->m_diskCacheLock.unlock();
+
     dir.setPath(themecachedir);
 
     if (!dir.exists())
@@ -864,6 +975,66 @@ void MythUIHelper::RemoveCacheDir(const QString &dirname)
     dir.rmdir(dirname);
 }
 
+/**
+ *  \brief Adds change bytes to the size of the disk cache, and removes the
+ *         least recently used files once it is over UIDiskCacheSize MB
+ *
+ *  Files are removed until the cache is down to 90% of its limit, so that
+ *  the directory isn't read again for every image saved after that.
+ */
+void MythUIHelper::UpdateDiskCacheSize(qint64 change)
+{
+    QMutexLocker locker(&d->m_diskCacheLock);
+
+    QDir dir(GetThemeCacheDir());
+    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot);
+
+    if (d->m_diskCacheSize < 0)
+    {
+        d->m_diskCacheSize = 0;
+        QFileInfoList list = dir.entryInfoList();
+        for (int i = 0; i < list.size(); ++i)
+            d->m_diskCacheSize += list[i].size();
+    }
+    else
+    {
+        d->m_diskCacheSize += change;
+    }
+
+    if (d->m_diskCacheSize <= d->m_maxDiskCacheSize)
+        return;
+
+    QFileInfoList list = dir.entryInfoList();
+    QMultiMap<QDateTime, QFileInfo> byLastUse;
+    qint64 total = 0;
+    for (int i = 0; i < list.size(); ++i)
+    {
+        byLastUse.insert(list[i].lastRead(), list[i]);
+        total += list[i].size();
+    }
+
+    qint64 target = d->m_maxDiskCacheSize / 10 * 9;
+    int removed = 0;
+
+    QMultiMap<QDateTime, QFileInfo>::const_iterator it = byLastUse.begin();
+    for (; it != byLastUse.end() && total > target; ++it)
+    {
+        if (dir.remove((*it).fileName()))
+        {
+            total -= (*it).size();
+            ++removed;
+        }
+    }
+
+    LOG(VB_GUI | VB_FILE, LOG_INFO, LOC +
+        QString("Disk cache over %1 MB, removed %2 least recently used "
+                "images, %3 MB left")
+            .arg(d->m_maxDiskCacheSize / (1024 * 1024)).arg(removed)
+            .arg(total / (1024 * 1024)));
+
+    d->m_diskCacheSize = total;
+}
+
 void MythUIHelper::GetScreenBounds(int &xbase, int &ybase,
                                    int &width, int &height)
 {
@@ -1655,6 +1826,8 @@ MythImage *MythUIHelper::LoadCacheImage(QString srcfile, QString label,
         // cache
         if (cacheFileInfo.lastModified() >= srcLastModified)
         {
+            TouchCacheFile(cacheFileInfo);
+
             // If we haven't already loaded the image from the memory cache
             // and we're not ignoring the disk cache, then it's time to load
             // it from there instead
@@ -1666,7 +1839,8 @@ MythImage *MythUIHelper::LoadCacheImage(QString srcfile, QString label,
                     ret = painter->GetFormatImage();
 
                     // Load file from disk cache to memory cache
-                    if (ret->Load(cachefilepath))
+                    if (LoadRawImage(ret, cachefilepath) ||
+                        ret->Load(cachefilepath))
                     {
                         // Add to ram cache, and skip saving to disk since that is
                         // where we found this in the first place.
@@ -151,6 +151,7 @@ class MUI_PUBLIC MythUIHelper
 
     void ClearOldImageCache(void);
     void RemoveCacheDir(const QString &dirname);
+    void UpdateDiskCacheSize(qint64 change);
 
     MythUIHelperPrivate *d;
 
@@ -17,6 +17,8 @@
 #include <QRunnable>
 #include <QEvent>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QtAlgorithms>
 
 // libmythbase
 #include "mythlogging.h"
@@ -180,6 +182,48 @@ class ImageLoader
         return false;
     }
 
+    /**
+    *  \brief Decodes a local image directly at the size it will be shown
+    *
+    *  JPEG in particular can be decoded at a fraction of its size much
+    *  faster than decoding it fully and scaling afterwards, which matters
+    *  for cover art and fanart that are far larger than the widget.
+    *  Returns false when the image wouldn't shrink or can't be read this
+    *  way, in which case it should be loaded normally.
+    */
+    static bool LoadScaled(MythImage *image, const QString &filename,
+                           const QSize &size, bool preserveAspect)
+    {
+        if (!filename.startsWith('/') || size.width() <= 0 ||
+            size.height() <= 0)
+            return false;
+
+        QImageReader reader(filename);
+        QSize original = reader.size();
+
+        if (!original.isValid() ||
+            (original.width() <= size.width() &&
+             original.height() <= size.height()))
+            return false;
+
+        QSize scaled = size;
+        if (preserveAspect)
+        {
+            scaled = original;
+            scaled.scale(size, Qt::KeepAspectRatio);
+        }
+
+        reader.setScaledSize(scaled);
+
+        QImage decoded;
+        if (!reader.read(&decoded))
+            return false;
+
+        image->Assign(decoded);
+        image->SetFileName(filename);
+        return true;
+    }
+
     /**
     *  \brief Generates a unique identifying string for this image which is used
     *         as a key in the image cache.
@@ -251,6 +295,7 @@ class ImageLoader
         MythImage *image = NULL;
 
         bool bResize = false;
+        bool bScaled = false;
         bool bFoundInCache = false;
 
         int w = -1;
@@ -305,7 +350,15 @@ class ImageLoader
             if (imageReader)
                 ok = image->Load(imageReader);
             else
-                ok = image->Load(filename);
+            {
+                // Reflection and rotation change the geometry before the
+                // image is resized, so those still take the long way round
+                if (bResize && !imProps.isReflected && !imProps.isOriented)
+                    ok = bScaled = LoadScaled(image, filename, QSize(w, h),
+                                              imProps.preserveAspect);
+                if (!ok)
+                    ok = image->Load(filename);
+            }
 
             if (!ok)
             {
@@ -353,7 +406,7 @@ class ImageLoader
                 }
             }
 
-            if (bResize)
+            if (bResize && !bScaled)
                 image->Resize(QSize(w, h), imProps.preserveAspect);
 
             if (imProps.isMasked)
@@ -463,19 +516,19 @@ class ImageLoadEvent : public QEvent
   public:
     ImageLoadEvent(const MythUIImage *parent, MythImage *image,
                    const QString &basefile, const QString &filename,
-                   int number, bool aborted)
+                   int number, bool aborted, qint64 queued)
         : QEvent(kEventType),
           m_parent(parent), m_image(image), m_basefile(basefile),
           m_filename(filename), m_number(number),
-          m_images(NULL), m_aborted(aborted) { }
+          m_images(NULL), m_aborted(aborted), m_queued(queued) { }
 
     ImageLoadEvent(const MythUIImage *parent, AnimationFrames *frames,
                    const QString &basefile,
-                   const QString &filename, bool aborted)
+                   const QString &filename, bool aborted, qint64 queued)
         : QEvent(kEventType),
           m_parent(parent), m_image(NULL), m_basefile(basefile),
           m_filename(filename), m_number(0),
-          m_images(frames), m_aborted(aborted) { }
+          m_images(frames), m_aborted(aborted), m_queued(queued) { }
 
     const MythUIImage *GetParent() const    { return m_parent; }
     MythImage *GetImage() const       { return m_image; }
@@ -484,6 +537,7 @@ class ImageLoadEvent : public QEvent
     int GetNumber() const             { return m_number; }
     AnimationFrames *GetAnimationFrames() const { return m_images; }
     bool GetAbortState() const        { return m_aborted; }
+    qint64 GetQueuedTime() const      { return m_queued; }
 
     static Type kEventType;
 
@@ -499,6 +553,7 @@ class ImageLoadEvent : public QEvent
 
     // Image Load
     bool             m_aborted;
+    qint64           m_queued;
 };
 
 QEvent::Type ImageLoadEvent::kEventType =
@@ -506,18 +561,26 @@ QEvent::Type ImageLoadEvent::kEventType =
 
 /*!
 * \class ImageLoadThread
+*
+* \brief A single background load, run by a pool thread once
+*        ImageLoadQueue hands it out.
+*
+* Prefetch loads have no parent, the image only ends up in the cache.
 */
-class ImageLoadThread : public QRunnable
+class ImageLoadThread
 {
   public:
     ImageLoadThread(const MythUIImage *parent, MythPainter *painter,
                     const ImageProperties &imProps, const QString &basefile,
                     int number, ImageCacheMode mode) :
         m_parent(parent), m_painter(painter), m_imageProperties(imProps),
-        m_basefile(basefile), m_number(number), m_cacheMode(mode)
+        m_basefile(basefile), m_number(number), m_cacheMode(mode),
+        m_queued(0)
     {
     }
 
+    void SetQueuedTime(qint64 queued) { m_queued = queued; }
+
     void run()
     {
         bool aborted = false;
@@ -525,7 +588,7 @@ class ImageLoadThread : public QRunnable
 
         // NOTE Do NOT use MythImageReader::supportsAnimation here, it defeats
         // the point of caching remote images
-        if (ImageLoader::SupportsAnimation(filename))
+        if (m_parent && ImageLoader::SupportsAnimation(filename))
         {
              AnimationFrames *frames;
 
@@ -539,7 +602,7 @@ class ImageLoadThread : public QRunnable
                 ImageLoadEvent *le = new ImageLoadEvent(m_parent, frames,
                                                         m_basefile,
                                                         m_imageProperties.filename,
-                                                        aborted);
+                                                        aborted, m_queued);
                 QCoreApplication::postEvent(const_cast<MythUIImage*>(m_parent), le);
 
                 return;
@@ -552,9 +615,17 @@ class ImageLoadThread : public QRunnable
                                                     m_cacheMode, m_parent,
                                                     aborted);
 
+        if (!m_parent)
+        {
+            // Prefetch, the cache holds its own reference
+            if (image)
+                image->DecrRef();
+            return;
+        }
+
         ImageLoadEvent *le = new ImageLoadEvent(m_parent, image, m_basefile,
                                                 m_imageProperties.filename,
-                                                m_number, aborted);
+                                                m_number, aborted, m_queued);
         QCoreApplication::postEvent(const_cast<MythUIImage*>(m_parent), le);
     }
 
@@ -565,8 +636,197 @@ private:
     QString         m_basefile;
     int             m_number;
     ImageCacheMode  m_cacheMode;
+    qint64          m_queued;
 };
 
+/*!
+ * \class ImageLoadQueue
+ *
+ * \brief Prioritised queue of pending background image loads
+ *
+ * Loads are not handed to the image thread pool directly. Instead each
+ * queued load starts a runner on the pool which takes whichever load has
+ * the highest priority at the time it gets a thread, so images that are
+ * on screen are decoded before hidden ones and before prefetches. Loads
+ * that have not started yet can be cancelled, which stops fast scrolling
+ * from leaving a long tail of decodes for images that are already gone.
+ */
+class ImageLoadQueue
+{
+  public:
+    enum Priority
+    {
+        kPriorityVisible  = 0,
+        kPriorityHidden   = 1,
+        kPriorityPrefetch = 2,
+        kPriorityCount    = 3,
+    };
+
+    static ImageLoadQueue *GetQueue(void)
+    {
+        static ImageLoadQueue queue;
+        return &queue;
+    }
+
+    void Enqueue(const MythUIImage *owner, ImageLoadThread *load,
+                 Priority priority);
+    int  Cancel(const MythUIImage *owner, bool prefetchOnly);
+    ImageLoadThread *TakeNext(void);
+    void Finished(void);
+
+    qint64 Now(void) const { return m_clock.elapsed(); }
+    void Displayed(qint64 queued);
+    QStringList GetStats(void);
+
+  private:
+    ImageLoadQueue() : m_active(0), m_completed(0), m_cancelled(0),
+        m_latencyPos(0)
+    {
+        m_clock.start();
+    }
+
+    class Request
+    {
+      public:
+        Request() : owner(NULL), load(NULL) {}
+        Request(const MythUIImage *o, ImageLoadThread *l) :
+            owner(o), load(l) {}
+        const MythUIImage *owner;
+        ImageLoadThread   *load;
+    };
+
+    static const int kLatencySamples = 256;
+
+    QMutex         m_lock;
+    QList<Request> m_queues[kPriorityCount];
+    QElapsedTimer  m_clock;
+    int            m_active;
+    uint64_t       m_completed;
+    uint64_t       m_cancelled;
+    QVector<int>   m_latencies;
+    int            m_latencyPos;
+};
+
+/*!
+ * \class ImageLoadRunner
+ *
+ * \brief Pool task which runs the most urgent queued load, if any is left
+ */
+class ImageLoadRunner : public QRunnable
+{
+  public:
+    void run()
+    {
+        ImageLoadQueue *queue = ImageLoadQueue::GetQueue();
+        ImageLoadThread *load = queue->TakeNext();
+        if (!load)
+            return;
+
+        load->run();
+        delete load;
+        queue->Finished();
+    }
+};
+
+void ImageLoadQueue::Enqueue(const MythUIImage *owner, ImageLoadThread *load,
+                             Priority priority)
+{
+    load->SetQueuedTime(Now());
+
+    m_lock.lock();
+    m_queues[priority].append(Request(owner, load));
+    m_lock.unlock();
+
+    GetMythUI()->GetImageThreadPool()->start(new ImageLoadRunner(),
+                                             "ImageLoad");
+}
+
+/// Drops loads for owner which haven't started yet. Returns the number of
+/// dropped loads which would have delivered an image to owner.
+int ImageLoadQueue::Cancel(const MythUIImage *owner, bool prefetchOnly)
+{
+    QMutexLocker locker(&m_lock);
+
+    int delivering = 0;
+    int first = prefetchOnly ? (int)kPriorityPrefetch : 0;
+
+    for (int i = first; i < kPriorityCount; ++i)
+    {
+        QMutableListIterator<Request> it(m_queues[i]);
+        while (it.hasNext())
+        {
+            Request &req = it.next();
+            if (req.owner != owner)
+                continue;
+
+            if (i != kPriorityPrefetch)
+                ++delivering;
+            delete req.load;
+            it.remove();
+            ++m_cancelled;
+        }
+    }
+
+    return delivering;
+}
+
+ImageLoadThread *ImageLoadQueue::TakeNext(void)
+{
+    QMutexLocker locker(&m_lock);
+
+    for (int i = 0; i < kPriorityCount; ++i)
+    {
+        if (!m_queues[i].isEmpty())
+        {
+            ++m_active;
+            return m_queues[i].takeFirst().load;
+        }
+    }
+
+    return NULL;
+}
+
+void ImageLoadQueue::Finished(void)
+{
+    QMutexLocker locker(&m_lock);
+    --m_active;
+    ++m_completed;
+}
+
+/// Records the time from queueing a load to its image being shown
+void ImageLoadQueue::Displayed(qint64 queued)
+{
+    int elapsed = (int)(Now() - queued);
+
+    QMutexLocker locker(&m_lock);
+    if (m_latencies.size() < kLatencySamples)
+        m_latencies.append(elapsed);
+    else
+        m_latencies[m_latencyPos] = elapsed;
+    m_latencyPos = (m_latencyPos + 1) % kLatencySamples;
+}
+
+QStringList ImageLoadQueue::GetStats(void)
+{
+    QMutexLocker locker(&m_lock);
+
+    QVector<int> sorted = m_latencies;
+    qSort(sorted);
+    int p95 = sorted.isEmpty() ? 0 : sorted[(sorted.size() * 95) / 100];
+
+    QStringList stats;
+    stats << QString("Image queue: %1 visible %2 hidden %3 prefetch "
+                     "%4 decoding")
+                 .arg(m_queues[kPriorityVisible].size())
+                 .arg(m_queues[kPriorityHidden].size())
+                 .arg(m_queues[kPriorityPrefetch].size())
+                 .arg(m_active);
+    stats << QString("Image loads: %1 done %2 cancelled, "
+                     "p95 to display %3ms")
+                 .arg(m_completed).arg(m_cancelled).arg(p95);
+    return stats;
+}
+
 /////////////////////////////////////////////////////////////////
 class MythUIImagePrivate
 {
@@ -632,9 +892,11 @@ MythUIImage::MythUIImage(MythUIType *parent, const QString &name)
 
 MythUIImage::~MythUIImage()
 {
-    // Wait until all image loading threads are complete or bad things
-    // may happen if this MythUIImage disappears when a queued thread
-    // needs it.
+    // Drop anything that hasn't started, then wait until all image loading
+    // threads are complete or bad things may happen if this MythUIImage
+    // disappears when a running thread needs it.
+    m_runningThreads -= ImageLoadQueue::GetQueue()->Cancel(this, false);
+
     if (m_runningThreads > 0)
     {
         GetMythUI()->GetImageThreadPool()->waitForDone();
@@ -1061,6 +1323,12 @@ bool MythUIImage::Load(bool allowLoadInBackground, bool forceStat)
 
     int j = 0;
 
+    // Whatever is still queued for this widget is about to be replaced
+    m_runningThreads -= ImageLoadQueue::GetQueue()->Cancel(this, false);
+
+    ImageLoadQueue::Priority priority = IsVisible(true) ?
+        ImageLoadQueue::kPriorityVisible : ImageLoadQueue::kPriorityHidden;
+
     for (int i = m_LowNum; i <= m_HighNum && !m_animatedImage; i++)
     {
         if (!m_animatedImage && m_HighNum != m_LowNum &&
@@ -1107,7 +1375,7 @@ bool MythUIImage::Load(bool allowLoadInBackground, bool forceStat)
                                              imProps,
                                              bFilename, i,
                                              static_cast<ImageCacheMode>(cacheMode2));
-            GetMythUI()->GetImageThreadPool()->start(bImgThread, "ImageLoad");
+            ImageLoadQueue::GetQueue()->Enqueue(this, bImgThread, priority);
         }
         else
         {
@@ -1193,6 +1461,52 @@ bool MythUIImage::Load(bool allowLoadInBackground, bool forceStat)
     return true;
 }
 
+/**
+ *  \brief Load filename into the image cache ahead of it being shown
+ *
+ *  The image is loaded with this widget's properties (size, reflection,
+ *  mask etc.) at the lowest priority, so a later Load() of the same file by
+ *  any widget sharing those properties finds it in the memory cache. Used
+ *  by MythUIButtonList for the items about to be scrolled into view.
+ */
+void MythUIImage::Prefetch(const QString &filename)
+{
+    if (filename.isEmpty() || ImageLoader::SupportsAnimation(filename) ||
+        getenv("DISABLETHREADEDMYTHUIIMAGE"))
+        return;
+
+    d->m_UpdateLock.lockForRead();
+    ImageProperties imProps = m_imageProperties;
+    d->m_UpdateLock.unlock();
+
+    imProps.filename = filename;
+    imProps.isThemeImage = false;
+
+    if (GetMythUI()->IsImageInCache(ImageLoader::GenImageLabel(imProps)))
+        return;
+
+    ImageLoadThread *load = new ImageLoadThread(NULL, GetPainter(), imProps,
+                                                filename, 0, kCacheNormal);
+    ImageLoadQueue::GetQueue()->Enqueue(this, load,
+                                        ImageLoadQueue::kPriorityPrefetch);
+}
+
+/**
+ *  \brief Drop prefetches queued by this widget which haven't started yet
+ */
+void MythUIImage::CancelPrefetch(void)
+{
+    ImageLoadQueue::GetQueue()->Cancel(this, true);
+}
+
+/**
+ *  \brief Describes the background image loader, for debugging overlays
+ */
+QStringList MythUIImage::GetLoaderStats(void)
+{
+    return ImageLoadQueue::GetQueue()->GetStats();
+}
+
 /**
  *  \copydoc MythUIType::Pulse()
  */
@@ -1653,6 +1967,8 @@ void MythUIImage::customEvent(QEvent *event)
         }
         else if (image)
         {
+            ImageLoadQueue::GetQueue()->Displayed(le->GetQueuedTime());
+
             // We don't clear until we have the new image ready to display to
             // avoid unsightly flashing. This isn't currently supported for
             // animations.
@@ -137,6 +137,11 @@ class MUI_PUBLIC MythUIImage : public MythUIType
 
     void SetOrientation(int orientation);
 
+    void Prefetch(const QString &filename);
+    void CancelPrefetch(void);
+
+    static QStringList GetLoaderStats(void);
+
   signals:
     void LoadComplete();
 
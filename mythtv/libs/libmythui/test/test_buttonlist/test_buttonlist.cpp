@@ -0,0 +1,3 @@
+#include "test_buttonlist.h"
+
+QTEST_APPLESS_MAIN(TestButtonList)
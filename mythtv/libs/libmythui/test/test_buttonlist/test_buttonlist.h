@@ -0,0 +1,233 @@
+/*
+ *  Class TestButtonList
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <unistd.h>
+#include <cstdio>
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSet>
+
+#include "mythcorecontext.h"
+#include "mythdb.h"
+#include "mythuibuttonlist.h"
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#define MSKIP(MSG) QSKIP(MSG, SkipSingle)
+#else
+#define MSKIP(MSG) QSKIP(MSG)
+#endif
+
+/// Provider with numbered rows, which can gain and lose rows
+class CountingProvider : public MythUIButtonListProvider
+{
+  public:
+    explicit CountingProvider(int count) : m_fills(0)
+    {
+        for (int i = 0; i < count; ++i)
+            m_rows.append(i);
+    }
+
+    int GetCount(void) const { return m_rows.size(); }
+
+    void FillItem(int row, MythUIButtonListItem *item)
+    {
+        ++m_fills;
+        m_items.insert(item);
+        item->SetText(QString::number(m_rows[row]));
+        item->SetData(m_rows[row]);
+    }
+
+    QList<int> m_rows;
+    int        m_fills;
+    QSet<MythUIButtonListItem*> m_items; ///< every item it has filled
+};
+
+/// Resident size of this process in kB, 0 where /proc isn't there
+static long ResidentKB(void)
+{
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return 0;
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return 0;
+    return fields[1].toLong() * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ *  Tests a virtualized list without a theme, so only the rows asked for
+ *  are held.
+ */
+class TestButtonList: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    // called at the beginning of these sets of tests
+    void initTestCase(void)
+    {
+        gCoreContext = new MythCoreContext("bin_version", NULL);
+        gCoreContext->GetDB()->IgnoreDatabase(true);
+    }
+
+    void HeldItemKnowsItsRow(void)
+    {
+        CountingProvider provider(1000);
+        MythUIButtonList list(NULL, "list");
+        list.SetProvider(&provider);
+
+        MythUIButtonListItem *item = list.GetItemAt(500);
+        QVERIFY(item);
+        QCOMPARE(item->GetText(), QString("500"));
+        QCOMPARE(list.GetItemPos(item), 500);
+        QCOMPARE(list.GetItemPos(list.GetItemAt(3)), 3);
+
+        // asking again doesn't fill the item again
+        int fills = provider.m_fills;
+        QCOMPARE(list.GetItemAt(500), item);
+        QCOMPARE(provider.m_fills, fills);
+
+        list.SetProvider(NULL);
+    }
+
+    void RowFollowsInsertAndRemove(void)
+    {
+        CountingProvider provider(100);
+        MythUIButtonList list(NULL, "list");
+        list.SetProvider(&provider);
+
+        MythUIButtonListItem *before = list.GetItemAt(10);
+        MythUIButtonListItem *after = list.GetItemAt(50);
+
+        provider.m_rows.insert(20, -1);
+        provider.m_rows.insert(20, -2);
+        list.RowsInserted(20, 2);
+        QCOMPARE(list.GetItemPos(before), 10);
+        QCOMPARE(list.GetItemPos(after), 52);
+        QCOMPARE(list.GetItemAt(52), after);
+
+        provider.m_rows.removeAt(10);
+        list.RowsRemoved(10);
+        QCOMPARE(list.GetItemPos(before), -1);
+        QCOMPARE(list.GetItemPos(after), 51);
+        QCOMPARE(list.GetItemAt(51), after);
+
+        // the recycled item gets a new row
+        MythUIButtonListItem *reused = list.GetItemAt(90);
+        QCOMPARE(reused, before);
+        QCOMPARE(list.GetItemPos(reused), 90);
+        QCOMPARE(reused->GetText(), QString("89"));
+
+        list.SetProvider(NULL);
+    }
+
+    void ItemNotInTheListHasNoRow(void)
+    {
+        CountingProvider provider(10);
+        MythUIButtonList list(NULL, "list");
+        list.SetProvider(&provider);
+
+        MythUIButtonList other(NULL, "other");
+        MythUIButtonListItem *item = new MythUIButtonListItem(&other, "x");
+        QCOMPARE(list.GetItemPos(item), -1);
+        QCOMPARE(list.GetItemPos(NULL), -1);
+
+        list.SetProvider(NULL);
+    }
+
+    void FindDoesNotHoldRows(void)
+    {
+        CountingProvider provider(10000);
+        MythUIButtonList list(NULL, "list");
+        list.SetProvider(&provider);
+
+        MythUIButtonListItem *first = list.GetItemAt(0);
+        QVERIFY(list.Find("9999"));
+        QCOMPARE(list.GetCurrentPos(), 9999);
+        QCOMPARE(list.GetItemCurrent()->GetText(), QString("9999"));
+        QCOMPARE(list.GetItemPos(first), 0);
+
+        // every row was looked at through the same scratch item
+        QVERIFY(provider.m_fills >= 10000);
+        QVERIFY(provider.m_items.size() <= 3);
+
+        QVERIFY(!list.Find("no such row"));
+        QCOMPARE(list.GetCurrentPos(), 9999);
+        QVERIFY(provider.m_items.size() <= 3);
+
+        list.SetProvider(NULL);
+    }
+
+    /**
+     * Benchmark opening and searching a list of synthetic rows through a
+     * provider, against the same rows added as items.
+     *
+     * MYTHTV_BUTTONLIST_BENCH sets the number of rows, 100000 is a large
+     * music library, it is skipped if it isn't set. The results are
+     * printed on a line starting "BUTTONLISTBENCH ".
+     */
+    void ProviderBench(void)
+    {
+        QByteArray env = qgetenv("MYTHTV_BUTTONLIST_BENCH");
+        if (env.isEmpty())
+            MSKIP("Set MYTHTV_BUTTONLIST_BENCH to the number of rows");
+        int rows = env.toInt();
+        QVERIFY(rows > 0);
+
+        QElapsedTimer timer;
+        CountingProvider provider(rows);
+        MythUIButtonList list(NULL, "list");
+
+        long rss = ResidentKB();
+        timer.start();
+        list.SetProvider(&provider);
+        qint64 open = timer.nsecsElapsed();
+        long openKB = ResidentKB() - rss;
+
+        timer.start();
+        list.Find(QString::number(rows - 1));
+        qint64 find = timer.nsecsElapsed();
+        QCOMPARE(list.GetCurrentPos(), rows - 1);
+        int held = provider.m_items.size();
+        list.SetProvider(NULL);
+
+        MythUIButtonList items(NULL, "items");
+        rss = ResidentKB();
+        timer.start();
+        for (int i = 0; i < rows; ++i)
+            new MythUIButtonListItem(&items, QString::number(i), i);
+        qint64 fill = timer.nsecsElapsed();
+        long fillKB = ResidentKB() - rss;
+        items.Reset();
+
+        printf("BUTTONLISTBENCH {\"rows\":%d,\"open_ms\":%.3f,"
+               "\"open_kb\":%ld,\"find_ms\":%.3f,\"items_held\":%d,"
+               "\"items_ms\":%.3f,\"items_kb\":%ld}\n",
+               rows, open / 1e6, openKB, find / 1e6, held,
+               fill / 1e6, fillKB);
+    }
+
+    // called at the end of these sets of tests
+    void cleanupTestCase(void)
+    {
+        delete gCoreContext;
+        gCoreContext = NULL;
+    }
+};
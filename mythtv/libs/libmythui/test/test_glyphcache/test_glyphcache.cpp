@@ -0,0 +1,10 @@
+#include "test_glyphcache.h"
+
+int main(int argc, char *argv[])
+{
+    // Fonts need a GUI application, run with QT_QPA_PLATFORM=offscreen
+    // when there is no display
+    QApplication app(argc, argv);
+    TestGlyphCache test;
+    return QTest::qExec(&test, argc, argv);
+}
@@ -0,0 +1,254 @@
+/*
+ *  Class TestGlyphCache
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <cstdio>
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QImage>
+
+#include "mythcorecontext.h"
+#include "mythdb.h"
+#include "mythfontproperties.h"
+#include "mythglyphcache.h"
+#include "mythpainter_qimage.h"
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#define MSKIP(MSG) QSKIP(MSG, SkipSingle)
+#else
+#define MSKIP(MSG) QSKIP(MSG)
+#endif
+
+/**
+ *  QImage painter that counts how it is asked to draw, and can have the
+ *  glyph atlas turned off to compare against the string image cache.
+ */
+class CountingPainter : public MythQImagePainter
+{
+  public:
+    CountingPainter() : m_images(0), m_batches(0) { }
+
+    void SetGlyphCache(bool enable)
+    {
+        if (enable)
+            EnableGlyphCache();
+        else
+        {
+            delete m_glyphCache;
+            m_glyphCache = NULL;
+        }
+    }
+
+    void DrawImage(const QRect &dest, MythImage *im, const QRect &src,
+                   int alpha)
+    {
+        ++m_images;
+        MythQImagePainter::DrawImage(dest, im, src, alpha);
+    }
+
+    void DrawImages(MythImage *im, const QVector<QRect> &dests,
+                    const QVector<QRect> &srcs, int alpha)
+    {
+        ++m_batches;
+        MythQImagePainter::DrawImages(im, dests, srcs, alpha);
+    }
+
+    int m_images;
+    int m_batches;
+};
+
+class TestGlyphCache: public QObject
+{
+    Q_OBJECT
+
+  private:
+    MythFontProperties m_font;
+
+    /// Bounding box of the pixels drawn into the image
+    static QRect Drawn(const QImage &image)
+    {
+        QRect drawn;
+        for (int y = 0; y < image.height(); ++y)
+        {
+            const QRgb *line =
+                reinterpret_cast<const QRgb *>(image.constScanLine(y));
+            for (int x = 0; x < image.width(); ++x)
+            {
+                if (qAlpha(line[x]))
+                    drawn |= QRect(x, y, 1, 1);
+            }
+        }
+        return drawn;
+    }
+
+    QImage Render(bool atlas, const QString &msg, int flags)
+    {
+        QImage image(400, 100, QImage::Format_ARGB32_Premultiplied);
+        image.fill(0);
+
+        CountingPainter painter;
+        painter.SetGlyphCache(atlas);
+        painter.Begin(&image);
+        painter.DrawText(image.rect(), msg, flags, m_font, 255, QRect());
+        painter.End();
+
+        return image;
+    }
+
+    /// Draws a screenful of guide cells, scrolled by one row each frame
+    static double Scroll(CountingPainter &painter, QImage &screen,
+                         const MythFontProperties &font, int strings)
+    {
+        const int rows = 30;
+        const QRect cell(0, 0, 400, screen.height() / rows);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int first = 0; first + rows <= strings; ++first)
+        {
+            screen.fill(0);
+            painter.Begin(&screen);
+            for (int row = 0; row < rows; ++row)
+            {
+                QRect r = cell.translated(0, row * cell.height());
+                painter.DrawText(r, QString("Programme %1: Episode title")
+                                        .arg(first + row),
+                                 Qt::AlignLeft | Qt::AlignVCenter, font,
+                                 255, r);
+            }
+            painter.End();
+        }
+
+        return timer.nsecsElapsed() / 1000000.0;
+    }
+
+  private slots:
+    // called at the beginning of these sets of tests
+    void initTestCase(void)
+    {
+        gCoreContext = new MythCoreContext("bin_version", NULL);
+        gCoreContext->GetDB()->IgnoreDatabase(true);
+
+        QFont face("Sans");
+        face.setPixelSize(20);
+        m_font.SetFace(face);
+        m_font.SetColor(Qt::white);
+    }
+
+    void StringIsOneDrawPerPage(void)
+    {
+        QImage image(400, 100, QImage::Format_ARGB32_Premultiplied);
+        image.fill(0);
+
+        CountingPainter painter;
+        painter.Begin(&image);
+        painter.DrawText(image.rect(), "The quick brown fox", Qt::AlignLeft,
+                         m_font, 255, QRect());
+        painter.DrawText(image.rect(), "The quick brown fox", Qt::AlignRight,
+                         m_font, 255, QRect());
+        painter.End();
+
+        QCOMPARE(painter.m_batches, 2);
+        QCOMPARE(painter.m_images, 0);
+    }
+
+    void OutlinedTextUsesStringImages(void)
+    {
+        MythFontProperties font = m_font;
+        font.SetOutline(true, Qt::black, 2, 255);
+
+        QImage image(400, 100, QImage::Format_ARGB32_Premultiplied);
+        image.fill(0);
+
+        CountingPainter painter;
+        painter.Begin(&image);
+        painter.DrawText(image.rect(), "Outlined", Qt::AlignLeft, font, 255,
+                         QRect());
+        painter.End();
+
+        QCOMPARE(painter.m_batches, 0);
+        QCOMPARE(painter.m_images, 1);
+    }
+
+    void AtlasTextIsPlacedLikeStringImages(void)
+    {
+        int flags[] = { Qt::AlignLeft | Qt::AlignTop,
+                        Qt::AlignHCenter | Qt::AlignVCenter,
+                        Qt::AlignRight | Qt::AlignBottom };
+
+        for (uint i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i)
+        {
+            QRect atlas  = Drawn(Render(true, "Jumped over", flags[i]));
+            QRect string = Drawn(Render(false, "Jumped over", flags[i]));
+
+            QVERIFY(!atlas.isEmpty());
+            // rounding of the glyph positions may move edges by a pixel
+            QVERIFY2(qAbs(atlas.left() - string.left()) <= 2 &&
+                     qAbs(atlas.top() - string.top()) <= 2 &&
+                     qAbs(atlas.right() - string.right()) <= 2 &&
+                     qAbs(atlas.bottom() - string.bottom()) <= 2,
+                     qPrintable(QString("flags %1: atlas %2,%3 %4x%5 "
+                                        "string %6,%7 %8x%9")
+                         .arg(flags[i])
+                         .arg(atlas.x()).arg(atlas.y())
+                         .arg(atlas.width()).arg(atlas.height())
+                         .arg(string.x()).arg(string.y())
+                         .arg(string.width()).arg(string.height())));
+        }
+    }
+
+    /**
+     * Benchmark scrolling through guide cells with and without the atlas.
+     *
+     * MYTHTV_GLYPHBENCH_STRINGS sets how many different strings are
+     * scrolled through, it is skipped if it isn't set. The results are
+     * printed on a line starting "GLYPHBENCH ".
+     */
+    void ScrollBench(void)
+    {
+        QByteArray env = qgetenv("MYTHTV_GLYPHBENCH_STRINGS");
+        if (env.isEmpty())
+            MSKIP("Set MYTHTV_GLYPHBENCH_STRINGS to the number of strings");
+        int strings = env.toInt();
+        QVERIFY(strings >= 30);
+
+        QImage screen(1280, 720, QImage::Format_ARGB32_Premultiplied);
+
+        CountingPainter atlas;
+        double atlasMs = Scroll(atlas, screen, m_font, strings);
+
+        CountingPainter images;
+        images.SetGlyphCache(false);
+        double imagesMs = Scroll(images, screen, m_font, strings);
+
+        printf("GLYPHBENCH {\"strings\":%d,\"frames\":%d,"
+               "\"atlas_ms\":%.1f,\"atlas_draws\":%d,"
+               "\"string_ms\":%.1f,\"string_draws\":%d}\n",
+               strings, strings - 29, atlasMs, atlas.m_batches,
+               imagesMs, images.m_images);
+    }
+
+    // called at the end of these sets of tests
+    void cleanupTestCase(void)
+    {
+        delete gCoreContext;
+        gCoreContext = NULL;
+    }
+};
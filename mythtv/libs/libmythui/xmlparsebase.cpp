@@ -15,6 +15,7 @@
 
 // libmyth headers
 #include "mythlogging.h"
+#include "mythtimer.h"
 
 // Mythui headers
 #include "mythmainwindow.h"
@@ -40,6 +41,7 @@
 #include "mythuivideo.h"
 #include "mythuieditbar.h"
 #include "mythfontproperties.h"
+#include "xmlparsecache.h"
 
 #define LOC      QString("XMLParseBase: ")
 
@@ -627,44 +629,17 @@ bool XMLParseBase::WindowExists(const QString &xmlfile,
     for (; it != searchpath.end(); ++it)
     {
         QString themefile = *it + xmlfile;
-        QFile f(themefile);
+        XMLParseCache::File compiled;
 
-        if (!f.open(QIODevice::ReadOnly))
+        if (!XMLParseCache::GetCache()->GetFile(themefile, compiled))
             continue;
 
-        QDomDocument doc;
-        QString errorMsg;
-        int errorLine = 0;
-        int errorColumn = 0;
-
-        if (!doc.setContent(&f, false, &errorMsg, &errorLine, &errorColumn))
+        QList<XMLParseCache::Entry>::const_iterator eit =
+            compiled.m_entries.begin();
+        for (; eit != compiled.m_entries.end(); ++eit)
         {
-            LOG(VB_GENERAL, LOG_ERR, LOC +
-                QString("Location: '%1' @ %2 column: %3"
-                        "\n\t\t\tError: %4")
-                    .arg(qPrintable(themefile)).arg(errorLine).arg(errorColumn)
-                    .arg(qPrintable(errorMsg)));
-            f.close();
-            continue;
-        }
-
-        f.close();
-
-        QDomElement docElem = doc.documentElement();
-        QDomNode n = docElem.firstChild();
-        while (!n.isNull())
-        {
-            QDomElement e = n.toElement();
-            if (!e.isNull())
-            {
-                if (e.tagName() == "window")
-                {
-                    QString name = e.attribute("name", "");
-                    if (name == windowname)
-                        return true;
-                }
-            }
-            n = n.nextSibling();
+            if ((*eit).m_tagName == "window" && (*eit).m_name == windowname)
+                return true;
         }
     }
 
@@ -678,6 +653,9 @@ bool XMLParseBase::LoadWindowFromXML(const QString &xmlfile,
     bool onlyLoadWindows = true;
     bool showWarnings = true;
 
+    MythTimer timer;
+    timer.start();
+
     const QStringList searchpath = GetMythUI()->GetThemeSearchPath();
     QStringList::const_iterator it = searchpath.begin();
     for (; it != searchpath.end(); ++it)
@@ -687,6 +665,12 @@ bool XMLParseBase::LoadWindowFromXML(const QString &xmlfile,
         if (doLoad(windowname, parent, themefile,
                    onlyLoadWindows, showWarnings))
         {
+            XMLParseCache *cache = XMLParseCache::GetCache();
+            LOG(VB_GUI, LOG_INFO, LOC +
+                QString("Loaded window %1 in %2 ms "
+                        "(compiled theme cache hits: %3 misses: %4)")
+                    .arg(windowname).arg(timer.elapsed())
+                    .arg(cache->GetHits()).arg(cache->GetMisses()));
             return true;
         }
         else
@@ -708,120 +692,119 @@ bool XMLParseBase::doLoad(const QString &windowname,
                           bool onlywindows,
                           bool showWarnings)
 {
-    QDomDocument doc;
-    QFile f(filename);
+    XMLParseCache::File compiled;
 
-    if (!f.open(QIODevice::ReadOnly))
+    if (!XMLParseCache::GetCache()->GetFile(filename, compiled))
         return false;
 
-    QString errorMsg;
-    int errorLine = 0;
-    int errorColumn = 0;
-
-    if (!doc.setContent(&f, false, &errorMsg, &errorLine, &errorColumn))
+    QList<XMLParseCache::Entry>::const_iterator it = compiled.m_entries.begin();
+    for (; it != compiled.m_entries.end(); ++it)
     {
-        LOG(VB_GENERAL, LOG_ERR, LOC +
-            QString("Location: '%1' @ %2 column: %3"
-                    "\n\t\t\tError: %4")
-                .arg(qPrintable(filename)).arg(errorLine).arg(errorColumn)
-                .arg(qPrintable(errorMsg)));
-        f.close();
-        return false;
-    }
+        const XMLParseCache::Entry &entry = *it;
 
-    f.close();
+        if (entry.m_tagName == "include")
+        {
+            if (!entry.m_include.isEmpty())
+                 LoadBaseTheme(entry.m_include);
+            continue;
+        }
 
-    QDomElement docElem = doc.documentElement();
-    QDomNode n = docElem.firstChild();
-    while (!n.isNull())
-    {
-        QDomElement e = n.toElement();
-        if (!e.isNull())
+        if (onlywindows)
         {
-            if (e.tagName() == "include")
-            {
-                QString include = getFirstText(e);
+            if (entry.m_tagName != "window")
+                continue;
 
-                if (!include.isEmpty())
-                     LoadBaseTheme(include);
+            if (entry.m_name.isEmpty())
+            {
+                LOG(VB_GENERAL, LOG_ERR, LOC +
+                    QString("Window needs a name\n\t\t\tLocation: %1")
+                        .arg(filename));
+                return false;
             }
 
-            if (onlywindows && e.tagName() == "window")
+            if (!entry.m_include.isEmpty())
+                LoadBaseTheme(entry.m_include);
+
+            // Only the requested window is expanded back into a DOM tree
+            if (entry.m_name == windowname)
             {
-                QString name = e.attribute("name", "");
-                QString include = e.attribute("include", "");
-                if (name.isEmpty())
+                QDomDocument doc;
+                QDomElement e = XMLParseCache::Expand(entry, doc);
+                if (e.isNull())
                 {
-                    VERBOSE_XML(VB_GENERAL, LOG_ERR, filename, e,
-                                "Window needs a name");
+                    LOG(VB_GENERAL, LOG_ERR, LOC +
+                        QString("Unable to expand window '%1' from '%2'")
+                            .arg(windowname).arg(filename));
                     return false;
                 }
 
-                if (!include.isEmpty())
-                    LoadBaseTheme(include);
-
-                if (name == windowname)
-                {
-                    ParseChildren(filename, e, parent, showWarnings);
-                    return true;
-                }
+                ParseChildren(filename, e, parent, showWarnings);
+                return true;
             }
 
-            if (!onlywindows)
-            {
-                QString type = e.tagName();
-                if (type == "font" || type == "fontdef")
-                {
-                    bool global = (GetGlobalObjectStore() == parent);
-                    MythFontProperties *font = MythFontProperties::ParseFromXml(
-                        filename, e, parent, global, showWarnings);
-
-                    if (!global && font)
-                    {
-                        QString name = e.attribute("name");
-                        parent->AddFont(name, font);
-                    }
-                    delete font;
-                }
-                else if (type == "imagetype" ||
-                         type == "textarea" ||
-                         type == "group" ||
-                         type == "textedit" ||
-                         type == "button" ||
-                         type == "buttonlist" ||
-                         type == "buttonlist2" ||
-                         type == "buttontree" ||
-                         type == "spinbox" ||
-                         type == "checkbox" ||
-                         type == "statetype" ||
-                         type == "window" ||
-                         type == "clock" ||
-                         type == "progressbar" ||
-                         type == "scrollbar" ||
-                         type == "webbrowser" ||
-                         type == "guidegrid" ||
-                         type == "shape" ||
-                         type == "editbar" ||
-                         type == "video")
-                {
+            continue;
+        }
 
-                    // We don't want widgets in base.xml
-                    // depending on each other so ignore dependsMap
-                    QMap<QString, QString> dependsMap;
-                    MythUIType *uitype = NULL;
-                    uitype = ParseUIType(filename, e, type, parent,
-                                         NULL, showWarnings, dependsMap);
-                    if (uitype)
-                        uitype->ConnectDependants(true);
-                }
-                else
-                {
-                    VERBOSE_XML(VB_GENERAL, LOG_ERR, filename, e,
-                                "Unknown widget type");
-                }
+        QDomDocument doc;
+        QDomElement e = XMLParseCache::Expand(entry, doc);
+        if (e.isNull())
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC +
+                QString("Unable to expand '%1' from '%2'")
+                    .arg(entry.m_tagName).arg(filename));
+            continue;
+        }
+
+        QString type = e.tagName();
+        if (type == "font" || type == "fontdef")
+        {
+            bool global = (GetGlobalObjectStore() == parent);
+            MythFontProperties *font = MythFontProperties::ParseFromXml(
+                filename, e, parent, global, showWarnings);
+
+            if (!global && font)
+            {
+                QString name = e.attribute("name");
+                parent->AddFont(name, font);
             }
+            delete font;
+        }
+        else if (type == "imagetype" ||
+                 type == "textarea" ||
+                 type == "group" ||
+                 type == "textedit" ||
+                 type == "button" ||
+                 type == "buttonlist" ||
+                 type == "buttonlist2" ||
+                 type == "buttontree" ||
+                 type == "spinbox" ||
+                 type == "checkbox" ||
+                 type == "statetype" ||
+                 type == "window" ||
+                 type == "clock" ||
+                 type == "progressbar" ||
+                 type == "scrollbar" ||
+                 type == "webbrowser" ||
+                 type == "guidegrid" ||
+                 type == "shape" ||
+                 type == "editbar" ||
+                 type == "video")
+        {
+
+            // We don't want widgets in base.xml
+            // depending on each other so ignore dependsMap
+            QMap<QString, QString> dependsMap;
+            MythUIType *uitype = NULL;
+            uitype = ParseUIType(filename, e, type, parent,
+                                 NULL, showWarnings, dependsMap);
+            if (uitype)
+                uitype->ConnectDependants(true);
+        }
+        else
+        {
+            VERBOSE_XML(VB_GENERAL, LOG_ERR, filename, e,
+                        "Unknown widget type");
         }
-        n = n.nextSibling();
     }
     if (onlywindows)
         return false;
@@ -0,0 +1,364 @@
+// Own header
+#include "xmlparsecache.h"
+
+// C++ headers
+#include <cstdio>
+
+// QT headers
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QDomDocument>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+// libmythbase headers
+#include "mythlogging.h"
+#include "mythdirs.h"
+
+#define LOC      QString("XMLParseCache: ")
+
+// Bump whenever the on disk format changes
+static const quint32 kCacheMagic   = 0x4d585443; // "MXTC"
+static const quint32 kCacheVersion = 1;
+
+// Guard against corrupt cache files sending us into deep recursion
+static const int kMaxDepth = 256;
+
+enum NodeType
+{
+    kNodeElement = 1,
+    kNodeText    = 2,
+    kNodeCDATA   = 3,
+};
+
+XMLParseCache *XMLParseCache::GetCache(void)
+{
+    static QMutex lock;
+    static XMLParseCache *cache = NULL;
+
+    QMutexLocker locker(&lock);
+    if (!cache)
+        cache = new XMLParseCache();
+    return cache;
+}
+
+XMLParseCache::XMLParseCache(void)
+  : m_cacheDir(GetConfDir() + "/cache/themexmlcache/"),
+    m_hits(0), m_misses(0)
+{
+}
+
+bool XMLParseCache::GetFile(const QString &filename, File &file)
+{
+    QFileInfo fi(filename);
+    if (!fi.exists() || !fi.isReadable())
+        return false;
+
+    QMutexLocker locker(&m_lock);
+
+    QHash<QString, File>::const_iterator it = m_files.find(filename);
+    if (it != m_files.end() &&
+        (*it).m_modified == fi.lastModified() && (*it).m_size == fi.size())
+    {
+        file = *it;
+        m_hits++;
+        return true;
+    }
+
+    m_misses++;
+    m_files.remove(filename);
+
+    if (!LoadFromDisk(filename, file) ||
+        file.m_modified != fi.lastModified() || file.m_size != fi.size())
+    {
+        file = File();
+        file.m_filename = filename;
+        file.m_modified = fi.lastModified();
+        file.m_size     = fi.size();
+
+        if (!Compile(filename, file))
+            return false;
+
+        SaveToDisk(file);
+    }
+
+    m_files.insert(filename, file);
+    return true;
+}
+
+bool XMLParseCache::Compile(const QString &filename, File &file)
+{
+    QFile f(filename);
+
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QDomDocument doc;
+    QString errorMsg;
+    int errorLine = 0;
+    int errorColumn = 0;
+
+    if (!doc.setContent(&f, false, &errorMsg, &errorLine, &errorColumn))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Location: '%1' @ %2 column: %3"
+                    "\n\t\t\tError: %4")
+                .arg(qPrintable(filename)).arg(errorLine).arg(errorColumn)
+                .arg(qPrintable(errorMsg)));
+        f.close();
+        return false;
+    }
+
+    f.close();
+
+    QDomElement docElem = doc.documentElement();
+    for (QDomNode n = docElem.firstChild(); !n.isNull(); n = n.nextSibling())
+    {
+        QDomElement e = n.toElement();
+        if (e.isNull())
+            continue;
+
+        Entry entry;
+        entry.m_tagName = e.tagName();
+        entry.m_name    = e.attribute("name", "");
+
+        if (entry.m_tagName == "include")
+        {
+            for (QDomNode t = e.firstChild(); !t.isNull(); t = t.nextSibling())
+            {
+                if (t.isText())
+                {
+                    entry.m_include = t.toText().data();
+                    break;
+                }
+            }
+        }
+        else
+        {
+            entry.m_include = e.attribute("include", "");
+
+            QDataStream stream(&entry.m_tree, QIODevice::WriteOnly);
+            stream.setVersion(QDataStream::Qt_4_6);
+            EncodeNode(stream, e);
+        }
+
+        file.m_entries.append(entry);
+    }
+
+    LOG(VB_GUI | VB_FILE, LOG_INFO, LOC +
+        QString("Compiled '%1' (%2 elements)")
+            .arg(filename).arg(file.m_entries.size()));
+
+    return true;
+}
+
+QDomElement XMLParseCache::Expand(const Entry &entry, QDomDocument &doc)
+{
+    QDataStream stream(entry.m_tree);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    quint8 type = 0;
+    stream >> type;
+    if (type != kNodeElement)
+        return QDomElement();
+
+    QDomElement e = DecodeNode(stream, doc, 0);
+    if (stream.status() != QDataStream::Ok)
+        return QDomElement();
+
+    doc.appendChild(e);
+    return e;
+}
+
+void XMLParseCache::EncodeNode(QDataStream &stream, const QDomElement &element)
+{
+    stream << (quint8)kNodeElement << element.tagName();
+
+    QDomNamedNodeMap attrs = element.attributes();
+    stream << (quint32)attrs.count();
+    for (int i = 0; i < attrs.count(); ++i)
+    {
+        QDomAttr attr = attrs.item(i).toAttr();
+        stream << attr.name() << attr.value();
+    }
+
+    quint32 children = 0;
+    QDomNode n;
+    for (n = element.firstChild(); !n.isNull(); n = n.nextSibling())
+    {
+        if (n.isElement() || n.isText())
+            children++;
+    }
+
+    stream << children;
+    for (n = element.firstChild(); !n.isNull(); n = n.nextSibling())
+    {
+        if (n.isElement())
+            EncodeNode(stream, n.toElement());
+        else if (n.isCDATASection())
+            stream << (quint8)kNodeCDATA << n.toCDATASection().data();
+        else if (n.isText())
+            stream << (quint8)kNodeText << n.toText().data();
+    }
+}
+
+/// Decodes an element whose type marker has already been read.
+QDomElement XMLParseCache::DecodeNode(QDataStream &stream, QDomDocument &doc,
+                                      int depth)
+{
+    QString tagName;
+    quint32 count = 0;
+
+    stream >> tagName >> count;
+    if (stream.status() != QDataStream::Ok || depth > kMaxDepth)
+    {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return QDomElement();
+    }
+
+    QDomElement element = doc.createElement(tagName);
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString name, value;
+        stream >> name >> value;
+        element.setAttribute(name, value);
+    }
+
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        quint8 type = 0;
+        QString data;
+
+        stream >> type;
+        switch (type)
+        {
+            case kNodeElement:
+                element.appendChild(DecodeNode(stream, doc, depth + 1));
+                break;
+            case kNodeText:
+                stream >> data;
+                element.appendChild(doc.createTextNode(data));
+                break;
+            case kNodeCDATA:
+                stream >> data;
+                element.appendChild(doc.createCDATASection(data));
+                break;
+            default:
+                stream.setStatus(QDataStream::ReadCorruptData);
+                break;
+        }
+    }
+
+    return element;
+}
+
+QString XMLParseCache::DiskCacheFilename(const QString &filename) const
+{
+    QByteArray hash = QCryptographicHash::hash(
+        QFileInfo(filename).absoluteFilePath().toUtf8(),
+        QCryptographicHash::Md5).toHex();
+    return m_cacheDir + QString(hash) + ".bin";
+}
+
+bool XMLParseCache::LoadFromDisk(const QString &filename, File &file)
+{
+    QFile f(DiskCacheFilename(filename));
+
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic = 0, version = 0, count = 0;
+    qint64 modified = 0;
+
+    stream >> magic >> version;
+    if (magic != kCacheMagic || version != kCacheVersion)
+        return false;
+
+    stream >> file.m_filename >> modified >> file.m_size >> count;
+    if (stream.status() != QDataStream::Ok || file.m_filename != filename)
+        return false;
+
+    file.m_modified = QDateTime::fromMSecsSinceEpoch(modified);
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        Entry entry;
+        stream >> entry.m_tagName >> entry.m_name >> entry.m_include
+               >> entry.m_tree;
+        file.m_entries.append(entry);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        LOG(VB_GUI | VB_FILE, LOG_WARNING, LOC +
+            QString("Discarding corrupt cache file for '%1'").arg(filename));
+        file.m_entries.clear();
+        return false;
+    }
+
+    LOG(VB_GUI | VB_FILE, LOG_DEBUG, LOC +
+        QString("Loaded compiled '%1' from disk").arg(filename));
+
+    return true;
+}
+
+void XMLParseCache::SaveToDisk(const File &file)
+{
+    QDir dir;
+    if (!dir.mkpath(m_cacheDir))
+        return;
+
+    QString cachefile = DiskCacheFilename(file.m_filename);
+    QString tmpfile = cachefile + ".tmp";
+    QFile f(tmpfile);
+
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LOG(VB_GUI | VB_FILE, LOG_WARNING, LOC +
+            QString("Unable to write cache file '%1'").arg(tmpfile));
+        return;
+    }
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    stream << kCacheMagic << kCacheVersion << file.m_filename
+           << (qint64)file.m_modified.toMSecsSinceEpoch() << file.m_size
+           << (quint32)file.m_entries.size();
+
+    QList<Entry>::const_iterator it = file.m_entries.begin();
+    for (; it != file.m_entries.end(); ++it)
+    {
+        stream << (*it).m_tagName << (*it).m_name << (*it).m_include
+               << (*it).m_tree;
+    }
+
+    f.close();
+
+    if (f.error() != QFile::NoError || stream.status() != QDataStream::Ok)
+    {
+        QFile::remove(tmpfile);
+        return;
+    }
+
+    // rename() replaces the old file atomically, so another frontend
+    // never sees a partial or missing file. QFile::rename() won't
+    // overwrite, and Windows can't, so there the old one goes first.
+#ifdef _WIN32
+    QFile::remove(cachefile);
+#endif
+    if (rename(QFile::encodeName(tmpfile).constData(),
+               QFile::encodeName(cachefile).constData()) != 0)
+    {
+        LOG(VB_GUI | VB_FILE, LOG_WARNING, LOC +
+            QString("Unable to replace cache file '%1'").arg(cachefile) + ENO);
+        QFile::remove(tmpfile);
+    }
+}
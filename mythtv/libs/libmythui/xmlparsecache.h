@@ -0,0 +1,85 @@
+#ifndef XMLPARSECACHE_H_
+#define XMLPARSECACHE_H_
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+
+#include "mythuiexp.h"
+
+class QDomDocument;
+class QDomElement;
+class QDataStream;
+
+/**
+ *  \class XMLParseCache
+ *
+ *  \brief Compiled form of the theme XML files.
+ *
+ *  Every theme file is DOM parsed only once and broken up into its top
+ *  level elements (windows, includes, base widgets and fonts). Each
+ *  element is kept as a compact binary tree which is expanded back into a
+ *  small QDomDocument only when that element is actually needed, so
+ *  loading a screen no longer requires parsing the whole theme file.
+ *
+ *  Compiled files are kept in memory and persisted below the configuration
+ *  directory so that a cold started frontend also benefits. Entries are
+ *  invalidated by the modification time and size of the source file.
+ */
+class MUI_PUBLIC XMLParseCache
+{
+  public:
+    class Entry
+    {
+      public:
+        QString    m_tagName;
+        QString    m_name;     ///< "name" attribute
+        QString    m_include;  ///< "include" attribute or <include> text
+        QByteArray m_tree;     ///< Binary encoded element
+    };
+
+    class File
+    {
+      public:
+        QString      m_filename;
+        QDateTime    m_modified;
+        qint64       m_size;
+        QList<Entry> m_entries;
+    };
+
+    static XMLParseCache *GetCache(void);
+
+    /// Fills in the compiled form of filename, compiling it if the
+    /// cached copy is missing or stale. Returns false if it can't be read.
+    bool GetFile(const QString &filename, File &file);
+
+    /// Expands an entry back into a DOM element owned by doc.
+    static QDomElement Expand(const Entry &entry, QDomDocument &doc);
+
+    uint GetHits(void) const   { return m_hits; }
+    uint GetMisses(void) const { return m_misses; }
+
+  private:
+    XMLParseCache(void);
+
+    bool Compile(const QString &filename, File &file);
+    bool LoadFromDisk(const QString &filename, File &file);
+    void SaveToDisk(const File &file);
+    QString DiskCacheFilename(const QString &filename) const;
+
+    static void EncodeNode(QDataStream &stream, const QDomElement &element);
+    static QDomElement DecodeNode(QDataStream &stream, QDomDocument &doc,
+                                  int depth);
+
+    QMutex                m_lock;
+    QHash<QString, File>  m_files;
+    QString               m_cacheDir;
+    uint                  m_hits;
+    uint                  m_misses;
+};
+
+#endif
@@ -46,6 +46,12 @@ libmythbase-test.target = buildtestmythbase
 libmythbase-test.commands = cd libmythbase/test && $(QMAKE) && $(MAKE)
 unix:QMAKE_EXTRA_TARGETS += libmythbase-test
 
+# unit tests libmythui
+libmythui-test.depends = sub-libmythui
+libmythui-test.target = buildtestmythui
+libmythui-test.commands = cd libmythui/test && $(QMAKE) && $(MAKE)
+unix:QMAKE_EXTRA_TARGETS += libmythui-test
+
 # unit tests libmythtv
 libmythtv-test.depends = sub-libmythtv
 libmythtv-test.target = buildtestmythtv
@@ -58,7 +64,7 @@ libmythmetadata-test.target = buildtestmythmetadata
 libmythmetadata-test.commands = cd libmythmetadata/test && $(QMAKE) && $(MAKE)
 unix:QMAKE_EXTRA_TARGETS += libmythmetadata-test
 
-unittest.depends = libmyth-test libmythbase-test libmythtv-test libmythmetadata-test
+unittest.depends = libmyth-test libmythbase-test libmythui-test libmythtv-test libmythmetadata-test
 unittest.target = test
 unittest.commands = ../programs/scripts/unittests.sh
 unix:QMAKE_EXTRA_TARGETS += unittest
@@ -8,6 +8,15 @@
 #include "mythsocket.h"
 #include "programinfo.h"
 #include "mythlogging.h"
+#include "mythmetrics.h"
+
+static MythCounter *transferred_bytes(const char *direction)
+{
+    return MythMetrics::Counter(
+        "mythtv_filetransfer_bytes_total",
+        "Bytes sent to (read) or received from (write) file transfer clients",
+        MythMetrics::Label("direction", direction));
+}
 
 FileTransfer::FileTransfer(QString &filename, MythSocket *remote,
                            bool usereadahead, int timeout_ms) :
@@ -152,6 +161,12 @@ int FileTransfer::RequestBlock(int size)
             break; // we hit eof
     }
 
+    if (tot > 0)
+    {
+        static MythCounter *counter = transferred_bytes("read");
+        counter->Add(tot);
+    }
+
     if (pginfo)
         pginfo->UpdateInUseMark();
 
@@ -215,6 +230,12 @@ int FileTransfer::WriteBlock(int size)
         tot += received;
     }
 
+    if (tot > 0)
+    {
+        static MythCounter *counter = transferred_bytes("write");
+        counter->Add(tot);
+    }
+
     if (pginfo)
         pginfo->UpdateInUseMark();
 
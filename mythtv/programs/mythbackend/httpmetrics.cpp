@@ -0,0 +1,38 @@
+// MythTV headers
+#include "httpmetrics.h"
+#include "mythmetrics.h"
+#include "mythlogging.h"
+
+HttpMetrics::HttpMetrics() : HttpServerExtension("HttpMetrics", QString())
+{
+}
+
+HttpMetrics::~HttpMetrics()
+{
+}
+
+QStringList HttpMetrics::GetBasePaths()
+{
+    QStringList paths;
+    paths << "/Metrics";
+    paths << "/metrics";
+    return paths;
+}
+
+bool HttpMetrics::ProcessRequest(HTTPRequest *request)
+{
+    if (!request)
+        return false;
+
+    if (request->m_sResourceUrl.compare("/Metrics", Qt::CaseInsensitive) != 0)
+        return false;
+
+    LOG(VB_UPNP, LOG_DEBUG, "HttpMetrics::ProcessRequest()");
+
+    request->m_eResponseType     = ResponseTypeOther;
+    request->m_sResponseTypeText = "text/plain; version=0.0.4; charset=utf-8";
+    request->m_nResponseStatus   = 200;
+    request->m_response.write(MythMetrics::Exposition());
+
+    return true;
+}
@@ -0,0 +1,23 @@
+// -*- Mode: c++ -*-
+
+#ifndef _HTTPMETRICS_H_
+#define _HTTPMETRICS_H_
+
+#include "httpserver.h"
+
+/** \class HttpMetrics
+ *  \brief Serves the backend's MythMetrics at /Metrics in the Prometheus
+ *         text exposition format, for scraping by a monitoring server.
+ */
+class HttpMetrics : public HttpServerExtension
+{
+  public:
+    HttpMetrics();
+    virtual ~HttpMetrics();
+
+    virtual QStringList GetBasePaths();
+
+    bool ProcessRequest(HTTPRequest *pRequest);
+};
+
+#endif
@@ -57,6 +57,7 @@
 
 #include "mediaserver.h"
 #include "httpstatus.h"
+#include "httpmetrics.h"
 #include "mythlogging.h"
 
 #define LOC      QString("MythBackend: ")
@@ -688,6 +689,9 @@ int run_backend(MythBackendCommandLineParser &cmdline)
 
         httpStatus = new HttpStatus( &tvList, sched, expirer, ismaster );
         pHS->RegisterExtension( httpStatus );
+
+        LOG(VB_GENERAL, LOG_INFO, "Main::Registering HttpMetrics Extension");
+        pHS->RegisterExtension( new HttpMetrics() );
     }
 
     mainServer = new MainServer(
@@ -72,6 +72,8 @@ using namespace std;
 #include "metadatafactory.h"
 #include "videoutils.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
+#include "mythmetrics.h"
 #include "filesysteminfo.h"
 #include "metaio.h"
 #include "musicmetadata.h"
@@ -92,6 +94,34 @@ using namespace std;
 #define LOC_WARN QString("MainServer, Warning: ")
 #define LOC_ERR  QString("MainServer, Error: ")
 
+/// Returns the latency histogram for a protocol command. Commands come
+/// from clients, so only the first few distinct ones get their own series.
+static MythHistogram *command_latency(const QString &command)
+{
+    static const int kMaxCommands = 128;
+    static QMutex lock;
+    static QHash<QString, MythHistogram*> histograms;
+
+    QMutexLocker locker(&lock);
+
+    QHash<QString, MythHistogram*>::const_iterator it =
+        histograms.find(command);
+    if (it != histograms.end())
+        return *it;
+
+    QString label = (histograms.size() < kMaxCommands) ? command : "other";
+    MythHistogram *histogram = MythMetrics::Histogram(
+        "mythtv_protocol_command_seconds",
+        "Time taken to handle each backend protocol command",
+        MythMetrics::LatencyBuckets(), 1000000.0,
+        MythMetrics::Label("command", label));
+
+    if (histograms.size() < kMaxCommands)
+        histograms.insert(command, histogram);
+
+    return histogram;
+}
+
 namespace {
 
 int delete_file_immediately(const QString &filename,
@@ -497,6 +527,10 @@ void MainServer::ProcessRequestWork(MythSocket *sock)
     line = line.simplified();
     QStringList tokens = line.split(' ', QString::SkipEmptyParts);
     QString command = tokens[0];
+
+    MYTH_TRACE_SPAN_DETAIL(kTraceServer, "MainServer command", line);
+    MythHistogramTimer latency(command_latency(command));
+
     if (command == "MYTH_PROTO_VERSION")
     {
         if (tokens.size() < 2)
@@ -1395,6 +1429,9 @@ void MainServer::customEvent(QEvent *e)
         if (me->Message() == "CLEAR_SETTINGS_CACHE")
             gCoreContext->ClearSettingsCache();
 
+        if (me->Message().startsWith("TRACE"))
+            MythTrace::HandleMessage(me->Message());
+
         if (me->Message().startsWith("RESET_IDLETIME") && m_sched)
             m_sched->ResetIdleTime();
 
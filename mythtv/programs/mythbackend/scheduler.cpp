@@ -46,6 +46,8 @@ using namespace std;
 #include "mythdb.h"
 #include "mythsystemevent.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
+#include "mythmetrics.h"
 
 #define LOC QString("Scheduler: ")
 #define LOC_WARN QString("Scheduler, Warning: ")
@@ -53,11 +55,29 @@ using namespace std;
 
 bool debugConflicts = false;
 
+/// Records a scheduler phase timed with gettimeofday(), the trace clock,
+/// as a trace event and in the phase duration histogram
+static void record_phase(const char *name, const struct timeval &start,
+                         const struct timeval &end)
+{
+    int64_t s = (int64_t)start.tv_sec * 1000000 + start.tv_usec;
+    int64_t e = (int64_t)end.tv_sec * 1000000 + end.tv_usec;
+
+    MythMetrics::Histogram("mythtv_scheduler_phase_seconds",
+                           "Time taken by each phase of a reschedule",
+                           MythMetrics::LatencyBuckets(), 1000000.0,
+                           MythMetrics::Label("phase", name))->Observe(e - s);
+
+    if (MythTrace::IsEnabled(kTraceScheduler))
+        MythTrace::Complete(kTraceScheduler, name, s, e - s);
+}
+
 Scheduler::Scheduler(bool runthread, QMap<int, EncoderLink *> *tvList,
                      QString tmptable, Scheduler *master_sched) :
     MThread("Scheduler"),
     recordTable(tmptable),
     priorityTable("powerpriority"),
+    reschedTraceId(0),
     schedLock(),
     reclist_changed(false),
     specsched(master_sched),
@@ -531,6 +551,7 @@ void Scheduler::FillRecordListFromDB(uint recordid)
     gettimeofday(&fillstart, NULL);
     UpdateMatches(recordid, 0, 0, QDateTime());
     gettimeofday(&fillend, NULL);
+    record_phase("match", fillstart, fillend);
     matchTime = ((fillend.tv_sec - fillstart.tv_sec ) * 1000000 +
                  (fillend.tv_usec - fillstart.tv_usec)) / 1000000.0;
 
@@ -541,12 +562,14 @@ void Scheduler::FillRecordListFromDB(uint recordid)
     LOG(VB_SCHEDULE, LOG_INFO, "UpdateDuplicates...");
     UpdateDuplicates();
     gettimeofday(&fillend, NULL);
+    record_phase("check", fillstart, fillend);
     checkTime = ((fillend.tv_sec - fillstart.tv_sec ) * 1000000 +
                  (fillend.tv_usec - fillstart.tv_usec)) / 1000000.0;
 
     gettimeofday(&fillstart, NULL);
     FillRecordList();
     gettimeofday(&fillend, NULL);
+    record_phase("place", fillstart, fillend);
     placeTime = ((fillend.tv_sec - fillstart.tv_sec ) * 1000000 +
                  (fillend.tv_usec - fillstart.tv_usec)) / 1000000.0;
 
@@ -1830,6 +1853,15 @@ void Scheduler::GetAllScheduled(QStringList &strList, SchedSortColumn sortBy,
 void Scheduler::Reschedule(const QStringList &request)
 {
     QMutexLocker locker(&schedLock);
+    if (!reschedTraceId && MythTrace::IsEnabled(kTraceScheduler))
+    {
+        reschedTraceId = MythTrace::NewFlowId();
+        MythTrace::AsyncBegin(kTraceScheduler, "reschedule queued",
+                              reschedTraceId);
+    }
+    if (reschedTraceId && !request.empty())
+        MYTH_TRACE_ASYNC_STEP(kTraceScheduler, "reschedule queued",
+                              reschedTraceId, request[0]);
     reschedQueue.enqueue(request);
     reschedWait.wakeOne();
 }
@@ -2239,6 +2271,8 @@ void Scheduler::ResetDuplicates(uint recordid, uint findid,
 
 bool Scheduler::HandleReschedule(void)
 {
+    MYTH_TRACE_SPAN(kTraceScheduler, "reschedule");
+
     // We might have been inactive for a long time, so make
     // sure our DB connection is fresh before continuing.
     dbConn = MSqlQuery::SchedCon();
@@ -2251,6 +2285,13 @@ bool Scheduler::HandleReschedule(void)
     bool deleteFuture = false;
     bool runCheck = false;
 
+    if (reschedTraceId)
+    {
+        MYTH_TRACE_ASYNC_END(kTraceScheduler, "reschedule queued",
+                             reschedTraceId);
+        reschedTraceId = 0;
+    }
+
     while (HaveQueuedRequests())
     {
         QStringList request = reschedQueue.dequeue();
@@ -2337,6 +2378,7 @@ bool Scheduler::HandleReschedule(void)
     }
 
     gettimeofday(&fillend, NULL);
+    record_phase("match", fillstart, fillend);
     matchTime = ((fillend.tv_sec - fillstart.tv_sec ) * 1000000 +
                  (fillend.tv_usec - fillstart.tv_usec)) / 1000000.0;
 
@@ -2350,12 +2392,14 @@ bool Scheduler::HandleReschedule(void)
         UpdateDuplicates();
     }
     gettimeofday(&fillend, NULL);
+    record_phase("check", fillstart, fillend);
     checkTime = ((fillend.tv_sec - fillstart.tv_sec ) * 1000000 +
                  (fillend.tv_usec - fillstart.tv_usec)) / 1000000.0;
 
     gettimeofday(&fillstart, NULL);
     bool worklistused = FillRecordList();
     gettimeofday(&fillend, NULL);
+    record_phase("place", fillstart, fillend);
     placeTime = ((fillend.tv_sec - fillstart.tv_sec ) * 1000000 +
                  (fillend.tv_usec - fillstart.tv_usec)) / 1000000.0;
 
@@ -215,6 +215,8 @@ class Scheduler : public MThread, public MythScheduler
     void CreateConflictLists(void);
 
     MythDeque<QStringList> reschedQueue;
+    /// Async trace id from the first queued request until it is handled
+    uint64_t reschedTraceId;
     mutable QMutex schedLock;
     QMutex recordmatchLock;
     QWaitCondition reschedWait;
@@ -39,6 +39,7 @@
 #include "mythcoreutil.h"
 #include "mythdbcon.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
 #include "storagegroup.h"
 #include "dbutil.h"
 #include "hardwareprofile.h"
@@ -1087,3 +1088,31 @@ DTC::BackendInfo* Myth::GetBackendInfo( void )
     return pInfo;
 
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+/////////////////////////////////////////////////////////////////////////////
+
+bool Myth::SetTrace( const QString &sCategories )
+{
+    bool ok = false;
+    MythTrace::ParseCategories(sCategories, &ok);
+    if (!ok)
+        throw( QString( "Unknown trace category." ));
+
+    // Handled by this backend and passed on to every connected program
+    gCoreContext->SendMessage("TRACE " + sCategories);
+
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+/////////////////////////////////////////////////////////////////////////////
+
+bool Myth::DumpTrace( const QString &sDirectory )
+{
+    gCoreContext->SendMessage("TRACE_DUMP " + sDirectory);
+
+    return true;
+}
@@ -140,6 +140,10 @@ class Myth : public MythServices
         QString             ProfileText         ( void );
 
         DTC::BackendInfo*   GetBackendInfo      ( void );
+
+        bool                SetTrace            ( const QString &Categories );
+
+        bool                DumpTrace           ( const QString &Directory );
 };
 
 // --------------------------------------------------------------------------
@@ -395,6 +399,20 @@ class ScriptableMyth : public QObject
                 return m_obj.GetBackendInfo();
             )
         }
+
+        bool SetTrace( const QString &Categories )
+        {
+            SCRIPT_CATCH_EXCEPTION( false,
+                return m_obj.SetTrace( Categories );
+            )
+        }
+
+        bool DumpTrace( const QString &Directory )
+        {
+            SCRIPT_CATCH_EXCEPTION( false,
+                return m_obj.DumpTrace( Directory );
+            )
+        }
 };
 
 Q_SCRIPT_DECLARE_QMETAOBJECT_MYTHTV( ScriptableMyth, QObject*);
@@ -34,6 +34,12 @@ void MythFrontendCommandLineParser::LoadArguments(void)
         "Start the frontend within specified plugin.", "")
             ->SetGroup("Startup Behavior")
             ->SetBlocks("jumppoint");
+    add("--startup-trace", "startuptrace", "",
+        "Write a timeline of the startup phases to the specified file.",
+        "The file uses the Chrome trace event format and can be opened\n"
+        "with chrome://tracing. It is written once the main menu has\n"
+        "been shown and the background startup work has finished.")
+            ->SetGroup("Startup Behavior");
 
     add(QStringList( QStringList() << "-G" << "--get-setting" ),
         "getsetting", "", "", "")
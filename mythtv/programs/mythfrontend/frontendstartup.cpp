@@ -0,0 +1,178 @@
+#include "frontendstartup.h"
+
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QThread>
+#include <QFile>
+#include <QDir>
+#include <QTextStream>
+
+#include "mythlogging.h"
+#include "mthreadpool.h"
+#include "xmlparsecache.h"
+
+#include <unistd.h>
+
+#define LOC QString("Startup: ")
+
+StartupTimeline *StartupTimeline::Get(void)
+{
+    static StartupTimeline timeline;
+    return &timeline;
+}
+
+StartupTimeline::StartupTimeline() :
+    m_mainThread((quint64)QThread::currentThreadId())
+{
+    m_clock.start();
+}
+
+void StartupTimeline::AddSpan(const QString &name, qint64 start, qint64 end)
+{
+    Event event;
+    event.name     = name;
+    event.start    = start;
+    event.duration = end - start;
+    event.thread   = (quint64)QThread::currentThreadId();
+
+    LOG(VB_GENERAL, LOG_DEBUG, LOC + QString("%1 took %2 ms")
+        .arg(name).arg(event.duration / 1000));
+
+    QMutexLocker locker(&m_lock);
+    m_events.append(event);
+}
+
+void StartupTimeline::AddMark(const QString &name)
+{
+    Event event;
+    event.name     = name;
+    event.start    = Now();
+    event.duration = -1;
+    event.thread   = (quint64)QThread::currentThreadId();
+
+    LOG(VB_GENERAL, LOG_INFO, LOC + QString("%1 after %2 ms")
+        .arg(name).arg(event.start / 1000));
+
+    QMutexLocker locker(&m_lock);
+    m_events.append(event);
+}
+
+static QString JSONString(const QString &str)
+{
+    QString escaped = str;
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+/**
+ *  \brief Writes all events so far as a Chrome trace event file
+ */
+bool StartupTimeline::Write(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Unable to write startup trace to '%1'").arg(filename));
+        return false;
+    }
+
+    QMutexLocker locker(&m_lock);
+
+    QTextStream out(&file);
+    qint64 pid = getpid();
+
+    out << "{\"traceEvents\":[\n";
+    out << QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%1,"
+                   "\"tid\":%2,\"args\":{\"name\":\"main\"}}")
+               .arg(pid).arg(m_mainThread);
+
+    QVector<Event>::const_iterator it;
+    for (it = m_events.begin(); it != m_events.end(); ++it)
+    {
+        out << ",\n";
+        if ((*it).duration < 0)
+        {
+            out << QString("{\"name\":%1,\"cat\":\"startup\",\"ph\":\"i\","
+                           "\"s\":\"g\",\"ts\":%2,\"pid\":%3,\"tid\":%4}")
+                       .arg(JSONString((*it).name)).arg((*it).start)
+                       .arg(pid).arg((*it).thread);
+        }
+        else
+        {
+            out << QString("{\"name\":%1,\"cat\":\"startup\",\"ph\":\"X\","
+                           "\"ts\":%2,\"dur\":%3,\"pid\":%4,\"tid\":%5}")
+                       .arg(JSONString((*it).name)).arg((*it).start)
+                       .arg((*it).duration).arg(pid).arg((*it).thread);
+        }
+    }
+
+    out << "\n]}\n";
+    out.flush();
+
+    LOG(VB_GENERAL, LOG_INFO, LOC +
+        QString("Wrote startup trace to '%1'").arg(filename));
+
+    return true;
+}
+
+StartupSpan::StartupSpan(const QString &name) :
+    m_name(name), m_start(StartupTimeline::Get()->Now()), m_done(false)
+{
+}
+
+void StartupSpan::End(void)
+{
+    if (m_done)
+        return;
+
+    m_done = true;
+    StartupTimeline::Get()->AddSpan(m_name, m_start,
+                                    StartupTimeline::Get()->Now());
+}
+
+namespace
+{
+    class ThemeWarmupTask : public QRunnable
+    {
+      public:
+        explicit ThemeWarmupTask(const QStringList &files) : m_files(files) {}
+
+        void run()
+        {
+            StartupSpan span("theme cache warm-up");
+
+            XMLParseCache *cache = XMLParseCache::GetCache();
+            XMLParseCache::File file;
+
+            QStringList::const_iterator it;
+            for (it = m_files.begin(); it != m_files.end(); ++it)
+                cache->GetFile(*it, file);
+        }
+
+      private:
+        QStringList m_files;
+    };
+}
+
+void FrontendStartup::WarmThemeCache(const QStringList &dirs)
+{
+    QStringList files;
+
+    QStringList::const_iterator it;
+    for (it = dirs.begin(); it != dirs.end(); ++it)
+    {
+        QDir dir(*it);
+        QStringList entries = dir.entryList(QStringList("*.xml"),
+                                            QDir::Files | QDir::Readable);
+        // Same form as XMLParseBase uses, which the cache is keyed on
+        QStringList::const_iterator entry;
+        for (entry = entries.begin(); entry != entries.end(); ++entry)
+            files << *it + *entry;
+    }
+
+    if (!files.isEmpty())
+        MThreadPool::globalInstance()->start(new ThemeWarmupTask(files),
+                                             "ThemeWarmup");
+}
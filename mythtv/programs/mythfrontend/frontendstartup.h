@@ -0,0 +1,78 @@
+#ifndef FRONTENDSTARTUP_H_
+#define FRONTENDSTARTUP_H_
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+
+/**
+ *  \class StartupTimeline
+ *
+ *  \brief Records how long each phase of frontend startup takes.
+ *
+ *  Phases are recorded as spans from whichever thread runs them, so work
+ *  moved onto the thread pool shows up next to the main thread. The result
+ *  can be written in the Chrome trace event format and viewed with
+ *  chrome://tracing (mythfrontend --startup-trace <file>).
+ */
+class StartupTimeline
+{
+  public:
+    static StartupTimeline *Get(void);
+
+    /// Microseconds since the timeline was created
+    qint64 Now(void) const { return m_clock.nsecsElapsed() / 1000; }
+
+    void AddSpan(const QString &name, qint64 start, qint64 end);
+    void AddMark(const QString &name);
+
+    bool Write(const QString &filename);
+
+  private:
+    StartupTimeline();
+
+    class Event
+    {
+      public:
+        QString name;
+        qint64  start;
+        qint64  duration; ///< -1 for instant events
+        quint64 thread;
+    };
+
+    QMutex         m_lock;
+    QElapsedTimer  m_clock;
+    QVector<Event> m_events;
+    quint64        m_mainThread;
+};
+
+/**
+ *  \class StartupSpan
+ *
+ *  \brief Adds a span to the StartupTimeline covering its own lifetime,
+ *         or up to the first call to End().
+ */
+class StartupSpan
+{
+  public:
+    explicit StartupSpan(const QString &name);
+   ~StartupSpan() { End(); }
+
+    void End(void);
+
+  private:
+    QString m_name;
+    qint64  m_start;
+    bool    m_done;
+};
+
+namespace FrontendStartup
+{
+    /// Compiles the theme XML files in dirs (the theme search path) on
+    /// the thread pool, so the main menu finds them in the theme XML cache.
+    void WarmThemeCache(const QStringList &dirs);
+}
+
+#endif
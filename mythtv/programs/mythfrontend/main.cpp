@@ -17,6 +17,7 @@ using namespace std;
 #include <QWidget>
 #include <QApplication>
 #include <QTimer>
+#include <QElapsedTimer>
 #ifdef Q_OS_MAC
 #include <QProcessEnvironment>
 #endif
@@ -84,6 +85,8 @@ using namespace std;
 #include "mythversion.h"
 #include "taskqueue.h"
 #include "cleanupguard.h"
+#include "mthreadpool.h"
+#include "frontendstartup.h"
 
 // Video
 #include "cleanup.h"
@@ -252,6 +255,81 @@ namespace
         ProgramInfo* pgi;
     };
 
+    /**
+     *  \brief Startup work that is not needed to show the main menu
+     *
+     *  Runs once the main menu has been drawn for the first time, then
+     *  writes the startup trace (if requested) when the thread pool has
+     *  finished the work queued during startup.
+     */
+    class DeferredStartup : public QObject
+    {
+        Q_OBJECT
+
+      public:
+        DeferredStartup(bool startUPnP, MediaMonitor *monitor,
+                        const QString &traceFile) :
+            m_startUPnP(startUPnP), m_monitor(monitor),
+            m_traceFile(traceFile)
+        {
+            connect(GetMythMainWindow(), SIGNAL(FrameDrawn()),
+                    this, SLOT(Run()), Qt::QueuedConnection);
+        }
+
+      private slots:
+        void Run(void)
+        {
+            disconnect(GetMythMainWindow(), SIGNAL(FrameDrawn()),
+                       this, SLOT(Run()));
+
+            StartupTimeline::Get()->AddMark("main menu shown");
+
+            if (m_startUPnP)
+            {
+                StartupSpan span("UPnP media renderer");
+                g_pUPnp  = new MediaRenderer();
+                if (!g_pUPnp->isInitialized())
+                {
+                    delete g_pUPnp;
+                    g_pUPnp = NULL;
+                }
+            }
+
+            if (m_monitor)
+            {
+                StartupSpan span("media monitor");
+                m_monitor->StartMonitoring();
+            }
+
+            StartupTimeline::Get()->AddMark("deferred startup done");
+
+            m_waited.start();
+            WriteTrace();
+        }
+
+        void WriteTrace(void)
+        {
+            // Give the thread pool up to 10 seconds to finish
+            if (MThreadPool::globalInstance()->activeThreadCount() > 0 &&
+                m_waited.elapsed() < 10000)
+            {
+                QTimer::singleShot(100, this, SLOT(WriteTrace()));
+                return;
+            }
+
+            if (!m_traceFile.isEmpty())
+                StartupTimeline::Get()->Write(m_traceFile);
+
+            deleteLater();
+        }
+
+      private:
+        bool          m_startUPnP;
+        MediaMonitor *m_monitor;
+        QString       m_traceFile;
+        QElapsedTimer m_waited;
+    };
+
     void cleanup()
     {
 #ifdef USING_AIRPLAY
@@ -1359,6 +1437,12 @@ static void setDebugShowNames(void)
         GetMythMainWindow()->GetMainStack()->GetTopScreen()->SetRedraw();
 }
 
+static void setDebugShowFrameStats(void)
+{
+    MythMainWindow *mainWindow = GetMythMainWindow();
+    mainWindow->SetFrameStatsOverlay(!mainWindow->GetFrameStatsOverlay());
+}
+
 static void InitJumpPoints(void)
 {
      REG_JUMP(QT_TRANSLATE_NOOP("MythControls", "Reload Theme"),
@@ -1413,6 +1497,8 @@ static void InitJumpPoints(void)
          "", "", setDebugShowBorders, false);
      REG_JUMPEX(QT_TRANSLATE_NOOP("MythControls", "Toggle Show Widget Names"),
          "", "", setDebugShowNames, false);
+     REG_JUMPEX(QT_TRANSLATE_NOOP("MythControls", "Toggle Frame Statistics"),
+         "", "", setDebugShowFrameStats, false);
      REG_JUMPEX(QT_TRANSLATE_NOOP("MythControls", "Reset All Keys"),
          QT_TRANSLATE_NOOP("MythControls", "Reset all keys to defaults"),
          "", resetAllKeys, false);
@@ -1672,6 +1758,9 @@ static int revokeRoot (void)
 
 int main(int argc, char **argv)
 {
+    // Start the startup timeline clock
+    StartupTimeline::Get();
+
     bool bPromptForBackend    = false;
     bool bBypassAutoDiscovery = false;
 
@@ -1773,6 +1862,7 @@ int main(int argc, char **argv)
         MythUIHelper::ParseGeometryOverride(cmdline.toString("geometry"));
     }
 
+    StartupSpan contextSpan("context init");
     gContext = new MythContext(MYTH_BINARY_VERSION);
 
     if (!gContext->Init(true, bPromptForBackend, bBypassAutoDiscovery))
@@ -1781,6 +1871,7 @@ int main(int argc, char **argv)
         return GENERIC_EXIT_NO_MYTHCONTEXT;
     }
     gCoreContext->SetAsFrontend(true);
+    contextSpan.End();
 
     cmdline.ApplySettingsOverride();
 
@@ -1793,16 +1884,6 @@ int main(int argc, char **argv)
     if (cmdline.toBool("reset"))
         ResetSettings = true;
 
-    if (!cmdline.toBool("noupnp"))
-    {
-        g_pUPnp  = new MediaRenderer();
-        if (!g_pUPnp->isInitialized())
-        {
-            delete g_pUPnp;
-            g_pUPnp = NULL;
-        }
-    }
-
     QString fileprefix = GetConfDir();
 
     QDir dir(fileprefix);
@@ -1868,6 +1949,7 @@ int main(int argc, char **argv)
         return GENERIC_EXIT_NO_THEME;
     }
 
+    StartupSpan themeSpan("theme config");
     GetMythUI()->LoadQtConfig();
 
     themename = gCoreContext->GetSetting("Theme", DEFAULT_UI_THEME);
@@ -1878,13 +1960,18 @@ int main(int argc, char **argv)
                 .arg(themename));
         return GENERIC_EXIT_NO_THEME;
     }
+    themeSpan.End();
+
+    FrontendStartup::WarmThemeCache(GetMythUI()->GetThemeSearchPath());
 
+    StartupSpan windowSpan("main window init");
     MythMainWindow *mainWindow = GetMythMainWindow();
 #if CONFIG_DARWIN
     mainWindow->Init(QT_PAINTER);
 #else
     mainWindow->Init();
 #endif
+    windowSpan.End();
     mainWindow->setWindowTitle(qApp->translate("(MythFrontendMain)",
                                                "MythTV Frontend",
                                                "Main window title"));
@@ -1909,13 +1996,16 @@ int main(int argc, char **argv)
             return GENERIC_EXIT_NO_THEME;
     }
 
+    StartupSpan schemaSpan("schema check");
     if (!UpgradeTVDatabaseSchema(false))
     {
         LOG(VB_GENERAL, LOG_ERR,
             "Couldn't upgrade database to new schema, exiting.");
         return GENERIC_EXIT_DB_OUTOFDATE;
     }
+    schemaSpan.End();
 
+    StartupSpan keysSpan("keys and jump points");
     WriteDefaults();
 
     // Refresh Global/Main Menu keys after DB update in case there was no DB
@@ -1926,22 +2016,27 @@ int main(int argc, char **argv)
     InitKeys();
     TV::InitKeys();
     SetFuncPtrs();
+    keysSpan.End();
 
+    StartupSpan mediaSpan("media init");
     internal_media_init();
 
     CleanupMyOldInUsePrograms();
 
     setHttpProxy();
+    mediaSpan.End();
 
+    // The main menu depends on which plugins are loaded, and loading a
+    // plugin runs its static initialisers, so this stays on the main thread.
+    StartupSpan pluginSpan("plugin init");
     pmanager = new MythPluginManager();
     gCoreContext->SetPluginManager(pmanager);
+    pluginSpan.End();
 
+    // Device scanning starts once the main menu is up
     MediaMonitor *mon = MediaMonitor::GetMediaMonitor();
     if (mon)
-    {
-        mon->StartMonitoring();
         mainWindow->installEventFilter(mon);
-    }
 
     NetworkControl *networkControl = NULL;
     if (gCoreContext->GetNumSetting("NetworkControlEnabled", 0))
@@ -1961,10 +2056,16 @@ int main(int argc, char **argv)
     GetMythMainWindow()->SetEffectsEnabled(true);
     gLoaded = true;
 #endif
+    StartupSpan menuSpan("main menu");
     if (!RunMenu(themedir, themename) && !resetTheme(themedir, themename))
     {
         return GENERIC_EXIT_NO_THEME;
     }
+    menuSpan.End();
+
+    new DeferredStartup(!cmdline.toBool("noupnp"), mon,
+                        cmdline.toString("startuptrace"));
+
     ThemeUpdateChecker *themeUpdateChecker = NULL;
     if (gCoreContext->GetNumSetting("ThemeUpdateNofications", 1))
         themeUpdateChecker = new ThemeUpdateChecker();
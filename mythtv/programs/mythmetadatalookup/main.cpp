@@ -26,6 +26,7 @@ using namespace std;
 #include "mythlogging.h"
 #include "signalhandling.h"
 #include "cleanupguard.h"
+#include "metadatagrabberpool.h"
 
 #include "lookup.h"
 
@@ -33,6 +34,7 @@ namespace
 {
     void cleanup()
     {
+        MetaGrabberPool::Shutdown();
         delete gContext;
         gContext = NULL;
         SignalHandler::Done();
@@ -513,6 +513,78 @@ static HostSpinBox *JobQueueCheckFrequency()
     return gc;
 };
 
+static HostSpinBox *JobQueueMaxCPUUsage()
+{
+    HostSpinBox *gc = new HostSpinBox("JobQueueMaxCPUUsage", 0, 100, 5);
+    gc->setLabel(QObject::tr("Maximum CPU usage for more jobs (%)"));
+    gc->setHelpText(QObject::tr("While a job is running, another one will "
+                    "only be started if the CPU is less busy than this. "
+                    "Set to 0 to ignore the CPU usage."));
+    gc->setValue(90);
+    return gc;
+};
+
+static HostSpinBox *JobQueueMaxWriteLatency()
+{
+    HostSpinBox *gc = new HostSpinBox("JobQueueMaxWriteLatency", 0, 2000, 10);
+    gc->setLabel(QObject::tr("Maximum disk write time for more jobs (ms)"));
+    gc->setHelpText(QObject::tr("While a job is running, another one will "
+                    "only be started if writes to the disks holding this "
+                    "backend's storage groups take less time than this on "
+                    "average. Set to 0 to ignore the disks."));
+    gc->setValue(100);
+    return gc;
+};
+
+static HostSpinBox *JobQueueMaxJobsWhileRecording()
+{
+    HostSpinBox *gc = new HostSpinBox("JobQueueMaxJobsWhileRecording",
+                                      0, 10, 1);
+    gc->setLabel(QObject::tr("Maximum simultaneous jobs while recording"));
+    gc->setHelpText(QObject::tr("The Job Queue will be limited to running "
+                    "this many simultaneous jobs while this backend is "
+                    "recording."));
+    gc->setValue(1);
+    return gc;
+};
+
+static HostSpinBox *JobQueueMaxJobsOfType(const QString &setting,
+                                          const QString &label)
+{
+    HostSpinBox *gc = new HostSpinBox(setting, 0, 10, 1);
+    gc->setLabel(label);
+    gc->setHelpText(QObject::tr("The Job Queue will be limited to running "
+                    "this many jobs of this type at once on this backend. "
+                    "Set to 0 to only apply the overall limit."));
+    gc->setValue(0);
+    return gc;
+};
+
+static HostLineEdit *JobQueueCGroup()
+{
+    HostLineEdit *gc = new HostLineEdit("JobQueueCGroup");
+    gc->setLabel(QObject::tr("Job cgroup"));
+    gc->setValue("");
+    gc->setHelpText(QObject::tr("If set, jobs are run in this cgroup v2 "
+                    "group, for example /sys/fs/cgroup/mythtv/jobs, with "
+                    "the CPU and IO weights below. Its parent group must "
+                    "have the cpu and io controllers enabled and be "
+                    "writable by the backend."));
+    return gc;
+};
+
+static HostSpinBox *JobQueueCGroupWeight(const QString &setting,
+                                         const QString &label)
+{
+    HostSpinBox *gc = new HostSpinBox(setting, 1, 10000, 10);
+    gc->setLabel(label);
+    gc->setHelpText(QObject::tr("The share of the host jobs in the cgroup "
+                    "get when it is busy, compared to the default of 100 "
+                    "that the recorders run with."));
+    gc->setValue(20);
+    return gc;
+};
+
 static HostComboBox *JobQueueCPU()
 {
     HostComboBox *gc = new HostComboBox("JobQueueCPU");
@@ -558,6 +630,32 @@ static GlobalCheckBox *JobsRunOnRecordHost()
     return gc;
 };
 
+static GlobalCheckBox *CommFlagInRecorder()
+{
+    GlobalCheckBox *gc = new GlobalCheckBox("CommFlagInRecorder");
+    gc->setLabel(QObject::tr("Flag commercials in the recorder"));
+    gc->setValue(false);
+    gc->setHelpText(QObject::tr("If enabled, digital recordings are "
+                    "checked for commercials by the backend as they are "
+                    "recorded, so the breaks are ready when the recording "
+                    "ends. If the backend can't keep up, the recording is "
+                    "flagged by the usual job afterwards."));
+    return gc;
+};
+
+static GlobalSpinBox *JobQueueRemoteClaimDelay()
+{
+    GlobalSpinBox *gc = new GlobalSpinBox("JobQueueRemoteClaimDelay",
+                                          0, 600, 10);
+    gc->setLabel(QObject::tr("Wait for a better placed backend (secs)"));
+    gc->setValue(60);
+    gc->setHelpText(QObject::tr("How long a new job is left for the "
+                    "best placed backend, an idle one and preferably one "
+                    "with the recording on its own disks, before any "
+                    "backend may run it."));
+    return gc;
+};
+
 static GlobalCheckBox *AutoTranscodeBeforeAutoCommflag()
 {
     GlobalCheckBox *gc = new GlobalCheckBox("AutoTranscodeBeforeAutoCommflag");
@@ -937,10 +1035,43 @@ BackendSettings::BackendSettings() {
     group5->addChild(group5a);
     addChild(group5);
 
+    VerticalConfigurationGroup* group5b = new VerticalConfigurationGroup(false);
+    group5b->setLabel(QObject::tr("Job Queue (Backend-Specific Resources)"));
+    group5b->addChild(JobQueueMaxJobsWhileRecording());
+    group5b->addChild(JobQueueMaxCPUUsage());
+    group5b->addChild(JobQueueMaxWriteLatency());
+
+    HorizontalConfigurationGroup* group5b1 =
+              new HorizontalConfigurationGroup(false, false);
+    VerticalConfigurationGroup* group5b2 =
+              new VerticalConfigurationGroup(false, false);
+    group5b2->addChild(JobQueueMaxJobsOfType("JobQueueMaxTranscodeJobs",
+                       QObject::tr("Maximum transcode jobs")));
+    group5b2->addChild(JobQueueMaxJobsOfType("JobQueueMaxCommFlagJobs",
+                       QObject::tr("Maximum commercial detection jobs")));
+    group5b1->addChild(group5b2);
+    VerticalConfigurationGroup* group5b3 =
+              new VerticalConfigurationGroup(false, false);
+    group5b3->addChild(JobQueueMaxJobsOfType("JobQueueMaxMetadataJobs",
+                       QObject::tr("Maximum metadata lookup jobs")));
+    group5b3->addChild(JobQueueMaxJobsOfType("JobQueueMaxUserJobs",
+                       QObject::tr("Maximum user jobs")));
+    group5b1->addChild(group5b3);
+    group5b->addChild(group5b1);
+
+    group5b->addChild(JobQueueCGroup());
+    group5b->addChild(JobQueueCGroupWeight("JobQueueCGroupCPUWeight",
+                      QObject::tr("Job cgroup CPU weight")));
+    group5b->addChild(JobQueueCGroupWeight("JobQueueCGroupIOWeight",
+                      QObject::tr("Job cgroup IO weight")));
+    addChild(group5b);
+
     VerticalConfigurationGroup* group6 = new VerticalConfigurationGroup(false);
     group6->setLabel(QObject::tr("Job Queue (Global)"));
     group6->addChild(JobsRunOnRecordHost());
+    group6->addChild(JobQueueRemoteClaimDelay());
     group6->addChild(AutoCommflagWhileRecording());
+    group6->addChild(CommFlagInRecorder());
     group6->addChild(JobQueueCommFlagCommand());
     group6->addChild(JobQueueTranscodeCommand());
     group6->addChild(AutoTranscodeBeforeAutoCommflag());
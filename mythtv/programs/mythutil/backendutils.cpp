@@ -8,6 +8,7 @@ using std::endl;
 #include "exitcodes.h"
 #include "mythcorecontext.h"
 #include "mythlogging.h"
+#include "mythtrace.h"
 
 // libmyth
 #include "remoteutil.h"
@@ -50,6 +51,39 @@ static int ClearSettingsCache(const MythUtilCommandLineParser &cmdline)
     return GENERIC_EXIT_CONNECT_ERROR;
 }
 
+static int SetTrace(const MythUtilCommandLineParser &cmdline)
+{
+    bool ok = false;
+    MythTrace::ParseCategories(cmdline.toString("settrace"), &ok);
+    if (!ok)
+        return GENERIC_EXIT_INVALID_CMDLINE;
+
+    if (gCoreContext->ConnectToMasterServer(false, false))
+    {
+        gCoreContext->SendMessage("TRACE " + cmdline.toString("settrace"));
+        LOG(VB_GENERAL, LOG_INFO, "Sent TRACE message");
+        return GENERIC_EXIT_OK;
+    }
+
+    LOG(VB_GENERAL, LOG_ERR, "Unable to connect to backend, trace "
+        "categories unchanged.");
+    return GENERIC_EXIT_CONNECT_ERROR;
+}
+
+static int DumpTrace(const MythUtilCommandLineParser &cmdline)
+{
+    if (gCoreContext->ConnectToMasterServer(false, false))
+    {
+        gCoreContext->SendMessage("TRACE_DUMP " + cmdline.toString("dumptrace"));
+        LOG(VB_GENERAL, LOG_INFO, "Sent TRACE_DUMP message");
+        return GENERIC_EXIT_OK;
+    }
+
+    LOG(VB_GENERAL, LOG_ERR, "Unable to connect to backend, trace "
+        "will not be written.");
+    return GENERIC_EXIT_CONNECT_ERROR;
+}
+
 static int SendEvent(const MythUtilCommandLineParser &cmdline)
 {
     return RawSendEvent(cmdline.toStringList("event"));
@@ -112,6 +146,8 @@ void registerBackendUtils(UtilMap &utilMap)
     utilMap["scanvideos"]           = &ScanVideos;
     utilMap["systemevent"]          = &SendSystemEvent;
     utilMap["parsevideo"]           = &ParseVideoFilename;
+    utilMap["settrace"]             = &SetTrace;
+    utilMap["dumptrace"]            = &DumpTrace;
 }
 
 /* vim: set expandtab tabstop=4 shiftwidth=4: */
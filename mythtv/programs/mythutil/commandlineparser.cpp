@@ -121,6 +121,22 @@ void MythUtilCommandLineParser::LoadArguments(void)
                 "local database settings cache used by each program, causing "
                 "options to be re-read from the database upon next use.")
                 ->SetGroup("Backend")
+        << add("--settrace", "settrace", "",
+                "Change the trace categories recorded by all connected "
+                "MythTV programs.",
+                "Takes a comma separated list of categories: recorder, "
+                "stream, scheduler, server, player, ui, all or none. "
+                "Events are kept in memory by each program until "
+                "--dumptrace is used.")
+                ->SetGroup("Backend")
+        << add("--dumptrace", "dumptrace", "",
+                "Make all connected MythTV programs write out their trace "
+                "events.",
+                "Each program writes a Chrome trace event file named "
+                "<application>-<pid>.trace.json to the given directory on "
+                "its own host, which can be loaded into chrome://tracing "
+                "or the Perfetto UI.")
+                ->SetGroup("Backend")
         << add("--parse-video-filename", "parsevideo", "", "",
                 "Diagnostic tool for testing filename formats against what "
                 "the Video Library name parser will detect them as.")
@@ -11,7 +11,7 @@
 #-----------------------
 __title__ = "TheMovieDB.org V3"
 __author__ = "Raymond Wagner"
-__version__ = "0.3.7"
+__version__ = "0.3.8"
 # 0.1.0 Initial version
 # 0.2.0 Add language support, move cache to home directory
 # 0.3.0 Enable version detection to allow use in MythTV
@@ -26,6 +26,8 @@ __version__ = "0.3.7"
 #       resolved upstream.
 # 0.3.7 Add handling for TMDB site returning insufficient results from a
 #       query
+# 0.3.8 Add --worker mode, answering lookups from MythTV on stdin without
+#       restarting the interpreter for each one
 
 from optparse import OptionParser
 import sys
@@ -223,6 +225,7 @@ def buildVersion():
     etree.SubElement(version, "version").text = __version__
     etree.SubElement(version, "accepts").text = 'tmdb.py'
     etree.SubElement(version, "accepts").text = 'tmdb.pl'
+    etree.SubElement(version, "worker").text = 'true'
     sys.stdout.write(etree.tostring(version, encoding='UTF-8', pretty_print=True,
                                     xml_declaration=True))
     sys.exit(0)
@@ -252,7 +255,59 @@ def performSelfTest():
         print "Everything appears in order."
     sys.exit(err)
 
-def main():
+def runWorker():
+    """Answer lookups until stdin is closed, one JSON request per line,
+
+        {"id":1,"args":["-l","en","-M","Title"]}
+
+    each answered by one line giving the exit status and output the same
+    command line would have had,
+
+        {"id":1,"status":0,"output":"<?xml ... </metadata>"}
+
+    See MetaGrabberPool in libmythmetadata.
+    """
+    import json
+    import traceback
+    from StringIO import StringIO
+    import MythTV.tmdb3.locales
+
+    stdout = sys.stdout
+    while True:
+        line = sys.stdin.readline()
+        if not line:
+            break
+        request = json.loads(line)
+
+        # every lookup starts from the defaults, as a fresh process would
+        MythTV.tmdb3.locales.syslocale = None
+
+        sys.stdout = StringIO()
+        status = 0
+        try:
+            main([arg.encode('utf-8') for arg in request.get('args', [])])
+        except SystemExit, e:
+            if isinstance(e.code, int):
+                status = e.code
+            elif e.code is not None:
+                sys.stderr.write('%s\n' % e.code)
+                status = 1
+        except Exception:
+            traceback.print_exc()
+            status = 1
+        output = sys.stdout.getvalue()
+        sys.stdout = stdout
+        if isinstance(output, str):
+            output = output.decode('utf-8', 'replace')
+
+        stdout.write(json.dumps({'id':     request.get('id'),
+                                 'status': status,
+                                 'output': output}))
+        stdout.write('\n')
+        stdout.flush()
+    sys.exit(0)
+
+def main(argv=None):
     parser = OptionParser()
 
     parser.add_option('-v', "--version", action="store_true", default=False,
@@ -272,12 +327,18 @@ def main():
     parser.add_option('--debug', action="store_true", default=False,
                       dest="debug", help=("Disable caching and enable raw "
                                           "data output."))
+    parser.add_option('--worker', action="store_true", default=False,
+                      dest="worker", help=("Answer JSON requests from MythTV "
+                                           "on stdin until it is closed."))
 
-    opts, args = parser.parse_args()
+    opts, args = parser.parse_args(argv)
 
     if opts.version:
         buildVersion()
 
+    if opts.worker:
+        runWorker()
+
     if opts.test:
         performSelfTest()
 
@@ -37,7 +37,7 @@
 #-------------------------------------
 __title__ ="TheTVDB.com";
 __author__="R.D.Vaughan"
-__version__="1.1.5"
+__version__="1.1.7"
 # Version .1    Initial development
 # Version .2    Add an option to get season and episode numbers from ep name
 # Version .3    Cleaned up the documentation and added a usage display option
@@ -137,6 +137,8 @@ __version__="1.1.5"
 # Version 1.1.5 Add the -C (collection option) with corresponding XML output
 #               and add a <collectionref> XML tag to Search and Query XML output
 # Version 1.1.6 Honor series name overrides during TV series search
+# Version 1.1.7 Add --worker mode, answering lookups from MythTV on stdin
+#               without restarting the interpreter for each one
 
 usage_txt='''
 Usage: ttvdb.py usage: ttvdb -hdruviomMPFBDSC [parameters]
@@ -173,6 +175,7 @@ Options:
   -D, --data            Get Series episode data
   -N, --numbers         Get Season and Episode numbers
   -C, --collection      Get A TV Series (collection) series specific information
+  --worker              Answer JSON requests from MythTV on stdin until it is closed
 
 Command examples:
 (Return the banner graphics for a series)
@@ -1143,7 +1146,55 @@ def displayCollectionXML(tvdb_api):
     sys.exit(0)
 # end displayCollectionXML()
 
-def main():
+def runWorker():
+    '''Answer lookups until stdin is closed, one JSON request per line,
+        {"id":1,"args":["-l","en","-M","Title"]}
+    each answered by one line giving the exit status and output the same
+    command line would have had,
+        {"id":1,"status":0,"output":"<?xml ... </metadata>"}
+    See MetaGrabberPool in libmythmetadata.
+    '''
+    import json
+    import traceback
+    global screenshot_request
+
+    stdout = sys.stdout
+    while True:
+        line = sys.stdin.readline()
+        if not line:
+            break
+        request = json.loads(line)
+
+        # every lookup starts from the defaults, as a fresh process would
+        screenshot_request = False
+
+        sys.stdout = OutStreamEncoder(StringIO(), 'utf8')
+        status = 0
+        try:
+            main([arg.encode('utf8') for arg in request.get('args', [])])
+        except SystemExit, e:
+            if isinstance(e.code, int):
+                status = e.code
+            elif e.code is not None:
+                sys.stderr.write(u'%s\n' % e.code)
+                status = 1
+        except Exception:
+            traceback.print_exc()
+            status = 1
+        output = sys.stdout.out.getvalue()
+        sys.stdout = stdout
+        if isinstance(output, str):
+            output = unicode(output, 'utf8', 'replace')
+
+        stdout.write(json.dumps({'id':     request.get('id'),
+                                 'status': status,
+                                 'output': output}))
+        stdout.write('\n')
+        stdout.flush()
+    sys.exit(0)
+# end runWorker()
+
+def main(argv=None):
     parser = OptionParser(usage=u"%prog usage: ttvdb -hdruviomMPFBDS [parameters]\n <series name or 'series and season number' or 'series and season number and episode number'>\n\nFor details on using ttvdb with Mythvideo see the ttvdb wiki page at:\nhttp://www.mythtv.org/wiki/Ttvdb.py")
 
     parser.add_option(  "-d", "--debug", action="store_true", default=False, dest="debug",
@@ -1184,8 +1235,13 @@ def main():
                         help=u"Get Season and Episode numbers")
     parser.add_option(  "-C", "--collection", action="store_true", default=False, dest="collection",
                         help=u'Get a TV Series (collection) "series" level information')
+    parser.add_option(  "--worker", action="store_true", default=False, dest="worker",
+                        help=u"Answer JSON requests from MythTV on stdin until it is closed")
+
+    opts, series_season_ep = parser.parse_args(argv)
 
-    opts, series_season_ep = parser.parse_args()
+    if opts.worker:
+        runWorker()
 
 
     # Test mode, if we've made it here, everything is ok
@@ -1211,6 +1267,7 @@ def main():
         etree.SubElement(version, "type").text = 'television'
         etree.SubElement(version, "description").text = 'Search and metadata downloads for thetvdb.com'
         etree.SubElement(version, "version").text = __version__
+        etree.SubElement(version, "worker").text = 'true'
         sys.stdout.write(etree.tostring(version, encoding='UTF-8', pretty_print=True))
         sys.exit(0)
 